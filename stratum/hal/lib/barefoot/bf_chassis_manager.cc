@@ -3,16 +3,23 @@
 
 #include "stratum/hal/lib/barefoot/bf_chassis_manager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "gflags/gflags.h"
 #include "stratum/glue/integral_types.h"
 #include "stratum/hal/lib/barefoot/bfrt_constants.h"
 #include "stratum/hal/lib/common/constants.h"
@@ -25,6 +32,11 @@
 #include "stratum/lib/macros.h"
 #include "stratum/lib/utils.h"
 
+DEFINE_int32(bfrt_port_config_threads, 8,
+             "Number of threads configuring ports in parallel during chassis "
+             "config pushes and replays. A value of 1 or less configures the "
+             "ports one at a time.");
+
 namespace stratum {
 namespace hal {
 namespace barefoot {
@@ -32,6 +44,71 @@ namespace barefoot {
 using PortStatusEvent = BfSdeInterface::PortStatusEvent;
 using TransceiverEvent = PhalInterface::TransceiverEvent;
 
+namespace {
+
+// A unit of port configuration work, i.e. adding, updating or replaying a
+// single singleton port.
+struct PortConfigTask {
+  uint64 node_id;
+  uint32 port_id;
+  // The (slot, port) of the front panel port. The channels of a front panel
+  // port share its serdes lanes, hence their tasks depend on each other.
+  PortKey port_group_key;
+  std::function<::util::Status()> run;
+};
+
+// Runs the given port configuration tasks on up to num_threads threads. The
+// tasks of a front panel port run one after the other, in the given order,
+// while the tasks of different front panel ports run concurrently. Every task
+// is run, even if others fail. Returns the errors of all failed tasks, each
+// annotated with its port.
+::util::Status RunPortConfigTasks(const std::vector<PortConfigTask>& tasks,
+                                  int num_threads) {
+  // Group the task indices by front panel port, in the order of the tasks.
+  std::vector<std::vector<size_t>> groups;
+  {
+    std::map<std::pair<uint64, PortKey>, size_t> group_index;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      auto key = std::make_pair(tasks[i].node_id, tasks[i].port_group_key);
+      auto it = group_index.find(key);
+      if (it == group_index.end()) {
+        it = group_index.emplace(key, groups.size()).first;
+        groups.emplace_back();
+      }
+      groups[it->second].push_back(i);
+    }
+  }
+
+  // Every status is written by exactly one thread, and read after the join.
+  std::vector<::util::Status> statuses(tasks.size());
+  std::atomic<size_t> next_group(0);
+  auto run_groups = [&tasks, &groups, &statuses, &next_group]() {
+    for (size_t g = next_group++; g < groups.size(); g = next_group++) {
+      for (size_t i : groups[g]) statuses[i] = tasks[i].run();
+    }
+  };
+  num_threads = std::min<int>(num_threads, groups.size());
+  std::vector<std::thread> workers;
+  for (int i = 1; i < num_threads; ++i) workers.emplace_back(run_groups);
+  run_groups();
+  for (auto& worker : workers) worker.join();
+
+  ::util::Status status = ::util::OkStatus();
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    if (statuses[i].ok()) continue;
+    LOG(ERROR) << "Failed to configure port " << tasks[i].port_id
+               << " in node " << tasks[i].node_id << ": " << statuses[i];
+    ::util::Status error = APPEND_ERROR(statuses[i]).without_logging()
+                           << " (port " << tasks[i].port_id << " in node "
+                           << tasks[i].node_id << ")";
+    APPEND_STATUS_IF_ERROR(status, error);
+  }
+
+  return status;
+}
+
+}  // namespace
+
 /* static */
 constexpr int BfChassisManager::kMaxPortStatusEventDepth;
 /* static */
@@ -380,7 +457,35 @@ BfChassisManager::~BfChassisManager() {
     PortKey port_group_key(singleton_port.slot(), singleton_port.port());
     xcvr_port_key_to_xcvr_state[port_group_key] = HW_STATE_UNKNOWN;
   }
+  // Port shaping configs per node and port, applied together with the port
+  // configuration below.
+  std::map<uint64,
+           std::map<uint32, const TofinoConfig::BfPortShapingConfig::
+                                BfPerPortShapingConfig*>>
+      node_id_to_port_id_to_shaping_config;
+  if (config.has_vendor_config() &&
+      config.vendor_config().has_tofino_config()) {
+    const auto& node_id_to_port_shaping_config =
+        config.vendor_config().tofino_config().node_id_to_port_shaping_config();
+    for (const auto& key : node_id_to_port_shaping_config) {
+      const uint64 node_id = key.first;
+      const TofinoConfig::BfPortShapingConfig& port_id_to_shaping_config =
+          key.second;
+      RET_CHECK(node_id_to_port_id_to_sdk_port_id.count(node_id));
+      RET_CHECK(node_id_to_device.count(node_id));
+      for (const auto& e :
+           port_id_to_shaping_config.per_port_shaping_configs()) {
+        const uint32 port_id = e.first;
+        RET_CHECK(node_id_to_port_id_to_sdk_port_id[node_id].count(port_id));
+        node_id_to_port_id_to_shaping_config[node_id][port_id] = &e.second;
+      }
+    }
+  }
 
+  // Ports are added or updated in parallel by RunPortConfigTasks(). The tasks
+  // only access their own port_config entry of the new maps, which are not
+  // modified until all tasks are done.
+  std::vector<PortConfigTask> port_config_tasks;
   for (const auto& singleton_port : config.singleton_ports()) {
     uint32 port_id = singleton_port.id();
     uint64 node_id = singleton_port.node();
@@ -397,15 +502,30 @@ BfChassisManager::~BfChassisManager() {
       old_port_config = gtl::FindOrNull(*port_id_to_port_config_old, port_id);
     }
 
-    auto& port_config = node_id_to_port_id_to_port_config[node_id][port_id];
+    auto* port_config = &node_id_to_port_id_to_port_config[node_id][port_id];
     uint32 sdk_port_id = node_id_to_port_id_to_sdk_port_id[node_id][port_id];
-    if (old_port_config == nullptr) {  // new port
-      // if anything fails, port_config.admin_state will be set to
-      // ADMIN_STATE_UNKNOWN (invalid)
-      RETURN_IF_ERROR(AddPortHelper(node_id, device, sdk_port_id,
-                                    singleton_port, &port_config));
-    } else {  // port already exists, config may have changed
-      if (old_port_config->admin_state == ADMIN_STATE_UNKNOWN) {
+    const TofinoConfig::BfPortShapingConfig::BfPerPortShapingConfig*
+        shaping_config = nullptr;
+    if (const auto* port_id_to_shaping_config =
+            gtl::FindOrNull(node_id_to_port_id_to_shaping_config, node_id)) {
+      shaping_config =
+          gtl::FindPtrOrNull(*port_id_to_shaping_config, port_id);
+    }
+
+    PortConfigTask task;
+    task.node_id = node_id;
+    task.port_id = port_id;
+    task.port_group_key =
+        PortKey(singleton_port.slot(), singleton_port.port());
+    task.run = [this, node_id, device, sdk_port_id, &singleton_port,
+                old_port_config, port_config,
+                shaping_config]() -> ::util::Status {
+      if (old_port_config == nullptr) {  // new port
+        // if anything fails, port_config->admin_state will be set to
+        // ADMIN_STATE_UNKNOWN (invalid)
+        RETURN_IF_ERROR(AddPortHelper(node_id, device, sdk_port_id,
+                                      singleton_port, port_config));
+      } else if (old_port_config->admin_state == ADMIN_STATE_UNKNOWN) {
         // something is wrong with the port, we make sure the port is deleted
         // first (and ignore the error status if there is one), then add the
         // port again.
@@ -413,55 +533,41 @@ BfChassisManager::~BfChassisManager() {
           bf_sde_interface_->DeletePort(device, sdk_port_id).IgnoreError();
         }
         RETURN_IF_ERROR(AddPortHelper(node_id, device, sdk_port_id,
-                                      singleton_port, &port_config));
-        continue;
-      }
+                                      singleton_port, port_config));
+      } else {  // port already exists, config may have changed
+        // diff configs and apply necessary changes
+
+        // sanity-check: if admin_state is not ADMIN_STATE_UNKNOWN, then the
+        // port was added and the speed_bps was set.
+        if (!old_port_config->speed_bps) {
+          return MAKE_ERROR(ERR_INTERNAL)
+                 << "Invalid internal state in BfChassisManager, speed_bps "
+                    "field should contain a value";
+        }
 
-      // diff configs and apply necessary changes
+        // if anything fails, port_config->admin_state will be set to
+        // ADMIN_STATE_UNKNOWN (invalid)
+        RETURN_IF_ERROR(UpdatePortHelper(node_id, device, sdk_port_id,
+                                         singleton_port, *old_port_config,
+                                         port_config));
+      }
 
-      // sanity-check: if admin_state is not ADMIN_STATE_UNKNOWN, then the port
-      // was added and the speed_bps was set.
-      if (!old_port_config->speed_bps) {
-        return MAKE_ERROR(ERR_INTERNAL)
-               << "Invalid internal state in BfChassisManager, speed_bps field "
-                  "should contain a value";
+      // Handle port shaping.
+      if (shaping_config != nullptr) {
+        RETURN_IF_ERROR(ApplyPortShapingConfig(node_id, device, sdk_port_id,
+                                               *shaping_config));
+        port_config->shaping_config = *shaping_config;
       }
 
-      // if anything fails, port_config.admin_state will be set to
-      // ADMIN_STATE_UNKNOWN (invalid)
-      RETURN_IF_ERROR(UpdatePortHelper(node_id, device, sdk_port_id,
-                                       singleton_port, *old_port_config,
-                                       &port_config));
-    }
+      return ::util::OkStatus();
+    };
+    port_config_tasks.push_back(task);
   }
+  RETURN_IF_ERROR(
+      RunPortConfigTasks(port_config_tasks, FLAGS_bfrt_port_config_threads));
 
   if (config.has_vendor_config() &&
       config.vendor_config().has_tofino_config()) {
-    // Handle port shaping.
-    const auto& node_id_to_port_shaping_config =
-        config.vendor_config().tofino_config().node_id_to_port_shaping_config();
-    for (const auto& key : node_id_to_port_shaping_config) {
-      const uint64 node_id = key.first;
-      const TofinoConfig::BfPortShapingConfig& port_id_to_shaping_config =
-          key.second;
-      RET_CHECK(node_id_to_port_id_to_sdk_port_id.count(node_id));
-      RET_CHECK(node_id_to_device.count(node_id));
-      int device = node_id_to_device[node_id];
-      for (const auto& e :
-           port_id_to_shaping_config.per_port_shaping_configs()) {
-        const uint32 port_id = e.first;
-        const TofinoConfig::BfPortShapingConfig::BfPerPortShapingConfig&
-            shaping_config = e.second;
-        RET_CHECK(node_id_to_port_id_to_sdk_port_id[node_id].count(port_id));
-        const uint32 sdk_port_id =
-            node_id_to_port_id_to_sdk_port_id[node_id][port_id];
-        RETURN_IF_ERROR(ApplyPortShapingConfig(node_id, device, sdk_port_id,
-                                               shaping_config));
-        node_id_to_port_id_to_port_config[node_id][port_id].shaping_config =
-            shaping_config;
-      }
-    }
-
     // Handle deflect-on-drop config.
     const auto& node_id_to_deflect_on_drop_configs =
         config.vendor_config()
@@ -993,6 +1099,25 @@ BfChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
   return resp;
 }
 
+std::vector<::util::StatusOr<DataResponse>>
+BfChassisManager::GetPortDataBatch(
+    const std::vector<DataRequest::Request>& requests) {
+  std::vector<::util::StatusOr<DataResponse>> responses;
+  responses.reserve(requests.size());
+  // Map from a serialized request to the index of its first response.
+  std::map<std::string, size_t> request_to_response_index;
+  for (const auto& request : requests) {
+    auto ret = request_to_response_index.emplace(request.SerializeAsString(),
+                                                 responses.size());
+    if (ret.second) {
+      responses.push_back(GetPortData(request));
+    } else {
+      responses.push_back(responses[ret.first->second]);
+    }
+  }
+  return responses;
+}
+
 ::util::StatusOr<PortState> BfChassisManager::GetPortState(
     uint64 node_id, uint32 port_id) const {
   if (!initialized_) {
@@ -1065,7 +1190,8 @@ BfChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
   }
 
   auto replay_one_port = [node_id, device, this](
-                             uint32 port_id, const PortConfig& config,
+                             uint32 port_id, uint32 sdk_port_id,
+                             const PortConfig& config,
                              PortConfig* config_new) -> ::util::Status {
     if (config.admin_state == ADMIN_STATE_UNKNOWN) {
       LOG(WARNING) << "Port " << port_id << " in node " << node_id
@@ -1084,7 +1210,6 @@ BfChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
                 "should contain a value";
     }
 
-    ASSIGN_OR_RETURN(auto sdk_port_id, GetSdkPortId(node_id, port_id));
     RETURN_IF_ERROR(bf_sde_interface_->AddPort(
         device, sdk_port_id, *config.speed_bps, *config.fec_mode));
     config_new->speed_bps = *config.speed_bps;
@@ -1136,12 +1261,48 @@ BfChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
 
   ::util::Status status = ::util::OkStatus();  // errors to keep track of.
 
-  for (auto& p : node_id_to_port_id_to_port_config_[node_id]) {
+  // Ports are replayed in parallel by RunPortConfigTasks(). The new configs
+  // are stored once all ports are done, including those of failed ports. A
+  // port which cannot be replayed does not stop the replay of the others.
+  auto& port_id_to_port_config = node_id_to_port_id_to_port_config_[node_id];
+  std::vector<PortConfig> configs_new(port_id_to_port_config.size());
+  std::vector<PortConfigTask> port_config_tasks;
+  size_t port_index = 0;
+  for (const auto& p : port_id_to_port_config) {
     uint32 port_id = p.first;
-    PortConfig config_new;
-    APPEND_STATUS_IF_ERROR(status,
-                           replay_one_port(port_id, p.second, &config_new));
-    p.second = config_new;
+    PortConfig* config_new = &configs_new[port_index++];
+    auto sdk_port_id_or = GetSdkPortId(node_id, port_id);
+    if (!sdk_port_id_or.ok()) {
+      APPEND_STATUS_IF_ERROR(status, sdk_port_id_or.status());
+      continue;
+    }
+    uint32 sdk_port_id = sdk_port_id_or.ValueOrDie();
+    const PortKey* port_key = gtl::FindOrNull(
+        node_id_to_port_id_to_singleton_port_key_[node_id], port_id);
+    if (port_key == nullptr) {
+      ::util::Status error = MAKE_ERROR(ERR_INTERNAL)
+                             << "Node " << node_id << ", port " << port_id
+                             << " is not configured or not known.";
+      APPEND_STATUS_IF_ERROR(status, error);
+      continue;
+    }
+    const PortConfig* config = &p.second;
+    PortConfigTask task;
+    task.node_id = node_id;
+    task.port_id = port_id;
+    task.port_group_key = PortKey(port_key->slot, port_key->port);
+    task.run = [replay_one_port, port_id, sdk_port_id, config,
+                config_new]() -> ::util::Status {
+      return replay_one_port(port_id, sdk_port_id, *config, config_new);
+    };
+    port_config_tasks.push_back(task);
+  }
+  APPEND_STATUS_IF_ERROR(status, RunPortConfigTasks(
+                                     port_config_tasks,
+                                     FLAGS_bfrt_port_config_threads));
+  {
+    size_t i = 0;
+    for (auto& p : port_id_to_port_config) p.second = configs_new[i++];
   }
 
   // Replay QoS configuration.
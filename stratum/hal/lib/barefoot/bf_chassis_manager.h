@@ -6,6 +6,8 @@
 
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
@@ -58,6 +60,14 @@ class BfChassisManager {
   virtual ::util::StatusOr<DataResponse> GetPortData(
       const DataRequest::Request& request) SHARED_LOCKS_REQUIRED(chassis_lock);
 
+  // Same as GetPortData() for several requests, e.g. all the port requests of
+  // a gNMI Get. Identical requests are served once, so the hardware is read
+  // once per port and kind of data, like the counters of a port. Returns the
+  // responses in the order of the requests.
+  virtual std::vector<::util::StatusOr<DataResponse>> GetPortDataBatch(
+      const std::vector<DataRequest::Request>& requests)
+      SHARED_LOCKS_REQUIRED(chassis_lock);
+
   virtual ::util::StatusOr<absl::Time> GetPortTimeLastChanged(uint64 node_id,
                                                               uint32 port_id)
       SHARED_LOCKS_REQUIRED(chassis_lock);
@@ -29,6 +29,9 @@ class BfChassisManagerMock : public BfChassisManager {
   MOCK_METHOD0(UnregisterEventNotifyWriter, ::util::Status());
   MOCK_METHOD1(GetPortData, ::util::StatusOr<DataResponse>(
                                 const DataRequest::Request& request));
+  MOCK_METHOD1(GetPortDataBatch,
+               std::vector<::util::StatusOr<DataResponse>>(
+                   const std::vector<DataRequest::Request>& requests));
   MOCK_METHOD2(GetPortTimeLastChanged,
                ::util::StatusOr<absl::Time>(uint64 node_id, uint32 port_id));
   MOCK_METHOD3(GetPortCounters, ::util::Status(uint64 node_id, uint32 port_id,
@@ -3,6 +3,8 @@
 
 #include "stratum/hal/lib/barefoot/bf_chassis_manager.h"
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <utility>
 
@@ -10,6 +12,7 @@
 #include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/integral_types.h"
@@ -24,6 +27,8 @@
 #include "stratum/lib/test_utils/matchers.h"
 #include "stratum/lib/utils.h"
 
+DECLARE_int32(bfrt_port_config_threads);
+
 namespace stratum {
 namespace hal {
 namespace barefoot {
@@ -38,6 +43,7 @@ using ::testing::HasSubstr;
 using ::testing::Invoke;
 using ::testing::Matcher;
 using ::testing::Mock;
+using ::testing::Not;
 using ::testing::Return;
 using ::testing::SaveArg;
 using ::testing::Sequence;
@@ -219,6 +225,14 @@ class BfChassisManagerTest : public ::testing::Test {
     return ::util::OkStatus();
   }
 
+  // Drops the port key of a port, which makes the port unknown to the parts of
+  // the chassis manager that need it.
+  void ForgetSingletonPortKey(uint64 node_id, uint32 port_id) {
+    absl::WriterMutexLock l(&chassis_lock);
+    bf_chassis_manager_->node_id_to_port_id_to_singleton_port_key_[node_id]
+        .erase(port_id);
+  }
+
   ::util::Status ReplayChassisConfig(uint64 node_id) {
     absl::WriterMutexLock l(&chassis_lock);
     return bf_chassis_manager_->ReplayChassisConfig(node_id);
@@ -900,6 +914,46 @@ TEST_F(BfChassisManagerTest, GetPortData) {
   ASSERT_OK(ShutdownAndTestCleanState());
 }
 
+TEST_F(BfChassisManagerTest, GetPortDataBatchReadsCountersOncePerPort) {
+  ASSERT_OK(PushBaseChassisConfig());
+  const uint32 sdkPortId = kPortId + kSdkPortOffset;
+
+  PortCounters counters;
+  counters.set_in_octets(1);
+  counters.set_out_octets(2);
+  EXPECT_CALL(*bf_sde_mock_, GetPortCounters(kDevice, sdkPortId, _))
+      .WillOnce(DoAll(SetArgPointee<2>(counters), Return(::util::OkStatus())));
+
+  std::vector<DataRequest::Request> requests(4);
+  requests[0].mutable_port_counters()->set_node_id(kNodeId);
+  requests[0].mutable_port_counters()->set_port_id(kPortId);
+  requests[1].mutable_admin_status()->set_node_id(kNodeId);
+  requests[1].mutable_admin_status()->set_port_id(kPortId);
+  requests[2] = requests[0];
+  // Unknown port.
+  requests[3].mutable_port_counters()->set_node_id(kNodeId);
+  requests[3].mutable_port_counters()->set_port_id(kPortId + 1);
+
+  std::vector<::util::StatusOr<DataResponse>> responses;
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    responses = bf_chassis_manager_->GetPortDataBatch(requests);
+  }
+  ASSERT_EQ(4, responses.size());
+  ASSERT_OK(responses[0]);
+  EXPECT_THAT(responses[0].ValueOrDie().port_counters(),
+              EqualsProto(counters));
+  ASSERT_OK(responses[1]);
+  EXPECT_EQ(ADMIN_STATE_ENABLED,
+            responses[1].ValueOrDie().admin_status().state());
+  ASSERT_OK(responses[2]);
+  EXPECT_THAT(responses[2].ValueOrDie().port_counters(),
+              EqualsProto(counters));
+  EXPECT_FALSE(responses[3].ok());
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
 TEST_F(BfChassisManagerTest, UpdateInvalidPort) {
   ASSERT_OK(PushBaseChassisConfig());
   ChassisConfigBuilder builder;
@@ -931,6 +985,180 @@ TEST_F(BfChassisManagerTest, UpdateInvalidPort) {
   ASSERT_OK(ShutdownAndTestCleanState());
 }
 
+TEST_F(BfChassisManagerTest, PortsAreConfiguredInParallel) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_port_config_threads = 4;
+  ChassisConfigBuilder builder;
+  ASSERT_OK(PushBaseChassisConfig(&builder));
+
+  // Four front panel ports with two channels each.
+  constexpr int kNumPorts = 8;
+  constexpr uint32 kFirstPortId = kPortId + 1;
+  for (int i = 0; i < kNumPorts; ++i) {
+    SingletonPort* sport = builder.AddPort(kFirstPortId + i, kPort + 1 + i / 2,
+                                           ADMIN_STATE_ENABLED);
+    sport->set_channel(i % 2 + 1);
+    RegisterSdkPortId(sport);
+    EXPECT_CALL(*bf_sde_mock_,
+                EnablePort(kDevice, kFirstPortId + i + kSdkPortOffset));
+  }
+
+  // Adding a port takes a while, as it does on hardware. Keep track of the
+  // number of ports, and of channels of a front panel port, being added at the
+  // same time.
+  absl::Mutex lock;
+  int num_in_flight = 0;
+  int max_in_flight = 0;
+  std::map<int, int> front_panel_port_to_num_in_flight;
+  int max_channels_in_flight = 0;
+  EXPECT_CALL(*bf_sde_mock_,
+              AddPort(kDevice, _, kDefaultSpeedBps, kDefaultFecMode))
+      .Times(kNumPorts)
+      .WillRepeatedly(Invoke([&](int device, int sdk_port_id, uint64 speed_bps,
+                                 FecMode fec_mode) -> ::util::Status {
+        const int front_panel_port =
+            (sdk_port_id - kSdkPortOffset - kFirstPortId) / 2;
+        {
+          absl::MutexLock l(&lock);
+          max_in_flight = std::max(max_in_flight, ++num_in_flight);
+          max_channels_in_flight =
+              std::max(max_channels_in_flight,
+                       ++front_panel_port_to_num_in_flight[front_panel_port]);
+        }
+        absl::SleepFor(absl::Milliseconds(20));
+        {
+          absl::MutexLock l(&lock);
+          --num_in_flight;
+          --front_panel_port_to_num_in_flight[front_panel_port];
+        }
+        return ::util::OkStatus();
+      }));
+
+  ASSERT_OK(PushChassisConfig(builder));
+  EXPECT_GT(max_in_flight, 1);
+  EXPECT_LE(max_in_flight, 4);
+  // The channels of a front panel port are never added concurrently.
+  EXPECT_EQ(1, max_channels_in_flight);
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BfChassisManagerTest, PortConfigErrorsAreReportedPerPort) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_port_config_threads = 4;
+  ChassisConfigBuilder builder;
+  ASSERT_OK(PushBaseChassisConfig(&builder));
+
+  const uint32 kBadPortId1 = kPortId + 1;
+  const uint32 kGoodPortId = kPortId + 2;
+  const uint32 kBadPortId2 = kPortId + 3;
+  RegisterSdkPortId(builder.AddPort(kBadPortId1, kPort + 1,
+                                    ADMIN_STATE_ENABLED));
+  RegisterSdkPortId(builder.AddPort(kGoodPortId, kPort + 2,
+                                    ADMIN_STATE_ENABLED));
+  RegisterSdkPortId(builder.AddPort(kBadPortId2, kPort + 3,
+                                    ADMIN_STATE_ENABLED));
+  const ::util::Status kAddPortError(StratumErrorSpace(), ERR_INTERNAL,
+                                     "Port add failed.");
+  EXPECT_CALL(*bf_sde_mock_, AddPort(kDevice, kBadPortId1 + kSdkPortOffset,
+                                     kDefaultSpeedBps, kDefaultFecMode))
+      .WillOnce(Return(kAddPortError));
+  EXPECT_CALL(*bf_sde_mock_, AddPort(kDevice, kBadPortId2 + kSdkPortOffset,
+                                     kDefaultSpeedBps, kDefaultFecMode))
+      .WillOnce(Return(kAddPortError));
+  // A failing port does not prevent the other ports from being configured.
+  EXPECT_CALL(*bf_sde_mock_, AddPort(kDevice, kGoodPortId + kSdkPortOffset,
+                                     kDefaultSpeedBps, kDefaultFecMode))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_mock_, EnablePort(kDevice, kGoodPortId + kSdkPortOffset))
+      .WillOnce(Return(::util::OkStatus()));
+
+  auto status = PushChassisConfig(builder);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(ERR_INTERNAL, status.error_code());
+  std::stringstream bad_port1_msg, bad_port2_msg, good_port_msg;
+  bad_port1_msg << "(port " << kBadPortId1 << " in node " << kNodeId << ")";
+  bad_port2_msg << "(port " << kBadPortId2 << " in node " << kNodeId << ")";
+  good_port_msg << "(port " << kGoodPortId << " in node " << kNodeId << ")";
+  EXPECT_THAT(status.error_message(), HasSubstr(bad_port1_msg.str()));
+  EXPECT_THAT(status.error_message(), HasSubstr(bad_port2_msg.str()));
+  EXPECT_THAT(status.error_message(),
+              Not(HasSubstr(good_port_msg.str())));
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BfChassisManagerTest, ReplayPortsInParallel) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_port_config_threads = 8;
+  ChassisConfigBuilder builder;
+  constexpr int kNumPorts = 4;
+  for (int i = 1; i <= kNumPorts; ++i) {
+    const uint32 sdk_port_id = kPortId + i + kSdkPortOffset;
+    RegisterSdkPortId(
+        builder.AddPort(kPortId + i, kPort + i, ADMIN_STATE_ENABLED));
+    EXPECT_CALL(*bf_sde_mock_, AddPort(kDevice, sdk_port_id, kDefaultSpeedBps,
+                                       kDefaultFecMode));
+    EXPECT_CALL(*bf_sde_mock_, EnablePort(kDevice, sdk_port_id));
+  }
+  // Also adds the base port.
+  ASSERT_OK(PushBaseChassisConfig(&builder));
+
+  // Every port replay blocks until all ports are being added, which can only
+  // happen if the ports are replayed concurrently.
+  absl::Mutex lock;
+  int num_added = 0;
+  absl::Notification all_added;
+  EXPECT_CALL(*bf_sde_mock_,
+              AddPort(kDevice, _, kDefaultSpeedBps, kDefaultFecMode))
+      .Times(kNumPorts + 1)
+      .WillRepeatedly(Invoke([&](int device, int sdk_port_id, uint64 speed_bps,
+                                 FecMode fec_mode) -> ::util::Status {
+        {
+          absl::MutexLock l(&lock);
+          if (++num_added == kNumPorts + 1) all_added.Notify();
+        }
+        EXPECT_TRUE(all_added.WaitForNotificationWithTimeout(absl::Seconds(5)));
+        return ::util::OkStatus();
+      }));
+  EXPECT_CALL(*bf_sde_mock_, EnablePort(kDevice, _)).Times(kNumPorts + 1);
+  EXPECT_CALL(*bf_sde_mock_, GetPcieCpuPort(kDevice)).WillOnce(Return(64));
+  EXPECT_CALL(*bf_sde_mock_, SetTmCpuPort(kDevice, 64))
+      .WillOnce(Return(::util::OkStatus()));
+
+  EXPECT_OK(ReplayChassisConfig(kNodeId));
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BfChassisManagerTest, ReplayContinuesAfterPortError) {
+  ChassisConfigBuilder builder;
+  const uint32 sdk_port_id = kPortId + 1 + kSdkPortOffset;
+  RegisterSdkPortId(
+      builder.AddPort(kPortId + 1, kPort + 1, ADMIN_STATE_ENABLED));
+  // The port is added on the push and again on the replay.
+  EXPECT_CALL(*bf_sde_mock_, AddPort(kDevice, sdk_port_id, kDefaultSpeedBps,
+                                     kDefaultFecMode))
+      .Times(2);
+  EXPECT_CALL(*bf_sde_mock_, EnablePort(kDevice, sdk_port_id)).Times(2);
+  // Also adds the base port.
+  ASSERT_OK(PushBaseChassisConfig(&builder));
+
+  // The base port cannot be replayed, but the other port and the rest of the
+  // chassis config still are.
+  ForgetSingletonPortKey(kNodeId, kPortId);
+  EXPECT_CALL(*bf_sde_mock_, GetPcieCpuPort(kDevice)).WillOnce(Return(64));
+  EXPECT_CALL(*bf_sde_mock_, SetTmCpuPort(kDevice, 64))
+      .WillOnce(Return(::util::OkStatus()));
+
+  ::util::Status status = ReplayChassisConfig(kNodeId);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(),
+              HasSubstr("is not configured or not known"));
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
 TEST_F(BfChassisManagerTest, VerifyChassisConfigSuccess) {
   const std::string kConfigText1 = R"(
       description: "Sample Generic Tofino config 2x25G ports."
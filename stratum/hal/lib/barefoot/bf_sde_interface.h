@@ -4,8 +4,10 @@
 #ifndef STRATUM_HAL_LIB_BAREFOOT_BF_SDE_INTERFACE_H_
 #define STRATUM_HAL_LIB_BAREFOOT_BF_SDE_INTERFACE_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/types/optional.h"
@@ -13,9 +15,12 @@
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
 #include "stratum/hal/lib/barefoot/bf.pb.h"
+#include "stratum/hal/lib/barefoot/bfrt_counter_sync_coordinator.h"
+#include "stratum/hal/lib/barefoot/utils.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/utils.h"
 #include "stratum/lib/channel/channel.h"
+#include "stratum/lib/channel/ring_buffer.h"
 
 namespace stratum {
 namespace hal {
@@ -50,6 +55,47 @@ class BfSdeInterface {
     absl::Time timestamp;
   };
 
+  // PacketRxBufferPool is shared between the SDE packet receive callback and
+  // the reader of the packet receive channel of a device. The callback copies
+  // received packets into buffers taken from the pool and the reader puts them
+  // back once it is done with them, so that packet RX does not allocate in the
+  // steady state. The pool also counts the packets the callback dropped
+  // because the channel was full. This class is thread-safe.
+  class PacketRxBufferPool {
+   public:
+    explicit PacketRxBufferPool(size_t size)
+        : free_buffers_(size), num_dropped_(0) {}
+
+    // Returns a free buffer, or a new one if the pool is empty.
+    std::string Get() {
+      std::string buffer;
+      free_buffers_.TryPop(&buffer);
+      return buffer;
+    }
+
+    // Puts a buffer back into the pool. The buffer is released if the pool is
+    // full.
+    void Put(std::string&& buffer) {
+      buffer.clear();
+      free_buffers_.TryPush(std::move(buffer));
+    }
+
+    void IncrementNumDropped() {
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64 GetNumDropped() const {
+      return num_dropped_.load(std::memory_order_relaxed);
+    }
+
+    // PacketRxBufferPool is neither copyable nor movable.
+    PacketRxBufferPool(const PacketRxBufferPool&) = delete;
+    PacketRxBufferPool& operator=(const PacketRxBufferPool&) = delete;
+
+   private:
+    RingBuffer<std::string> free_buffers_;
+    std::atomic<uint64> num_dropped_;
+  };
+
   // SessionInterface is a proxy class for BfRt sessions. Most API calls require
   // an active session. It also allows batching requests for performance.
   class SessionInterface {
@@ -264,9 +310,12 @@ class BfSdeInterface {
   virtual ::util::Status StopPacketIo(int device) = 0;
 
   // Registers a writer to be invoked when we receive a packet on the PCIe CPU
-  // port. There can only be one writer per device.
+  // port. There can only be one writer per device. Received packets are copied
+  // into buffers from the given pool, if not null, and dropped packets are
+  // counted in it.
   virtual ::util::Status RegisterPacketReceiveWriter(
-      int device, std::unique_ptr<ChannelWriter<std::string>> writer) = 0;
+      int device, std::unique_ptr<ChannelWriter<std::string>> writer,
+      std::shared_ptr<PacketRxBufferPool> buffer_pool) = 0;
 
   // Unregisters the writer registered to this device by
   // RegisterPacketReceiveWriter().
@@ -372,6 +421,18 @@ class BfSdeInterface {
       std::vector<absl::optional<uint64>>* packet_counts,
       absl::Duration timeout) = 0;
 
+  // Reads the data of the given index ranges of an indirect counter, with a
+  // single counter sync. The ranges must be sorted and must not overlap, as
+  // returned by IndicesToRanges(). The counter ID must be a BfRt table ID, not
+  // P4Runtime. Indices are returned in ascending order.
+  virtual ::util::Status ReadIndirectCounterRanges(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      uint32 counter_id, const std::vector<IndexRange>& index_ranges,
+      std::vector<uint32>* counter_indices,
+      std::vector<absl::optional<uint64>>* byte_counts,
+      std::vector<absl::optional<uint64>>* packet_counts,
+      absl::Duration timeout) = 0;
+
   // Updates a register at the given index in a table. The table ID must be a
   // BfRt table ID, not P4Runtime. Timeout specifies the maximum time to wait
   // for the registers to sync.
@@ -390,6 +451,14 @@ class BfSdeInterface {
       std::vector<uint32>* register_indices,
       std::vector<uint64>* register_datas, absl::Duration timeout) = 0;
 
+  // Reads the data of the given index ranges of a register table, with a
+  // single register sync. Same constraints as ReadIndirectCounterRanges().
+  virtual ::util::Status ReadRegisterRanges(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      uint32 table_id, const std::vector<IndexRange>& index_ranges,
+      std::vector<uint32>* register_indices,
+      std::vector<uint64>* register_datas, absl::Duration timeout) = 0;
+
   // Updates an indirect meter at the given index. The table ID must be a
   // BfRt table ID, not P4Runtime.
   // TODO(max): figure out optional register index API, see TotW#163
@@ -408,6 +477,15 @@ class BfSdeInterface {
       std::vector<uint64>* cbursts, std::vector<uint64>* pirs,
       std::vector<uint64>* pbursts, std::vector<bool>* in_pps) = 0;
 
+  // Reads the data of the given index ranges of an indirect meter. Same
+  // constraints as ReadIndirectCounterRanges().
+  virtual ::util::Status ReadIndirectMeterRanges(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      uint32 table_id, const std::vector<IndexRange>& index_ranges,
+      std::vector<uint32>* meter_indices, std::vector<uint64>* cirs,
+      std::vector<uint64>* cbursts, std::vector<uint64>* pirs,
+      std::vector<uint64>* pbursts, std::vector<bool>* in_pps) = 0;
+
   // Inserts an action profile member. The table ID must be a BfRt table, not
   // P4Runtime.
   virtual ::util::Status InsertActionProfileMember(
@@ -491,10 +569,16 @@ class BfSdeInterface {
       uint32 table_id, const TableKeyInterface* table_key,
       TableDataInterface* table_data) = 0;
 
-  // Fetches all table entries in the given table.
-  virtual ::util::Status GetAllTableEntries(
+  // Fetches up to max_entries table entries in the given table, starting with
+  // the entry following the cursor key. A null cursor starts at the first entry
+  // of the table. Fewer than max_entries results mark the end of the table.
+  // Use the last returned key as the cursor of the next call to page through a
+  // table without materializing all of its entries at once. Fails with
+  // ERR_ABORTED if the cursor entry has been deleted in the meantime, so
+  // callers must keep writes to the table from deleting it.
+  virtual ::util::Status GetNextTableEntries(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
-      uint32 table_id,
+      uint32 table_id, const TableKeyInterface* cursor, int max_entries,
       std::vector<std::unique_ptr<TableKeyInterface>>* table_keys,
       std::vector<std::unique_ptr<TableDataInterface>>* table_datas) = 0;
 
@@ -539,11 +623,15 @@ class BfSdeInterface {
       absl::Duration* max_timeout) = 0;
 
   // Synchronizes the driver cached counter values with the current hardware
-  // state for a given BfRt table.
+  // state for a given BfRt table. Concurrent calls for the same table may be
+  // answered by a single sync.
   virtual ::util::Status SynchronizeCounters(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout) = 0;
 
+  // Returns the statistics of the counter syncs done on the given device.
+  virtual BfrtCounterSyncStats GetCounterSyncStats(int device) const = 0;
+
   // Returns the equivalent BfRt ID for the given P4RT ID.
   virtual ::util::StatusOr<uint32> GetBfRtId(uint32 p4info_id) const = 0;
 
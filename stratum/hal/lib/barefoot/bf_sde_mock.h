@@ -109,10 +109,11 @@ class BfSdeMock : public BfSdeInterface {
   MOCK_METHOD2(TxPacket, ::util::Status(int device, const std::string& packet));
   MOCK_METHOD1(StartPacketIo, ::util::Status(int device));
   MOCK_METHOD1(StopPacketIo, ::util::Status(int device));
-  MOCK_METHOD2(
+  MOCK_METHOD3(
       RegisterPacketReceiveWriter,
       ::util::Status(int device,
-                     std::unique_ptr<ChannelWriter<std::string>> writer));
+                     std::unique_ptr<ChannelWriter<std::string>> writer,
+                     std::shared_ptr<PacketRxBufferPool> buffer_pool));
   MOCK_METHOD1(UnregisterPacketReceiveWriter, ::util::Status(int device));
   MOCK_METHOD2(
       RegisterDigestListWriter,
@@ -201,6 +202,16 @@ class BfSdeMock : public BfSdeInterface {
                      std::vector<absl::optional<uint64>>* byte_counts,
                      std::vector<absl::optional<uint64>>* packet_counts,
                      absl::Duration timeout));
+  MOCK_METHOD8(
+      ReadIndirectCounterRanges,
+      ::util::Status(int device,
+                     std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                     uint32 counter_id,
+                     const std::vector<IndexRange>& index_ranges,
+                     std::vector<uint32>* counter_indices,
+                     std::vector<absl::optional<uint64>>* byte_counts,
+                     std::vector<absl::optional<uint64>>* packet_counts,
+                     absl::Duration timeout));
   MOCK_METHOD5(
       WriteRegister,
       ::util::Status(int device,
@@ -215,6 +226,15 @@ class BfSdeMock : public BfSdeInterface {
                      std::vector<uint32>* register_indices,
                      std::vector<uint64>* register_datas,
                      absl::Duration timeout));
+  MOCK_METHOD7(
+      ReadRegisterRanges,
+      ::util::Status(int device,
+                     std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                     uint32 table_id,
+                     const std::vector<IndexRange>& index_ranges,
+                     std::vector<uint32>* register_indices,
+                     std::vector<uint64>* register_datas,
+                     absl::Duration timeout));
   MOCK_METHOD9(
       WriteIndirectMeter,
       ::util::Status(int device,
@@ -231,6 +251,16 @@ class BfSdeMock : public BfSdeInterface {
                      std::vector<uint64>* cirs, std::vector<uint64>* cbursts,
                      std::vector<uint64>* pirs, std::vector<uint64>* pbursts,
                      std::vector<bool>* in_pps));
+  MOCK_METHOD10(
+      ReadIndirectMeterRanges,
+      ::util::Status(int device,
+                     std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                     uint32 table_id,
+                     const std::vector<IndexRange>& index_ranges,
+                     std::vector<uint32>* meter_indices,
+                     std::vector<uint64>* cirs, std::vector<uint64>* cbursts,
+                     std::vector<uint64>* pirs, std::vector<uint64>* pbursts,
+                     std::vector<bool>* in_pps));
   MOCK_METHOD5(
       InsertActionProfileMember,
       ::util::Status(int device,
@@ -310,11 +340,11 @@ class BfSdeMock : public BfSdeInterface {
                      std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      uint32 table_id, const TableKeyInterface* table_key,
                      TableDataInterface* table_data));
-  MOCK_METHOD5(
-      GetAllTableEntries,
+  MOCK_METHOD7(
+      GetNextTableEntries,
       ::util::Status(
           int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
-          uint32 table_id,
+          uint32 table_id, const TableKeyInterface* cursor, int max_entries,
           std::vector<std::unique_ptr<TableKeyInterface>>* table_keys,
           std::vector<std::unique_ptr<TableDataInterface>>* table_datas));
   MOCK_METHOD4(
@@ -358,6 +388,7 @@ class BfSdeMock : public BfSdeInterface {
       ::util::Status(int device,
                      std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      uint32 table_id, absl::Duration timeout));
+  MOCK_CONST_METHOD1(GetCounterSyncStats, BfrtCounterSyncStats(int device));
   MOCK_CONST_METHOD1(GetBfRtId, ::util::StatusOr<uint32>(uint32 p4info_id));
   MOCK_CONST_METHOD1(GetP4InfoId, ::util::StatusOr<uint32>(uint32 bfrt_id));
   MOCK_CONST_METHOD1(GetActionSelectorBfRtId,
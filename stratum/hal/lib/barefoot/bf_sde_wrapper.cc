@@ -3,12 +3,12 @@
 
 #include "stratum/hal/lib/barefoot/bf_sde_wrapper.h"
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <utility>
 
 #include "absl/cleanup/cleanup.h"
-#include "absl/strings/match.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
@@ -46,6 +46,22 @@ int switch_pci_sysfs_str_get(char* name, size_t name_size);
 
 DEFINE_string(bfrt_sde_config_dir, "/var/run/stratum/bfrt_config",
               "The dir used by the SDE to load the device configuration.");
+DEFINE_int32(bfrt_counter_sync_max_staleness_ms, 0,
+             "Maximum age of synced counters in milliseconds for them to be "
+             "read without another hardware sync. Requests arriving during a "
+             "sync of the same table share the next sync. 0 makes every read "
+             "wait for a sync issued after the read was requested.");
+DEFINE_int32(bfrt_num_packet_tx_rings, 1,
+             "Number of SDE TX rings packets sent to the CPU port are spread "
+             "over in a round-robin fashion. Packets sent on different rings "
+             "may be reordered.");
+DEFINE_int32(bfrt_packet_tx_pool_size, 64,
+             "Number of DMA packet buffers pre-allocated per TX ring for "
+             "packets sent to the CPU port. Packets are sent in newly "
+             "allocated buffers while all the pooled ones are in flight.");
+DEFINE_int32(bfrt_packet_tx_buffer_size, 2048,
+             "Size of the pre-allocated TX packet buffers in bytes. Larger "
+             "packets are sent in newly allocated buffers.");
 
 namespace stratum {
 namespace hal {
@@ -266,236 +282,150 @@ inline constexpr uint64 BytesPerSecondToKbits(uint64 bytes) {
   return s;
 }
 
-::util::Status GetField(const bfrt::BfRtTableKey& table_key,
-                        std::string field_name, uint64* field_value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_key.tableGet(&table));
-  RETURN_IF_BFRT_ERROR(table->keyFieldIdGet(field_name, &field_id));
-  RETURN_IF_BFRT_ERROR(table->keyFieldDataTypeGet(field_id, &data_type));
-  RET_CHECK(data_type == bfrt::DataType::UINT64)
+// Returns the data field with the given name of the action of the given data.
+::util::StatusOr<const BfRtTableMetadata::FieldInfo*> GetDataField(
+    const BfRtTableMetadata& metadata, const bfrt::BfRtTableData& table_data,
+    absl::string_view field_name) {
+  bf_rt_id_t action_id = 0;
+  if (metadata.action_id_applicable()) {
+    RETURN_IF_BFRT_ERROR(table_data.actionIdGet(&action_id));
+  }
+  return metadata.GetDataField(action_id, field_name);
+}
+
+::util::Status GetField(const BfRtTableMetadata& metadata,
+                        const bfrt::BfRtTableKey& table_key,
+                        absl::string_view field_name, uint64* field_value) {
+  ASSIGN_OR_RETURN(const auto* field, metadata.GetKeyField(field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::UINT64)
       << "Requested uint64 but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_key.getValue(field_id, field_value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_key.getValue(field->id, field_value));
 
   return ::util::OkStatus();
 }
 
-::util::Status SetField(bfrt::BfRtTableKey* table_key, std::string field_name,
-                        uint64 value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_key->tableGet(&table));
-  RETURN_IF_BFRT_ERROR(table->keyFieldIdGet(field_name, &field_id));
-  RETURN_IF_BFRT_ERROR(table->keyFieldDataTypeGet(field_id, &data_type));
-  RET_CHECK(data_type == bfrt::DataType::UINT64)
+::util::Status SetField(const BfRtTableMetadata& metadata,
+                        bfrt::BfRtTableKey* table_key,
+                        absl::string_view field_name, uint64 value) {
+  ASSIGN_OR_RETURN(const auto* field, metadata.GetKeyField(field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::UINT64)
       << "Setting uint64 but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_key->setValue(field_id, value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_key->setValue(field->id, value));
 
   return ::util::OkStatus();
 }
 
-::util::Status GetField(const bfrt::BfRtTableData& table_data,
-                        std::string field_name, uint64* field_value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data.getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data.actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::UINT64)
+::util::Status GetField(const BfRtTableMetadata& metadata,
+                        const bfrt::BfRtTableData& table_data,
+                        absl::string_view field_name, uint64* field_value) {
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::UINT64)
       << "Requested uint64 but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data.getValue(field_id, field_value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data.getValue(field->id, field_value));
 
   return ::util::OkStatus();
 }
 
-::util::Status GetField(const bfrt::BfRtTableData& table_data,
-                        std::string field_name, std::string* field_value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data.getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data.actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::STRING)
+::util::Status GetField(const BfRtTableMetadata& metadata,
+                        const bfrt::BfRtTableData& table_data,
+                        absl::string_view field_name,
+                        std::string* field_value) {
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::STRING)
       << "Requested string but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data.getValue(field_id, field_value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data.getValue(field->id, field_value));
 
   return ::util::OkStatus();
 }
 
-::util::Status GetField(const bfrt::BfRtTableData& table_data,
-                        std::string field_name, bool* field_value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data.getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data.actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::BOOL)
+::util::Status GetField(const BfRtTableMetadata& metadata,
+                        const bfrt::BfRtTableData& table_data,
+                        absl::string_view field_name, bool* field_value) {
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::BOOL)
       << "Requested bool but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data.getValue(field_id, field_value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data.getValue(field->id, field_value));
 
   return ::util::OkStatus();
 }
 
 template <typename T>
-::util::Status GetField(const bfrt::BfRtTableData& table_data,
-                        std::string field_name, std::vector<T>* field_values) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data.getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data.actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::INT_ARR ||
-            data_type == bfrt::DataType::BOOL_ARR)
-      << "Requested array but field has type " << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data.getValue(field_id, field_values));
+::util::Status GetField(const BfRtTableMetadata& metadata,
+                        const bfrt::BfRtTableData& table_data,
+                        absl::string_view field_name,
+                        std::vector<T>* field_values) {
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::INT_ARR ||
+            field->data_type == bfrt::DataType::BOOL_ARR)
+      << "Requested array but field has type "
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data.getValue(field->id, field_values));
 
   return ::util::OkStatus();
 }
 
-::util::Status SetField(bfrt::BfRtTableData* table_data, std::string field_name,
-                        const uint64& value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data->getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data->actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::UINT64)
+::util::Status SetField(const BfRtTableMetadata& metadata,
+                        bfrt::BfRtTableData* table_data,
+                        absl::string_view field_name, const uint64& value) {
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, *table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::UINT64)
       << "Setting uint64 but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data->setValue(field_id, value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data->setValue(field->id, value));
 
   return ::util::OkStatus();
 }
 
-::util::Status SetField(bfrt::BfRtTableData* table_data, std::string field_name,
+::util::Status SetField(const BfRtTableMetadata& metadata,
+                        bfrt::BfRtTableData* table_data,
+                        absl::string_view field_name,
                         const std::string& field_value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data->getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data->actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::STRING)
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, *table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::STRING)
       << "Setting string but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data->setValue(field_id, field_value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data->setValue(field->id, field_value));
 
   return ::util::OkStatus();
 }
 
-::util::Status SetFieldBool(bfrt::BfRtTableData* table_data,
-                            std::string field_name, const bool& field_value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data->getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data->actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::BOOL)
+::util::Status SetFieldBool(const BfRtTableMetadata& metadata,
+                            bfrt::BfRtTableData* table_data,
+                            absl::string_view field_name,
+                            const bool& field_value) {
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, *table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::BOOL)
       << "Setting bool but field " << field_name << " has type "
-      << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data->setValue(field_id, field_value));
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data->setValue(field->id, field_value));
 
   return ::util::OkStatus();
 }
 
 template <typename T>
-::util::Status SetField(bfrt::BfRtTableData* table_data, std::string field_name,
+::util::Status SetField(const BfRtTableMetadata& metadata,
+                        bfrt::BfRtTableData* table_data,
+                        absl::string_view field_name,
                         const std::vector<T>& value) {
-  bf_rt_id_t field_id;
-  const bfrt::BfRtTable* table;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table_data->getParent(&table));
-  if (table->actionIdApplicable()) {
-    bf_rt_id_t action_id;
-    RETURN_IF_BFRT_ERROR(table_data->actionIdGet(&action_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldIdGet(field_name, action_id, &field_id));
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldDataTypeGet(field_id, action_id, &data_type));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(field_name, &field_id));
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  }
-  RET_CHECK(data_type == bfrt::DataType::INT_ARR ||
-            data_type == bfrt::DataType::BOOL_ARR)
-      << "Requested array but field has type " << static_cast<int>(data_type);
-  RETURN_IF_BFRT_ERROR(table_data->setValue(field_id, value));
+  ASSIGN_OR_RETURN(const auto* field,
+                   GetDataField(metadata, *table_data, field_name));
+  RET_CHECK(field->data_type == bfrt::DataType::INT_ARR ||
+            field->data_type == bfrt::DataType::BOOL_ARR)
+      << "Requested array but field has type "
+      << static_cast<int>(field->data_type);
+  RETURN_IF_BFRT_ERROR(table_data->setValue(field->id, value));
 
   return ::util::OkStatus();
 }
@@ -573,15 +503,174 @@ template <typename T>
   return ::util::OkStatus();
 }
 
+// Reads the entries of the given index ranges of a table with a single index
+// key field, like indirect counters, meters and registers. Every range is read
+// with one tableEntryGet() and one tableEntryGetNext_n() call.
+::util::Status GetIndexRangeEntries(
+    std::shared_ptr<bfrt::BfRtSession> bfrt_session,
+    bf_rt_target_t bf_dev_target, const BfRtTableMetadata& metadata,
+    absl::string_view index_field_name,
+    const std::vector<IndexRange>& index_ranges,
+    std::vector<std::unique_ptr<bfrt::BfRtTableKey>>* table_keys,
+    std::vector<std::unique_ptr<bfrt::BfRtTableData>>* table_datums) {
+  RET_CHECK(table_keys) << "table_keys is null";
+  RET_CHECK(table_datums) << "table_datums is null";
+
+  const bfrt::BfRtTable* table = metadata.table();
+  ASSIGN_OR_RETURN(const auto* index_field,
+                   metadata.GetKeyField(index_field_name));
+  size_t table_size;
+  RETURN_IF_BFRT_ERROR(
+      table->tableSizeGet(*bfrt_session, bf_dev_target, &table_size));
+
+  table_keys->resize(0);
+  table_datums->resize(0);
+  for (size_t i = 0; i < index_ranges.size(); ++i) {
+    const IndexRange& range = index_ranges[i];
+    RET_CHECK(range.first <= range.last)
+        << "Invalid index range [" << range.first << ", " << range.last
+        << "].";
+    RET_CHECK(i == 0 || range.first > index_ranges[i - 1].last)
+        << "Index ranges must be sorted and must not overlap.";
+    if (range.last >= table_size) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Index " << range.last << " is out of range for table "
+             << metadata.table_id() << " with " << table_size << " entries.";
+    }
+
+    // First entry of the range.
+    std::unique_ptr<bfrt::BfRtTableKey> first_key;
+    std::unique_ptr<bfrt::BfRtTableData> first_data;
+    RETURN_IF_BFRT_ERROR(table->keyAllocate(&first_key));
+    RETURN_IF_BFRT_ERROR(table->dataAllocate(&first_data));
+    RETURN_IF_BFRT_ERROR(
+        first_key->setValue(index_field->id, static_cast<uint64>(range.first)));
+    RETURN_IF_BFRT_ERROR(table->tableEntryGet(
+        *bfrt_session, bf_dev_target, *first_key,
+        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, first_data.get()));
+    const bfrt::BfRtTableKey* start_key = first_key.get();
+    table_keys->push_back(std::move(first_key));
+    table_datums->push_back(std::move(first_data));
+    if (range.last == range.first) continue;
+
+    // All entries of the range following the first.
+    const uint32 num_entries = range.last - range.first;
+    bfrt::BfRtTable::keyDataPairs pairs;
+    for (uint32 j = 0; j < num_entries; ++j) {
+      std::unique_ptr<bfrt::BfRtTableKey> table_key;
+      std::unique_ptr<bfrt::BfRtTableData> table_data;
+      RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
+      RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
+      pairs.push_back(std::make_pair(table_key.get(), table_data.get()));
+      table_keys->push_back(std::move(table_key));
+      table_datums->push_back(std::move(table_data));
+    }
+    uint32 actual = 0;
+    RETURN_IF_BFRT_ERROR(table->tableEntryGetNext_n(
+        *bfrt_session, bf_dev_target, *start_key, pairs.size(),
+        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, &pairs, &actual));
+    RET_CHECK(actual == num_entries)
+        << "Expected " << num_entries << " entries following index "
+        << range.first << " but got " << actual << ".";
+  }
+
+  CHECK(table_keys->size() == table_datums->size());
+
+  return ::util::OkStatus();
+}
+
 }  // namespace
 
+BfRtTableMetadata::BfRtTableMetadata(const bfrt::BfRtTable* table,
+                                     bf_rt_id_t table_id)
+    : table_(table),
+      action_id_applicable_(false),
+      fields_(table_id),
+      has_register_data_field_(false),
+      register_data_field_() {}
+
+::util::StatusOr<std::shared_ptr<const BfRtTableMetadata>>
+BfRtTableMetadata::CreateFromTable(const bfrt::BfRtTable* table) {
+  RET_CHECK(table);
+  bf_rt_id_t table_id;
+  RETURN_IF_BFRT_ERROR(table->tableIdGet(&table_id));
+  std::shared_ptr<BfRtTableMetadata> metadata(
+      new BfRtTableMetadata(table, table_id));
+  metadata->action_id_applicable_ = table->actionIdApplicable();
+
+  std::vector<bf_rt_id_t> key_field_ids;
+  RETURN_IF_BFRT_ERROR(table->keyFieldIdListGet(&key_field_ids));
+  for (const auto& field_id : key_field_ids) {
+    std::string field_name;
+    FieldInfo field = {field_id, bfrt::DataType::UINT64, 0};
+    RETURN_IF_BFRT_ERROR(table->keyFieldNameGet(field_id, &field_name));
+    RETURN_IF_BFRT_ERROR(
+        table->keyFieldDataTypeGet(field_id, &field.data_type));
+    RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(field_id, &field.size_bits));
+    metadata->fields_.AddKeyField(field_name, field_id, field);
+  }
+
+  // Fields common to all actions, or all fields if there are no actions.
+  RETURN_IF_ERROR(metadata->AddDataFields(0));
+  if (metadata->action_id_applicable_) {
+    std::vector<bf_rt_id_t> action_ids;
+    RETURN_IF_BFRT_ERROR(table->actionIdListGet(&action_ids));
+    for (const auto& action_id : action_ids) {
+      std::string action_name;
+      RETURN_IF_BFRT_ERROR(table->actionNameGet(action_id, &action_name));
+      metadata->fields_.AddAction(action_name, action_id);
+      RETURN_IF_ERROR(metadata->AddDataFields(action_id));
+    }
+  }
+
+  // The current bf-p4c compiler emits the fully-qualified register field
+  // name, including parent table and pipeline, so we match on the suffix.
+  const FieldInfo* register_data_field =
+      metadata->fields_.FindDataFieldWithSuffix(0, ".f1");
+  if (register_data_field) {
+    metadata->has_register_data_field_ = true;
+    metadata->register_data_field_ = *register_data_field;
+  }
+
+  return std::shared_ptr<const BfRtTableMetadata>(std::move(metadata));
+}
+
+::util::Status BfRtTableMetadata::AddDataFields(bf_rt_id_t action_id) {
+  std::vector<bf_rt_id_t> data_field_ids;
+  if (action_id) {
+    RETURN_IF_BFRT_ERROR(
+        table_->dataFieldIdListGet(action_id, &data_field_ids));
+  } else if (table_->dataFieldIdListGet(&data_field_ids) != BF_SUCCESS) {
+    // Some tables with actions have no common data fields.
+    return ::util::OkStatus();
+  }
+  for (const auto& field_id : data_field_ids) {
+    std::string field_name;
+    FieldInfo field = {field_id, bfrt::DataType::UINT64, 0};
+    if (action_id) {
+      RETURN_IF_BFRT_ERROR(
+          table_->dataFieldNameGet(field_id, action_id, &field_name));
+      RETURN_IF_BFRT_ERROR(
+          table_->dataFieldDataTypeGet(field_id, action_id, &field.data_type));
+      RETURN_IF_BFRT_ERROR(
+          table_->dataFieldSizeGet(field_id, action_id, &field.size_bits));
+    } else {
+      RETURN_IF_BFRT_ERROR(table_->dataFieldNameGet(field_id, &field_name));
+      RETURN_IF_BFRT_ERROR(
+          table_->dataFieldDataTypeGet(field_id, &field.data_type));
+      RETURN_IF_BFRT_ERROR(
+          table_->dataFieldSizeGet(field_id, &field.size_bits));
+    }
+    fields_.AddDataField(action_id, field_name, field_id, field);
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::Status TableKey::SetExact(int id, const std::string& value) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   std::string v = P4RuntimeByteStringToPaddedByteString(
-      value, NumBitsToNumBytes(field_size_bits));
+      value, NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_key_->setValue(
       id, reinterpret_cast<const uint8*>(v.data()), v.size()));
 
@@ -590,14 +679,11 @@ template <typename T>
 
 ::util::Status TableKey::SetTernary(int id, const std::string& value,
                                     const std::string& mask) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   std::string v = P4RuntimeByteStringToPaddedByteString(
-      value, NumBitsToNumBytes(field_size_bits));
+      value, NumBitsToNumBytes(field->size_bits));
   std::string m = P4RuntimeByteStringToPaddedByteString(
-      mask, NumBitsToNumBytes(field_size_bits));
+      mask, NumBitsToNumBytes(field->size_bits));
   CHECK_EQ(v.size(), m.size());
   RETURN_IF_BFRT_ERROR(table_key_->setValueandMask(
       id, reinterpret_cast<const uint8*>(v.data()),
@@ -608,12 +694,9 @@ template <typename T>
 
 ::util::Status TableKey::SetLpm(int id, const std::string& prefix,
                                 uint16 prefix_length) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   std::string p = P4RuntimeByteStringToPaddedByteString(
-      prefix, NumBitsToNumBytes(field_size_bits));
+      prefix, NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_key_->setValueLpm(
       id, reinterpret_cast<const uint8*>(p.data()), prefix_length, p.size()));
 
@@ -622,14 +705,11 @@ template <typename T>
 
 ::util::Status TableKey::SetRange(int id, const std::string& low,
                                   const std::string& high) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   std::string l = P4RuntimeByteStringToPaddedByteString(
-      low, NumBitsToNumBytes(field_size_bits));
+      low, NumBitsToNumBytes(field->size_bits));
   std::string h = P4RuntimeByteStringToPaddedByteString(
-      high, NumBitsToNumBytes(field_size_bits));
+      high, NumBitsToNumBytes(field->size_bits));
   CHECK_EQ(l.size(), h.size());
   RETURN_IF_BFRT_ERROR(table_key_->setValueRange(
       id, reinterpret_cast<const uint8*>(l.data()),
@@ -639,23 +719,13 @@ template <typename T>
 }
 
 ::util::Status TableKey::SetPriority(uint32 priority) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  bf_rt_id_t priority_field_id;
-  RETURN_IF_BFRT_ERROR(
-      table->keyFieldIdGet(kMatchPriority, &priority_field_id));
-  RETURN_IF_BFRT_ERROR(table_key_->setValue(priority_field_id, priority));
-
-  return ::util::OkStatus();
+  return SetField(*metadata_, table_key_.get(), kMatchPriority, priority);
 }
 
 ::util::Status TableKey::GetExact(int id, std::string* value) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   value->clear();
-  value->resize(NumBitsToNumBytes(field_size_bits));
+  value->resize(NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_key_->getValue(
       id, value->size(),
       reinterpret_cast<uint8*>(gtl::string_as_array(value))));
@@ -666,14 +736,11 @@ template <typename T>
 
 ::util::Status TableKey::GetTernary(int id, std::string* value,
                                     std::string* mask) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   value->clear();
-  value->resize(NumBitsToNumBytes(field_size_bits));
+  value->resize(NumBitsToNumBytes(field->size_bits));
   mask->clear();
-  mask->resize(NumBitsToNumBytes(field_size_bits));
+  mask->resize(NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_key_->getValueandMask(
       id, value->size(), reinterpret_cast<uint8*>(gtl::string_as_array(value)),
       reinterpret_cast<uint8*>(gtl::string_as_array(mask))));
@@ -685,12 +752,9 @@ template <typename T>
 
 ::util::Status TableKey::GetLpm(int id, std::string* prefix,
                                 uint16* prefix_length) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   prefix->clear();
-  prefix->resize(NumBitsToNumBytes(field_size_bits));
+  prefix->resize(NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_key_->getValueLpm(
       id, prefix->size(),
       reinterpret_cast<uint8*>(gtl::string_as_array(prefix)), prefix_length));
@@ -701,14 +765,11 @@ template <typename T>
 
 ::util::Status TableKey::GetRange(int id, std::string* low,
                                   std::string* high) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  size_t field_size_bits;
-  RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetKeyField(id));
   low->clear();
-  low->resize(NumBitsToNumBytes(field_size_bits));
+  low->resize(NumBitsToNumBytes(field->size_bits));
   high->clear();
-  high->resize(NumBitsToNumBytes(field_size_bits));
+  high->resize(NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_key_->getValueRange(
       id, low->size(), reinterpret_cast<uint8*>(gtl::string_as_array(low)),
       reinterpret_cast<uint8*>(gtl::string_as_array(high))));
@@ -719,50 +780,43 @@ template <typename T>
 }
 
 ::util::Status TableKey::GetPriority(uint32* priority) const {
-  // const bfrt::BfRtTable* table;
-  // RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
   uint64 bf_priority;
-  RETURN_IF_ERROR(GetField(*table_key_, kMatchPriority, &bf_priority));
+  RETURN_IF_ERROR(
+      GetField(*metadata_, *table_key_, kMatchPriority, &bf_priority));
   *priority = bf_priority;
 
   return ::util::OkStatus();
 }
 
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>
-TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+TableKey::CreateTableKey(std::shared_ptr<const BfRtTableMetadata> metadata) {
+  RET_CHECK(metadata);
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
-  RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
+  RETURN_IF_BFRT_ERROR(metadata->table()->keyAllocate(&table_key));
   auto key = std::unique_ptr<BfSdeInterface::TableKeyInterface>(
-      new TableKey(std::move(table_key)));
+      new TableKey(std::move(table_key), std::move(metadata)));
   return key;
 }
 
 ::util::Status TableKey::GetTableId(uint32* table_id) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  RETURN_IF_BFRT_ERROR(table->tableIdGet(table_id));
+  *table_id = metadata_->table_id();
 
   return ::util::OkStatus();
 }
 
-::util::Status TableData::SetParam(int id, const std::string& value) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
+::util::StatusOr<bf_rt_id_t> TableData::GetBfRtActionId() const {
   bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
+  if (metadata_->action_id_applicable()) {
     RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
   }
-  size_t field_size_bits;
-  if (action_id) {
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldSizeGet(id, action_id, &field_size_bits));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldSizeGet(id, &field_size_bits));
-  }
+  return action_id;
+}
+
+::util::Status TableData::SetParam(int id, const std::string& value) {
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, GetBfRtActionId());
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetDataField(action_id, id));
   std::string p = P4RuntimeByteStringToPaddedByteString(
-      value, NumBitsToNumBytes(field_size_bits));
+      value, NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_data_->setValue(
       id, reinterpret_cast<const uint8*>(p.data()), p.size()));
 
@@ -770,21 +824,10 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 }
 
 ::util::Status TableData::GetParam(int id, std::string* value) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
-  size_t field_size_bits;
-  if (action_id) {
-    RETURN_IF_BFRT_ERROR(
-        table->dataFieldSizeGet(id, action_id, &field_size_bits));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldSizeGet(id, &field_size_bits));
-  }
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, GetBfRtActionId());
+  ASSIGN_OR_RETURN(const auto* field, metadata_->GetDataField(action_id, id));
   value->clear();
-  value->resize(NumBitsToNumBytes(field_size_bits));
+  value->resize(NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_data_->getValue(
       id, value->size(),
       reinterpret_cast<uint8*>(gtl::string_as_array(value))));
@@ -794,65 +837,59 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 }
 
 ::util::Status TableData::SetActionMemberId(uint64 action_member_id) {
-  return SetField(table_data_.get(), kActionMemberId, action_member_id);
+  return SetField(*metadata_, table_data_.get(), kActionMemberId,
+                  action_member_id);
 }
 
 ::util::Status TableData::GetActionMemberId(uint64* action_member_id) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
   // Here we assume that table entries with action IDs (direct match-action) can
   // never hold action member or group IDs (indirect match-action). Since this
   // function is regularly called on both, we do not log this error here.
-  if (table->actionIdApplicable()) {
+  if (metadata_->action_id_applicable()) {
     return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
            << "This direct table does not contain action member IDs.";
   }
-  bf_rt_id_t field_id;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(kActionMemberId, &field_id));
-  RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  RET_CHECK(data_type == bfrt::DataType::UINT64)
+  ASSIGN_OR_RETURN(const auto* field,
+                   metadata_->GetDataField(0, kActionMemberId));
+  RET_CHECK(field->data_type == bfrt::DataType::UINT64)
       << "Requested uint64 but field $ACTION_MEMBER_ID has type "
-      << static_cast<int>(data_type);
+      << static_cast<int>(field->data_type);
   bool is_active;
-  RETURN_IF_BFRT_ERROR(table_data_->isActive(field_id, &is_active));
+  RETURN_IF_BFRT_ERROR(table_data_->isActive(field->id, &is_active));
   if (!is_active) {
     return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
            << "Field $ACTION_MEMBER_ID is not active.";
   }
-  RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, action_member_id));
+  RETURN_IF_BFRT_ERROR(table_data_->getValue(field->id, action_member_id));
 
   return ::util::OkStatus();
 }
 
 ::util::Status TableData::SetSelectorGroupId(uint64 selector_group_id) {
-  return SetField(table_data_.get(), kSelectorGroupId, selector_group_id);
+  return SetField(*metadata_, table_data_.get(), kSelectorGroupId,
+                  selector_group_id);
 }
 
 ::util::Status TableData::GetSelectorGroupId(uint64* selector_group_id) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
   // Here we assume that table entries with action IDs (direct match-action) can
   // never hold action member or group IDs (indirect match-action). Since this
   // function is regularly called on both, we do not log this error here.
-  if (table->actionIdApplicable()) {
+  if (metadata_->action_id_applicable()) {
     return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
            << "This direct table does not contain action group IDs.";
   }
-  bf_rt_id_t field_id;
-  bfrt::DataType data_type;
-  RETURN_IF_BFRT_ERROR(table->dataFieldIdGet(kSelectorGroupId, &field_id));
-  RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-  RET_CHECK(data_type == bfrt::DataType::UINT64)
+  ASSIGN_OR_RETURN(const auto* field,
+                   metadata_->GetDataField(0, kSelectorGroupId));
+  RET_CHECK(field->data_type == bfrt::DataType::UINT64)
       << "Requested uint64 but field $SELECTOR_GROUP_ID has type "
-      << static_cast<int>(data_type);
+      << static_cast<int>(field->data_type);
   bool is_active;
-  RETURN_IF_BFRT_ERROR(table_data_->isActive(field_id, &is_active));
+  RETURN_IF_BFRT_ERROR(table_data_->isActive(field->id, &is_active));
   if (!is_active) {
     return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
            << "Field $SELECTOR_GROUP_ID is not active.";
   }
-  RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, selector_group_id));
+  RETURN_IF_BFRT_ERROR(table_data_->getValue(field->id, selector_group_id));
 
   return ::util::OkStatus();
 }
@@ -863,34 +900,19 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 // request for a packet-only counter. Therefore we have to be careful when
 // making set calls for those fields against the SDE.
 ::util::Status TableData::SetCounterData(uint64 bytes, uint64 packets) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, GetBfRtActionId());
   if (!action_id) {
-    bf_rt_id_t table_id;
-    table->tableIdGet(&table_id);
-    std::string table_name;
-    table->tableNameGet(&table_name);
     LOG(WARNING) << "Trying to set counter data on a table entry without "
                  << "action ID. This might not behave as expected, please "
-                 << "report this to the Stratum authors: table_id " << table_id
-                 << " table_name " << table_name << ".";
+                 << "report this to the Stratum authors: table_id "
+                 << metadata_->table_id() << ".";
   }
-  std::vector<bf_rt_id_t> data_field_ids;
-  RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(&data_field_ids));
-  for (const auto& field_id : data_field_ids) {
-    std::string field_name;
-    RETURN_IF_BFRT_ERROR(table->dataFieldNameGet(field_id, &field_name));
-    if (field_name == kCounterBytes) {
-      RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id, bytes));
-    } else if (field_name == kCounterPackets) {
-      RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id, packets));
-    }
-    // Uninteresting field, ignore.
+  // The counter fields are common to all actions.
+  if (const auto* field = metadata_->FindDataField(0, kCounterBytes)) {
+    RETURN_IF_BFRT_ERROR(table_data_->setValue(field->id, bytes));
+  }
+  if (const auto* field = metadata_->FindDataField(0, kCounterPackets)) {
+    RETURN_IF_BFRT_ERROR(table_data_->setValue(field->id, packets));
   }
 
   return ::util::OkStatus();
@@ -899,38 +921,18 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 ::util::Status TableData::GetCounterData(uint64* bytes, uint64* packets) const {
   RET_CHECK(bytes);
   RET_CHECK(packets);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
 
   // Clear values in case we set only one of them later.
   *bytes = 0;
   *packets = 0;
 
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
-
-  std::vector<bf_rt_id_t> data_field_ids;
-  if (action_id) {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(action_id, &data_field_ids));
-  } else {
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(&data_field_ids));
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, GetBfRtActionId());
+  if (const auto* field = metadata_->FindDataField(action_id, kCounterBytes)) {
+    RETURN_IF_BFRT_ERROR(table_data_->getValue(field->id, bytes));
   }
-  for (const auto& field_id : data_field_ids) {
-    std::string field_name;
-    if (action_id) {
-      RETURN_IF_BFRT_ERROR(
-          table->dataFieldNameGet(field_id, action_id, &field_name));
-    } else {
-      RETURN_IF_BFRT_ERROR(table->dataFieldNameGet(field_id, &field_name));
-    }
-    if (field_name == kCounterBytes) {
-      RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, bytes));
-    } else if (field_name == kCounterPackets) {
-      RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, packets));
-    }
-    // Uninteresting field, ignore.
+  if (const auto* field =
+          metadata_->FindDataField(action_id, kCounterPackets)) {
+    RETURN_IF_BFRT_ERROR(table_data_->getValue(field->id, packets));
   }
 
   return ::util::OkStatus();
@@ -938,20 +940,14 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 
 ::util::Status TableData::GetActionId(int* action_id) const {
   RET_CHECK(action_id);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-  bf_rt_id_t bf_action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&bf_action_id));
-  }
+  ASSIGN_OR_RETURN(bf_rt_id_t bf_action_id, GetBfRtActionId());
   *action_id = bf_action_id;
 
   return ::util::OkStatus();
 }
 
 ::util::Status TableData::Reset(int action_id) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
+  const bfrt::BfRtTable* table = metadata_->table();
   if (action_id) {
     RETURN_IF_BFRT_ERROR(table->dataReset(action_id, table_data_.get()));
   } else {
@@ -962,10 +958,10 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 }
 
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>
-TableData::CreateTableData(const bfrt::BfRtInfo* bfrt_info_, int table_id,
+TableData::CreateTableData(std::shared_ptr<const BfRtTableMetadata> metadata,
                            int action_id) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  RET_CHECK(metadata);
+  const bfrt::BfRtTable* table = metadata->table();
   std::unique_ptr<bfrt::BfRtTableData> table_data;
   if (action_id) {
     RETURN_IF_BFRT_ERROR(table->dataAllocate(action_id, &table_data));
@@ -973,7 +969,7 @@ TableData::CreateTableData(const bfrt::BfRtInfo* bfrt_info_, int table_id,
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
   }
   auto data = std::unique_ptr<BfSdeInterface::TableDataInterface>(
-      new TableData(std::move(table_data)));
+      new TableData(std::move(table_data), std::move(metadata)));
   return data;
 }
 
@@ -1882,6 +1878,17 @@ std::string BfSdeWrapper::GetSdeVersion() const {
 
   RETURN_IF_BFRT_ERROR(bfrt_device_manager_->bfRtInfoGet(
       device, device_config.programs(0).name(), &bfrt_info_));
+  // Counters synced with the old pipeline must not be reused.
+  counter_sync_coordinator_.Reset(device);
+
+  // Cache the key and data field IDs of all tables of the new pipeline.
+  table_metadata_.clear();
+  std::vector<const bfrt::BfRtTable*> tables;
+  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtInfoGetTables(&tables));
+  for (const auto* table : tables) {
+    ASSIGN_OR_RETURN(table_metadata_[table],
+                     BfRtTableMetadata::CreateFromTable(table));
+  }
 
   // FIXME: if all we ever do is create and push, this could be one call.
   bfrt_id_mapper_ = BfrtIdMapper::CreateInstance();
@@ -1891,6 +1898,16 @@ std::string BfSdeWrapper::GetSdeVersion() const {
   return ::util::OkStatus();
 }
 
+::util::StatusOr<std::shared_ptr<const BfRtTableMetadata>>
+BfSdeWrapper::GetTableMetadata(const bfrt::BfRtTable* table) const {
+  auto it = table_metadata_.find(table);
+  if (it == table_metadata_.end()) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED)
+           << "No metadata cached for table. Has the pipeline been pushed?";
+  }
+  return it->second;
+}
+
 // Create and start an new session.
 ::util::StatusOr<std::shared_ptr<BfSdeInterface::SessionInterface>>
 BfSdeWrapper::CreateSession() {
@@ -1900,31 +1917,112 @@ BfSdeWrapper::CreateSession() {
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>
 BfSdeWrapper::CreateTableKey(int table_id) {
   ::absl::ReaderMutexLock l(&data_lock_);
-  return TableKey::CreateTableKey(bfrt_info_, table_id);
+  const bfrt::BfRtTable* table;
+  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
+  return TableKey::CreateTableKey(std::move(metadata));
 }
 
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>
 BfSdeWrapper::CreateTableData(int table_id, int action_id) {
   ::absl::ReaderMutexLock l(&data_lock_);
-  return TableData::CreateTableData(bfrt_info_, table_id, action_id);
+  const bfrt::BfRtTable* table;
+  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
+  return TableData::CreateTableData(std::move(metadata), action_id);
 }
 
 //  Packetio
 
+namespace {
+// Returns the DMA type of the buffers of packets sent on the given TX ring.
+bf_dma_type_t TxRingDmaType(int tx_ring) {
+  return static_cast<bf_dma_type_t>(BF_DMA_CPU_PKT_TRANSMIT_0 + tx_ring);
+}
+}  // namespace
+
 ::util::Status BfSdeWrapper::TxPacket(int device, const std::string& buffer) {
   bf_pkt* pkt = nullptr;
-  RETURN_IF_BFRT_ERROR(
-      bf_pkt_alloc(device, &pkt, buffer.size(), BF_DMA_CPU_PKT_TRANSMIT_0));
-  auto pkt_cleaner =
-      absl::MakeCleanup([pkt, device]() { bf_pkt_free(device, pkt); });
+  int tx_ring = BF_PKT_TX_RING_0;
+  {
+    absl::MutexLock l(&packet_tx_pool_lock_);
+    auto* pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+    if (pool != nullptr) {
+      tx_ring = pool->NextTxRing();
+      pkt = pool->Take(tx_ring, buffer.size());
+    }
+  }
+  if (pkt == nullptr) {
+    RETURN_IF_BFRT_ERROR(
+        bf_pkt_alloc(device, &pkt, buffer.size(), TxRingDmaType(tx_ring)));
+  }
+  auto pkt_cleaner = absl::MakeCleanup(
+      [this, pkt, device]() { HandlePacketTxDone(device, pkt); });
   RETURN_IF_BFRT_ERROR(bf_pkt_data_copy(
       pkt, reinterpret_cast<const uint8*>(buffer.data()), buffer.size()));
-  RETURN_IF_BFRT_ERROR(bf_pkt_tx(device, pkt, BF_PKT_TX_RING_0, pkt));
+  RETURN_IF_BFRT_ERROR(bf_pkt_tx(
+      device, pkt, static_cast<bf_pkt_tx_ring_t>(tx_ring), pkt));
   std::move(pkt_cleaner).Cancel();
 
   return ::util::OkStatus();
 }
 
+::util::Status BfSdeWrapper::AllocatePacketTxPool(int device) {
+  const int num_tx_rings =
+      std::min(std::max(1, FLAGS_bfrt_num_packet_tx_rings),
+               static_cast<int>(BF_PKT_TX_RING_MAX));
+  RET_CHECK(FLAGS_bfrt_packet_tx_pool_size >= 0)
+      << "Invalid bfrt_packet_tx_pool_size: " << FLAGS_bfrt_packet_tx_pool_size
+      << ".";
+  RET_CHECK(FLAGS_bfrt_packet_tx_buffer_size > 0)
+      << "Invalid bfrt_packet_tx_buffer_size: "
+      << FLAGS_bfrt_packet_tx_buffer_size << ".";
+
+  BfrtPacketTxPool<bf_pkt> pool(num_tx_rings,
+                                 FLAGS_bfrt_packet_tx_buffer_size);
+  for (int tx_ring = 0; tx_ring < num_tx_rings; ++tx_ring) {
+    for (int i = 0; i < FLAGS_bfrt_packet_tx_pool_size; ++i) {
+      bf_pkt* pkt = nullptr;
+      bf_status_t bf_status = bf_pkt_alloc(device, &pkt, pool.BufferSize(),
+                                           TxRingDmaType(tx_ring));
+      if (bf_status != BF_SUCCESS) {
+        // Not an error, packets are sent in newly allocated buffers when the
+        // pool runs out of free ones.
+        LOG(WARNING) << "Could only pre-allocate " << i << " TX packet "
+                     << "buffers for TX ring " << tx_ring << " on device "
+                     << device << ": " << bf_err_str(bf_status) << ".";
+        break;
+      }
+      pool.Add(tx_ring, pkt);
+    }
+  }
+  VLOG(1) << "Pre-allocated " << pool.NumBuffers()
+          << " TX packet buffers on " << num_tx_rings << " TX rings on device "
+          << device << ".";
+
+  absl::MutexLock l(&packet_tx_pool_lock_);
+  device_to_packet_tx_pool_.insert_or_assign(device, std::move(pool));
+
+  return ::util::OkStatus();
+}
+
+void BfSdeWrapper::FreePacketTxPool(int device) {
+  absl::MutexLock l(&packet_tx_pool_lock_);
+  auto* pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+  if (pool == nullptr) return;
+  for (bf_pkt* pkt : pool->Clear()) bf_pkt_free(device, pkt);
+  device_to_packet_tx_pool_.erase(device);
+}
+
+void BfSdeWrapper::HandlePacketTxDone(bf_dev_id_t device, bf_pkt* pkt) {
+  {
+    absl::MutexLock l(&packet_tx_pool_lock_);
+    auto* pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+    if (pool != nullptr && pool->Release(pkt)) return;
+  }
+  bf_pkt_free(device, pkt);
+}
+
 ::util::Status BfSdeWrapper::StartPacketIo(int device) {
   // Maybe move to InitSde function?
   if (!bf_pkt_is_inited(device)) {
@@ -1947,6 +2045,10 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
   }
   VLOG(1) << "Registered packetio callbacks on device " << device << ".";
 
+  // The bf_pkt driver may have been reset, which releases the buffers of any
+  // previous pool, so they are not freed here.
+  RETURN_IF_ERROR(AllocatePacketTxPool(device));
+
   return ::util::OkStatus();
 }
 
@@ -1964,13 +2066,18 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
   }
   VLOG(1) << "Unregistered packetio callbacks on device " << device << ".";
 
+  FreePacketTxPool(device);
+
   return ::util::OkStatus();
 }
 
 ::util::Status BfSdeWrapper::RegisterPacketReceiveWriter(
-    int device, std::unique_ptr<ChannelWriter<std::string>> writer) {
+    int device, std::unique_ptr<ChannelWriter<std::string>> writer,
+    std::shared_ptr<PacketRxBufferPool> buffer_pool) {
   absl::WriterMutexLock l(&packet_rx_callback_lock_);
-  device_to_packet_rx_writer_[device] = std::move(writer);
+  auto& rx_writer = device_to_packet_rx_writer_[device];
+  rx_writer.writer = std::move(writer);
+  rx_writer.buffer_pool = std::move(buffer_pool);
   return ::util::OkStatus();
 }
 
@@ -1987,14 +2094,22 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
   RET_CHECK(rx_writer) << "No Rx callback registered for device id " << device
                        << ".";
 
-  std::string buffer(reinterpret_cast<const char*>(bf_pkt_get_pkt_data(pkt)),
-                     bf_pkt_get_pkt_size(pkt));
-  ::util::Status status = (*rx_writer)->TryWrite(buffer);
-  LOG_IF_EVERY_N(INFO, !status.ok(), 500)
-      << "Dropped packet received from CPU: " << status;
+  // Copy the packet into a pooled buffer, to avoid an allocation per packet.
+  std::string buffer;
+  if (rx_writer->buffer_pool) buffer = rx_writer->buffer_pool->Get();
+  buffer.assign(reinterpret_cast<const char*>(bf_pkt_get_pkt_data(pkt)),
+                bf_pkt_get_pkt_size(pkt));
   VLOG(1) << "Received " << buffer.size() << " byte packet from CPU "
           << StringToHex(buffer);
-
+  ::util::Status status = rx_writer->writer->TryWrite(std::move(buffer));
+  if (!status.ok()) {
+    if (rx_writer->buffer_pool) {
+      rx_writer->buffer_pool->IncrementNumDropped();
+      rx_writer->buffer_pool->Put(std::move(buffer));
+    }
+    LOG_EVERY_N(INFO, 500) << "Dropped packet received from CPU: " << status;
+  }
+
   return ::util::OkStatus();
 }
 
@@ -2006,8 +2121,10 @@ bf_status_t BfSdeWrapper::BfPktTxNotifyCallback(bf_dev_id_t device,
           << " tx ring: " << tx_ring << " tx cookie: " << tx_cookie
           << " status: " << status;
 
-  bf_pkt* pkt = reinterpret_cast<bf_pkt*>(tx_cookie);
-  return bf_pkt_free(device, pkt);
+  BfSdeWrapper* bf_sde_wrapper = BfSdeWrapper::GetSingleton();
+  bf_sde_wrapper->HandlePacketTxDone(device,
+                                     reinterpret_cast<bf_pkt*>(tx_cookie));
+  return BF_SUCCESS;
 }
 
 bf_status_t BfSdeWrapper::BfPktRxNotifyCallback(bf_dev_id_t device, bf_pkt* pkt,
@@ -2104,7 +2221,7 @@ bf_rt_target_t BfSdeWrapper::GetDeviceTarget(int device) const {
 
 // PRE
 namespace {
-::util::Status PrintMcGroupEntry(const bfrt::BfRtTable* table,
+::util::Status PrintMcGroupEntry(const BfRtTableMetadata& metadata,
                                  const bfrt::BfRtTableKey* table_key,
                                  const bfrt::BfRtTableData* table_data) {
   std::vector<uint32> mc_node_list;
@@ -2113,13 +2230,14 @@ namespace {
   uint64 multicast_group_id;
 
   // Key: $MGID
-  RETURN_IF_ERROR(GetField(*table_key, kMgid, &multicast_group_id));
+  RETURN_IF_ERROR(GetField(metadata, *table_key, kMgid, &multicast_group_id));
   // Data: $MULTICAST_NODE_ID
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeId, &mc_node_list));
+  RETURN_IF_ERROR(GetField(metadata, *table_data, kMcNodeId, &mc_node_list));
   // Data: $MULTICAST_NODE_L1_XID_VALID
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeL1XidValid, &l1_xid_valid_list));
+  RETURN_IF_ERROR(
+      GetField(metadata, *table_data, kMcNodeL1XidValid, &l1_xid_valid_list));
   // Data: $MULTICAST_NODE_L1_XID
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeL1Xid, &l1_xid_list));
+  RETURN_IF_ERROR(GetField(metadata, *table_data, kMcNodeL1Xid, &l1_xid_list));
 
   LOG(INFO) << "Multicast group id " << multicast_group_id << " has "
             << mc_node_list.size() << " nodes.";
@@ -2130,18 +2248,18 @@ namespace {
   return ::util::OkStatus();
 }
 
-::util::Status PrintMcNodeEntry(const bfrt::BfRtTable* table,
+::util::Status PrintMcNodeEntry(const BfRtTableMetadata& metadata,
                                 const bfrt::BfRtTableKey* table_key,
                                 const bfrt::BfRtTableData* table_data) {
   // Key: $MULTICAST_NODE_ID (24 bit)
   uint64 node_id;
-  RETURN_IF_ERROR(GetField(*table_key, kMcNodeId, &node_id));
+  RETURN_IF_ERROR(GetField(metadata, *table_key, kMcNodeId, &node_id));
   // Data: $MULTICAST_RID (16 bit)
   uint64 rid;
-  RETURN_IF_ERROR(GetField(*table_data, kMcReplicationId, &rid));
+  RETURN_IF_ERROR(GetField(metadata, *table_data, kMcReplicationId, &rid));
   // Data: $DEV_PORT
   std::vector<uint32> ports;
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeDevPort, &ports));
+  RETURN_IF_ERROR(GetField(metadata, *table_data, kMcNodeDevPort, &ports));
 
   std::string ports_str = " ports [ ";
   for (const auto& port : ports) {
@@ -2173,10 +2291,11 @@ namespace {
         bfrt_info_->bfrtTableFromNameGet(kPreMgidTable, &table));
     RETURN_IF_ERROR(GetAllEntries(real_session->bfrt_session_, bf_dev_tgt,
                                   table, &keys, &datums));
+    ASSIGN_OR_RETURN(auto mgid_metadata, GetTableMetadata(table));
     for (size_t i = 0; i < keys.size(); ++i) {
       const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
       const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
-      PrintMcGroupEntry(table, table_key.get(), table_data.get());
+      PrintMcGroupEntry(*mgid_metadata, table_key.get(), table_data.get());
     }
     LOG(INFO) << "###################";
 
@@ -2186,10 +2305,11 @@ namespace {
         bfrt_info_->bfrtTableFromNameGet(kPreNodeTable, &table));
     RETURN_IF_ERROR(GetAllEntries(real_session->bfrt_session_, bf_dev_tgt,
                                   table, &keys, &datums));
+    ASSIGN_OR_RETURN(auto node_metadata, GetTableMetadata(table));
     for (size_t i = 0; i < keys.size(); ++i) {
       const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
       const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
-      PrintMcNodeEntry(table, table_key.get(), table_data.get());
+      PrintMcNodeEntry(*node_metadata, table_key.get(), table_data.get());
     }
     LOG(INFO) << "###################";
   }
@@ -2204,6 +2324,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreNodeTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   size_t table_size;
   RETURN_IF_BFRT_ERROR(table->tableSizeGet(*real_session->bfrt_session_,
                                            bf_dev_tgt, &table_size));
@@ -2218,7 +2339,7 @@ namespace {
   uint32 id = usage;
   for (size_t _ = 0; _ < table_size; ++_) {
     // Key: $MULTICAST_NODE_ID
-    RETURN_IF_ERROR(SetField(table_key.get(), kMcNodeId, id));
+    RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMcNodeId, id));
     bf_status_t status = table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *table_key,
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, table_data.get());
@@ -2247,6 +2368,7 @@ namespace {
   const bfrt::BfRtTable* table;  // PRE node table.
   bf_rt_id_t table_id;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreNodeTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   RETURN_IF_BFRT_ERROR(table->tableIdGet(&table_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
@@ -2259,14 +2381,15 @@ namespace {
   ASSIGN_OR_RETURN(uint64 mc_node_id, GetFreeMulticastNodeId(device, session));
 
   // Key: $MULTICAST_NODE_ID
-  RETURN_IF_ERROR(SetField(table_key.get(), kMcNodeId, mc_node_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMcNodeId, mc_node_id));
   // Data: $MULTICAST_RID (16 bit)
-  RETURN_IF_ERROR(
-      SetField(table_data.get(), kMcReplicationId, mc_replication_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMcReplicationId,
+                           mc_replication_id));
   // Data: $MULTICAST_LAG_ID
-  RETURN_IF_ERROR(SetField(table_data.get(), kMcNodeLagId, mc_lag_ids));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_data.get(), kMcNodeLagId, mc_lag_ids));
   // Data: $DEV_PORT
-  RETURN_IF_ERROR(SetField(table_data.get(), kMcNodeDevPort, ports));
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMcNodeDevPort, ports));
 
   RETURN_IF_BFRT_ERROR(table->tableEntryAdd(
       *real_session->bfrt_session_, bf_dev_tgt, *table_key, *table_data));
@@ -2285,19 +2408,20 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreMgidTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
   RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
   // Key: $MGID
-  RETURN_IF_ERROR(SetField(table_key.get(), kMgid, group_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMgid, group_id));
   RETURN_IF_BFRT_ERROR(table->tableEntryGet(
       *real_session->bfrt_session_, bf_dev_tgt, *table_key,
       bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, table_data.get()));
   // Data: $MULTICAST_NODE_ID
   std::vector<uint32> mc_node_list;
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeId, &mc_node_list));
+  RETURN_IF_ERROR(GetField(*metadata, *table_data, kMcNodeId, &mc_node_list));
 
   return mc_node_list;
 }
@@ -2313,13 +2437,15 @@ namespace {
   const bfrt::BfRtTable* table;
   bf_rt_id_t table_id;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreNodeTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   RETURN_IF_BFRT_ERROR(table->tableIdGet(&table_id));
 
   // TODO(max): handle partial delete failures
   for (const auto& mc_node_id : mc_node_ids) {
     std::unique_ptr<bfrt::BfRtTableKey> table_key;
     RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
-    RETURN_IF_ERROR(SetField(table_key.get(), kMcNodeId, mc_node_id));
+    RETURN_IF_ERROR(
+        SetField(*metadata, table_key.get(), kMcNodeId, mc_node_id));
     RETURN_IF_BFRT_ERROR(table->tableEntryDel(*real_session->bfrt_session_,
                                               bf_dev_tgt, *table_key));
   }
@@ -2342,6 +2468,7 @@ namespace {
   const bfrt::BfRtTable* table;  // PRE node table.
   bf_rt_id_t table_id;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreNodeTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   RETURN_IF_BFRT_ERROR(table->tableIdGet(&table_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
@@ -2349,21 +2476,21 @@ namespace {
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
   RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
   // Key: $MULTICAST_NODE_ID
-  RETURN_IF_ERROR(SetField(table_key.get(), kMcNodeId, mc_node_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMcNodeId, mc_node_id));
   RETURN_IF_BFRT_ERROR(table->tableEntryGet(
       *real_session->bfrt_session_, bf_dev_tgt, *table_key,
       bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, table_data.get()));
   // Data: $DEV_PORT
   std::vector<uint32> dev_ports;
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeDevPort, &dev_ports));
+  RETURN_IF_ERROR(GetField(*metadata, *table_data, kMcNodeDevPort, &dev_ports));
   *ports = dev_ports;
   // Data: $RID (16 bit)
   uint64 rid;
-  RETURN_IF_ERROR(GetField(*table_data, kMcReplicationId, &rid));
+  RETURN_IF_ERROR(GetField(*metadata, *table_data, kMcReplicationId, &rid));
   *replication_id = rid;
   // Data: $MULTICAST_LAG_ID
   std::vector<uint32> lags;
-  RETURN_IF_ERROR(GetField(*table_data, kMcNodeLagId, &lags));
+  RETURN_IF_ERROR(GetField(*metadata, *table_data, kMcNodeLagId, &lags));
   *lag_ids = lags;
 
   return ::util::OkStatus();
@@ -2378,6 +2505,7 @@ namespace {
   const bfrt::BfRtTable* table;  // PRE MGID table.
   bf_rt_id_t table_id;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreMgidTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   RETURN_IF_BFRT_ERROR(table->tableIdGet(&table_id));
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -2394,14 +2522,16 @@ namespace {
     l1_xid_list.push_back(0);
   }
   // Key: $MGID
-  RETURN_IF_ERROR(SetField(table_key.get(), kMgid, group_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMgid, group_id));
   // Data: $MULTICAST_NODE_ID
-  RETURN_IF_ERROR(SetField(table_data.get(), kMcNodeId, mc_node_list));
-  // Data: $MULTICAST_NODE_L1_XID_VALID
   RETURN_IF_ERROR(
-      SetField(table_data.get(), kMcNodeL1XidValid, l1_xid_valid_list));
+      SetField(*metadata, table_data.get(), kMcNodeId, mc_node_list));
+  // Data: $MULTICAST_NODE_L1_XID_VALID
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMcNodeL1XidValid,
+                           l1_xid_valid_list));
   // Data: $MULTICAST_NODE_L1_XID
-  RETURN_IF_ERROR(SetField(table_data.get(), kMcNodeL1Xid, l1_xid_list));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_data.get(), kMcNodeL1Xid, l1_xid_list));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   if (insert) {
@@ -2439,10 +2569,11 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;  // PRE MGID table.
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreMgidTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
   // Key: $MGID
-  RETURN_IF_ERROR(SetField(table_key.get(), kMgid, group_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMgid, group_id));
   RETURN_IF_BFRT_ERROR(table->tableEntryDel(*real_session->bfrt_session_,
                                             bf_dev_tgt, *table_key));
 
@@ -2462,6 +2593,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;  // PRE MGID table.
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromNameGet(kPreMgidTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
   // Is this a wildcard read?
@@ -2471,7 +2603,7 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->keyAllocate(&keys[0]));
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&datums[0]));
     // Key: $MGID
-    RETURN_IF_ERROR(SetField(keys[0].get(), kMgid, group_id));
+    RETURN_IF_ERROR(SetField(*metadata, keys[0].get(), kMgid, group_id));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -2488,11 +2620,11 @@ namespace {
     ::p4::v1::MulticastGroupEntry result;
     // Key: $MGID
     uint64 group_id;
-    RETURN_IF_ERROR(GetField(*table_key, kMgid, &group_id));
+    RETURN_IF_ERROR(GetField(*metadata, *table_key, kMgid, &group_id));
     group_ids->push_back(group_id);
     // Data: $MULTICAST_NODE_ID
     std::vector<uint32> mc_node_list;
-    RETURN_IF_ERROR(GetField(*table_data, kMcNodeId, &mc_node_list));
+    RETURN_IF_ERROR(GetField(*metadata, *table_data, kMcNodeId, &mc_node_list));
     mc_node_ids->push_back(mc_node_list);
   }
 
@@ -2512,32 +2644,34 @@ namespace {
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(
       bfrt_info_->bfrtTableFromNameGet(kMirrorConfigTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
-  bf_rt_id_t action_id;
-  RETURN_IF_BFRT_ERROR(table->actionIdGet("$normal", &action_id));
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, metadata->GetActionId("$normal"));
   RETURN_IF_BFRT_ERROR(table->dataAllocate(action_id, &table_data));
 
   // Key: $sid
-  RETURN_IF_ERROR(SetField(table_key.get(), "$sid", session_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), "$sid", session_id));
   // Data: $direction
-  RETURN_IF_ERROR(SetField(table_data.get(), "$direction", "BOTH"));
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), "$direction", "BOTH"));
   // Data: $session_enable
-  RETURN_IF_ERROR(SetFieldBool(table_data.get(), "$session_enable", true));
+  RETURN_IF_ERROR(
+      SetFieldBool(*metadata, table_data.get(), "$session_enable", true));
   // Data: $ucast_egress_port
   RETURN_IF_ERROR(
-      SetField(table_data.get(), "$ucast_egress_port", egress_port));
+      SetField(*metadata, table_data.get(), "$ucast_egress_port", egress_port));
   // Data: $ucast_egress_port_valid
-  RETURN_IF_ERROR(
-      SetFieldBool(table_data.get(), "$ucast_egress_port_valid", true));
+  RETURN_IF_ERROR(SetFieldBool(*metadata, table_data.get(),
+                               "$ucast_egress_port_valid", true));
   // Data: $egress_port_queue
-  RETURN_IF_ERROR(
-      SetField(table_data.get(), "$egress_port_queue", egress_queue));
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), "$egress_port_queue",
+                           egress_queue));
   // Data: $ingress_cos
-  RETURN_IF_ERROR(SetField(table_data.get(), "$ingress_cos", cos));
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), "$ingress_cos", cos));
   // Data: $max_pkt_len
-  RETURN_IF_ERROR(SetField(table_data.get(), "$max_pkt_len", max_pkt_len));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_data.get(), "$max_pkt_len", max_pkt_len));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   if (insert) {
@@ -2579,14 +2713,14 @@ namespace {
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(
       bfrt_info_->bfrtTableFromNameGet(kMirrorConfigTable, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
-  bf_rt_id_t action_id;
-  RETURN_IF_BFRT_ERROR(table->actionIdGet("$normal", &action_id));
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, metadata->GetActionId("$normal"));
   RETURN_IF_BFRT_ERROR(table->dataAllocate(action_id, &table_data));
   // Key: $sid
-  RETURN_IF_ERROR(SetField(table_key.get(), "$sid", session_id));
+  RETURN_IF_ERROR(SetField(*metadata, table_key.get(), "$sid", session_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryDel(*real_session->bfrt_session_,
@@ -2612,8 +2746,8 @@ namespace {
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(
       bfrt_info_->bfrtTableFromNameGet(kMirrorConfigTable, &table));
-  bf_rt_id_t action_id;
-  RETURN_IF_BFRT_ERROR(table->actionIdGet("$normal", &action_id));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
+  ASSIGN_OR_RETURN(bf_rt_id_t action_id, metadata->GetActionId("$normal"));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
   // Is this a wildcard read?
@@ -2623,7 +2757,7 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->keyAllocate(&keys[0]));
     RETURN_IF_BFRT_ERROR(table->dataAllocate(action_id, &datums[0]));
     // Key: $sid
-    RETURN_IF_ERROR(SetField(keys[0].get(), "$sid", session_id));
+    RETURN_IF_ERROR(SetField(*metadata, keys[0].get(), "$sid", session_id));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -2641,27 +2775,30 @@ namespace {
     const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
     // Key: $sid
     uint64 session_id;
-    RETURN_IF_ERROR(GetField(*table_key, "$sid", &session_id));
+    RETURN_IF_ERROR(GetField(*metadata, *table_key, "$sid", &session_id));
     session_ids->push_back(session_id);
     // Data: $ingress_cos
     uint64 ingress_cos;
-    RETURN_IF_ERROR(GetField(*table_data, "$ingress_cos", &ingress_cos));
+    RETURN_IF_ERROR(
+        GetField(*metadata, *table_data, "$ingress_cos", &ingress_cos));
     coss->push_back(ingress_cos);
     // Data: $max_pkt_len
     uint64 pkt_len;
-    RETURN_IF_ERROR(GetField(*table_data, "$max_pkt_len", &pkt_len));
+    RETURN_IF_ERROR(GetField(*metadata, *table_data, "$max_pkt_len", &pkt_len));
     max_pkt_lens->push_back(pkt_len);
     // Data: $ucast_egress_port
     uint64 port;
-    RETURN_IF_ERROR(GetField(*table_data, "$ucast_egress_port", &port));
+    RETURN_IF_ERROR(
+        GetField(*metadata, *table_data, "$ucast_egress_port", &port));
     egress_ports->push_back(port);
     // Data: $session_enable
     bool session_enable;
-    RETURN_IF_ERROR(GetField(*table_data, "$session_enable", &session_enable));
+    RETURN_IF_ERROR(
+        GetField(*metadata, *table_data, "$session_enable", &session_enable));
     RET_CHECK(session_enable) << "Found a session that is not enabled.";
     // Data: $ucast_egress_port_valid
     bool ucast_egress_port_valid;
-    RETURN_IF_ERROR(GetField(*table_data, "$ucast_egress_port_valid",
+    RETURN_IF_ERROR(GetField(*metadata, *table_data, "$ucast_egress_port_valid",
                              &ucast_egress_port_valid));
     RET_CHECK(ucast_egress_port_valid)
         << "Found a unicase egress port that is not set valid.";
@@ -2685,6 +2822,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(counter_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -2692,24 +2830,20 @@ namespace {
   RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
 
   // Counter key: $COUNTER_INDEX
-  RETURN_IF_ERROR(SetField(table_key.get(), kCounterIndex, counter_index));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_key.get(), kCounterIndex, counter_index));
 
   // Counter data: $COUNTER_SPEC_BYTES
-  if (byte_count.has_value()) {
-    bf_rt_id_t field_id;
-    auto bf_status = table->dataFieldIdGet(kCounterBytes, &field_id);
-    if (bf_status == BF_SUCCESS) {
-      RETURN_IF_BFRT_ERROR(table_data->setValue(field_id, byte_count.value()));
-    }
+  const auto* bytes_field = metadata->FindDataField(0, kCounterBytes);
+  if (byte_count.has_value() && bytes_field) {
+    RETURN_IF_BFRT_ERROR(
+        table_data->setValue(bytes_field->id, byte_count.value()));
   }
   // Counter data: $COUNTER_SPEC_PKTS
-  if (packet_count.has_value()) {
-    bf_rt_id_t field_id;
-    auto bf_status = table->dataFieldIdGet(kCounterPackets, &field_id);
-    if (bf_status == BF_SUCCESS) {
-      RETURN_IF_BFRT_ERROR(
-          table_data->setValue(field_id, packet_count.value()));
-    }
+  const auto* packets_field = metadata->FindDataField(0, kCounterPackets);
+  if (packet_count.has_value() && packets_field) {
+    RETURN_IF_BFRT_ERROR(
+        table_data->setValue(packets_field->id, packet_count.value()));
   }
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryMod(
@@ -2718,6 +2852,65 @@ namespace {
   return ::util::OkStatus();
 }
 
+namespace {
+// Returns the indices and values of the given indirect counter entries.
+::util::Status ParseCounterEntries(
+    const BfRtTableMetadata& metadata,
+    const std::vector<std::unique_ptr<bfrt::BfRtTableKey>>& keys,
+    const std::vector<std::unique_ptr<bfrt::BfRtTableData>>& datums,
+    std::vector<uint32>* counter_indices,
+    std::vector<absl::optional<uint64>>* byte_counts,
+    std::vector<absl::optional<uint64>>* packet_counts) {
+  // The field IDs are the same for all entries, look them up only once.
+  ASSIGN_OR_RETURN(const auto* index_field,
+                   metadata.GetKeyField(kCounterIndex));
+  const auto* bytes_field = metadata.FindDataField(0, kCounterBytes);
+  const auto* packets_field = metadata.FindDataField(0, kCounterPackets);
+
+  counter_indices->resize(0);
+  byte_counts->resize(0);
+  packet_counts->resize(0);
+  counter_indices->reserve(keys.size());
+  byte_counts->reserve(keys.size());
+  packet_counts->reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
+    const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
+    // Key: $COUNTER_INDEX
+    uint64 bf_counter_index;
+    RETURN_IF_BFRT_ERROR(
+        table_key->getValue(index_field->id, &bf_counter_index));
+    counter_indices->push_back(bf_counter_index);
+
+    absl::optional<uint64> byte_count;
+    absl::optional<uint64> packet_count;
+    // Counter data: $COUNTER_SPEC_BYTES
+    if (bytes_field) {
+      uint64 counter_data;
+      RETURN_IF_BFRT_ERROR(
+          table_data->getValue(bytes_field->id, &counter_data));
+      byte_count = counter_data;
+    }
+    byte_counts->push_back(byte_count);
+
+    // Counter data: $COUNTER_SPEC_PKTS
+    if (packets_field) {
+      uint64 counter_data;
+      RETURN_IF_BFRT_ERROR(
+          table_data->getValue(packets_field->id, &counter_data));
+      packet_count = counter_data;
+    }
+    packet_counts->push_back(packet_count);
+  }
+
+  CHECK_EQ(counter_indices->size(), keys.size());
+  CHECK_EQ(byte_counts->size(), keys.size());
+  CHECK_EQ(packet_counts->size(), keys.size());
+
+  return ::util::OkStatus();
+}
+}  // namespace
+
 ::util::Status BfSdeWrapper::ReadIndirectCounter(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
     uint32 counter_id, absl::optional<uint32> counter_index,
@@ -2735,6 +2928,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(counter_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
 
@@ -2748,8 +2942,8 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&datums[0]));
 
     // Key: $COUNTER_INDEX
-    RETURN_IF_ERROR(
-        SetField(keys[0].get(), kCounterIndex, counter_index.value()));
+    RETURN_IF_ERROR(SetField(*metadata, keys[0].get(), kCounterIndex,
+                             counter_index.value()));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -2758,70 +2952,40 @@ namespace {
                                   table, &keys, &datums));
   }
 
-  counter_indices->resize(0);
-  byte_counts->resize(0);
-  packet_counts->resize(0);
-  for (size_t i = 0; i < keys.size(); ++i) {
-    const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
-    const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
-    // Key: $COUNTER_INDEX
-    uint64 bf_counter_index;
-    RETURN_IF_ERROR(GetField(*table_key, kCounterIndex, &bf_counter_index));
-    counter_indices->push_back(bf_counter_index);
-
-    absl::optional<uint64> byte_count;
-    absl::optional<uint64> packet_count;
-    // Counter data: $COUNTER_SPEC_BYTES
-    bf_rt_id_t field_id;
-    auto bf_status = table->dataFieldIdGet(kCounterBytes, &field_id);
-    if (bf_status == BF_SUCCESS) {
-      uint64 counter_data;
-      RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &counter_data));
-      byte_count = counter_data;
-    }
-    byte_counts->push_back(byte_count);
-
-    // Counter data: $COUNTER_SPEC_PKTS
-    bf_status = table->dataFieldIdGet(kCounterPackets, &field_id);
-    if (bf_status == BF_SUCCESS) {
-      uint64 counter_data;
-      RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &counter_data));
-      packet_count = counter_data;
-    }
-    packet_counts->push_back(packet_count);
-  }
+  return ParseCounterEntries(*metadata, keys, datums, counter_indices,
+                             byte_counts, packet_counts);
+}
 
-  CHECK_EQ(counter_indices->size(), keys.size());
-  CHECK_EQ(byte_counts->size(), keys.size());
-  CHECK_EQ(packet_counts->size(), keys.size());
+::util::Status BfSdeWrapper::ReadIndirectCounterRanges(
+    int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    uint32 counter_id, const std::vector<IndexRange>& index_ranges,
+    std::vector<uint32>* counter_indices,
+    std::vector<absl::optional<uint64>>* byte_counts,
+    std::vector<absl::optional<uint64>>* packet_counts,
+    absl::Duration timeout) {
+  RET_CHECK(counter_indices);
+  RET_CHECK(byte_counts);
+  RET_CHECK(packet_counts);
+  ::absl::ReaderMutexLock l(&data_lock_);
+  auto real_session = std::dynamic_pointer_cast<Session>(session);
+  RET_CHECK(real_session);
 
-  return ::util::OkStatus();
-}
+  auto bf_dev_tgt = GetDeviceTarget(device);
+  const bfrt::BfRtTable* table;
+  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(counter_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
+  std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
+  std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
 
-namespace {
-// Helper function to get the field ID of the "f1" register data field.
-// TODO(max): Maybe use table name and strip off "pipe." at the beginning?
-// std::string table_name;
-// RETURN_IF_BFRT_ERROR(table->tableNameGet(&table_name));
-// RETURN_IF_BFRT_ERROR(
-//     table->dataFieldIdGet(absl::StrCat(table_name, ".", "f1"), &field_id));
-::util::StatusOr<bf_rt_id_t> GetRegisterDataFieldId(
-    const bfrt::BfRtTable* table) {
-  std::vector<bf_rt_id_t> data_field_ids;
-  RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(&data_field_ids));
-  for (const auto& field_id : data_field_ids) {
-    std::string field_name;
-    RETURN_IF_BFRT_ERROR(table->dataFieldNameGet(field_id, &field_name));
-    bfrt::DataType data_type;
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(field_id, &data_type));
-    if (absl::EndsWith(field_name, ".f1")) {
-      return field_id;
-    }
-  }
+  // One sync covers all ranges.
+  RETURN_IF_ERROR(DoSynchronizeCounters(device, session, counter_id, timeout));
+  RETURN_IF_ERROR(GetIndexRangeEntries(real_session->bfrt_session_,
+                                       bf_dev_tgt, *metadata, kCounterIndex,
+                                       index_ranges, &keys, &datums));
 
-  return MAKE_ERROR(ERR_INTERNAL) << "Could not find register data field id.";
+  return ParseCounterEntries(*metadata, keys, datums, counter_indices,
+                             byte_counts, packet_counts);
 }
-}  // namespace
 
 ::util::Status BfSdeWrapper::WriteRegister(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
@@ -2833,6 +2997,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -2842,23 +3007,22 @@ namespace {
   // Register data: <register_name>.f1
   // The current bf-p4c compiler emits the fully-qualified field name, including
   // parent table and pipeline. We cannot use just "f1" as the field name.
-  bf_rt_id_t field_id;
-  ASSIGN_OR_RETURN(field_id, GetRegisterDataFieldId(table));
-  size_t data_field_size_bits;
-  RETURN_IF_BFRT_ERROR(
-      table->dataFieldSizeGet(field_id, &data_field_size_bits));
+  const auto* field = metadata->register_data_field();
+  if (!field) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Could not find register data field id.";
+  }
   // The SDE expects a string with the full width.
   std::string value = P4RuntimeByteStringToPaddedByteString(
-      register_data, NumBitsToNumBytes(data_field_size_bits));
+      register_data, NumBitsToNumBytes(field->size_bits));
   RETURN_IF_BFRT_ERROR(table_data->setValue(
-      field_id, reinterpret_cast<const uint8*>(value.data()), value.size()));
+      field->id, reinterpret_cast<const uint8*>(value.data()), value.size()));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   if (register_index) {
     // Single index target.
     // Register key: $REGISTER_INDEX
-    RETURN_IF_ERROR(
-        SetField(table_key.get(), kRegisterIndex, register_index.value()));
+    RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kRegisterIndex,
+                             register_index.value()));
     RETURN_IF_BFRT_ERROR(table->tableEntryMod(
         *real_session->bfrt_session_, bf_dev_tgt, *table_key, *table_data));
   } else {
@@ -2868,7 +3032,7 @@ namespace {
                                              bf_dev_tgt, &table_size));
     for (size_t i = 0; i < table_size; ++i) {
       // Register key: $REGISTER_INDEX
-      RETURN_IF_ERROR(SetField(table_key.get(), kRegisterIndex, i));
+      RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kRegisterIndex, i));
       RETURN_IF_BFRT_ERROR(table->tableEntryMod(
           *real_session->bfrt_session_, bf_dev_tgt, *table_key, *table_data));
     }
@@ -2877,6 +3041,63 @@ namespace {
   return ::util::OkStatus();
 }
 
+namespace {
+// Returns the indices and values of the given register entries.
+::util::Status ParseRegisterEntries(
+    const BfRtTableMetadata& metadata,
+    const std::vector<std::unique_ptr<bfrt::BfRtTableKey>>& keys,
+    const std::vector<std::unique_ptr<bfrt::BfRtTableData>>& datums,
+    std::vector<uint32>* register_indices,
+    std::vector<uint64>* register_datas) {
+  // The field IDs are the same for all entries, look them up only once.
+  ASSIGN_OR_RETURN(const auto* index_field,
+                   metadata.GetKeyField(kRegisterIndex));
+  // Data: <register_name>.f1
+  const auto* f1_field = metadata.register_data_field();
+  if (!f1_field) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Could not find register data field id.";
+  }
+
+  register_indices->resize(0);
+  register_datas->resize(0);
+  register_indices->reserve(keys.size());
+  register_datas->reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
+    const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
+    // Key: $REGISTER_INDEX
+    uint64 bf_register_index;
+    RETURN_IF_BFRT_ERROR(
+        table_key->getValue(index_field->id, &bf_register_index));
+    register_indices->push_back(bf_register_index);
+
+    const bfrt::DataType data_type = f1_field->data_type;
+    switch (data_type) {
+      case bfrt::DataType::BYTE_STREAM: {
+        // Even though the data type says byte stream, the SDE can only allows
+        // fetching the data in an uint64 vector with one entry per pipe.
+        std::vector<uint64> register_data;
+        RETURN_IF_BFRT_ERROR(
+            table_data->getValue(f1_field->id, &register_data));
+        RET_CHECK(register_data.size() > 0);
+        register_datas->push_back(register_data[0]);
+        break;
+      }
+      default:
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Unsupported register data type "
+               << static_cast<int>(data_type) << " for register in table "
+               << metadata.table_id();
+    }
+  }
+
+  CHECK_EQ(register_indices->size(), keys.size());
+  CHECK_EQ(register_datas->size(), keys.size());
+
+  return ::util::OkStatus();
+}
+}  // namespace
+
 ::util::Status BfSdeWrapper::ReadRegisters(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
     uint32 table_id, absl::optional<uint32> register_index,
@@ -2893,6 +3114,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
 
@@ -2904,8 +3126,8 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&datums[0]));
 
     // Key: $REGISTER_INDEX
-    RETURN_IF_ERROR(
-        SetField(keys[0].get(), kRegisterIndex, register_index.value()));
+    RETURN_IF_ERROR(SetField(*metadata, keys[0].get(), kRegisterIndex,
+                             register_index.value()));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -2914,42 +3136,36 @@ namespace {
                                   table, &keys, &datums));
   }
 
-  register_indices->resize(0);
-  register_datas->resize(0);
-  for (size_t i = 0; i < keys.size(); ++i) {
-    const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
-    const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
-    // Key: $REGISTER_INDEX
-    uint64 bf_register_index;
-    RETURN_IF_ERROR(GetField(*table_key, kRegisterIndex, &bf_register_index));
-    register_indices->push_back(bf_register_index);
-    // Data: <register_name>.f1
-    ASSIGN_OR_RETURN(auto f1_field_id, GetRegisterDataFieldId(table));
+  return ParseRegisterEntries(*metadata, keys, datums, register_indices,
+                              register_datas);
+}
 
-    bfrt::DataType data_type;
-    RETURN_IF_BFRT_ERROR(table->dataFieldDataTypeGet(f1_field_id, &data_type));
-    switch (data_type) {
-      case bfrt::DataType::BYTE_STREAM: {
-        // Even though the data type says byte stream, the SDE can only allows
-        // fetching the data in an uint64 vector with one entry per pipe.
-        std::vector<uint64> register_data;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(f1_field_id, &register_data));
-        RET_CHECK(register_data.size() > 0);
-        register_datas->push_back(register_data[0]);
-        break;
-      }
-      default:
-        return MAKE_ERROR(ERR_INVALID_PARAM)
-               << "Unsupported register data type "
-               << static_cast<int>(data_type) << " for register in table "
-               << table_id;
-    }
-  }
+::util::Status BfSdeWrapper::ReadRegisterRanges(
+    int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    uint32 table_id, const std::vector<IndexRange>& index_ranges,
+    std::vector<uint32>* register_indices, std::vector<uint64>* register_datas,
+    absl::Duration timeout) {
+  RET_CHECK(register_indices);
+  RET_CHECK(register_datas);
+  ::absl::ReaderMutexLock l(&data_lock_);
+  auto real_session = std::dynamic_pointer_cast<Session>(session);
+  RET_CHECK(real_session);
 
-  CHECK_EQ(register_indices->size(), keys.size());
-  CHECK_EQ(register_datas->size(), keys.size());
+  // One sync covers all ranges.
+  RETURN_IF_ERROR(SynchronizeRegisters(device, session, table_id, timeout));
 
-  return ::util::OkStatus();
+  auto bf_dev_tgt = GetDeviceTarget(device);
+  const bfrt::BfRtTable* table;
+  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
+  std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
+  std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
+  RETURN_IF_ERROR(GetIndexRangeEntries(real_session->bfrt_session_,
+                                       bf_dev_tgt, *metadata, kRegisterIndex,
+                                       index_ranges, &keys, &datums));
+
+  return ParseRegisterEntries(*metadata, keys, datums, register_indices,
+                              register_datas);
 }
 
 ::util::Status BfSdeWrapper::WriteIndirectMeter(
@@ -2962,6 +3178,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -2970,19 +3187,21 @@ namespace {
 
   // Meter data: $METER_SPEC_*
   if (in_pps) {
-    RETURN_IF_ERROR(SetField(table_data.get(), kMeterCirPps, cir));
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMeterCirPps, cir));
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(),
+                             kMeterCommitedBurstPackets, cburst));
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMeterPirPps, pir));
     RETURN_IF_ERROR(
-        SetField(table_data.get(), kMeterCommitedBurstPackets, cburst));
-    RETURN_IF_ERROR(SetField(table_data.get(), kMeterPirPps, pir));
-    RETURN_IF_ERROR(SetField(table_data.get(), kMeterPeakBurstPackets, pburst));
+        SetField(*metadata, table_data.get(), kMeterPeakBurstPackets, pburst));
   } else {
-    RETURN_IF_ERROR(
-        SetField(table_data.get(), kMeterCirKbps, BytesPerSecondToKbits(cir)));
-    RETURN_IF_ERROR(SetField(table_data.get(), kMeterCommitedBurstKbits,
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMeterCirKbps,
+                             BytesPerSecondToKbits(cir)));
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(),
+                             kMeterCommitedBurstKbits,
                              BytesPerSecondToKbits(cburst)));
-    RETURN_IF_ERROR(
-        SetField(table_data.get(), kMeterPirKbps, BytesPerSecondToKbits(pir)));
-    RETURN_IF_ERROR(SetField(table_data.get(), kMeterPeakBurstKbits,
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMeterPirKbps,
+                             BytesPerSecondToKbits(pir)));
+    RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kMeterPeakBurstKbits,
                              BytesPerSecondToKbits(pburst)));
   }
 
@@ -2991,7 +3210,7 @@ namespace {
     // Single index target.
     // Meter key: $METER_INDEX
     RETURN_IF_ERROR(
-        SetField(table_key.get(), kMeterIndex, meter_index.value()));
+        SetField(*metadata, table_key.get(), kMeterIndex, meter_index.value()));
     RETURN_IF_BFRT_ERROR(table->tableEntryMod(
         *real_session->bfrt_session_, bf_dev_tgt, *table_key, *table_data));
   } else {
@@ -3001,7 +3220,7 @@ namespace {
                                              bf_dev_tgt, &table_size));
     for (size_t i = 0; i < table_size; ++i) {
       // Meter key: $METER_INDEX
-      RETURN_IF_ERROR(SetField(table_key.get(), kMeterIndex, i));
+      RETURN_IF_ERROR(SetField(*metadata, table_key.get(), kMeterIndex, i));
       RETURN_IF_BFRT_ERROR(table->tableEntryMod(
           *real_session->bfrt_session_, bf_dev_tgt, *table_key, *table_data));
     }
@@ -3010,6 +3229,89 @@ namespace {
   return ::util::OkStatus();
 }
 
+namespace {
+// Returns the indices and configurations of the given meter entries.
+::util::Status ParseMeterEntries(
+    const BfRtTableMetadata& metadata,
+    const std::vector<std::unique_ptr<bfrt::BfRtTableKey>>& keys,
+    const std::vector<std::unique_ptr<bfrt::BfRtTableData>>& datums,
+    std::vector<uint32>* meter_indices, std::vector<uint64>* cirs,
+    std::vector<uint64>* cbursts, std::vector<uint64>* pirs,
+    std::vector<uint64>* pbursts, std::vector<bool>* in_pps) {
+  // The field IDs are the same for all entries, look them up only once.
+  ASSIGN_OR_RETURN(const auto* index_field, metadata.GetKeyField(kMeterIndex));
+  // Data: $METER_SPEC_*
+  const auto* cir_kbps = metadata.FindDataField(0, kMeterCirKbps);
+  const auto* cburst_kbits =
+      metadata.FindDataField(0, kMeterCommitedBurstKbits);
+  const auto* pir_kbps = metadata.FindDataField(0, kMeterPirKbps);
+  const auto* pburst_kbits = metadata.FindDataField(0, kMeterPeakBurstKbits);
+  const auto* cir_pps = metadata.FindDataField(0, kMeterCirPps);
+  const auto* cburst_packets =
+      metadata.FindDataField(0, kMeterCommitedBurstPackets);
+  const auto* pir_pps = metadata.FindDataField(0, kMeterPirPps);
+  const auto* pburst_packets =
+      metadata.FindDataField(0, kMeterPeakBurstPackets);
+  const bool is_pps = cir_pps && cburst_packets && pir_pps && pburst_packets;
+  const bool is_kbps = cir_kbps && cburst_kbits && pir_kbps && pburst_kbits;
+  if (is_pps == is_kbps) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Meter with id " << metadata.table_id()
+           << " has unexpected data fields.";
+  }
+  const auto* cir_field = is_pps ? cir_pps : cir_kbps;
+  const auto* cburst_field = is_pps ? cburst_packets : cburst_kbits;
+  const auto* pir_field = is_pps ? pir_pps : pir_kbps;
+  const auto* pburst_field = is_pps ? pburst_packets : pburst_kbits;
+
+  meter_indices->resize(0);
+  cirs->resize(0);
+  cbursts->resize(0);
+  pirs->resize(0);
+  pbursts->resize(0);
+  in_pps->resize(0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
+    const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
+    // Key: $METER_INDEX
+    uint64 bf_meter_index;
+    RETURN_IF_BFRT_ERROR(
+        table_key->getValue(index_field->id, &bf_meter_index));
+    meter_indices->push_back(bf_meter_index);
+
+    uint64 cir;
+    uint64 cburst;
+    uint64 pir;
+    uint64 pburst;
+    RETURN_IF_BFRT_ERROR(table_data->getValue(cir_field->id, &cir));
+    RETURN_IF_BFRT_ERROR(table_data->getValue(cburst_field->id, &cburst));
+    RETURN_IF_BFRT_ERROR(table_data->getValue(pir_field->id, &pir));
+    RETURN_IF_BFRT_ERROR(table_data->getValue(pburst_field->id, &pburst));
+    if (is_pps) {  // Packets
+      cirs->push_back(cir);
+      cbursts->push_back(cburst);
+      pirs->push_back(pir);
+      pbursts->push_back(pburst);
+    } else {  // kbits
+      cirs->push_back(KbitsToBytesPerSecond(cir));
+      cbursts->push_back(KbitsToBytesPerSecond(cburst));
+      pirs->push_back(KbitsToBytesPerSecond(pir));
+      pbursts->push_back(KbitsToBytesPerSecond(pburst));
+    }
+    in_pps->push_back(is_pps);
+  }
+
+  CHECK_EQ(meter_indices->size(), keys.size());
+  CHECK_EQ(cirs->size(), keys.size());
+  CHECK_EQ(cbursts->size(), keys.size());
+  CHECK_EQ(pirs->size(), keys.size());
+  CHECK_EQ(pbursts->size(), keys.size());
+  CHECK_EQ(in_pps->size(), keys.size());
+
+  return ::util::OkStatus();
+}
+}  // namespace
+
 ::util::Status BfSdeWrapper::ReadIndirectMeters(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
     uint32 table_id, absl::optional<uint32> meter_index,
@@ -3028,6 +3330,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
 
@@ -3039,7 +3342,8 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&datums[0]));
 
     // Key: $METER_INDEX
-    RETURN_IF_ERROR(SetField(keys[0].get(), kMeterIndex, meter_index.value()));
+    RETURN_IF_ERROR(
+        SetField(*metadata, keys[0].get(), kMeterIndex, meter_index.value()));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -3048,76 +3352,38 @@ namespace {
                                   table, &keys, &datums));
   }
 
-  meter_indices->resize(0);
-  cirs->resize(0);
-  cbursts->resize(0);
-  pirs->resize(0);
-  pbursts->resize(0);
-  in_pps->resize(0);
-  for (size_t i = 0; i < keys.size(); ++i) {
-    const std::unique_ptr<bfrt::BfRtTableData>& table_data = datums[i];
-    const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
-    // Key: $METER_INDEX
-    uint64 bf_meter_index;
-    RETURN_IF_ERROR(GetField(*table_key, kMeterIndex, &bf_meter_index));
-    meter_indices->push_back(bf_meter_index);
+  return ParseMeterEntries(*metadata, keys, datums, meter_indices, cirs,
+                           cbursts, pirs, pbursts, in_pps);
+}
 
-    // Data: $METER_SPEC_*
-    std::vector<bf_rt_id_t> data_field_ids;
-    RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(&data_field_ids));
-    for (const auto& field_id : data_field_ids) {
-      std::string field_name;
-      RETURN_IF_BFRT_ERROR(table->dataFieldNameGet(field_id, &field_name));
-      if (field_name == kMeterCirKbps) {  // kbits
-        uint64 cir;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &cir));
-        cirs->push_back(KbitsToBytesPerSecond(cir));
-        in_pps->push_back(false);
-      } else if (field_name == kMeterCommitedBurstKbits) {
-        uint64 cburst;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &cburst));
-        cbursts->push_back(KbitsToBytesPerSecond(cburst));
-      } else if (field_name == kMeterPirKbps) {
-        uint64 pir;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &pir));
-        pirs->push_back(KbitsToBytesPerSecond(pir));
-      } else if (field_name == kMeterPeakBurstKbits) {
-        uint64 pburst;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &pburst));
-        pbursts->push_back(KbitsToBytesPerSecond(pburst));
-      } else if (field_name == kMeterCirPps) {  // Packets
-        uint64 cir;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &cir));
-        cirs->push_back(cir);
-        in_pps->push_back(true);
-      } else if (field_name == kMeterCommitedBurstPackets) {
-        uint64 cburst;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &cburst));
-        cbursts->push_back(cburst);
-      } else if (field_name == kMeterPirPps) {
-        uint64 pir;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &pir));
-        pirs->push_back(pir);
-      } else if (field_name == kMeterPeakBurstPackets) {
-        uint64 pburst;
-        RETURN_IF_BFRT_ERROR(table_data->getValue(field_id, &pburst));
-        pbursts->push_back(pburst);
-      } else {
-        return MAKE_ERROR(ERR_INVALID_PARAM)
-               << "Unknown meter field " << field_name << " in meter with id "
-               << table_id << ".";
-      }
-    }
-  }
+::util::Status BfSdeWrapper::ReadIndirectMeterRanges(
+    int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    uint32 table_id, const std::vector<IndexRange>& index_ranges,
+    std::vector<uint32>* meter_indices, std::vector<uint64>* cirs,
+    std::vector<uint64>* cbursts, std::vector<uint64>* pirs,
+    std::vector<uint64>* pbursts, std::vector<bool>* in_pps) {
+  RET_CHECK(meter_indices);
+  RET_CHECK(cirs);
+  RET_CHECK(cbursts);
+  RET_CHECK(pirs);
+  RET_CHECK(pbursts);
+  RET_CHECK(in_pps);
+  ::absl::ReaderMutexLock l(&data_lock_);
+  auto real_session = std::dynamic_pointer_cast<Session>(session);
+  RET_CHECK(real_session);
 
-  CHECK_EQ(meter_indices->size(), keys.size());
-  CHECK_EQ(cirs->size(), keys.size());
-  CHECK_EQ(cbursts->size(), keys.size());
-  CHECK_EQ(pirs->size(), keys.size());
-  CHECK_EQ(pbursts->size(), keys.size());
-  CHECK_EQ(in_pps->size(), keys.size());
+  auto bf_dev_tgt = GetDeviceTarget(device);
+  const bfrt::BfRtTable* table;
+  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
+  std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
+  std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
+  RETURN_IF_ERROR(GetIndexRangeEntries(real_session->bfrt_session_,
+                                       bf_dev_tgt, *metadata, kMeterIndex,
+                                       index_ranges, &keys, &datums));
 
-  return ::util::OkStatus();
+  return ParseMeterEntries(*metadata, keys, datums, meter_indices, cirs,
+                           cbursts, pirs, pbursts, in_pps);
 }
 
 ::util::Status BfSdeWrapper::WriteActionProfileMember(
@@ -3131,6 +3397,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
@@ -3145,7 +3412,8 @@ namespace {
   };
 
   // Key: $ACTION_MEMBER_ID
-  RETURN_IF_ERROR(SetField(table_key.get(), kActionMemberId, member_id));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_key.get(), kActionMemberId, member_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   if (insert) {
@@ -3188,6 +3456,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
@@ -3200,7 +3469,8 @@ namespace {
   };
 
   // Key: $ACTION_MEMBER_ID
-  RETURN_IF_ERROR(SetField(table_key.get(), kActionMemberId, member_id));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_key.get(), kActionMemberId, member_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryDel(*real_session->bfrt_session_,
@@ -3223,6 +3493,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
   // Is this a wildcard read?
@@ -3232,7 +3503,8 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->keyAllocate(&keys[0]));
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&datums[0]));
     // Key: $ACTION_MEMBER_ID
-    RETURN_IF_ERROR(SetField(keys[0].get(), kActionMemberId, member_id));
+    RETURN_IF_ERROR(
+        SetField(*metadata, keys[0].get(), kActionMemberId, member_id));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -3246,11 +3518,11 @@ namespace {
   for (size_t i = 0; i < keys.size(); ++i) {
     // Key: $sid
     uint64 member_id;
-    RETURN_IF_ERROR(GetField(*keys[i], kActionMemberId, &member_id));
+    RETURN_IF_ERROR(GetField(*metadata, *keys[i], kActionMemberId, &member_id));
     member_ids->push_back(member_id);
 
     // Data: action params
-    auto td = absl::make_unique<TableData>(std::move(datums[i]));
+    auto td = absl::make_unique<TableData>(std::move(datums[i]), metadata);
     table_datas->push_back(std::move(td));
   }
 
@@ -3270,6 +3542,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -3287,15 +3560,17 @@ namespace {
   };
 
   // Key: $SELECTOR_GROUP_ID
-  RETURN_IF_ERROR(SetField(table_key.get(), kSelectorGroupId, group_id));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_key.get(), kSelectorGroupId, group_id));
   // Data: $ACTION_MEMBER_ID
-  RETURN_IF_ERROR(SetField(table_data.get(), kActionMemberId, member_ids));
-  // Data: $ACTION_MEMBER_STATUS
   RETURN_IF_ERROR(
-      SetField(table_data.get(), kActionMemberStatus, member_status));
+      SetField(*metadata, table_data.get(), kActionMemberId, member_ids));
+  // Data: $ACTION_MEMBER_STATUS
+  RETURN_IF_ERROR(SetField(*metadata, table_data.get(), kActionMemberStatus,
+                           member_status));
   // Data: $MAX_GROUP_SIZE
   RETURN_IF_ERROR(
-      SetField(table_data.get(), "$MAX_GROUP_SIZE", max_group_size));
+      SetField(*metadata, table_data.get(), "$MAX_GROUP_SIZE", max_group_size));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   if (insert) {
@@ -3342,6 +3617,7 @@ namespace {
 
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
 
@@ -3353,7 +3629,8 @@ namespace {
   };
 
   // Key: $SELECTOR_GROUP_ID
-  RETURN_IF_ERROR(SetField(table_key.get(), kSelectorGroupId, group_id));
+  RETURN_IF_ERROR(
+      SetField(*metadata, table_key.get(), kSelectorGroupId, group_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryDel(*real_session->bfrt_session_,
@@ -3380,6 +3657,7 @@ namespace {
   auto bf_dev_tgt = GetDeviceTarget(device);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
   // Is this a wildcard read?
@@ -3389,7 +3667,8 @@ namespace {
     RETURN_IF_BFRT_ERROR(table->keyAllocate(&keys[0]));
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&datums[0]));
     // Key: $SELECTOR_GROUP_ID
-    RETURN_IF_ERROR(SetField(keys[0].get(), kSelectorGroupId, group_id));
+    RETURN_IF_ERROR(
+        SetField(*metadata, keys[0].get(), kSelectorGroupId, group_id));
     RETURN_IF_BFRT_ERROR(table->tableEntryGet(
         *real_session->bfrt_session_, bf_dev_tgt, *keys[0],
         bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, datums[0].get()));
@@ -3407,23 +3686,26 @@ namespace {
     const std::unique_ptr<bfrt::BfRtTableKey>& table_key = keys[i];
     // Key: $SELECTOR_GROUP_ID
     uint64 group_id;
-    RETURN_IF_ERROR(GetField(*table_key, kSelectorGroupId, &group_id));
+    RETURN_IF_ERROR(
+        GetField(*metadata, *table_key, kSelectorGroupId, &group_id));
     group_ids->push_back(group_id);
 
     // Data: $MAX_GROUP_SIZE
     uint64 max_group_size;
-    RETURN_IF_ERROR(GetField(*table_data, "$MAX_GROUP_SIZE", &max_group_size));
+    RETURN_IF_ERROR(
+        GetField(*metadata, *table_data, "$MAX_GROUP_SIZE", &max_group_size));
     max_group_sizes->push_back(max_group_size);
 
     // Data: $ACTION_MEMBER_ID
     std::vector<uint32> members;
-    RETURN_IF_ERROR(GetField(*table_data, kActionMemberId, &members));
+    RETURN_IF_ERROR(
+        GetField(*metadata, *table_data, kActionMemberId, &members));
     member_ids->push_back(members);
 
     // Data: $ACTION_MEMBER_STATUS
     std::vector<bool> member_enabled;
     RETURN_IF_ERROR(
-        GetField(*table_data, kActionMemberStatus, &member_enabled));
+        GetField(*metadata, *table_data, kActionMemberStatus, &member_enabled));
     member_status->push_back(member_enabled);
   }
 
@@ -3551,33 +3833,99 @@ namespace {
   return ::util::OkStatus();
 }
 
-::util::Status BfSdeWrapper::GetAllTableEntries(
+::util::Status BfSdeWrapper::GetNextTableEntries(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
-    uint32 table_id,
+    uint32 table_id, const TableKeyInterface* cursor, int max_entries,
     std::vector<std::unique_ptr<TableKeyInterface>>* table_keys,
     std::vector<std::unique_ptr<TableDataInterface>>* table_datas) {
+  RET_CHECK(table_keys) << "table_keys is null";
+  RET_CHECK(table_datas) << "table_datas is null";
+  RET_CHECK(max_entries > 0) << "Invalid number of entries " << max_entries;
   ::absl::ReaderMutexLock l(&data_lock_);
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   RET_CHECK(real_session);
   const bfrt::BfRtTable* table;
   RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(auto metadata, GetTableMetadata(table));
   auto bf_dev_tgt = GetDeviceTarget(device);
 
-  std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
-  std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
-  RETURN_IF_ERROR(GetAllEntries(real_session->bfrt_session_, bf_dev_tgt, table,
-                                &keys, &datums));
-
   table_keys->resize(0);
   table_datas->resize(0);
 
-  for (size_t i = 0; i < keys.size(); ++i) {
-    auto tk = absl::make_unique<TableKey>(std::move(keys[i]));
-    auto td = absl::make_unique<TableData>(std::move(datums[i]));
-    table_keys->push_back(std::move(tk));
-    table_datas->push_back(std::move(td));
+  std::unique_ptr<bfrt::BfRtTableKey> first_key;
+  const bfrt::BfRtTableKey* start_key = nullptr;
+  if (cursor == nullptr) {
+    // Start of iteration, the first entry has to be fetched individually. An
+    // empty table has no first entry.
+    std::unique_ptr<bfrt::BfRtTableData> first_data;
+    RETURN_IF_BFRT_ERROR(table->keyAllocate(&first_key));
+    RETURN_IF_BFRT_ERROR(table->dataAllocate(&first_data));
+    bf_status_t status = table->tableEntryGetFirst(
+        *real_session->bfrt_session_, bf_dev_tgt,
+        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, first_key.get(),
+        first_data.get());
+    if (status == BF_OBJECT_NOT_FOUND) return ::util::OkStatus();
+    RETURN_IF_BFRT_ERROR(status);
+    start_key = first_key.get();
+    table_datas->push_back(
+        absl::make_unique<TableData>(std::move(first_data), metadata));
+    --max_entries;
+  } else {
+    auto real_cursor = dynamic_cast<const TableKey*>(cursor);
+    RET_CHECK(real_cursor);
+    start_key = real_cursor->table_key_.get();
   }
 
+  if (max_entries > 0) {
+    std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys(max_entries);
+    std::vector<std::unique_ptr<bfrt::BfRtTableData>> data(keys.size());
+    bfrt::BfRtTable::keyDataPairs pairs;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      RETURN_IF_BFRT_ERROR(table->keyAllocate(&keys[i]));
+      RETURN_IF_BFRT_ERROR(table->dataAllocate(&data[i]));
+      pairs.push_back(std::make_pair(keys[i].get(), data[i].get()));
+    }
+    uint32 actual = 0;
+    bf_status_t status = table->tableEntryGetNext_n(
+        *real_session->bfrt_session_, bf_dev_tgt, *start_key, pairs.size(),
+        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, &pairs, &actual);
+    if (status == BF_OBJECT_NOT_FOUND) {
+      // Either the cursor was the last entry of the table, or it has been
+      // deleted since the previous page was read. In the latter case the
+      // position in the table is lost, and the read must not be reported as
+      // complete.
+      std::unique_ptr<bfrt::BfRtTableData> cursor_data;
+      RETURN_IF_BFRT_ERROR(table->dataAllocate(&cursor_data));
+      bf_status_t cursor_status = table->tableEntryGet(
+          *real_session->bfrt_session_, bf_dev_tgt, *start_key,
+          bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, cursor_data.get());
+      if (cursor_status == BF_OBJECT_NOT_FOUND) {
+        return MAKE_ERROR(ERR_ABORTED)
+               << "Table " << table_id << " was modified while it was read.";
+      }
+      RETURN_IF_BFRT_ERROR(cursor_status);
+      actual = 0;
+    } else {
+      RETURN_IF_BFRT_ERROR(status);
+    }
+    RET_CHECK(actual <= keys.size());
+
+    if (first_key) {
+      table_keys->push_back(
+          absl::make_unique<TableKey>(std::move(first_key), metadata));
+    }
+    for (size_t i = 0; i < actual; ++i) {
+      table_keys->push_back(
+          absl::make_unique<TableKey>(std::move(keys[i]), metadata));
+      table_datas->push_back(
+          absl::make_unique<TableData>(std::move(data[i]), metadata));
+    }
+  } else if (first_key) {
+    table_keys->push_back(
+        absl::make_unique<TableKey>(std::move(first_key), metadata));
+  }
+  CHECK(table_keys->size() == table_datas->size());
+
   return ::util::OkStatus();
 }
 
@@ -3782,34 +4130,47 @@ namespace {
   // Sync table counter
   std::set<bfrt::TableOperationsType> supported_ops;
   RETURN_IF_BFRT_ERROR(table->tableOperationsSupported(&supported_ops));
-  if (supported_ops.count(bfrt::TableOperationsType::COUNTER_SYNC)) {
-    auto sync_notifier = std::make_shared<absl::Notification>();
-    std::weak_ptr<absl::Notification> weak_ref(sync_notifier);
-    std::unique_ptr<bfrt::BfRtTableOperations> table_op;
-    RETURN_IF_BFRT_ERROR(table->operationsAllocate(
-        bfrt::TableOperationsType::COUNTER_SYNC, &table_op));
-    RETURN_IF_BFRT_ERROR(table_op->counterSyncSet(
-        *real_session->bfrt_session_, bf_dev_tgt,
-        [table_id, weak_ref](const bf_rt_target_t& dev_tgt, void* cookie) {
-          if (auto notifier = weak_ref.lock()) {
-            VLOG(1) << "Table counter for table " << table_id << " synced.";
-            notifier->Notify();
-          } else {
-            VLOG(1) << "Notifier expired before table " << table_id
-                    << " could be synced.";
-          }
-        },
-        nullptr));
-    RETURN_IF_BFRT_ERROR(table->tableOperationsExecute(*table_op.get()));
-    // Wait until sync done or timeout.
-    if (!sync_notifier->WaitForNotificationWithTimeout(timeout)) {
-      return MAKE_ERROR(ERR_OPER_TIMEOUT)
-             << "Timeout while syncing (indirect) table counters of table "
-             << table_id << ".";
-    }
+  if (!supported_ops.count(bfrt::TableOperationsType::COUNTER_SYNC)) {
+    return ::util::OkStatus();
   }
 
-  return ::util::OkStatus();
+  // Concurrent requests for the same table share a single sync.
+  return counter_sync_coordinator_.Synchronize(
+      device, table_id, timeout,
+      absl::Milliseconds(FLAGS_bfrt_counter_sync_max_staleness_ms),
+      [table, table_id, real_session,
+       bf_dev_tgt](absl::Duration sync_timeout) -> ::util::Status {
+        auto sync_notifier = std::make_shared<absl::Notification>();
+        std::weak_ptr<absl::Notification> weak_ref(sync_notifier);
+        std::unique_ptr<bfrt::BfRtTableOperations> table_op;
+        RETURN_IF_BFRT_ERROR(table->operationsAllocate(
+            bfrt::TableOperationsType::COUNTER_SYNC, &table_op));
+        RETURN_IF_BFRT_ERROR(table_op->counterSyncSet(
+            *real_session->bfrt_session_, bf_dev_tgt,
+            [table_id, weak_ref](const bf_rt_target_t& dev_tgt, void* cookie) {
+              if (auto notifier = weak_ref.lock()) {
+                VLOG(1) << "Table counter for table " << table_id
+                        << " synced.";
+                notifier->Notify();
+              } else {
+                VLOG(1) << "Notifier expired before table " << table_id
+                        << " could be synced.";
+              }
+            },
+            nullptr));
+        RETURN_IF_BFRT_ERROR(table->tableOperationsExecute(*table_op.get()));
+        // Wait until sync done or timeout.
+        if (!sync_notifier->WaitForNotificationWithTimeout(sync_timeout)) {
+          return MAKE_ERROR(ERR_OPER_TIMEOUT)
+                 << "Timeout while syncing (indirect) table counters of table "
+                 << table_id << ".";
+        }
+        return ::util::OkStatus();
+      });
+}
+
+BfrtCounterSyncStats BfSdeWrapper::GetCounterSyncStats(int device) const {
+  return counter_sync_coordinator_.GetStats(device);
 }
 
 ::util::Status BfSdeWrapper::SynchronizeRegisters(
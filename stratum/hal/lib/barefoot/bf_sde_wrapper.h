@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "bf_rt/bf_rt_init.hpp"
 #include "bf_rt/bf_rt_learn.hpp"
@@ -21,7 +22,10 @@
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
+#include "stratum/hal/lib/barefoot/bfrt_counter_sync_coordinator.h"
 #include "stratum/hal/lib/barefoot/bfrt_id_mapper.h"
+#include "stratum/hal/lib/barefoot/bfrt_packet_tx_pool.h"
+#include "stratum/hal/lib/barefoot/bfrt_table_field_index.h"
 #include "stratum/hal/lib/barefoot/macros.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/lib/channel/channel.h"
@@ -34,10 +38,99 @@ namespace stratum {
 namespace hal {
 namespace barefoot {
 
+// BfRtTableMetadata holds the bf_rt IDs, data types and sizes of the key
+// fields, data fields and actions of a table. The SDE resolves field and
+// action names with string lookups, which adds up when reading large tables
+// entry by entry, so they are resolved once when the pipeline is pushed.
+class BfRtTableMetadata {
+ public:
+  struct FieldInfo {
+    bf_rt_id_t id;
+    bfrt::DataType data_type;
+    size_t size_bits;
+  };
+
+  // Resolves the metadata of the given table.
+  static ::util::StatusOr<std::shared_ptr<const BfRtTableMetadata>>
+  CreateFromTable(const bfrt::BfRtTable* table);
+
+  // Returns the key field with the given name or ID, or nullptr if the table
+  // has no such key field.
+  const FieldInfo* FindKeyField(absl::string_view name) const {
+    return fields_.FindKeyField(name);
+  }
+  const FieldInfo* FindKeyField(bf_rt_id_t id) const {
+    return fields_.FindKeyField(id);
+  }
+
+  // Returns the data field with the given name or ID of the given action, or
+  // nullptr if there is no such data field. Fields common to all actions are
+  // found with any action ID. Tables without actions use action ID 0.
+  const FieldInfo* FindDataField(bf_rt_id_t action_id,
+                                 absl::string_view name) const {
+    return fields_.FindDataField(action_id, name);
+  }
+  const FieldInfo* FindDataField(bf_rt_id_t action_id, bf_rt_id_t id) const {
+    return fields_.FindDataField(action_id, id);
+  }
+
+  // Same as the Find*() functions above, but return an error if the field
+  // does not exist.
+  ::util::StatusOr<const FieldInfo*> GetKeyField(absl::string_view name) const {
+    return fields_.GetKeyField(name);
+  }
+  ::util::StatusOr<const FieldInfo*> GetKeyField(bf_rt_id_t id) const {
+    return fields_.GetKeyField(id);
+  }
+  ::util::StatusOr<const FieldInfo*> GetDataField(
+      bf_rt_id_t action_id, absl::string_view name) const {
+    return fields_.GetDataField(action_id, name);
+  }
+  ::util::StatusOr<const FieldInfo*> GetDataField(bf_rt_id_t action_id,
+                                                  bf_rt_id_t id) const {
+    return fields_.GetDataField(action_id, id);
+  }
+
+  // Returns the ID of the action with the given name.
+  ::util::StatusOr<bf_rt_id_t> GetActionId(absl::string_view name) const {
+    return fields_.GetActionId(name);
+  }
+
+  // Returns the data field holding the register value, i.e. the
+  // "<register>.f1" field. Returns nullptr for non-register tables.
+  const FieldInfo* register_data_field() const {
+    return has_register_data_field_ ? &register_data_field_ : nullptr;
+  }
+
+  const bfrt::BfRtTable* table() const { return table_; }
+  bf_rt_id_t table_id() const { return fields_.table_id(); }
+  bool action_id_applicable() const { return action_id_applicable_; }
+
+  // BfRtTableMetadata is neither copyable nor movable.
+  BfRtTableMetadata(const BfRtTableMetadata&) = delete;
+  BfRtTableMetadata& operator=(const BfRtTableMetadata&) = delete;
+
+ private:
+  // Private constructor, use CreateFromTable().
+  BfRtTableMetadata(const bfrt::BfRtTable* table, bf_rt_id_t table_id);
+
+  // Adds the data fields of the given action, 0 for the fields common to all
+  // actions or of tables without actions.
+  ::util::Status AddDataFields(bf_rt_id_t action_id);
+
+  const bfrt::BfRtTable* table_;
+  bool action_id_applicable_;
+  // The fields and actions of the table, by name and by ID.
+  BfrtTableFieldIndex<FieldInfo> fields_;
+  bool has_register_data_field_;
+  FieldInfo register_data_field_;
+};
+
 class TableKey : public BfSdeInterface::TableKeyInterface {
  public:
-  explicit TableKey(std::unique_ptr<bfrt::BfRtTableKey> table_key)
-      : table_key_(std::move(table_key)) {}
+  TableKey(std::unique_ptr<bfrt::BfRtTableKey> table_key,
+           std::shared_ptr<const BfRtTableMetadata> metadata)
+      : table_key_(std::move(table_key)), metadata_(std::move(metadata)) {}
 
   // TableKeyInterface public methods.
   ::util::Status SetExact(int id, const std::string& value) override;
@@ -58,21 +151,25 @@ class TableKey : public BfSdeInterface::TableKeyInterface {
   ::util::Status GetPriority(uint32* priority) const override;
   ::util::Status GetTableId(uint32* table_id) const override;
 
-  // Allocates a new table key object.
+  // Allocates a new table key object for the table of the given metadata.
   static ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>
-  CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id);
+  CreateTableKey(std::shared_ptr<const BfRtTableMetadata> metadata);
 
   // Stores the underlying SDE object.
   std::unique_ptr<bfrt::BfRtTableKey> table_key_;
 
+  // The metadata of the table of this key.
+  std::shared_ptr<const BfRtTableMetadata> metadata_;
+
  private:
   TableKey() {}
 };
 
 class TableData : public BfSdeInterface::TableDataInterface {
  public:
-  explicit TableData(std::unique_ptr<bfrt::BfRtTableData> table_data)
-      : table_data_(std::move(table_data)) {}
+  TableData(std::unique_ptr<bfrt::BfRtTableData> table_data,
+            std::shared_ptr<const BfRtTableMetadata> metadata)
+      : table_data_(std::move(table_data)), metadata_(std::move(metadata)) {}
 
   // TableDataInterface public methods.
   ::util::Status SetParam(int id, const std::string& value) override;
@@ -86,16 +183,22 @@ class TableData : public BfSdeInterface::TableDataInterface {
   ::util::Status GetActionId(int* action_id) const override;
   ::util::Status Reset(int action_id) override;
 
-  // Allocates a new table data object.
+  // Allocates a new table data object for the table of the given metadata.
   static ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>
-  CreateTableData(const bfrt::BfRtInfo* bfrt_info_, int table_id,
+  CreateTableData(std::shared_ptr<const BfRtTableMetadata> metadata,
                   int action_id);
 
   // Stores the underlying SDE object.
   std::unique_ptr<bfrt::BfRtTableData> table_data_;
 
+  // The metadata of the table of this data.
+  std::shared_ptr<const BfRtTableMetadata> metadata_;
+
  private:
   TableData() {}
+
+  // Returns the action ID of this data, or 0 if the table has no actions.
+  ::util::StatusOr<bf_rt_id_t> GetBfRtActionId() const;
 };
 
 // The "BfSdeWrapper" is an implementation of BfSdeInterface which is used
@@ -192,7 +295,8 @@ class BfSdeWrapper : public BfSdeInterface {
   ::util::Status StartPacketIo(int device) override;
   ::util::Status StopPacketIo(int device) override;
   ::util::Status RegisterPacketReceiveWriter(
-      int device, std::unique_ptr<ChannelWriter<std::string>> writer) override;
+      int device, std::unique_ptr<ChannelWriter<std::string>> writer,
+      std::shared_ptr<PacketRxBufferPool> buffer_pool) override;
   ::util::Status UnregisterPacketReceiveWriter(int device) override;
   ::util::Status RegisterDigestListWriter(
       int device, std::unique_ptr<ChannelWriter<DigestList>> writer) override
@@ -257,6 +361,13 @@ class BfSdeWrapper : public BfSdeInterface {
       std::vector<absl::optional<uint64>>* byte_counts,
       std::vector<absl::optional<uint64>>* packet_counts,
       absl::Duration timeout) override LOCKS_EXCLUDED(data_lock_);
+  ::util::Status ReadIndirectCounterRanges(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      uint32 counter_id, const std::vector<IndexRange>& index_ranges,
+      std::vector<uint32>* counter_indices,
+      std::vector<absl::optional<uint64>>* byte_counts,
+      std::vector<absl::optional<uint64>>* packet_counts,
+      absl::Duration timeout) override LOCKS_EXCLUDED(data_lock_);
   ::util::Status WriteRegister(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::optional<uint32> register_index,
@@ -267,6 +378,12 @@ class BfSdeWrapper : public BfSdeInterface {
       std::vector<uint32>* register_indices,
       std::vector<uint64>* register_datas, absl::Duration timeout) override
       LOCKS_EXCLUDED(data_lock_);
+  ::util::Status ReadRegisterRanges(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      uint32 table_id, const std::vector<IndexRange>& index_ranges,
+      std::vector<uint32>* register_indices,
+      std::vector<uint64>* register_datas, absl::Duration timeout) override
+      LOCKS_EXCLUDED(data_lock_);
   ::util::Status WriteIndirectMeter(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::optional<uint32> meter_index, bool in_pps,
@@ -279,6 +396,13 @@ class BfSdeWrapper : public BfSdeInterface {
       std::vector<uint64>* cbursts, std::vector<uint64>* pirs,
       std::vector<uint64>* pbursts, std::vector<bool>* in_pps) override
       LOCKS_EXCLUDED(data_lock_);
+  ::util::Status ReadIndirectMeterRanges(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      uint32 table_id, const std::vector<IndexRange>& index_ranges,
+      std::vector<uint32>* meter_indices, std::vector<uint64>* cirs,
+      std::vector<uint64>* cbursts, std::vector<uint64>* pirs,
+      std::vector<uint64>* pbursts, std::vector<bool>* in_pps) override
+      LOCKS_EXCLUDED(data_lock_);
   ::util::Status InsertActionProfileMember(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, int member_id,
@@ -321,6 +445,7 @@ class BfSdeWrapper : public BfSdeInterface {
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout) override
       LOCKS_EXCLUDED(data_lock_);
+  BfrtCounterSyncStats GetCounterSyncStats(int device) const override;
   ::util::Status InsertTableEntry(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, const TableKeyInterface* table_key,
@@ -337,9 +462,9 @@ class BfSdeWrapper : public BfSdeInterface {
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, const TableKeyInterface* table_key,
       TableDataInterface* table_data) override LOCKS_EXCLUDED(data_lock_);
-  ::util::Status GetAllTableEntries(
+  ::util::Status GetNextTableEntries(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
-      uint32 table_id,
+      uint32 table_id, const TableKeyInterface* cursor, int max_entries,
       std::vector<std::unique_ptr<TableKeyInterface>>* table_keys,
       std::vector<std::unique_ptr<TableDataInterface>>* table_datas) override
       LOCKS_EXCLUDED(data_lock_);
@@ -400,6 +525,12 @@ class BfSdeWrapper : public BfSdeInterface {
                                 bf_pkt_rx_ring_t rx_ring)
       LOCKS_EXCLUDED(packet_rx_callback_lock_);
 
+  // Puts a transmitted packet back into the TX buffer pool of the device, or
+  // frees it if it is not part of the pool. Called from the SDE callback
+  // function.
+  void HandlePacketTxDone(bf_dev_id_t device, bf_pkt* pkt)
+      LOCKS_EXCLUDED(packet_tx_pool_lock_);
+
   // Writes a received digest list to the registered writer. Called from the SDE
   // callback function.
   ::util::Status HandleDigestList(
@@ -444,6 +575,9 @@ class BfSdeWrapper : public BfSdeInterface {
   // Mutex protecting the packet rx writer map.
   mutable absl::Mutex packet_rx_callback_lock_;
 
+  // Mutex protecting the packet tx buffer pools.
+  mutable absl::Mutex packet_tx_pool_lock_;
+
   // Mutex protecting the digest list writer map.
   mutable absl::Mutex digest_list_callback_lock_;
 
@@ -467,6 +601,15 @@ class BfSdeWrapper : public BfSdeInterface {
       std::vector<std::unique_ptr<bfrt::BfRtLearnData>> learn_data,
       bf_rt_learn_msg_hdl* const learn_msg_hdl, const void* cookie);
 
+  // Allocates the packet TX buffer pool of a device, replacing any previous
+  // pool. Must be called after the bf_pkt driver has been (re)initialized.
+  ::util::Status AllocatePacketTxPool(int device)
+      LOCKS_EXCLUDED(packet_tx_pool_lock_);
+
+  // Frees the buffers of the packet TX buffer pool of a device which are not
+  // in flight and removes the pool.
+  void FreePacketTxPool(int device) LOCKS_EXCLUDED(packet_tx_pool_lock_);
+
   // Common code for multicast group handling.
   ::util::Status WriteMulticastGroup(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
@@ -499,6 +642,10 @@ class BfSdeWrapper : public BfSdeInterface {
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session)
       SHARED_LOCKS_REQUIRED(data_lock_);
 
+  // Returns the metadata of the given table.
+  ::util::StatusOr<std::shared_ptr<const BfRtTableMetadata>> GetTableMetadata(
+      const bfrt::BfRtTable* table) const SHARED_LOCKS_REQUIRED(data_lock_);
+
   // Helper to dump the entire PRE table state for debugging. Only runs at v=2.
   ::util::Status DumpPreState(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session)
@@ -512,21 +659,38 @@ class BfSdeWrapper : public BfSdeInterface {
       uint32 table_id, absl::Duration timeout)
       SHARED_LOCKS_REQUIRED(data_lock_);
 
-  // Internal version SynchronizeCounters without locks.
+  // Internal version SynchronizeCounters without locks. Concurrent calls for
+  // the same table are merged by counter_sync_coordinator_.
   // TODO(max): consolidate with SynchronizeRegisters
   ::util::Status DoSynchronizeCounters(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout)
       SHARED_LOCKS_REQUIRED(data_lock_);
 
+  // Merges the counter syncs of concurrent reads and keeps their statistics.
+  CounterSyncCoordinator counter_sync_coordinator_;
+
   // Writer to forward the port status change message to. It is registered
   // by chassis manager to receive SDE port status change events.
   std::unique_ptr<ChannelWriter<PortStatusEvent>> port_status_event_writer_
       GUARDED_BY(port_status_event_writer_lock_);
 
+  // The writer and buffer pool registered for the packets received on a device.
+  struct PacketRxWriter {
+    std::unique_ptr<ChannelWriter<std::string>> writer;
+    std::shared_ptr<PacketRxBufferPool> buffer_pool;
+  };
+
   // Map from device ID to packet receive writer.
-  absl::flat_hash_map<int, std::unique_ptr<ChannelWriter<std::string>>>
-      device_to_packet_rx_writer_ GUARDED_BY(packet_rx_callback_lock_);
+  absl::flat_hash_map<int, PacketRxWriter> device_to_packet_rx_writer_
+      GUARDED_BY(packet_rx_callback_lock_);
+
+  // Map from device ID to the pool of DMA packet buffers pre-allocated for
+  // each TX ring in use. TxPacket() takes a free buffer of the next TX ring and
+  // the TX completion callback puts it back, so that packet TX does not
+  // allocate in the steady state.
+  absl::flat_hash_map<int, BfrtPacketTxPool<bf_pkt>> device_to_packet_tx_pool_
+      GUARDED_BY(packet_tx_pool_lock_);
 
   // Map from device ID to digest list receive writer.
   absl::flat_hash_map<int, std::unique_ptr<ChannelWriter<DigestList>>>
@@ -543,6 +707,12 @@ class BfSdeWrapper : public BfSdeInterface {
   // Pointer to the current BfR info object. Not owned by this class.
   const bfrt::BfRtInfo* bfrt_info_ GUARDED_BY(data_lock_);
 
+  // Map from table to the metadata of the table, for all tables of the
+  // current pipeline.
+  absl::flat_hash_map<const bfrt::BfRtTable*,
+                      std::shared_ptr<const BfRtTableMetadata>>
+      table_metadata_ GUARDED_BY(data_lock_);
+
   // Pointer to the bfrt device manager. Not owned by this class.
   bfrt::BfRtDevMgr* bfrt_device_manager_ GUARDED_BY(data_lock_);
 };
@@ -67,6 +67,9 @@ constexpr int kMaxQueuesPerPort = 32;
 
 constexpr absl::Duration kDefaultSyncTimeout = absl::Seconds(1);
 
+// Number of lock shards used to serialize P4Runtime writes per P4 resource.
+constexpr int kNumWriteLockShards = 64;
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
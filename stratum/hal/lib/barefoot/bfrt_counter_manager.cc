@@ -8,6 +8,7 @@
 #include "absl/synchronization/notification.h"
 #include "gflags/gflags.h"
 #include "stratum/hal/lib/barefoot/bfrt_constants.h"
+#include "stratum/hal/lib/barefoot/utils.h"
 
 DECLARE_uint32(bfrt_table_sync_timeout_ms);
 
@@ -136,6 +137,77 @@ BfrtCounterManager::~BfrtCounterManager() = default;
   return ::util::OkStatus();
 }
 
+::util::Status BfrtCounterManager::ReadIndirectCounterEntries(
+    std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const std::vector<::p4::v1::CounterEntry>& counter_entries,
+    WriterInterface<::p4::v1::ReadResponse>* writer) {
+  absl::ReaderMutexLock l(&lock_);
+  RET_CHECK(!counter_entries.empty()) << "No counter entries to read.";
+  std::vector<uint32> requested_indices;
+  requested_indices.reserve(counter_entries.size());
+  ::p4::v1::CounterEntry template_entry;
+  for (const auto& counter_entry : counter_entries) {
+    ASSIGN_OR_RETURN(const auto& translated_counter_entry,
+                     bfrt_p4runtime_translator_->TranslateCounterEntry(
+                         counter_entry, /*to_sdk=*/true));
+    RET_CHECK(translated_counter_entry.counter_id() != 0)
+        << "Querying an indirect counter without counter id is not supported.";
+    RET_CHECK(translated_counter_entry.has_index())
+        << "Only entries with an index can be read together.";
+    RET_CHECK(translated_counter_entry.index().index() >= 0)
+        << "Counter index must be greater than or equal to zero.";
+    if (requested_indices.empty()) {
+      template_entry = translated_counter_entry;
+    } else {
+      RET_CHECK(translated_counter_entry.counter_id() ==
+                template_entry.counter_id())
+          << "Only entries of the same counter can be read together.";
+    }
+    requested_indices.push_back(translated_counter_entry.index().index());
+  }
+
+  // Find counter table
+  ASSIGN_OR_RETURN(uint32 table_id,
+                   bf_sde_interface_->GetBfRtId(template_entry.counter_id()));
+
+  std::vector<uint32> counter_indices;
+  std::vector<absl::optional<uint64>> byte_counts;
+  std::vector<absl::optional<uint64>> packet_counts;
+  RETURN_IF_ERROR(bf_sde_interface_->ReadIndirectCounterRanges(
+      device_, session, table_id, IndicesToRanges(requested_indices),
+      &counter_indices, &byte_counts, &packet_counts,
+      absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
+
+  ::p4::v1::ReadResponse read_resp;
+  template_entry.clear_data();
+  for (size_t i = 0; i < counter_indices.size(); ++i) {
+    const absl::optional<uint64>& byte_count = byte_counts[i];
+    const absl::optional<uint64>& packet_count = packet_counts[i];
+    ::p4::v1::CounterEntry result = template_entry;
+
+    result.mutable_index()->set_index(counter_indices[i]);
+    if (byte_count) {
+      result.mutable_data()->set_byte_count(byte_count.value());
+    }
+    if (packet_count) {
+      result.mutable_data()->set_packet_count(packet_count.value());
+    }
+    ASSIGN_OR_RETURN(*read_resp.add_entities()->mutable_counter_entry(),
+                     bfrt_p4runtime_translator_->TranslateCounterEntry(
+                         result, /*to_sdk=*/false));
+  }
+  ::p4::v1::ReadResponse resp;
+  RETURN_IF_ERROR(OrderEntitiesLikeRequest(requested_indices, counter_indices,
+                                           &read_resp, &resp));
+
+  VLOG(1) << "ReadIndirectCounterEntries resp " << resp.DebugString();
+  if (!writer->Write(resp)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
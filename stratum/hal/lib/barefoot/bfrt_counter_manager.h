@@ -5,6 +5,7 @@
 #define STRATUM_HAL_LIB_BAREFOOT_BFRT_COUNTER_MANAGER_H_
 
 #include <memory>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
@@ -42,6 +43,14 @@ class BfrtCounterManager {
       const ::p4::v1::CounterEntry& counter_entry,
       WriterInterface<::p4::v1::ReadResponse>* writer) LOCKS_EXCLUDED(lock_);
 
+  // Reads a set of indexed entries of the same indirect counter with a single
+  // counter sync and writes them in one response, with one entity per
+  // requested entry in the order of the request.
+  virtual ::util::Status ReadIndirectCounterEntries(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const std::vector<::p4::v1::CounterEntry>& counter_entries,
+      WriterInterface<::p4::v1::ReadResponse>* writer) LOCKS_EXCLUDED(lock_);
+
   // Creates a table manager instance.
   static std::unique_ptr<BfrtCounterManager> CreateInstance(
       BfSdeInterface* bf_sde_interface_,
@@ -0,0 +1,187 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks indirect counter reads of the BfrtCounterManager against the SDE
+// mock. Every SDE read call simulates the latency of a hardware counter sync,
+// which allows comparing reads of one index at a time with batched reads of
+// the same indices.
+
+#include <memory>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/barefoot/bf_sde_mock.h"
+#include "stratum/hal/lib/barefoot/bfrt_counter_manager.h"
+#include "stratum/hal/lib/barefoot/bfrt_p4runtime_translator_mock.h"
+#include "stratum/hal/lib/barefoot/utils.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+constexpr int kDevice = 0;
+constexpr uint32 kP4CounterId = 318814845;
+constexpr uint32 kBfRtCounterId = 20;
+
+// Writer which only records the number of streamed responses and entities.
+class CountingWriter : public WriterInterface<::p4::v1::ReadResponse> {
+ public:
+  bool Write(const ::p4::v1::ReadResponse& msg) override {
+    ++responses_;
+    entities_ += msg.entities_size();
+    return true;
+  }
+
+  int responses_ = 0;
+  int entities_ = 0;
+};
+
+// Holds the mocks and the counter manager under test. Every counter read from
+// the SDE mock takes sync_latency and counts as one SDE call.
+class CounterReadFixture {
+ public:
+  explicit CounterReadFixture(absl::Duration sync_latency)
+      : session_(std::make_shared<NiceMock<SessionMock>>()), sde_calls_(0) {
+    ON_CALL(bf_sde_mock_, GetBfRtId(kP4CounterId))
+        .WillByDefault(Return(kBfRtCounterId));
+    ON_CALL(translator_mock_, TranslateCounterEntry(_, _))
+        .WillByDefault(Invoke([](const ::p4::v1::CounterEntry& entry, bool) {
+          return ::util::StatusOr<::p4::v1::CounterEntry>(entry);
+        }));
+    ON_CALL(bf_sde_mock_,
+            ReadIndirectCounter(kDevice, _, kBfRtCounterId, _, _, _, _, _))
+        .WillByDefault(Invoke(
+            [this, sync_latency](
+                int device,
+                std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                uint32 counter_id, absl::optional<uint32> counter_index,
+                std::vector<uint32>* counter_indices,
+                std::vector<absl::optional<uint64>>* byte_counts,
+                std::vector<absl::optional<uint64>>* packet_counts,
+                absl::Duration timeout) {
+              ++sde_calls_;
+              absl::SleepFor(sync_latency);
+              *counter_indices = {counter_index.value()};
+              *byte_counts = {counter_index.value() * 64};
+              *packet_counts = {counter_index.value()};
+              return ::util::OkStatus();
+            }));
+    ON_CALL(bf_sde_mock_, ReadIndirectCounterRanges(kDevice, _, kBfRtCounterId,
+                                                    _, _, _, _, _))
+        .WillByDefault(Invoke(
+            [this, sync_latency](
+                int device,
+                std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                uint32 counter_id, const std::vector<IndexRange>& index_ranges,
+                std::vector<uint32>* counter_indices,
+                std::vector<absl::optional<uint64>>* byte_counts,
+                std::vector<absl::optional<uint64>>* packet_counts,
+                absl::Duration timeout) {
+              ++sde_calls_;
+              absl::SleepFor(sync_latency);
+              counter_indices->clear();
+              byte_counts->clear();
+              packet_counts->clear();
+              for (const auto& range : index_ranges) {
+                for (uint64 i = range.first; i <= range.last; ++i) {
+                  counter_indices->push_back(i);
+                  byte_counts->push_back(i * 64);
+                  packet_counts->push_back(i);
+                }
+              }
+              return ::util::OkStatus();
+            }));
+    bfrt_counter_manager_ = BfrtCounterManager::CreateInstance(
+        &bf_sde_mock_, &translator_mock_, kDevice);
+  }
+
+  BfrtCounterManager* counter_manager() { return bfrt_counter_manager_.get(); }
+  std::shared_ptr<BfSdeInterface::SessionInterface> session() {
+    return session_;
+  }
+  int sde_calls() const { return sde_calls_; }
+
+ private:
+  NiceMock<BfSdeMock> bf_sde_mock_;
+  NiceMock<BfrtP4RuntimeTranslatorMock> translator_mock_;
+  std::shared_ptr<NiceMock<SessionMock>> session_;
+  std::unique_ptr<BfrtCounterManager> bfrt_counter_manager_;
+  int sde_calls_;
+};
+
+// Returns counter entries for every other index, which makes for many small
+// ranges, followed by a block of consecutive indices.
+std::vector<::p4::v1::CounterEntry> MakeCounterEntries(int num_entries) {
+  std::vector<::p4::v1::CounterEntry> entries;
+  for (int i = 0; i < num_entries; ++i) {
+    ::p4::v1::CounterEntry entry;
+    entry.set_counter_id(kP4CounterId);
+    entry.mutable_index()->set_index(i < num_entries / 2 ? 2 * i : i + 1000);
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+// Arguments: number of counter indices, simulated sync latency in us.
+void BM_ReadIndirectCounterEntriesOneByOne(benchmark::State& state) {
+  CounterReadFixture fixture(absl::Microseconds(state.range(1)));
+  const auto entries = MakeCounterEntries(state.range(0));
+  CountingWriter writer;
+  for (auto _ : state) {
+    for (const auto& entry : entries) {
+      CHECK_OK(fixture.counter_manager()->ReadIndirectCounterEntry(
+          fixture.session(), entry, &writer));
+    }
+  }
+  state.SetItemsProcessed(writer.entities_);
+  state.counters["sde_calls_per_read"] =
+      static_cast<double>(fixture.sde_calls()) / state.iterations();
+  state.counters["responses_per_read"] =
+      static_cast<double>(writer.responses_) / state.iterations();
+}
+BENCHMARK(BM_ReadIndirectCounterEntriesOneByOne)
+    ->Args({16, 0})
+    ->Args({256, 0})
+    ->Args({16, 100})
+    ->Args({256, 100})
+    ->Unit(benchmark::kMillisecond);
+
+// Arguments: number of counter indices, simulated sync latency in us.
+void BM_ReadIndirectCounterEntriesBatched(benchmark::State& state) {
+  CounterReadFixture fixture(absl::Microseconds(state.range(1)));
+  const auto entries = MakeCounterEntries(state.range(0));
+  CountingWriter writer;
+  for (auto _ : state) {
+    CHECK_OK(fixture.counter_manager()->ReadIndirectCounterEntries(
+        fixture.session(), entries, &writer));
+  }
+  state.SetItemsProcessed(writer.entities_);
+  state.counters["sde_calls_per_read"] =
+      static_cast<double>(fixture.sde_calls()) / state.iterations();
+  state.counters["responses_per_read"] =
+      static_cast<double>(writer.responses_) / state.iterations();
+}
+BENCHMARK(BM_ReadIndirectCounterEntriesBatched)
+    ->Args({16, 0})
+    ->Args({256, 0})
+    ->Args({16, 100})
+    ->Args({256, 100})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -5,6 +5,7 @@
 #define STRATUM_HAL_LIB_BAREFOOT_BFRT_COUNTER_MANAGER_MOCK_H_
 
 #include <memory>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "stratum/hal/lib/barefoot/bfrt_pre_manager.h"
@@ -34,6 +35,12 @@ class BfrtCounterManagerMock : public BfrtCounterManager {
       ::util::Status(std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      const ::p4::v1::CounterEntry& counter_entry,
                      WriterInterface<::p4::v1::ReadResponse>* writer));
+  MOCK_METHOD3(
+      ReadIndirectCounterEntries,
+      ::util::Status(
+          std::shared_ptr<BfSdeInterface::SessionInterface> session,
+          const std::vector<::p4::v1::CounterEntry>& counter_entries,
+          WriterInterface<::p4::v1::ReadResponse>* writer));
 };
 
 }  // namespace barefoot
@@ -12,6 +12,7 @@
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/barefoot/bf_sde_mock.h"
 #include "stratum/hal/lib/barefoot/bfrt_p4runtime_translator_mock.h"
+#include "stratum/hal/lib/common/writer_mock.h"
 #include "stratum/lib/test_utils/matchers.h"
 #include "stratum/lib/utils.h"
 
@@ -22,10 +23,16 @@ namespace barefoot {
 using test_utils::EqualsProto;
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::Invoke;
 using ::testing::InvokeWithoutArgs;
 using ::testing::Return;
+using ::testing::SetArgPointee;
+
+MATCHER_P2(IndexRangeIs, first, last, "") {
+  return arg.first == first && arg.last == last;
+}
 
 class BfrtCounterManagerTest : public ::testing::Test {
  protected:
@@ -163,6 +170,82 @@ TEST_F(BfrtCounterManagerTest, RejectIndirectCounterIndexZeroTest) {
               HasSubstr("Counter index must be greater than or equal to zero"));
 }
 
+TEST_F(BfrtCounterManagerTest, ReadIndirectCounterEntriesTest) {
+  constexpr int kCounterId = 55;
+  constexpr int kBfRtCounterId = 66;
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  std::vector<::p4::v1::CounterEntry> entries;
+  // Index 2 is requested twice.
+  const std::vector<uint32> requested_indices = {3, 1, 2, 7, 2};
+  for (uint32 index : requested_indices) {
+    ::p4::v1::CounterEntry entry;
+    entry.set_counter_id(kCounterId);
+    entry.mutable_index()->set_index(index);
+    entries.push_back(entry);
+  }
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_, TranslateCounterEntry(_, _))
+      .WillRepeatedly(
+          Invoke([](const ::p4::v1::CounterEntry& entry, bool to_sdk) {
+            return ::util::StatusOr<::p4::v1::CounterEntry>(entry);
+          }));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kCounterId))
+      .WillOnce(Return(kBfRtCounterId));
+  // The five entries are read as two ranges, with a single SDE call.
+  std::vector<uint32> counter_indices = {1, 2, 3, 7};
+  std::vector<absl::optional<uint64>> byte_counts = {10, 20, 30, 70};
+  std::vector<absl::optional<uint64>> packet_counts = {1, 2, 3, 7};
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              ReadIndirectCounterRanges(
+                  kDevice1, _, kBfRtCounterId,
+                  ElementsAre(IndexRangeIs(1, 3), IndexRangeIs(7, 7)), _, _,
+                  _, _))
+      .WillOnce(DoAll(SetArgPointee<4>(counter_indices),
+                      SetArgPointee<5>(byte_counts),
+                      SetArgPointee<6>(packet_counts),
+                      Return(::util::OkStatus())));
+
+  // Every requested entry is answered, in the order of the request.
+  ::p4::v1::ReadResponse resp;
+  for (uint32 index : requested_indices) {
+    auto* counter_entry = resp.add_entities()->mutable_counter_entry();
+    counter_entry->set_counter_id(kCounterId);
+    counter_entry->mutable_index()->set_index(index);
+    counter_entry->mutable_data()->set_byte_count(index * 10);
+    counter_entry->mutable_data()->set_packet_count(index);
+  }
+  EXPECT_CALL(writer_mock, Write(EqualsProto(resp))).WillOnce(Return(true));
+
+  EXPECT_OK(bfrt_counter_manager_->ReadIndirectCounterEntries(
+      session_mock, entries, &writer_mock));
+}
+
+TEST_F(BfrtCounterManagerTest, RejectIndirectCounterEntriesOfDifferentIds) {
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  std::vector<::p4::v1::CounterEntry> entries(2);
+  entries[0].set_counter_id(55);
+  entries[0].mutable_index()->set_index(1);
+  entries[1].set_counter_id(56);
+  entries[1].mutable_index()->set_index(2);
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_, TranslateCounterEntry(_, _))
+      .WillRepeatedly(
+          Invoke([](const ::p4::v1::CounterEntry& entry, bool to_sdk) {
+            return ::util::StatusOr<::p4::v1::CounterEntry>(entry);
+          }));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, ReadIndirectCounterRanges(_, _, _, _, _,
+                                                               _, _, _))
+      .Times(0);
+
+  ::util::Status ret = bfrt_counter_manager_->ReadIndirectCounterEntries(
+      session_mock, entries, &writer_mock);
+  ASSERT_FALSE(ret.ok());
+  EXPECT_THAT(ret.error_message(),
+              HasSubstr("Only entries of the same counter"));
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
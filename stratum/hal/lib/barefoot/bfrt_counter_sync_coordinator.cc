@@ -0,0 +1,154 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_counter_sync_coordinator.h"
+
+#include <algorithm>
+
+#include "absl/time/clock.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+::util::Status CounterSyncCoordinator::Synchronize(
+    int device, uint32 table_id, absl::Duration timeout,
+    absl::Duration max_staleness, const SyncFunction& sync) {
+  const absl::Time start = absl::Now();
+  const absl::Time deadline = start + timeout;
+  const auto key = std::make_pair(device, table_id);
+  // The sync answering this request.
+  std::shared_ptr<PendingSync> pending;
+  // The sync in flight, which must complete before the queued sync of this
+  // request is issued.
+  std::shared_ptr<PendingSync> previous;
+  bool leader = false;
+  {
+    absl::MutexLock l(&lock_);
+    ++device_to_stats_[device].requests;
+    TableSyncState& state = tables_[key];
+    if (max_staleness > absl::ZeroDuration() &&
+        start - state.last_synced <= max_staleness) {
+      ++device_to_stats_[device].fresh_hits;
+      RecordWait(device, absl::ZeroDuration());
+      return ::util::OkStatus();
+    }
+    if (!state.in_flight) {
+      state.in_flight = std::make_shared<PendingSync>();
+      state.in_flight->issued = start;
+      pending = state.in_flight;
+      leader = true;
+    } else if (start - state.in_flight->issued <= max_staleness) {
+      // The sync in flight was issued recently enough, or it was queued and
+      // has not been issued yet.
+      ++device_to_stats_[device].coalesced;
+      pending = state.in_flight;
+    } else if (state.next) {
+      ++device_to_stats_[device].coalesced;
+      pending = state.next;
+    } else {
+      state.next = std::make_shared<PendingSync>();
+      pending = state.next;
+      previous = state.in_flight;
+      leader = true;
+    }
+  }
+
+  if (!leader) return AwaitSync(device, table_id, start, timeout, pending);
+
+  if (previous) {
+    VLOG(2) << "Queueing a sync of table " << table_id
+            << " after the sync in flight.";
+    const bool previous_done =
+        previous->done.WaitForNotificationWithDeadline(deadline);
+    {
+      absl::MutexLock l(&lock_);
+      if (previous_done) {
+        pending->issued = absl::Now();
+      } else {
+        // Give up on the queued sync, the requests waiting for it fail too.
+        auto it = tables_.find(key);
+        if (it != tables_.end()) {
+          if (it->second.in_flight == pending) it->second.in_flight.reset();
+          if (it->second.next == pending) it->second.next.reset();
+        }
+        RecordWait(device, absl::Now() - start);
+        pending->status = MAKE_ERROR(ERR_OPER_TIMEOUT)
+                          << "Timeout while waiting for the counter sync of "
+                          << "table " << table_id << ".";
+      }
+    }
+    if (!previous_done) {
+      pending->done.Notify();
+      return pending->status;
+    }
+  }
+
+  ::util::Status status = sync(deadline - absl::Now());
+  {
+    absl::MutexLock l(&lock_);
+    BfrtCounterSyncStats& stats = device_to_stats_[device];
+    ++stats.syncs;
+    if (!status.ok()) ++stats.sync_errors;
+    RecordWait(device, absl::Now() - start);
+    // The state may have been reset while the sync was in flight.
+    auto it = tables_.find(key);
+    if (it != tables_.end() && it->second.in_flight == pending) {
+      if (status.ok()) it->second.last_synced = pending->issued;
+      // The queued sync, if any, is issued by the request that queued it.
+      it->second.in_flight = std::move(it->second.next);
+    }
+    pending->status = status;
+  }
+  pending->done.Notify();
+
+  return status;
+}
+
+::util::Status CounterSyncCoordinator::AwaitSync(
+    int device, uint32 table_id, absl::Time start, absl::Duration timeout,
+    const std::shared_ptr<PendingSync>& pending) {
+  VLOG(2) << "Waiting for a sync of table " << table_id << ".";
+  if (!pending->done.WaitForNotificationWithTimeout(timeout)) {
+    absl::MutexLock l(&lock_);
+    RecordWait(device, absl::Now() - start);
+    return MAKE_ERROR(ERR_OPER_TIMEOUT)
+           << "Timeout while waiting for the counter sync of table "
+           << table_id << ".";
+  }
+  absl::MutexLock l(&lock_);
+  RecordWait(device, absl::Now() - start);
+  return pending->status;
+}
+
+BfrtCounterSyncStats CounterSyncCoordinator::GetStats(int device) const {
+  absl::MutexLock l(&lock_);
+  auto it = device_to_stats_.find(device);
+  if (it == device_to_stats_.end()) return BfrtCounterSyncStats();
+  return it->second;
+}
+
+void CounterSyncCoordinator::Reset(int device) {
+  absl::MutexLock l(&lock_);
+  for (auto it = tables_.begin(); it != tables_.end();) {
+    if (it->first.first == device) {
+      tables_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void CounterSyncCoordinator::RecordWait(int device, absl::Duration wait) {
+  BfrtCounterSyncStats& stats = device_to_stats_[device];
+  const uint64 usecs = absl::ToInt64Microseconds(wait);
+  stats.total_wait_usecs += usecs;
+  stats.max_wait_usecs = std::max(stats.max_wait_usecs, usecs);
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,141 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_COUNTER_SYNC_COORDINATOR_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_COUNTER_SYNC_COORDINATOR_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// Counters of the hardware counter synchronizations of a device.
+struct BfrtCounterSyncStats {
+  // Calls to CounterSyncCoordinator::Synchronize().
+  uint64 requests;
+  // Requests answered by a sync completed within the freshness window.
+  uint64 fresh_hits;
+  // Requests that waited for a sync issued by another request, either the
+  // sync in flight or the next one.
+  uint64 coalesced;
+  // Syncs issued to the hardware.
+  uint64 syncs;
+  // Syncs that failed or timed out.
+  uint64 sync_errors;
+  // Total and maximum time requests waited for their counters to be synced.
+  uint64 total_wait_usecs;
+  uint64 max_wait_usecs;
+  BfrtCounterSyncStats()
+      : requests(0),
+        fresh_hits(0),
+        coalesced(0),
+        syncs(0),
+        sync_errors(0),
+        total_wait_usecs(0),
+        max_wait_usecs(0) {}
+  std::string ToString() const {
+    return absl::StrCat(
+        "(requests:", requests, ", fresh_hits:", fresh_hits,
+        ", coalesced:", coalesced, ", syncs:", syncs,
+        ", sync_errors:", sync_errors, ", total_wait_usecs:", total_wait_usecs,
+        ", max_wait_usecs:", max_wait_usecs, ")");
+  }
+};
+
+// CounterSyncCoordinator merges the counter synchronizations requested for
+// the same table. A sync in flight may have read the counters before a request
+// arrived, so a request that arrives while a sync of its table is in flight
+// waits for the next sync. That sync is issued once the sync in flight
+// completes, and it is shared by all the requests that arrived in the
+// meantime. A request that accepts counters of a given age is answered right
+// away if a sync was issued recently enough, and joins the sync in flight if
+// that one was issued recently enough. This class is thread-safe.
+class CounterSyncCoordinator {
+ public:
+  // The function issuing a sync to the hardware and waiting for its
+  // completion. It must respect the given timeout.
+  using SyncFunction = std::function<::util::Status(absl::Duration timeout)>;
+
+  CounterSyncCoordinator() {}
+
+  // Makes sure the counters of the given table were synced no longer than
+  // max_staleness ago, calling sync if needed. Returns the status of the sync
+  // the request was answered by, or ERR_OPER_TIMEOUT if that sync did not
+  // complete within the given timeout.
+  ::util::Status Synchronize(int device, uint32 table_id,
+                             absl::Duration timeout,
+                             absl::Duration max_staleness,
+                             const SyncFunction& sync) LOCKS_EXCLUDED(lock_);
+
+  // Returns the sync statistics of the given device.
+  BfrtCounterSyncStats GetStats(int device) const LOCKS_EXCLUDED(lock_);
+
+  // Forgets when the tables of the given device were synced, e.g. after a new
+  // pipeline was pushed. Syncs in flight and statistics are not affected.
+  void Reset(int device) LOCKS_EXCLUDED(lock_);
+
+  // CounterSyncCoordinator is neither copyable nor movable.
+  CounterSyncCoordinator(const CounterSyncCoordinator&) = delete;
+  CounterSyncCoordinator& operator=(const CounterSyncCoordinator&) = delete;
+
+ private:
+  // A sync in flight or queued, shared by the requests waiting for it.
+  struct PendingSync {
+    // The time the sync was issued, or absl::InfiniteFuture() if it is
+    // queued.
+    absl::Time issued = absl::InfiniteFuture();
+    absl::Notification done;
+    // Set before done is notified.
+    ::util::Status status;
+  };
+
+  // The sync state of a table.
+  struct TableSyncState {
+    // The time the last successful sync was issued.
+    absl::Time last_synced = absl::InfinitePast();
+    // The sync in flight, if any.
+    std::shared_ptr<PendingSync> in_flight;
+    // The sync queued for the requests that arrived while the sync in flight
+    // was running. It becomes the sync in flight when that one completes.
+    std::shared_ptr<PendingSync> next;
+  };
+
+  // Waits for a sync issued by another request.
+  ::util::Status AwaitSync(int device, uint32 table_id, absl::Time start,
+                           absl::Duration timeout,
+                           const std::shared_ptr<PendingSync>& pending)
+      LOCKS_EXCLUDED(lock_);
+
+  // Records the wait time of a request in the stats of the given device.
+  void RecordWait(int device, absl::Duration wait)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  mutable absl::Mutex lock_;
+
+  // Map from (device, table ID) to the sync state of the table.
+  absl::flat_hash_map<std::pair<int, uint32>, TableSyncState> tables_
+      GUARDED_BY(lock_);
+
+  // Map from device ID to the sync statistics of the device.
+  absl::flat_hash_map<int, BfrtCounterSyncStats> device_to_stats_
+      GUARDED_BY(lock_);
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_COUNTER_SYNC_COORDINATOR_H_
@@ -0,0 +1,234 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_counter_sync_coordinator.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using test_utils::StatusIs;
+using ::testing::_;
+using ::testing::HasSubstr;
+
+constexpr int kDevice = 0;
+constexpr uint32 kTableId = 12345;
+constexpr absl::Duration kTimeout = absl::Seconds(10);
+
+class CounterSyncCoordinatorTest : public ::testing::Test {
+ protected:
+  CounterSyncCoordinatorTest() : num_syncs_(0) {}
+
+  // Returns a sync function that counts its calls and returns the given
+  // status.
+  CounterSyncCoordinator::SyncFunction CountingSync(
+      ::util::Status status = ::util::OkStatus()) {
+    return [this, status](absl::Duration timeout) -> ::util::Status {
+      absl::MutexLock l(&lock_);
+      ++num_syncs_;
+      return status;
+    };
+  }
+
+  int NumSyncs() {
+    absl::MutexLock l(&lock_);
+    return num_syncs_;
+  }
+
+  CounterSyncCoordinator coordinator_;
+  absl::Mutex lock_;
+  int num_syncs_ GUARDED_BY(lock_);
+};
+
+TEST_F(CounterSyncCoordinatorTest, SyncsEveryRequestWithoutFreshnessWindow) {
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                       absl::ZeroDuration(), CountingSync()));
+  }
+  EXPECT_EQ(3, NumSyncs());
+  BfrtCounterSyncStats stats = coordinator_.GetStats(kDevice);
+  EXPECT_EQ(3, stats.requests);
+  EXPECT_EQ(3, stats.syncs);
+  EXPECT_EQ(0, stats.fresh_hits);
+  EXPECT_EQ(0, stats.coalesced);
+}
+
+TEST_F(CounterSyncCoordinatorTest, ReusesSyncWithinFreshnessWindow) {
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                       absl::Hours(1), CountingSync()));
+  }
+  EXPECT_EQ(1, NumSyncs());
+  // Other tables and devices are synced separately.
+  EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId + 1, kTimeout,
+                                     absl::Hours(1), CountingSync()));
+  EXPECT_OK(coordinator_.Synchronize(kDevice + 1, kTableId, kTimeout,
+                                     absl::Hours(1), CountingSync()));
+  EXPECT_EQ(3, NumSyncs());
+  BfrtCounterSyncStats stats = coordinator_.GetStats(kDevice);
+  EXPECT_EQ(4, stats.requests);
+  EXPECT_EQ(2, stats.syncs);
+  EXPECT_EQ(2, stats.fresh_hits);
+}
+
+TEST_F(CounterSyncCoordinatorTest, ResetForgetsCompletedSyncs) {
+  EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                     absl::Hours(1), CountingSync()));
+  coordinator_.Reset(kDevice);
+  EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                     absl::Hours(1), CountingSync()));
+  EXPECT_EQ(2, NumSyncs());
+  // Statistics are kept.
+  EXPECT_EQ(2, coordinator_.GetStats(kDevice).syncs);
+}
+
+TEST_F(CounterSyncCoordinatorTest, FailedSyncIsNotReused) {
+  ::util::Status error = MAKE_ERROR(ERR_INTERNAL) << "sync failed";
+  EXPECT_THAT(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                       absl::Hours(1), CountingSync(error)),
+              StatusIs(_, ERR_INTERNAL, HasSubstr("sync failed")));
+  EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                     absl::Hours(1), CountingSync()));
+  EXPECT_EQ(2, NumSyncs());
+  EXPECT_EQ(1, coordinator_.GetStats(kDevice).sync_errors);
+}
+
+TEST_F(CounterSyncCoordinatorTest, LateRequestsWaitForNextSync) {
+  constexpr int kNumWaiters = 4;
+  absl::Notification sync_started;
+  absl::Notification release_sync;
+  auto blocking_sync = [this, &sync_started, &release_sync](
+                           absl::Duration timeout) -> ::util::Status {
+    {
+      absl::MutexLock l(&lock_);
+      ++num_syncs_;
+    }
+    sync_started.Notify();
+    release_sync.WaitForNotification();
+    return MAKE_ERROR(ERR_INTERNAL) << "sync failed";
+  };
+
+  std::thread leader([this, &blocking_sync]() {
+    EXPECT_THAT(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                         absl::ZeroDuration(), blocking_sync),
+                StatusIs(_, ERR_INTERNAL, _));
+  });
+  sync_started.WaitForNotification();
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < kNumWaiters; ++i) {
+    waiters.emplace_back([this]() {
+      // The sync in flight may have read the counters before the request, so
+      // the waiters share the result of one more sync.
+      EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                         absl::ZeroDuration(),
+                                         CountingSync()));
+    });
+  }
+  while (coordinator_.GetStats(kDevice).requests < kNumWaiters + 1) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  release_sync.Notify();
+  leader.join();
+  for (auto& waiter : waiters) waiter.join();
+
+  EXPECT_EQ(2, NumSyncs());
+  BfrtCounterSyncStats stats = coordinator_.GetStats(kDevice);
+  EXPECT_EQ(kNumWaiters + 1, stats.requests);
+  EXPECT_EQ(kNumWaiters - 1, stats.coalesced);
+  EXPECT_EQ(2, stats.syncs);
+  EXPECT_EQ(1, stats.sync_errors);
+  EXPECT_GT(stats.max_wait_usecs, 0);
+}
+
+TEST_F(CounterSyncCoordinatorTest, JoinsSyncInFlightWithinFreshnessWindow) {
+  constexpr int kNumWaiters = 4;
+  absl::Notification sync_started;
+  absl::Notification release_sync;
+  auto blocking_sync = [this, &sync_started, &release_sync](
+                           absl::Duration timeout) -> ::util::Status {
+    {
+      absl::MutexLock l(&lock_);
+      ++num_syncs_;
+    }
+    sync_started.Notify();
+    release_sync.WaitForNotification();
+    return MAKE_ERROR(ERR_INTERNAL) << "sync failed";
+  };
+
+  std::thread leader([this, &blocking_sync]() {
+    EXPECT_THAT(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                         absl::Hours(1), blocking_sync),
+                StatusIs(_, ERR_INTERNAL, _));
+  });
+  sync_started.WaitForNotification();
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < kNumWaiters; ++i) {
+    waiters.emplace_back([this]() {
+      // The sync in flight is recent enough, the waiters get its result.
+      EXPECT_THAT(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                           absl::Hours(1), CountingSync()),
+                  StatusIs(_, ERR_INTERNAL, _));
+    });
+  }
+  while (coordinator_.GetStats(kDevice).coalesced < kNumWaiters) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  release_sync.Notify();
+  leader.join();
+  for (auto& waiter : waiters) waiter.join();
+
+  EXPECT_EQ(1, NumSyncs());
+  BfrtCounterSyncStats stats = coordinator_.GetStats(kDevice);
+  EXPECT_EQ(kNumWaiters + 1, stats.requests);
+  EXPECT_EQ(kNumWaiters, stats.coalesced);
+  EXPECT_EQ(1, stats.syncs);
+}
+
+TEST_F(CounterSyncCoordinatorTest, WaiterTimesOut) {
+  absl::Notification sync_started;
+  absl::Notification release_sync;
+  std::thread leader([this, &sync_started, &release_sync]() {
+    EXPECT_OK(coordinator_.Synchronize(
+        kDevice, kTableId, kTimeout, absl::ZeroDuration(),
+        [&sync_started,
+         &release_sync](absl::Duration timeout) -> ::util::Status {
+          sync_started.Notify();
+          release_sync.WaitForNotification();
+          return ::util::OkStatus();
+        }));
+  });
+  sync_started.WaitForNotification();
+  // The request times out waiting for the sync in flight to complete before
+  // its own sync can be issued.
+  EXPECT_THAT(
+      coordinator_.Synchronize(kDevice, kTableId, absl::Milliseconds(1),
+                               absl::ZeroDuration(), CountingSync()),
+      StatusIs(_, ERR_OPER_TIMEOUT, HasSubstr("Timeout")));
+  release_sync.Notify();
+  leader.join();
+  EXPECT_EQ(0, NumSyncs());
+  // The queued sync was dropped, the next request is synced.
+  EXPECT_OK(coordinator_.Synchronize(kDevice, kTableId, kTimeout,
+                                     absl::ZeroDuration(), CountingSync()));
+  EXPECT_EQ(1, NumSyncs());
+}
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
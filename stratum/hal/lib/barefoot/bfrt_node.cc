@@ -5,11 +5,24 @@
 
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "gflags/gflags.h"
+#include "google/protobuf/arena.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/barefoot/bf_pipeline_utils.h"
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
@@ -20,10 +33,234 @@
 #include "stratum/lib/utils.h"
 #include "stratum/public/proto/error.pb.h"
 
+DEFINE_int32(bfrt_write_pipeline_threads, 4,
+             "Number of worker threads translating table entries and building "
+             "their SDE key and data objects in large P4Runtime write "
+             "requests. A value of 1 or less disables the write pipeline.");
+DEFINE_int32(bfrt_write_pipeline_min_batch_size, 256,
+             "Minimum number of table entries in a P4Runtime write request "
+             "for the write pipeline to be used.");
+
 namespace stratum {
 namespace hal {
 namespace barefoot {
 
+// Fixed set of worker threads running the tasks of the write pipeline. The
+// threads are spawned by the first task, so that nodes which never see a large
+// write request do not keep idle threads around.
+class BfrtWriteWorkerPool {
+ public:
+  explicit BfrtWriteWorkerPool(int num_threads)
+      : num_threads_(num_threads), shutdown_(false) {}
+
+  ~BfrtWriteWorkerPool() {
+    {
+      absl::MutexLock l(&lock_);
+      shutdown_ = true;
+    }
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void Schedule(std::function<void()> task) LOCKS_EXCLUDED(lock_) {
+    absl::MutexLock l(&lock_);
+    if (threads_.empty()) {
+      for (int i = 0; i < num_threads_; ++i) {
+        threads_.emplace_back(&BfrtWriteWorkerPool::WorkerLoop, this);
+      }
+    }
+    tasks_.push_back(std::move(task));
+  }
+
+  BfrtWriteWorkerPool(const BfrtWriteWorkerPool&) = delete;
+  BfrtWriteWorkerPool& operator=(const BfrtWriteWorkerPool&) = delete;
+
+ private:
+  // Runs the queued tasks until the pool is destroyed.
+  void WorkerLoop() LOCKS_EXCLUDED(lock_) {
+    while (true) {
+      std::function<void()> task;
+      {
+        absl::MutexLock l(&lock_);
+        lock_.Await(
+            absl::Condition(this, &BfrtWriteWorkerPool::HasWorkOrShutdown));
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  bool HasWorkOrShutdown() const EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    return shutdown_ || !tasks_.empty();
+  }
+
+  const int num_threads_;
+  absl::Mutex lock_;
+  bool shutdown_ GUARDED_BY(lock_);
+  std::deque<std::function<void()>> tasks_ GUARDED_BY(lock_);
+  // Only modified under lock_, and joined after all the users of the pool are
+  // gone.
+  std::vector<std::thread> threads_;
+};
+
+namespace {
+
+// Returns the P4 ID of the resource (table, action profile, counter, ...) the
+// given entity is written to. Entities without such an ID map to 0.
+uint32 GetWriteResourceId(const ::p4::v1::Entity& entity) {
+  switch (entity.entity_case()) {
+    case ::p4::v1::Entity::kTableEntry:
+      return entity.table_entry().table_id();
+    case ::p4::v1::Entity::kExternEntry:
+      return entity.extern_entry().extern_id();
+    case ::p4::v1::Entity::kActionProfileMember:
+      return entity.action_profile_member().action_profile_id();
+    case ::p4::v1::Entity::kActionProfileGroup:
+      return entity.action_profile_group().action_profile_id();
+    case ::p4::v1::Entity::kDirectCounterEntry:
+      return entity.direct_counter_entry().table_entry().table_id();
+    case ::p4::v1::Entity::kCounterEntry:
+      return entity.counter_entry().counter_id();
+    case ::p4::v1::Entity::kRegisterEntry:
+      return entity.register_entry().register_id();
+    case ::p4::v1::Entity::kMeterEntry:
+      return entity.meter_entry().meter_id();
+    case ::p4::v1::Entity::kDigestEntry:
+      return entity.digest_entry().digest_id();
+    default:
+      return 0;
+  }
+}
+
+// Holds a set of write lock shards for the lifetime of the object. The locks
+// are acquired in ascending address order to avoid lock order inversions
+// between concurrent write requests. Readers take the locks shared.
+class WriteLockSet {
+ public:
+  WriteLockSet(std::vector<absl::Mutex*> locks, bool shared)
+      NO_THREAD_SAFETY_ANALYSIS : locks_(std::move(locks)),
+                                  shared_(shared) {
+    std::sort(locks_.begin(), locks_.end());
+    locks_.erase(std::unique(locks_.begin(), locks_.end()), locks_.end());
+    for (auto* lock : locks_) {
+      if (shared_) {
+        lock->ReaderLock();
+      } else {
+        lock->Lock();
+      }
+    }
+  }
+  ~WriteLockSet() NO_THREAD_SAFETY_ANALYSIS {
+    for (auto it = locks_.rbegin(); it != locks_.rend(); ++it) {
+      if (shared_) {
+        (*it)->ReaderUnlock();
+      } else {
+        (*it)->Unlock();
+      }
+    }
+  }
+
+  WriteLockSet(const WriteLockSet&) = delete;
+  WriteLockSet& operator=(const WriteLockSet&) = delete;
+
+ private:
+  std::vector<absl::Mutex*> locks_;
+  const bool shared_;
+};
+
+// Runs the translation and SDE key/data building stage of all table entries
+// in a write request as tasks on the write worker threads of the node. The
+// caller submits the prepared entries to the SDE in request order through
+// Commit(), which only blocks until the chunk containing the requested update
+// is ready. Updates are handed out in chunks to amortize the synchronization
+// cost.
+class TableEntryWritePipeline {
+ public:
+  TableEntryWritePipeline(BfrtTableManager* bfrt_table_manager,
+                          const ::p4::v1::WriteRequest& req,
+                          BfrtWriteWorkerPool* worker_pool, int num_tasks)
+      : bfrt_table_manager_(bfrt_table_manager),
+        req_(req),
+        num_chunks_((req.updates_size() + kChunkSize - 1) / kChunkSize),
+        num_tasks_(std::min(num_tasks, num_chunks_)),
+        next_chunk_(0),
+        cancelled_(false),
+        writes_(req.updates_size()),
+        statuses_(req.updates_size()),
+        chunk_ready_(num_chunks_),
+        tasks_done_(num_tasks_) {
+    for (int i = 0; i < num_tasks_; ++i) {
+      worker_pool->Schedule([this]() {
+        Run();
+        tasks_done_.DecrementCount();
+      });
+    }
+  }
+
+  // Waits for the tasks of this pipeline. Tasks which have not started yet
+  // return right away.
+  ~TableEntryWritePipeline() {
+    cancelled_ = true;
+    tasks_done_.Wait();
+  }
+
+  // Waits until the table entry update at the given index has been prepared
+  // and submits it to the SDE.
+  ::util::Status Commit(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session, int index) {
+    chunk_ready_[index / kChunkSize].WaitForNotification();
+    RETURN_IF_ERROR(statuses_[index]);
+    return bfrt_table_manager_->CommitTableEntryWrite(session, writes_[index]);
+  }
+
+  TableEntryWritePipeline(const TableEntryWritePipeline&) = delete;
+  TableEntryWritePipeline& operator=(const TableEntryWritePipeline&) = delete;
+
+ private:
+  static constexpr int kChunkSize = 64;
+
+  void Run() {
+    while (!cancelled_) {
+      const int chunk = next_chunk_.fetch_add(1);
+      if (chunk >= num_chunks_) break;
+      const int end = std::min((chunk + 1) * kChunkSize, req_.updates_size());
+      for (int i = chunk * kChunkSize; i < end; ++i) {
+        const auto& update = req_.updates(i);
+        if (update.entity().entity_case() != ::p4::v1::Entity::kTableEntry) {
+          continue;
+        }
+        statuses_[i] = bfrt_table_manager_->PrepareTableEntryWrite(
+            update.type(), update.entity().table_entry(), &arena_,
+            &writes_[i]);
+      }
+      chunk_ready_[chunk].Notify();
+    }
+  }
+
+  BfrtTableManager* const bfrt_table_manager_;
+  const ::p4::v1::WriteRequest& req_;
+  const int num_chunks_;
+  const int num_tasks_;
+  std::atomic<int> next_chunk_;
+  std::atomic<bool> cancelled_;
+  // Holds the protos built by the prepare stage for all the updates, so that
+  // they are not allocated and freed one by one. Protobuf arenas are
+  // thread-safe. Declared before writes_, which points into it.
+  google::protobuf::Arena arena_;
+  // Per-update results of the prepare stage, indexed like req_.updates().
+  // Each element is only written by the worker owning its chunk, before the
+  // chunk notification is sent.
+  std::vector<BfrtTableManager::TableEntryWrite> writes_;
+  std::vector<::util::Status> statuses_;
+  std::vector<absl::Notification> chunk_ready_;
+  absl::BlockingCounter tasks_done_;
+};
+
+constexpr int TableEntryWritePipeline::kChunkSize;
+
+}  // namespace
+
 BfrtNode::BfrtNode(BfrtTableManager* bfrt_table_manager,
                    BfrtPacketioManager* bfrt_packetio_manager,
                    BfrtPreManager* bfrt_pre_manager,
@@ -39,6 +276,8 @@ BfrtNode::BfrtNode(BfrtTableManager* bfrt_table_manager,
       bfrt_pre_manager_(ABSL_DIE_IF_NULL(bfrt_pre_manager)),
       bfrt_counter_manager_(ABSL_DIE_IF_NULL(bfrt_counter_manager)),
       bfrt_p4runtime_translator_(ABSL_DIE_IF_NULL(bfrt_p4runtime_translator)),
+      write_worker_pool_(absl::make_unique<BfrtWriteWorkerPool>(
+          FLAGS_bfrt_write_pipeline_threads)),
       node_id_(0),
       device_id_(device_id) {}
 
@@ -185,7 +424,10 @@ std::unique_ptr<BfrtNode> BfrtNode::CreateInstance(
 
 ::util::Status BfrtNode::WriteForwardingEntries(
     const ::p4::v1::WriteRequest& req, std::vector<::util::Status>* results) {
-  absl::WriterMutexLock l(&lock_);
+  // Node state is only read here. Conflicting writes are serialized by the
+  // per-resource write locks below, which keeps reads and stream messages
+  // flowing during large writes.
+  absl::ReaderMutexLock l(&lock_);
   RET_CHECK(req.device_id() == node_id_)
       << "Request device id must be same as id of this BfrtNode.";
   RET_CHECK(req.atomicity() == ::p4::v1::WriteRequest::CONTINUE_ON_ERROR)
@@ -196,15 +438,42 @@ std::unique_ptr<BfrtNode> BfrtNode::CreateInstance(
     return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
   }
 
+  std::set<int> shards;
+  int num_table_entries = 0;
+  for (const auto& update : req.updates()) {
+    shards.insert(GetWriteResourceId(update.entity()) % kNumWriteLockShards);
+    if (update.entity().entity_case() == ::p4::v1::Entity::kTableEntry) {
+      ++num_table_entries;
+    }
+  }
+  std::vector<absl::Mutex*> locks;
+  for (int shard : shards) locks.push_back(&write_locks_[shard]);
+  WriteLockSet write_lock_set(std::move(locks), /*shared=*/false);
+
+  // Large batches of table entries are translated and converted to SDE objects
+  // on worker threads, while this thread submits them to the SDE in order.
+  std::unique_ptr<TableEntryWritePipeline> pipeline;
+  if (FLAGS_bfrt_write_pipeline_threads > 1 &&
+      num_table_entries >= FLAGS_bfrt_write_pipeline_min_batch_size) {
+    pipeline = absl::make_unique<TableEntryWritePipeline>(
+        bfrt_table_manager_, req, write_worker_pool_.get(),
+        FLAGS_bfrt_write_pipeline_threads);
+  }
+
   bool success = true;
   ASSIGN_OR_RETURN(auto session, bf_sde_interface_->CreateSession());
   RETURN_IF_ERROR(session->BeginBatch());
-  for (const auto& update : req.updates()) {
+  for (int i = 0; i < req.updates_size(); ++i) {
+    const auto& update = req.updates(i);
     ::util::Status status = ::util::OkStatus();
     switch (update.entity().entity_case()) {
       case ::p4::v1::Entity::kTableEntry:
-        status = bfrt_table_manager_->WriteTableEntry(
-            session, update.type(), update.entity().table_entry());
+        if (pipeline) {
+          status = pipeline->Commit(session, i);
+        } else {
+          status = bfrt_table_manager_->WriteTableEntry(
+              session, update.type(), update.entity().table_entry());
+        }
         break;
       case ::p4::v1::Entity::kExternEntry:
         status = WriteExternEntry(session, update.type(),
@@ -280,6 +549,67 @@ std::unique_ptr<BfrtNode> BfrtNode::CreateInstance(
   if (!initialized_ || !pipeline_initialized_) {
     return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
   }
+  // Wildcard table reads page through the SDE table, using the last entry of
+  // each page as the cursor of the next one. Holding the write lock shards of
+  // the tables shared keeps writes from deleting the cursor entry in between,
+  // while reads of the same table still run concurrently.
+  std::set<int> shards;
+  for (const auto& entity : req.entities()) {
+    if (entity.entity_case() != ::p4::v1::Entity::kTableEntry) continue;
+    const auto& table_entry = entity.table_entry();
+    if (table_entry.match_size() != 0 || table_entry.is_default_action()) {
+      continue;
+    }
+    if (table_entry.table_id() == 0) {
+      for (int shard = 0; shard < kNumWriteLockShards; ++shard) {
+        shards.insert(shard);
+      }
+      break;
+    }
+    shards.insert(table_entry.table_id() % kNumWriteLockShards);
+  }
+  std::vector<absl::Mutex*> locks;
+  for (int shard : shards) locks.push_back(&write_locks_[shard]);
+  WriteLockSet write_lock_set(std::move(locks), /*shared=*/true);
+
+  // Entries that address a single index of the same counter, register or meter
+  // are read in one batch, with a single hardware sync. The status of a batch
+  // is reported for each of its entries.
+  absl::flat_hash_map<uint32, std::vector<::p4::v1::CounterEntry>>
+      counter_batches;
+  absl::flat_hash_map<uint32, std::vector<::p4::v1::RegisterEntry>>
+      register_batches;
+  absl::flat_hash_map<uint32, std::vector<::p4::v1::MeterEntry>> meter_batches;
+  for (const auto& entity : req.entities()) {
+    switch (entity.entity_case()) {
+      case ::p4::v1::Entity::kCounterEntry:
+        if (entity.counter_entry().counter_id() != 0 &&
+            entity.counter_entry().has_index()) {
+          counter_batches[entity.counter_entry().counter_id()].push_back(
+              entity.counter_entry());
+        }
+        break;
+      case ::p4::v1::Entity::kRegisterEntry:
+        if (entity.register_entry().register_id() != 0 &&
+            entity.register_entry().has_index()) {
+          register_batches[entity.register_entry().register_id()].push_back(
+              entity.register_entry());
+        }
+        break;
+      case ::p4::v1::Entity::kMeterEntry:
+        if (entity.meter_entry().meter_id() != 0 &&
+            entity.meter_entry().has_index()) {
+          meter_batches[entity.meter_entry().meter_id()].push_back(
+              entity.meter_entry());
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  // Map from P4 ID to the status of the batches already read.
+  absl::flat_hash_map<uint32, ::util::Status> batch_statuses;
+
   ::p4::v1::ReadResponse resp;
   bool success = true;
   ASSIGN_OR_RETURN(auto session, bf_sde_interface_->CreateSession());
@@ -332,22 +662,61 @@ std::unique_ptr<BfrtNode> BfrtNode::CreateInstance(
         break;
       }
       case ::p4::v1::Entity::kCounterEntry: {
-        auto status = bfrt_counter_manager_->ReadIndirectCounterEntry(
-            session, entity.counter_entry(), writer);
+        const auto& counter_entry = entity.counter_entry();
+        const uint32 counter_id = counter_entry.counter_id();
+        auto it = counter_batches.find(counter_id);
+        ::util::Status status;
+        if (!counter_entry.has_index() || it == counter_batches.end() ||
+            it->second.size() < 2) {
+          status = bfrt_counter_manager_->ReadIndirectCounterEntry(
+              session, counter_entry, writer);
+        } else if (!batch_statuses.contains(counter_id)) {
+          status = bfrt_counter_manager_->ReadIndirectCounterEntries(
+              session, it->second, writer);
+          batch_statuses[counter_id] = status;
+        } else {
+          status = batch_statuses[counter_id];
+        }
         success &= status.ok();
         details->push_back(status);
         break;
       }
       case ::p4::v1::Entity::kRegisterEntry: {
-        auto status = bfrt_table_manager_->ReadRegisterEntry(
-            session, entity.register_entry(), writer);
+        const auto& register_entry = entity.register_entry();
+        const uint32 register_id = register_entry.register_id();
+        auto it = register_batches.find(register_id);
+        ::util::Status status;
+        if (!register_entry.has_index() || it == register_batches.end() ||
+            it->second.size() < 2) {
+          status = bfrt_table_manager_->ReadRegisterEntry(
+              session, register_entry, writer);
+        } else if (!batch_statuses.contains(register_id)) {
+          status = bfrt_table_manager_->ReadRegisterEntries(
+              session, it->second, writer);
+          batch_statuses[register_id] = status;
+        } else {
+          status = batch_statuses[register_id];
+        }
         success &= status.ok();
         details->push_back(status);
         break;
       }
       case ::p4::v1::Entity::kMeterEntry: {
-        auto status = bfrt_table_manager_->ReadMeterEntry(
-            session, entity.meter_entry(), writer);
+        const auto& meter_entry = entity.meter_entry();
+        const uint32 meter_id = meter_entry.meter_id();
+        auto it = meter_batches.find(meter_id);
+        ::util::Status status;
+        if (!meter_entry.has_index() || it == meter_batches.end() ||
+            it->second.size() < 2) {
+          status =
+              bfrt_table_manager_->ReadMeterEntry(session, meter_entry, writer);
+        } else if (!batch_statuses.contains(meter_id)) {
+          status = bfrt_table_manager_->ReadMeterEntries(session, it->second,
+                                                         writer);
+          batch_statuses[meter_id] = status;
+        } else {
+          status = batch_statuses[meter_id];
+        }
         success &= status.ok();
         details->push_back(status);
         break;
@@ -432,6 +801,14 @@ std::unique_ptr<BfrtNode> BfrtNode::CreateInstance(
   }
 }
 
+::util::StatusOr<std::string> BfrtNode::DumpPacketioStats() const {
+  absl::ReaderMutexLock l(&lock_);
+  if (!initialized_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
+  }
+  return bfrt_packetio_manager_->GetRxStats().ToString();
+}
+
 ::util::Status BfrtNode::WriteExternEntry(
     std::shared_ptr<BfSdeInterface::SessionInterface> session,
     const ::p4::v1::Update::Type type, const ::p4::v1::ExternEntry& entry) {
@@ -14,6 +14,7 @@
 #include "stratum/glue/status/status.h"
 #include "stratum/hal/lib/barefoot/bf.pb.h"
 #include "stratum/hal/lib/barefoot/bf_global_vars.h"
+#include "stratum/hal/lib/barefoot/bfrt_constants.h"
 #include "stratum/hal/lib/barefoot/bfrt_counter_manager.h"
 #include "stratum/hal/lib/barefoot/bfrt_p4runtime_translator.h"
 #include "stratum/hal/lib/barefoot/bfrt_packetio_manager.h"
@@ -26,6 +27,9 @@ namespace stratum {
 namespace hal {
 namespace barefoot {
 
+// Worker threads of the table entry write pipeline. Defined in bfrt_node.cc.
+class BfrtWriteWorkerPool;
+
 // The BfrtNode class encapsulates all per P4-native node/chip/ASIC
 // functionalities, primarily the flow managers. Calls made to this class are
 // processed and passed through to the BfRt API.
@@ -63,6 +67,9 @@ class BfrtNode {
       LOCKS_EXCLUDED(lock_);
   virtual ::util::Status HandleStreamMessageRequest(
       const ::p4::v1::StreamMessageRequest& req) LOCKS_EXCLUDED(lock_);
+  // Returns a human-readable dump of the packet I/O stats of this node.
+  virtual ::util::StatusOr<std::string> DumpPacketioStats() const
+      LOCKS_EXCLUDED(lock_);
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BfrtNode> CreateInstance(
       BfrtTableManager* bfrt_table_manager,
@@ -113,6 +120,13 @@ class BfrtNode {
   // Mutex used for exclusive access to rx_writer_.
   mutable absl::Mutex rx_writer_lock_;
 
+  // Locks serializing writes to the same P4 resource (table, action profile,
+  // counter, ...). A resource maps to a shard by its P4 ID. Write requests
+  // only take the shards of the resources they touch, so writes to disjoint
+  // resources proceed concurrently and lock_ is only ever taken shared on the
+  // write path. Wildcard table reads hold the shards of their tables shared.
+  absl::Mutex write_locks_[kNumWriteLockShards];
+
   // Flag indicating whether the pipeline has been pushed.
   bool pipeline_initialized_ GUARDED_BY(lock_);
 
@@ -136,6 +150,10 @@ class BfrtNode {
   // translator logic. Not owned by this class.
   BfrtP4RuntimeTranslator* bfrt_p4runtime_translator_ = nullptr;
 
+  // Worker threads preparing the table entries of large write requests. Null
+  // in the default constructed node used for mocking.
+  std::unique_ptr<BfrtWriteWorkerPool> write_worker_pool_;
+
   // Logical node ID corresponding to the node/ASIC managed by this class
   // instance. Assigned on PushChassisConfig() and might change during the
   // lifetime of the class.
@@ -42,6 +42,7 @@ class BfrtNodeMock : public BfrtNode {
                                   ::p4::v1::StreamMessageResponse>>& writer));
   MOCK_METHOD1(HandleStreamMessageRequest,
                ::util::Status(const ::p4::v1::StreamMessageRequest& req));
+  MOCK_CONST_METHOD0(DumpPacketioStats, ::util::StatusOr<std::string>());
 };
 
 }  // namespace barefoot
@@ -4,10 +4,16 @@
 
 #include "stratum/hal/lib/barefoot/bfrt_node.h"
 
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
 
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/status/canonical_errors.h"
@@ -22,6 +28,9 @@
 #include "stratum/hal/lib/common/writer_mock.h"
 #include "stratum/lib/utils.h"
 
+DECLARE_int32(bfrt_write_pipeline_threads);
+DECLARE_int32(bfrt_write_pipeline_min_batch_size);
+
 namespace stratum {
 namespace hal {
 namespace barefoot {
@@ -1015,6 +1024,101 @@ TEST_F(BfrtNodeTest, WriteForwardingEntriesSuccess_DeleteTableEntry) {
   EXPECT_EQ(1U, results.size());
 }
 
+TEST_F(BfrtNodeTest, WriteForwardingEntriesSuccess_PipelinedTableEntries) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_write_pipeline_threads = 2;
+  FLAGS_bfrt_write_pipeline_min_batch_size = 2;
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+  ASSERT_NO_FATAL_FAILURE(PushForwardingPipelineConfigWithCheck());
+
+  constexpr int kNumEntries = 200;
+  ::p4::v1::WriteRequest req;
+  for (int i = 0; i < kNumEntries; ++i) {
+    auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+    table_entry->set_table_id(kNumEntries + i);
+  }
+
+  std::shared_ptr<BfSdeInterface::SessionInterface> session_mock =
+      std::make_shared<SessionMock>();
+  EXPECT_CALL(*bf_sde_mock_, CreateSession()).WillOnce(Return(session_mock));
+  EXPECT_CALL(*bfrt_table_manager_mock_, WriteTableEntry(_, _, _)).Times(0);
+  // All the entries of the request are prepared on the same arena.
+  absl::Mutex arenas_lock;
+  std::set<google::protobuf::Arena*> arenas;
+  EXPECT_CALL(*bfrt_table_manager_mock_,
+              PrepareTableEntryWrite(::p4::v1::Update::INSERT, _, _, _))
+      .Times(kNumEntries)
+      .WillRepeatedly(
+          Invoke([&](const ::p4::v1::Update::Type type,
+                     const ::p4::v1::TableEntry& table_entry,
+                     google::protobuf::Arena* arena,
+                     BfrtTableManager::TableEntryWrite* write) {
+            absl::MutexLock l(&arenas_lock);
+            arenas.insert(arena);
+            write->type = type;
+            write->table_id = table_entry.table_id();
+            return ::util::OkStatus();
+          }));
+  // Entries must be submitted to the SDE in request order.
+  int next_table_id = kNumEntries;
+  EXPECT_CALL(*bfrt_table_manager_mock_, CommitTableEntryWrite(session_mock, _))
+      .Times(kNumEntries)
+      .WillRepeatedly(
+          Invoke([&next_table_id](
+                     std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                     const BfrtTableManager::TableEntryWrite& write) {
+            EXPECT_EQ(next_table_id++, write.table_id);
+            return ::util::OkStatus();
+          }));
+
+  std::vector<::util::Status> results = {};
+  EXPECT_OK(WriteForwardingEntries(req, &results));
+  EXPECT_EQ(kNumEntries, static_cast<int>(results.size()));
+  absl::MutexLock l(&arenas_lock);
+  EXPECT_EQ(1U, arenas.size());
+  EXPECT_EQ(0U, arenas.count(nullptr));
+}
+
+TEST_F(BfrtNodeTest, WriteForwardingEntriesFailure_PipelinedTableEntries) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_write_pipeline_threads = 2;
+  FLAGS_bfrt_write_pipeline_min_batch_size = 2;
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+  ASSERT_NO_FATAL_FAILURE(PushForwardingPipelineConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  SetupTableEntryToInsert(&req, kNodeId)->set_table_id(1);
+  SetupTableEntryToInsert(&req, kNodeId)->set_table_id(2);
+
+  std::shared_ptr<BfSdeInterface::SessionInterface> session_mock =
+      std::make_shared<SessionMock>();
+  EXPECT_CALL(*bf_sde_mock_, CreateSession()).WillOnce(Return(session_mock));
+  EXPECT_CALL(*bfrt_table_manager_mock_,
+              PrepareTableEntryWrite(::p4::v1::Update::INSERT, _, _, _))
+      .WillRepeatedly(Invoke([](const ::p4::v1::Update::Type type,
+                                const ::p4::v1::TableEntry& table_entry,
+                                google::protobuf::Arena* arena,
+                                BfrtTableManager::TableEntryWrite* write)
+                         -> ::util::Status {
+        if (table_entry.table_id() == 1) {
+          return ::util::Status(StratumErrorSpace(), ERR_INVALID_PARAM,
+                                "Bad entry.");
+        }
+        return ::util::OkStatus();
+      }));
+  // The failed entry must not reach the SDE.
+  EXPECT_CALL(*bfrt_table_manager_mock_, CommitTableEntryWrite(session_mock, _))
+      .WillOnce(Return(::util::OkStatus()));
+
+  std::vector<::util::Status> results = {};
+  ::util::Status ret = WriteForwardingEntries(req, &results);
+  ASSERT_FALSE(ret.ok());
+  EXPECT_EQ(ERR_AT_LEAST_ONE_OPER_FAILED, ret.error_code());
+  ASSERT_EQ(2U, results.size());
+  EXPECT_EQ(ERR_INVALID_PARAM, results[0].error_code());
+  EXPECT_OK(results[1]);
+}
+
 TEST_F(BfrtNodeTest, WriteForwardingEntriesSuccess_InsertActionProfileMember) {
   ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
   ASSERT_NO_FATAL_FAILURE(PushForwardingPipelineConfigWithCheck());
@@ -1410,6 +1514,57 @@ TEST_F(BfrtNodeTest, ReadForwardingEntriesSuccess_TableEntry) {
   EXPECT_EQ(1U, results.size());
 }
 
+// A wildcard table read pages through the table with the last read entry as
+// the cursor, so writes to the table must wait until the read is done.
+TEST_F(BfrtNodeTest, ReadForwardingEntries_WildcardReadBlocksTableWrites) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+  ASSERT_NO_FATAL_FAILURE(PushForwardingPipelineConfigWithCheck());
+  constexpr uint32 kTableId = 33583783;
+
+  ::p4::v1::ReadRequest read_req;
+  SetupTableEntryToRead(&read_req, kNodeId)->set_table_id(kTableId);
+  ::p4::v1::WriteRequest write_req;
+  SetupTableEntryToDelete(&write_req, kNodeId)->set_table_id(kTableId);
+
+  std::shared_ptr<BfSdeInterface::SessionInterface> session_mock =
+      std::make_shared<SessionMock>();
+  EXPECT_CALL(*bf_sde_mock_, CreateSession())
+      .WillRepeatedly(Return(session_mock));
+  absl::Notification read_started;
+  absl::Notification read_released;
+  absl::Notification write_done;
+  EXPECT_CALL(*bfrt_table_manager_mock_, ReadTableEntry(session_mock, _, _))
+      .WillOnce(Invoke([&](std::shared_ptr<BfSdeInterface::SessionInterface>,
+                           const ::p4::v1::TableEntry&,
+                           WriterInterface<::p4::v1::ReadResponse>*) {
+        read_started.Notify();
+        read_released.WaitForNotification();
+        EXPECT_FALSE(write_done.HasBeenNotified());
+        return ::util::OkStatus();
+      }));
+  EXPECT_CALL(*bfrt_table_manager_mock_,
+              WriteTableEntry(session_mock, ::p4::v1::Update::DELETE, _))
+      .WillOnce(Return(::util::OkStatus()));
+
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+  std::thread reader([&]() {
+    std::vector<::util::Status> details;
+    EXPECT_OK(ReadForwardingEntries(read_req, &writer_mock, &details));
+  });
+  read_started.WaitForNotification();
+  std::thread writer([&]() {
+    std::vector<::util::Status> results;
+    EXPECT_OK(WriteForwardingEntries(write_req, &results));
+    write_done.Notify();
+  });
+  // The write must not overtake the read.
+  EXPECT_FALSE(write_done.WaitForNotificationWithTimeout(absl::Seconds(1)));
+  read_released.Notify();
+  reader.join();
+  writer.join();
+  EXPECT_TRUE(write_done.HasBeenNotified());
+}
+
 // RegisterStreamMessageResponseWriter() should forward the call to
 // BfrtPacketioManager and return success or error based on the returned result.
 TEST_F(BfrtNodeTest, RegisterStreamMessageResponseWriter) {
@@ -3,6 +3,9 @@
 
 #include "stratum/hal/lib/barefoot/bfrt_p4runtime_translator.h"
 
+#include <string>
+#include <utility>
+
 #include "gflags/gflags.h"
 #include "stratum/glue/gtl/map_util.h"
 #include "stratum/glue/gtl/stl_util.h"
@@ -18,6 +21,15 @@ namespace stratum {
 namespace hal {
 namespace barefoot {
 
+namespace {
+
+// Translation plans are indexed by field ID. P4 compilers assign match field
+// and action parameter IDs sequentially, this bound only guards against
+// pathological P4Infos.
+constexpr uint32 kMaxTranslatedFieldId = 1 << 16;
+
+}  // namespace
+
 ::util::Status BfrtP4RuntimeTranslator::PushChassisConfig(
     const ChassisConfig& config, uint64 node_id) {
   ::absl::WriterMutexLock l(&lock_);
@@ -90,36 +102,49 @@ namespace barefoot {
   // Types that support P4Runtime translation:
   // Table.MatchField, Action.Param, ControllerPacketMetadata.Metadata
   // Counter, Meter, Register (index)
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, std::string>>
-      table_to_field_to_type_uri;
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, std::string>>
-      action_to_param_to_type_uri;
+  absl::flat_hash_map<uint32, TranslationPlan> table_translation_plans;
+  absl::flat_hash_map<uint32, TranslationPlan> action_translation_plans;
   absl::flat_hash_map<uint32, std::string> packet_in_meta_to_type_uri;
   absl::flat_hash_map<uint32, std::string> packet_out_meta_to_type_uri;
   absl::flat_hash_map<uint32, std::string> counter_to_type_uri;
   absl::flat_hash_map<uint32, std::string> meter_to_type_uri;
   absl::flat_hash_map<uint32, std::string> register_to_type_uri;
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, int32>>
-      table_to_field_to_bit_width;
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, int32>>
-      action_to_param_to_bit_width;
   absl::flat_hash_map<uint32, int32> packet_in_meta_to_bit_width;
   absl::flat_hash_map<uint32, int32> packet_out_meta_to_bit_width;
 
+  // Adds the translation of a field of the given type to a plan, if the type
+  // is translated.
+  auto add_to_plan = [&type_name_to_uri, &type_name_to_bit_width](
+                         const std::string& type_name, uint32 field_id,
+                         TranslationPlan* plan) -> ::util::Status {
+    const std::string* uri = gtl::FindOrNull(type_name_to_uri, type_name);
+    if (!uri) return ::util::OkStatus();
+    RET_CHECK(field_id < kMaxTranslatedFieldId)
+        << "Translated field ID " << field_id << " is too large.";
+    if (plan->fields.size() <= field_id) plan->fields.resize(field_id + 1);
+    FieldTranslation* field = &plan->fields[field_id];
+    field->uri = *uri;
+    field->sdn_bit_width =
+        gtl::FindWithDefault(type_name_to_bit_width, type_name, 0);
+    field->sdk_bit_width = gtl::FindWithDefault(kUriToBitWidth, *uri, 0);
+    if (field->sdn_bit_width) {
+      field->sdn_all_ones_mask = AllOnesByteString(field->sdn_bit_width);
+    }
+    if (field->sdk_bit_width) {
+      field->sdk_all_ones_mask = AllOnesByteString(field->sdk_bit_width);
+    }
+    return ::util::OkStatus();
+  };
   for (const auto& table : p4info.tables()) {
     for (const auto& match_field : table.match_fields()) {
       if (match_field.has_type_name()) {
         const auto& type_name = match_field.type_name().name();
-        const auto& table_id = table.preamble().id();
-        const auto& match_field_id = match_field.id();
         std::string* uri = gtl::FindOrNull(type_name_to_uri, type_name);
         if (uri) {
           RET_CHECK(kUriToBitWidth.contains(*uri));
-          table_to_field_to_type_uri[table_id][match_field_id] = *uri;
-        }
-        int32* bit_width = gtl::FindOrNull(type_name_to_bit_width, type_name);
-        if (bit_width) {
-          table_to_field_to_bit_width[table_id][match_field_id] = *bit_width;
+          RETURN_IF_ERROR(
+              add_to_plan(type_name, match_field.id(),
+                          &table_translation_plans[table.preamble().id()]));
         }
       }
     }
@@ -128,15 +153,10 @@ namespace barefoot {
     for (const auto& param : action.params()) {
       if (param.has_type_name()) {
         const auto& type_name = param.type_name().name();
-        const auto& action_id = action.preamble().id();
-        const auto& param_id = param.id();
-        std::string* uri = gtl::FindOrNull(type_name_to_uri, type_name);
-        if (uri) {
-          action_to_param_to_type_uri[action_id][param_id] = *uri;
-        }
-        int32* bit_width = gtl::FindOrNull(type_name_to_bit_width, type_name);
-        if (bit_width) {
-          action_to_param_to_bit_width[action_id][param_id] = *bit_width;
+        if (type_name_to_uri.contains(type_name)) {
+          RETURN_IF_ERROR(
+              add_to_plan(type_name, param.id(),
+                          &action_translation_plans[action.preamble().id()]));
         }
       }
     }
@@ -201,15 +221,13 @@ namespace barefoot {
       }
     }
   }
-  table_to_field_to_type_uri_ = table_to_field_to_type_uri;
-  action_to_param_to_type_uri_ = action_to_param_to_type_uri;
+  table_translation_plans_ = std::move(table_translation_plans);
+  action_translation_plans_ = std::move(action_translation_plans);
   packet_in_meta_to_type_uri_ = packet_in_meta_to_type_uri;
   packet_out_meta_to_type_uri_ = packet_out_meta_to_type_uri;
   counter_to_type_uri_ = counter_to_type_uri;
   meter_to_type_uri_ = meter_to_type_uri;
   register_to_type_uri_ = register_to_type_uri;
-  table_to_field_to_bit_width_ = table_to_field_to_bit_width;
-  action_to_param_to_bit_width_ = action_to_param_to_bit_width;
   packet_in_meta_to_bit_width_ = packet_in_meta_to_bit_width;
   packet_out_meta_to_bit_width_ = packet_out_meta_to_bit_width;
   pipeline_require_translation_ = true;
@@ -220,37 +238,76 @@ namespace barefoot {
 BfrtP4RuntimeTranslator::TranslateTableEntry(const ::p4::v1::TableEntry& entry,
                                              bool to_sdk) {
   absl::ReaderMutexLock l(&lock_);
-  if (!pipeline_require_translation_) {
+  if (!TableEntryRequiresTranslationInternal(entry)) {
     return entry;
   }
-  return TranslateTableEntryInternal(entry, to_sdk);
+  ::p4::v1::TableEntry translated_entry(entry);
+  RETURN_IF_ERROR(
+      TranslateTableEntryInPlaceInternal(&translated_entry, to_sdk));
+  return translated_entry;
 }
 
-::util::StatusOr<::p4::v1::TableEntry>
-BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
-    const ::p4::v1::TableEntry& entry, bool to_sdk) {
-  ::p4::v1::TableEntry translated_entry(entry);
-  const auto& table_id = translated_entry.table_id();
-  if (table_to_field_to_type_uri_.contains(table_id) &&
-      table_to_field_to_bit_width_.contains(table_id)) {
-    for (::p4::v1::FieldMatch& field_match :
-         *translated_entry.mutable_match()) {
-      const auto& field_id = field_match.field_id();
-      std::string* uri =
-          gtl::FindOrNull(table_to_field_to_type_uri_[table_id], field_id);
-      if (!uri) {
+bool BfrtP4RuntimeTranslator::TableEntryRequiresTranslation(
+    const ::p4::v1::TableEntry& entry) {
+  absl::ReaderMutexLock l(&lock_);
+  return TableEntryRequiresTranslationInternal(entry);
+}
+
+::util::Status BfrtP4RuntimeTranslator::TranslateTableEntryInPlace(
+    ::p4::v1::TableEntry* entry, bool to_sdk) {
+  RET_CHECK(entry);
+  absl::ReaderMutexLock l(&lock_);
+  if (!TableEntryRequiresTranslationInternal(*entry)) {
+    return ::util::OkStatus();
+  }
+  return TranslateTableEntryInPlaceInternal(entry, to_sdk);
+}
+
+bool BfrtP4RuntimeTranslator::TableActionRequiresTranslation(
+    const ::p4::v1::TableAction& action) const {
+  switch (action.type_case()) {
+    case ::p4::v1::TableAction::kAction:
+      return action_translation_plans_.contains(action.action().action_id());
+    case ::p4::v1::TableAction::kActionProfileActionSet:
+      for (const auto& action_profile_action :
+           action.action_profile_action_set().action_profile_actions()) {
+        if (action_translation_plans_.contains(
+                action_profile_action.action().action_id())) {
+          return true;
+        }
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+bool BfrtP4RuntimeTranslator::TableEntryRequiresTranslationInternal(
+    const ::p4::v1::TableEntry& entry) const {
+  // Most tables have no translated fields, skip the work for them.
+  return pipeline_require_translation_ &&
+         (table_translation_plans_.contains(entry.table_id()) ||
+          TableActionRequiresTranslation(entry.action()));
+}
+
+::util::Status BfrtP4RuntimeTranslator::TranslateTableEntryInPlaceInternal(
+    ::p4::v1::TableEntry* entry, bool to_sdk) {
+  const TranslationPlan* table_plan =
+      gtl::FindOrNull(table_translation_plans_, entry->table_id());
+  if (table_plan) {
+    for (::p4::v1::FieldMatch& field_match : *entry->mutable_match()) {
+      const FieldTranslation* field = table_plan->Find(field_match.field_id());
+      if (!field) {
         continue;
       }
-      int32 from_bit_width = 0;
-      int32 to_bit_width = 0;
-      if (to_sdk) {
-        from_bit_width = gtl::FindWithDefault(
-            table_to_field_to_bit_width_[table_id], field_id, 0);
-        to_bit_width = gtl::FindWithDefault(kUriToBitWidth, *uri, 0);
-      } else {
-        from_bit_width = gtl::FindWithDefault(kUriToBitWidth, *uri, 0);
-        to_bit_width = gtl::FindWithDefault(
-            table_to_field_to_bit_width_[table_id], field_id, 0);
+      const std::string& uri = field->uri;
+      int32 from_bit_width = field->sdn_bit_width;
+      int32 to_bit_width = field->sdk_bit_width;
+      const std::string* from_all_ones_mask = &field->sdn_all_ones_mask;
+      const std::string* to_all_ones_mask = &field->sdk_all_ones_mask;
+      if (!to_sdk) {
+        std::swap(from_bit_width, to_bit_width);
+        std::swap(from_all_ones_mask, to_all_ones_mask);
       }
       if (!from_bit_width || !to_bit_width) {
         continue;
@@ -258,7 +315,7 @@ BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
       switch (field_match.field_match_type_case()) {
         case ::p4::v1::FieldMatch::kExact: {
           ASSIGN_OR_RETURN(const std::string& new_val,
-                           TranslateValue(field_match.exact().value(), *uri,
+                           TranslateValue(field_match.exact().value(), uri,
                                           to_sdk, to_bit_width));
           field_match.mutable_exact()->set_value(new_val);
           break;
@@ -266,15 +323,13 @@ BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
         case ::p4::v1::FieldMatch::kTernary: {
           // We only allow the "exact" type of ternary match, which means
           // all bits from mask must be one.
-          RET_CHECK(field_match.ternary().mask() ==
-                    AllOnesByteString(from_bit_width));
+          RET_CHECK(field_match.ternary().mask() == *from_all_ones_mask);
           // New mask with bit width.
           ASSIGN_OR_RETURN(const std::string& new_val,
-                           TranslateValue(field_match.ternary().value(), *uri,
+                           TranslateValue(field_match.ternary().value(), uri,
                                           to_sdk, to_bit_width));
           field_match.mutable_ternary()->set_value(new_val);
-          field_match.mutable_ternary()->set_mask(
-              AllOnesByteString(to_bit_width));
+          field_match.mutable_ternary()->set_mask(*to_all_ones_mask);
           break;
         }
         case ::p4::v1::FieldMatch::kLpm: {
@@ -282,7 +337,7 @@ BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
           // length must same as the bit width of the field.
           RET_CHECK(field_match.lpm().prefix_len() == from_bit_width);
           ASSIGN_OR_RETURN(const std::string& new_val,
-                           TranslateValue(field_match.lpm().value(), *uri,
+                           TranslateValue(field_match.lpm().value(), uri,
                                           to_sdk, to_bit_width));
           field_match.mutable_lpm()->set_value(new_val);
           field_match.mutable_lpm()->set_prefix_len(to_bit_width);
@@ -293,7 +348,7 @@ BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
           // and high value must be the same.
           RET_CHECK(field_match.range().low() == field_match.range().high());
           ASSIGN_OR_RETURN(const std::string& new_val,
-                           TranslateValue(field_match.range().low(), *uri,
+                           TranslateValue(field_match.range().low(), uri,
                                           to_sdk, to_bit_width));
           field_match.mutable_range()->set_low(new_val);
           field_match.mutable_range()->set_high(new_val);
@@ -301,7 +356,7 @@ BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
         }
         case ::p4::v1::FieldMatch::kOptional: {
           ASSIGN_OR_RETURN(const std::string& new_val,
-                           TranslateValue(field_match.optional().value(), *uri,
+                           TranslateValue(field_match.optional().value(), uri,
                                           to_sdk, to_bit_width));
           field_match.mutable_optional()->set_value(new_val);
           break;
@@ -314,28 +369,26 @@ BfrtP4RuntimeTranslator::TranslateTableEntryInternal(
     }
   }
 
-  switch (translated_entry.action().type_case()) {
+  switch (entry->action().type_case()) {
     case ::p4::v1::TableAction::kAction: {
-      ASSIGN_OR_RETURN(
-          *(translated_entry.mutable_action()->mutable_action()),
-          TranslateAction(translated_entry.action().action(), to_sdk));
+      RETURN_IF_ERROR(TranslateActionInPlace(
+          entry->mutable_action()->mutable_action(), to_sdk));
       break;
     }
     case ::p4::v1::TableAction::kActionProfileActionSet: {
-      auto* action_set = translated_entry.mutable_action()
-                             ->mutable_action_profile_action_set();
+      auto* action_set =
+          entry->mutable_action()->mutable_action_profile_action_set();
       for (::p4::v1::ActionProfileAction& action_profile_action :
            *action_set->mutable_action_profile_actions()) {
-        ASSIGN_OR_RETURN(
-            *(action_profile_action.mutable_action()),
-            TranslateAction(action_profile_action.action(), to_sdk));
+        RETURN_IF_ERROR(TranslateActionInPlace(
+            action_profile_action.mutable_action(), to_sdk));
       }
       break;
     }
     default:
       break;
   }
-  return translated_entry;
+  return ::util::OkStatus();
 }
 
 ::util::StatusOr<::p4::v1::ActionProfileMember>
@@ -345,12 +398,12 @@ BfrtP4RuntimeTranslator::TranslateActionProfileMember(
   if (!pipeline_require_translation_) {
     return act_prof_mem;
   }
-  ::p4::v1::ActionProfileMember translated_apm;
-  translated_apm.CopyFrom(act_prof_mem);
-  const auto& action_profile_id = act_prof_mem.action_profile_id();
-  const auto& member_id = act_prof_mem.member_id();
-  ASSIGN_OR_RETURN(*(translated_apm.mutable_action()),
-                   TranslateAction(translated_apm.action(), to_sdk));
+  if (!action_translation_plans_.contains(act_prof_mem.action().action_id())) {
+    return act_prof_mem;
+  }
+  ::p4::v1::ActionProfileMember translated_apm(act_prof_mem);
+  RETURN_IF_ERROR(
+      TranslateActionInPlace(translated_apm.mutable_action(), to_sdk));
   return translated_apm;
 }
 
@@ -378,8 +431,10 @@ BfrtP4RuntimeTranslator::TranslateDirectMeterEntry(
     return entry;
   }
   ::p4::v1::DirectMeterEntry translated_entry(entry);
-  ASSIGN_OR_RETURN(*translated_entry.mutable_table_entry(),
-                   TranslateTableEntryInternal(entry.table_entry(), to_sdk));
+  if (TableEntryRequiresTranslationInternal(entry.table_entry())) {
+    RETURN_IF_ERROR(TranslateTableEntryInPlaceInternal(
+        translated_entry.mutable_table_entry(), to_sdk));
+  }
   return translated_entry;
 }
 
@@ -433,8 +488,10 @@ BfrtP4RuntimeTranslator::TranslateDirectCounterEntry(
     return entry;
   }
   ::p4::v1::DirectCounterEntry translated_entry(entry);
-  ASSIGN_OR_RETURN(*translated_entry.mutable_table_entry(),
-                   TranslateTableEntryInternal(entry.table_entry(), to_sdk));
+  if (TableEntryRequiresTranslationInternal(entry.table_entry())) {
+    RETURN_IF_ERROR(TranslateTableEntryInPlaceInternal(
+        translated_entry.mutable_table_entry(), to_sdk));
+  }
   return translated_entry;
 }
 
@@ -637,34 +694,29 @@ BfrtP4RuntimeTranslator::TranslateP4Info(
   return translated_p4info;
 }
 
-::util::StatusOr<::p4::v1::Action> BfrtP4RuntimeTranslator::TranslateAction(
-    const ::p4::v1::Action& action, bool to_sdk) {
-  ::p4::v1::Action translated_action;
-  translated_action.CopyFrom(action);
-  const auto& action_id = action.action_id();
-  if (action_to_param_to_type_uri_.contains(action_id) &&
-      action_to_param_to_bit_width_.contains(action_id)) {
-    for (::p4::v1::Action_Param& param : *translated_action.mutable_params()) {
-      const auto& param_id = param.param_id();
-      std::string* uri =
-          gtl::FindOrNull(action_to_param_to_type_uri_[action_id], param_id);
-      int32 to_bit_width = 0;
-      if (to_sdk && uri) {
-        to_bit_width = gtl::FindWithDefault(kUriToBitWidth, *uri, 0);
-      } else {
-        to_bit_width = gtl::FindWithDefault(
-            action_to_param_to_bit_width_[action_id], param_id, 0);
-      }
-      if (uri && to_bit_width) {
-        ASSIGN_OR_RETURN(
-            const std::string& new_val,
-            TranslateValue(param.value(), *uri, to_sdk, to_bit_width));
-        param.set_value(new_val);
-      }  // else, we don't modify the value if it doesn't need to be
-         // translated.
+::util::Status BfrtP4RuntimeTranslator::TranslateActionInPlace(
+    ::p4::v1::Action* action, bool to_sdk) {
+  const TranslationPlan* action_plan =
+      gtl::FindOrNull(action_translation_plans_, action->action_id());
+  if (!action_plan) {
+    return ::util::OkStatus();
+  }
+  for (::p4::v1::Action_Param& param : *action->mutable_params()) {
+    const FieldTranslation* field = action_plan->Find(param.param_id());
+    if (!field) {
+      continue;
     }
+    const int32 to_bit_width =
+        to_sdk ? field->sdk_bit_width : field->sdn_bit_width;
+    if (to_bit_width) {
+      ASSIGN_OR_RETURN(
+          const std::string& new_val,
+          TranslateValue(param.value(), field->uri, to_sdk, to_bit_width));
+      param.set_value(new_val);
+    }  // else, we don't modify the value if it doesn't need to be
+       // translated.
   }
-  return translated_action;
+  return ::util::OkStatus();
 }
 
 ::util::StatusOr<std::string> BfrtP4RuntimeTranslator::TranslateValue(
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
@@ -42,6 +43,16 @@ class BfrtP4RuntimeTranslator {
       const ::p4::config::v1::P4Info& p4info) LOCKS_EXCLUDED(lock_);
   virtual ::util::StatusOr<::p4::v1::TableEntry> TranslateTableEntry(
       const ::p4::v1::TableEntry& entry, bool to_sdk) LOCKS_EXCLUDED(lock_);
+  // Returns true if the given table entry has fields to translate. Entries for
+  // which this returns false are the same on the SDN and the SDK side, and can
+  // be used as they are without going through the translator.
+  virtual bool TableEntryRequiresTranslation(const ::p4::v1::TableEntry& entry)
+      LOCKS_EXCLUDED(lock_);
+  // Translates the given table entry in place. Entries without fields to
+  // translate are left untouched.
+  virtual ::util::Status TranslateTableEntryInPlace(::p4::v1::TableEntry* entry,
+                                                    bool to_sdk)
+      LOCKS_EXCLUDED(lock_);
   virtual ::util::StatusOr<::p4::v1::ActionProfileMember>
   TranslateActionProfileMember(const ::p4::v1::ActionProfileMember& entry,
                                bool to_sdk) LOCKS_EXCLUDED(lock_);
@@ -97,8 +108,49 @@ class BfrtP4RuntimeTranslator {
         pipeline_require_translation_(false),
         bf_sde_interface_(bf_sde_interface),
         device_id_(device_id) {}
-  virtual ::util::StatusOr<::p4::v1::TableEntry> TranslateTableEntryInternal(
-      const ::p4::v1::TableEntry& entry, bool to_sdk)
+
+  // Translation of a single match field or action parameter.
+  struct FieldTranslation {
+    // URI of the translated type, empty if the field is not translated.
+    std::string uri;
+    // Bit widths of the field on the SDN (controller) and SDK side.
+    int32 sdn_bit_width = 0;
+    int32 sdk_bit_width = 0;
+    // All-ones masks of the above bit widths, used for ternary matches.
+    std::string sdn_all_ones_mask;
+    std::string sdk_all_ones_mask;
+  };
+
+  // The translation plan of a table or an action, compiled once when the
+  // pipeline is pushed. Only tables and actions with at least one translated
+  // field have a plan.
+  struct TranslationPlan {
+    // Indexed by match field or action parameter ID.
+    std::vector<FieldTranslation> fields;
+
+    // Returns the translation of the given field, or nullptr if the field is
+    // not translated.
+    const FieldTranslation* Find(uint32 field_id) const {
+      if (field_id >= fields.size() || fields[field_id].uri.empty()) {
+        return nullptr;
+      }
+      return &fields[field_id];
+    }
+  };
+
+  // Returns true if the given table action contains an action that needs to be
+  // translated.
+  bool TableActionRequiresTranslation(const ::p4::v1::TableAction& action) const
+      SHARED_LOCKS_REQUIRED(lock_);
+  // Returns true if the given table entry has fields to translate.
+  bool TableEntryRequiresTranslationInternal(
+      const ::p4::v1::TableEntry& entry) const SHARED_LOCKS_REQUIRED(lock_);
+  // Translates the parameters of the given action in place.
+  ::util::Status TranslateActionInPlace(::p4::v1::Action* action, bool to_sdk)
+      SHARED_LOCKS_REQUIRED(lock_);
+  // Translates the match fields and actions of the given table entry in place.
+  ::util::Status TranslateTableEntryInPlaceInternal(::p4::v1::TableEntry* entry,
+                                                    bool to_sdk)
       SHARED_LOCKS_REQUIRED(lock_);
   virtual ::util::StatusOr<::p4::v1::PacketMetadata> TranslatePacketMetadata(
       const p4::v1::PacketMetadata& packet_metadata, const std::string& uri,
@@ -106,8 +158,6 @@ class BfrtP4RuntimeTranslator {
   virtual ::util::StatusOr<::p4::v1::Replica> TranslateReplica(
       const ::p4::v1::Replica& replica, bool to_sdk)
       SHARED_LOCKS_REQUIRED(lock_);
-  virtual ::util::StatusOr<::p4::v1::Action> TranslateAction(
-      const ::p4::v1::Action& action, bool to_sdk) SHARED_LOCKS_REQUIRED(lock_);
   virtual ::util::StatusOr<::p4::v1::Index> TranslateIndex(
       const ::p4::v1::Index& index, const std::string& uri, bool to_sdk)
       SHARED_LOCKS_REQUIRED(lock_);
@@ -141,10 +191,10 @@ class BfrtP4RuntimeTranslator {
       GUARDED_BY(lock_);
 
   // P4Runtime translation information
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, std::string>>
-      table_to_field_to_type_uri_ GUARDED_BY(lock_);
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, std::string>>
-      action_to_param_to_type_uri_ GUARDED_BY(lock_);
+  absl::flat_hash_map<uint32, TranslationPlan> table_translation_plans_
+      GUARDED_BY(lock_);
+  absl::flat_hash_map<uint32, TranslationPlan> action_translation_plans_
+      GUARDED_BY(lock_);
   absl::flat_hash_map<uint32, std::string> packet_in_meta_to_type_uri_
       GUARDED_BY(lock_);
   absl::flat_hash_map<uint32, std::string> packet_out_meta_to_type_uri_
@@ -154,10 +204,6 @@ class BfrtP4RuntimeTranslator {
   absl::flat_hash_map<uint32, std::string> meter_to_type_uri_ GUARDED_BY(lock_);
   absl::flat_hash_map<uint32, std::string> register_to_type_uri_
       GUARDED_BY(lock_);
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, int32>>
-      table_to_field_to_bit_width_ GUARDED_BY(lock_);
-  absl::flat_hash_map<uint32, absl::flat_hash_map<uint32, int32>>
-      action_to_param_to_bit_width_ GUARDED_BY(lock_);
   absl::flat_hash_map<uint32, int32> packet_in_meta_to_bit_width_
       GUARDED_BY(lock_);
   absl::flat_hash_map<uint32, int32> packet_out_meta_to_bit_width_
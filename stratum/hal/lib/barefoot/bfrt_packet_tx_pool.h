@@ -0,0 +1,105 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_PACKET_TX_POOL_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_PACKET_TX_POOL_H_
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// Keeps track of the DMA packet buffers pre-allocated for each TX ring in use.
+// The buffers are allocated and freed by the caller, the pool only records
+// which of them are not in flight. Packets are spread over the TX rings in a
+// round-robin fashion. Buffer is the SDE packet type, bf_pkt. The class is not
+// thread-safe.
+template <typename Buffer>
+class BfrtPacketTxPool {
+ public:
+  BfrtPacketTxPool(int num_tx_rings, size_t buffer_size)
+      : buffer_size_(buffer_size),
+        free_buffers_(num_tx_rings > 0 ? num_tx_rings : 1),
+        next_tx_ring_(0) {}
+
+  // Adds a buffer used on the given TX ring to the pool.
+  void Add(int tx_ring, Buffer* buffer) {
+    free_buffers_[tx_ring].push_back(buffer);
+    buffer_to_tx_ring_[buffer] = tx_ring;
+  }
+
+  // Returns the TX ring the next packet is sent on.
+  int NextTxRing() {
+    const int tx_ring = next_tx_ring_;
+    next_tx_ring_ = (next_tx_ring_ + 1) % free_buffers_.size();
+    return tx_ring;
+  }
+
+  // Takes a free buffer of the TX ring for a packet of the given size. Returns
+  // nullptr if the packet does not fit into the buffers of the pool or if all
+  // the buffers of the TX ring are in flight. The packet is then sent in a
+  // buffer allocated for it.
+  Buffer* Take(int tx_ring, size_t packet_size) {
+    auto& free_buffers = free_buffers_[tx_ring];
+    if (packet_size > buffer_size_ || free_buffers.empty()) return nullptr;
+    Buffer* buffer = free_buffers.back();
+    free_buffers.pop_back();
+    return buffer;
+  }
+
+  // Puts a buffer which is no longer in flight back into the pool. Returns
+  // false if the buffer is not part of the pool, in which case the caller must
+  // free it.
+  bool Release(Buffer* buffer) {
+    auto it = buffer_to_tx_ring_.find(buffer);
+    if (it == buffer_to_tx_ring_.end()) return false;
+    free_buffers_[it->second].push_back(buffer);
+    return true;
+  }
+
+  // Removes all the buffers from the pool and returns the ones that are not in
+  // flight, so that the caller can free them.
+  std::vector<Buffer*> Clear() {
+    std::vector<Buffer*> buffers;
+    for (auto& free_buffers : free_buffers_) {
+      buffers.insert(buffers.end(), free_buffers.begin(), free_buffers.end());
+      free_buffers.clear();
+    }
+    buffer_to_tx_ring_.clear();
+    return buffers;
+  }
+
+  // Returns the number of buffers of the pool, including the ones in flight.
+  size_t NumBuffers() const { return buffer_to_tx_ring_.size(); }
+
+  // Returns the number of buffers of the TX ring which are not in flight.
+  size_t NumFreeBuffers(int tx_ring) const {
+    return free_buffers_[tx_ring].size();
+  }
+
+  // Returns the number of TX rings in use.
+  int NumTxRings() const { return free_buffers_.size(); }
+
+  // Returns the size of the buffers of the pool.
+  size_t BufferSize() const { return buffer_size_; }
+
+ private:
+  // The size of each buffer. Larger packets are sent in a buffer allocated for
+  // them.
+  size_t buffer_size_;
+  // Map from each buffer of the pool to the TX ring it is used on.
+  absl::flat_hash_map<Buffer*, int> buffer_to_tx_ring_;
+  // The buffers which are not in flight, per TX ring.
+  std::vector<std::vector<Buffer*>> free_buffers_;
+  // The TX ring the next packet is sent on.
+  int next_tx_ring_;
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_PACKET_TX_POOL_H_
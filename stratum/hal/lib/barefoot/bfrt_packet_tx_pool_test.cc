@@ -0,0 +1,102 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_packet_tx_pool.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using ::testing::Contains;
+using ::testing::Not;
+
+// Stands in for the SDE packet buffer type.
+struct FakePacket {};
+
+class BfrtPacketTxPoolTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kBufferSize = 128;
+
+  BfrtPacketTxPoolTest() : pool_(2, kBufferSize) {
+    // Two buffers for each of the two TX rings.
+    pool_.Add(0, &packets_[0]);
+    pool_.Add(0, &packets_[1]);
+    pool_.Add(1, &packets_[2]);
+    pool_.Add(1, &packets_[3]);
+  }
+
+  FakePacket packets_[4];
+  FakePacket unpooled_packet_;
+  BfrtPacketTxPool<FakePacket> pool_;
+};
+
+constexpr size_t BfrtPacketTxPoolTest::kBufferSize;
+
+TEST_F(BfrtPacketTxPoolTest, SpreadsPacketsOverTxRings) {
+  EXPECT_EQ(2, pool_.NumTxRings());
+  EXPECT_EQ(4U, pool_.NumBuffers());
+  EXPECT_EQ(0, pool_.NextTxRing());
+  EXPECT_EQ(1, pool_.NextTxRing());
+  EXPECT_EQ(0, pool_.NextTxRing());
+}
+
+TEST_F(BfrtPacketTxPoolTest, TakeReturnsNullWhenTxRingIsExhausted) {
+  FakePacket* first = pool_.Take(0, kBufferSize);
+  FakePacket* second = pool_.Take(0, kBufferSize);
+  ASSERT_NE(nullptr, first);
+  ASSERT_NE(nullptr, second);
+  EXPECT_NE(first, second);
+  // All the buffers of the ring are in flight, the packet is sent in a newly
+  // allocated buffer.
+  EXPECT_EQ(nullptr, pool_.Take(0, kBufferSize));
+  EXPECT_EQ(0U, pool_.NumFreeBuffers(0));
+  // The other ring is not affected.
+  EXPECT_EQ(2U, pool_.NumFreeBuffers(1));
+  EXPECT_NE(nullptr, pool_.Take(1, kBufferSize));
+}
+
+TEST_F(BfrtPacketTxPoolTest, TakeReturnsNullForOversizePacket) {
+  EXPECT_EQ(nullptr, pool_.Take(0, kBufferSize + 1));
+  EXPECT_EQ(2U, pool_.NumFreeBuffers(0));
+  EXPECT_NE(nullptr, pool_.Take(0, kBufferSize));
+}
+
+TEST_F(BfrtPacketTxPoolTest, ReleasedBufferIsReused) {
+  // The same path is taken on TX completion and when sending the packet
+  // failed.
+  FakePacket* pkt = pool_.Take(1, 64);
+  ASSERT_NE(nullptr, pkt);
+  EXPECT_EQ(1U, pool_.NumFreeBuffers(1));
+  EXPECT_TRUE(pool_.Release(pkt));
+  EXPECT_EQ(2U, pool_.NumFreeBuffers(1));
+  EXPECT_EQ(pkt, pool_.Take(1, 64));
+}
+
+TEST_F(BfrtPacketTxPoolTest, ReleaseOfUnpooledBufferFails) {
+  // Buffers allocated for a single packet are freed by the caller.
+  EXPECT_FALSE(pool_.Release(&unpooled_packet_));
+  EXPECT_EQ(2U, pool_.NumFreeBuffers(0));
+  EXPECT_EQ(2U, pool_.NumFreeBuffers(1));
+}
+
+TEST_F(BfrtPacketTxPoolTest, ClearReturnsBuffersNotInFlight) {
+  FakePacket* in_flight = pool_.Take(0, kBufferSize);
+  ASSERT_NE(nullptr, in_flight);
+  std::vector<FakePacket*> free_buffers = pool_.Clear();
+  EXPECT_EQ(3U, free_buffers.size());
+  EXPECT_THAT(free_buffers, Not(Contains(in_flight)));
+  EXPECT_EQ(0U, pool_.NumBuffers());
+  // A buffer completing after the pool was cleared is freed by the caller.
+  EXPECT_FALSE(pool_.Release(in_flight));
+}
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -17,12 +17,15 @@
 #include <linux/if_tun.h>
 #include <sys/epoll.h>
 
+#include <algorithm>
 #include <deque>
 #include <string>
+#include <vector>
 
 #include "stratum/glue/gtl/map_util.h"
 #include "stratum/hal/lib/common/constants.h"
 #include "stratum/hal/lib/p4/utils.h"
+#include "stratum/lib/channel/lock_free_channel.h"
 #include "stratum/lib/utils.h"
 
 DEFINE_string(
@@ -35,6 +38,15 @@ DEFINE_string(
     "interface are delivered verbatim to the pipeline over the PCIe CPU port.");
 DEFINE_int32(experimental_tap_rx_poll_timeout_ms, 100,
              "Polling timeout to check incoming packets from TAP RX sockets.");
+DEFINE_int32(experimental_tap_max_num_packets_to_read_at_once, 32,
+             "Max number of packets read from the TAP interface and sent to "
+             "the PCIe CPU port each time the interface becomes readable.");
+DEFINE_int32(bfrt_packet_rx_queue_depth, 1024,
+             "Max number of packets buffered between the SDE RX callback and "
+             "the PacketIn handler thread. Packets beyond that are dropped.");
+DEFINE_int32(bfrt_packet_rx_batch_size, 64,
+             "Max number of packets the PacketIn handler thread processes and "
+             "hands over to the receive writer in a single batch.");
 
 namespace stratum {
 namespace hal {
@@ -53,10 +65,10 @@ namespace {
   int fd = -1;
   if (PathExists(barefoot_tun_device_path)) {
     // We're on a Tofino switch. Use the patched TUN/TAP driver.
-    fd = open(barefoot_tun_device_path, O_RDWR);
+    fd = open(barefoot_tun_device_path, O_RDWR | O_NONBLOCK);
   } else {
     // We're on a normal UNIX device. Use canonical TUN/TAP driver.
-    fd = open(canonical_tun_device_path, O_RDWR);
+    fd = open(canonical_tun_device_path, O_RDWR | O_NONBLOCK);
   }
 
   RET_CHECK(fd >= 0) << "Failed to open: " << strerror(errno);
@@ -129,6 +141,7 @@ BfrtPacketioManager::BfrtPacketioManager(
       packetin_header_size_(),
       packetout_header_size_(),
       packet_receive_channel_(nullptr),
+      packet_rx_buffer_pool_(nullptr),
       tap_intf_fd_(-1),
       sde_rx_thread_id_(),
       virtual_cpu_intf_rx_thread_id_(),
@@ -144,6 +157,7 @@ BfrtPacketioManager::BfrtPacketioManager()
       packetin_header_size_(),
       packetout_header_size_(),
       packet_receive_channel_(nullptr),
+      packet_rx_buffer_pool_(nullptr),
       tap_intf_fd_(-1),
       sde_rx_thread_id_(),
       virtual_cpu_intf_rx_thread_id_(),
@@ -176,7 +190,18 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
   // PushForwardingPipelineConfig resets the bf_pkt driver.
   RETURN_IF_ERROR(bf_sde_interface_->StartPacketIo(device_));
   if (!initialized_) {
-    packet_receive_channel_ = Channel<std::string>::Create(128);
+    RET_CHECK(FLAGS_bfrt_packet_rx_queue_depth > 0)
+        << "Invalid bfrt_packet_rx_queue_depth: "
+        << FLAGS_bfrt_packet_rx_queue_depth << ".";
+    RET_CHECK(FLAGS_bfrt_packet_rx_batch_size > 0)
+        << "Invalid bfrt_packet_rx_batch_size: "
+        << FLAGS_bfrt_packet_rx_batch_size << ".";
+    packet_receive_channel_ =
+        LockFreeChannel<std::string>::Create(FLAGS_bfrt_packet_rx_queue_depth);
+    // Enough buffers for a full channel plus the batch being processed.
+    packet_rx_buffer_pool_ =
+        std::make_shared<BfSdeInterface::PacketRxBufferPool>(
+            FLAGS_bfrt_packet_rx_queue_depth + FLAGS_bfrt_packet_rx_batch_size);
     if (sde_rx_thread_id_ == 0) {
       int ret = pthread_create(&sde_rx_thread_id_, nullptr,
                                &BfrtPacketioManager::SdeRxThreadFunc, this);
@@ -187,7 +212,8 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
       }
     }
     RETURN_IF_ERROR(bf_sde_interface_->RegisterPacketReceiveWriter(
-        device_, ChannelWriter<std::string>::Create(packet_receive_channel_)));
+        device_, ChannelWriter<std::string>::Create(packet_receive_channel_),
+        packet_rx_buffer_pool_));
     // Bind to provided interface and start rx/tx handler.
     if (!FLAGS_experimental_bfrt_tofino_virtual_cpu_interface_name.empty()) {
       ASSIGN_OR_RETURN(
@@ -240,6 +266,7 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
     packetin_header_size_ = 0;
     packetout_header_size_ = 0;
     packet_receive_channel_.reset();
+    packet_rx_buffer_pool_.reset();
     initialized_ = false;
   }
   // TODO(max): we release the locks between closing the channel and joining the
@@ -438,6 +465,19 @@ class BitBuffer {
   return ::util::OkStatus();
 }
 
+BfrtPacketioRxStats BfrtPacketioManager::GetRxStats() const {
+  BfrtPacketioRxStats stats;
+  {
+    absl::ReaderMutexLock l(&rx_stats_lock_);
+    stats = rx_stats_;
+  }
+  absl::ReaderMutexLock l(&data_lock_);
+  if (packet_rx_buffer_pool_) {
+    stats.rx_drops_channel_full = packet_rx_buffer_pool_->GetNumDropped();
+  }
+  return stats;
+}
+
 namespace {
 
 ::util::Status HasPacketInMagicBytes(const std::string& buffer) {
@@ -486,7 +526,12 @@ namespace {
            << "epoll_ctl() failed. errno: " << errno << ".";
   }
 
+  // The frames are read into a buffer of the max size and copied to a second
+  // one of the frame size, which avoids clearing the big buffer per frame.
+  std::string rx_buf(kMaxRxBufferSize, 0);
   std::string buf;
+  const int max_num_packets =
+      std::max(1, FLAGS_experimental_tap_max_num_packets_to_read_at_once);
   while (true) {
     // This is the graceful shutdown check.
     {
@@ -501,22 +546,11 @@ namespace {
       VLOG(1) << "Error in epoll_wait(). errno: " << errno << ".";
       continue;  // let it retry
     } else if (ret > 0 && pevents[0].events & EPOLLIN) {
-      buf.resize(kMaxRxBufferSize);  // Pad with zeros.
-      ret = read(fd, &buf[0], buf.size());
-      if (ret < 0) {
-        LOG(ERROR) << "Read from TAP interface failed: " << strerror(errno)
-                   << ".";
-        continue;
-      }
-      if (ret == 0) {
-        LOG(ERROR) << "Read zero bytes TAP interface?";
-        continue;
-      }
-      buf.resize(ret);  // Trim trailing zero bytes.
-      RETURN_IF_ERROR(bf_sde_interface_->TxPacket(device_, buf));
-      VLOG(1)
-          << "Read " << ret
-          << " byte packet from TAP interface and sent it to PCIe CPU port.";
+      // Drain up to max_num_packets frames before we check for the exit
+      // criteria again.
+      RETURN_IF_ERROR(TransmitVirtualCpuIntfPackets(fd, max_num_packets,
+                                                    &rx_buf, &buf)
+                          .status());
     }
   }
 
@@ -525,6 +559,34 @@ namespace {
   return ::util::OkStatus();
 }
 
+::util::StatusOr<int> BfrtPacketioManager::TransmitVirtualCpuIntfPackets(
+    int fd, int max_num_packets, std::string* rx_buf, std::string* buf) {
+  int num_packets = 0;
+  while (num_packets < max_num_packets) {
+    int ret = read(fd, &(*rx_buf)[0], rx_buf->size());
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      // The TAP interface is non-blocking, EAGAIN means it has been drained.
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG(ERROR) << "Read from TAP interface failed: " << strerror(errno)
+                   << ".";
+      }
+      break;
+    }
+    if (ret == 0) {
+      LOG(ERROR) << "Read zero bytes TAP interface?";
+      break;
+    }
+    buf->assign(rx_buf->data(), ret);
+    RETURN_IF_ERROR(bf_sde_interface_->TxPacket(device_, *buf));
+    VLOG(1) << "Read " << ret
+            << " byte packet from TAP interface and sent it to PCIe CPU port.";
+    ++num_packets;
+  }
+
+  return num_packets;
+}
+
 ::util::Status BfrtPacketioManager::HandleSdePacketRx() {
   SetOwnThreadName("HndlSdePktRx");
 
@@ -533,6 +595,7 @@ namespace {
       !FLAGS_experimental_bfrt_tofino_virtual_cpu_interface_name.empty();
 
   std::unique_ptr<ChannelReader<std::string>> reader;
+  std::shared_ptr<BfSdeInterface::PacketRxBufferPool> buffer_pool;
   int fd = -1;  // Copy the fd to avoid locking the mutex inside the loop.
   {
     absl::ReaderMutexLock l(&data_lock_);
@@ -540,56 +603,101 @@ namespace {
       return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized.";
     reader = ChannelReader<std::string>::Create(packet_receive_channel_);
     if (!reader) return MAKE_ERROR(ERR_INTERNAL) << "Failed to create reader.";
+    buffer_pool = packet_rx_buffer_pool_;
     if (virtual_cpu_interface_enabled) {
       RET_CHECK(tap_intf_fd_ > 0) << "TAP interface not initialized";
       fd = tap_intf_fd_;
     }
   }
 
+  const size_t max_batch_size = FLAGS_bfrt_packet_rx_batch_size;
+  std::vector<std::string> buffers(max_batch_size);
+  std::vector<::p4::v1::PacketIn> packet_ins;
+  packet_ins.reserve(max_batch_size);
   while (true) {
     {
       absl::ReaderMutexLock l(&chassis_lock);
       if (shutdown) break;
     }
-    std::string buffer;
-    int code = reader->Read(&buffer, absl::InfiniteDuration()).error_code();
+    // Block for the first packet, then drain whatever else is already queued
+    // up to the batch size without blocking.
+    int code =
+        reader->Read(&buffers[0], absl::InfiniteDuration()).error_code();
     if (code == ERR_CANCELLED) break;
     if (code == ERR_ENTRY_NOT_FOUND) {
       LOG(ERROR) << "Read with infinite timeout failed with ENTRY_NOT_FOUND.";
       continue;
     }
+    size_t batch_size = 1;
+    while (batch_size < max_batch_size &&
+           reader->TryRead(&buffers[batch_size]).ok()) {
+      ++batch_size;
+    }
 
-    // Check if this packet is to be forwarded to the virtual CPU interface.
-    if (virtual_cpu_interface_enabled && !HasPacketInMagicBytes(buffer).ok()) {
-      int ret = write(fd, buffer.data(), buffer.size());
-      if (ret < 0) {
-        LOG(ERROR) << "Write to TAP interface failed: " << ret;
+    BfrtPacketioRxStats stats;
+    stats.rx_packets = batch_size;
+    packet_ins.clear();
+    for (size_t i = 0; i < batch_size; ++i) {
+      const std::string& buffer = buffers[i];
+      // Check if this packet is to be forwarded to the virtual CPU interface.
+      if (virtual_cpu_interface_enabled &&
+          !HasPacketInMagicBytes(buffer).ok()) {
+        int ret = write(fd, buffer.data(), buffer.size());
+        if (ret < 0) {
+          LOG(ERROR) << "Write to TAP interface failed: " << ret;
+          continue;
+        }
+        ++stats.rx_virtual_cpu_intf;
+        VLOG(1)
+            << "Read " << buffer.size()
+            << " byte packet from PCIe CPU port and sent it to TAP interface.";
         continue;
       }
-      VLOG(1)
-          << "Read " << buffer.size()
-          << " byte packet from PCIe CPU port and sent it to TAP interface.";
-      continue;
-    }
 
-    ::p4::v1::PacketIn packet_in;
-    ::util::Status status = ParsePacketIn(buffer, &packet_in);
-    if (!status.ok()) {
-      LOG(ERROR) << "ParsePacketIn failed: " << status;
-      continue;
+      ::p4::v1::PacketIn packet_in;
+      ::util::Status status = ParsePacketIn(buffer, &packet_in);
+      if (!status.ok()) {
+        LOG(ERROR) << "ParsePacketIn failed: " << status;
+        ++stats.rx_drops_metadata_parse_error;
+        continue;
+      }
+      auto translated_packet_in =
+          bfrt_p4runtime_translator_->TranslatePacketIn(packet_in);
+      if (!translated_packet_in.ok()) {
+        LOG(ERROR) << "TranslatePacketIn failed: "
+                   << translated_packet_in.status();
+        ++stats.rx_drops_translation_error;
+        continue;
+      }
+      VLOG(1) << "Handled PacketIn: " << packet_in.ShortDebugString();
+      packet_ins.push_back(translated_packet_in.ConsumeValueOrDie());
     }
-    const auto& translated_packet_in =
-        bfrt_p4runtime_translator_->TranslatePacketIn(packet_in);
-    if (!translated_packet_in.ok()) {
-      LOG(ERROR) << "TranslatePacketIn failed: " << status;
-      continue;
+    // Hand the buffers back to the SDE callback.
+    for (size_t i = 0; i < batch_size; ++i) {
+      buffer_pool->Put(std::move(buffers[i]));
     }
-    {
+
+    if (!packet_ins.empty()) {
       absl::WriterMutexLock l(&rx_writer_lock_);
-      if (rx_writer_ != nullptr)
-        rx_writer_->Write(translated_packet_in.ValueOrDie());
+      const size_t num_packet_ins = packet_ins.size();
+      // On failure, only the PacketIns which were not written are left.
+      if (rx_writer_ != nullptr) rx_writer_->WriteBatch(&packet_ins);
+      stats.rx_accepts = num_packet_ins - packet_ins.size();
+      stats.rx_drops_write_error = packet_ins.size();
+    }
+    {
+      absl::WriterMutexLock l(&rx_stats_lock_);
+      rx_stats_.rx_packets += stats.rx_packets;
+      ++rx_stats_.rx_batches;
+      rx_stats_.rx_max_batch_size =
+          std::max<uint64>(rx_stats_.rx_max_batch_size, batch_size);
+      rx_stats_.rx_virtual_cpu_intf += stats.rx_virtual_cpu_intf;
+      rx_stats_.rx_accepts += stats.rx_accepts;
+      rx_stats_.rx_drops_metadata_parse_error +=
+          stats.rx_drops_metadata_parse_error;
+      rx_stats_.rx_drops_translation_error += stats.rx_drops_translation_error;
+      rx_stats_.rx_drops_write_error += stats.rx_drops_write_error;
     }
-    VLOG(1) << "Handled PacketIn: " << packet_in.ShortDebugString();
   }
 
   return ::util::OkStatus();
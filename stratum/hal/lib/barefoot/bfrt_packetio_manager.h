@@ -12,9 +12,11 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
 #include "stratum/hal/lib/barefoot/bf.pb.h"
 #include "stratum/hal/lib/barefoot/bf_global_vars.h"
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
@@ -27,6 +29,50 @@ namespace stratum {
 namespace hal {
 namespace barefoot {
 
+// The stats of the packets received from the SDE on the PCIe CPU port.
+struct BfrtPacketioRxStats {
+  // All packets read from the packet receive channel.
+  uint64 rx_packets;
+  // Number of batches read from the channel, i.e. wakeups of the RX thread.
+  uint64 rx_batches;
+  // The largest batch read from the channel. As batches drain the channel,
+  // this is the peak queue depth seen by the RX thread.
+  uint64 rx_max_batch_size;
+  // Packets forwarded to the virtual CPU interface.
+  uint64 rx_virtual_cpu_intf;
+  // PacketIns handed over to the registered receive writer.
+  uint64 rx_accepts;
+  // Packets dropped by the SDE callback because the channel was full.
+  uint64 rx_drops_channel_full;
+  // Packets dropped due to metadata parse failures.
+  uint64 rx_drops_metadata_parse_error;
+  // Packets dropped due to PacketIn translation failures.
+  uint64 rx_drops_translation_error;
+  // PacketIns dropped because no writer was registered or the write failed.
+  uint64 rx_drops_write_error;
+  BfrtPacketioRxStats()
+      : rx_packets(0),
+        rx_batches(0),
+        rx_max_batch_size(0),
+        rx_virtual_cpu_intf(0),
+        rx_accepts(0),
+        rx_drops_channel_full(0),
+        rx_drops_metadata_parse_error(0),
+        rx_drops_translation_error(0),
+        rx_drops_write_error(0) {}
+  std::string ToString() const {
+    return absl::StrCat(
+        "(rx_packets:", rx_packets, ", rx_batches:", rx_batches,
+        ", rx_max_batch_size:", rx_max_batch_size,
+        ", rx_virtual_cpu_intf:", rx_virtual_cpu_intf,
+        ", rx_accepts:", rx_accepts,
+        ", rx_drops_channel_full:", rx_drops_channel_full,
+        ", rx_drops_metadata_parse_error:", rx_drops_metadata_parse_error,
+        ", rx_drops_translation_error:", rx_drops_translation_error,
+        ", rx_drops_write_error:", rx_drops_write_error, ")");
+  }
+};
+
 class BfrtPacketioManager {
  public:
   virtual ~BfrtPacketioManager();
@@ -67,6 +113,10 @@ class BfrtPacketioManager {
   virtual ::util::Status TransmitPacket(const ::p4::v1::PacketOut& packet)
       LOCKS_EXCLUDED(data_lock_);
 
+  // Returns a copy of the stats of the packets received from the SDE.
+  virtual BfrtPacketioRxStats GetRxStats() const
+      LOCKS_EXCLUDED(data_lock_, rx_stats_lock_);
+
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BfrtPacketioManager> CreateInstance(
       BfSdeInterface* bf_sde_interface,
@@ -102,13 +152,23 @@ class BfrtPacketioManager {
                                ::p4::v1::PacketIn* packet)
       LOCKS_EXCLUDED(data_lock_);
 
-  // Handles a received packets and hands it over the registered receive writer.
+  // Reads batches of received packets and hands them over to the registered
+  // receive writer.
   ::util::Status HandleSdePacketRx()
-      LOCKS_EXCLUDED(data_lock_, rx_writer_lock_);
+      LOCKS_EXCLUDED(data_lock_, rx_writer_lock_, rx_stats_lock_);
 
   // Handles a received packets and hands it over the registered receive writer.
   ::util::Status HandleVirtualCpuIntfPacketRx() LOCKS_EXCLUDED(data_lock_);
 
+  // Reads up to max_num_packets frames from the non-blocking virtual CPU
+  // interface into rx_buf and sends each of them to the PCIe CPU port, using
+  // buf for the frame. Returns the number of frames sent, which is less than
+  // max_num_packets once the interface has no more frames to read.
+  ::util::StatusOr<int> TransmitVirtualCpuIntfPackets(int fd,
+                                                      int max_num_packets,
+                                                      std::string* rx_buf,
+                                                      std::string* buf);
+
   // SDE CPU interface RX thread function.
   static void* SdeRxThreadFunc(void* arg);
 
@@ -121,6 +181,13 @@ class BfrtPacketioManager {
   // Mutex lock to protect the metadata mappings.
   mutable absl::Mutex data_lock_;
 
+  // Mutex lock for protecting rx_stats_.
+  mutable absl::Mutex rx_stats_lock_;
+
+  // The stats of the packets received from the SDE. Updated once per batch by
+  // the RX thread. rx_drops_channel_full is kept in packet_rx_buffer_pool_.
+  BfrtPacketioRxStats rx_stats_ GUARDED_BY(rx_stats_lock_);
+
   // Initialized to false, set once only on first PushForwardingPipelineConfig.
   bool initialized_ GUARDED_BY(data_lock_);
 
@@ -139,6 +206,10 @@ class BfrtPacketioManager {
   std::shared_ptr<Channel<std::string>> packet_receive_channel_
       GUARDED_BY(data_lock_);
 
+  // Pool of the buffers passed through packet_receive_channel_.
+  std::shared_ptr<BfSdeInterface::PacketRxBufferPool> packet_rx_buffer_pool_
+      GUARDED_BY(data_lock_);
+
   // File descriptor of the virtual TAP port used to simulate a CPU port.
   int tap_intf_fd_ GUARDED_BY(data_lock_);
 
@@ -3,6 +3,13 @@
 
 #include "stratum/hal/lib/barefoot/bfrt_packetio_manager.h"
 
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "absl/synchronization/notification.h"
 #include "gmock/gmock.h"
@@ -24,6 +31,7 @@ using test_utils::StatusIs;
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::HasSubstr;
+using ::testing::InSequence;
 using ::testing::Invoke;
 using ::testing::InvokeWithoutArgs;
 using ::testing::Return;
@@ -54,7 +62,7 @@ class BfrtPacketioManagerTest : public ::testing::Test {
           .WillOnce(Return(util::OkStatus()));
       // - RegisterPacketReceiveWriter of SDE interface will be invoked
       EXPECT_CALL(*bf_sde_wrapper_mock_,
-                  RegisterPacketReceiveWriter(kDevice1, _))
+                  RegisterPacketReceiveWriter(kDevice1, _, _))
           .WillOnce(Invoke(
               this, &BfrtPacketioManagerTest::RegisterPacketReceiveWriter));
     }
@@ -88,12 +96,24 @@ class BfrtPacketioManagerTest : public ::testing::Test {
   // The mock method which help us to initialize a mock packet receive writer
   // so we can use it later.
   ::util::Status RegisterPacketReceiveWriter(
-      int device, std::unique_ptr<ChannelWriter<std::string>> writer) {
+      int device, std::unique_ptr<ChannelWriter<std::string>> writer,
+      std::shared_ptr<BfSdeInterface::PacketRxBufferPool> buffer_pool) {
     EXPECT_EQ(device, kDevice1);
+    EXPECT_NE(nullptr, buffer_pool);
     packet_rx_writer = std::move(writer);
     return ::util::OkStatus();
   }
 
+  // Sends the frames queued on the virtual CPU interface to the CPU port, like
+  // the virtual CPU interface RX thread does when the interface is readable.
+  ::util::StatusOr<int> TransmitVirtualCpuIntfPackets(int fd,
+                                                      int max_num_packets) {
+    std::string rx_buf(1500, 0);
+    std::string buf;
+    return bfrt_packetio_manager_->TransmitVirtualCpuIntfPackets(
+        fd, max_num_packets, &rx_buf, &buf);
+  }
+
   static constexpr int kDevice1 = 0;
   static constexpr char kP4Info[] = R"pb(
     controller_packet_metadata {
@@ -401,6 +421,151 @@ TEST_F(BfrtPacketioManagerTest, MalformedPacketInShouldNotStopRxThread) {
   EXPECT_OK(Shutdown());
 }
 
+TEST_F(BfrtPacketioManagerTest, PacketInBatchUpdatesRxStats) {
+  EXPECT_OK(PushPipelineConfig());
+  auto writer = std::make_shared<WriterMock<::p4::v1::PacketIn>>();
+  EXPECT_OK(bfrt_packetio_manager_->RegisterPacketReceiveWriter(writer));
+  constexpr int kNumValidPackets = 5;
+  auto write_notifier = std::make_shared<absl::Notification>();
+  std::weak_ptr<absl::Notification> weak_ref(write_notifier);
+  int num_writes = 0;
+  EXPECT_CALL(*writer, Write(_))
+      .Times(kNumValidPackets)
+      .WillRepeatedly(
+          Invoke([weak_ref, &num_writes](::p4::v1::PacketIn actual) {
+            if (++num_writes < kNumValidPackets) return true;
+            if (auto notifier = weak_ref.lock()) {
+              notifier->Notify();
+              return true;
+            } else {
+              LOG(ERROR) << "Write notifier expired.";
+              return false;
+            }
+          }));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_, TranslatePacketIn(_))
+      .WillRepeatedly(ReturnArg<0>());
+  const std::string malformed_packet_from_asic("\0", 1);
+  const std::string valid_packet_from_asic(
+      "\0\x80"
+      "abcde",
+      7);
+
+  EXPECT_OK(packet_rx_writer->Write(malformed_packet_from_asic,
+                                    absl::Milliseconds(100)));
+  for (int i = 0; i < kNumValidPackets; ++i) {
+    EXPECT_OK(packet_rx_writer->Write(valid_packet_from_asic,
+                                      absl::Milliseconds(100)));
+  }
+  EXPECT_TRUE(
+      write_notifier->WaitForNotificationWithTimeout(absl::Milliseconds(100)));
+
+  // The stats are updated after the writer returned.
+  BfrtPacketioRxStats stats;
+  for (int i = 0; i < 10; ++i) {
+    stats = bfrt_packetio_manager_->GetRxStats();
+    if (stats.rx_accepts == kNumValidPackets) break;
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(kNumValidPackets + 1, stats.rx_packets);
+  EXPECT_EQ(kNumValidPackets, stats.rx_accepts);
+  EXPECT_EQ(1, stats.rx_drops_metadata_parse_error);
+  EXPECT_EQ(0, stats.rx_drops_translation_error);
+  EXPECT_EQ(0, stats.rx_drops_write_error);
+  EXPECT_EQ(0, stats.rx_drops_channel_full);
+  EXPECT_LE(1, stats.rx_batches);
+  EXPECT_GE(kNumValidPackets + 1, stats.rx_max_batch_size);
+  EXPECT_OK(bfrt_packetio_manager_->UnregisterPacketReceiveWriter());
+  EXPECT_OK(Shutdown());
+}
+
+TEST_F(BfrtPacketioManagerTest, PartialPacketInWriteOnlyCountsUnwritten) {
+  EXPECT_OK(PushPipelineConfig());
+  auto writer = std::make_shared<WriterMock<::p4::v1::PacketIn>>();
+  EXPECT_OK(bfrt_packetio_manager_->RegisterPacketReceiveWriter(writer));
+  constexpr int kNumPackets = 5;
+  constexpr int kNumAccepted = 2;
+  std::atomic<int> num_writes(0);
+  // The writer fails once it has accepted kNumAccepted PacketIns.
+  EXPECT_CALL(*writer, Write(_))
+      .WillRepeatedly(Invoke([&num_writes](::p4::v1::PacketIn actual) {
+        return ++num_writes <= kNumAccepted;
+      }));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_, TranslatePacketIn(_))
+      .WillRepeatedly(ReturnArg<0>());
+  const std::string valid_packet_from_asic(
+      "\0\x80"
+      "abcde",
+      7);
+
+  for (int i = 0; i < kNumPackets; ++i) {
+    EXPECT_OK(packet_rx_writer->Write(valid_packet_from_asic,
+                                      absl::Milliseconds(100)));
+  }
+
+  BfrtPacketioRxStats stats;
+  for (int i = 0; i < 50; ++i) {
+    stats = bfrt_packetio_manager_->GetRxStats();
+    if (stats.rx_accepts + stats.rx_drops_write_error == kNumPackets) break;
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(kNumPackets, stats.rx_packets);
+  EXPECT_EQ(kNumAccepted, stats.rx_accepts);
+  EXPECT_EQ(kNumPackets - kNumAccepted, stats.rx_drops_write_error);
+  EXPECT_OK(bfrt_packetio_manager_->UnregisterPacketReceiveWriter());
+  EXPECT_OK(Shutdown());
+}
+
+TEST_F(BfrtPacketioManagerTest, VirtualCpuIntfDrainsAllFramesPerWakeup) {
+  // A datagram socket keeps the frame boundaries, like the TAP interface.
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds));
+  const std::vector<std::string> frames = {"abc", "defgh", "ij"};
+  {
+    InSequence s;
+    for (const auto& frame : frames) {
+      ASSERT_EQ(static_cast<ssize_t>(frame.size()),
+                write(fds[1], frame.data(), frame.size()));
+      EXPECT_CALL(*bf_sde_wrapper_mock_, TxPacket(kDevice1, frame))
+          .WillOnce(Return(::util::OkStatus()));
+    }
+  }
+
+  ASSERT_OK_AND_ASSIGN(int num_packets,
+                       TransmitVirtualCpuIntfPackets(fds[0], 32));
+  EXPECT_EQ(static_cast<int>(frames.size()), num_packets);
+  // The interface has been drained, the next read stops on EAGAIN.
+  ASSERT_OK_AND_ASSIGN(num_packets, TransmitVirtualCpuIntfPackets(fds[0], 32));
+  EXPECT_EQ(0, num_packets);
+
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_OK(Shutdown());
+}
+
+TEST_F(BfrtPacketioManagerTest, VirtualCpuIntfReadsAtMostMaxFramesPerWakeup) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds));
+  const std::vector<std::string> frames = {"abc", "defgh", "ij"};
+  for (const auto& frame : frames) {
+    ASSERT_EQ(static_cast<ssize_t>(frame.size()),
+              write(fds[1], frame.data(), frame.size()));
+  }
+  EXPECT_CALL(*bf_sde_wrapper_mock_, TxPacket(kDevice1, _))
+      .Times(frames.size())
+      .WillRepeatedly(Return(::util::OkStatus()));
+
+  // The frame left over is read on the next wakeup.
+  ASSERT_OK_AND_ASSIGN(int num_packets,
+                       TransmitVirtualCpuIntfPackets(fds[0], 2));
+  EXPECT_EQ(2, num_packets);
+  ASSERT_OK_AND_ASSIGN(num_packets, TransmitVirtualCpuIntfPackets(fds[0], 2));
+  EXPECT_EQ(1, num_packets);
+
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_OK(Shutdown());
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
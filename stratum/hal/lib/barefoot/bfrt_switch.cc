@@ -191,33 +191,96 @@ BfrtSwitch::~BfrtSwitch() {}
   return bf_chassis_manager_->UnregisterEventNotifyWriter();
 }
 
+namespace {
+
+// Returns true if the request is served by BfChassisManager::GetPortData().
+bool IsPortDataRequest(const DataRequest::Request& request) {
+  switch (request.request_case()) {
+    case DataRequest::Request::kOperStatus:
+    case DataRequest::Request::kAdminStatus:
+    case DataRequest::Request::kMacAddress:
+    case DataRequest::Request::kPortSpeed:
+    case DataRequest::Request::kNegotiatedPortSpeed:
+    case DataRequest::Request::kLacpRouterMac:
+    case DataRequest::Request::kPortCounters:
+    case DataRequest::Request::kForwardingViability:
+    case DataRequest::Request::kHealthIndicator:
+    case DataRequest::Request::kAutonegStatus:
+    case DataRequest::Request::kFrontPanelPortInfo:
+    case DataRequest::Request::kLoopbackStatus:
+    case DataRequest::Request::kSdnPortId:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
 ::util::Status BfrtSwitch::RetrieveValue(uint64 node_id,
                                          const DataRequest& request,
                                          WriterInterface<DataResponse>* writer,
                                          std::vector<::util::Status>* details) {
   absl::ReaderMutexLock l(&chassis_lock);
-  for (const auto& req : request.requests()) {
+  // The port requests are served together by the chassis manager, which reads
+  // the hardware once per port and kind of data. Every port request is mapped
+  // to the position of its response.
+  std::vector<DataRequest::Request> port_requests;
+  std::vector<int> port_response_indices(request.requests_size(), -1);
+  for (int i = 0; i < request.requests_size(); ++i) {
+    if (IsPortDataRequest(request.requests(i))) {
+      port_response_indices[i] = port_requests.size();
+      port_requests.push_back(request.requests(i));
+    }
+  }
+  std::vector<::util::StatusOr<DataResponse>> port_responses;
+  if (!port_requests.empty()) {
+    port_responses = bf_chassis_manager_->GetPortDataBatch(port_requests);
+  }
+  for (int i = 0; i < request.requests_size(); ++i) {
+    const auto& req = request.requests(i);
     DataResponse resp;
     ::util::Status status = ::util::OkStatus();
+    if (port_response_indices[i] >= 0) {
+      const size_t index = port_response_indices[i];
+      if (index >= port_responses.size()) {
+        status = MAKE_ERROR(ERR_INTERNAL) << "Missing response for port request "
+                                          << req.ShortDebugString() << ".";
+      } else if (!port_responses[index].ok()) {
+        status.Update(port_responses[index].status());
+      } else {
+        resp = port_responses[index].ValueOrDie();
+      }
+      if (status.ok()) writer->Write(resp);
+      if (details) details->push_back(status);
+      continue;
+    }
     switch (req.request_case()) {
-      case DataRequest::Request::kOperStatus:
-      case DataRequest::Request::kAdminStatus:
-      case DataRequest::Request::kMacAddress:
-      case DataRequest::Request::kPortSpeed:
-      case DataRequest::Request::kNegotiatedPortSpeed:
-      case DataRequest::Request::kLacpRouterMac:
-      case DataRequest::Request::kPortCounters:
-      case DataRequest::Request::kForwardingViability:
-      case DataRequest::Request::kHealthIndicator:
-      case DataRequest::Request::kAutonegStatus:
-      case DataRequest::Request::kFrontPanelPortInfo:
-      case DataRequest::Request::kLoopbackStatus:
-      case DataRequest::Request::kSdnPortId: {
-        auto port_data = bf_chassis_manager_->GetPortData(req);
-        if (!port_data.ok()) {
-          status.Update(port_data.status());
+      case DataRequest::Request::kNodePacketioDebugInfo: {
+        auto bfrt_node = GetBfrtNodeFromNodeId(
+            req.node_packetio_debug_info().node_id());
+        if (!bfrt_node.ok()) {
+          status.Update(bfrt_node.status());
+          break;
+        }
+        auto debug_string = bfrt_node.ValueOrDie()->DumpPacketioStats();
+        if (!debug_string.ok()) {
+          status.Update(debug_string.status());
+        } else {
+          resp.mutable_node_packetio_debug_info()->set_debug_string(
+              debug_string.ConsumeValueOrDie());
+        }
+        break;
+      }
+      case DataRequest::Request::kNodeCounterSyncDebugInfo: {
+        auto device_id = bf_chassis_manager_->GetDeviceFromNodeId(
+            req.node_counter_sync_debug_info().node_id());
+        if (!device_id.ok()) {
+          status.Update(device_id.status());
         } else {
-          resp = port_data.ConsumeValueOrDie();
+          resp.mutable_node_counter_sync_debug_info()->set_debug_string(
+              bf_sde_interface_->GetCounterSyncStats(device_id.ValueOrDie())
+                  .ToString());
         }
         break;
       }
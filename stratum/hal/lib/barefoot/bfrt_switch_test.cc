@@ -4,6 +4,7 @@
 #include "stratum/hal/lib/barefoot/bfrt_switch.h"
 
 #include <map>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -440,6 +441,101 @@ TEST_F(BfrtSwitchTest, RetrieveValueNodeInfo) {
   EXPECT_EQ(error.ToString(), details.at(0).ToString());
 }
 
+TEST_F(BfrtSwitchTest, RetrieveValueMatchesPortResponsesToRequests) {
+  constexpr char kDebugString[] = "(rx_packets:1)";
+
+  PushChassisConfigSuccess();
+
+  WriterMock<DataResponse> writer;
+  std::vector<DataResponse> responses;
+  EXPECT_CALL(writer, Write(_))
+      .WillRepeatedly(DoAll(WithArg<0>(Invoke([&responses](DataResponse r) {
+                              responses.push_back(r);
+                            })),
+                            Return(true)));
+  EXPECT_CALL(*bfrt_node_mock_, DumpPacketioStats())
+      .WillOnce(Return(std::string(kDebugString)));
+
+  DataRequest req;
+  req.add_requests()->mutable_oper_status()->set_node_id(kNodeId);
+  req.add_requests()->mutable_node_packetio_debug_info()->set_node_id(kNodeId);
+  req.add_requests()->mutable_port_counters()->set_node_id(kNodeId);
+
+  // The port requests are served in one batch, in the order of the request.
+  DataResponse oper_status;
+  oper_status.mutable_oper_status()->set_state(PORT_STATE_UP);
+  DataResponse port_counters;
+  port_counters.mutable_port_counters()->set_in_octets(42);
+  std::vector<::util::StatusOr<DataResponse>> port_responses = {oper_status,
+                                                                port_counters};
+  EXPECT_CALL(*bf_chassis_manager_mock_, GetPortDataBatch(_))
+      .WillOnce(Invoke([&port_responses](
+                           const std::vector<DataRequest::Request>& requests) {
+        EXPECT_EQ(2, requests.size());
+        EXPECT_TRUE(requests[0].has_oper_status());
+        EXPECT_TRUE(requests[1].has_port_counters());
+        return port_responses;
+      }));
+  std::vector<::util::Status> details;
+
+  EXPECT_OK(bfrt_switch_->RetrieveValue(kNodeId, req, &writer, &details));
+  ASSERT_EQ(3, responses.size());
+  EXPECT_EQ(PORT_STATE_UP, responses[0].oper_status().state());
+  EXPECT_EQ(kDebugString,
+            responses[1].node_packetio_debug_info().debug_string());
+  EXPECT_EQ(42, responses[2].port_counters().in_octets());
+  ASSERT_EQ(3, details.size());
+  for (const auto& status : details) EXPECT_OK(status);
+}
+
+TEST_F(BfrtSwitchTest, RetrieveValueNodePacketioDebugInfo) {
+  constexpr char kDebugString[] = "(rx_packets:1)";
+
+  PushChassisConfigSuccess();
+
+  WriterMock<DataResponse> writer;
+  DataResponse resp;
+  ExpectMockWriteDataResponse(&writer, &resp);
+  EXPECT_CALL(*bfrt_node_mock_, DumpPacketioStats())
+      .WillOnce(Return(std::string(kDebugString)));
+
+  DataRequest req;
+  req.add_requests()->mutable_node_packetio_debug_info()->set_node_id(kNodeId);
+  std::vector<::util::Status> details;
+
+  EXPECT_OK(bfrt_switch_->RetrieveValue(kNodeId, req, &writer, &details));
+  EXPECT_EQ(kDebugString, resp.node_packetio_debug_info().debug_string());
+  ASSERT_EQ(details.size(), 1);
+  EXPECT_THAT(details.at(0), ::util::OkStatus());
+}
+
+TEST_F(BfrtSwitchTest, RetrieveValueNodeCounterSyncDebugInfo) {
+  PushChassisConfigSuccess();
+
+  WriterMock<DataResponse> writer;
+  DataResponse resp;
+  ExpectMockWriteDataResponse(&writer, &resp);
+  BfrtCounterSyncStats stats;
+  stats.requests = 3;
+  stats.coalesced = 2;
+  stats.syncs = 1;
+  EXPECT_CALL(*bf_chassis_manager_mock_, GetDeviceFromNodeId(kNodeId))
+      .WillOnce(Return(kDevice));
+  EXPECT_CALL(*bf_sde_mock_, GetCounterSyncStats(kDevice))
+      .WillOnce(Return(stats));
+
+  DataRequest req;
+  req.add_requests()->mutable_node_counter_sync_debug_info()->set_node_id(
+      kNodeId);
+  std::vector<::util::Status> details;
+
+  EXPECT_OK(bfrt_switch_->RetrieveValue(kNodeId, req, &writer, &details));
+  EXPECT_EQ(stats.ToString(),
+            resp.node_counter_sync_debug_info().debug_string());
+  ASSERT_EQ(details.size(), 1);
+  EXPECT_THAT(details.at(0), ::util::OkStatus());
+}
+
 // TODO(max): add more tests, use BcmSwitch as a reference.
 
 }  // namespace
@@ -0,0 +1,168 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_FIELD_INDEX_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_FIELD_INDEX_H_
+
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// Indexes the key fields, data fields and actions of a table by name and by
+// ID. Data fields belong to an action, action ID 0 holds the fields common to
+// all actions and the fields of tables without actions. Field is the SDE field
+// description, BfRtTableMetadata::FieldInfo. The class is not thread-safe, but
+// lookups can be done concurrently once all the fields were added.
+template <typename Field>
+class BfrtTableFieldIndex {
+ public:
+  explicit BfrtTableFieldIndex(uint32 table_id) : table_id_(table_id) {}
+
+  // Adds a key field of the table.
+  void AddKeyField(const std::string& name, uint32 id, const Field& field) {
+    key_fields_by_name_[name] = field;
+    key_fields_by_id_[id] = field;
+  }
+
+  // Adds a data field of the given action, 0 for the fields common to all
+  // actions.
+  void AddDataField(uint32 action_id, const std::string& name, uint32 id,
+                    const Field& field) {
+    ActionDataFields& fields = data_fields_[action_id];
+    fields.by_name[name] = field;
+    fields.by_id[id] = field;
+  }
+
+  // Adds an action of the table.
+  void AddAction(const std::string& name, uint32 action_id) {
+    action_ids_[name] = action_id;
+  }
+
+  // Returns the key field with the given name or ID, or nullptr if the table
+  // has no such key field.
+  const Field* FindKeyField(absl::string_view name) const {
+    auto it = key_fields_by_name_.find(name);
+    return it != key_fields_by_name_.end() ? &it->second : nullptr;
+  }
+  const Field* FindKeyField(uint32 id) const {
+    auto it = key_fields_by_id_.find(id);
+    return it != key_fields_by_id_.end() ? &it->second : nullptr;
+  }
+
+  // Returns the data field with the given name or ID of the given action, or
+  // nullptr if there is no such data field. Fields common to all actions are
+  // found with any action ID.
+  const Field* FindDataField(uint32 action_id, absl::string_view name) const {
+    auto it = data_fields_.find(action_id);
+    if (it != data_fields_.end()) {
+      auto field = it->second.by_name.find(name);
+      if (field != it->second.by_name.end()) return &field->second;
+    }
+    // Fall back to the fields common to all actions.
+    return action_id ? FindDataField(0, name) : nullptr;
+  }
+  const Field* FindDataField(uint32 action_id, uint32 id) const {
+    auto it = data_fields_.find(action_id);
+    if (it != data_fields_.end()) {
+      auto field = it->second.by_id.find(id);
+      if (field != it->second.by_id.end()) return &field->second;
+    }
+    // Fall back to the fields common to all actions.
+    return action_id ? FindDataField(0, id) : nullptr;
+  }
+
+  // Returns a data field of the given action whose name ends with the given
+  // suffix, or nullptr if there is none. Fields common to all actions are
+  // only found with action ID 0.
+  const Field* FindDataFieldWithSuffix(uint32 action_id,
+                                       absl::string_view suffix) const {
+    auto it = data_fields_.find(action_id);
+    if (it == data_fields_.end()) return nullptr;
+    for (const auto& e : it->second.by_name) {
+      if (absl::EndsWith(e.first, suffix)) return &e.second;
+    }
+    return nullptr;
+  }
+
+  // Same as the Find*() functions above, but return an error if the field
+  // does not exist.
+  ::util::StatusOr<const Field*> GetKeyField(absl::string_view name) const {
+    const Field* field = FindKeyField(name);
+    if (!field) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table_id_ << " has no key field " << name << ".";
+    }
+    return field;
+  }
+  ::util::StatusOr<const Field*> GetKeyField(uint32 id) const {
+    const Field* field = FindKeyField(id);
+    if (!field) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table_id_ << " has no key field with ID " << id
+             << ".";
+    }
+    return field;
+  }
+  ::util::StatusOr<const Field*> GetDataField(uint32 action_id,
+                                              absl::string_view name) const {
+    const Field* field = FindDataField(action_id, name);
+    if (!field) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table_id_ << " has no data field " << name
+             << " for action " << action_id << ".";
+    }
+    return field;
+  }
+  ::util::StatusOr<const Field*> GetDataField(uint32 action_id,
+                                              uint32 id) const {
+    const Field* field = FindDataField(action_id, id);
+    if (!field) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table_id_ << " has no data field with ID " << id
+             << " for action " << action_id << ".";
+    }
+    return field;
+  }
+
+  // Returns the ID of the action with the given name.
+  ::util::StatusOr<uint32> GetActionId(absl::string_view name) const {
+    auto it = action_ids_.find(name);
+    if (it == action_ids_.end()) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table_id_ << " has no action " << name << ".";
+    }
+    return it->second;
+  }
+
+  uint32 table_id() const { return table_id_; }
+
+ private:
+  // The data fields of an action, by name and by ID.
+  struct ActionDataFields {
+    absl::flat_hash_map<std::string, Field> by_name;
+    absl::flat_hash_map<uint32, Field> by_id;
+  };
+
+  uint32 table_id_;
+  absl::flat_hash_map<std::string, Field> key_fields_by_name_;
+  absl::flat_hash_map<uint32, Field> key_fields_by_id_;
+  // Map from action ID to the data fields of the action.
+  absl::flat_hash_map<uint32, ActionDataFields> data_fields_;
+  absl::flat_hash_map<std::string, uint32> action_ids_;
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_FIELD_INDEX_H_
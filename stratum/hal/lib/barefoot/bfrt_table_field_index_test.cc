@@ -0,0 +1,137 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_table_field_index.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using test_utils::StatusIs;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Pointee;
+
+// Stands in for the SDE field description.
+struct FakeField {
+  uint32 id;
+  int size_bits;
+};
+
+MATCHER_P2(FieldIs, id, size_bits, "") {
+  return arg.id == id && arg.size_bits == size_bits;
+}
+
+constexpr uint32 kTableId = 12345;
+constexpr uint32 kAction1 = 1;
+constexpr uint32 kAction2 = 2;
+constexpr uint32 kUnknownAction = 3;
+
+class BfrtTableFieldIndexTest : public ::testing::Test {
+ protected:
+  BfrtTableFieldIndexTest() : index_(kTableId) {
+    index_.AddKeyField("hdr.ipv4.dst_addr", 1, {1, 32});
+    index_.AddKeyField("$MATCH_PRIORITY", 65537, {65537, 32});
+    // Fields common to all actions.
+    index_.AddDataField(0, "$COUNTER_SPEC_PKTS", 65553, {65553, 64});
+    index_.AddDataField(0, "pipe.Ingress.reg.f1", 65554, {65554, 16});
+    index_.AddAction("Ingress.set_port", kAction1);
+    index_.AddDataField(kAction1, "port", 1, {1, 9});
+    index_.AddAction("Ingress.set_vlan", kAction2);
+    index_.AddDataField(kAction2, "vlan", 1, {1, 12});
+  }
+
+  BfrtTableFieldIndex<FakeField> index_;
+};
+
+TEST_F(BfrtTableFieldIndexTest, FindKeyFieldByNameAndId) {
+  const FakeField* field = index_.FindKeyField("hdr.ipv4.dst_addr");
+  ASSERT_NE(nullptr, field);
+  EXPECT_EQ(1, field->id);
+  EXPECT_EQ(32, field->size_bits);
+  EXPECT_THAT(index_.FindKeyField(1), Pointee(FieldIs(1, 32)));
+  EXPECT_EQ(nullptr, index_.FindKeyField("hdr.ipv4.src_addr"));
+  EXPECT_EQ(nullptr, index_.FindKeyField(2));
+}
+
+TEST_F(BfrtTableFieldIndexTest, ActionDataFieldsWithSameIdAreSeparate) {
+  const FakeField* port = index_.FindDataField(kAction1, 1);
+  const FakeField* vlan = index_.FindDataField(kAction2, 1);
+  ASSERT_NE(nullptr, port);
+  ASSERT_NE(nullptr, vlan);
+  EXPECT_EQ(9, port->size_bits);
+  EXPECT_EQ(12, vlan->size_bits);
+  EXPECT_THAT(index_.FindDataField(kAction1, "port"), Pointee(FieldIs(1, 9)));
+  EXPECT_EQ(nullptr, index_.FindDataField(kAction1, "vlan"));
+  EXPECT_EQ(nullptr, index_.FindDataField(kAction2, "port"));
+}
+
+TEST_F(BfrtTableFieldIndexTest, DataFieldFallsBackToCommonFields) {
+  EXPECT_THAT(index_.FindDataField(0, "$COUNTER_SPEC_PKTS"),
+              Pointee(FieldIs(65553, 64)));
+  // Common fields are found with any action ID, including unknown ones.
+  EXPECT_THAT(index_.FindDataField(kAction1, "$COUNTER_SPEC_PKTS"),
+              Pointee(FieldIs(65553, 64)));
+  EXPECT_THAT(index_.FindDataField(kUnknownAction, "$COUNTER_SPEC_PKTS"),
+              Pointee(FieldIs(65553, 64)));
+  EXPECT_THAT(index_.FindDataField(kAction2, 65553),
+              Pointee(FieldIs(65553, 64)));
+  EXPECT_THAT(index_.FindDataField(kUnknownAction, 65553),
+              Pointee(FieldIs(65553, 64)));
+  // Action fields are not found with action ID 0.
+  EXPECT_EQ(nullptr, index_.FindDataField(0, "port"));
+  EXPECT_EQ(nullptr, index_.FindDataField(0, 1));
+}
+
+TEST_F(BfrtTableFieldIndexTest, FindDataFieldWithSuffix) {
+  const FakeField* field = index_.FindDataFieldWithSuffix(0, ".f1");
+  ASSERT_NE(nullptr, field);
+  EXPECT_EQ(65554, field->id);
+  // There is no fallback to the common fields.
+  EXPECT_EQ(nullptr, index_.FindDataFieldWithSuffix(kAction1, ".f1"));
+  EXPECT_EQ(nullptr, index_.FindDataFieldWithSuffix(kUnknownAction, ".f1"));
+}
+
+TEST_F(BfrtTableFieldIndexTest, GetReturnsErrorsForMissingFields) {
+  ASSERT_OK_AND_ASSIGN(const FakeField* key, index_.GetKeyField(65537));
+  EXPECT_EQ(65537, key->id);
+  ASSERT_OK_AND_ASSIGN(const FakeField* data,
+                       index_.GetDataField(kAction2, "vlan"));
+  EXPECT_EQ(12, data->size_bits);
+  ASSERT_OK_AND_ASSIGN(data, index_.GetDataField(kAction1, 65554));
+  EXPECT_EQ(16, data->size_bits);
+
+  EXPECT_THAT(index_.GetKeyField("hdr.ipv4.src_addr").status(),
+              StatusIs(_, ERR_INVALID_PARAM,
+                       HasSubstr("Table 12345 has no key field "
+                                 "hdr.ipv4.src_addr")));
+  EXPECT_THAT(index_.GetKeyField(2).status(),
+              StatusIs(_, ERR_INVALID_PARAM, HasSubstr("key field with ID 2")));
+  EXPECT_THAT(index_.GetDataField(kAction2, "port").status(),
+              StatusIs(_, ERR_INVALID_PARAM,
+                       HasSubstr("no data field port for action 2")));
+  EXPECT_THAT(index_.GetDataField(kAction1, 2).status(),
+              StatusIs(_, ERR_INVALID_PARAM,
+                       HasSubstr("no data field with ID 2 for action 1")));
+}
+
+TEST_F(BfrtTableFieldIndexTest, GetActionId) {
+  ASSERT_OK_AND_ASSIGN(uint32 action_id,
+                       index_.GetActionId("Ingress.set_vlan"));
+  EXPECT_EQ(kAction2, action_id);
+  EXPECT_THAT(index_.GetActionId("Ingress.drop").status(),
+              StatusIs(_, ERR_INVALID_PARAM,
+                       HasSubstr("Table 12345 has no action Ingress.drop")));
+  EXPECT_EQ(kTableId, index_.table_id());
+}
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -8,9 +8,12 @@
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/match.h"
 #include "absl/synchronization/notification.h"
 #include "gflags/gflags.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/util/message_differencer.h"
 #include "p4/config/v1/p4info.pb.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/barefoot/bfrt_constants.h"
@@ -22,11 +25,63 @@ DEFINE_uint32(
     bfrt_table_sync_timeout_ms,
     stratum::hal::barefoot::kDefaultSyncTimeout / absl::Milliseconds(1),
     "The timeout for table sync operation like counters and registers.");
+DEFINE_int32(bfrt_table_read_chunk_size, 1024,
+             "Maximum number of table entries fetched from the SDE and "
+             "streamed in a single ReadResponse on wildcard table reads.");
+DEFINE_string(bfrt_table_shadow, "off",
+              "Use of the write-through shadow of the table entries written "
+              "through P4Runtime: 'off', 'on' to serve table reads from the "
+              "shadow, reading only counter values from the SDE, or 'check' "
+              "to serve reads from the SDE and log where the shadow differs. "
+              "Only valid if all table entries are written through Stratum.");
 
 namespace stratum {
 namespace hal {
 namespace barefoot {
 
+namespace {
+// Forwards read responses to another writer, if any, and keeps a copy of the
+// table entries in them.
+class TableEntryCollector : public WriterInterface<::p4::v1::ReadResponse> {
+ public:
+  explicit TableEntryCollector(
+      WriterInterface<::p4::v1::ReadResponse>* writer)
+      : writer_(writer) {}
+
+  bool Write(const ::p4::v1::ReadResponse& resp) override {
+    for (const auto& entity : resp.entities()) {
+      entries_.push_back(entity.table_entry());
+    }
+    return writer_ == nullptr || writer_->Write(resp);
+  }
+
+  const std::vector<::p4::v1::TableEntry>& entries() const { return entries_; }
+
+ private:
+  WriterInterface<::p4::v1::ReadResponse>* writer_;  // not owned
+  std::vector<::p4::v1::TableEntry> entries_;
+};
+
+// Checks that a wildcard table read has no filters, which are not supported.
+::util::Status VerifyWildcardTableRead(
+    const ::p4::v1::TableEntry& table_entry) {
+  RET_CHECK(table_entry.match_size() == 0)
+      << "Match filters on wildcard reads are not supported.";
+  RET_CHECK(table_entry.priority() == 0)
+      << "Priority filters on wildcard reads are not supported.";
+  RET_CHECK(table_entry.has_action() == false)
+      << "Action filters on wildcard reads are not supported.";
+  RET_CHECK(table_entry.metadata() == "")
+      << "Metadata filters on wildcard reads are not supported.";
+  RET_CHECK(table_entry.is_default_action() == false)
+      << "Default action filters on wildcard reads are not supported.";
+  RET_CHECK(FLAGS_bfrt_table_read_chunk_size > 0)
+      << "Invalid read chunk size " << FLAGS_bfrt_table_read_chunk_size << ".";
+
+  return ::util::OkStatus();
+}
+}  // namespace
+
 BfrtTableManager::BfrtTableManager(
     OperationMode mode, BfSdeInterface* bf_sde_interface,
     BfrtP4RuntimeTranslator* bfrt_p4runtime_translator, int device)
@@ -35,6 +90,8 @@ BfrtTableManager::BfrtTableManager(
       bf_sde_interface_(ABSL_DIE_IF_NULL(bf_sde_interface)),
       bfrt_p4runtime_translator_(ABSL_DIE_IF_NULL(bfrt_p4runtime_translator)),
       p4_info_manager_(nullptr),
+      table_shadow_mode_(TableShadowMode::kOff),
+      pipeline_epoch_(0),
       device_(device) {}
 
 BfrtTableManager::BfrtTableManager()
@@ -43,6 +100,8 @@ BfrtTableManager::BfrtTableManager()
       bf_sde_interface_(nullptr),
       bfrt_p4runtime_translator_(nullptr),
       p4_info_manager_(nullptr),
+      table_shadow_mode_(TableShadowMode::kOff),
+      pipeline_epoch_(0),
       device_(-1) {}
 
 BfrtTableManager::~BfrtTableManager() = default;
@@ -58,12 +117,27 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
     const BfrtDeviceConfig& config) {
   absl::WriterMutexLock l(&lock_);
   RET_CHECK(config.programs_size() == 1) << "Only one P4 program is supported.";
+  TableShadowMode table_shadow_mode;
+  if (FLAGS_bfrt_table_shadow == "off") {
+    table_shadow_mode = TableShadowMode::kOff;
+  } else if (FLAGS_bfrt_table_shadow == "on") {
+    table_shadow_mode = TableShadowMode::kOn;
+  } else if (FLAGS_bfrt_table_shadow == "check") {
+    table_shadow_mode = TableShadowMode::kCheck;
+  } else {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Invalid table shadow mode '" << FLAGS_bfrt_table_shadow << "'.";
+  }
   const auto& program = config.programs(0);
   const auto& p4_info = program.p4info();
   std::unique_ptr<P4InfoManager> p4_info_manager =
       absl::make_unique<P4InfoManager>(p4_info);
   RETURN_IF_ERROR(p4_info_manager->InitializeAndVerify());
   p4_info_manager_ = std::move(p4_info_manager);
+  // The SDE tables are cleared by the pipeline push.
+  table_shadow_mode_ = table_shadow_mode;
+  table_shadow_.Clear();
+  ++pipeline_epoch_;
 
   if (digest_rx_thread_id_ == 0) {
     digest_list_receive_channel_ =
@@ -118,6 +192,7 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
     }
     digest_list_receive_channel_.reset();
     digest_list_session_.reset();
+    table_shadow_.Clear();
   }
   // TODO(max): we release the locks between closing the channel and joining the
   // thread to prevent deadlocks with the RX handler. But there might still be a
@@ -308,21 +383,51 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
   return ::util::OkStatus();
 }
 
+::util::StatusOr<const ::p4::v1::TableEntry*>
+BfrtTableManager::TranslateTableEntryToSdk(
+    const ::p4::v1::TableEntry& table_entry, google::protobuf::Arena* arena) {
+  // Most entries have nothing to translate and are used as they are.
+  if (!bfrt_p4runtime_translator_->TableEntryRequiresTranslation(table_entry)) {
+    return &table_entry;
+  }
+  auto* translated_copy =
+      google::protobuf::Arena::CreateMessage<::p4::v1::TableEntry>(arena);
+  *translated_copy = table_entry;
+  RETURN_IF_ERROR(bfrt_p4runtime_translator_->TranslateTableEntryInPlace(
+      translated_copy, /*to_sdk=*/true));
+  return translated_copy;
+}
+
 ::util::Status BfrtTableManager::WriteTableEntry(
     std::shared_ptr<BfSdeInterface::SessionInterface> session,
     const ::p4::v1::Update::Type type,
     const ::p4::v1::TableEntry& table_entry) {
+  google::protobuf::Arena arena;
+  TableEntryWrite write;
+  RETURN_IF_ERROR(PrepareTableEntryWrite(type, table_entry, &arena, &write));
+  return CommitTableEntryWrite(session, write);
+}
+
+::util::Status BfrtTableManager::PrepareTableEntryWrite(
+    const ::p4::v1::Update::Type type, const ::p4::v1::TableEntry& table_entry,
+    google::protobuf::Arena* arena, TableEntryWrite* write) {
   RET_CHECK(type != ::p4::v1::Update::UNSPECIFIED)
       << "Invalid update type " << type;
+  RET_CHECK(arena);
+  RET_CHECK(write);
   absl::ReaderMutexLock l(&lock_);
-  ASSIGN_OR_RETURN(const auto& translated_table_entry,
-                   bfrt_p4runtime_translator_->TranslateTableEntry(
-                       table_entry, /*to_sdk=*/true));
+  ASSIGN_OR_RETURN(const ::p4::v1::TableEntry* translated_entry,
+                   TranslateTableEntryToSdk(table_entry, arena));
+  const ::p4::v1::TableEntry& translated_table_entry = *translated_entry;
 
   ASSIGN_OR_RETURN(auto table, p4_info_manager_->FindTableByID(
                                    translated_table_entry.table_id()));
   ASSIGN_OR_RETURN(uint32 table_id, bf_sde_interface_->GetBfRtId(
                                         translated_table_entry.table_id()));
+  write->type = type;
+  write->table_id = table_id;
+  write->pipeline_epoch = pipeline_epoch_;
+  write->is_default_action = translated_table_entry.is_default_action();
 
   if (!translated_table_entry.is_default_action()) {
     if (table.is_const_table()) {
@@ -330,36 +435,38 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
              << "Can't write to const table " << table.preamble().name()
              << " because it has const entries.";
     }
-    ASSIGN_OR_RETURN(auto table_key,
-                     bf_sde_interface_->CreateTableKey(table_id));
-    RETURN_IF_ERROR(BuildTableKey(translated_table_entry, table_key.get()));
-
-    ASSIGN_OR_RETURN(
-        auto table_data,
-        bf_sde_interface_->CreateTableData(
-            table_id, translated_table_entry.action().action().action_id()));
-    if (type == ::p4::v1::Update::INSERT || type == ::p4::v1::Update::MODIFY) {
-      RETURN_IF_ERROR(BuildTableData(translated_table_entry, table_data.get()));
-    }
-
     switch (type) {
       case ::p4::v1::Update::INSERT:
-        RETURN_IF_ERROR(bf_sde_interface_->InsertTableEntry(
-            device_, session, table_id, table_key.get(), table_data.get()));
-        break;
       case ::p4::v1::Update::MODIFY:
-        RETURN_IF_ERROR(bf_sde_interface_->ModifyTableEntry(
-            device_, session, table_id, table_key.get(), table_data.get()));
-        break;
       case ::p4::v1::Update::DELETE:
-        RETURN_IF_ERROR(bf_sde_interface_->DeleteTableEntry(
-            device_, session, table_id, table_key.get()));
         break;
       default:
         return MAKE_ERROR(ERR_INTERNAL)
                << "Unsupported update type: " << type << " in table entry "
                << translated_table_entry.ShortDebugString() << ".";
     }
+    ASSIGN_OR_RETURN(write->table_key,
+                     bf_sde_interface_->CreateTableKey(table_id));
+    RETURN_IF_ERROR(
+        BuildTableKey(translated_table_entry, write->table_key.get()));
+
+    ASSIGN_OR_RETURN(
+        write->table_data,
+        bf_sde_interface_->CreateTableData(
+            table_id, translated_table_entry.action().action().action_id()));
+    if (type == ::p4::v1::Update::INSERT || type == ::p4::v1::Update::MODIFY) {
+      RETURN_IF_ERROR(
+          BuildTableData(translated_table_entry, write->table_data.get()));
+    }
+    if (table_shadow_mode_ != TableShadowMode::kOff) {
+      auto* shadow_entry =
+          google::protobuf::Arena::CreateMessage<::p4::v1::TableEntry>(arena);
+      RETURN_IF_ERROR(BuildShadowTableEntry(
+          translated_table_entry,
+          /*with_action=*/type != ::p4::v1::Update::DELETE, shadow_entry));
+      write->update_shadow = true;
+      write->shadow_entry = shadow_entry;
+    }
   } else {
     RET_CHECK(type == ::p4::v1::Update::MODIFY)
         << "The default table entry can only be modified.";
@@ -370,80 +477,206 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
 
     if (translated_table_entry.has_action()) {
       ASSIGN_OR_RETURN(
-          auto table_data,
+          write->table_data,
           bf_sde_interface_->CreateTableData(
               table_id, translated_table_entry.action().action().action_id()));
-      RETURN_IF_ERROR(BuildTableData(translated_table_entry, table_data.get()));
-      RETURN_IF_ERROR(bf_sde_interface_->SetDefaultTableEntry(
-          device_, session, table_id, table_data.get()));
-    } else {
-      RETURN_IF_ERROR(bf_sde_interface_->ResetDefaultTableEntry(
-          device_, session, table_id));
+      RETURN_IF_ERROR(
+          BuildTableData(translated_table_entry, write->table_data.get()));
     }
   }
 
   return ::util::OkStatus();
 }
 
+::util::Status BfrtTableManager::CommitTableEntryWrite(
+    std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const TableEntryWrite& write) {
+  // The commit runs under the reader lock, so that the pipeline can not be
+  // replaced while the SDE call is in flight.
+  absl::ReaderMutexLock l(&lock_);
+  if (write.pipeline_epoch != pipeline_epoch_) {
+    return MAKE_ERROR(ERR_ABORTED)
+           << "The forwarding pipeline was changed while the table entry "
+           << "write was in progress.";
+  }
+  if (write.is_default_action) {
+    if (write.table_data) {
+      return bf_sde_interface_->SetDefaultTableEntry(
+          device_, session, write.table_id, write.table_data.get());
+    }
+    return bf_sde_interface_->ResetDefaultTableEntry(device_, session,
+                                                     write.table_id);
+  }
+
+  RET_CHECK(write.table_key) << "Table entry write has no key.";
+  switch (write.type) {
+    case ::p4::v1::Update::INSERT:
+      RETURN_IF_ERROR(bf_sde_interface_->InsertTableEntry(
+          device_, session, write.table_id, write.table_key.get(),
+          write.table_data.get()));
+      break;
+    case ::p4::v1::Update::MODIFY:
+      RETURN_IF_ERROR(bf_sde_interface_->ModifyTableEntry(
+          device_, session, write.table_id, write.table_key.get(),
+          write.table_data.get()));
+      break;
+    case ::p4::v1::Update::DELETE:
+      RETURN_IF_ERROR(bf_sde_interface_->DeleteTableEntry(
+          device_, session, write.table_id, write.table_key.get()));
+      break;
+    default:
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Unsupported update type: " << write.type << ".";
+  }
+  if (write.update_shadow) {
+    table_shadow_.Update(write.type, *write.shadow_entry);
+  }
+
+  return ::util::OkStatus();
+}
+
+BfrtTableManager::TableShadowMode BfrtTableManager::GetTableShadowMode(
+    uint32 table_id) const {
+  if (table_shadow_mode_ == TableShadowMode::kOff) {
+    return TableShadowMode::kOff;
+  }
+  auto table = p4_info_manager_->FindTableByID(table_id);
+  if (!table.ok() || table.ValueOrDie().is_const_table()) {
+    return TableShadowMode::kOff;
+  }
+
+  return table_shadow_mode_;
+}
+
+::util::Status BfrtTableManager::BuildShadowTableEntry(
+    const ::p4::v1::TableEntry& table_entry, bool with_action,
+    ::p4::v1::TableEntry* result) const {
+  ASSIGN_OR_RETURN(auto table,
+                   p4_info_manager_->FindTableByID(table_entry.table_id()));
+  result->set_table_id(table_entry.table_id());
+
+  // Match fields in P4Info order with canonical values, as BuildP4TableEntry()
+  // returns them. Unknown fields are ignored, like in BuildTableKey().
+  for (const auto& expected_match_field : table.match_fields()) {
+    auto expected_field_id = expected_match_field.id();
+    auto it =
+        std::find_if(table_entry.match().begin(), table_entry.match().end(),
+                     [expected_field_id](const ::p4::v1::FieldMatch& match) {
+                       return match.field_id() == expected_field_id;
+                     });
+    if (it == table_entry.match().end()) continue;
+    ::p4::v1::FieldMatch* match = result->add_match();
+    *match = *it;
+    switch (match->field_match_type_case()) {
+      case ::p4::v1::FieldMatch::kExact:
+        match->mutable_exact()->set_value(
+            ByteStringToP4RuntimeByteString(match->exact().value()));
+        break;
+      case ::p4::v1::FieldMatch::kTernary:
+        match->mutable_ternary()->set_value(
+            ByteStringToP4RuntimeByteString(match->ternary().value()));
+        match->mutable_ternary()->set_mask(
+            ByteStringToP4RuntimeByteString(match->ternary().mask()));
+        break;
+      case ::p4::v1::FieldMatch::kLpm:
+        match->mutable_lpm()->set_value(
+            ByteStringToP4RuntimeByteString(match->lpm().value()));
+        break;
+      case ::p4::v1::FieldMatch::kRange:
+        match->mutable_range()->set_low(
+            ByteStringToP4RuntimeByteString(match->range().low()));
+        match->mutable_range()->set_high(
+            ByteStringToP4RuntimeByteString(match->range().high()));
+        break;
+      default:
+        break;
+    }
+  }
+  result->set_priority(table_entry.priority());
+  if (!with_action) return ::util::OkStatus();
+
+  if (table_entry.action().type_case() == ::p4::v1::TableAction::kAction) {
+    const auto& action = table_entry.action().action();
+    ASSIGN_OR_RETURN(auto expected_action,
+                     p4_info_manager_->FindActionByID(action.action_id()));
+    auto* result_action = result->mutable_action()->mutable_action();
+    result_action->set_action_id(action.action_id());
+    for (const auto& expected_param : expected_action.params()) {
+      auto expected_param_id = expected_param.id();
+      auto it = std::find_if(
+          action.params().begin(), action.params().end(),
+          [expected_param_id](const ::p4::v1::Action::Param& param) {
+            return param.param_id() == expected_param_id;
+          });
+      if (it == action.params().end()) continue;
+      auto* param = result_action->add_params();
+      param->set_param_id(expected_param_id);
+      param->set_value(ByteStringToP4RuntimeByteString(it->value()));
+    }
+  } else if (table_entry.has_action()) {
+    *result->mutable_action() = table_entry.action();
+  }
+
+  return ::util::OkStatus();
+}
+
 // TODO(max): the need for the original request might go away when the table
 // data is correctly initialized with only the fields we care about.
-::util::StatusOr<::p4::v1::TableEntry> BfrtTableManager::BuildP4TableEntry(
+::util::Status BfrtTableManager::BuildP4TableEntry(
     const ::p4::v1::TableEntry& request,
     const BfSdeInterface::TableKeyInterface* table_key,
-    const BfSdeInterface::TableDataInterface* table_data) {
-  ::p4::v1::TableEntry result;
+    const BfSdeInterface::TableDataInterface* table_data,
+    ::p4::v1::TableEntry* result) {
+  RET_CHECK(result);
+  result->Clear();
 
   ASSIGN_OR_RETURN(auto table,
                    p4_info_manager_->FindTableByID(request.table_id()));
-  result.set_table_id(request.table_id());
+  result->set_table_id(request.table_id());
 
   bool has_priority_field = false;
   // Match keys
   for (const auto& expected_match_field : table.match_fields()) {
-    ::p4::v1::FieldMatch match;  // Added to the entry later.
+    // Built in place and removed again if it turns out to be a don't care.
+    ::p4::v1::FieldMatch& match = *result->add_match();
     match.set_field_id(expected_match_field.id());
     switch (expected_match_field.match_type()) {
       case ::p4::config::v1::MatchField::EXACT: {
         RETURN_IF_ERROR(table_key->GetExact(
             expected_match_field.id(), match.mutable_exact()->mutable_value()));
-        if (!IsDontCareMatch(match.exact())) {
-          *result.add_match() = match;
+        if (IsDontCareMatch(match.exact())) {
+          result->mutable_match()->RemoveLast();
         }
         break;
       }
       case ::p4::config::v1::MatchField::TERNARY: {
         has_priority_field = true;
-        std::string value, mask;
-        RETURN_IF_ERROR(
-            table_key->GetTernary(expected_match_field.id(), &value, &mask));
-        match.mutable_ternary()->set_value(value);
-        match.mutable_ternary()->set_mask(mask);
-        if (!IsDontCareMatch(match.ternary())) {
-          *result.add_match() = match;
+        RETURN_IF_ERROR(table_key->GetTernary(
+            expected_match_field.id(), match.mutable_ternary()->mutable_value(),
+            match.mutable_ternary()->mutable_mask()));
+        if (IsDontCareMatch(match.ternary())) {
+          result->mutable_match()->RemoveLast();
         }
         break;
       }
       case ::p4::config::v1::MatchField::LPM: {
-        std::string prefix;
         uint16 prefix_length;
-        RETURN_IF_ERROR(table_key->GetLpm(expected_match_field.id(), &prefix,
+        RETURN_IF_ERROR(table_key->GetLpm(expected_match_field.id(),
+                                          match.mutable_lpm()->mutable_value(),
                                           &prefix_length));
-        match.mutable_lpm()->set_value(prefix);
         match.mutable_lpm()->set_prefix_len(prefix_length);
-        if (!IsDontCareMatch(match.lpm())) {
-          *result.add_match() = match;
+        if (IsDontCareMatch(match.lpm())) {
+          result->mutable_match()->RemoveLast();
         }
         break;
       }
       case ::p4::config::v1::MatchField::RANGE: {
         has_priority_field = true;
-        std::string low, high;
-        RETURN_IF_ERROR(
-            table_key->GetRange(expected_match_field.id(), &low, &high));
-        match.mutable_range()->set_low(low);
-        match.mutable_range()->set_high(high);
-        if (!IsDontCareMatch(match.range(), expected_match_field.bitwidth())) {
-          *result.add_match() = match;
+        RETURN_IF_ERROR(table_key->GetRange(
+            expected_match_field.id(), match.mutable_range()->mutable_low(),
+            match.mutable_range()->mutable_high()));
+        if (IsDontCareMatch(match.range(), expected_match_field.bitwidth())) {
+          result->mutable_match()->RemoveLast();
         }
         break;
       }
@@ -468,7 +701,7 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
     RETURN_IF_ERROR(table_key->GetPriority(&bf_priority));
     ASSIGN_OR_RETURN(uint64 p4rt_priority,
                      ConvertPriorityFromBfrtToP4rt(bf_priority));
-    result.set_priority(p4rt_priority);
+    result->set_priority(p4rt_priority);
   }
 
   // Action and action data
@@ -477,37 +710,36 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
   // TODO(max): perform check if action id is valid for this table.
   if (action_id) {
     ASSIGN_OR_RETURN(auto action, p4_info_manager_->FindActionByID(action_id));
-    result.mutable_action()->mutable_action()->set_action_id(action_id);
+    result->mutable_action()->mutable_action()->set_action_id(action_id);
     for (const auto& expected_param : action.params()) {
-      std::string value;
-      RETURN_IF_ERROR(table_data->GetParam(expected_param.id(), &value));
-      auto* param = result.mutable_action()->mutable_action()->add_params();
+      auto* param = result->mutable_action()->mutable_action()->add_params();
       param->set_param_id(expected_param.id());
-      param->set_value(value);
+      RETURN_IF_ERROR(
+          table_data->GetParam(expected_param.id(), param->mutable_value()));
     }
   }
 
   // Action profile member id
   uint64 action_member_id;
   if (table_data->GetActionMemberId(&action_member_id).ok()) {
-    result.mutable_action()->set_action_profile_member_id(action_member_id);
+    result->mutable_action()->set_action_profile_member_id(action_member_id);
   }
 
   // Action profile group id
   uint64 selector_group_id;
   if (table_data->GetSelectorGroupId(&selector_group_id).ok()) {
-    result.mutable_action()->set_action_profile_group_id(selector_group_id);
+    result->mutable_action()->set_action_profile_group_id(selector_group_id);
   }
 
   // Counter data, if applicable.
   uint64 bytes, packets;
   if (request.has_counter_data() &&
       table_data->GetCounterData(&bytes, &packets).ok()) {
-    result.mutable_counter_data()->set_byte_count(bytes);
-    result.mutable_counter_data()->set_packet_count(packets);
+    result->mutable_counter_data()->set_byte_count(bytes);
+    result->mutable_counter_data()->set_packet_count(packets);
   }
 
-  return result;
+  return ::util::OkStatus();
 }
 
 ::util::StatusOr<::p4::v1::DigestList> BfrtTableManager::BuildP4DigestList(
@@ -550,13 +782,12 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
   RETURN_IF_ERROR(BuildTableKey(table_entry, table_key.get()));
   RETURN_IF_ERROR(bf_sde_interface_->GetTableEntry(
       device_, session, table_id, table_key.get(), table_data.get()));
-  ASSIGN_OR_RETURN(
-      ::p4::v1::TableEntry result,
-      BuildP4TableEntry(table_entry, table_key.get(), table_data.get()));
   ::p4::v1::ReadResponse resp;
-  ASSIGN_OR_RETURN(*resp.add_entities()->mutable_table_entry(),
-                   bfrt_p4runtime_translator_->TranslateTableEntry(
-                       result, /*to_sdk=*/false));
+  auto* result = resp.add_entities()->mutable_table_entry();
+  RETURN_IF_ERROR(BuildP4TableEntry(table_entry, table_key.get(),
+                                    table_data.get(), result));
+  RETURN_IF_ERROR(bfrt_p4runtime_translator_->TranslateTableEntryInPlace(
+      result, /*to_sdk=*/false));
   VLOG(1) << "ReadSingleTableEntry resp " << resp.DebugString();
   if (!writer->Write(resp)) {
     return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
@@ -582,16 +813,14 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
   RETURN_IF_ERROR(bf_sde_interface_->GetDefaultTableEntry(
       device_, session, table_id, table_data.get()));
   // FIXME: BuildP4TableEntry is not suitable for default entries.
-  ASSIGN_OR_RETURN(
-      ::p4::v1::TableEntry result,
-      BuildP4TableEntry(table_entry, table_key.get(), table_data.get()));
-  result.set_is_default_action(true);
-  result.clear_match();
-
   ::p4::v1::ReadResponse resp;
-  ASSIGN_OR_RETURN(*resp.add_entities()->mutable_table_entry(),
-                   bfrt_p4runtime_translator_->TranslateTableEntry(
-                       result, /*to_sdk=*/false));
+  auto* result = resp.add_entities()->mutable_table_entry();
+  RETURN_IF_ERROR(BuildP4TableEntry(table_entry, table_key.get(),
+                                    table_data.get(), result));
+  result->set_is_default_action(true);
+  result->clear_match();
+  RETURN_IF_ERROR(bfrt_p4runtime_translator_->TranslateTableEntryInPlace(
+      result, /*to_sdk=*/false));
   VLOG(1) << "ReadDefaultTableEntry resp " << resp.DebugString();
   if (!writer->Write(resp)) {
     return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
@@ -604,38 +833,78 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
     std::shared_ptr<BfSdeInterface::SessionInterface> session,
     const ::p4::v1::TableEntry& table_entry,
     WriterInterface<::p4::v1::ReadResponse>* writer) {
-  RET_CHECK(table_entry.match_size() == 0)
-      << "Match filters on wildcard reads are not supported.";
-  RET_CHECK(table_entry.priority() == 0)
-      << "Priority filters on wildcard reads are not supported.";
-  RET_CHECK(table_entry.has_action() == false)
-      << "Action filters on wildcard reads are not supported.";
-  RET_CHECK(table_entry.metadata() == "")
-      << "Metadata filters on wildcard reads are not supported.";
-  RET_CHECK(table_entry.is_default_action() == false)
-      << "Default action filters on wildcard reads are not supported.";
+  RETURN_IF_ERROR(VerifyWildcardTableRead(table_entry));
 
   ASSIGN_OR_RETURN(uint32 table_id,
                    bf_sde_interface_->GetBfRtId(table_entry.table_id()));
-  std::vector<std::unique_ptr<BfSdeInterface::TableKeyInterface>> keys;
-  std::vector<std::unique_ptr<BfSdeInterface::TableDataInterface>> datas;
-  RETURN_IF_ERROR(bf_sde_interface_->GetAllTableEntries(
-      device_, session, table_id, &keys, &datas));
-  ::p4::v1::ReadResponse resp;
-  for (size_t i = 0; i < keys.size(); ++i) {
-    const std::unique_ptr<BfSdeInterface::TableKeyInterface>& table_key =
-        keys[i];
-    const std::unique_ptr<BfSdeInterface::TableDataInterface>& table_data =
-        datas[i];
-    ASSIGN_OR_RETURN(
-        auto result,
-        BuildP4TableEntry(table_entry, table_key.get(), table_data.get()));
-    ASSIGN_OR_RETURN(*resp.add_entities()->mutable_table_entry(),
-                     bfrt_p4runtime_translator_->TranslateTableEntry(
-                         result, /*to_sdk=*/false));
+  // Page through the table and stream each chunk as a separate ReadResponse,
+  // which bounds both the memory use and the gRPC message size.
+  const int chunk_size = FLAGS_bfrt_table_read_chunk_size;
+  std::unique_ptr<BfSdeInterface::TableKeyInterface> cursor;
+  while (true) {
+    std::vector<std::unique_ptr<BfSdeInterface::TableKeyInterface>> keys;
+    std::vector<std::unique_ptr<BfSdeInterface::TableDataInterface>> datas;
+    RETURN_IF_ERROR(bf_sde_interface_->GetNextTableEntries(
+        device_, session, table_id, cursor.get(), chunk_size, &keys, &datas));
+    RET_CHECK(keys.size() == datas.size());
+    // An empty table is answered with a single empty response.
+    if (keys.empty() && cursor) break;
+
+    // The response and its entries are built in place on an arena, which
+    // replaces the many small allocations per entry with a few large blocks.
+    google::protobuf::Arena arena;
+    auto* resp =
+        google::protobuf::Arena::CreateMessage<::p4::v1::ReadResponse>(&arena);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto* result = resp->add_entities()->mutable_table_entry();
+      RETURN_IF_ERROR(BuildP4TableEntry(table_entry, keys[i].get(),
+                                        datas[i].get(), result));
+      RETURN_IF_ERROR(bfrt_p4runtime_translator_->TranslateTableEntryInPlace(
+          result, /*to_sdk=*/false));
+    }
+    VLOG(1) << "ReadAllTableEntries resp " << resp->DebugString();
+    if (!writer->Write(*resp)) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+    }
+    if (keys.size() < static_cast<size_t>(chunk_size)) break;
+    cursor = std::move(keys.back());
   }
 
-  VLOG(1) << "ReadAllTableEntries resp " << resp.DebugString();
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtTableManager::ReadSingleTableEntryFromShadow(
+    std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const ::p4::v1::TableEntry& table_entry,
+    WriterInterface<::p4::v1::ReadResponse>* writer) {
+  ::p4::v1::TableEntry key;
+  RETURN_IF_ERROR(
+      BuildShadowTableEntry(table_entry, /*with_action=*/false, &key));
+  ASSIGN_OR_RETURN(::p4::v1::TableEntry result, table_shadow_.Lookup(key));
+  if (table_entry.has_counter_data()) {
+    // Only the counter values are taken from the SDE, the rest of the entry
+    // does not have to be converted back from the BfRt objects.
+    ASSIGN_OR_RETURN(uint32 table_id,
+                     bf_sde_interface_->GetBfRtId(table_entry.table_id()));
+    ASSIGN_OR_RETURN(auto table_key,
+                     bf_sde_interface_->CreateTableKey(table_id));
+    ASSIGN_OR_RETURN(auto table_data,
+                     bf_sde_interface_->CreateTableData(
+                         table_id, result.action().action().action_id()));
+    RETURN_IF_ERROR(BuildTableKey(table_entry, table_key.get()));
+    RETURN_IF_ERROR(bf_sde_interface_->GetTableEntry(
+        device_, session, table_id, table_key.get(), table_data.get()));
+    uint64 bytes, packets;
+    if (table_data->GetCounterData(&bytes, &packets).ok()) {
+      result.mutable_counter_data()->set_byte_count(bytes);
+      result.mutable_counter_data()->set_packet_count(packets);
+    }
+  }
+  RETURN_IF_ERROR(bfrt_p4runtime_translator_->TranslateTableEntryInPlace(
+      &result, /*to_sdk=*/false));
+  ::p4::v1::ReadResponse resp;
+  resp.add_entities()->mutable_table_entry()->Swap(&result);
+  VLOG(1) << "ReadSingleTableEntryFromShadow resp " << resp.DebugString();
   if (!writer->Write(resp)) {
     return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
   }
@@ -643,15 +912,113 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
   return ::util::OkStatus();
 }
 
+::util::Status BfrtTableManager::ReadAllTableEntriesFromShadow(
+    const ::p4::v1::TableEntry& table_entry,
+    WriterInterface<::p4::v1::ReadResponse>* writer) {
+  RETURN_IF_ERROR(VerifyWildcardTableRead(table_entry));
+
+  // Stream the entries in chunks of the same size as the SDE reads. Like there,
+  // each response is parsed in place on an arena.
+  const size_t chunk_size = FLAGS_bfrt_table_read_chunk_size;
+  const std::vector<std::string> entries =
+      table_shadow_.GetEntries(table_entry.table_id());
+  // An empty table is answered with a single empty response.
+  for (size_t begin = 0; begin == 0 || begin < entries.size();
+       begin += chunk_size) {
+    const size_t end = std::min(begin + chunk_size, entries.size());
+    google::protobuf::Arena arena;
+    auto* resp =
+        google::protobuf::Arena::CreateMessage<::p4::v1::ReadResponse>(&arena);
+    for (size_t i = begin; i < end; ++i) {
+      auto* result = resp->add_entities()->mutable_table_entry();
+      RET_CHECK(result->ParseFromString(entries[i]));
+      RETURN_IF_ERROR(bfrt_p4runtime_translator_->TranslateTableEntryInPlace(
+          result, /*to_sdk=*/false));
+    }
+    VLOG(1) << "ReadAllTableEntriesFromShadow resp " << resp->DebugString();
+    if (!writer->Write(*resp)) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtTableManager::ReadTableEntryAndCheckShadow(
+    std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const ::p4::v1::TableEntry& table_entry,
+    WriterInterface<::p4::v1::ReadResponse>* writer) {
+  const bool wildcard = table_entry.match_size() == 0;
+  TableEntryCollector sde_entries(writer);
+  ::util::Status status =
+      wildcard ? ReadAllTableEntries(session, table_entry, &sde_entries)
+               : ReadSingleTableEntry(session, table_entry, &sde_entries);
+  if (!status.ok() && status.error_code() != ERR_ENTRY_NOT_FOUND) {
+    return status;
+  }
+
+  ::p4::v1::TableEntry shadow_request = table_entry;
+  shadow_request.clear_counter_data();
+  TableEntryCollector shadow_entries(nullptr);
+  ::util::Status shadow_status =
+      wildcard ? ReadAllTableEntriesFromShadow(shadow_request, &shadow_entries)
+               : ReadSingleTableEntryFromShadow(session, shadow_request,
+                                                &shadow_entries);
+  if (!shadow_status.ok() &&
+      shadow_status.error_code() != ERR_ENTRY_NOT_FOUND) {
+    LOG(ERROR) << "Failed to read " << shadow_request.ShortDebugString()
+               << " from the table shadow: " << shadow_status;
+    return status;
+  }
+
+  // Match up the entries by match key and compare them without counter data.
+  absl::flat_hash_map<std::string, ::p4::v1::TableEntry> shadow_by_key;
+  for (const auto& entry : shadow_entries.entries()) {
+    shadow_by_key.emplace(BfrtTableShadow::MatchKey(entry), entry);
+  }
+  int num_mismatches = 0;
+  for (::p4::v1::TableEntry entry : sde_entries.entries()) {
+    entry.clear_counter_data();
+    auto it = shadow_by_key.find(BfrtTableShadow::MatchKey(entry));
+    if (it == shadow_by_key.end()) {
+      LOG(ERROR) << "Table entry " << entry.ShortDebugString()
+                 << " is missing from the table shadow.";
+      ++num_mismatches;
+      continue;
+    }
+    if (!google::protobuf::util::MessageDifferencer::Equals(entry,
+                                                            it->second)) {
+      LOG(ERROR) << "Table entry " << entry.ShortDebugString()
+                 << " differs from the table shadow entry "
+                 << it->second.ShortDebugString() << ".";
+      ++num_mismatches;
+    }
+    shadow_by_key.erase(it);
+  }
+  for (const auto& e : shadow_by_key) {
+    LOG(ERROR) << "Table shadow entry " << e.second.ShortDebugString()
+               << " is missing from the SDE.";
+    ++num_mismatches;
+  }
+  if (num_mismatches > 0) {
+    LOG(ERROR) << "Found " << num_mismatches << " mismatches between the SDE "
+               << "and the table shadow on read "
+               << table_entry.ShortDebugString() << ".";
+  }
+
+  return status;
+}
+
 ::util::Status BfrtTableManager::ReadTableEntry(
     std::shared_ptr<BfSdeInterface::SessionInterface> session,
     const ::p4::v1::TableEntry& table_entry,
     WriterInterface<::p4::v1::ReadResponse>* writer) {
   RET_CHECK(writer) << "Null writer.";
   absl::ReaderMutexLock l(&lock_);
-  ASSIGN_OR_RETURN(const auto& translated_table_entry,
-                   bfrt_p4runtime_translator_->TranslateTableEntry(
-                       table_entry, /*to_sdk=*/true));
+  google::protobuf::Arena arena;
+  ASSIGN_OR_RETURN(const ::p4::v1::TableEntry* translated_entry,
+                   TranslateTableEntryToSdk(table_entry, &arena));
+  const ::p4::v1::TableEntry& translated_table_entry = *translated_entry;
 
   // We have four cases to handle:
   // 1. table id not set: return all table entries from all tables
@@ -686,8 +1053,25 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
       }
     }
     for (const auto& wanted_table_entry : wanted_tables) {
-      RETURN_IF_ERROR_WITH_APPEND(
-          ReadAllTableEntries(session, wanted_table_entry, writer))
+      ::util::Status status;
+      switch (GetTableShadowMode(wanted_table_entry.table_id())) {
+        case TableShadowMode::kOn:
+          // Counter values have to be read from the SDE, which returns the
+          // whole entries with them.
+          if (!wanted_table_entry.has_counter_data()) {
+            status = ReadAllTableEntriesFromShadow(wanted_table_entry, writer);
+            break;
+          }
+          ABSL_FALLTHROUGH_INTENDED;
+        case TableShadowMode::kOff:
+          status = ReadAllTableEntries(session, wanted_table_entry, writer);
+          break;
+        case TableShadowMode::kCheck:
+          status = ReadTableEntryAndCheckShadow(session, wanted_table_entry,
+                                                writer);
+          break;
+      }
+      RETURN_IF_ERROR_WITH_APPEND(status)
               .with_logging()
           << "Failed to read all table entries for request "
           << translated_table_entry.ShortDebugString() << ".";
@@ -704,6 +1088,16 @@ std::unique_ptr<BfrtTableManager> BfrtTableManager::CreateInstance(
           device_, session, table_entry.table_id(),
           absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
     }
+    switch (GetTableShadowMode(translated_table_entry.table_id())) {
+      case TableShadowMode::kOn:
+        return ReadSingleTableEntryFromShadow(session, translated_table_entry,
+                                              writer);
+      case TableShadowMode::kCheck:
+        return ReadTableEntryAndCheckShadow(session, translated_table_entry,
+                                            writer);
+      case TableShadowMode::kOff:
+        break;
+    }
     return ReadSingleTableEntry(session, translated_table_entry, writer);
   }
 
@@ -826,12 +1220,78 @@ BfrtTableManager::ReadDirectCounterEntry(
       &register_datas, absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
 
   ::p4::v1::ReadResponse resp;
+  RETURN_IF_ERROR(AppendRegisterEntries(translated_register_entry.register_id(),
+                                        register_indices, register_datas,
+                                        &resp));
+
+  VLOG(1) << "ReadRegisterEntry resp " << resp.DebugString();
+  if (!writer->Write(resp)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtTableManager::ReadRegisterEntries(
+    std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const std::vector<::p4::v1::RegisterEntry>& register_entries,
+    WriterInterface<::p4::v1::ReadResponse>* writer) {
+  RET_CHECK(!register_entries.empty()) << "No register entries to read.";
+  uint32 register_id = 0;
+  std::vector<uint32> requested_indices;
+  requested_indices.reserve(register_entries.size());
+  for (const auto& register_entry : register_entries) {
+    ASSIGN_OR_RETURN(const auto& translated_register_entry,
+                     bfrt_p4runtime_translator_->TranslateRegisterEntry(
+                         register_entry, /*to_sdk=*/true));
+    {
+      absl::ReaderMutexLock l(&lock_);
+      RETURN_IF_ERROR(
+          p4_info_manager_->VerifyRegisterEntry(translated_register_entry));
+    }
+    RET_CHECK(translated_register_entry.has_index())
+        << "Only entries with an index can be read together.";
+    if (requested_indices.empty()) {
+      register_id = translated_register_entry.register_id();
+    } else {
+      RET_CHECK(translated_register_entry.register_id() == register_id)
+          << "Only entries of the same register can be read together.";
+    }
+    requested_indices.push_back(translated_register_entry.index().index());
+  }
+
+  ASSIGN_OR_RETURN(uint32 table_id, bf_sde_interface_->GetBfRtId(register_id));
+  std::vector<uint32> register_indices;
+  std::vector<uint64> register_datas;
+  RETURN_IF_ERROR(bf_sde_interface_->ReadRegisterRanges(
+      device_, session, table_id, IndicesToRanges(requested_indices),
+      &register_indices, &register_datas,
+      absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
+
+  ::p4::v1::ReadResponse read_resp;
+  RETURN_IF_ERROR(AppendRegisterEntries(register_id, register_indices,
+                                        register_datas, &read_resp));
+  ::p4::v1::ReadResponse resp;
+  RETURN_IF_ERROR(OrderEntitiesLikeRequest(requested_indices, register_indices,
+                                           &read_resp, &resp));
+
+  VLOG(1) << "ReadRegisterEntries resp " << resp.DebugString();
+  if (!writer->Write(resp)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtTableManager::AppendRegisterEntries(
+    uint32 register_id, const std::vector<uint32>& register_indices,
+    const std::vector<uint64>& register_datas, ::p4::v1::ReadResponse* resp) {
   for (size_t i = 0; i < register_indices.size(); ++i) {
     const uint32 register_index = register_indices[i];
     const uint64 register_data = register_datas[i];
     ::p4::v1::RegisterEntry result;
 
-    result.set_register_id(translated_register_entry.register_id());
+    result.set_register_id(register_id);
     result.mutable_index()->set_index(register_index);
     // TODO(max): Switch to tuple form, once compiler support landed.
     // ::p4::v1::P4StructLike register_tuple;
@@ -842,16 +1302,11 @@ BfrtTableManager::ReadDirectCounterEntry(
     // *result.mutable_data()->mutable_tuple() = register_tuple;
     result.mutable_data()->set_bitstring(Uint64ToByteStream(register_data));
 
-    ASSIGN_OR_RETURN(*resp.add_entities()->mutable_register_entry(),
+    ASSIGN_OR_RETURN(*resp->add_entities()->mutable_register_entry(),
                      bfrt_p4runtime_translator_->TranslateRegisterEntry(
                          result, /*to_sdk=*/false));
   }
 
-  VLOG(1) << "ReadRegisterEntry resp " << resp.DebugString();
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
-  }
-
   return ::util::OkStatus();
 }
 
@@ -896,24 +1351,7 @@ BfrtTableManager::ReadDirectCounterEntry(
       << "Wildcard MeterEntry reads are not supported.";
   ASSIGN_OR_RETURN(uint32 table_id, bf_sde_interface_->GetBfRtId(
                                         translated_meter_entry.meter_id()));
-  bool meter_units_in_bits;  // or packets
-  {
-    absl::ReaderMutexLock l(&lock_);
-    ASSIGN_OR_RETURN(auto meter, p4_info_manager_->FindMeterByID(
-                                     translated_meter_entry.meter_id()));
-    switch (meter.spec().unit()) {
-      case ::p4::config::v1::MeterSpec::BYTES:
-        meter_units_in_bits = true;
-        break;
-      case ::p4::config::v1::MeterSpec::PACKETS:
-        meter_units_in_bits = false;
-        break;
-      default:
-        return MAKE_ERROR(ERR_INVALID_PARAM)
-               << "Unsupported meter spec on meter " << meter.ShortDebugString()
-               << ".";
-    }
-  }
+  RETURN_IF_ERROR(VerifyMeterUnit(translated_meter_entry.meter_id()));
   // Index 0 is a valid value and not a wildcard.
   absl::optional<uint32> optional_meter_index;
   if (translated_meter_entry.has_index()) {
@@ -931,9 +1369,92 @@ BfrtTableManager::ReadDirectCounterEntry(
       &cbursts, &pirs, &pbursts, &in_pps));
 
   ::p4::v1::ReadResponse resp;
+  RETURN_IF_ERROR(AppendMeterEntries(translated_meter_entry.meter_id(),
+                                     meter_indices, cirs, cbursts, pirs,
+                                     pbursts, &resp));
+
+  VLOG(1) << "ReadMeterEntry resp " << resp.DebugString();
+  if (!writer->Write(resp)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtTableManager::ReadMeterEntries(
+    std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const std::vector<::p4::v1::MeterEntry>& meter_entries,
+    WriterInterface<::p4::v1::ReadResponse>* writer) {
+  RET_CHECK(!meter_entries.empty()) << "No meter entries to read.";
+  uint32 meter_id = 0;
+  std::vector<uint32> requested_indices;
+  requested_indices.reserve(meter_entries.size());
+  for (const auto& meter_entry : meter_entries) {
+    ASSIGN_OR_RETURN(const auto& translated_meter_entry,
+                     bfrt_p4runtime_translator_->TranslateMeterEntry(
+                         meter_entry, /*to_sdk=*/true));
+    RET_CHECK(translated_meter_entry.meter_id() != 0)
+        << "Wildcard MeterEntry reads are not supported.";
+    RET_CHECK(translated_meter_entry.has_index())
+        << "Only entries with an index can be read together.";
+    if (requested_indices.empty()) {
+      meter_id = translated_meter_entry.meter_id();
+    } else {
+      RET_CHECK(translated_meter_entry.meter_id() == meter_id)
+          << "Only entries of the same meter can be read together.";
+    }
+    requested_indices.push_back(translated_meter_entry.index().index());
+  }
+  ASSIGN_OR_RETURN(uint32 table_id, bf_sde_interface_->GetBfRtId(meter_id));
+  RETURN_IF_ERROR(VerifyMeterUnit(meter_id));
+
+  std::vector<uint32> meter_indices;
+  std::vector<uint64> cirs;
+  std::vector<uint64> cbursts;
+  std::vector<uint64> pirs;
+  std::vector<uint64> pbursts;
+  std::vector<bool> in_pps;
+  RETURN_IF_ERROR(bf_sde_interface_->ReadIndirectMeterRanges(
+      device_, session, table_id, IndicesToRanges(requested_indices),
+      &meter_indices, &cirs, &cbursts, &pirs, &pbursts, &in_pps));
+
+  ::p4::v1::ReadResponse read_resp;
+  RETURN_IF_ERROR(AppendMeterEntries(meter_id, meter_indices, cirs, cbursts,
+                                     pirs, pbursts, &read_resp));
+  ::p4::v1::ReadResponse resp;
+  RETURN_IF_ERROR(OrderEntitiesLikeRequest(requested_indices, meter_indices,
+                                           &read_resp, &resp));
+
+  VLOG(1) << "ReadMeterEntries resp " << resp.DebugString();
+  if (!writer->Write(resp)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtTableManager::VerifyMeterUnit(uint32 meter_id) {
+  absl::ReaderMutexLock l(&lock_);
+  ASSIGN_OR_RETURN(auto meter, p4_info_manager_->FindMeterByID(meter_id));
+  switch (meter.spec().unit()) {
+    case ::p4::config::v1::MeterSpec::BYTES:
+    case ::p4::config::v1::MeterSpec::PACKETS:
+      return ::util::OkStatus();
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Unsupported meter spec on meter " << meter.ShortDebugString()
+             << ".";
+  }
+}
+
+::util::Status BfrtTableManager::AppendMeterEntries(
+    uint32 meter_id, const std::vector<uint32>& meter_indices,
+    const std::vector<uint64>& cirs, const std::vector<uint64>& cbursts,
+    const std::vector<uint64>& pirs, const std::vector<uint64>& pbursts,
+    ::p4::v1::ReadResponse* resp) {
   for (size_t i = 0; i < meter_indices.size(); ++i) {
     ::p4::v1::MeterEntry result;
-    result.set_meter_id(translated_meter_entry.meter_id());
+    result.set_meter_id(meter_id);
     result.mutable_index()->set_index(meter_indices[i]);
     if (cirs[i] >= kUnsetMeterThresholdRead) {
       // The high value returned from the SDE indicates that this meter is
@@ -948,15 +1469,11 @@ BfrtTableManager::ReadDirectCounterEntry(
       result.mutable_config()->set_pburst(pbursts[i]);
     }
 
-    ASSIGN_OR_RETURN(*resp.add_entities()->mutable_meter_entry(),
+    ASSIGN_OR_RETURN(*resp->add_entities()->mutable_meter_entry(),
                      bfrt_p4runtime_translator_->TranslateMeterEntry(
                          result, /*to_sdk=*/false));
   }
 
-  VLOG(1) << "ReadMeterEntry resp " << resp.DebugString();
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
-  }
 
   return ::util::OkStatus();
 }
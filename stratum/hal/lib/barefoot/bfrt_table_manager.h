@@ -8,6 +8,7 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena.h"
 #include "p4/v1/p4runtime.grpc.pb.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/integral_types.h"
@@ -17,6 +18,7 @@
 #include "stratum/hal/lib/barefoot/bf_global_vars.h"
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
 #include "stratum/hal/lib/barefoot/bfrt_p4runtime_translator.h"
+#include "stratum/hal/lib/barefoot/bfrt_table_shadow.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/hal/lib/p4/p4_info_manager.h"
@@ -27,6 +29,27 @@ namespace barefoot {
 
 class BfrtTableManager {
  public:
+  // A table entry write which has been translated and converted into BfRt key
+  // and data objects, but has not been submitted to the SDE yet. Created by
+  // PrepareTableEntryWrite() and consumed by CommitTableEntryWrite().
+  struct TableEntryWrite {
+    ::p4::v1::Update::Type type = ::p4::v1::Update::UNSPECIFIED;
+    // BfRt (not P4) table ID.
+    uint32 table_id = 0;
+    bool is_default_action = false;
+    std::unique_ptr<BfSdeInterface::TableKeyInterface> table_key;
+    // Null for a default action reset.
+    std::unique_ptr<BfSdeInterface::TableDataInterface> table_data;
+    // True if the table shadow is updated once the write has been accepted by
+    // the SDE, with the entry as it is stored in the shadow. The entry is
+    // allocated on the arena given to PrepareTableEntryWrite().
+    bool update_shadow = false;
+    const ::p4::v1::TableEntry* shadow_entry = nullptr;
+    // The pipeline the write was prepared against. The commit fails if a new
+    // pipeline has been pushed since.
+    uint64 pipeline_epoch = 0;
+  };
+
   virtual ~BfrtTableManager();
 
   // Pushes the pipline info.
@@ -50,6 +73,23 @@ class BfrtTableManager {
       const ::p4::v1::Update::Type type,
       const ::p4::v1::TableEntry& table_entry) LOCKS_EXCLUDED(lock_);
 
+  // Translates a table entry and builds the SDE key and data objects for it,
+  // without touching the SDE session. This is the first stage of
+  // WriteTableEntry() and is safe to call concurrently from multiple threads.
+  // The translated and shadow entries are allocated on 'arena', which is
+  // usually shared by all the updates of a write request and must outlive
+  // 'write'.
+  virtual ::util::Status PrepareTableEntryWrite(
+      const ::p4::v1::Update::Type type,
+      const ::p4::v1::TableEntry& table_entry, google::protobuf::Arena* arena,
+      TableEntryWrite* write) LOCKS_EXCLUDED(lock_);
+
+  // Submits a table entry write previously built by PrepareTableEntryWrite()
+  // to the SDE. This is the second stage of WriteTableEntry().
+  virtual ::util::Status CommitTableEntryWrite(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const TableEntryWrite& write) LOCKS_EXCLUDED(lock_);
+
   // Reads the P4 TableEntry(s) matched by the given table entry.
   virtual ::util::Status ReadTableEntry(
       std::shared_ptr<BfSdeInterface::SessionInterface> session,
@@ -119,12 +159,28 @@ class BfrtTableManager {
       const ::p4::v1::RegisterEntry& register_entry,
       WriterInterface<::p4::v1::ReadResponse>* writer) LOCKS_EXCLUDED(lock_);
 
+  // Read the data of a set of indexed entries of the same register, with a
+  // single register sync. The entries are written in one response, with one
+  // entity per requested entry in the order of the request.
+  virtual ::util::Status ReadRegisterEntries(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const std::vector<::p4::v1::RegisterEntry>& register_entries,
+      WriterInterface<::p4::v1::ReadResponse>* writer) LOCKS_EXCLUDED(lock_);
+
   // Read the data of a meter entry.
   virtual ::util::Status ReadMeterEntry(
       std::shared_ptr<BfSdeInterface::SessionInterface> session,
       const ::p4::v1::MeterEntry& meter_entry,
       WriterInterface<::p4::v1::ReadResponse>* writer) LOCKS_EXCLUDED(lock_);
 
+  // Read the data of a set of indexed entries of the same meter. The entries
+  // are written in one response, with one entity per requested entry in the
+  // order of the request.
+  virtual ::util::Status ReadMeterEntries(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const std::vector<::p4::v1::MeterEntry>& meter_entries,
+      WriterInterface<::p4::v1::ReadResponse>* writer) LOCKS_EXCLUDED(lock_);
+
   // Read the data of a digest entry.
   virtual ::util::Status ReadDigestEntry(
       std::shared_ptr<BfSdeInterface::SessionInterface> session,
@@ -151,6 +207,14 @@ class BfrtTableManager {
   BfrtTableManager();
 
  private:
+  // How table reads make use of the table shadow, see the bfrt_table_shadow
+  // flag.
+  enum class TableShadowMode {
+    kOff,
+    kOn,
+    kCheck,
+  };
+
   // Private constructor, we can create the instance by using `CreateInstance`
   // function only.
   explicit BfrtTableManager(OperationMode mode,
@@ -171,6 +235,12 @@ class BfrtTableManager {
   ::util::Status BuildTableData(const ::p4::v1::TableEntry& table_entry,
                                 BfSdeInterface::TableDataInterface* table_data);
 
+  // Translates a P4RT table entry to the SDK side. Entries without fields to
+  // translate are returned as they are, without a copy. Otherwise the entry is
+  // translated into a copy allocated on 'arena', which is returned.
+  ::util::StatusOr<const ::p4::v1::TableEntry*> TranslateTableEntryToSdk(
+      const ::p4::v1::TableEntry& table_entry, google::protobuf::Arena* arena);
+
   ::util::Status ReadSingleTableEntry(
       std::shared_ptr<BfSdeInterface::SessionInterface> session,
       const ::p4::v1::TableEntry& table_entry,
@@ -189,13 +259,71 @@ class BfrtTableManager {
       WriterInterface<::p4::v1::ReadResponse>* writer)
       SHARED_LOCKS_REQUIRED(lock_);
 
+  // Returns the mode in which the table shadow is used to read entries from the
+  // given table. Const tables are never shadowed, since their entries are not
+  // written through this class.
+  TableShadowMode GetTableShadowMode(uint32 table_id) const
+      SHARED_LOCKS_REQUIRED(lock_);
+
+  // Builds the table entry stored in the table shadow from a translated P4RT
+  // table entry into 'result', which must be empty. Without 'with_action',
+  // only the fields identifying the entry are set, as used for lookups.
+  ::util::Status BuildShadowTableEntry(const ::p4::v1::TableEntry& table_entry,
+                                       bool with_action,
+                                       ::p4::v1::TableEntry* result) const
+      SHARED_LOCKS_REQUIRED(lock_);
+
+  // Reads a single table entry from the table shadow. Counter data, if
+  // requested, is read from the SDE and merged into the entry.
+  ::util::Status ReadSingleTableEntryFromShadow(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const ::p4::v1::TableEntry& table_entry,
+      WriterInterface<::p4::v1::ReadResponse>* writer)
+      SHARED_LOCKS_REQUIRED(lock_);
+
+  // Reads all the entries of a table from the table shadow.
+  ::util::Status ReadAllTableEntriesFromShadow(
+      const ::p4::v1::TableEntry& table_entry,
+      WriterInterface<::p4::v1::ReadResponse>* writer)
+      SHARED_LOCKS_REQUIRED(lock_);
+
+  // Reads the entries matched by a single-entry or wildcard table entry from
+  // the SDE, and logs the entries in which the result differs from the table
+  // shadow. Counter data is not compared.
+  ::util::Status ReadTableEntryAndCheckShadow(
+      std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const ::p4::v1::TableEntry& table_entry,
+      WriterInterface<::p4::v1::ReadResponse>* writer)
+      SHARED_LOCKS_REQUIRED(lock_);
+
   // Construct a P4RT table entry from a table entry request, table key and
-  // table data.
-  ::util::StatusOr<::p4::v1::TableEntry> BuildP4TableEntry(
+  // table data. The entry is built in place, so that it can be part of a
+  // response allocated on an arena.
+  ::util::Status BuildP4TableEntry(
       const ::p4::v1::TableEntry& request,
       const BfSdeInterface::TableKeyInterface* table_key,
-      const BfSdeInterface::TableDataInterface* table_data)
-      SHARED_LOCKS_REQUIRED(lock_);
+      const BfSdeInterface::TableDataInterface* table_data,
+      ::p4::v1::TableEntry* result) SHARED_LOCKS_REQUIRED(lock_);
+
+  // Appends the given register entries, as read from the SDE, to a P4RT read
+  // response.
+  ::util::Status AppendRegisterEntries(
+      uint32 register_id, const std::vector<uint32>& register_indices,
+      const std::vector<uint64>& register_datas,
+      ::p4::v1::ReadResponse* resp);
+
+  // Checks that the given meter exists and has a supported unit.
+  ::util::Status VerifyMeterUnit(uint32 meter_id) LOCKS_EXCLUDED(lock_);
+
+  // Appends the given meter entries, as read from the SDE, to a P4RT read
+  // response.
+  ::util::Status AppendMeterEntries(uint32 meter_id,
+                                    const std::vector<uint32>& meter_indices,
+                                    const std::vector<uint64>& cirs,
+                                    const std::vector<uint64>& cbursts,
+                                    const std::vector<uint64>& pirs,
+                                    const std::vector<uint64>& pbursts,
+                                    ::p4::v1::ReadResponse* resp);
 
   // Construct a P4RT digest list from a list of learn data.
   ::util::StatusOr<::p4::v1::DigestList> BuildP4DigestList(
@@ -253,6 +381,17 @@ class BfrtTableManager {
   // to all feature managers.
   std::unique_ptr<P4InfoManager> p4_info_manager_ GUARDED_BY(lock_);
 
+  // The mode of the table shadow, set when the pipeline is pushed.
+  TableShadowMode table_shadow_mode_ GUARDED_BY(lock_);
+
+  // Incremented on every pipeline push, so that table entry writes prepared
+  // against an older pipeline are not committed to the new one.
+  uint64 pipeline_epoch_ GUARDED_BY(lock_);
+
+  // Write-through copy of the table entries written to the SDE. It has its own
+  // lock, since it is updated by concurrent writers holding lock_ shared.
+  BfrtTableShadow table_shadow_;
+
   // Fixed zero-based Tofino device number corresponding to the node/ASIC
   // managed by this class instance. Assigned in the class constructor.
   const int device_;
@@ -0,0 +1,343 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks wildcard table reads of the BfrtTableManager against the SDE mock.
+// The mock serves a table of configurable size in pages, which allows
+// measuring the cost of the read path and the size of the streamed responses
+// for different chunk sizes. Reads from the table shadow and the prepare stage
+// of table entry writes are benchmarked too. The heap allocations are counted
+// by replacing the global operator new, and reported per read or written
+// entry.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "benchmark/benchmark.h"
+#include "gflags/gflags.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/arena.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/barefoot/bf_sde_mock.h"
+#include "stratum/hal/lib/barefoot/bfrt_p4runtime_translator_mock.h"
+#include "stratum/hal/lib/barefoot/bfrt_table_manager.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/hal/lib/p4/utils.h"
+#include "stratum/lib/utils.h"
+
+DECLARE_int32(bfrt_table_read_chunk_size);
+DECLARE_string(bfrt_table_shadow);
+
+namespace {
+// The number of heap allocations made so far, including the blocks of protobuf
+// arenas and the allocations of the mocks.
+std::atomic<int64_t> num_allocations(0);
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t size) noexcept { std::free(ptr); }
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+constexpr int kDevice = 0;
+constexpr uint32 kP4TableId = 33583783;
+constexpr uint32 kBfRtTableId = 20;
+constexpr uint32 kP4ActionId = 16794911;
+
+constexpr char kPipelineConfigText[] = R"pb(
+  programs {
+    name: "benchmark"
+    p4info {
+      pkg_info { arch: "tna" }
+      tables {
+        preamble { id: 33583783 name: "Ingress.control.table1" }
+        match_fields { id: 1 name: "field1" bitwidth: 32 match_type: EXACT }
+        action_refs { id: 16794911 }
+        size: 1048576
+      }
+      actions {
+        preamble { id: 16794911 name: "Ingress.control.action1" }
+        params { id: 1 name: "port" bitwidth: 9 }
+      }
+    }
+  }
+)pb";
+
+// Writer which only records the number and size of the streamed responses.
+class CountingWriter : public WriterInterface<::p4::v1::ReadResponse> {
+ public:
+  bool Write(const ::p4::v1::ReadResponse& msg) override {
+    ++responses_;
+    entities_ += msg.entities_size();
+    max_response_bytes_ =
+        std::max(max_response_bytes_, static_cast<size_t>(msg.ByteSizeLong()));
+    return true;
+  }
+
+  int responses_ = 0;
+  int entities_ = 0;
+  size_t max_response_bytes_ = 0;
+};
+
+std::unique_ptr<BfSdeInterface::TableKeyInterface> MakeTableKey(int index) {
+  auto table_key = absl::make_unique<NiceMock<TableKeyMock>>();
+  ON_CALL(*table_key, GetExact(1, _))
+      .WillByDefault(DoAll(SetArgPointee<1>(Uint32ToByteStream(index + 1)),
+                           Return(::util::OkStatus())));
+  return std::move(table_key);
+}
+
+std::unique_ptr<BfSdeInterface::TableDataInterface> MakeTableData() {
+  auto table_data = absl::make_unique<NiceMock<TableDataMock>>();
+  ON_CALL(*table_data, GetActionId(_))
+      .WillByDefault(
+          DoAll(SetArgPointee<0>(kP4ActionId), Return(::util::OkStatus())));
+  ON_CALL(*table_data, GetParam(1, _))
+      .WillByDefault(
+          DoAll(SetArgPointee<1>(std::string("\x01", 1)),
+                Return(::util::OkStatus())));
+  ON_CALL(*table_data, GetActionMemberId(_))
+      .WillByDefault(Return(
+          ::util::Status(StratumErrorSpace(), ERR_INVALID_PARAM, "")));
+  ON_CALL(*table_data, GetSelectorGroupId(_))
+      .WillByDefault(Return(
+          ::util::Status(StratumErrorSpace(), ERR_INVALID_PARAM, "")));
+  return std::move(table_data);
+}
+
+// Arguments: number of table entries, read chunk size.
+void BM_ReadAllTableEntries(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  FLAGS_bfrt_table_read_chunk_size = state.range(1);
+
+  NiceMock<BfSdeMock> bf_sde_mock;
+  NiceMock<BfrtP4RuntimeTranslatorMock> translator_mock;
+  auto session = std::make_shared<NiceMock<SessionMock>>();
+  ON_CALL(bf_sde_mock, CreateSession())
+      .WillByDefault(Invoke([session]() {
+        return ::util::StatusOr<
+            std::shared_ptr<BfSdeInterface::SessionInterface>>(session);
+      }));
+  ON_CALL(bf_sde_mock, GetBfRtId(kP4TableId))
+      .WillByDefault(Return(kBfRtTableId));
+  ON_CALL(translator_mock, TableEntryRequiresTranslation(_))
+      .WillByDefault(Return(false));
+  // Serves the table page by page. The position is tracked outside of the key
+  // objects, which are opaque mocks.
+  int position = 0;
+  ON_CALL(bf_sde_mock, GetNextTableEntries(kDevice, _, kBfRtTableId, _, _, _, _))
+      .WillByDefault(Invoke(
+          [&position, num_entries](
+              int device,
+              std::shared_ptr<BfSdeInterface::SessionInterface> session,
+              uint32 table_id, const BfSdeInterface::TableKeyInterface* cursor,
+              int max_entries,
+              std::vector<std::unique_ptr<BfSdeInterface::TableKeyInterface>>*
+                  table_keys,
+              std::vector<std::unique_ptr<BfSdeInterface::TableDataInterface>>*
+                  table_datas) {
+            if (cursor == nullptr) position = 0;
+            table_keys->clear();
+            table_datas->clear();
+            for (; position < num_entries &&
+                   static_cast<int>(table_keys->size()) < max_entries;
+                 ++position) {
+              table_keys->push_back(MakeTableKey(position));
+              table_datas->push_back(MakeTableData());
+            }
+            return ::util::OkStatus();
+          }));
+
+  auto bfrt_table_manager = BfrtTableManager::CreateInstance(
+      OPERATION_MODE_STANDALONE, &bf_sde_mock, &translator_mock, kDevice);
+  BfrtDeviceConfig config;
+  CHECK_OK(ParseProtoFromString(kPipelineConfigText, &config));
+  CHECK_OK(bfrt_table_manager->PushForwardingPipelineConfig(config));
+
+  ::p4::v1::TableEntry wildcard;
+  wildcard.set_table_id(kP4TableId);
+  CountingWriter writer;
+  const int64_t allocations_before = num_allocations.load();
+  for (auto _ : state) {
+    CHECK_OK(bfrt_table_manager->ReadTableEntry(session, wildcard, &writer));
+  }
+  state.SetItemsProcessed(writer.entities_);
+  state.counters["responses_per_read"] =
+      static_cast<double>(writer.responses_) / state.iterations();
+  state.counters["max_response_bytes"] = writer.max_response_bytes_;
+  state.counters["allocs_per_entry"] =
+      static_cast<double>(num_allocations.load() - allocations_before) /
+      std::max(writer.entities_, 1);
+  CHECK_OK(bfrt_table_manager->Shutdown());
+}
+BENCHMARK(BM_ReadAllTableEntries)
+    ->Args({10000, 256})
+    ->Args({10000, 1024})
+    ->Args({10000, 8192})
+    ->Args({100000, 1024})
+    ->Args({100000, 8192})
+    // A single chunk covering the whole table, like the unchunked read path.
+    ->Args({100000, 1 << 20})
+    ->Unit(benchmark::kMillisecond);
+
+// Returns the P4RT entry of the benchmark table with the given index.
+::p4::v1::TableEntry MakeP4TableEntry(int index) {
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kP4TableId);
+  auto* match = entry.add_match();
+  match->set_field_id(1);
+  match->mutable_exact()->set_value(Uint32ToByteStream(index + 1));
+  auto* action = entry.mutable_action()->mutable_action();
+  action->set_action_id(kP4ActionId);
+  auto* param = action->add_params();
+  param->set_param_id(1);
+  param->set_value(std::string("\x01", 1));
+  return entry;
+}
+
+// Sets up the SDE mock to accept the writes of the benchmark table.
+void SetUpTableWrites(NiceMock<BfSdeMock>* bf_sde_mock) {
+  ON_CALL(*bf_sde_mock, GetBfRtId(kP4TableId))
+      .WillByDefault(Return(kBfRtTableId));
+  ON_CALL(*bf_sde_mock, CreateTableKey(kBfRtTableId))
+      .WillByDefault(Invoke([](uint32 table_id) {
+        return ::util::StatusOr<
+            std::unique_ptr<BfSdeInterface::TableKeyInterface>>(
+            absl::make_unique<NiceMock<TableKeyMock>>());
+      }));
+  ON_CALL(*bf_sde_mock, CreateTableData(kBfRtTableId, kP4ActionId))
+      .WillByDefault(Invoke([](uint32 table_id, int action_id) {
+        return ::util::StatusOr<
+            std::unique_ptr<BfSdeInterface::TableDataInterface>>(
+            absl::make_unique<NiceMock<TableDataMock>>());
+      }));
+}
+
+// Arguments: number of table entries, read chunk size.
+void BM_ReadAllTableEntriesFromShadow(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  FLAGS_bfrt_table_read_chunk_size = state.range(1);
+  FLAGS_bfrt_table_shadow = "on";
+
+  NiceMock<BfSdeMock> bf_sde_mock;
+  NiceMock<BfrtP4RuntimeTranslatorMock> translator_mock;
+  auto session = std::make_shared<NiceMock<SessionMock>>();
+  ON_CALL(bf_sde_mock, CreateSession())
+      .WillByDefault(Invoke([session]() {
+        return ::util::StatusOr<
+            std::shared_ptr<BfSdeInterface::SessionInterface>>(session);
+      }));
+  SetUpTableWrites(&bf_sde_mock);
+  ON_CALL(translator_mock, TableEntryRequiresTranslation(_))
+      .WillByDefault(Return(false));
+
+  auto bfrt_table_manager = BfrtTableManager::CreateInstance(
+      OPERATION_MODE_STANDALONE, &bf_sde_mock, &translator_mock, kDevice);
+  BfrtDeviceConfig config;
+  CHECK_OK(ParseProtoFromString(kPipelineConfigText, &config));
+  CHECK_OK(bfrt_table_manager->PushForwardingPipelineConfig(config));
+
+  // The writes fill the shadow, the SDE mock accepts all of them.
+  for (int i = 0; i < num_entries; ++i) {
+    CHECK_OK(bfrt_table_manager->WriteTableEntry(
+        session, ::p4::v1::Update::INSERT, MakeP4TableEntry(i)));
+  }
+
+  ::p4::v1::TableEntry wildcard;
+  wildcard.set_table_id(kP4TableId);
+  CountingWriter writer;
+  const int64_t allocations_before = num_allocations.load();
+  for (auto _ : state) {
+    CHECK_OK(bfrt_table_manager->ReadTableEntry(session, wildcard, &writer));
+  }
+  state.SetItemsProcessed(writer.entities_);
+  state.counters["responses_per_read"] =
+      static_cast<double>(writer.responses_) / state.iterations();
+  state.counters["allocs_per_entry"] =
+      static_cast<double>(num_allocations.load() - allocations_before) /
+      std::max(writer.entities_, 1);
+  CHECK_OK(bfrt_table_manager->Shutdown());
+  FLAGS_bfrt_table_shadow = "off";
+}
+BENCHMARK(BM_ReadAllTableEntriesFromShadow)
+    ->Args({10000, 1024})
+    ->Args({100000, 1024})
+    ->Args({100000, 8192})
+    ->Unit(benchmark::kMillisecond);
+
+// Arguments: number of updates of the write request, 1 if the entries need to
+// be translated.
+void BM_PrepareTableEntryWrites(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  FLAGS_bfrt_table_shadow = "on";
+
+  NiceMock<BfSdeMock> bf_sde_mock;
+  NiceMock<BfrtP4RuntimeTranslatorMock> translator_mock;
+  SetUpTableWrites(&bf_sde_mock);
+  ON_CALL(translator_mock, TableEntryRequiresTranslation(_))
+      .WillByDefault(Return(state.range(1) != 0));
+  ON_CALL(translator_mock, TranslateTableEntryInPlace(_, _))
+      .WillByDefault(Return(::util::OkStatus()));
+
+  auto bfrt_table_manager = BfrtTableManager::CreateInstance(
+      OPERATION_MODE_STANDALONE, &bf_sde_mock, &translator_mock, kDevice);
+  BfrtDeviceConfig config;
+  CHECK_OK(ParseProtoFromString(kPipelineConfigText, &config));
+  CHECK_OK(bfrt_table_manager->PushForwardingPipelineConfig(config));
+
+  std::vector<::p4::v1::TableEntry> entries;
+  for (int i = 0; i < num_entries; ++i) entries.push_back(MakeP4TableEntry(i));
+  const int64_t allocations_before = num_allocations.load();
+  for (auto _ : state) {
+    // The arena and the prepared writes are scoped to the request, as in
+    // BfrtNode::WriteForwardingEntries().
+    google::protobuf::Arena arena;
+    std::vector<BfrtTableManager::TableEntryWrite> writes(num_entries);
+    for (int i = 0; i < num_entries; ++i) {
+      CHECK_OK(bfrt_table_manager->PrepareTableEntryWrite(
+          ::p4::v1::Update::INSERT, entries[i], &arena, &writes[i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_entries);
+  // Includes the allocations of the SDE key and data mocks.
+  state.counters["allocs_per_entry"] =
+      static_cast<double>(num_allocations.load() - allocations_before) /
+      (state.iterations() * num_entries);
+  CHECK_OK(bfrt_table_manager->Shutdown());
+  FLAGS_bfrt_table_shadow = "off";
+}
+BENCHMARK(BM_PrepareTableEntryWrites)
+    ->Args({10000, 0})
+    ->Args({10000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -30,6 +30,15 @@ class BfrtTableManagerMock : public BfrtTableManager {
       ::util::Status(std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      const ::p4::v1::Update::Type type,
                      const ::p4::v1::TableEntry& table_entry));
+  MOCK_METHOD4(PrepareTableEntryWrite,
+               ::util::Status(const ::p4::v1::Update::Type type,
+                              const ::p4::v1::TableEntry& table_entry,
+                              google::protobuf::Arena* arena,
+                              TableEntryWrite* write));
+  MOCK_METHOD2(
+      CommitTableEntryWrite,
+      ::util::Status(std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                     const TableEntryWrite& write));
   MOCK_METHOD3(
       ReadTableEntry,
       ::util::Status(std::shared_ptr<BfSdeInterface::SessionInterface> session,
@@ -80,11 +89,23 @@ class BfrtTableManagerMock : public BfrtTableManager {
       ::util::Status(std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      const ::p4::v1::RegisterEntry& register_entry,
                      WriterInterface<::p4::v1::ReadResponse>* writer));
+  MOCK_METHOD3(
+      ReadRegisterEntries,
+      ::util::Status(
+          std::shared_ptr<BfSdeInterface::SessionInterface> session,
+          const std::vector<::p4::v1::RegisterEntry>& register_entries,
+          WriterInterface<::p4::v1::ReadResponse>* writer));
   MOCK_METHOD3(
       ReadMeterEntry,
       ::util::Status(std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      const ::p4::v1::MeterEntry& meter_entry,
                      WriterInterface<::p4::v1::ReadResponse>* writer));
+  MOCK_METHOD3(
+      ReadMeterEntries,
+      ::util::Status(
+          std::shared_ptr<BfSdeInterface::SessionInterface> session,
+          const std::vector<::p4::v1::MeterEntry>& meter_entries,
+          WriterInterface<::p4::v1::ReadResponse>* writer));
 };
 
 }  // namespace barefoot
@@ -7,6 +7,7 @@
 #include <utility>
 
 #include "absl/memory/memory.h"
+#include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/status/status_test_util.h"
@@ -17,6 +18,9 @@
 #include "stratum/lib/test_utils/matchers.h"
 #include "stratum/lib/utils.h"
 
+DECLARE_int32(bfrt_table_read_chunk_size);
+DECLARE_string(bfrt_table_shadow);
+
 // FIXME
 DEFINE_string(bfrt_sde_config_dir, "/var/run/stratum/bfrt_config",
               "The dir used by the SDE to load the device configuration.");
@@ -29,13 +33,19 @@ using test_utils::EqualsProto;
 using ::testing::_;
 using ::testing::ByMove;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::Invoke;
 using ::testing::InvokeWithoutArgs;
 using ::testing::Optional;
+using ::testing::Pointee;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 
+MATCHER_P2(IndexRangeIs, first, last, "") {
+  return arg.first == first && arg.last == last;
+}
+
 class BfrtTableManagerTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -471,6 +481,90 @@ TEST_F(BfrtTableManagerTest, ReadSingleIndirectMeterEntryTest) {
       bfrt_table_manager_->ReadMeterEntry(session_mock, entry, &writer_mock));
 }
 
+TEST_F(BfrtTableManagerTest, ReadIndirectMeterEntriesTest) {
+  ASSERT_OK(PushTestConfig());
+  auto session_mock = std::make_shared<SessionMock>();
+  constexpr int kP4MeterId = 55555;
+  constexpr int kBfRtTableId = 11111;
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  std::vector<::p4::v1::MeterEntry> entries;
+  for (int index : {5, 4, 9}) {
+    ::p4::v1::MeterEntry entry;
+    entry.set_meter_id(kP4MeterId);
+    entry.mutable_index()->set_index(index);
+    entries.push_back(entry);
+  }
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_, TranslateMeterEntry(_, _))
+      .WillRepeatedly(
+          Invoke([](const ::p4::v1::MeterEntry& entry, bool to_sdk) {
+            return ::util::StatusOr<::p4::v1::MeterEntry>(entry);
+          }));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4MeterId))
+      .WillOnce(Return(kBfRtTableId));
+  std::vector<uint32> meter_indices = {4, 5, 9};
+  std::vector<uint64> cirs = {1, 2, kUnsetMeterThresholdRead};
+  std::vector<uint64> cbursts = {100, 200, kUnsetMeterThresholdRead};
+  std::vector<uint64> pirs = {3, 4, kUnsetMeterThresholdRead};
+  std::vector<uint64> pbursts = {300, 400, kUnsetMeterThresholdRead};
+  std::vector<bool> in_pps = {true, true, true};
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              ReadIndirectMeterRanges(
+                  kDevice1, _, kBfRtTableId,
+                  ElementsAre(IndexRangeIs(4, 5), IndexRangeIs(9, 9)), _, _,
+                  _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>(meter_indices), SetArgPointee<5>(cirs),
+                      SetArgPointee<6>(cbursts), SetArgPointee<7>(pirs),
+                      SetArgPointee<8>(pbursts), SetArgPointee<9>(in_pps),
+                      Return(::util::OkStatus())));
+
+  // The entries are written in the order of the request.
+  const std::string kMeterResponseText = R"pb(
+    entities {
+      meter_entry {
+        meter_id: 55555
+        index {
+          index: 5
+        }
+        config {
+          cir: 2
+          cburst: 200
+          pir: 4
+          pburst: 400
+        }
+      }
+    }
+    entities {
+      meter_entry {
+        meter_id: 55555
+        index {
+          index: 4
+        }
+        config {
+          cir: 1
+          cburst: 100
+          pir: 3
+          pburst: 300
+        }
+      }
+    }
+    entities {
+      meter_entry {
+        meter_id: 55555
+        index {
+          index: 9
+        }
+      }
+    }
+  )pb";
+  ::p4::v1::ReadResponse resp;
+  ASSERT_OK(ParseProtoFromString(kMeterResponseText, &resp));
+  EXPECT_CALL(writer_mock, Write(EqualsProto(resp))).WillOnce(Return(true));
+
+  EXPECT_OK(bfrt_table_manager_->ReadMeterEntries(session_mock, entries,
+                                                  &writer_mock));
+}
+
 TEST_F(BfrtTableManagerTest, RejectMeterEntryReadWithoutId) {
   ASSERT_OK(PushTestConfig());
   auto session_mock = std::make_shared<SessionMock>();
@@ -698,8 +792,8 @@ TEST_F(BfrtTableManagerTest, RejectTableEntryWithDontCareRangeMatch) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   ::util::Status ret =
       bfrt_table_manager_->ReadTableEntry(session_mock, entry, &writer_mock);
@@ -733,8 +827,52 @@ TEST_F(BfrtTableManagerTest, WriteTableEntryTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
+
+  EXPECT_OK(bfrt_table_manager_->WriteTableEntry(
+      session_mock, ::p4::v1::Update::INSERT, entry));
+}
+
+// Entries with fields to translate are translated on a copy, which is used to
+// build the SDE key.
+TEST_F(BfrtTableManagerTest, WriteTranslatedTableEntryTest) {
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4TableId = 33583783;
+  constexpr int kP4ActionId = 16783057;
+  constexpr int kBfRtTableId = 20;
+  auto table_key_mock = absl::make_unique<TableKeyMock>();
+  auto table_data_mock = absl::make_unique<TableDataMock>();
+  auto session_mock = std::make_shared<SessionMock>();
+
+  EXPECT_CALL(*table_key_mock, SetTernary(4, "\x01\x2C", "\377\377"))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4TableId))
+      .WillOnce(Return(kBfRtTableId));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              InsertTableEntry(kDevice1, _, kBfRtTableId, table_key_mock.get(),
+                               table_data_mock.get()))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableKey(kBfRtTableId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>(
+              std::move(table_key_mock)))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableData(kBfRtTableId, kP4ActionId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>(
+              std::move(table_data_mock)))));
+  ::p4::v1::TableEntry entry;
+  ASSERT_OK(ParseProtoFromString(kTableEntryText, &entry));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TranslateTableEntryInPlace(Pointee(EqualsProto(entry)), true))
+      .WillOnce(Invoke([](::p4::v1::TableEntry* table_entry, bool to_sdk) {
+        table_entry->mutable_match(0)->mutable_ternary()->set_value(
+            "\x01\x2C");
+        return ::util::OkStatus();
+      }));
 
   EXPECT_OK(bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::INSERT, entry));
@@ -766,8 +904,8 @@ TEST_F(BfrtTableManagerTest, ModifyTableEntryTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   EXPECT_OK(bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::MODIFY, entry));
@@ -798,13 +936,73 @@ TEST_F(BfrtTableManagerTest, DeleteTableEntryTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   EXPECT_OK(bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::DELETE, entry));
 }
 
+TEST_F(BfrtTableManagerTest, RejectTableEntryWriteAcrossPipelinePushTest) {
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4TableId = 33583783;
+  constexpr int kP4ActionId = 16783057;
+  constexpr int kBfRtTableId = 20;
+  auto session_mock = std::make_shared<SessionMock>();
+
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4TableId))
+      .WillOnce(Return(kBfRtTableId));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableKey(kBfRtTableId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>(
+              absl::make_unique<TableKeyMock>()))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableData(kBfRtTableId, kP4ActionId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>(
+              absl::make_unique<TableDataMock>()))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, InsertTableEntry(_, _, _, _, _)).Times(0);
+  ::p4::v1::TableEntry entry;
+  ASSERT_OK(ParseProtoFromString(kTableEntryText, &entry));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
+
+  google::protobuf::Arena arena;
+  BfrtTableManager::TableEntryWrite write;
+  ASSERT_OK(bfrt_table_manager_->PrepareTableEntryWrite(
+      ::p4::v1::Update::INSERT, entry, &arena, &write));
+
+  // A new pipeline is pushed before the write is committed.
+  const std::string kNewPipelineText = R"pb(
+    programs {
+      name: "new pipeline config",
+      p4info {
+        pkg_info { arch: "tna" }
+        tables {
+          preamble { id: 33583783 name: "Ingress.control.table1" }
+          match_fields { id: 4 name: "field4" bitwidth: 16 match_type: TERNARY }
+          action_refs { id: 16783057 }
+          size: 1024
+        }
+        actions { preamble { id: 16783057 name: "Ingress.control.action1" } }
+      }
+    }
+  )pb";
+  BfrtDeviceConfig config;
+  ASSERT_OK(ParseProtoFromString(kNewPipelineText, &config));
+  std::shared_ptr<BfSdeInterface::SessionInterface> digest_session_mock =
+      std::make_shared<SessionMock>();
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateSession())
+      .WillOnce(Return(digest_session_mock));
+  ASSERT_OK(bfrt_table_manager_->PushForwardingPipelineConfig(config));
+
+  ::util::Status ret =
+      bfrt_table_manager_->CommitTableEntryWrite(session_mock, write);
+  ASSERT_FALSE(ret.ok());
+  EXPECT_EQ(ERR_ABORTED, ret.error_code());
+  EXPECT_THAT(ret.error_message(), HasSubstr("pipeline was changed"));
+}
+
 TEST_F(BfrtTableManagerTest, RejectWriteTableUnspecifiedTypeTest) {
   ASSERT_OK(PushTestConfig());
   auto session_mock = std::make_shared<SessionMock>();
@@ -845,8 +1043,8 @@ TEST_F(BfrtTableManagerTest, RejectWriteTableConstTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText2, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   ::util::Status ret = bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::INSERT, entry);
@@ -873,8 +1071,8 @@ TEST_F(BfrtTableManagerTest, RejectWriteTableDefaultActionTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText2, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   ::util::Status ret = bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::INSERT, entry);
@@ -903,8 +1101,8 @@ TEST_F(BfrtTableManagerTest, RejectModifyTableDefaultActionWithMatchTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText2, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   ::util::Status ret = bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::MODIFY, entry);
@@ -933,8 +1131,8 @@ TEST_F(BfrtTableManagerTest, RejectModifyTableDefaultActionWithPriorityTest) {
   ::p4::v1::TableEntry entry;
   ASSERT_OK(ParseProtoFromString(kTableEntryText2, &entry));
   EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
-              TranslateTableEntry(EqualsProto(entry), true))
-      .WillOnce(Return(::util::StatusOr<::p4::v1::TableEntry>(entry)));
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
 
   ::util::Status ret = bfrt_table_manager_->WriteTableEntry(
       session_mock, ::p4::v1::Update::MODIFY, entry);
@@ -1133,6 +1331,387 @@ TEST_F(BfrtTableManagerTest, ReadRegisterEntryTest) {
                                                    &writer_mock));
 }
 
+TEST_F(BfrtTableManagerTest, ReadRegisterEntriesTest) {
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4RegisterId = 66666;
+  constexpr int kBfRtTableId = 20;
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  std::vector<::p4::v1::RegisterEntry> entries;
+  for (int index : {2, 0, 1, 2}) {
+    ::p4::v1::RegisterEntry entry;
+    entry.set_register_id(kP4RegisterId);
+    entry.mutable_index()->set_index(index);
+    entries.push_back(entry);
+  }
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_, TranslateRegisterEntry(_, _))
+      .WillRepeatedly(
+          Invoke([](const ::p4::v1::RegisterEntry& entry, bool to_sdk) {
+            return ::util::StatusOr<::p4::v1::RegisterEntry>(entry);
+          }));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4RegisterId))
+      .WillOnce(Return(kBfRtTableId));
+  // Duplicate indices are read only once, but answered for every request.
+  std::vector<uint32> register_indices = {0, 1, 2};
+  std::vector<uint64> register_datas = {1, 2, 3};
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              ReadRegisterRanges(kDevice1, _, kBfRtTableId,
+                                 ElementsAre(IndexRangeIs(0, 2)), _, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>(register_indices),
+                      SetArgPointee<5>(register_datas),
+                      Return(::util::OkStatus())));
+
+  const std::string kRegisterResponseText = R"pb(
+    entities {
+      register_entry {
+        register_id: 66666
+        index {
+          index: 2
+        }
+        data {
+          bitstring: "\x03"
+        }
+      }
+    }
+    entities {
+      register_entry {
+        register_id: 66666
+        index {
+          index: 0
+        }
+        data {
+          bitstring: "\x01"
+        }
+      }
+    }
+    entities {
+      register_entry {
+        register_id: 66666
+        index {
+          index: 1
+        }
+        data {
+          bitstring: "\x02"
+        }
+      }
+    }
+    entities {
+      register_entry {
+        register_id: 66666
+        index {
+          index: 2
+        }
+        data {
+          bitstring: "\x03"
+        }
+      }
+    }
+  )pb";
+  ::p4::v1::ReadResponse resp;
+  ASSERT_OK(ParseProtoFromString(kRegisterResponseText, &resp));
+  EXPECT_CALL(writer_mock, Write(EqualsProto(resp))).WillOnce(Return(true));
+
+  EXPECT_OK(bfrt_table_manager_->ReadRegisterEntries(session_mock, entries,
+                                                     &writer_mock));
+}
+
+TEST_F(BfrtTableManagerTest, ReadAllTableEntriesInChunksTest) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_table_read_chunk_size = 2;
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4TableId = 33583783;
+  constexpr int kBfRtTableId = 20;
+  constexpr int kNumEntries = 5;
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kP4TableId);
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
+  // The entries read back are translated in place.
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TranslateTableEntryInPlace(_, false))
+      .Times(kNumEntries)
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4TableId))
+      .WillOnce(Return(kBfRtTableId));
+
+  // The SDE hands out the table in pages of at most two entries. Every page
+  // after the first must continue from the last key of the previous one.
+  int next_entry = 0;
+  const BfSdeInterface::TableKeyInterface* last_key = nullptr;
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              GetNextTableEntries(kDevice1, _, kBfRtTableId, _, 2, _, _))
+      .Times(3)
+      .WillRepeatedly(Invoke(
+          [&](int device,
+              std::shared_ptr<BfSdeInterface::SessionInterface> session,
+              uint32 table_id, const BfSdeInterface::TableKeyInterface* cursor,
+              int max_entries,
+              std::vector<std::unique_ptr<BfSdeInterface::TableKeyInterface>>*
+                  table_keys,
+              std::vector<std::unique_ptr<BfSdeInterface::TableDataInterface>>*
+                  table_datas) {
+            EXPECT_EQ(last_key, cursor);
+            table_keys->clear();
+            table_datas->clear();
+            for (; next_entry < kNumEntries &&
+                   static_cast<int>(table_keys->size()) < max_entries;
+                 ++next_entry) {
+              auto table_key = absl::make_unique<TableKeyMock>();
+              EXPECT_CALL(*table_key, GetPriority(_))
+                  .WillRepeatedly(DoAll(SetArgPointee<0>(next_entry + 1),
+                                        Return(::util::OkStatus())));
+              auto table_data = absl::make_unique<TableDataMock>();
+              EXPECT_CALL(*table_data, GetActionId(_))
+                  .WillRepeatedly(DoAll(SetArgPointee<0>(0),
+                                        Return(::util::OkStatus())));
+              EXPECT_CALL(*table_data, GetActionMemberId(_))
+                  .WillRepeatedly(Return(::util::Status(
+                      StratumErrorSpace(), ERR_INVALID_PARAM, "No member.")));
+              EXPECT_CALL(*table_data, GetSelectorGroupId(_))
+                  .WillRepeatedly(Return(::util::Status(
+                      StratumErrorSpace(), ERR_INVALID_PARAM, "No group.")));
+              last_key = table_key.get();
+              table_keys->push_back(std::move(table_key));
+              table_datas->push_back(std::move(table_data));
+            }
+            return ::util::OkStatus();
+          }));
+  std::vector<int> response_sizes;
+  EXPECT_CALL(writer_mock, Write(_))
+      .Times(3)
+      .WillRepeatedly(Invoke([&](const ::p4::v1::ReadResponse& resp) {
+        response_sizes.push_back(resp.entities_size());
+        return true;
+      }));
+
+  EXPECT_OK(
+      bfrt_table_manager_->ReadTableEntry(session_mock, entry, &writer_mock));
+  EXPECT_THAT(response_sizes, ::testing::ElementsAre(2, 2, 1));
+}
+
+TEST_F(BfrtTableManagerTest, ReadAllTableEntriesEmptyTableTest) {
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4TableId = 33583783;
+  constexpr int kBfRtTableId = 20;
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kP4TableId);
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TableEntryRequiresTranslation(EqualsProto(entry)))
+      .WillOnce(Return(false));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4TableId))
+      .WillOnce(Return(kBfRtTableId));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              GetNextTableEntries(kDevice1, _, kBfRtTableId, _, _, _, _))
+      .WillOnce(Return(::util::OkStatus()));
+  // An empty table still results in one (empty) response.
+  EXPECT_CALL(writer_mock, Write(EqualsProto(::p4::v1::ReadResponse())))
+      .WillOnce(Return(true));
+
+  EXPECT_OK(
+      bfrt_table_manager_->ReadTableEntry(session_mock, entry, &writer_mock));
+}
+
+TEST_F(BfrtTableManagerTest, ReadTableEntriesFromShadowTest) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_table_shadow = "on";
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4TableId = 33583783;
+  constexpr int kP4ActionId = 16794911;
+  constexpr int kBfRtTableId = 20;
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  // The entry is stored in canonical form, which is what reads return.
+  const std::string kWrittenEntryText = R"pb(
+    table_id: 33583783
+    match {
+      field_id: 2
+      ternary { value: "\x00\x0a" mask: "\x0f\xff" }
+    }
+    match {
+      field_id: 1
+      exact { value: "\x00\x01" }
+    }
+    action {
+      action {
+        action_id: 16794911
+        params { param_id: 1 value: "\x00\x02" }
+      }
+    }
+    priority: 10
+  )pb";
+  const std::string kReadEntryText = R"pb(
+    table_id: 33583783
+    match {
+      field_id: 1
+      exact { value: "\x01" }
+    }
+    match {
+      field_id: 2
+      ternary { value: "\x0a" mask: "\x0f\xff" }
+    }
+    action {
+      action {
+        action_id: 16794911
+        params { param_id: 1 value: "\x02" }
+      }
+    }
+    priority: 10
+  )pb";
+  ::p4::v1::TableEntry written_entry, read_entry;
+  ASSERT_OK(ParseProtoFromString(kWrittenEntryText, &written_entry));
+  ASSERT_OK(ParseProtoFromString(kReadEntryText, &read_entry));
+  ::p4::v1::ReadResponse resp;
+  *resp.add_entities()->mutable_table_entry() = read_entry;
+
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TableEntryRequiresTranslation(_))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TranslateTableEntryInPlace(_, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4TableId))
+      .WillRepeatedly(Return(kBfRtTableId));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableKey(kBfRtTableId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>(
+              absl::make_unique<TableKeyMock>()))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableData(kBfRtTableId, kP4ActionId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>(
+              absl::make_unique<TableDataMock>()))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              InsertTableEntry(kDevice1, _, kBfRtTableId, _, _))
+      .WillOnce(Return(::util::OkStatus()));
+  // Neither of the reads goes to the SDE.
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetTableEntry(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetNextTableEntries(_, _, _, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(writer_mock, Write(EqualsProto(resp)))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  ASSERT_OK(bfrt_table_manager_->WriteTableEntry(
+      session_mock, ::p4::v1::Update::INSERT, written_entry));
+
+  // Wildcard read of the table.
+  ::p4::v1::TableEntry wildcard_request;
+  wildcard_request.set_table_id(kP4TableId);
+  EXPECT_OK(bfrt_table_manager_->ReadTableEntry(session_mock, wildcard_request,
+                                                &writer_mock));
+
+  // Single entry read, by the match fields of the written entry.
+  ::p4::v1::TableEntry single_request = written_entry;
+  single_request.clear_action();
+  EXPECT_OK(bfrt_table_manager_->ReadTableEntry(session_mock, single_request,
+                                                &writer_mock));
+}
+
+TEST_F(BfrtTableManagerTest, ReadTableEntryCounterDataWithShadowTest) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_table_shadow = "on";
+  ASSERT_OK(PushTestConfig());
+  constexpr int kP4TableId = 33583783;
+  constexpr int kP4ActionId = 16794911;
+  constexpr int kBfRtTableId = 20;
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  const std::string kEntryText = R"pb(
+    table_id: 33583783
+    match {
+      field_id: 1
+      exact { value: "\x01" }
+    }
+    match {
+      field_id: 2
+      ternary { value: "\x0a" mask: "\x0f\xff" }
+    }
+    action {
+      action {
+        action_id: 16794911
+        params { param_id: 1 value: "\x02" }
+      }
+    }
+    priority: 10
+  )pb";
+  ::p4::v1::TableEntry entry;
+  ASSERT_OK(ParseProtoFromString(kEntryText, &entry));
+
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TableEntryRequiresTranslation(_))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(*bfrt_p4runtime_translator_mock_,
+              TranslateTableEntryInPlace(_, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(kP4TableId))
+      .WillRepeatedly(Return(kBfRtTableId));
+  // The read only takes the counter values from the SDE.
+  auto read_table_data_mock = absl::make_unique<TableDataMock>();
+  EXPECT_CALL(*read_table_data_mock, GetCounterData(_, _))
+      .WillOnce(DoAll(SetArgPointee<0>(200), SetArgPointee<1>(100),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*read_table_data_mock, GetParam(_, _)).Times(0);
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableKey(kBfRtTableId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>(
+              absl::make_unique<TableKeyMock>()))))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>(
+              absl::make_unique<TableKeyMock>()))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, CreateTableData(kBfRtTableId, kP4ActionId))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>(
+              absl::make_unique<TableDataMock>()))))
+      .WillOnce(Return(ByMove(
+          ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>(
+              std::move(read_table_data_mock)))));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              InsertTableEntry(kDevice1, _, kBfRtTableId, _, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              SynchronizeCounters(kDevice1, _, kP4TableId, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              GetTableEntry(kDevice1, _, kBfRtTableId, _, _))
+      .WillOnce(Return(::util::OkStatus()));
+
+  ::p4::v1::ReadResponse resp;
+  auto* expected_entry = resp.add_entities()->mutable_table_entry();
+  *expected_entry = entry;
+  expected_entry->mutable_counter_data()->set_byte_count(200);
+  expected_entry->mutable_counter_data()->set_packet_count(100);
+  EXPECT_CALL(writer_mock, Write(EqualsProto(resp))).WillOnce(Return(true));
+
+  ASSERT_OK(bfrt_table_manager_->WriteTableEntry(
+      session_mock, ::p4::v1::Update::INSERT, entry));
+
+  ::p4::v1::TableEntry request = entry;
+  request.clear_action();
+  request.mutable_counter_data();
+  EXPECT_OK(
+      bfrt_table_manager_->ReadTableEntry(session_mock, request, &writer_mock));
+}
+
+TEST_F(BfrtTableManagerTest, RejectInvalidTableShadowModeTest) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_bfrt_table_shadow = "sometimes";
+  BfrtDeviceConfig config;
+  config.add_programs();
+  ::util::Status ret =
+      bfrt_table_manager_->PushForwardingPipelineConfig(config);
+  EXPECT_EQ(ERR_INVALID_PARAM, ret.error_code());
+  EXPECT_THAT(ret.error_message(), HasSubstr("Invalid table shadow mode"));
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
@@ -0,0 +1,85 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_table_shadow.h"
+
+#include "stratum/glue/gtl/map_util.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+void BfrtTableShadow::Update(::p4::v1::Update::Type type,
+                             const ::p4::v1::TableEntry& entry) {
+  std::string key = MatchKey(entry);
+  absl::WriterMutexLock l(&lock_);
+  auto& table = tables_[entry.table_id()];
+  switch (type) {
+    case ::p4::v1::Update::INSERT:
+    case ::p4::v1::Update::MODIFY:
+      table[std::move(key)] = entry.SerializeAsString();
+      break;
+    case ::p4::v1::Update::DELETE:
+      table.erase(key);
+      break;
+    default:
+      break;
+  }
+}
+
+::util::StatusOr<::p4::v1::TableEntry> BfrtTableShadow::Lookup(
+    const ::p4::v1::TableEntry& entry) const {
+  const std::string key = MatchKey(entry);
+  ::p4::v1::TableEntry result;
+  {
+    absl::ReaderMutexLock l(&lock_);
+    const auto* table = gtl::FindOrNull(tables_, entry.table_id());
+    const std::string* serialized =
+        table ? gtl::FindOrNull(*table, key) : nullptr;
+    if (serialized == nullptr) {
+      return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
+             << "Table entry " << entry.ShortDebugString()
+             << " not found in the table shadow.";
+    }
+    RET_CHECK(result.ParseFromString(*serialized));
+  }
+
+  return result;
+}
+
+std::vector<std::string> BfrtTableShadow::GetEntries(uint32 table_id) const {
+  std::vector<std::string> entries;
+  absl::ReaderMutexLock l(&lock_);
+  const auto* table = gtl::FindOrNull(tables_, table_id);
+  if (table == nullptr) return entries;
+  entries.reserve(table->size());
+  for (const auto& e : *table) entries.push_back(e.second);
+
+  return entries;
+}
+
+size_t BfrtTableShadow::Size(uint32 table_id) const {
+  absl::ReaderMutexLock l(&lock_);
+  const auto* table = gtl::FindOrNull(tables_, table_id);
+  return table ? table->size() : 0;
+}
+
+void BfrtTableShadow::Clear() {
+  absl::WriterMutexLock l(&lock_);
+  tables_.clear();
+}
+
+std::string BfrtTableShadow::MatchKey(const ::p4::v1::TableEntry& entry) {
+  // The match fields of stored entries and lookups are both in P4Info order
+  // and canonical, so their serialization identifies the entry.
+  ::p4::v1::TableEntry key;
+  *key.mutable_match() = entry.match();
+  key.set_priority(entry.priority());
+  return key.SerializeAsString();
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
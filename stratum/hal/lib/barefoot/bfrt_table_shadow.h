@@ -0,0 +1,72 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_SHADOW_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_SHADOW_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// A write-through copy of the P4Runtime table entries which have been written
+// to the SDE, from which table reads can be served without going to the SDE.
+// The entries are stored the way a read from the SDE builds them: with
+// canonical byte strings, match fields and action parameters in P4Info order
+// and without counter data. Each table maps the match key of an entry to the
+// entry in serialized form, which is much more compact than the parsed message.
+// This class is thread-safe.
+class BfrtTableShadow {
+ public:
+  BfrtTableShadow() {}
+
+  // Applies a table entry update, which has been accepted by the SDE.
+  void Update(::p4::v1::Update::Type type, const ::p4::v1::TableEntry& entry)
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the stored entry with the same table ID, match fields and priority
+  // as the given entry.
+  ::util::StatusOr<::p4::v1::TableEntry> Lookup(
+      const ::p4::v1::TableEntry& entry) const LOCKS_EXCLUDED(lock_);
+
+  // Returns a snapshot of all the entries of the given table, as serialized
+  // TableEntry messages, so that the caller can stream them without holding
+  // up the writers.
+  std::vector<std::string> GetEntries(uint32 table_id) const
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the number of entries stored for the given table.
+  size_t Size(uint32 table_id) const LOCKS_EXCLUDED(lock_);
+
+  // Removes all the entries, e.g. when a new pipeline is pushed.
+  void Clear() LOCKS_EXCLUDED(lock_);
+
+  // Returns the key identifying an entry within its table, made from the
+  // match fields and the priority.
+  static std::string MatchKey(const ::p4::v1::TableEntry& entry);
+
+  BfrtTableShadow(const BfrtTableShadow&) = delete;
+  BfrtTableShadow& operator=(const BfrtTableShadow&) = delete;
+
+ private:
+  mutable absl::Mutex lock_;
+
+  // Map from P4 table ID to the entries of the table, keyed by match key.
+  absl::flat_hash_map<uint32, absl::flat_hash_map<std::string, std::string>>
+      tables_ GUARDED_BY(lock_);
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_SHADOW_H_
@@ -0,0 +1,124 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_table_shadow.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using test_utils::EqualsProto;
+using test_utils::StatusIs;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::UnorderedElementsAre;
+
+constexpr char kEntry1Text[] = R"pb(
+  table_id: 33583783
+  match {
+    field_id: 1
+    exact { value: "\001" }
+  }
+  action {
+    action {
+      action_id: 16794911
+      params { param_id: 1 value: "\002" }
+    }
+  }
+)pb";
+
+constexpr char kEntry2Text[] = R"pb(
+  table_id: 33583783
+  match {
+    field_id: 1
+    exact { value: "\002" }
+  }
+  action {
+    action {
+      action_id: 16794911
+      params { param_id: 1 value: "\003" }
+    }
+  }
+)pb";
+
+TEST(BfrtTableShadowTest, InsertModifyDelete) {
+  BfrtTableShadow shadow;
+  ::p4::v1::TableEntry entry1, entry2;
+  ASSERT_OK(ParseProtoFromString(kEntry1Text, &entry1));
+  ASSERT_OK(ParseProtoFromString(kEntry2Text, &entry2));
+
+  shadow.Update(::p4::v1::Update::INSERT, entry1);
+  shadow.Update(::p4::v1::Update::INSERT, entry2);
+  EXPECT_EQ(2, shadow.Size(entry1.table_id()));
+
+  // Lookups only use the match fields and the priority.
+  ::p4::v1::TableEntry key = entry1;
+  key.clear_action();
+  ASSERT_OK_AND_ASSIGN(auto result, shadow.Lookup(key));
+  EXPECT_THAT(result, EqualsProto(entry1));
+
+  ::p4::v1::TableEntry modified = entry1;
+  modified.mutable_action()->mutable_action()->mutable_params(0)->set_value(
+      "\x05");
+  shadow.Update(::p4::v1::Update::MODIFY, modified);
+  ASSERT_OK_AND_ASSIGN(result, shadow.Lookup(key));
+  EXPECT_THAT(result, EqualsProto(modified));
+
+  shadow.Update(::p4::v1::Update::DELETE, key);
+  EXPECT_THAT(shadow.Lookup(key), StatusIs(_, ERR_ENTRY_NOT_FOUND,
+                                           HasSubstr("not found")));
+  EXPECT_EQ(1, shadow.Size(entry1.table_id()));
+}
+
+TEST(BfrtTableShadowTest, PriorityIsPartOfTheKey) {
+  BfrtTableShadow shadow;
+  ::p4::v1::TableEntry entry;
+  ASSERT_OK(ParseProtoFromString(kEntry1Text, &entry));
+  entry.set_priority(10);
+  shadow.Update(::p4::v1::Update::INSERT, entry);
+
+  ::p4::v1::TableEntry key = entry;
+  key.set_priority(20);
+  EXPECT_THAT(shadow.Lookup(key), StatusIs(_, ERR_ENTRY_NOT_FOUND, _));
+  key.set_priority(10);
+  EXPECT_OK(shadow.Lookup(key).status());
+}
+
+TEST(BfrtTableShadowTest, GetEntriesAndClear) {
+  BfrtTableShadow shadow;
+  ::p4::v1::TableEntry entry1, entry2;
+  ASSERT_OK(ParseProtoFromString(kEntry1Text, &entry1));
+  ASSERT_OK(ParseProtoFromString(kEntry2Text, &entry2));
+  shadow.Update(::p4::v1::Update::INSERT, entry1);
+  shadow.Update(::p4::v1::Update::INSERT, entry2);
+
+  std::vector<::p4::v1::TableEntry> entries;
+  for (const auto& serialized : shadow.GetEntries(entry1.table_id())) {
+    ::p4::v1::TableEntry entry;
+    ASSERT_TRUE(entry.ParseFromString(serialized));
+    entries.push_back(entry);
+  }
+  EXPECT_THAT(entries,
+              UnorderedElementsAre(EqualsProto(entry1), EqualsProto(entry2)));
+  EXPECT_TRUE(shadow.GetEntries(1).empty());
+
+  shadow.Clear();
+  EXPECT_EQ(0, shadow.Size(entry1.table_id()));
+  EXPECT_TRUE(shadow.GetEntries(entry1.table_id()).empty());
+}
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
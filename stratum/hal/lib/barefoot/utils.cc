@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "stratum/hal/lib/barefoot/bfrt_constants.h"
 #include "stratum/hal/lib/p4/utils.h"
 #include "stratum/lib/macros.h"
@@ -73,6 +74,53 @@ std::string AllOnesByteString(size_t bitwidth) {
   return value;
 }
 
+std::vector<IndexRange> IndicesToRanges(std::vector<uint32> indices) {
+  std::sort(indices.begin(), indices.end());
+  std::vector<IndexRange> ranges;
+  for (const uint32 index : indices) {
+    // The indices are sorted, so index is never below the last range.
+    if (!ranges.empty() && index - ranges.back().last <= 1) {
+      ranges.back().last = index;
+    } else {
+      ranges.push_back({index, index});
+    }
+  }
+  return ranges;
+}
+
+::util::Status OrderEntitiesLikeRequest(
+    const std::vector<uint32>& requested_indices,
+    const std::vector<uint32>& read_indices, ::p4::v1::ReadResponse* read_resp,
+    ::p4::v1::ReadResponse* resp) {
+  RET_CHECK(read_indices.size() ==
+            static_cast<size_t>(read_resp->entities_size()))
+      << "Expected one read entity per read index.";
+  absl::flat_hash_map<uint32, int> read_positions;
+  read_positions.reserve(read_indices.size());
+  for (size_t i = 0; i < read_indices.size(); ++i) {
+    read_positions[read_indices[i]] = i;
+  }
+  // The position in resp of every read entity which was already moved there.
+  std::vector<int> resp_positions(read_indices.size(), -1);
+  resp->mutable_entities()->Reserve(requested_indices.size());
+  for (const uint32 index : requested_indices) {
+    auto it = read_positions.find(index);
+    if (it == read_positions.end()) {
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Requested index " << index << " was not read.";
+    }
+    const int resp_position = resp_positions[it->second];
+    if (resp_position >= 0) {
+      *resp->add_entities() = resp->entities(resp_position);
+    } else {
+      resp_positions[it->second] = resp->entities_size();
+      resp->add_entities()->Swap(read_resp->mutable_entities(it->second));
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
@@ -50,6 +50,25 @@ int NumBitsToNumBytes(int num_bits);
 // Returns a byte string with bitwidth bits set to zero.
 std::string AllOnesByteString(size_t bitwidth);
 
+// An inclusive range of indices of an indirect counter, meter or register.
+struct IndexRange {
+  uint32 first;
+  uint32 last;
+};
+
+// Returns the given indices as sorted ranges. Duplicate indices are dropped
+// and consecutive indices are merged into one range.
+std::vector<IndexRange> IndicesToRanges(std::vector<uint32> indices);
+
+// Moves the entities read for IndicesToRanges(requested_indices) into 'resp',
+// in the order of the request. 'read_indices' holds the index of every entity
+// of 'read_resp'. Every requested index gets its own entity, so an index which
+// is requested twice is also answered twice.
+::util::Status OrderEntitiesLikeRequest(
+    const std::vector<uint32>& requested_indices,
+    const std::vector<uint32>& read_indices, ::p4::v1::ReadResponse* read_resp,
+    ::p4::v1::ReadResponse* resp);
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
@@ -231,6 +231,48 @@ TEST(ConvertPriorityTest, InvalidBfrtPriority) {
               stratum::ErrorCode::ERR_INVALID_PARAM);
 }
 
+TEST(IndicesToRangesTest, MergesConsecutiveIndices) {
+  auto ranges = IndicesToRanges({7, 1, 3, 2, 2, 9, 8, 0xffffffff});
+  ASSERT_EQ(3, ranges.size());
+  EXPECT_EQ(1, ranges[0].first);
+  EXPECT_EQ(3, ranges[0].last);
+  EXPECT_EQ(7, ranges[1].first);
+  EXPECT_EQ(9, ranges[1].last);
+  EXPECT_EQ(0xffffffff, ranges[2].first);
+  EXPECT_EQ(0xffffffff, ranges[2].last);
+}
+
+TEST(IndicesToRangesTest, NoIndices) {
+  EXPECT_TRUE(IndicesToRanges({}).empty());
+}
+
+TEST(OrderEntitiesLikeRequestTest, AnswersEveryRequestedIndexInOrder) {
+  ::p4::v1::ReadResponse read_resp;
+  for (uint32 index : {1, 2, 3}) {
+    auto* register_entry = read_resp.add_entities()->mutable_register_entry();
+    register_entry->mutable_index()->set_index(index);
+  }
+  ::p4::v1::ReadResponse resp;
+  ASSERT_OK(OrderEntitiesLikeRequest({3, 1, 3, 2}, {1, 2, 3}, &read_resp,
+                                     &resp));
+  ASSERT_EQ(4, resp.entities_size());
+  EXPECT_EQ(3, resp.entities(0).register_entry().index().index());
+  EXPECT_EQ(1, resp.entities(1).register_entry().index().index());
+  EXPECT_EQ(3, resp.entities(2).register_entry().index().index());
+  EXPECT_EQ(2, resp.entities(3).register_entry().index().index());
+}
+
+TEST(OrderEntitiesLikeRequestTest, RejectsIndexWhichWasNotRead) {
+  ::p4::v1::ReadResponse read_resp;
+  auto* register_entry = read_resp.add_entities()->mutable_register_entry();
+  register_entry->mutable_index()->set_index(1);
+  ::p4::v1::ReadResponse resp;
+  ::util::Status status =
+      OrderEntitiesLikeRequest({1, 2}, {1}, &read_resp, &resp);
+  EXPECT_EQ(ERR_INTERNAL, status.error_code());
+  EXPECT_THAT(status.error_message(), HasSubstr("was not read"));
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
@@ -143,19 +143,6 @@ class AclTable : public BcmFlowTable {
   // Returns ERR_NO_RESOURCE if the table is full.
   util::Status InsertEntry(const ::p4::v1::TableEntry& entry, int bcm_acl_id);
 
-  // Attempts to modify an existing entry in this table. Returns the original
-  // entry on success.
-  // Returns ERR_ENTRY_NOT_FOUND if a matching entry does not already exist.
-  // Returns an error if the entry cannot be added.
-  util::StatusOr<p4::v1::TableEntry> ModifyEntry(
-      const ::p4::v1::TableEntry& entry) override {
-    // Remove the entry, but don't remove the record in bcm_acl_id_map_.
-    ASSIGN_OR_RETURN(p4::v1::TableEntry old_entry,
-                     BcmFlowTable::DeleteEntry(entry));
-    entries_.insert(entry);
-    return old_entry;
-  }
-
   // Attempts to set the Bcm ACL ID for an entry in this table.
   // Returns ERR_ENTRY_NOT_FOUND if the entry is not found.
   util::Status SetBcmAclId(const ::p4::v1::TableEntry& entry, int bcm_acl_id);
@@ -166,7 +153,7 @@ class AclTable : public BcmFlowTable {
       const ::p4::v1::TableEntry& entry) override {
     // We aren't interested in the return for erase since it's possible nobody
     // ever set the associated Bcm ACL ID.
-    bcm_acl_id_map_.erase(entry);
+    bcm_acl_id_map_.erase(TableEntryKey(entry));
     return BcmFlowTable::DeleteEntry(entry);
   }
 
@@ -193,9 +180,7 @@ class AclTable : public BcmFlowTable {
   // match_fields_.
   absl::flat_hash_set<uint32> udf_match_fields_;
   // Mapping from entries to their respective Bcm ACL IDs.
-  absl::flat_hash_map<::p4::v1::TableEntry, uint32, TableEntryHash,
-                      TableEntryEqual>
-      bcm_acl_id_map_;
+  absl::flat_hash_map<TableEntryKey, uint32> bcm_acl_id_map_;
   // Stores const conditions
   absl::flat_hash_map<P4HeaderType, bool, EnumHash<P4HeaderType>>
       const_conditions_;
@@ -6,12 +6,17 @@
 #define STRATUM_HAL_LIB_BCM_BCM_FLOW_TABLE_H_
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <utility>
+#include <vector>
 
-#include "absl/container/node_hash_set.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/message.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/integral_types.h"
 #include "stratum/glue/status/status.h"
@@ -24,69 +29,146 @@ namespace stratum {
 namespace hal {
 namespace bcm {
 
-// Custom hash and equal function for P4 TableEntry protos. We need a way
-// to differeniate flows in the following way: If we have 2 flows f1 and f2
-// with f2 being the modified version of f1 as intended by the controller, f1
-// = f2. In any other case they should not.
-struct TableEntryHash {
-  size_t operator()(const ::p4::v1::TableEntry& x) const {
-    // Save a copy of the input proto, clear actions/metadata/counter/meter,
-    // and hash the rest.
-    ::p4::v1::TableEntry a = x;
-    a.clear_table_id();
-    a.clear_action();
-    a.clear_controller_metadata();
-    a.clear_meter_config();
-    a.clear_counter_data();
-    // Hash on match field combination, not on permutation.
-    std::sort(a.mutable_match()->begin(), a.mutable_match()->end(),
-              [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
-                return ProtoSerialize(l) < ProtoSerialize(r);
-              });
-    return std::hash<std::string>()(ProtoSerialize(a));
+// Canonical key of a P4 TableEntry. We need a way to differentiate flows in
+// the following way: If we have 2 flows f1 and f2 with f2 being the modified
+// version of f1 as intended by the controller, key(f1) = key(f2). In any other
+// case they should differ. The key is made of all the fields of the entry
+// except the table ID, the action, the controller metadata, the meter config
+// and the counter data, and it does not depend on the order in which the match
+// fields are given. The key bytes and their hash are computed once on
+// construction, so that lookups in a TableEntryMap neither copy nor
+// re-serialize the stored entries.
+class TableEntryKey {
+ public:
+  explicit TableEntryKey(const ::p4::v1::TableEntry& entry) {
+    const std::string other_fields = SerializeOtherFields(entry);
+    std::vector<std::string> matches;
+    matches.reserve(entry.match_size());
+    size_t size = 0;
+    for (const auto& match : entry.match()) {
+      matches.push_back(ProtoSerialize(match));
+      size += sizeof(uint32) + matches.back().size();
+    }
+    std::sort(matches.begin(), matches.end());
+    bytes_.reserve(sizeof(int32) + 1 + sizeof(uint32) + other_fields.size() +
+                   size);
+    AppendUint32(static_cast<uint32>(entry.priority()));
+    bytes_.push_back(entry.is_default_action() ? 1 : 0);
+    AppendUint32(other_fields.size());
+    bytes_.append(other_fields);
+    for (const auto& match : matches) {
+      // Length-prefix every match field to keep the encoding unambiguous.
+      AppendUint32(match.size());
+      bytes_.append(match);
+    }
+    hash_ = absl::Hash<std::string>()(bytes_);
+  }
+
+  // Returns the canonical byte representation of the key.
+  const std::string& bytes() const { return bytes_; }
+
+  // Returns the precomputed hash of the key.
+  size_t hash() const { return hash_; }
+
+  bool operator==(const TableEntryKey& other) const {
+    return hash_ == other.hash_ && bytes_ == other.bytes_;
+  }
+  bool operator!=(const TableEntryKey& other) const {
+    return !(*this == other);
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const TableEntryKey& key) {
+    return H::combine(std::move(h), key.hash_);
+  }
+
+ private:
+  // Returns the serialized form of the key fields of the entry other than the
+  // match fields, the priority and is_default_action, e.g. idle_timeout_ns or
+  // metadata. Most entries have none of them set, in which case the entry does
+  // not have to be copied.
+  static std::string SerializeOtherFields(const ::p4::v1::TableEntry& entry) {
+    std::vector<const google::protobuf::FieldDescriptor*> fields;
+    entry.GetReflection()->ListFields(entry, &fields);
+    bool has_other_fields = false;
+    for (const auto* field : fields) {
+      switch (field->number()) {
+        case ::p4::v1::TableEntry::kTableIdFieldNumber:
+        case ::p4::v1::TableEntry::kMatchFieldNumber:
+        case ::p4::v1::TableEntry::kActionFieldNumber:
+        case ::p4::v1::TableEntry::kPriorityFieldNumber:
+        case ::p4::v1::TableEntry::kControllerMetadataFieldNumber:
+        case ::p4::v1::TableEntry::kMeterConfigFieldNumber:
+        case ::p4::v1::TableEntry::kCounterDataFieldNumber:
+        case ::p4::v1::TableEntry::kIsDefaultActionFieldNumber:
+          break;
+        default:
+          has_other_fields = true;
+      }
+    }
+    if (!has_other_fields) return "";
+    ::p4::v1::TableEntry other = entry;
+    other.clear_table_id();
+    other.clear_match();
+    other.clear_action();
+    other.clear_priority();
+    other.clear_controller_metadata();
+    other.clear_meter_config();
+    other.clear_counter_data();
+    other.clear_is_default_action();
+    return ProtoSerialize(other);
   }
-};
 
-struct TableEntryEqual {
-  bool operator()(const ::p4::v1::TableEntry& x,
-                  const ::p4::v1::TableEntry& y) const {
-    // Save copies of the input protos, clear actions/metadata/counter/meter
-    // and compare the rest.
-    ::p4::v1::TableEntry a = x, b = y;
-    a.clear_table_id();
-    a.clear_action();
-    a.clear_controller_metadata();
-    a.clear_meter_config();
-    a.clear_counter_data();
-    b.clear_table_id();
-    b.clear_action();
-    b.clear_controller_metadata();
-    b.clear_meter_config();
-    b.clear_counter_data();
-    // The order of the match fields are not important.
-    if (a.match_size() != b.match_size() ||
-        !std::is_permutation(
-            a.match().begin(), a.match().end(), b.match().begin(),
-            [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
-              return ProtoSerialize(l) == ProtoSerialize(r);
-            })) {
-      return false;
+  void AppendUint32(uint32 value) {
+    for (int i = 0; i < 4; ++i) {
+      bytes_.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
     }
-    a.clear_match();
-    b.clear_match();
-    return ProtoSerialize(a) == ProtoSerialize(b);
   }
+
+  std::string bytes_;
+  size_t hash_;
 };
 
-using TableEntrySet =
-    absl::node_hash_set<::p4::v1::TableEntry, TableEntryHash, TableEntryEqual>;
+// Map from the canonical key of a TableEntry to the entry itself.
+using TableEntryMap = absl::node_hash_map<TableEntryKey, ::p4::v1::TableEntry>;
 
 // Class for managing a BCM table.
 class BcmFlowTable {
  public:
-  // STL-style types that allow table traversal.
-  using const_iterator = TableEntrySet::const_iterator;
-  using value_type = TableEntrySet::value_type;
+  // STL-style types that allow table traversal. Iterating the table yields
+  // the stored P4 TableEntry protos.
+  using value_type = ::p4::v1::TableEntry;
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ::p4::v1::TableEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    explicit const_iterator(TableEntryMap::const_iterator iter) : iter_(iter) {}
+
+    reference operator*() const { return iter_->second; }
+    pointer operator->() const { return &iter_->second; }
+    const_iterator& operator++() {
+      ++iter_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++iter_;
+      return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+      return iter_ == other.iter_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return iter_ != other.iter_;
+    }
+
+   private:
+    TableEntryMap::const_iterator iter_;
+  };
 
   // Constructors.
   explicit BcmFlowTable(uint32 p4_table_id)
@@ -133,7 +215,7 @@ class BcmFlowTable {
 
   // Returns true if this table already has this entry.
   virtual bool HasEntry(const ::p4::v1::TableEntry& entry) const {
-    return entries_.count(entry) > 0;
+    return entries_.count(TableEntryKey(entry)) > 0;
   }
 
   // Returns the number of entries in this table.
@@ -146,17 +228,17 @@ class BcmFlowTable {
   // Returns ERR_ENTRY_NOT_FOUND if a matching entry is not found.
   virtual ::util::StatusOr<::p4::v1::TableEntry> Lookup(
       const ::p4::v1::TableEntry& key) const {
-    auto lookup = entries_.find(key);
+    auto lookup = entries_.find(TableEntryKey(key));
     if (lookup == entries_.end()) {
       return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
              << TableStr()
              << " does not contain TableEntry: " << key.ShortDebugString();
     }
-    return *lookup;
+    return lookup->second;
   }
 
-  TableEntrySet::const_iterator begin() const { return entries_.begin(); }
-  TableEntrySet::const_iterator end() const { return entries_.end(); }
+  const_iterator begin() const { return const_iterator(entries_.begin()); }
+  const_iterator end() const { return const_iterator(entries_.end()); }
 
   // Returns true if this is a const table.
   virtual bool IsConst() const { return is_const_; }
@@ -174,15 +256,14 @@ class BcmFlowTable {
   // 2) TableEntry.priority
   // 3) is_default_action
   //
-  // See TableEntryEqual below.
+  // See TableEntryKey above.
   virtual ::util::Status InsertEntry(const ::p4::v1::TableEntry& entry) {
-    auto result = entries_.insert(entry);
+    auto result = entries_.emplace(TableEntryKey(entry), entry);
     if (!result.second) {
       return MAKE_ERROR(ERR_ENTRY_EXISTS)
              << TableStr() << " contains duplicate of TableEntry: "
-             << entry.ShortDebugString()
-             << ". Matching TableEntry: " << result.first->ShortDebugString()
-             << ".";
+             << entry.ShortDebugString() << ". Matching TableEntry: "
+             << result.first->second.ShortDebugString() << ".";
     }
     return ::util::OkStatus();
   }
@@ -191,12 +272,12 @@ class BcmFlowTable {
   // inserted. If the entry can be inserted, returns ::util::OkStatus().
   virtual ::util::Status DryRunInsertEntry(
       const ::p4::v1::TableEntry& entry) const {
-    const auto result = entries_.find(entry);
+    const auto result = entries_.find(TableEntryKey(entry));
     if (result != entries_.end()) {
       return MAKE_ERROR(ERR_ENTRY_EXISTS)
              << TableStr() << " contains duplicate of TableEntry: "
-             << entry.ShortDebugString()
-             << ". Matching TableEntry: " << result->ShortDebugString() << ".";
+             << entry.ShortDebugString() << ". Matching TableEntry: "
+             << result->second.ShortDebugString() << ".";
     }
     return ::util::OkStatus();
   }
@@ -207,8 +288,17 @@ class BcmFlowTable {
   // Returns an error if the entry cannot be added.
   virtual ::util::StatusOr<::p4::v1::TableEntry> ModifyEntry(
       const ::p4::v1::TableEntry& entry) {
-    ASSIGN_OR_RETURN(::p4::v1::TableEntry old_entry, DeleteEntry(entry));
-    entries_.insert(entry);
+    // The key of a modified entry does not change, so the entry is replaced in
+    // place.
+    auto lookup = entries_.find(TableEntryKey(entry));
+    if (lookup == entries_.end()) {
+      return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+             << TableStr()
+             << " does not contain TableEntry: " << entry.ShortDebugString()
+             << ".";
+    }
+    ::p4::v1::TableEntry old_entry = std::move(lookup->second);
+    lookup->second = entry;
     return old_entry;
   }
 
@@ -217,14 +307,14 @@ class BcmFlowTable {
   // Returns ERR_ENTRY_NOT_FOUND if a matching entry does not already exist.
   virtual ::util::StatusOr<::p4::v1::TableEntry> DeleteEntry(
       const ::p4::v1::TableEntry& key) {
-    const auto lookup = entries_.find(key);
+    const auto lookup = entries_.find(TableEntryKey(key));
     if (lookup == entries_.end()) {
       return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
              << TableStr()
              << " does not contain TableEntry: " << key.ShortDebugString()
              << ".";
     }
-    ::p4::v1::TableEntry entry = *lookup;
+    ::p4::v1::TableEntry entry = std::move(lookup->second);
     entries_.erase(lookup);
     return entry;
   }
@@ -240,8 +330,8 @@ class BcmFlowTable {
   // ***************************************************************************
   uint32 id_;
   std::string name_;
-  // Keeps track of all entries currently in the table.
-  TableEntrySet entries_;
+  // Keeps track of all entries currently in the table, by their key.
+  TableEntryMap entries_;
   // True is this is a const table. Const tables can only be modified during
   // SetForwardingPipelineConfig().
   bool is_const_;
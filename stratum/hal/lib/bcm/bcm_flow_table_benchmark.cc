@@ -0,0 +1,104 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks entry lookups in a BcmFlowTable of up to 1M entries.
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/bcm/bcm_flow_table.h"
+#include "stratum/hal/lib/p4/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+// Returns a ternary ACL-like entry with three match fields, which is unique
+// for the given index.
+::p4::v1::TableEntry MakeTableEntry(int index) {
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(1);
+  entry.set_priority(10);
+  auto* match = entry.add_match();
+  match->set_field_id(1);
+  match->mutable_ternary()->set_value(Uint32ToByteStream(index));
+  match->mutable_ternary()->set_mask("\xff\xff\xff\xff");
+  match = entry.add_match();
+  match->set_field_id(2);
+  match->mutable_exact()->set_value(Uint32ToByteStream(index % 4096));
+  match = entry.add_match();
+  match->set_field_id(3);
+  match->mutable_lpm()->set_value(Uint32ToByteStream(index << 8));
+  match->mutable_lpm()->set_prefix_len(24);
+  entry.mutable_action()->set_action_profile_member_id(index);
+  return entry;
+}
+
+// Arguments: number of table entries.
+void BM_BcmFlowTableLookup(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  BcmFlowTable table(1);
+  std::vector<::p4::v1::TableEntry> entries;
+  entries.reserve(num_entries);
+  for (int i = 0; i < num_entries; ++i) {
+    entries.push_back(MakeTableEntry(i));
+    CHECK_OK(table.InsertEntry(entries.back()));
+  }
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.HasEntry(entries[i]));
+    if (++i == num_entries) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BcmFlowTableLookup)->Range(1 << 10, 1 << 20);
+
+// Arguments: number of table entries.
+void BM_BcmFlowTableLookupMiss(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  BcmFlowTable table(1);
+  for (int i = 0; i < num_entries; ++i) {
+    CHECK_OK(table.InsertEntry(MakeTableEntry(i)));
+  }
+  const ::p4::v1::TableEntry missing = MakeTableEntry(num_entries);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.HasEntry(missing));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BcmFlowTableLookupMiss)->Range(1 << 10, 1 << 20);
+
+// Arguments: number of table entries.
+void BM_BcmFlowTableInsertDelete(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  BcmFlowTable table(1);
+  for (int i = 0; i < num_entries; ++i) {
+    CHECK_OK(table.InsertEntry(MakeTableEntry(i)));
+  }
+  const ::p4::v1::TableEntry entry = MakeTableEntry(num_entries);
+  for (auto _ : state) {
+    CHECK_OK(table.InsertEntry(entry));
+    CHECK_OK(table.DeleteEntry(entry).status());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BcmFlowTableInsertDelete)->Range(1 << 10, 1 << 20);
+
+void BM_TableEntryKey(benchmark::State& state) {
+  const ::p4::v1::TableEntry entry = MakeTableEntry(1);
+  for (auto _ : state) {
+    TableEntryKey key(entry);
+    benchmark::DoNotOptimize(key.hash());
+  }
+}
+BENCHMARK(BM_TableEntryKey);
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
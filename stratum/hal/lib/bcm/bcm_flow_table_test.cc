@@ -280,6 +280,68 @@ TEST(BcmFlowTableTest, LookupIsDefaultActionFailure) {
   ASSERT_EQ(table.Lookup(mod).status().error_code(), ERR_ENTRY_NOT_FOUND);
 }
 
+// Verify that lookup succeeds when the match parameters are reordered.
+TEST(BcmFlowTableTest, LookupPermutedMatchSuccess) {
+  ::p4::v1::TableEntry mod = MockTableEntry();
+  mod.mutable_match()->SwapElements(0, 2);
+
+  BcmFlowTable table(1);
+  ASSERT_OK(table.InsertEntry(MockTableEntry()));
+  EXPECT_TRUE(table.HasEntry(mod));
+  EXPECT_THAT(table.Lookup(mod), IsOkAndHolds(EqualsProto(MockTableEntry())));
+  EXPECT_EQ(table.InsertEntry(mod).error_code(), ERR_ENTRY_EXISTS);
+}
+
+// Verify that the key depends on all fields of an entry but the table ID,
+// action, controller metadata, meter config and counter data.
+TEST(BcmFlowTableTest, TableEntryKey) {
+  const TableEntryKey key(MockTableEntry());
+
+  ::p4::v1::TableEntry same = MockTableEntry();
+  same.mutable_match()->SwapElements(1, 2);
+  same.mutable_action()->set_action_profile_member_id(12);
+  same.set_controller_metadata(13);
+  same.mutable_meter_config()->set_cir(14);
+  same.mutable_counter_data()->set_byte_count(15);
+  EXPECT_EQ(key, TableEntryKey(same));
+  EXPECT_EQ(key.hash(), TableEntryKey(same).hash());
+  EXPECT_EQ(key.bytes(), TableEntryKey(same).bytes());
+
+  ::p4::v1::TableEntry other = MockTableEntry();
+  other.set_priority(other.priority() + 1);
+  EXPECT_NE(key, TableEntryKey(other));
+  other = MockTableEntry();
+  other.set_is_default_action(true);
+  EXPECT_NE(key, TableEntryKey(other));
+  other = MockTableEntry();
+  other.mutable_match(0)->mutable_exact()->set_value("22");
+  EXPECT_NE(key, TableEntryKey(other));
+  other = MockTableEntry();
+  other.set_idle_timeout_ns(16);
+  EXPECT_NE(key, TableEntryKey(other));
+  other = MockTableEntry();
+  other.set_metadata("17");
+  EXPECT_NE(key, TableEntryKey(other));
+  // Entries with the same other fields still get the same key.
+  same = other;
+  same.mutable_match()->SwapElements(0, 1);
+  same.set_controller_metadata(18);
+  EXPECT_EQ(TableEntryKey(other), TableEntryKey(same));
+}
+
+// Verify that entries which only differ in fields other than the match fields,
+// priority and is_default_action, e.g. idle_timeout_ns, are distinct.
+TEST(BcmFlowTableTest, InsertEntriesWithDifferentIdleTimeout) {
+  ::p4::v1::TableEntry other = MockTableEntry();
+  other.set_idle_timeout_ns(1000);
+
+  BcmFlowTable table(1);
+  ASSERT_OK(table.InsertEntry(MockTableEntry()));
+  ASSERT_OK(table.InsertEntry(other));
+  EXPECT_EQ(2, table.EntryCount());
+  EXPECT_THAT(table.Lookup(other), IsOkAndHolds(EqualsProto(other)));
+}
+
 // Verify that an equivalent entry can be deleted even if it is not exactly the
 // same.
 TEST(BcmFlowTableTest, DeleteEquivalentEntry) {
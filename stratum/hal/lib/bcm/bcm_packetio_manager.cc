@@ -18,8 +18,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/substitute.h"
@@ -37,8 +39,9 @@ DEFINE_int32(knet_rx_buf_size, 512 * 1024,
 DEFINE_int32(knet_rx_poll_timeout_ms, 100,
              "Polling timeout to check incoming packets from KNET RX sockets.");
 DEFINE_int32(knet_max_num_packets_to_read_at_once, 8,
-             "Determines the number of packets we try to read at once as soon "
-             "as the socket FD becomes available.");
+             "Determines the number of packets we try to read at once (with a "
+             "single recvmmsg() call) as soon as the socket FD becomes "
+             "available.");
 
 // TODO(unknown): I really really wish we could use google3 thread libraries.
 namespace stratum {
@@ -57,22 +60,85 @@ constexpr size_t BcmPacketioManager::kMaxRxBufferSize;
 
 namespace {
 
-// Macros to increment the RX/TX counters for a KNET intf. MUST be called inside
-// the class methods only as it accesses class member variables.
+// Macro to increment the TX counters for a KNET intf. MUST be called inside the
+// class methods only as it accesses class member variables.
 #define INCREMENT_TX_COUNTER(purpose, counter) \
   do {                                         \
     absl::WriterMutexLock l(&tx_stats_lock_);  \
     purpose_to_tx_stats_[purpose].counter++;   \
   } while (0)
 
-#define INCREMENT_RX_COUNTER(purpose, counter) \
-  do {                                         \
-    absl::WriterMutexLock l(&rx_stats_lock_);  \
-    purpose_to_rx_stats_[purpose].counter++;   \
+// Macro to increment the RX counters collected by the RX thread of a KNET intf
+// in a KnetIntfRxBatch. The counters are added to the RX stats of the KNET intf
+// by FlushRxStats() once per batch.
+#define INCREMENT_RX_COUNTER(batch, counter) \
+  do {                                       \
+    (batch)->stats.counter++;                \
+    (batch)->stats_updated = true;           \
   } while (0)
 
 }  // namespace
 
+// The state owned by the RX thread of a KNET interface. Holds the buffers used
+// to receive a batch of packets with a single recvmmsg() call, which are
+// allocated once and reused for all the batches, as well as the RX counters
+// collected since the last call to FlushRxStats().
+struct KnetIntfRxBatch {
+  // Size of the KNET header prepended to each received packet and size of the
+  // payload buffer of each message.
+  size_t header_size;
+  size_t max_payload_size;
+  // The header and payload buffers of all the messages of the batch.
+  std::vector<char> header_buffers;
+  std::vector<char> payload_buffers;
+  // Two iovecs (header + payload), one sockaddr_ll and one mmsghdr per
+  // message of the batch.
+  std::vector<struct iovec> iovs;
+  std::vector<struct sockaddr_ll> addrs;
+  std::vector<struct mmsghdr> msgs;
+  // The number of messages read by the last recvmmsg() call.
+  int num_received;
+  // The RX counters collected since the last flush and whether any of them
+  // was incremented.
+  BcmKnetRxStats stats;
+  bool stats_updated;
+  KnetIntfRxBatch()
+      : header_size(0),
+        max_payload_size(0),
+        header_buffers(),
+        payload_buffers(),
+        iovs(),
+        addrs(),
+        msgs(),
+        num_received(0),
+        stats(),
+        stats_updated(false) {}
+  // Allocates the buffers for 'max_num_packets' messages. The buffer size
+  // given to the kernel never changes, so neither do the iovecs.
+  void Allocate(size_t _header_size, int max_num_packets,
+                size_t _max_payload_size) {
+    header_size = _header_size;
+    max_payload_size = _max_payload_size;
+    header_buffers.assign(max_num_packets * header_size, 0);
+    payload_buffers.assign(max_num_packets * max_payload_size, 0);
+    iovs.assign(2 * max_num_packets, {});
+    addrs.assign(max_num_packets, {});
+    msgs.assign(max_num_packets, {});
+    for (int i = 0; i < max_num_packets; ++i) {
+      iovs[2 * i].iov_base = Header(i);
+      iovs[2 * i].iov_len = header_size;
+      iovs[2 * i + 1].iov_base = Payload(i);
+      iovs[2 * i + 1].iov_len = max_payload_size;
+      msgs[i].msg_hdr.msg_iov = &iovs[2 * i];
+      msgs[i].msg_hdr.msg_iovlen = 2;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+    }
+  }
+  bool Allocated() const { return !msgs.empty(); }
+  char* Header(int i) { return header_buffers.data() + i * header_size; }
+  char* Payload(int i) { return payload_buffers.data() + i * max_payload_size; }
+};
+
 BcmPacketioManager::BcmPacketioManager(
     OperationMode mode, BcmChassisRoInterface* bcm_chassis_ro_interface,
     P4TableMapper* p4_table_mapper, BcmSdkInterface* bcm_sdk_interface,
@@ -1017,6 +1083,11 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
     return MAKE_ERROR(ERR_INTERNAL)
            << "epoll_ctl() failed. errno: " << errno << ".";
   }
+  // The RX buffers and counters of this thread, and the packets of the
+  // current batch. All of them are reused for all the batches.
+  KnetIntfRxBatch batch;
+  std::vector<::p4::v1::PacketIn> packets;
+  std::string header;
   while (true) {
     {
       absl::ReaderMutexLock l(&chassis_lock);
@@ -1028,34 +1099,44 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
             << " epoll_wait() = " << ret;
     if (ret < 0) {
       VLOG(1) << "Error in epoll_wait(). errno: " << errno << ".";
-      INCREMENT_RX_COUNTER(purpose, rx_errors_epoll_wait_failures);
+      INCREMENT_RX_COUNTER(&batch, rx_errors_epoll_wait_failures);
+      FlushRxStats(purpose, &batch);
       continue;  // let it retry
     } else if (ret > 0 && pevents[0].events & EPOLLIN) {
       // We have data to receive. Try to read max of
-      // FLAGS_knet_max_num_packets_to_read_at_once packets before we try to
-      // check for exit criteria.
-      std::vector<::p4::v1::PacketIn> packets;
-      for (int i = 0; i < FLAGS_knet_max_num_packets_to_read_at_once; ++i) {
+      // FLAGS_knet_max_num_packets_to_read_at_once packets in one batch before
+      // we try to check for exit criteria.
+      {
         absl::ReaderMutexLock l(&chassis_lock);
         if (shutdown) break;
-        std::string header = "";
-        ::p4::v1::PacketIn packet;
-        ASSIGN_OR_RETURN(bool retry,
-                         RxPacket(purpose, rx_sock, netif_index, &header,
-                                  packet.mutable_payload()));
-        if (!retry) break;
-        if (!header.empty()) {
+        if (!batch.Allocated()) {
+          batch.Allocate(
+              bcm_sdk_interface_->GetKnetHeaderSizeForRx(unit_),
+              std::max(1, FLAGS_knet_max_num_packets_to_read_at_once),
+              kMaxRxBufferSize);
+        }
+        ::util::Status status = RxPackets(rx_sock, netif_index, &batch);
+        if (!status.ok()) {
+          FlushRxStats(purpose, &batch);
+          return status;
+        }
+        for (int i = 0; i < batch.num_received; ++i) {
+          ::p4::v1::PacketIn packet;
+          if (!ExtractRxPacket(netif_index, i, &batch, &header,
+                               packet.mutable_payload())) {
+            continue;  // already counted as an RX error
+          }
           // We received good data. Process it. The parsing errors will not
           // result in RX thread to shutdown.
           int ingress_logical_port = 0, egress_logical_port = 0;
           PacketInMetadata meta;
-          ::util::Status status = bcm_sdk_interface_->ParseKnetHeaderForRx(
+          status = bcm_sdk_interface_->ParseKnetHeaderForRx(
               unit_, header, &ingress_logical_port, &egress_logical_port,
               &meta.cos);
           if (!status.ok()) {
             VLOG(1) << "Failed to parse KNET header for a packet on unit "
                     << unit_ << ": " << status.error_message();
-            INCREMENT_RX_COUNTER(purpose, rx_drops_knet_header_parse_error);
+            INCREMENT_RX_COUNTER(&batch, rx_drops_knet_header_parse_error);
             continue;  // let it retry
           }
           // Find ingress port ID.
@@ -1068,7 +1149,7 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
             if (ingress_port_id == nullptr) {
               VLOG(1) << "Ingress logical port " << ingress_logical_port
                       << " on unit " << unit_ << " is unknown!";
-              INCREMENT_RX_COUNTER(purpose, rx_drops_unknown_ingress_port);
+              INCREMENT_RX_COUNTER(&batch, rx_drops_unknown_ingress_port);
               continue;  // let it retry
             }
             meta.ingress_port_id = *ingress_port_id;
@@ -1094,7 +1175,7 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
             if (egress_port_id == nullptr) {
               VLOG(1) << "Egress logical port " << egress_logical_port
                       << " on unit " << unit_ << " is unknown!";
-              INCREMENT_RX_COUNTER(purpose, rx_drops_unknown_egress_port);
+              INCREMENT_RX_COUNTER(&batch, rx_drops_unknown_egress_port);
               continue;  // let it retry
             }
             meta.egress_port_id = *egress_port_id;
@@ -1108,13 +1189,14 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
                   << "PacketInMetadata.cos: " << meta.cos;
           status = DeparsePacketInMetadata(meta, &packet);
           if (!status.ok()) {
-            INCREMENT_RX_COUNTER(purpose, rx_drops_metadata_deparse_error);
+            INCREMENT_RX_COUNTER(&batch, rx_drops_metadata_deparse_error);
             continue;  // let it retry
           }
-          INCREMENT_RX_COUNTER(purpose, rx_accepts);
-          packets.push_back(packet);
+          INCREMENT_RX_COUNTER(&batch, rx_accepts);
+          packets.push_back(std::move(packet));
         }
       }
+      FlushRxStats(purpose, &batch);
       // Send the packet to the packet RX writer.
       if (!packets.empty()) {
         absl::ReaderMutexLock l(&rx_writer_lock_);
@@ -1124,6 +1206,7 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
             (*writer)->Write(p);
           }
         }
+        packets.clear();
       }
     }
   }
@@ -1137,96 +1220,88 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
   return ::util::OkStatus();
 }
 
-::util::StatusOr<bool> BcmPacketioManager::RxPacket(
-    GoogleConfig::BcmKnetIntfPurpose purpose, int sock, int netif_index,
-    std::string* header, std::string* payload) {
-  if (header == nullptr || payload == nullptr) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Null header or payload!";
-  }
-
-  header->clear();
-  payload->clear();
-
-  constexpr size_t kMaxIovLen = 2;
-  struct iovec iov[kMaxIovLen];
-  size_t idx = 0;
-  size_t header_size = bcm_sdk_interface_->GetKnetHeaderSizeForRx(unit_);
-  std::unique_ptr<char[]> header_buffer(new char[header_size]);
-  std::unique_ptr<char[]> payload_buffer(new char[kMaxRxBufferSize]);
-  memset(header_buffer.get(), 0, header_size);
-  memset(payload_buffer.get(), 0, kMaxRxBufferSize);
-
-  iov[idx].iov_base = header_buffer.get();
-  iov[idx].iov_len = header_size;
-  idx++;
-
-  iov[idx].iov_base = payload_buffer.get();
-  iov[idx].iov_len = kMaxRxBufferSize;
-  idx++;
-
-  RET_CHECK(idx <= kMaxIovLen);  // juts in case. Will never happen
+::util::Status BcmPacketioManager::RxPackets(int sock, int netif_index,
+                                             KnetIntfRxBatch* batch) {
+  RET_CHECK(batch->Allocated());  // just in case. Will never happen
 
-  struct sockaddr_ll sa;
-  memset(&sa, 0, sizeof(sa));
-
-  struct msghdr msg;
-  memset(&msg, 0, sizeof(msg));
-  msg.msg_iov = iov;
-  msg.msg_iovlen = idx;
-  msg.msg_name = &sa;
-  msg.msg_namelen = sizeof(sa);
+  // Only the fields written by the kernel need to be reset. The buffers are
+  // not cleared, every message is checked against its received length.
+  batch->num_received = 0;
+  for (size_t i = 0; i < batch->msgs.size(); ++i) {
+    memset(&batch->addrs[i], 0, sizeof(batch->addrs[i]));
+    batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->addrs[i]);
+    batch->msgs[i].msg_hdr.msg_flags = 0;
+    batch->msgs[i].msg_len = 0;
+  }
 
-  ssize_t res = recvmsg(sock, &msg, MSG_DONTWAIT);
+  int res = recvmmsg(sock, batch->msgs.data(), batch->msgs.size(),
+                     MSG_DONTWAIT, nullptr);
   if (res < 0) {
     switch (errno) {
-      case EINTR:
-        // Signal received before we could read anything. Need to retry.
-        return true;
-      case EAGAIN:
-        // No data was available. No need to retry before we check for data
-        // available again.
-        return false;
+      case EINTR:   // signal received before we could read anything.
+      case EAGAIN:  // no data was available.
+        // Nothing to process. The socket is polled again.
+        return ::util::OkStatus();
       default:
-        VLOG(1) << "Error when receiving packet on netif  " << netif_index
+        VLOG(1) << "Error when receiving packets on netif  " << netif_index
                 << " on unit " << unit_ << ": " << errno;
-        INCREMENT_RX_COUNTER(purpose, rx_errors_internal_read_failures);
+        INCREMENT_RX_COUNTER(batch, rx_errors_internal_read_failures);
         // We retry in case of other errors as well.
-        return true;
+        return ::util::OkStatus();
     }
-  } else if (res == 0) {
-    INCREMENT_RX_COUNTER(purpose, rx_errors_sock_shutdown);
-    return MAKE_ERROR(ERR_INTERNAL)
-           << "Unexpected socket shutdown on netif  " << netif_index
-           << " on unit " << unit_ << ".";
   }
 
-  INCREMENT_RX_COUNTER(purpose, all_rx);
-  // res > 0 so cast to size_t is safe.
-  if (static_cast<size_t>(res) < header_size) {
+  for (int i = 0; i < res; ++i) {
+    if (batch->msgs[i].msg_len == 0) {
+      INCREMENT_RX_COUNTER(batch, rx_errors_sock_shutdown);
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Unexpected socket shutdown on netif  " << netif_index
+             << " on unit " << unit_ << ".";
+    }
+    INCREMENT_RX_COUNTER(batch, all_rx);
+  }
+  batch->num_received = res;
+
+  return ::util::OkStatus();
+}
+
+bool BcmPacketioManager::ExtractRxPacket(int netif_index, int i,
+                                         KnetIntfRxBatch* batch,
+                                         std::string* header,
+                                         std::string* payload) {
+  header->clear();
+  payload->clear();
+
+  const struct msghdr& msg = batch->msgs[i].msg_hdr;
+  const struct sockaddr_ll& sa = batch->addrs[i];
+  size_t res = batch->msgs[i].msg_len;
+  size_t header_size = batch->header_size;
+  if (res < header_size) {
     VLOG(1) << "Num of received bytes on netif  " << netif_index << " on unit "
             << unit_ << " < " << header_size << ".";
-    INCREMENT_RX_COUNTER(purpose, rx_errors_incomplete_read);
-    return true;
+    INCREMENT_RX_COUNTER(batch, rx_errors_incomplete_read);
+    return false;
   }
-  size_t payload_size = static_cast<size_t>(res - header_size);
+  size_t payload_size = res - header_size;
 
-  // Try to see if the message looks OK. If not retry.
+  // Try to see if the message looks OK.
   if (msg.msg_flags & MSG_TRUNC || sa.sll_ifindex != netif_index ||
       sa.sll_pkttype == PACKET_OUTGOING) {
     VLOG(1) << "Received invalid packet on netif  " << netif_index
             << " on unit " << unit_ << ".";
-    INCREMENT_RX_COUNTER(purpose, rx_errors_invalid_packet);
-    return true;
+    INCREMENT_RX_COUNTER(batch, rx_errors_invalid_packet);
+    return false;
   }
 
   // Strip some known VLAN tags.
-  struct ether_header* ether_header =
-      reinterpret_cast<struct ether_header*>(payload_buffer.get());
+  const char* payload_buffer = batch->Payload(i);
+  const struct ether_header* ether_header =
+      reinterpret_cast<const struct ether_header*>(payload_buffer);
   bool tagged = false;
   if (payload_size >= sizeof(struct ether_header) + kVlanIdSize &&
       ntohs(ether_header->ether_type) == ETHERTYPE_VLAN) {
-    auto* pid = reinterpret_cast<uint16*>(payload_buffer.get() +
-                                          sizeof(struct ether_header));
+    auto* pid = reinterpret_cast<const uint16*>(payload_buffer +
+                                                sizeof(struct ether_header));
     uint16 vlan = ntohs(*pid) & kVlanIdMask;
     if (vlan == kDefaultVlan || vlan == kArpVlan || vlan == 0) {
       tagged = true;
@@ -1234,17 +1309,28 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
   }
 
   if (tagged) {
-    payload->assign(payload_buffer.get(), ETH_ALEN * 2);
-    payload->append(payload_buffer.get() + ETH_ALEN * 2 + kVlanTagSize,
+    payload->assign(payload_buffer, ETH_ALEN * 2);
+    payload->append(payload_buffer + ETH_ALEN * 2 + kVlanTagSize,
                     payload_size - ETH_ALEN * 2 - kVlanTagSize);
   } else {
-    payload->assign(payload_buffer.get(), payload_size);
+    payload->assign(payload_buffer, payload_size);
   }
-  header->assign(header_buffer.get(), header_size);
+  header->assign(batch->Header(i), header_size);
 
   return true;
 }
 
+void BcmPacketioManager::FlushRxStats(GoogleConfig::BcmKnetIntfPurpose purpose,
+                                      KnetIntfRxBatch* batch) {
+  if (!batch->stats_updated) return;
+  {
+    absl::WriterMutexLock l(&rx_stats_lock_);
+    purpose_to_rx_stats_[purpose].Add(batch->stats);
+  }
+  batch->stats = BcmKnetRxStats();
+  batch->stats_updated = false;
+}
+
 ::util::Status BcmPacketioManager::DeparsePacketInMetadata(
     const PacketInMetadata& meta, ::p4::v1::PacketIn* packet) {
   // Note: We are down-casting to uint32 for the port/trunk IDs in this method.
@@ -40,6 +40,7 @@ namespace bcm {
 
 class BcmPacketioManager;
 struct BcmKnetIntf;
+struct KnetIntfRxBatch;
 
 // Encapsulates the data passed to the RX thread for each KNET interface.
 struct KnetIntfRxThreadData {
@@ -139,6 +140,20 @@ struct BcmKnetRxStats {
         rx_drops_metadata_deparse_error(0),
         rx_drops_unknown_ingress_port(0),
         rx_drops_unknown_egress_port(0) {}
+  // Adds the counters of 'other' to the counters of this instance.
+  void Add(const BcmKnetRxStats& other) {
+    all_rx += other.all_rx;
+    rx_accepts += other.rx_accepts;
+    rx_errors_epoll_wait_failures += other.rx_errors_epoll_wait_failures;
+    rx_errors_internal_read_failures += other.rx_errors_internal_read_failures;
+    rx_errors_sock_shutdown += other.rx_errors_sock_shutdown;
+    rx_errors_incomplete_read += other.rx_errors_incomplete_read;
+    rx_errors_invalid_packet += other.rx_errors_invalid_packet;
+    rx_drops_knet_header_parse_error += other.rx_drops_knet_header_parse_error;
+    rx_drops_metadata_deparse_error += other.rx_drops_metadata_deparse_error;
+    rx_drops_unknown_ingress_port += other.rx_drops_unknown_ingress_port;
+    rx_drops_unknown_egress_port += other.rx_drops_unknown_egress_port;
+  }
   std::string ToString() const {
     return absl::StrCat(
         "(all_rx:", all_rx, ", rx_accepts:", rx_accepts,
@@ -393,12 +408,23 @@ class BcmPacketioManager {
       GoogleConfig::BcmKnetIntfPurpose purpose)
       LOCKS_EXCLUDED(chassis_lock, rx_writer_lock_);
 
-  // Helper called by HandleKnetIntfPacketRx() to read one single full message
-  // from a socket. Returns true if we need to retry the receive and false if
-  // otherwise. If any non-recoverable error is encountered, returns error.
-  ::util::StatusOr<bool> RxPacket(GoogleConfig::BcmKnetIntfPurpose purpose,
-                                  int sock, int netif_index,
-                                  std::string* header, std::string* payload);
+  // Helper called by HandleKnetIntfPacketRx() to read a batch of full
+  // messages from a socket into the buffers of 'batch' with a single
+  // recvmmsg() call. The number of messages read is saved in the batch. If any
+  // non-recoverable error is encountered, returns error.
+  ::util::Status RxPackets(int sock, int netif_index, KnetIntfRxBatch* batch);
+
+  // Helper called by HandleKnetIntfPacketRx() to copy the KNET header and the
+  // payload of the i-th message of 'batch' to 'header' and 'payload'. Returns
+  // false if the message is not a valid packet.
+  bool ExtractRxPacket(int netif_index, int i, KnetIntfRxBatch* batch,
+                       std::string* header, std::string* payload);
+
+  // Adds the RX counters collected by the RX thread in 'batch' to the RX stats
+  // of the KNET intf with the given purpose and resets them. Called once per
+  // batch, so that the RX thread does not take rx_stats_lock_ per packet.
+  void FlushRxStats(GoogleConfig::BcmKnetIntfPurpose purpose,
+                    KnetIntfRxBatch* batch) LOCKS_EXCLUDED(rx_stats_lock_);
 
   // Deparses the given PacketInMetadata to the a set of
   // P4 PacketMetadata protos in the given P4 PacketIn which
@@ -10,6 +10,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/status/status_test_util.h"
@@ -26,6 +27,8 @@
 // #include "util/libcproxy/libcwrapper.h"
 // #include "util/libcproxy/passthrough_proxy.h"
 
+DECLARE_int32(knet_max_num_packets_to_read_at_once);
+
 namespace stratum {
 namespace hal {
 namespace bcm {
@@ -86,8 +89,9 @@ class LibcProxyMock : public PassthroughLibcProxy {
   ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags) override {
     return SendMsg(sockfd, msg, flags);
   }
-  ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags) override {
-    return RecvMsg(sockfd, msg, flags);
+  int recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen,
+               int flags, struct timespec* timeout) override {
+    return RecvMmsg(sockfd, msgvec, vlen, flags, timeout);
   }
   int epoll_create1(int flags) override { return EpollCreate1(flags); }
   int epoll_ctl(int efd, int op, int fd, struct epoll_event* event) override {
@@ -112,7 +116,9 @@ class LibcProxyMock : public PassthroughLibcProxy {
                          socklen_t addrlen));
   MOCK_METHOD3(SendMsg,
                ssize_t(int sockfd, const struct msghdr* msg, int flags));
-  MOCK_METHOD3(RecvMsg, ssize_t(int sockfd, struct msghdr* msg, int flags));
+  MOCK_METHOD5(RecvMmsg,
+               int(int sockfd, struct mmsghdr* msgvec, unsigned int vlen,
+                   int flags, struct timespec* timeout));
   MOCK_METHOD1(EpollCreate1, int(int flags));
   MOCK_METHOD4(EpollCtl,
                int(int efd, int op, int fd, struct epoll_event* event));
@@ -1254,12 +1260,18 @@ TEST_P(BcmPacketioManagerTest,
                               p[0].events = EPOLLIN;
                             })),
                             Return(1)));  // 1 means RX packet is available
-  EXPECT_CALL(*LibcProxyMock::Instance(), RecvMsg(kSocket1, _, _))
-      .WillRepeatedly(DoAll(WithArgs<1>(Invoke([](struct msghdr* msg) {
-                              // Any modification to msg goes here. Not needed
-                              // At the moment.
-                            })),
-                            Return(kTestKnetHeaderSize + kTestPacketBodySize)));
+  // Every call fills up the whole batch.
+  EXPECT_CALL(*LibcProxyMock::Instance(),
+              RecvMmsg(kSocket1, _, FLAGS_knet_max_num_packets_to_read_at_once,
+                       MSG_DONTWAIT, _))
+      .WillRepeatedly(
+          Invoke([](int sockfd, struct mmsghdr* msgvec, unsigned int vlen,
+                    int flags, struct timespec* timeout) {
+            for (unsigned int i = 0; i < vlen; ++i) {
+              msgvec[i].msg_len = kTestKnetHeaderSize + kTestPacketBodySize;
+            }
+            return static_cast<int>(vlen);
+          }));
 
   // BcmSdkInterface calls triggered by RX thread.
   EXPECT_CALL(*bcm_sdk_mock_, GetKnetHeaderSizeForRx(kUnit1))
@@ -1442,12 +1454,18 @@ TEST_P(BcmPacketioManagerTest,
                               p[0].events = EPOLLIN;
                             })),
                             Return(1)));  // 1 means RX packet is available
-  EXPECT_CALL(*LibcProxyMock::Instance(), RecvMsg(kSocket1, _, _))
-      .WillRepeatedly(DoAll(WithArgs<1>(Invoke([](struct msghdr* msg) {
-                              // Any modification to msg goes here. Not needed
-                              // At the moment.
-                            })),
-                            Return(kTestKnetHeaderSize + kTestPacketBodySize)));
+  // Every call fills up the whole batch.
+  EXPECT_CALL(*LibcProxyMock::Instance(),
+              RecvMmsg(kSocket1, _, FLAGS_knet_max_num_packets_to_read_at_once,
+                       MSG_DONTWAIT, _))
+      .WillRepeatedly(
+          Invoke([](int sockfd, struct mmsghdr* msgvec, unsigned int vlen,
+                    int flags, struct timespec* timeout) {
+            for (unsigned int i = 0; i < vlen; ++i) {
+              msgvec[i].msg_len = kTestKnetHeaderSize + kTestPacketBodySize;
+            }
+            return static_cast<int>(vlen);
+          }));
 
   // BcmSdkInterface calls triggered by RX thread.
   EXPECT_CALL(*bcm_sdk_mock_, GetKnetHeaderSizeForRx(kUnit1))
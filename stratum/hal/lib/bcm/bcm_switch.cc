@@ -250,6 +250,12 @@ BcmSwitch::~BcmSwitch() {}
   if (shutdown) {
     return MAKE_ERROR(ERR_CANCELLED) << "Switch is shutdown.";
   }
+  // The hardware is read once per port and kind of data, even if several
+  // requests ask for it, e.g. the counters of a port for each counter leaf.
+  std::map<std::pair<uint64, uint32>, ::util::StatusOr<PortCounters>>
+      port_counters;
+  std::map<std::pair<int32, int32>, ::util::StatusOr<OpticalTransceiverInfo>>
+      optical_transceiver_infos;
   // TODO(b/69920763): Implement this. The code below is just a placeholder.
   for (const auto& req : request.requests()) {
     DataResponse resp;
@@ -335,9 +341,26 @@ BcmSwitch::~BcmSwitch() {}
         // - node_id: req.port_counters().node_id()
         // - port_id: req.port_counters().port_id()
         // and then write it into the response.
-        status.Update(bcm_chassis_manager_->GetPortCounters(
-            req.port_counters().node_id(), req.port_counters().port_id(),
-            resp.mutable_port_counters()));
+        const auto key = std::make_pair(req.port_counters().node_id(),
+                                        req.port_counters().port_id());
+        auto it = port_counters.find(key);
+        if (it == port_counters.end()) {
+          PortCounters counters;
+          ::util::Status counters_status =
+              bcm_chassis_manager_->GetPortCounters(key.first, key.second,
+                                                    &counters);
+          it = port_counters
+                   .emplace(key, counters_status.ok()
+                                     ? ::util::StatusOr<PortCounters>(counters)
+                                     : ::util::StatusOr<PortCounters>(
+                                           counters_status))
+                   .first;
+        }
+        if (!it->second.ok()) {
+          status.Update(it->second.status());
+        } else {
+          *resp.mutable_port_counters() = it->second.ValueOrDie();
+        }
         break;
       }
       case DataRequest::Request::kHealthIndicator:
@@ -420,13 +443,32 @@ BcmSwitch::~BcmSwitch() {}
         }
         break;
       }
-      case DataRequest::Request::kOpticalTransceiverInfo:
+      case DataRequest::Request::kOpticalTransceiverInfo: {
         // Retrieve current optical transceiver state from phal.
-        status.Update(phal_interface_->GetOpticalTransceiverInfo(
-            req.optical_transceiver_info().module(),
-            req.optical_transceiver_info().network_interface(),
-            resp.mutable_optical_transceiver_info()));
+        const auto key =
+            std::make_pair(req.optical_transceiver_info().module(),
+                           req.optical_transceiver_info().network_interface());
+        auto it = optical_transceiver_infos.find(key);
+        if (it == optical_transceiver_infos.end()) {
+          OpticalTransceiverInfo info;
+          ::util::Status info_status =
+              phal_interface_->GetOpticalTransceiverInfo(key.first, key.second,
+                                                         &info);
+          it = optical_transceiver_infos
+                   .emplace(key,
+                            info_status.ok()
+                                ? ::util::StatusOr<OpticalTransceiverInfo>(info)
+                                : ::util::StatusOr<OpticalTransceiverInfo>(
+                                      info_status))
+                   .first;
+        }
+        if (!it->second.ok()) {
+          status.Update(it->second.status());
+        } else {
+          *resp.mutable_optical_transceiver_info() = it->second.ValueOrDie();
+        }
         break;
+      }
       case DataRequest::Request::kSdnPortId:
         // Return the requested port ID because port translation is performed.
         resp.mutable_sdn_port_id()->set_port_id(req.sdn_port_id().port_id());
@@ -372,12 +372,6 @@ class BcmTableManager {
   BcmTableManager();
 
  private:
-  // Typedefs for P4 TableEntry storage.
-  typedef absl::flat_hash_set<::p4::v1::TableEntry, TableEntryHash,
-                              TableEntryEqual>
-      TableEntrySet;
-  typedef absl::flat_hash_map<uint32, TableEntrySet> TableIdToTableEntrySetMap;
-
   // Private constructor. Use CreateInstance() to create an instance of this
   // class.
   BcmTableManager(const BcmChassisRoInterface* bcm_chassis_ro_interface,
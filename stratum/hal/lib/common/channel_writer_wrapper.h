@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/lib/channel/channel.h"
@@ -30,6 +31,16 @@ class ChannelWriterWrapper : public WriterInterface<T> {
     }
     return true;
   }
+  bool WriteBatch(std::vector<T>* msgs) override {
+    if (!writer_) return false;
+    auto status = writer_->WriteBatch(msgs, absl::InfiniteDuration());
+    if (!status.ok()) {
+      VLOG(3) << "Unable to write batch to Channel with error code: "
+              << status.error_code() << ".";
+      return false;
+    }
+    return true;
+  }
 
  private:
   std::unique_ptr<ChannelWriter<T>> writer_;
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
@@ -309,6 +310,19 @@ bool ContainsUniqueNames(const T& values) {
                           "Get response can only be encoded as PROTO.");
   }
 
+  // An in-place stream that saves contents of the `update` field of the
+  // `msg` PROTOBUF to the response that will be sent to the controller.
+  InlineGnmiSubscribeStream stream(
+      [resp](const ::gnmi::SubscribeResponse& msg) -> bool {
+        // If msg has empty update, it might be a sync_response for
+        // GetRequest
+        if (!msg.has_update()) return msg.sync_response();
+        *resp->add_notification() = msg.update();
+        return true;
+      });
+  // The leaves of all the paths are polled together, so the values they need
+  // are retrieved from the switch with one request per node.
+  std::vector<SubscriptionHandle> handles;
   for (const auto& path : req->path()) {
     VLOG(1) << "GET: " << path.ShortDebugString();
     if (path == GetPath()()) {
@@ -318,6 +332,12 @@ bool ContainsUniqueNames(const T& values) {
         return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
                               "Get '/' can be done for CONFIG elements only.");
       }
+      // Get the value(s) represented by the preceding paths first.
+      ::util::Status status = gnmi_publisher_.HandlePolls(handles);
+      if (!status.ok()) {
+        return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
+                              status.error_message());
+      }
       auto* notification = resp->add_notification();
       // TODO(unknown): Set correct timestamp.
       notification->set_timestamp(0ll);
@@ -337,32 +357,22 @@ bool ContainsUniqueNames(const T& values) {
                               out.status().error_message());
       }
     } else {
-      // Process the get request.
-      SubscriptionHandle h;
-      // An in-place stream that saves contents of the `update` field of the
-      // `msg` PROTOBUF to the response that will be sent to the controller.
-      InlineGnmiSubscribeStream stream(
-          [resp](const ::gnmi::SubscribeResponse& msg) -> bool {
-            // If msg has empty update, it might be a sync_response for
-            // GetRequest
-            if (!msg.has_update()) return msg.sync_response();
-            *resp->add_notification() = msg.update();
-            return true;
-          });
       // Check if the path is supported.
-      ::util::Status status;
-      if ((status = gnmi_publisher_.SubscribePoll(path, &stream, &h)).ok()) {
-        // Get the value(s) represented by the path.
-        if (!(status = gnmi_publisher_.HandlePoll(h)).ok()) {
-          return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
-                                status.error_message());
-        }
-      } else {
+      SubscriptionHandle h;
+      ::util::Status status = gnmi_publisher_.SubscribePoll(path, &stream, &h);
+      if (!status.ok()) {
         return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
                               status.error_message());
       }
+      handles.push_back(h);
     }
   }
+  // Get the value(s) represented by the paths.
+  ::util::Status status = gnmi_publisher_.HandlePolls(handles);
+  if (!status.ok()) {
+    return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
+                          status.error_message());
+  }
   return ::grpc::Status::OK;
 }
 
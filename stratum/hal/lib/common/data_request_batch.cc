@@ -0,0 +1,120 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/data_request_batch.h"
+
+#include "stratum/glue/logging.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// Collects the DataResponses of a RetrieveValue call.
+class DataResponseCollector : public WriterInterface<DataResponse> {
+ public:
+  explicit DataResponseCollector(std::vector<DataResponse>* responses)
+      : responses_(responses) {}
+
+  bool Write(const DataResponse& resp) override {
+    responses_->push_back(resp);
+    return true;
+  }
+
+ private:
+  std::vector<DataResponse>* responses_;  // not owned.
+};
+
+}  // namespace
+
+DataRequestBatch::DataRequestBatch(SwitchInterface* switch_interface)
+    : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
+      executed_(false),
+      recorded_requests_(),
+      node_id_to_requests_(),
+      responses_(),
+      num_switch_calls_(0) {}
+
+::util::Status DataRequestBatch::RetrieveValue(
+    uint64 node_id, const DataRequest& request,
+    WriterInterface<DataResponse>* writer,
+    std::vector<::util::Status>* details) {
+  if (!executed_) {
+    for (const auto& req : request.requests()) {
+      if (recorded_requests_.emplace(node_id, req.SerializeAsString()).second) {
+        node_id_to_requests_[node_id].push_back(req);
+      }
+    }
+    return ::util::OkStatus();
+  }
+
+  for (const auto& req : request.requests()) {
+    auto it = responses_.find(RequestKey(node_id, req.SerializeAsString()));
+    if (it == responses_.end()) {
+      RETURN_IF_ERROR(RetrieveDirectly(node_id, req, writer, details));
+      continue;
+    }
+    if (it->second.ok()) writer->Write(it->second.ValueOrDie());
+    if (details) details->push_back(it->second.status());
+  }
+  return ::util::OkStatus();
+}
+
+void DataRequestBatch::Execute() {
+  executed_ = true;
+  for (const auto& entry : node_id_to_requests_) {
+    const uint64 node_id = entry.first;
+    const auto& requests = entry.second;
+    DataRequest req;
+    for (const auto& request : requests) *req.add_requests() = request;
+
+    std::vector<DataResponse> responses;
+    std::vector<::util::Status> details;
+    DataResponseCollector writer(&responses);
+    ++num_switch_calls_;
+    ::util::Status status =
+        switch_interface_->RetrieveValue(node_id, req, &writer, &details);
+    if (!status.ok()) {
+      // The requests are retried one by one when their leaves are polled.
+      VLOG(1) << "Batched RetrieveValue for node " << node_id
+              << " failed: " << status;
+      continue;
+    }
+    if (details.size() == requests.size()) {
+      // A response is written for each request that succeeded, in the order
+      // of the requests.
+      size_t next_response = 0;
+      for (size_t i = 0; i < requests.size(); ++i) {
+        RequestKey key(node_id, requests[i].SerializeAsString());
+        if (!details[i].ok()) {
+          responses_.emplace(key, details[i]);
+        } else if (next_response < responses.size()) {
+          responses_.emplace(key, responses[next_response++]);
+        }
+      }
+    } else if (responses.size() == requests.size()) {
+      for (size_t i = 0; i < requests.size(); ++i) {
+        responses_.emplace(
+            RequestKey(node_id, requests[i].SerializeAsString()),
+            responses[i]);
+      }
+    }
+  }
+  recorded_requests_.clear();
+  node_id_to_requests_.clear();
+}
+
+::util::Status DataRequestBatch::RetrieveDirectly(
+    uint64 node_id, const DataRequest::Request& request,
+    WriterInterface<DataResponse>* writer,
+    std::vector<::util::Status>* details) {
+  DataRequest req;
+  *req.add_requests() = request;
+  ++num_switch_calls_;
+  return switch_interface_->RetrieveValue(node_id, req, writer, details);
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,91 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_DATA_REQUEST_BATCH_H_
+#define STRATUM_HAL_LIB_COMMON_DATA_REQUEST_BATCH_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/switch_interface.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+
+namespace stratum {
+namespace hal {
+
+// The class "DataRequestBatch" merges the DataRequests of many gNMI leaves into
+// a single RetrieveValue call per node. Every leaf used to query the switch on
+// its own, so a Get for hundreds of leaves issued hundreds of RetrieveValue
+// calls. A batch is used in two phases:
+// - While recording, RetrieveValue() only records the requests and writes no
+//   responses.
+// - Execute() retrieves all the recorded requests of each node at once.
+// - Afterwards, RetrieveValue() writes the responses retrieved by Execute().
+//   Requests which were not recorded are retrieved from the switch directly.
+// This class is not thread-safe. A batch is used by one thread at a time.
+class DataRequestBatch {
+ public:
+  explicit DataRequestBatch(SwitchInterface* switch_interface);
+  virtual ~DataRequestBatch() {}
+
+  // Same contract as SwitchInterface::RetrieveValue(). Records the requests
+  // before Execute() and serves them from the retrieved responses after it.
+  ::util::Status RetrieveValue(uint64 node_id, const DataRequest& request,
+                               WriterInterface<DataResponse>* writer,
+                               std::vector<::util::Status>* details);
+
+  // Retrieves all the recorded requests, with one RetrieveValue call per node.
+  void Execute();
+
+  // Returns true until Execute() is called, i.e. while requests are recorded.
+  bool IsRecording() const { return !executed_; }
+
+  // Returns the number of RetrieveValue calls made to the switch so far.
+  int GetNumSwitchCalls() const { return num_switch_calls_; }
+
+  // DataRequestBatch is neither copyable nor movable.
+  DataRequestBatch(const DataRequestBatch&) = delete;
+  DataRequestBatch& operator=(const DataRequestBatch&) = delete;
+
+ private:
+  // A recorded request, identified by its node ID and serialized form.
+  using RequestKey = std::pair<uint64, std::string>;
+
+  // Retrieves a single request from the switch.
+  ::util::Status RetrieveDirectly(uint64 node_id,
+                                  const DataRequest::Request& request,
+                                  WriterInterface<DataResponse>* writer,
+                                  std::vector<::util::Status>* details);
+
+  // Pointer to the switch used to retrieve the values. Not owned.
+  SwitchInterface* const switch_interface_;
+
+  // True once Execute() has been called.
+  bool executed_;
+
+  // The recorded requests.
+  std::set<RequestKey> recorded_requests_;
+
+  // Map from node ID to the unique requests recorded for the node, in the
+  // order they were recorded.
+  std::map<uint64, std::vector<DataRequest::Request>> node_id_to_requests_;
+
+  // Map from a recorded request to its response or the error retrieving it.
+  // Requests the switch answered ambiguously have no entry.
+  std::map<RequestKey, ::util::StatusOr<DataResponse>> responses_;
+
+  // The number of RetrieveValue calls made to the switch so far.
+  int num_switch_calls_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_DATA_REQUEST_BATCH_H_
@@ -0,0 +1,179 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/data_request_batch.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::SizeIs;
+
+constexpr uint64 kNodeId1 = 1;
+constexpr uint64 kNodeId2 = 2;
+constexpr uint32 kFailingPortId = 13;
+
+// Fake RetrieveValue() which answers each oper status request with
+// PORT_STATE_UP and each port speed request with the port ID. Requests for
+// 'kFailingPortId' fail.
+class FakeSwitch {
+ public:
+  ::util::Status RetrieveValue(uint64 node_id, const DataRequest& request,
+                               WriterInterface<DataResponse>* writer,
+                               std::vector<::util::Status>* details) {
+    requests_.push_back(request);
+    for (const auto& req : request.requests()) {
+      ::util::Status status = ::util::OkStatus();
+      DataResponse resp;
+      if (req.has_oper_status()) {
+        if (req.oper_status().port_id() == kFailingPortId) {
+          status = ::util::Status(StratumErrorSpace(), ERR_INVALID_PARAM,
+                                  "failing port");
+        } else {
+          resp.mutable_oper_status()->set_state(PORT_STATE_UP);
+        }
+      } else if (req.has_port_speed()) {
+        resp.mutable_port_speed()->set_speed_bps(req.port_speed().port_id());
+      }
+      if (status.ok()) writer->Write(resp);
+      if (details) details->push_back(status);
+    }
+    return ::util::OkStatus();
+  }
+
+  const std::vector<DataRequest>& requests() const { return requests_; }
+
+ private:
+  std::vector<DataRequest> requests_;
+};
+
+// Collects the DataResponses written to it.
+class ResponseCollector : public WriterInterface<DataResponse> {
+ public:
+  bool Write(const DataResponse& resp) override {
+    responses.push_back(resp);
+    return true;
+  }
+  std::vector<DataResponse> responses;
+};
+
+DataRequest MakePortSpeedRequest(uint64 node_id, uint32 port_id) {
+  DataRequest req;
+  auto* request = req.add_requests()->mutable_port_speed();
+  request->set_node_id(node_id);
+  request->set_port_id(port_id);
+  return req;
+}
+
+DataRequest MakeOperStatusRequest(uint64 node_id, uint32 port_id) {
+  DataRequest req;
+  auto* request = req.add_requests()->mutable_oper_status();
+  request->set_node_id(node_id);
+  request->set_port_id(port_id);
+  return req;
+}
+
+// Checks that the recorded requests are retrieved with one call per node and
+// served from the batch afterwards.
+TEST(DataRequestBatchTest, OneSwitchCallPerNode) {
+  SwitchMock switch_mock;
+  FakeSwitch fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(_, _, _, _))
+      .WillRepeatedly(Invoke(&fake, &FakeSwitch::RetrieveValue));
+
+  DataRequestBatch batch(&switch_mock);
+  ResponseCollector writer;
+  for (uint32 port_id = 1; port_id <= 3; ++port_id) {
+    EXPECT_OK(batch.RetrieveValue(
+        kNodeId1, MakePortSpeedRequest(kNodeId1, port_id), &writer, nullptr));
+    EXPECT_OK(batch.RetrieveValue(
+        kNodeId1, MakeOperStatusRequest(kNodeId1, port_id), &writer, nullptr));
+  }
+  // Duplicate requests are retrieved once.
+  EXPECT_OK(batch.RetrieveValue(kNodeId1, MakePortSpeedRequest(kNodeId1, 1),
+                                &writer, nullptr));
+  EXPECT_OK(batch.RetrieveValue(kNodeId2, MakePortSpeedRequest(kNodeId2, 4),
+                                &writer, nullptr));
+  // Nothing is written while recording.
+  EXPECT_THAT(writer.responses, SizeIs(0));
+  EXPECT_THAT(fake.requests(), SizeIs(0));
+
+  batch.Execute();
+  ASSERT_THAT(fake.requests(), SizeIs(2));
+  EXPECT_EQ(6, fake.requests()[0].requests_size());
+  EXPECT_EQ(1, fake.requests()[1].requests_size());
+
+  EXPECT_OK(batch.RetrieveValue(kNodeId1, MakePortSpeedRequest(kNodeId1, 2),
+                                &writer, nullptr));
+  EXPECT_OK(batch.RetrieveValue(kNodeId2, MakePortSpeedRequest(kNodeId2, 4),
+                                &writer, nullptr));
+  ASSERT_THAT(writer.responses, SizeIs(2));
+  EXPECT_EQ(2, writer.responses[0].port_speed().speed_bps());
+  EXPECT_EQ(4, writer.responses[1].port_speed().speed_bps());
+  EXPECT_THAT(fake.requests(), SizeIs(2));
+  EXPECT_EQ(2, batch.GetNumSwitchCalls());
+}
+
+// Checks that the error of a failed request is reported in the details.
+TEST(DataRequestBatchTest, FailedRequest) {
+  SwitchMock switch_mock;
+  FakeSwitch fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(_, _, _, _))
+      .WillRepeatedly(Invoke(&fake, &FakeSwitch::RetrieveValue));
+
+  DataRequestBatch batch(&switch_mock);
+  ResponseCollector writer;
+  EXPECT_OK(batch.RetrieveValue(kNodeId1,
+                                MakeOperStatusRequest(kNodeId1, kFailingPortId),
+                                &writer, nullptr));
+  EXPECT_OK(batch.RetrieveValue(kNodeId1, MakeOperStatusRequest(kNodeId1, 1),
+                                &writer, nullptr));
+  batch.Execute();
+
+  std::vector<::util::Status> details;
+  EXPECT_OK(batch.RetrieveValue(kNodeId1,
+                                MakeOperStatusRequest(kNodeId1, kFailingPortId),
+                                &writer, &details));
+  EXPECT_OK(batch.RetrieveValue(kNodeId1, MakeOperStatusRequest(kNodeId1, 1),
+                                &writer, &details));
+  ASSERT_THAT(details, SizeIs(2));
+  EXPECT_FALSE(details[0].ok());
+  EXPECT_OK(details[1]);
+  ASSERT_THAT(writer.responses, SizeIs(1));
+  EXPECT_EQ(PORT_STATE_UP, writer.responses[0].oper_status().state());
+  EXPECT_THAT(fake.requests(), SizeIs(1));
+}
+
+// Checks that requests which were not recorded are retrieved directly.
+TEST(DataRequestBatchTest, UnrecordedRequest) {
+  SwitchMock switch_mock;
+  FakeSwitch fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(_, _, _, _))
+      .WillRepeatedly(Invoke(&fake, &FakeSwitch::RetrieveValue));
+
+  DataRequestBatch batch(&switch_mock);
+  batch.Execute();
+  EXPECT_THAT(fake.requests(), SizeIs(0));
+
+  ResponseCollector writer;
+  EXPECT_OK(batch.RetrieveValue(kNodeId1, MakePortSpeedRequest(kNodeId1, 7),
+                                &writer, nullptr));
+  ASSERT_THAT(writer.responses, SizeIs(1));
+  EXPECT_EQ(7, writer.responses[0].port_speed().speed_bps());
+  EXPECT_THAT(fake.requests(), SizeIs(1));
+  EXPECT_EQ(1, batch.GetNumSwitchCalls());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -10,6 +10,7 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
@@ -42,9 +43,15 @@ namespace hal {
 // - an event knows its type, so it can call the Process() method of the
 //   correct event handler list, which in turn will call all handlers that are
 //   registered.
+// Handlers of per-port events can additionally register with the key of the
+// port they are interested in, so that an event is only sent to the handlers
+// of its port instead of to every handler of its type.
 // C++ template and inheritance magic is used to make the whole process as
 // automatic (i.e. without explicit code) as possible.
 
+class EventHandlerRecord;
+using SubscriptionHandle = std::shared_ptr<EventHandlerRecord>;
+
 // A base class for all types of events the gNMI GnmiPublisher handles.
 // Allows for using pointer of type GnmiEvent* to reference an event of any
 // type.
@@ -56,6 +63,10 @@ class GnmiEvent {
   // Triggers processing of this event. The processing is different for each
   // type of an event, so, each type will define its version of this method.
   virtual ::util::Status Process() const = 0;
+
+  // Returns the handlers that are interested in this event. Processing the
+  // event is equivalent to calling each of them with the event.
+  virtual std::vector<SubscriptionHandle> GetHandlers() const = 0;
 };
 using GnmiEventPtr = std::shared_ptr<GnmiEvent>;
 
@@ -69,6 +80,7 @@ template <typename E>
 class GnmiEventProcess : public GnmiEvent {
  public:
   ::util::Status Process() const override;
+  std::vector<SubscriptionHandle> GetHandlers() const override;
 };
 
 // A Timer event. Only certain types of subscriptions, such as interface
@@ -142,6 +154,29 @@ class PerPortGnmiEvent : public PerNodeGnmiEvent<E> {
   uint32 port_id_;
 };
 
+// The key of the handlers interested in the events of a single node and port:
+// a (node ID, port ID) pair. Per-node events use kGnmiEventAnyPortId.
+using GnmiEventKey = std::pair<uint64, uint32>;
+constexpr uint32 kGnmiEventAnyPortId = 0;
+
+// A family of functions returning the key of an event. Only per-node and
+// per-port events have a key; for other events false is returned.
+inline bool GetGnmiEventKey(const GnmiEvent& event, GnmiEventKey* key) {
+  return false;
+}
+
+template <typename E>
+bool GetGnmiEventKey(const PerNodeGnmiEvent<E>& event, GnmiEventKey* key) {
+  *key = GnmiEventKey(event.GetNodeId(), kGnmiEventAnyPortId);
+  return true;
+}
+
+template <typename E>
+bool GetGnmiEventKey(const PerPortGnmiEvent<E>& event, GnmiEventKey* key) {
+  *key = GnmiEventKey(event.GetNodeId(), event.GetPortId());
+  return true;
+}
+
 template <typename E>
 class PerOpticalPortGnmiEvent : public GnmiEventProcess<E> {
  public:
@@ -582,38 +617,64 @@ using GnmiSetHandler = std::function<::util::Status(
 using GnmiDeleteHandler = std::function<::util::Status(
     const ::gnmi::Path& path, CopyOnWriteChassisConfig* config)>;
 
+// The state shared by the subscriptions of one stream.
+struct GnmiSubscribeStreamState {
+  // Serializes the handlers writing to the stream, which is not thread-safe.
+  // The handlers of different streams run in parallel.
+  absl::Mutex lock;
+  // Runs the timer actions of the subscriptions of the stream that expire in
+  // the same tick together, see GnmiPublisher::HandleTimerBatch().
+  TimerDaemon::BatchRunnerPtr timer_batch_runner;
+};
+
 // A class used to keep information about a subscription.
 class EventHandlerRecord {
  public:
   // Constructor.
-  EventHandlerRecord(const GnmiEventHandler& handler,
-                     GnmiSubscribeStream* stream)
-      : handler_(handler), stream_(stream) {}
+  EventHandlerRecord(
+      const GnmiEventHandler& handler, GnmiSubscribeStream* stream,
+      std::shared_ptr<GnmiSubscribeStreamState> stream_state = nullptr)
+      : handler_(handler),
+        stream_(stream),
+        stream_state_(std::move(stream_state)) {}
   // Destructor.
   virtual ~EventHandlerRecord() {}
 
-  // Generic processing of an event.
+  // Generic processing of an event. Holds the lock of the stream, if any,
+  // while the handler runs.
   ::util::Status operator()(const GnmiEvent& event) const {
-    auto status = handler_(event, stream_);
-    if (status != ::util::OkStatus()) {
-      return status;
-    }
-    return ::util::OkStatus();
+    if (stream_state_ == nullptr) return handler_(event, stream_);
+    absl::MutexLock l(&stream_state_->lock);
+    return handler_(event, stream_);
+  }
+
+  // Processes an event, writing the responses to 'stream' instead of the
+  // stream of this record.
+  ::util::Status operator()(const GnmiEvent& event,
+                            GnmiSubscribeStream* stream) const {
+    return handler_(event, stream);
   }
 
   TimerDaemon::DescriptorPtr* mutable_timer() { return &timer_; }
 
+  GnmiSubscribeStream* stream() const { return stream_; }
+
+  const std::shared_ptr<GnmiSubscribeStreamState>& stream_state() const {
+    return stream_state_;
+  }
+
  protected:
   // The handler functor. Is called every time there is an event to handle.
   GnmiEventHandler handler_;
   // A stream to the client (the controller).
   GnmiSubscribeStream* stream_;
+  // The state shared with the other subscriptions of the stream.
+  std::shared_ptr<GnmiSubscribeStreamState> stream_state_;
   // Not every EventHandler is executed on timer, but some are and this is the
   // handler that is used by the timer sub-system.
   TimerDaemon::DescriptorPtr timer_;
 };
 using EventHandlerRecordPtr = std::weak_ptr<EventHandlerRecord>;
-using SubscriptionHandle = std::shared_ptr<EventHandlerRecord>;
 
 // A base class of the EventHandlerList<event-type> hierarchy. It is needed:
 // - to define a virtual method Process() implemented by each specialized event
@@ -641,12 +702,30 @@ class EventHandlerListBase {
     return ::util::OkStatus();
   }
 
+  // Adds a event handler to a list of handlers interested in this ('E') type of
+  // events, but only in the ones whose key (see GetGnmiEventKey()) is 'key'.
+  ::util::Status Register(const GnmiEventKey& key,
+                          const EventHandlerRecordPtr& record)
+      LOCKS_EXCLUDED(access_lock_) {
+    absl::WriterMutexLock l(&access_lock_);
+    keyed_handlers_[key].insert(record);
+    return ::util::OkStatus();
+  }
+
   // Removes a event handler from a list of handlers interested in this  ('E')
   // type of events.
   ::util::Status UnRegister(const EventHandlerRecordPtr& record)
       LOCKS_EXCLUDED(access_lock_) {
     absl::WriterMutexLock l(&access_lock_);
     handlers_.erase(record);
+    for (auto it = keyed_handlers_.begin(); it != keyed_handlers_.end();) {
+      it->second.erase(record);
+      if (it->second.empty()) {
+        keyed_handlers_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
     return ::util::OkStatus();
   }
 
@@ -655,34 +734,77 @@ class EventHandlerListBase {
     absl::WriterMutexLock l(&access_lock_);
     // To return acurate information remove all expired subscriptions.
     CleanUpInactiveRegistrations();
-    // Return the number of still active registrations.
-    return handlers_.size();
+    // Return the number of still active registrations. A handler registered
+    // with more than one key is counted once.
+    EventHandlerRecordSet all = handlers_;
+    for (auto it = keyed_handlers_.begin(); it != keyed_handlers_.end();) {
+      CleanUpInactiveRegistrations(&it->second);
+      if (it->second.empty()) {
+        keyed_handlers_.erase(it++);
+        continue;
+      }
+      all.insert(it->second.begin(), it->second.end());
+      ++it;
+    }
+    return all.size();
   }
 
  protected:
+  using EventHandlerRecordSet =
+      std::set<EventHandlerRecordPtr, std::owner_less<EventHandlerRecordPtr>>;
+
   // Removes pointers that are expired.
   void CleanUpInactiveRegistrations() EXCLUSIVE_LOCKS_REQUIRED(access_lock_) {
-    std::list<EventHandlerRecordPtr> entries_to_be_removed;
-    for (const auto& entry : handlers_) {
-      if (entry.expired()) {
+    CleanUpInactiveRegistrations(&handlers_);
+  }
+
+  // Removes pointers that are expired from 'handlers'.
+  static void CleanUpInactiveRegistrations(EventHandlerRecordSet* handlers) {
+    for (auto it = handlers->begin(); it != handlers->end();) {
+      if (it->expired()) {
         // The subscription has been silently (without calling UnRegister())
-        // canceled by deleting the handle. Make a note of this record and
-        // then delete it after all entries in handlers_ are processed.
-        entries_to_be_removed.push_back(entry);
+        // canceled by deleting the handle.
+        handlers->erase(it++);
+      } else {
+        ++it;
       }
     }
-    // Remove all subscriptions that have been silently canceled.
-    for (const auto& handler : entries_to_be_removed) {
-      handlers_.erase(handler);
+  }
+
+  // Returns the active handlers interested in an event with the given key, or
+  // in an event without a key if 'key' is nullptr. Each handler is returned
+  // once, even if it has been registered both with and without the key. Only
+  // the registrations that are looked at are cleaned up.
+  std::vector<SubscriptionHandle> GetActiveHandlers(const GnmiEventKey* key)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_) {
+    CleanUpInactiveRegistrations();
+    std::vector<SubscriptionHandle> active;
+    active.reserve(handlers_.size());
+    for (const auto& entry : handlers_) {
+      if (auto handler = entry.lock()) active.push_back(std::move(handler));
+    }
+    if (key == nullptr) return active;
+    auto it = keyed_handlers_.find(*key);
+    if (it == keyed_handlers_.end()) return active;
+    CleanUpInactiveRegistrations(&it->second);
+    for (const auto& entry : it->second) {
+      if (handlers_.count(entry)) continue;
+      if (auto handler = entry.lock()) active.push_back(std::move(handler));
     }
+    if (it->second.empty()) keyed_handlers_.erase(it);
+    return active;
   }
 
   // A Mutex used to guard access to the map of pointers to handlers.
   mutable absl::Mutex access_lock_;
 
   // A set of event handlers that are interested in this ('E') type of events.
-  std::set<EventHandlerRecordPtr, std::owner_less<EventHandlerRecordPtr>>
-      handlers_ GUARDED_BY(access_lock_);
+  EventHandlerRecordSet handlers_ GUARDED_BY(access_lock_);
+
+  // Sets of event handlers that are interested in this ('E') type of events,
+  // but only in the ones with a particular key.
+  absl::flat_hash_map<GnmiEventKey, EventHandlerRecordSet> keyed_handlers_
+      GUARDED_BY(access_lock_);
 };
 
 // A class that keeps track of all event handlers that are interested in
@@ -702,17 +824,13 @@ class EventHandlerList : public EventHandlerListBase {
   // Processes the event.
   // The dispatcher based on the type of the event to be processed selects one
   // specialized event handler list and calls its Process() method. This method.
-  // It goes through the list of registered event handlers and calls each of
-  // them with the 'event' to be processed.
+  // It goes through the list of registered event handlers that are interested
+  // in the event and calls each of them with the 'event' to be processed.
   ::util::Status Process(const GnmiEvent& base_event) override {
-    absl::WriterMutexLock l(&access_lock_);
     if (const E* event = dynamic_cast<const E*>(&base_event)) {
       VLOG(1) << "Handling " << Demangle(typeid(E).name());
-      CleanUpInactiveRegistrations();
-      for (const auto& entry : handlers_) {
-        if (auto handler = entry.lock()) {
-          (*handler)(*event).IgnoreError();
-        }
+      for (const auto& handler : GetHandlers(*event)) {
+        (*handler)(*event).IgnoreError();
       }
     } else {
       // This __really__ should never happen!
@@ -724,6 +842,18 @@ class EventHandlerList : public EventHandlerListBase {
     return ::util::OkStatus();
   }
 
+  // Returns the handlers that are interested in 'event': the ones registered
+  // for all events of this type and the ones registered with the event's key.
+  // The handlers are called without holding the lock, so they can take their
+  // time without blocking registrations.
+  std::vector<SubscriptionHandle> GetHandlers(const E& event)
+      LOCKS_EXCLUDED(access_lock_) {
+    GnmiEventKey key;
+    const bool has_key = GetGnmiEventKey(event, &key);
+    absl::WriterMutexLock l(&access_lock_);
+    return GetActiveHandlers(has_key ? &key : nullptr);
+  }
+
  private:
   // Constructor. Hidden as this class is a singleton.
   EventHandlerList() {}
@@ -739,6 +869,14 @@ template <typename E>
   return EventHandlerList<E>::GetInstance()->Process(*this);
 }
 
+// Implementation of the abstract GnmiEvent::GetHandlers() specialized for each
+// type of event.
+template <typename E>
+std::vector<SubscriptionHandle> GnmiEventProcess<E>::GetHandlers() const {
+  return EventHandlerList<E>::GetInstance()->GetHandlers(
+      static_cast<const E&>(*this));
+}
+
 }  // namespace hal
 }  // namespace stratum
 
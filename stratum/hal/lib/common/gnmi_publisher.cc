@@ -7,13 +7,22 @@
 #include <list>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "gnmi/gnmi.pb.h"
 #include "stratum/glue/gtl/map_util.h"
 #include "stratum/hal/lib/common/channel_writer_wrapper.h"
+#include "stratum/hal/lib/common/data_request_batch.h"
 #include "stratum/hal/lib/common/yang_parse_tree_paths.h"
 
+DEFINE_int32(gnmi_event_dispatch_threads, 1,
+             "Number of threads calling the handlers of gNMI events. With more "
+             "than one thread, the handlers of different subscription streams "
+             "run in parallel. The events sent to one stream keep their "
+             "order.");
+
 namespace stratum {
 namespace hal {
 
@@ -93,22 +102,83 @@ GnmiPublisher::~GnmiPublisher() {}
 
 ::util::Status GnmiPublisher::HandleEvent(
     const GnmiEvent& event, const std::weak_ptr<EventHandlerRecord>& h) {
-  absl::WriterMutexLock l(&access_lock_);
+  absl::ReaderMutexLock l(&access_lock_);
 
   // In order to reference a weak pointer, first it has to be used to create a
   // shared pointer.
   if (std::shared_ptr<EventHandlerRecord> handler = h.lock()) {
+    if (parse_tree_.IsRecordingDataRequests()) {
+      // The first pass of HandleTimerBatch(), the responses carry default
+      // values.
+      InlineGnmiSubscribeStream discard_stream(
+          [](const ::gnmi::SubscribeResponse& msg) { return true; });
+      return (*handler)(event, &discard_stream);
+    }
     RETURN_IF_ERROR((*handler)(event));
   }
   return ::util::OkStatus();
 }
 
+::util::Status GnmiPublisher::HandleTimerBatch(
+    const std::vector<TimerDaemon::DescriptorPtr>& timers) {
+  // A single action gains nothing from being run twice.
+  if (timers.size() == 1) return timers.front()->ExecuteAction();
+
+  // The actions take the lock themselves, so it is not held while they run.
+  // As in HandlePolls(), the first pass records the requests of all the
+  // leaves, the second one is served from the batch.
+  std::unique_ptr<DataRequestBatch> batch;
+  {
+    absl::ReaderMutexLock l(&access_lock_);
+    batch = absl::make_unique<DataRequestBatch>(switch_interface_);
+    parse_tree_.SetDataRequestBatchForThisThread(batch.get());
+  }
+  for (const auto& timer : timers) timer->ExecuteAction().IgnoreError();
+  batch->Execute();
+  ::util::Status status = ::util::OkStatus();
+  for (const auto& timer : timers) {
+    // The other subscriptions are sampled even if one of them fails.
+    ::util::Status timer_status = timer->ExecuteAction();
+    if (status.ok()) status = timer_status;
+  }
+  absl::ReaderMutexLock l(&access_lock_);
+  parse_tree_.SetDataRequestBatchForThisThread(nullptr);
+  return status;
+}
+
 ::util::Status GnmiPublisher::HandlePoll(const SubscriptionHandle& handle) {
   absl::WriterMutexLock l(&access_lock_);
 
   return (*handle)(PollEvent());
 }
 
+::util::Status GnmiPublisher::HandlePolls(
+    const std::vector<SubscriptionHandle>& handles) {
+  absl::WriterMutexLock l(&access_lock_);
+
+  // First, the handlers are run with a batch that records the requests of all
+  // the leaves. Their responses, which carry default values, are dropped. No
+  // value is read from the switch in this pass, the port counters leaves skip
+  // their snapshot until the second pass.
+  DataRequestBatch batch(switch_interface_);
+  InlineGnmiSubscribeStream discard_stream(
+      [](const ::gnmi::SubscribeResponse& msg) { return true; });
+  parse_tree_.SetDataRequestBatchForThisThread(&batch);
+  for (const auto& handle : handles) {
+    (*handle)(PollEvent(), &discard_stream).IgnoreError();
+  }
+  // Then, the recorded requests are retrieved in one go and the handlers are
+  // run again, this time served from the batch.
+  batch.Execute();
+  ::util::Status status = ::util::OkStatus();
+  for (const auto& handle : handles) {
+    status = (*handle)(PollEvent());
+    if (!status.ok()) break;
+  }
+  parse_tree_.SetDataRequestBatchForThisThread(nullptr);
+  return status;
+}
+
 ::util::Status GnmiPublisher::SubscribePeriodic(const Frequency& freq,
                                                 const ::gnmi::Path& path,
                                                 GnmiSubscribeStream* stream,
@@ -122,7 +192,8 @@ GnmiPublisher::~GnmiPublisher() {}
   if (TimerDaemon::RequestPeriodicTimer(
           freq.delay_ms_, freq.period_ms_,
           [weak, this]() { return this->HandleEvent(TimerEvent(), weak); },
-          (*h)->mutable_timer()) != ::util::OkStatus()) {
+          (*h)->mutable_timer(),
+          (*h)->stream_state()->timer_batch_runner) != ::util::OkStatus()) {
     return MAKE_ERROR(ERR_INTERNAL) << "Cannot start timer.";
   }
   // A handler has been successfully found and now it has to be registered in
@@ -185,10 +256,34 @@ GnmiPublisher::~GnmiPublisher() {}
            << ") support this mode!";
   }
   // All good! Save the handler that handles this leaf.
-  h->reset(new EventHandlerRecord((node->*get_handler)(), stream));
+  h->reset(new EventHandlerRecord((node->*get_handler)(), stream,
+                                  GetStreamState(stream)));
   return ::util::OkStatus();
 }
 
+std::shared_ptr<GnmiSubscribeStreamState> GnmiPublisher::GetStreamState(
+    GnmiSubscribeStream* stream) {
+  std::shared_ptr<GnmiSubscribeStreamState> state =
+      stream_states_[stream].lock();
+  if (state == nullptr) {
+    // Drop the entries of the streams that have no subscription left.
+    for (auto it = stream_states_.begin(); it != stream_states_.end();) {
+      if (it->first != stream && it->second.expired()) {
+        stream_states_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    state = std::make_shared<GnmiSubscribeStreamState>();
+    state->timer_batch_runner = std::make_shared<TimerDaemon::BatchRunner>(
+        [this](const std::vector<TimerDaemon::DescriptorPtr>& timers) {
+          return HandleTimerBatch(timers);
+        });
+    stream_states_[stream] = state;
+  }
+  return state;
+}
+
 ::util::Status GnmiPublisher::UnSubscribe(const SubscriptionHandle& h) {
   absl::WriterMutexLock l(&access_lock_);
   // There is no way to match a subscription to a certain type of event.
@@ -231,7 +326,9 @@ GnmiPublisher::UpdateSubscriptionWithTargetSpecificModeSpecification(
 }
 
 void GnmiPublisher::ReadGnmiEvents(
-    const std::unique_ptr<ChannelReader<GnmiEventPtr>>& reader) {
+    const std::unique_ptr<ChannelReader<GnmiEventPtr>>& reader,
+    const std::vector<std::unique_ptr<ChannelWriter<GnmiEventDispatchTask>>>&
+        dispatch_writers) {
   do {
     GnmiEventPtr event_ptr;
     // Block on the next event message from the Channel.
@@ -243,23 +340,92 @@ void GnmiPublisher::ReadGnmiEvents(
       LOG(ERROR) << "Read with infinite timeout failed with ENTRY_NOT_FOUND.";
       continue;
     }
-    // Handle received message.
-    ::util::Status status = HandleChange(*event_ptr);
-    if (status != ::util::OkStatus()) LOG(ERROR) << status;
+    if (dispatch_writers.empty()) {
+      // Handle received message.
+      ::util::Status status = HandleChange(*event_ptr);
+      if (status != ::util::OkStatus()) LOG(ERROR) << status;
+      continue;
+    }
+    // Distribute the handlers among the dispatch threads. All handlers of one
+    // stream go to the same thread.
+    std::vector<GnmiEventDispatchTask> tasks(dispatch_writers.size());
+    for (const auto& handler : event_ptr->GetHandlers()) {
+      size_t index = std::hash<GnmiSubscribeStream*>()(handler->stream()) %
+                     dispatch_writers.size();
+      tasks[index].handlers.push_back(handler);
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      if (tasks[i].handlers.empty()) continue;
+      tasks[i].event = event_ptr;
+      // Blocks if the dispatch thread falls behind.
+      ::util::Status status = dispatch_writers[i]->Write(
+          std::move(tasks[i]), absl::InfiniteDuration());
+      if (!status.ok() && status.error_code() != ERR_CANCELLED) {
+        LOG(ERROR) << status;
+      }
+    }
   } while (true);
 }
 
 void* GnmiPublisher::ThreadReadGnmiEvents(void* arg) {
   CHECK(arg != nullptr);
   // Retrieve arguments.
-  auto* args = reinterpret_cast<ReaderArgs<GnmiEventPtr>*>(arg);
+  auto* args = reinterpret_cast<EventReaderArgs*>(arg);
   GnmiPublisher* manager = args->manager;
   std::unique_ptr<ChannelReader<GnmiEventPtr>> reader = std::move(args->reader);
+  std::vector<std::unique_ptr<ChannelWriter<GnmiEventDispatchTask>>>
+      dispatch_writers = std::move(args->dispatch_writers);
+  delete args;
+  manager->ReadGnmiEvents(reader, dispatch_writers);
+  return nullptr;
+}
+
+void GnmiPublisher::DispatchGnmiEvents(
+    const std::unique_ptr<ChannelReader<GnmiEventDispatchTask>>& reader) {
+  do {
+    GnmiEventDispatchTask task;
+    int code = reader->Read(&task, absl::InfiniteDuration()).error_code();
+    // Exit if the Channel is closed.
+    if (code == ERR_CANCELLED) break;
+    // Read should never time out.
+    if (code == ERR_ENTRY_NOT_FOUND) {
+      LOG(ERROR) << "Read with infinite timeout failed with ENTRY_NOT_FOUND.";
+      continue;
+    }
+    HandleDispatchTask(task);
+  } while (true);
+}
+
+void* GnmiPublisher::ThreadDispatchGnmiEvents(void* arg) {
+  CHECK(arg != nullptr);
+  // Retrieve arguments.
+  auto* args = reinterpret_cast<ReaderArgs<GnmiEventDispatchTask>*>(arg);
+  GnmiPublisher* manager = args->manager;
+  std::unique_ptr<ChannelReader<GnmiEventDispatchTask>> reader =
+      std::move(args->reader);
   delete args;
-  manager->ReadGnmiEvents(reader);
+  manager->DispatchGnmiEvents(reader);
   return nullptr;
 }
 
+void GnmiPublisher::HandleDispatchTask(const GnmiEventDispatchTask& task) {
+  auto handle = [&task]() {
+    for (const auto& h : task.handlers) {
+      // The subscription might have been cancelled after the task was queued.
+      if (std::shared_ptr<EventHandlerRecord> handler = h.lock()) {
+        (*handler)(*task.event).IgnoreError();
+      }
+    }
+  };
+  if (dynamic_cast<const ConfigHasBeenPushedEvent*>(task.event.get())) {
+    absl::WriterMutexLock l(&access_lock_);
+    handle();
+  } else {
+    absl::ReaderMutexLock l(&access_lock_);
+    handle();
+  }
+}
+
 ::util::Status GnmiPublisher::RegisterEventWriter() {
   absl::WriterMutexLock l(&access_lock_);
   // If we have not done that yet, create notification event Channel, register
@@ -271,12 +437,45 @@ void* GnmiPublisher::ThreadReadGnmiEvents(void* arg) {
         ChannelWriter<GnmiEventPtr>::Create(event_channel_));
     RETURN_IF_ERROR(switch_interface_->RegisterEventNotifyWriter(writer));
     RETURN_IF_ERROR(parse_tree_.RegisterEventNotifyWriter(writer));
+    // Create the dispatch threads, if configured, and hand-off their Readers.
+    // Like the reader thread, they exit following the closing of their
+    // Channels in UnregisterEventWriter().
+    const int num_dispatch_threads =
+        FLAGS_gnmi_event_dispatch_threads > 1
+            ? FLAGS_gnmi_event_dispatch_threads
+            : 0;
+    std::vector<std::unique_ptr<ChannelWriter<GnmiEventDispatchTask>>>
+        dispatch_writers;
+    for (int i = 0; i < num_dispatch_threads; ++i) {
+      std::shared_ptr<Channel<GnmiEventDispatchTask>> channel =
+          Channel<GnmiEventDispatchTask>::Create(kMaxGnmiEventDepth);
+      dispatch_channels_.push_back(channel);
+      dispatch_writers.push_back(
+          ChannelWriter<GnmiEventDispatchTask>::Create(channel));
+      pthread_t dispatch_tid;
+      int ret = pthread_create(
+          &dispatch_tid, nullptr, ThreadDispatchGnmiEvents,
+          new ReaderArgs<GnmiEventDispatchTask>{
+              this, ChannelReader<GnmiEventDispatchTask>::Create(channel)});
+      if (ret != 0) {
+        return MAKE_ERROR(ERR_INTERNAL)
+               << "Failed to spawn gNMI event dispatch thread. Err: " << ret
+               << ".";
+      }
+      ret = pthread_detach(dispatch_tid);
+      if (ret != 0) {
+        return MAKE_ERROR(ERR_INTERNAL)
+               << "Failed to detach gNMI event dispatch thread. Err: " << ret
+               << ".";
+      }
+    }
     // Create and hand-off Reader to new reader thread.
     pthread_t event_reader_tid;
     auto reader = ChannelReader<GnmiEventPtr>::Create(event_channel_);
-    int ret =
-        pthread_create(&event_reader_tid, nullptr, ThreadReadGnmiEvents,
-                       new ReaderArgs<GnmiEventPtr>{this, std::move(reader)});
+    int ret = pthread_create(
+        &event_reader_tid, nullptr, ThreadReadGnmiEvents,
+        new EventReaderArgs{this, std::move(reader),
+                            std::move(dispatch_writers)});
     if (ret != 0) {
       return MAKE_ERROR(ERR_INTERNAL)
              << "Failed to spawn gNMI event thread. Err: " << ret << ".";
@@ -308,6 +507,9 @@ void* GnmiPublisher::ThreadReadGnmiEvents(void* arg) {
       APPEND_STATUS_IF_ERROR(status, error);
     }
     event_channel_ = nullptr;
+    // Close the Channels of the dispatch threads, which makes them exit.
+    for (const auto& channel : dispatch_channels_) channel->Close();
+    dispatch_channels_.clear();
     switch_interface_ = nullptr;
   }
 
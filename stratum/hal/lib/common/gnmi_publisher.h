@@ -12,6 +12,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
@@ -98,6 +99,13 @@ class GnmiPublisher {
   virtual ::util::Status HandlePoll(const SubscriptionHandle& handle)
       LOCKS_EXCLUDED(access_lock_);
 
+  // Polls all the given subscriptions, as a gNMI Get does. The values the
+  // leaves need from the switch are retrieved with one RetrieveValue call per
+  // node instead of one per leaf.
+  virtual ::util::Status HandlePolls(
+      const std::vector<SubscriptionHandle>& handles)
+      LOCKS_EXCLUDED(access_lock_);
+
   virtual ::util::Status SubscribePeriodic(const Frequency& freq,
                                            const ::gnmi::Path& path,
                                            GnmiSubscribeStream* stream,
@@ -146,6 +154,23 @@ class GnmiPublisher {
     std::unique_ptr<ChannelReader<T>> reader;
   };
 
+  // The handlers of an event which are executed by one of the dispatch threads.
+  // The handlers are weak pointers, as a subscription can be cancelled, and
+  // its stream freed, while the task is queued.
+  struct GnmiEventDispatchTask {
+    GnmiEventPtr event;
+    std::vector<EventHandlerRecordPtr> handlers;
+  };
+
+  // EventReaderArgs encapsulates the arguments for the event reader thread.
+  struct EventReaderArgs {
+    GnmiPublisher* manager;
+    std::unique_ptr<ChannelReader<GnmiEventPtr>> reader;
+    // Writers to the channels of the dispatch threads, if any.
+    std::vector<std::unique_ptr<ChannelWriter<GnmiEventDispatchTask>>>
+        dispatch_writers;
+  };
+
   // A family of helper methods that simplify registration of event handlers
   // with correct event handler list.
   template <typename E>
@@ -154,11 +179,27 @@ class GnmiPublisher {
   }
 
   // An internal method that handles an event in the context of particular event
-  // handler.
+  // handler. Is called by the TimerDaemon worker threads. Runs under a reader
+  // lock, so that the timer actions of different streams run in parallel.
+  // While the thread records the requests of a DataRequestBatch, the responses
+  // are dropped instead of being written to the stream.
   ::util::Status HandleEvent(const GnmiEvent& event,
                              const EventHandlerRecordPtr& h)
       LOCKS_EXCLUDED(access_lock_);
 
+  // Runs the actions of the given timers of one stream, retrieving the values
+  // all their leaves need from the switch with one RetrieveValue call per
+  // node. Each action is run twice, first to record the requests of its
+  // leaves, see HandleEvent().
+  ::util::Status HandleTimerBatch(
+      const std::vector<TimerDaemon::DescriptorPtr>& timers)
+      LOCKS_EXCLUDED(access_lock_);
+
+  // Returns the state shared by the subscriptions of 'stream', creating it if
+  // the stream has no other subscription.
+  std::shared_ptr<GnmiSubscribeStreamState> GetStreamState(
+      GnmiSubscribeStream* stream) EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
   // A generic method handling all types of subscriptions. Requires long list of
   // parameters, so, it has been hidden here and specialized methods calling it
   // have been exposed as public interface.
@@ -168,15 +209,36 @@ class GnmiPublisher {
                            GnmiSubscribeStream* stream, SubscriptionHandle* h)
       LOCKS_EXCLUDED(access_lock_);
 
-  // A handler of events received over the event_channel_ channel.
+  // A handler of events received over the event_channel_ channel. If there are
+  // dispatch threads, the handlers of every event are distributed among them
+  // by stream, so that the events sent to a stream keep their order. Otherwise
+  // the events are handled by the calling thread.
   void ReadGnmiEvents(
-      const std::unique_ptr<ChannelReader<GnmiEventPtr>>& reader)
-      LOCKS_EXCLUDED(access_lock_);
+      const std::unique_ptr<ChannelReader<GnmiEventPtr>>& reader,
+      const std::vector<std::unique_ptr<ChannelWriter<GnmiEventDispatchTask>>>&
+          dispatch_writers) LOCKS_EXCLUDED(access_lock_);
 
   // A code executed by the thread waiting for events transmitted over
   // the event_channel_ channel.
   static void* ThreadReadGnmiEvents(void* arg) LOCKS_EXCLUDED(access_lock_);
 
+  // A handler of the tasks received over one of the dispatch_channels_.
+  void DispatchGnmiEvents(
+      const std::unique_ptr<ChannelReader<GnmiEventDispatchTask>>& reader)
+      LOCKS_EXCLUDED(access_lock_);
+
+  // A code executed by the dispatch threads.
+  static void* ThreadDispatchGnmiEvents(void* arg)
+      LOCKS_EXCLUDED(access_lock_);
+
+  // Calls the handlers of a task which are still subscribed. Only the
+  // ConfigHasBeenPushedEvent modifies the parse tree, all other events are
+  // handled under a reader lock, so that the dispatch threads can run in
+  // parallel. The handlers hold the lock of their stream, as timer actions
+  // might write to the same stream.
+  void HandleDispatchTask(const GnmiEventDispatchTask& task)
+      LOCKS_EXCLUDED(access_lock_);
+
   // A pointer to implementation of the Switch Interface - the API used to
   // communicate with the switch.
   SwitchInterface* switch_interface_ GUARDED_BY(access_lock_);
@@ -188,10 +250,21 @@ class GnmiPublisher {
   // that node.
   YangParseTree parse_tree_ GUARDED_BY(access_lock_);
 
+  // The state shared by the subscriptions of each stream. An entry expires
+  // when the last subscription of its stream is released.
+  absl::flat_hash_map<GnmiSubscribeStream*,
+                      std::weak_ptr<GnmiSubscribeStreamState>>
+      stream_states_ GUARDED_BY(access_lock_);
+
   // Channel for receiving transceiver events from the SwitchInterface.
   std::shared_ptr<Channel<GnmiEventPtr>> event_channel_
       GUARDED_BY(access_lock_);
 
+  // Channels of the dispatch threads. Empty if the events are handled by the
+  // event reader thread.
+  std::vector<std::shared_ptr<Channel<GnmiEventDispatchTask>>>
+      dispatch_channels_ GUARDED_BY(access_lock_);
+
   // Special event handler that is called when a ConfigHasBeenPushedEvent event
   // is received.
   std::function<::util::Status(const GnmiEvent&, GnmiSubscribeStream*)>
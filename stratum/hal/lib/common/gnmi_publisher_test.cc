@@ -4,6 +4,12 @@
 
 #include "stratum/hal/lib/common/gnmi_publisher.h"
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "gnmi/gnmi.pb.h"
@@ -11,13 +17,17 @@
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/common/subscribe_reader_writer_mock.h"
 #include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/lib/timer_daemon.h"
 #include "stratum/lib/utils.h"
 
+DECLARE_int32(gnmi_event_dispatch_threads);
+
 namespace stratum {
 namespace hal {
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::Invoke;
 using ::testing::Not;
@@ -97,7 +107,7 @@ class SubscriptionTestBase {
                << node.AllSubtreeLeavesSupportOnTimer() << " "
                << node.supports_on_timer_;
     for (const auto& entry : node.children_) {
-      PrintNodeWithOnTimer(entry.second, prefix + " ");
+      PrintNodeWithOnTimer(*entry.second, prefix + " ");
     }
   }
 
@@ -111,8 +121,19 @@ class SubscriptionTestBase {
                << node.AllSubtreeLeavesSupportOnChange() << " "
                << node.supports_on_timer_;
     for (const auto& entry : node.children_) {
-      PrintNodeWithOnChange(entry.second, prefix + " ");
+      PrintNodeWithOnChange(*entry.second, prefix + " ");
+    }
+  }
+
+  // Hands the handlers of 'event' to a dispatch task, as the event reader
+  // thread does, and returns a function which handles the task later.
+  std::function<void()> QueueDispatchTask(const GnmiEventPtr& event) {
+    auto task = std::make_shared<GnmiPublisher::GnmiEventDispatchTask>();
+    task->event = event;
+    for (const auto& handler : event->GetHandlers()) {
+      task->handlers.push_back(handler);
     }
+    return [this, task]() { gnmi_publisher_->HandleDispatchTask(*task); };
   }
 
   void PrintPath(const ::gnmi::Path& path) {
@@ -342,6 +363,203 @@ TEST_F(SubscriptionTest, PromisedOnPollOnlyLeafsAreSupported) {
       &stream, &h));
 }
 
+TEST_F(SubscriptionTest, OnChangeEventIsSentToSubscribersOfItsPortOnly) {
+  SubscribeReaderWriterMock stream1;
+  SubscribeReaderWriterMock stream2;
+  SubscriptionHandle h1;
+  SubscriptionHandle h2;
+  EXPECT_OK(gnmi_publisher_->SubscribeOnChange(
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")(),
+      &stream1, &h1));
+  EXPECT_OK(gnmi_publisher_->SubscribeOnChange(
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/2")(
+          "state")("admin-status")(),
+      &stream2, &h2));
+  // The subscriptions are registered for their own port only.
+  EXPECT_EQ(1, EventHandlerList<PortAdminStateChangedEvent>::GetInstance()
+                   ->GetHandlers(PortAdminStateChangedEvent(
+                       1, 1, ADMIN_STATE_ENABLED))
+                   .size());
+
+  EXPECT_CALL(stream1, Write(_, _)).WillOnce(Return(true));
+  EXPECT_CALL(stream2, Write(_, _)).Times(0);
+  EXPECT_OK(gnmi_publisher_->HandleChange(
+      PortAdminStateChangedEvent(1, 1, ADMIN_STATE_ENABLED)));
+  // Events of other nodes are not sent either.
+  EXPECT_OK(gnmi_publisher_->HandleChange(
+      PortAdminStateChangedEvent(2, 2, ADMIN_STATE_ENABLED)));
+}
+
+TEST_F(SubscriptionTest, OnChangeEventsAreHandledByDispatchThreads) {
+  FLAGS_gnmi_event_dispatch_threads = 4;
+  std::shared_ptr<WriterInterface<GnmiEventPtr>> writer;
+  EXPECT_CALL(switch_mock_, RegisterEventNotifyWriter(_))
+      .WillOnce(DoAll(SaveArg<0>(&writer), Return(::util::OkStatus())));
+  EXPECT_CALL(switch_mock_, UnregisterEventNotifyWriter())
+      .WillOnce(Return(::util::OkStatus()));
+  ASSERT_OK(gnmi_publisher_->RegisterEventWriter());
+  ASSERT_NE(nullptr, writer);
+
+  // Every stream records the values it receives.
+  absl::Mutex lock;
+  std::vector<std::string> values1;
+  std::vector<std::string> values2;
+  auto record = [&lock](std::vector<std::string>* values) {
+    return [&lock, values](const ::gnmi::SubscribeResponse& resp,
+                           ::grpc::WriteOptions options) {
+      absl::MutexLock l(&lock);
+      values->push_back(resp.update().update(0).val().string_val());
+      return true;
+    };
+  };
+  SubscribeReaderWriterMock stream1;
+  SubscribeReaderWriterMock stream2;
+  EXPECT_CALL(stream1, Write(_, _)).WillRepeatedly(Invoke(record(&values1)));
+  EXPECT_CALL(stream2, Write(_, _)).WillRepeatedly(Invoke(record(&values2)));
+  SubscriptionHandle h1;
+  SubscriptionHandle h2;
+  EXPECT_OK(gnmi_publisher_->SubscribeOnChange(
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")(),
+      &stream1, &h1));
+  EXPECT_OK(gnmi_publisher_->SubscribeOnChange(
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/2")(
+          "state")("admin-status")(),
+      &stream2, &h2));
+
+  EXPECT_TRUE(writer->Write(GnmiEventPtr(
+      new PortAdminStateChangedEvent(1, 1, ADMIN_STATE_ENABLED))));
+  EXPECT_TRUE(writer->Write(GnmiEventPtr(
+      new PortAdminStateChangedEvent(1, 2, ADMIN_STATE_DISABLED))));
+  EXPECT_TRUE(writer->Write(GnmiEventPtr(
+      new PortAdminStateChangedEvent(1, 1, ADMIN_STATE_DISABLED))));
+  EXPECT_TRUE(writer->Write(GnmiEventPtr(
+      new PortAdminStateChangedEvent(1, 1, ADMIN_STATE_ENABLED))));
+  {
+    absl::MutexLock l(&lock);
+    auto all_received = [&values1, &values2]() {
+      return values1.size() == 3 && values2.size() == 1;
+    };
+    EXPECT_TRUE(lock.AwaitWithTimeout(absl::Condition(&all_received),
+                                      absl::Seconds(10)));
+    // The events sent to one stream keep their order.
+    EXPECT_THAT(values1, ElementsAre("UP", "DOWN", "UP"));
+    EXPECT_THAT(values2, ElementsAre("DOWN"));
+  }
+
+  EXPECT_OK(gnmi_publisher_->UnregisterEventWriter());
+  FLAGS_gnmi_event_dispatch_threads = 1;
+}
+
+TEST_F(SubscriptionTest, TimerActionsOfDifferentStreamsRunInParallel) {
+  ASSERT_OK(TimerDaemon::Start());
+  // The value of a leaf is only retrieved once the timer action of the other
+  // stream is retrieving its value too.
+  absl::Mutex lock;
+  int running = 0;
+  int max_running = 0;
+  auto both_running = [&max_running]() { return max_running >= 2; };
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillRepeatedly(WithArgs<2>(
+          Invoke([&](WriterInterface<DataResponse>* w) -> ::util::Status {
+            absl::MutexLock l(&lock);
+            max_running = std::max(max_running, ++running);
+            lock.AwaitWithTimeout(absl::Condition(&both_running),
+                                  absl::Seconds(10));
+            --running;
+            DataResponse resp;
+            resp.mutable_admin_status()->set_state(ADMIN_STATE_ENABLED);
+            w->Write(resp);
+            return ::util::OkStatus();
+          })));
+  SubscribeReaderWriterMock stream1;
+  SubscribeReaderWriterMock stream2;
+  EXPECT_CALL(stream1, Write(_, _)).WillRepeatedly(Return(true));
+  EXPECT_CALL(stream2, Write(_, _)).WillRepeatedly(Return(true));
+  SubscriptionHandle h1;
+  SubscriptionHandle h2;
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      Periodic(10),
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")(),
+      &stream1, &h1));
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      Periodic(10),
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/2")(
+          "state")("admin-status")(),
+      &stream2, &h2));
+  {
+    absl::MutexLock l(&lock);
+    EXPECT_TRUE(lock.AwaitWithTimeout(absl::Condition(&both_running),
+                                      absl::Seconds(10)));
+  }
+
+  // Releasing the handles cancels the timers.
+  EXPECT_OK(gnmi_publisher_->UnSubscribe(h1));
+  EXPECT_OK(gnmi_publisher_->UnSubscribe(h2));
+  h1.reset();
+  h2.reset();
+  EXPECT_OK(TimerDaemon::Stop());
+}
+
+TEST_F(SubscriptionTest, TimerActionsOfStreamAreBatched) {
+  SubscribeReaderWriterMock stream;
+  SubscriptionHandle h1;
+  SubscriptionHandle h2;
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      Periodic(1000),
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")(),
+      &stream, &h1));
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      Periodic(1000),
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/2")(
+          "state")("admin-status")(),
+      &stream, &h2));
+  // The subscriptions of a stream share its batch runner.
+  ASSERT_NE(nullptr, h1->stream_state()->timer_batch_runner);
+  EXPECT_EQ(h1->stream_state()->timer_batch_runner,
+            h2->stream_state()->timer_batch_runner);
+
+  // The values of both leaves are retrieved with one call, and each leaf is
+  // written to the stream once.
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillOnce(Invoke([](uint64 node_id, const DataRequest& req,
+                          WriterInterface<DataResponse>* w,
+                          std::vector<::util::Status>* details) {
+        EXPECT_EQ(2, req.requests_size());
+        for (int i = 0; i < req.requests_size(); ++i) {
+          DataResponse resp;
+          resp.mutable_admin_status()->set_state(ADMIN_STATE_ENABLED);
+          w->Write(resp);
+        }
+        return ::util::OkStatus();
+      }));
+  EXPECT_CALL(stream, Write(_, _)).Times(2).WillRepeatedly(Return(true));
+  EXPECT_OK((*h1->stream_state()->timer_batch_runner)(
+      {*h1->mutable_timer(), *h2->mutable_timer()}));
+}
+
+TEST_F(SubscriptionTest, QueuedEventIsNotSentToCancelledSubscription) {
+  SubscribeReaderWriterMock stream;
+  SubscriptionHandle h;
+  EXPECT_OK(gnmi_publisher_->SubscribeOnChange(
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")(),
+      &stream, &h));
+  std::function<void()> handle_queued_task = QueueDispatchTask(
+      GnmiEventPtr(new PortAdminStateChangedEvent(1, 1, ADMIN_STATE_ENABLED)));
+
+  // The subscription is cancelled, as the gNMI service does when the stream is
+  // closed, while the event waits for a dispatch thread.
+  EXPECT_OK(gnmi_publisher_->UnSubscribe(h));
+  h.reset();
+
+  EXPECT_CALL(stream, Write(_, _)).Times(0);
+  handle_queued_task();
+}
+
 // All remaining paths support all modes and can be tested by this parametrized
 // test that takes the path as a parameter.
 class SubscriptionSupportedPathsTest
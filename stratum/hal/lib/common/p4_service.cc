@@ -23,6 +23,7 @@
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/common/server_writer_wrapper.h"
 #include "stratum/lib/channel/channel.h"
+#include "stratum/lib/channel/lock_free_channel.h"
 #include "stratum/lib/macros.h"
 #include "stratum/lib/utils.h"
 #include "stratum/public/lib/error.h"
@@ -33,19 +34,43 @@ DEFINE_string(forwarding_pipeline_configs_file,
               "pushed to the switch. This file is updated whenever "
               "ForwardingPipelineConfig proto for switching node is added or "
               "modified.");
-DEFINE_string(write_req_log_file, "/var/log/stratum/p4_writes.pb.txt",
-              "The log file for all the individual write request updates and "
-              "the corresponding result. The format for each line is: "
-              "<timestamp>;<node_id>;<update proto>;<status>.");
-DEFINE_string(read_req_log_file, "/var/log/stratum/p4_reads.pb.txt",
-              "The log file for all the individual read request and "
-              "the corresponding result. The format for each line is: "
-              "<timestamp>;<node_id>;<request proto>;<status>.");
+DEFINE_string(write_req_log_file, "/var/log/stratum/p4_writes.pb.bin",
+              "The binary journal file for all the write requests and the "
+              "corresponding per-update results. The file is a sequence of "
+              "length-delimited P4RequestJournalEntry protos. Empty to "
+              "disable.");
+DEFINE_string(read_req_log_file, "/var/log/stratum/p4_reads.pb.bin",
+              "The binary journal file for all the read requests and the "
+              "corresponding per-entity results. The file is a sequence of "
+              "length-delimited P4RequestJournalEntry protos. Empty to "
+              "disable.");
+DEFINE_int32(req_log_queue_size, 4096,
+             "Max number of requests waiting to be written to a request "
+             "journal file. Requests are dropped from the journal when the "
+             "queue is full.");
+DEFINE_int64(req_log_max_file_size_bytes, 64 * 1024 * 1024,
+             "Size after which a request journal file is rotated.");
+DEFINE_int32(req_log_max_rotated_files, 4,
+             "Number of rotated request journal files to keep.");
+DEFINE_bool(req_log_use_mmap, false,
+            "If true, request journal files are preallocated and written "
+            "through a memory mapping instead of write() calls.");
 DEFINE_int32(max_num_controllers_per_node, 5,
              "Max number of controllers that can manage a node.");
 DEFINE_int32(max_num_controller_connections, 20,
              "Max number of active/inactive streaming connections from outside "
              "controllers (for all of the nodes combined).");
+DEFINE_int32(stream_channel_send_queue_size, 1024,
+             "Max number of stream messages waiting to be sent to a "
+             "controller. Arbitration updates are always queued.");
+DEFINE_string(stream_channel_packet_in_drop_policy, "drop-oldest",
+              "What to drop when a PacketIn does not fit on the full send "
+              "queue of a controller: 'drop-oldest' drops the oldest queued "
+              "PacketIn, 'drop-newest' drops the new one.");
+DEFINE_string(stream_channel_digest_drop_policy, "drop-newest",
+              "What to drop when a digest list does not fit on the full send "
+              "queue of a controller: 'drop-oldest' drops the oldest queued "
+              "digest list, 'drop-newest' drops the new one.");
 
 namespace stratum {
 namespace hal {
@@ -222,70 +247,53 @@ namespace {
                         from.SerializeAsString());
 }
 
-// Helper to facilitate logging the write requests to the desired log file.
-void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
-                     const std::vector<::util::Status>& results,
-                     const absl::Time timestamp) {
-  if (FLAGS_write_req_log_file.empty()) {
-    return;
-  }
-  if (results.empty()) {
-    // Nothing to log as the switch interface did not fill in any error details.
-    // TODO(max): Consider logging the requests with the overall status in this
-    //            case. But keep in mind that LogWriteRequest will not be called
-    //            for auth errors or invalid device IDs.
-    return;
-  }
-  if (results.size() != req.updates_size()) {
-    LOG(ERROR) << "Size mismatch: " << results.size()
-               << " != " << req.updates_size() << ". Did not log anything!";
-    return;
-  }
-  std::string msg = "";
-  std::string ts =
-      absl::FormatTime("%Y-%m-%d %H:%M:%E6S", timestamp, absl::LocalTimeZone());
-  for (size_t i = 0; i < results.size(); ++i) {
-    absl::StrAppend(&msg, ts, ";", node_id, ";",
-                    req.updates(i).ShortDebugString(), ";",
-                    results[i].error_message(), "\n");
+// Helper to create the request journal for the given file. Returns nullptr if
+// the path is empty or the journal could not be created.
+std::unique_ptr<P4RequestJournal> CreateRequestJournal(
+    const std::string& path) {
+  if (path.empty()) return nullptr;
+  P4RequestJournal::Options options;
+  options.queue_capacity = FLAGS_req_log_queue_size;
+  options.max_file_size_bytes = FLAGS_req_log_max_file_size_bytes;
+  options.max_num_rotated_files = FLAGS_req_log_max_rotated_files;
+  options.use_mmap = FLAGS_req_log_use_mmap;
+  auto ret = P4RequestJournal::CreateInstance(path, options);
+  if (!ret.ok()) {
+    LOG(ERROR) << "Failed to create the request journal " << path << ": "
+               << ret.status().error_message();
+    return nullptr;
   }
-  ::util::Status status =
-      WriteStringToFile(msg, FLAGS_write_req_log_file, /*append=*/true);
-  LOG_IF_EVERY_N(ERROR, !status.ok(), 50)
-      << "Failed to log the write request: " << status.error_message();
+  return ret.ConsumeValueOrDie();
 }
 
-// Helper to facilitate logging the read requests to the desired log file.
-void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
-                    const std::vector<::util::Status>& results,
-                    const absl::Time timestamp) {
-  if (FLAGS_read_req_log_file.empty()) {
-    return;
-  }
-  if (results.empty()) {
-    // Nothing to log as the switch interface did not fill in any error details.
-    // TODO(max): Consider logging the requests with the overall status in this
-    //            case. But keep in mind that LogReadRequest will not be called
-    //            for auth errors or invalid device IDs.
-    return;
-  }
-  if (results.size() != req.entities_size()) {
-    LOG(ERROR) << "Size mismatch: " << results.size()
-               << " != " << req.entities_size() << ". Did not log anything!";
-    return;
-  }
-  std::string msg = "";
-  std::string ts =
-      absl::FormatTime("%Y-%m-%d %H:%M:%E6S", timestamp, absl::LocalTimeZone());
-  for (size_t i = 0; i < results.size(); ++i) {
-    absl::StrAppend(&msg, ts, ";", node_id, ";",
-                    req.entities(i).ShortDebugString(), ";",
-                    results[i].error_message(), "\n");
+// Helper to parse a stream channel drop policy flag. Falls back to the given
+// default policy if the flag value is invalid.
+p4runtime::SdnConnection::DropPolicy ParseDropPolicy(
+    const std::string& flag,
+    p4runtime::SdnConnection::DropPolicy default_policy) {
+  if (flag == "drop-oldest") {
+    return p4runtime::SdnConnection::DropPolicy::kDropOldest;
   }
-  ::util::Status status =
-      WriteStringToFile(msg, FLAGS_read_req_log_file, /*append=*/true);
-  LOG_IF_EVERY_N(ERROR, !status.ok(), 50)
-      << "Failed to log the read request: " << status.error_message();
+  if (flag == "drop-newest") {
+    return p4runtime::SdnConnection::DropPolicy::kDropNewest;
+  }
+  LOG(ERROR) << "Invalid stream channel drop policy '" << flag << "'.";
+  return default_policy;
+}
+
+// Helper to create the send queue options of a stream channel from the flags.
+p4runtime::SdnConnection::SendQueueOptions GetSendQueueOptions() {
+  p4runtime::SdnConnection::SendQueueOptions options;
+  options.max_size = FLAGS_stream_channel_send_queue_size;
+  auto& packet_in_policy =
+      options.drop_policies[::p4::v1::StreamMessageResponse::kPacket];
+  packet_in_policy = ParseDropPolicy(FLAGS_stream_channel_packet_in_drop_policy,
+                                     packet_in_policy);
+  auto& digest_policy =
+      options.drop_policies[::p4::v1::StreamMessageResponse::kDigest];
+  digest_policy =
+      ParseDropPolicy(FLAGS_stream_channel_digest_drop_policy, digest_policy);
+  return options;
 }
 
 // Helper function to generate a StreamMessageResponse from a failed Status.
@@ -335,6 +343,10 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
   // Verify the request comes from the primary connection.
   RETURN_IF_GRPC_ERROR(IsWritePermitted(req->device_id(), *req));
 
+  // Wait for the earlier requests of the same role. The turn is held until
+  // the request is journaled, so the journal keeps the order within a role.
+  auto turn = role_write_sequencer_.Acquire(node_id, req->role());
+
   std::vector<::util::Status> results = {};
   absl::Time timestamp = absl::Now();
   ::util::Status status =
@@ -344,8 +356,9 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
                << ": " << status.error_message();
   }
 
-  // Log debug info for future debugging.
-  LogWriteRequest(node_id, *req, results, timestamp);
+  // Journal the request for future debugging.
+  P4RequestJournal* journal = GetWriteRequestJournal();
+  if (journal) journal->AppendWriteRequest(node_id, *req, results, timestamp);
 
   return ToGrpcStatus(status, results);
 }
@@ -397,8 +410,11 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
                << ": " << status.error_message();
   }
 
-  // Log debug info for future debugging.
-  LogReadRequest(node_id, *original_req, details, timestamp);
+  // Journal the request for future debugging.
+  P4RequestJournal* journal = GetReadRequestJournal();
+  if (journal) {
+    journal->AppendReadRequest(node_id, *original_req, details, timestamp);
+  }
 
   return ToGrpcStatus(status, details);
 }
@@ -582,8 +598,8 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
   }
 
   // We create a unique SDN connection object for every active connection.
-  auto sdn_connection =
-      absl::make_unique<p4runtime::SdnConnection>(context, stream);
+  auto sdn_connection = absl::make_unique<p4runtime::SdnConnection>(
+      context, stream, GetSendQueueOptions());
 
   // The ID of the node this stream channel corresponds to. This is MUST NOT
   // change after it is set for the first time.
@@ -715,7 +731,7 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
     // an RX response writer for it. If the node_id is invalid, registration
     // will fail.
     std::shared_ptr<Channel<::p4::v1::StreamMessageResponse>> channel =
-        Channel<::p4::v1::StreamMessageResponse>::Create(128);
+        LockFreeChannel<::p4::v1::StreamMessageResponse>::Create(128);
     // Create the writer and register with the SwitchInterface.
     auto writer =
         std::make_shared<ChannelWriterWrapper<::p4::v1::StreamMessageResponse>>(
@@ -842,6 +858,20 @@ p4::v1::ReadRequest P4Service::ExpandWildcardsInReadRequest(
   return it->second.ExpandWildcardsInReadRequest(req, p4info);
 }
 
+P4RequestJournal* P4Service::GetWriteRequestJournal() {
+  absl::call_once(write_req_journal_once_, [this]() {
+    write_req_journal_ = CreateRequestJournal(FLAGS_write_req_log_file);
+  });
+  return write_req_journal_.get();
+}
+
+P4RequestJournal* P4Service::GetReadRequestJournal() {
+  absl::call_once(read_req_journal_once_, [this]() {
+    read_req_journal_ = CreateRequestJournal(FLAGS_read_req_log_file);
+  });
+  return read_req_journal_.get();
+}
+
 void* P4Service::StreamResponseReceiveThreadFunc(void* arg) {
   auto* args =
       reinterpret_cast<ReaderArgs<::p4::v1::StreamMessageResponse>*>(arg);
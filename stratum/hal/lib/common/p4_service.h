@@ -14,6 +14,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/numeric/int128.h"
@@ -26,8 +27,10 @@
 #include "stratum/hal/lib/common/channel_writer_wrapper.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/error_buffer.h"
+#include "stratum/hal/lib/common/role_write_sequencer.h"
 #include "stratum/hal/lib/common/switch_interface.h"
 #include "stratum/hal/lib/p4/forwarding_pipeline_configs.pb.h"
+#include "stratum/hal/lib/p4/p4_request_journal.h"
 #include "stratum/lib/p4runtime/sdn_controller_manager.h"
 #include "stratum/lib/security/auth_policy_checker.h"
 
@@ -179,6 +182,12 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
       const ::p4::config::v1::P4Info& p4info) const
       LOCKS_EXCLUDED(controller_lock_);
 
+  // Return the journals for Write and Read requests. The journals are created
+  // on first use. Return nullptr if journaling is disabled or the journal
+  // could not be created.
+  P4RequestJournal* GetWriteRequestJournal();
+  P4RequestJournal* GetReadRequestJournal();
+
   // Thread function for handling stream response RX.
   static void* StreamResponseReceiveThreadFunc(void* arg)
       LOCKS_EXCLUDED(controller_lock_);
@@ -240,6 +249,18 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   std::unique_ptr<ForwardingPipelineConfigs> forwarding_pipeline_configs_
       GUARDED_BY(config_lock_);
 
+  // Orders the Write requests of every role. Requests of the same role are
+  // written one at a time in arrival order, requests of different roles
+  // concurrently.
+  RoleWriteSequencer role_write_sequencer_;
+
+  // Journals of the Write and Read requests, created once on first use. The
+  // journals write the requests to their files in the background.
+  absl::once_flag write_req_journal_once_;
+  std::unique_ptr<P4RequestJournal> write_req_journal_;
+  absl::once_flag read_req_journal_once_;
+  std::unique_ptr<P4RequestJournal> read_req_journal_;
+
   // Determines the mode of operation:
   // - OPERATION_MODE_STANDALONE: when Stratum stack runs independently and
   // therefore needs to do all the SDK initialization itself.
@@ -5,12 +5,15 @@
 #include "stratum/hal/lib/common/p4_service.h"
 
 #include <memory>
+#include <string>
 #include <tuple>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/numeric/int128.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "google/rpc/code.pb.h"
@@ -21,6 +24,7 @@
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/common/error_buffer.h"
 #include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/hal/lib/p4/p4_request_journal.h"
 #include "stratum/lib/macros.h"
 #include "stratum/lib/p4runtime/stream_message_reader_writer_mock.h"
 #include "stratum/lib/security/auth_policy_checker_mock.h"
@@ -78,8 +82,8 @@ class P4ServiceTest
     FLAGS_max_num_controller_connections = 20;
     FLAGS_forwarding_pipeline_configs_file =
         FLAGS_test_tmpdir + "/forwarding_pipeline_configs_file.pb.txt";
-    FLAGS_write_req_log_file = FLAGS_test_tmpdir + "/write_req_log_fil.csv";
-    FLAGS_read_req_log_file = FLAGS_test_tmpdir + "/read_req_log_fil.csv";
+    FLAGS_write_req_log_file = FLAGS_test_tmpdir + "/write_req_log_file.bin";
+    FLAGS_read_req_log_file = FLAGS_test_tmpdir + "/read_req_log_file.bin";
     // Before starting the tests, remove the read and write req file if exists.
     if (PathExists(FLAGS_write_req_log_file)) {
       ASSERT_OK(RemoveFile(FLAGS_write_req_log_file));
@@ -91,6 +95,24 @@ class P4ServiceTest
 
   void TearDown() override { server_->Shutdown(); }
 
+  // Waits until the request journals of the service have been written and
+  // returns the entries of the journal file at the given path.
+  std::vector<P4RequestJournalEntry> ReadRequestJournal(
+      const std::string& path) {
+    for (auto* journal : {p4_service_->write_req_journal_.get(),
+                          p4_service_->read_req_journal_.get()}) {
+      if (journal) EXPECT_OK(journal->Flush(absl::Seconds(10)));
+    }
+    std::vector<P4RequestJournalEntry> entries;
+    EXPECT_OK(P4RequestJournal::ReadEntries(
+        path,
+        [&entries](const P4RequestJournalEntry& entry) -> ::util::Status {
+          entries.push_back(entry);
+          return ::util::OkStatus();
+        }));
+    return entries;
+  }
+
   void OnPacketReceive(const ::p4::v1::PacketIn& packet) {
     ::p4::v1::StreamMessageResponse resp;
     *resp.mutable_packet() = packet;
@@ -769,9 +791,10 @@ TEST_P(P4ServiceTest, WriteSuccess) {
   EXPECT_TRUE(status.ok());
   EXPECT_TRUE(status.error_message().empty());
   EXPECT_TRUE(status.error_details().empty());
-  std::string s;
-  ASSERT_OK(ReadFileToString(FLAGS_write_req_log_file, &s));
-  EXPECT_THAT(s, HasSubstr(req.updates(0).ShortDebugString()));
+  auto entries = ReadRequestJournal(FLAGS_write_req_log_file);
+  ASSERT_EQ(1U, entries.size());
+  EXPECT_EQ(kNodeId1, entries[0].node_id());
+  EXPECT_THAT(entries[0].write_request(), EqualsProto(req));
 }
 
 TEST_P(P4ServiceTest, WriteSuccessForNoUpdatesToWrite) {
@@ -892,10 +915,14 @@ TEST_P(P4ServiceTest, WriteFailureWhenWriteForwardingEntriesFails) {
   EXPECT_EQ(kOperErrorMsg, detail.message());
   const auto& errors = error_buffer_->GetErrors();
   EXPECT_TRUE(errors.empty());
-  std::string s;
-  ASSERT_OK(ReadFileToString(FLAGS_write_req_log_file, &s));
-  EXPECT_THAT(s, HasSubstr(req.updates(0).ShortDebugString()));
-  EXPECT_THAT(s, HasSubstr(req.updates(1).ShortDebugString()));
+  auto entries = ReadRequestJournal(FLAGS_write_req_log_file);
+  ASSERT_EQ(1U, entries.size());
+  EXPECT_EQ(kNodeId1, entries[0].node_id());
+  EXPECT_THAT(entries[0].write_request(), EqualsProto(req));
+  ASSERT_EQ(2, entries[0].results_size());
+  EXPECT_EQ(ERR_SUCCESS, entries[0].results(0).error_code());
+  EXPECT_EQ(ERR_TABLE_FULL, entries[0].results(1).error_code());
+  EXPECT_EQ(kOperErrorMsg, entries[0].results(1).error_message());
 }
 
 TEST_P(P4ServiceTest, WriteFailureForAuthError) {
@@ -1041,9 +1068,9 @@ TEST_P(P4ServiceTest, ReadSuccess) {
   ASSERT_FALSE(reader->Read(&resp));
   ::grpc::Status status = reader->Finish();
   EXPECT_TRUE(status.ok());
-  std::string s;
-  ASSERT_OK(ReadFileToString(FLAGS_read_req_log_file, &s));
-  EXPECT_THAT(s, HasSubstr(req.entities(0).ShortDebugString()));
+  auto entries = ReadRequestJournal(FLAGS_read_req_log_file);
+  ASSERT_EQ(1U, entries.size());
+  EXPECT_THAT(entries[0].read_request(), EqualsProto(req));
 }
 
 TEST_P(P4ServiceTest, ReadSuccessForNoEntitiesToRead) {
@@ -1110,9 +1137,9 @@ TEST_P(P4ServiceTest, ReadSuccessForRoleWildcardExpansion) {
   ASSERT_FALSE(reader->Read(&resp));
   ::grpc::Status status = reader->Finish();
   EXPECT_TRUE(status.ok());
-  std::string s;
-  ASSERT_OK(ReadFileToString(FLAGS_read_req_log_file, &s));
-  EXPECT_THAT(s, HasSubstr(req.entities(0).ShortDebugString()));
+  auto entries = ReadRequestJournal(FLAGS_read_req_log_file);
+  ASSERT_EQ(1U, entries.size());
+  EXPECT_THAT(entries[0].read_request(), EqualsProto(req));
 }
 
 TEST_P(P4ServiceTest, ReadFailureForNoDeviceId) {
@@ -1170,9 +1197,9 @@ TEST_P(P4ServiceTest, ReadFailureWhenReadForwardingEntriesFails) {
   EXPECT_EQ(kOperErrorMsg, detail.message());
   const auto& errors = error_buffer_->GetErrors();
   EXPECT_TRUE(errors.empty());
-  std::string s;
-  ASSERT_OK(ReadFileToString(FLAGS_read_req_log_file, &s));
-  EXPECT_THAT(s, HasSubstr(req.entities(0).ShortDebugString()));
+  auto entries = ReadRequestJournal(FLAGS_read_req_log_file);
+  ASSERT_EQ(1U, entries.size());
+  EXPECT_THAT(entries[0].read_request(), EqualsProto(req));
 }
 
 TEST_P(P4ServiceTest, ReadFailureForAuthError) {
@@ -0,0 +1,159 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/port_counters_cache.h"
+
+#include <vector>
+
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// Collects the port counters from the DataResponses of a RetrieveValue call.
+class PortCountersWriter : public WriterInterface<DataResponse> {
+ public:
+  explicit PortCountersWriter(std::vector<PortCounters>* counters)
+      : counters_(counters) {}
+
+  bool Write(const DataResponse& resp) override {
+    if (!resp.has_port_counters()) return false;
+    counters_->push_back(resp.port_counters());
+    return true;
+  }
+
+ private:
+  std::vector<PortCounters>* counters_;  // not owned.
+};
+
+}  // namespace
+
+PortCountersCache::PortCountersCache(SwitchInterface* switch_interface,
+                                     absl::Duration max_staleness)
+    : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
+      max_staleness_(max_staleness),
+      node_id_to_snapshot_(),
+      num_snapshots_(0) {}
+
+void PortCountersCache::AddPort(uint64 node_id, uint32 port_id) {
+  auto snapshot = GetOrCreateNodeSnapshot(node_id);
+  absl::MutexLock l(&snapshot->lock);
+  snapshot->port_ids.insert(port_id);
+}
+
+void PortCountersCache::RemovePort(uint64 node_id, uint32 port_id) {
+  std::shared_ptr<NodeSnapshot> snapshot;
+  {
+    absl::MutexLock l(&lock_);
+    auto it = node_id_to_snapshot_.find(node_id);
+    if (it == node_id_to_snapshot_.end()) return;
+    snapshot = it->second;
+  }
+  absl::MutexLock l(&snapshot->lock);
+  snapshot->port_ids.erase(port_id);
+  snapshot->counters.erase(port_id);
+}
+
+void PortCountersCache::Clear() {
+  absl::MutexLock l(&lock_);
+  node_id_to_snapshot_.clear();
+}
+
+::util::StatusOr<PortCounters> PortCountersCache::GetPortCounters(
+    uint64 node_id, uint32 port_id) {
+  if (max_staleness_ <= absl::ZeroDuration()) {
+    std::map<uint32, ::util::StatusOr<PortCounters>> counters;
+    RetrievePortCounters(node_id, {port_id}, &counters);
+    return counters.at(port_id);
+  }
+
+  auto snapshot = GetOrCreateNodeSnapshot(node_id);
+  absl::MutexLock l(&snapshot->lock);
+  snapshot->port_ids.insert(port_id);
+  if (absl::Now() - snapshot->timestamp > max_staleness_ ||
+      !snapshot->counters.count(port_id)) {
+    RefreshNodeSnapshot(node_id, snapshot.get());
+  }
+
+  return snapshot->counters.at(port_id);
+}
+
+uint64 PortCountersCache::GetNumSnapshots() const {
+  absl::MutexLock l(&lock_);
+  return num_snapshots_;
+}
+
+std::shared_ptr<PortCountersCache::NodeSnapshot>
+PortCountersCache::GetOrCreateNodeSnapshot(uint64 node_id) {
+  absl::MutexLock l(&lock_);
+  auto& snapshot = node_id_to_snapshot_[node_id];
+  if (snapshot == nullptr) snapshot = std::make_shared<NodeSnapshot>();
+  return snapshot;
+}
+
+void PortCountersCache::RefreshNodeSnapshot(uint64 node_id,
+                                            NodeSnapshot* snapshot) {
+  snapshot->counters.clear();
+  RetrievePortCounters(node_id, snapshot->port_ids, &snapshot->counters);
+  snapshot->timestamp = absl::Now();
+  absl::MutexLock l(&lock_);
+  ++num_snapshots_;
+}
+
+void PortCountersCache::RetrievePortCounters(
+    uint64 node_id, const std::set<uint32>& port_ids,
+    std::map<uint32, ::util::StatusOr<PortCounters>>* counters) {
+  DataRequest req;
+  std::vector<uint32> requested_port_ids;
+  for (uint32 port_id : port_ids) {
+    auto* request = req.add_requests()->mutable_port_counters();
+    request->set_node_id(node_id);
+    request->set_port_id(port_id);
+    requested_port_ids.push_back(port_id);
+  }
+
+  std::vector<PortCounters> responses;
+  std::vector<::util::Status> details;
+  PortCountersWriter writer(&responses);
+  ::util::Status status =
+      switch_interface_->RetrieveValue(node_id, req, &writer, &details);
+  if (status.ok()) {
+    if (details.size() == requested_port_ids.size()) {
+      // A response is written for each request that succeeded, in the order
+      // of the requests.
+      size_t next_response = 0;
+      for (size_t i = 0; i < requested_port_ids.size(); ++i) {
+        if (!details[i].ok()) {
+          counters->emplace(requested_port_ids[i], details[i]);
+        } else if (next_response < responses.size()) {
+          counters->emplace(requested_port_ids[i], responses[next_response++]);
+        }
+      }
+    } else if (responses.size() == requested_port_ids.size()) {
+      for (size_t i = 0; i < requested_port_ids.size(); ++i) {
+        counters->emplace(requested_port_ids[i], responses[i]);
+      }
+    }
+  }
+  // Every port without a response gets an error.
+  for (uint32 port_id : requested_port_ids) {
+    if (counters->count(port_id)) continue;
+    if (!status.ok()) {
+      counters->emplace(port_id, status);
+    } else {
+      counters->emplace(port_id, MAKE_ERROR(ERR_INTERNAL)
+                                     << "Counters of port " << port_id
+                                     << " on node " << node_id
+                                     << " could not be retrieved.");
+    }
+  }
+}
+
+}  // namespace hal
+}  // namespace stratum
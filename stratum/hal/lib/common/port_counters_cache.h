@@ -0,0 +1,112 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_CACHE_H_
+#define STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/switch_interface.h"
+
+namespace stratum {
+namespace hal {
+
+// The class "PortCountersCache" serves the counters of singleton ports from
+// per-node snapshots. Each gNMI counter leaf used to retrieve the counters of
+// its port from the switch on its own, which read the same hardware stats once
+// per leaf. Instead, a snapshot of the counters of all the known ports of a
+// node is taken in a single DataRequest and every leaf of every port is served
+// from it, until the snapshot is older than the configured maximum staleness.
+// This class is thread-safe. Concurrent readers of a stale snapshot of the same
+// node wait for a single refresh.
+class PortCountersCache {
+ public:
+  // A 'max_staleness' of zero or less disables the snapshots. Then every call
+  // to GetPortCounters() retrieves the counters of a single port.
+  PortCountersCache(SwitchInterface* switch_interface,
+                    absl::Duration max_staleness);
+  virtual ~PortCountersCache() {}
+
+  // Adds a port to the set of ports whose counters are retrieved with every
+  // snapshot of the given node. Ports are also added on their first lookup.
+  void AddPort(uint64 node_id, uint32 port_id) LOCKS_EXCLUDED(lock_);
+
+  // Removes a port from the snapshots of the given node, e.g. after it was
+  // removed from the config.
+  void RemovePort(uint64 node_id, uint32 port_id) LOCKS_EXCLUDED(lock_);
+
+  // Forgets all the ports and snapshots.
+  void Clear() LOCKS_EXCLUDED(lock_);
+
+  // Returns the counters of the given port from the snapshot of its node. The
+  // snapshot is refreshed first if it is stale or does not contain the port.
+  ::util::StatusOr<PortCounters> GetPortCounters(uint64 node_id,
+                                                 uint32 port_id)
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the number of snapshots taken so far.
+  uint64 GetNumSnapshots() const LOCKS_EXCLUDED(lock_);
+
+  // PortCountersCache is neither copyable nor movable.
+  PortCountersCache(const PortCountersCache&) = delete;
+  PortCountersCache& operator=(const PortCountersCache&) = delete;
+
+ private:
+  // The snapshot of the counters of all the known ports of a node.
+  struct NodeSnapshot {
+    // Serializes the refreshes and lookups of this snapshot.
+    absl::Mutex lock;
+    // The ports included in the next refresh.
+    std::set<uint32> port_ids GUARDED_BY(lock);
+    // The counters of each port or the error retrieving them, as of the last
+    // refresh.
+    std::map<uint32, ::util::StatusOr<PortCounters>> counters GUARDED_BY(lock);
+    // The time of the last refresh.
+    absl::Time timestamp GUARDED_BY(lock) = absl::InfinitePast();
+  };
+
+  // Returns the snapshot of the given node, creating it if needed.
+  std::shared_ptr<NodeSnapshot> GetOrCreateNodeSnapshot(uint64 node_id)
+      LOCKS_EXCLUDED(lock_);
+
+  // Retrieves the counters of all the ports of the snapshot from the switch
+  // and replaces its content.
+  void RefreshNodeSnapshot(uint64 node_id, NodeSnapshot* snapshot)
+      EXCLUSIVE_LOCKS_REQUIRED(snapshot->lock) LOCKS_EXCLUDED(lock_);
+
+  // Retrieves the counters of the given ports from the switch in a single
+  // DataRequest. Adds the counters, or the error retrieving them, of every
+  // port to 'counters'.
+  void RetrievePortCounters(
+      uint64 node_id, const std::set<uint32>& port_ids,
+      std::map<uint32, ::util::StatusOr<PortCounters>>* counters);
+
+  // Pointer to the switch used to retrieve the counters. Not owned.
+  SwitchInterface* const switch_interface_;
+
+  // The maximum age of a snapshot that is used to serve counters.
+  const absl::Duration max_staleness_;
+
+  // Protects the map of snapshots and the stats.
+  mutable absl::Mutex lock_;
+
+  // Map from node ID to the snapshot of the node.
+  std::map<uint64, std::shared_ptr<NodeSnapshot>> node_id_to_snapshot_
+      GUARDED_BY(lock_);
+
+  // The number of snapshots taken so far.
+  uint64 num_snapshots_ GUARDED_BY(lock_);
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_CACHE_H_
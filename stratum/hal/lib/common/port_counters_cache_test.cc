@@ -0,0 +1,229 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/port_counters_cache.h"
+
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+using test_utils::StatusIs;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::SizeIs;
+
+constexpr uint64 kNodeId = 1;
+constexpr uint32 kPortId1 = 1;
+constexpr uint32 kPortId2 = 2;
+constexpr uint32 kPortId3 = 3;
+
+// Fake RetrieveValue() which answers each port counters request with
+// in_octets set to 100 times the port ID plus the number of calls so far.
+// Requests for 'failing_port_id' fail.
+class FakeCounters {
+ public:
+  explicit FakeCounters(uint32 failing_port_id = 0)
+      : failing_port_id_(failing_port_id), num_calls_(0) {}
+
+  ::util::Status RetrieveValue(uint64 node_id, const DataRequest& request,
+                               WriterInterface<DataResponse>* writer,
+                               std::vector<::util::Status>* details) {
+    ++num_calls_;
+    requests_.push_back(request);
+    for (const auto& req : request.requests()) {
+      ::util::Status status = ::util::OkStatus();
+      if (req.port_counters().port_id() == failing_port_id_) {
+        status = ::util::Status(StratumErrorSpace(), ERR_INVALID_PARAM,
+                                "failing port");
+      } else {
+        DataResponse resp;
+        resp.mutable_port_counters()->set_in_octets(
+            100 * req.port_counters().port_id() + num_calls_);
+        writer->Write(resp);
+      }
+      if (details) details->push_back(status);
+    }
+    return ::util::OkStatus();
+  }
+
+  const std::vector<DataRequest>& requests() const { return requests_; }
+
+ private:
+  const uint32 failing_port_id_;
+  int num_calls_;
+  std::vector<DataRequest> requests_;
+};
+
+// Checks that the counters of all the ports of a node are retrieved in a
+// single request and then served from the snapshot.
+TEST(PortCountersCacheTest, ServesAllPortsFromOneSnapshot) {
+  SwitchMock switch_mock;
+  FakeCounters fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .WillOnce(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::Hours(1));
+  cache.AddPort(kNodeId, kPortId1);
+  cache.AddPort(kNodeId, kPortId2);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_OK_AND_ASSIGN(auto counters1,
+                         cache.GetPortCounters(kNodeId, kPortId1));
+    EXPECT_EQ(101, counters1.in_octets());
+    ASSERT_OK_AND_ASSIGN(auto counters2,
+                         cache.GetPortCounters(kNodeId, kPortId2));
+    EXPECT_EQ(201, counters2.in_octets());
+  }
+  EXPECT_EQ(1, cache.GetNumSnapshots());
+  ASSERT_THAT(fake.requests(), SizeIs(1));
+  EXPECT_EQ(2, fake.requests()[0].requests_size());
+}
+
+// Checks that a stale snapshot is refreshed.
+TEST(PortCountersCacheTest, RefreshesStaleSnapshot) {
+  SwitchMock switch_mock;
+  FakeCounters fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::Milliseconds(1));
+  ASSERT_OK_AND_ASSIGN(auto counters, cache.GetPortCounters(kNodeId, kPortId1));
+  EXPECT_EQ(101, counters.in_octets());
+  absl::SleepFor(absl::Milliseconds(10));
+  ASSERT_OK_AND_ASSIGN(counters, cache.GetPortCounters(kNodeId, kPortId1));
+  EXPECT_EQ(102, counters.in_octets());
+  EXPECT_EQ(2, cache.GetNumSnapshots());
+}
+
+// Checks that a port unknown to the snapshot triggers a refresh, which then
+// includes all the ports.
+TEST(PortCountersCacheTest, RefreshesSnapshotForNewPort) {
+  SwitchMock switch_mock;
+  FakeCounters fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::Hours(1));
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId1).status());
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId2).status());
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId1).status());
+  ASSERT_THAT(fake.requests(), SizeIs(2));
+  EXPECT_EQ(2, fake.requests()[1].requests_size());
+}
+
+// Checks that the error of a single port is reported for that port only and
+// does not cause additional refreshes.
+TEST(PortCountersCacheTest, ReportsPerPortErrors) {
+  SwitchMock switch_mock;
+  FakeCounters fake(kPortId2);
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .WillOnce(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::Hours(1));
+  cache.AddPort(kNodeId, kPortId1);
+  cache.AddPort(kNodeId, kPortId2);
+  cache.AddPort(kNodeId, kPortId3);
+  ASSERT_OK_AND_ASSIGN(auto counters, cache.GetPortCounters(kNodeId, kPortId1));
+  EXPECT_EQ(101, counters.in_octets());
+  EXPECT_THAT(cache.GetPortCounters(kNodeId, kPortId2).status(),
+              StatusIs(_, ERR_INVALID_PARAM, HasSubstr("failing port")));
+  ASSERT_OK_AND_ASSIGN(counters, cache.GetPortCounters(kNodeId, kPortId3));
+  EXPECT_EQ(301, counters.in_octets());
+  EXPECT_EQ(1, cache.GetNumSnapshots());
+}
+
+// Checks that a failing RetrieveValue() is reported for all the ports.
+TEST(PortCountersCacheTest, ReportsRetrieveValueError) {
+  SwitchMock switch_mock;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .WillOnce(Return(
+          ::util::Status(StratumErrorSpace(), ERR_INTERNAL, "some error")));
+
+  PortCountersCache cache(&switch_mock, absl::Hours(1));
+  cache.AddPort(kNodeId, kPortId1);
+  cache.AddPort(kNodeId, kPortId2);
+  EXPECT_THAT(cache.GetPortCounters(kNodeId, kPortId1).status(),
+              StatusIs(_, ERR_INTERNAL, HasSubstr("some error")));
+  EXPECT_THAT(cache.GetPortCounters(kNodeId, kPortId2).status(),
+              StatusIs(_, ERR_INTERNAL, HasSubstr("some error")));
+}
+
+// Checks that a non-positive staleness retrieves the counters of one port for
+// every call.
+TEST(PortCountersCacheTest, ZeroStalenessDisablesSnapshots) {
+  SwitchMock switch_mock;
+  FakeCounters fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::ZeroDuration());
+  cache.AddPort(kNodeId, kPortId1);
+  cache.AddPort(kNodeId, kPortId2);
+  ASSERT_OK_AND_ASSIGN(auto counters, cache.GetPortCounters(kNodeId, kPortId1));
+  EXPECT_EQ(101, counters.in_octets());
+  ASSERT_OK_AND_ASSIGN(counters, cache.GetPortCounters(kNodeId, kPortId1));
+  EXPECT_EQ(102, counters.in_octets());
+  ASSERT_THAT(fake.requests(), SizeIs(2));
+  EXPECT_EQ(1, fake.requests()[0].requests_size());
+  EXPECT_EQ(1, fake.requests()[1].requests_size());
+  EXPECT_EQ(0, cache.GetNumSnapshots());
+}
+
+// Checks that Clear() drops the ports and the snapshots.
+TEST(PortCountersCacheTest, Clear) {
+  SwitchMock switch_mock;
+  FakeCounters fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::Hours(1));
+  cache.AddPort(kNodeId, kPortId1);
+  cache.AddPort(kNodeId, kPortId2);
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId1).status());
+  cache.Clear();
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId1).status());
+  ASSERT_THAT(fake.requests(), SizeIs(2));
+  EXPECT_EQ(1, fake.requests()[1].requests_size());
+}
+
+// Checks that a removed port is no longer part of the snapshot refreshes.
+TEST(PortCountersCacheTest, RemovePort) {
+  SwitchMock switch_mock;
+  FakeCounters fake;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(&fake, &FakeCounters::RetrieveValue));
+
+  PortCountersCache cache(&switch_mock, absl::Hours(1));
+  cache.AddPort(kNodeId, kPortId1);
+  cache.AddPort(kNodeId, kPortId2);
+  cache.AddPort(kNodeId, kPortId3);
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId1).status());
+  cache.RemovePort(kNodeId, kPortId2);
+  // The counters of the remaining ports are still served from the snapshot.
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId3).status());
+  ASSERT_THAT(fake.requests(), SizeIs(1));
+  // Asking for the removed port again adds it back with a refresh.
+  EXPECT_OK(cache.GetPortCounters(kNodeId, kPortId2).status());
+  ASSERT_THAT(fake.requests(), SizeIs(2));
+  EXPECT_EQ(3, fake.requests()[1].requests_size());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
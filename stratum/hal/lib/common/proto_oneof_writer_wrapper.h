@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "stratum/hal/lib/common/writer_interface.h"
 
@@ -32,6 +33,24 @@ class ProtoOneofWriterWrapper : public WriterInterface<R> {
     *(t.*get_mutable_inner_message_)() = msg;
     return writer_->Write(t);
   }
+  bool WriteBatch(std::vector<R>* msgs) override {
+    if (!writer_) return false;
+    std::vector<T> ts(msgs->size());
+    for (size_t i = 0; i < msgs->size(); ++i) {
+      (ts[i].*get_mutable_inner_message_)()->Swap(&(*msgs)[i]);
+    }
+    if (writer_->WriteBatch(&ts)) {
+      msgs->clear();
+      return true;
+    }
+    // Hand the messages which have not been written back to the caller.
+    const size_t num_written = msgs->size() - ts.size();
+    for (size_t i = 0; i < ts.size(); ++i) {
+      (ts[i].*get_mutable_inner_message_)()->Swap(&(*msgs)[num_written + i]);
+    }
+    msgs->erase(msgs->begin(), msgs->begin() + num_written);
+    return false;
+  }
 
  private:
   std::shared_ptr<WriterInterface<T>> writer_;
@@ -0,0 +1,64 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/role_write_sequencer.h"
+
+namespace stratum {
+namespace hal {
+
+RoleWriteSequencer::Turn::~Turn() { sequencer_->Release(key_, queue_); }
+
+std::unique_ptr<RoleWriteSequencer::Turn> RoleWriteSequencer::Acquire(
+    uint64 node_id, const std::string& role) {
+  auto key = std::make_pair(node_id, role);
+  std::shared_ptr<RoleQueue> queue;
+  uint64 ticket;
+  {
+    absl::MutexLock l(&lock_);
+    auto& entry = queues_[key];
+    if (!entry) entry = std::make_shared<RoleQueue>();
+    queue = entry;
+    absl::MutexLock queue_lock(&queue->lock);
+    ticket = queue->next_ticket++;
+  }
+  {
+    absl::MutexLock l(&queue->lock);
+    TurnArgs args = {queue.get(), ticket};
+    queue->lock.Await(absl::Condition(&RoleWriteSequencer::IsTurn, &args));
+  }
+
+  return std::unique_ptr<Turn>(new Turn(this, std::move(key), queue));
+}
+
+uint64 RoleWriteSequencer::NumPending(uint64 node_id,
+                                      const std::string& role) const {
+  std::shared_ptr<RoleQueue> queue;
+  {
+    absl::MutexLock l(&lock_);
+    auto it = queues_.find(std::make_pair(node_id, role));
+    if (it == queues_.end()) return 0;
+    queue = it->second;
+  }
+  absl::MutexLock l(&queue->lock);
+  return queue->next_ticket - queue->now_serving;
+}
+
+uint64 RoleWriteSequencer::NumActiveRoles() const {
+  absl::MutexLock l(&lock_);
+  return queues_.size();
+}
+
+void RoleWriteSequencer::Release(const std::pair<uint64, std::string>& key,
+                                 const std::shared_ptr<RoleQueue>& queue) {
+  absl::MutexLock l(&lock_);
+  absl::MutexLock queue_lock(&queue->lock);
+  ++queue->now_serving;
+  if (queue->now_serving == queue->next_ticket) queues_.erase(key);
+}
+
+bool RoleWriteSequencer::IsTurn(TurnArgs* args) {
+  return args->queue->now_serving == args->ticket;
+}
+
+}  // namespace hal
+}  // namespace stratum
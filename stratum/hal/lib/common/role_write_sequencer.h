@@ -0,0 +1,109 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_ROLE_WRITE_SEQUENCER_H_
+#define STRATUM_HAL_LIB_COMMON_ROLE_WRITE_SEQUENCER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "stratum/glue/integral_types.h"
+
+namespace stratum {
+namespace hal {
+
+// RoleWriteSequencer orders the P4Runtime Write requests per (node, role). The
+// requests of a role are executed one at a time, in the order they arrived,
+// while the requests of different roles proceed concurrently. Roles owning
+// disjoint sets of tables hence do not wait for each other; writes to shared
+// resources are serialized further down, by the switch implementation. This
+// class is thread-safe.
+class RoleWriteSequencer {
+ private:
+  struct RoleQueue;
+
+ public:
+  // The turn of a request. Subsequent requests of the same role wait until the
+  // turn is destroyed.
+  class Turn {
+   public:
+    ~Turn();
+
+    // Turn is neither copyable nor movable.
+    Turn(const Turn&) = delete;
+    Turn& operator=(const Turn&) = delete;
+
+   private:
+    friend class RoleWriteSequencer;
+    Turn(RoleWriteSequencer* sequencer, std::pair<uint64, std::string> key,
+         std::shared_ptr<RoleQueue> queue)
+        : sequencer_(sequencer), key_(std::move(key)), queue_(queue) {}
+
+    RoleWriteSequencer* sequencer_;
+    std::pair<uint64, std::string> key_;
+    std::shared_ptr<RoleQueue> queue_;
+  };
+
+  RoleWriteSequencer() {}
+
+  // Blocks until all earlier requests of the given role on the given node
+  // have released their turn, and returns the turn of the calling request.
+  std::unique_ptr<Turn> Acquire(uint64 node_id, const std::string& role)
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the number of requests of the given role which hold or wait for
+  // their turn.
+  uint64 NumPending(uint64 node_id, const std::string& role) const
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the number of (node, role) pairs which have requests holding or
+  // waiting for their turn.
+  uint64 NumActiveRoles() const LOCKS_EXCLUDED(lock_);
+
+  // RoleWriteSequencer is neither copyable nor movable.
+  RoleWriteSequencer(const RoleWriteSequencer&) = delete;
+  RoleWriteSequencer& operator=(const RoleWriteSequencer&) = delete;
+
+ private:
+  // A ticket queue serving the requests of a role in arrival order.
+  struct RoleQueue {
+    absl::Mutex lock;
+    // The ticket handed out to the next arriving request.
+    uint64 next_ticket GUARDED_BY(lock) = 0;
+    // The ticket of the request whose turn it is.
+    uint64 now_serving GUARDED_BY(lock) = 0;
+  };
+
+  // The arguments of the Acquire() wake-up condition.
+  struct TurnArgs {
+    RoleQueue* queue;
+    uint64 ticket;
+  };
+
+  // Condition used with absl::Mutex::Await().
+  static bool IsTurn(TurnArgs* args) SHARED_LOCKS_REQUIRED(args->queue->lock);
+
+  // Passes the turn to the next request of the role, and removes the queue of
+  // the role once no request holds or waits for a turn.
+  void Release(const std::pair<uint64, std::string>& key,
+               const std::shared_ptr<RoleQueue>& queue) LOCKS_EXCLUDED(lock_);
+
+  mutable absl::Mutex lock_;
+
+  // Map from (node ID, role name) to the queue of the role. Only roles with
+  // pending requests have a queue, so the queues of roles which are gone do
+  // not accumulate. The tickets are handed out under this lock as well, so
+  // that a queue is never removed while a request is about to join it.
+  absl::flat_hash_map<std::pair<uint64, std::string>,
+                      std::shared_ptr<RoleQueue>>
+      queues_ GUARDED_BY(lock_);
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_ROLE_WRITE_SEQUENCER_H_
@@ -0,0 +1,108 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/role_write_sequencer.h"
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr uint64 kNodeId = 1;
+
+// Waits until the given number of requests hold or wait for their turn.
+void WaitForPending(const RoleWriteSequencer& sequencer, uint64 node_id,
+                    const std::string& role, uint64 num_pending) {
+  while (sequencer.NumPending(node_id, role) < num_pending) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+}
+
+TEST(RoleWriteSequencerTest, SerializesRequestsOfARoleInArrivalOrder) {
+  constexpr int kNumRequests = 4;
+  RoleWriteSequencer sequencer;
+  absl::Mutex lock;
+  std::vector<int> order;
+
+  // The first request holds its turn while the others queue up behind it.
+  auto first = sequencer.Acquire(kNodeId, "routing");
+  std::vector<std::thread> threads;
+  for (int i = 1; i <= kNumRequests; ++i) {
+    threads.emplace_back([&sequencer, &lock, &order, i]() {
+      auto turn = sequencer.Acquire(kNodeId, "routing");
+      absl::MutexLock l(&lock);
+      order.push_back(i);
+    });
+    // Let every request take its ticket before the next one starts.
+    WaitForPending(sequencer, kNodeId, "routing", i + 1);
+  }
+  {
+    absl::MutexLock l(&lock);
+    EXPECT_TRUE(order.empty());
+  }
+  first.reset();
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_THAT(order, ElementsAre(1, 2, 3, 4));
+  EXPECT_EQ(0, sequencer.NumPending(kNodeId, "routing"));
+}
+
+TEST(RoleWriteSequencerTest, RolesDoNotWaitForEachOther) {
+  RoleWriteSequencer sequencer;
+  auto routing = sequencer.Acquire(kNodeId, "routing");
+  // Other roles, the default role and the same role on other nodes get their
+  // turn while the routing role holds its turn.
+  auto acl = sequencer.Acquire(kNodeId, "acl");
+  auto default_role = sequencer.Acquire(kNodeId, "");
+  auto other_node = sequencer.Acquire(kNodeId + 1, "routing");
+  EXPECT_EQ(1, sequencer.NumPending(kNodeId, "routing"));
+  EXPECT_EQ(1, sequencer.NumPending(kNodeId, "acl"));
+  EXPECT_EQ(0, sequencer.NumPending(kNodeId, "telemetry"));
+}
+
+TEST(RoleWriteSequencerTest, WaitsForTurnOfPreviousRequest) {
+  RoleWriteSequencer sequencer;
+  auto first = sequencer.Acquire(kNodeId, "acl");
+  absl::Notification acquired;
+  std::thread second([&sequencer, &acquired]() {
+    auto turn = sequencer.Acquire(kNodeId, "acl");
+    acquired.Notify();
+  });
+  WaitForPending(sequencer, kNodeId, "acl", 2);
+  EXPECT_FALSE(acquired.WaitForNotificationWithTimeout(absl::Milliseconds(20)));
+  first.reset();
+  acquired.WaitForNotification();
+  second.join();
+}
+
+TEST(RoleWriteSequencerTest, RemovesQueuesOfIdleRoles) {
+  RoleWriteSequencer sequencer;
+  auto routing = sequencer.Acquire(kNodeId, "routing");
+  {
+    auto acl = sequencer.Acquire(kNodeId, "acl");
+    EXPECT_EQ(2, sequencer.NumActiveRoles());
+  }
+  EXPECT_EQ(1, sequencer.NumActiveRoles());
+  routing.reset();
+  EXPECT_EQ(0, sequencer.NumActiveRoles());
+  // A role gets a new queue when it writes again.
+  auto acl = sequencer.Acquire(kNodeId, "acl");
+  EXPECT_EQ(1, sequencer.NumPending(kNodeId, "acl"));
+  EXPECT_EQ(1, sequencer.NumActiveRoles());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -5,6 +5,8 @@
 #ifndef STRATUM_HAL_LIB_COMMON_SERVER_WRITER_WRAPPER_H_
 #define STRATUM_HAL_LIB_COMMON_SERVER_WRITER_WRAPPER_H_
 
+#include <vector>
+
 #include "grpcpp/grpcpp.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 
@@ -21,6 +23,18 @@ class ServerWriterWrapper : public WriterInterface<T> {
     if (writer_) return writer_->Write(msg);
     return false;
   }
+  // Hints gRPC to coalesce all but the last message of the batch.
+  bool WriteBatch(std::vector<T>* msgs) override {
+    if (!writer_) return false;
+    size_t i = 0;
+    for (; i < msgs->size(); ++i) {
+      ::grpc::WriteOptions options;
+      if (i + 1 < msgs->size()) options.set_buffer_hint();
+      if (!writer_->Write((*msgs)[i], options)) break;
+    }
+    msgs->erase(msgs->begin(), msgs->begin() + i);
+    return msgs->empty();
+  }
 
  private:
   ::grpc::ServerWriter<T>* writer_;  // not owned by the class.
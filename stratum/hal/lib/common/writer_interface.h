@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace stratum {
 namespace hal {
@@ -23,6 +24,19 @@ class WriterInterface {
   // underlying transfer mechanism.
   virtual bool Write(const T& msg) = 0;
 
+  // Blocking Write() operation for a batch of messages, which are passed in
+  // order and may be moved from. Returns false if any of the messages could not
+  // be written, in which case the messages after it are not written either and
+  // msgs holds the messages which have not been written. On success, msgs is
+  // left empty. Transports which can pass several messages at once override
+  // this.
+  virtual bool WriteBatch(std::vector<T>* msgs) {
+    auto it = msgs->begin();
+    while (it != msgs->end() && Write(*it)) ++it;
+    msgs->erase(msgs->begin(), it);
+    return msgs->empty();
+  }
+
  protected:
   // Default constructor. To be called by the Mock class instance only.
   WriterInterface() {}
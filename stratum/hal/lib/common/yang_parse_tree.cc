@@ -4,18 +4,33 @@
 
 #include "stratum/hal/lib/common/yang_parse_tree.h"
 
+#include <algorithm>
+#include <initializer_list>
 #include <list>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
+#include "gflags/gflags.h"
 #include "grpcpp/grpcpp.h"
+#include "stratum/glue/gtl/map_util.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/common/gnmi_publisher.h"
 #include "stratum/hal/lib/common/yang_parse_tree_paths.h"
 
+DEFINE_int32(gnmi_port_counters_max_staleness_ms, 500,
+             "Maximum age of the per-node snapshot of port counters used to "
+             "serve the gNMI counters leaves. All the leaves of all the ports "
+             "of a node polled within this period are served from a single "
+             "read of the counters. Zero or less reads the counters of a port "
+             "for every leaf.");
+
 namespace stratum {
 namespace hal {
 
@@ -47,8 +62,70 @@ void TreeNode::CopySubtree(const TreeNode& src) {
 
   // Deep-copy children.
   for (const auto& entry : src.children_) {
-    children_.emplace(entry.first, TreeNode(*this, entry.first));
-    children_[entry.first].CopySubtree(entry.second);
+    AddChild(entry.first)->CopySubtree(*entry.second);
+  }
+}
+
+namespace {
+
+// Orders the children of a node by name.
+bool ChildNameLess(
+    const std::pair<std::string, std::unique_ptr<TreeNode>>& child,
+    const std::string& name) {
+  return child.first < name;
+}
+
+// The batch that YangParseTree::RetrieveValue() calls made by this thread are
+// passed to, if any. Not owned.
+thread_local DataRequestBatch* this_thread_batch = nullptr;
+
+}  // namespace
+
+const TreeNode* TreeNode::FindChildOrNull(const std::string& name) const {
+  auto it = std::lower_bound(children_.begin(), children_.end(), name,
+                             ChildNameLess);
+  if (it == children_.end() || it->first != name) return nullptr;
+  return it->second.get();
+}
+
+TreeNode* TreeNode::FindChildOrNull(const std::string& name) {
+  return const_cast<TreeNode*>(
+      static_cast<const TreeNode*>(this)->FindChildOrNull(name));
+}
+
+TreeNode* TreeNode::AddChild(const std::string& name, bool is_name_a_key) {
+  auto it = std::lower_bound(children_.begin(), children_.end(), name,
+                             ChildNameLess);
+  if (it == children_.end() || it->first != name) {
+    it = children_.emplace(it, name,
+                           absl::make_unique<TreeNode>(*this, name,
+                                                       is_name_a_key));
+  }
+  return it->second.get();
+}
+
+std::unique_ptr<TreeNode> TreeNode::RemoveChild(const TreeNode* child) {
+  auto it = std::lower_bound(children_.begin(), children_.end(), child->name(),
+                             ChildNameLess);
+  if (it == children_.end() || it->second.get() != child) return nullptr;
+  std::unique_ptr<TreeNode> removed = std::move(it->second);
+  children_.erase(it);
+  return removed;
+}
+
+bool TreeNode::SubtreeHasHandlers() const {
+  if (handler_anchor_.use_count() > 1) return true;
+  for (const auto& child : children_) {
+    if (child.second->SubtreeHasHandlers()) return true;
+  }
+  return false;
+}
+
+void TreeNode::CollectSubtreeNodes(
+    absl::flat_hash_set<const TreeNode*>* nodes) const {
+  nodes->insert(this);
+  for (const auto& child : children_) {
+    child.second->CollectSubtreeNodes(nodes);
   }
 }
 
@@ -57,8 +134,8 @@ void TreeNode::CopySubtree(const TreeNode& src) {
     const ::gnmi::Path& path, GnmiSubscribeStream* stream) const {
   RETURN_IF_ERROR((this->*handler)(event, path, stream));
   for (const auto& child : children_) {
-    RETURN_IF_ERROR(child.second.VisitThisNodeAndItsChildren(
-        handler, event, child.second.GetPath(), stream));
+    RETURN_IF_ERROR(child.second->VisitThisNodeAndItsChildren(
+        handler, event, child.second->GetPath(), stream));
   }
   return ::util::OkStatus();
 }
@@ -67,7 +144,7 @@ void TreeNode::CopySubtree(const TreeNode& src) {
     const EventHandlerRecordPtr& record) const {
   RETURN_IF_ERROR(this->on_change_registration_(record));
   for (const auto& child : children_) {
-    RETURN_IF_ERROR(child.second.RegisterThisNodeAndItsChildren(record));
+    RETURN_IF_ERROR(child.second->RegisterThisNodeAndItsChildren(record));
   }
   return ::util::OkStatus();
 }
@@ -107,10 +184,10 @@ const TreeNode* TreeNode::FindNodeOrNull(const ::gnmi::Path& path) const {
   const TreeNode* node = this;
   for (; node != nullptr && !node->children_.empty() &&
          element < path.elem_size();) {
-    node = gtl::FindOrNull(node->children_, path.elem(element).name());
+    node = node->FindChildOrNull(path.elem(element).name());
     auto* search = gtl::FindOrNull(path.elem(element).key(), "name");
     if (search != nullptr && node != nullptr) {
-      node = gtl::FindOrNull(node->children_, *search);
+      node = node->FindChildOrNull(*search);
     }
     ++element;
   }
@@ -131,10 +208,39 @@ void YangParseTree::SendNotification(const GnmiEventPtr& event) {
   }
 }
 
+namespace {
+
+// Returns a fingerprint of the given messages, which changes whenever one of
+// them does. Each message is prefixed with its size to keep the concatenation
+// unambiguous.
+std::string ConfigFingerprint(
+    std::initializer_list<const ::google::protobuf::Message*> messages) {
+  std::string fingerprint;
+  for (const auto* message : messages) {
+    const std::string serialized = message->SerializeAsString();
+    absl::StrAppend(&fingerprint, serialized.size(), ":", serialized);
+  }
+  return fingerprint;
+}
+
+}  // namespace
+
 void YangParseTree::ProcessPushedConfig(
     const ConfigHasBeenPushedEvent& change) {
   absl::WriterMutexLock r(&root_access_lock_);
 
+  // An element of the new config, like a singleton port, and the action adding
+  // its subtrees.
+  struct ConfigElement {
+    std::string key;
+    std::string fingerprint;
+    absl::optional<std::pair<uint64, uint32>> port;
+    Action add;
+  };
+  // The elements in the order their subtrees were always added in, as some
+  // of the paths they add are shared.
+  std::vector<ConfigElement> elements;
+
   // Translation from node ID to an object describing the node.
   absl::flat_hash_map<uint64, const Node*> node_id_to_node;
   for (const auto& node : change.new_config_.nodes()) {
@@ -151,12 +257,26 @@ void YangParseTree::ProcessPushedConfig(
         node_id_to_node[singleton.node()]
             ? node_id_to_node[singleton.node()]->config_params()
             : empty_node_config;
-    AddSubtreeInterfaceFromSingleton(singleton, node_config);
+    ConfigElement element;
+    element.key = absl::StrCat("singleton:", singleton.node(), ":",
+                               singleton.id());
+    element.fingerprint = ConfigFingerprint({&singleton, &node_config});
+    element.port = std::make_pair(singleton.node(), singleton.id());
+    element.add = [this, &singleton, &node_config]() {
+      AddSubtreeInterfaceFromSingleton(singleton, node_config);
+    };
+    elements.push_back(element);
     port_id_to_node_id[singleton.id()] = singleton.node();
   }
 
   for (const auto& optical : change.new_config_.optical_network_interfaces()) {
-    AddSubtreeInterfaceFromOptical(optical);
+    ConfigElement element;
+    element.key = absl::StrCat("optical:", optical.id());
+    element.fingerprint = ConfigFingerprint({&optical});
+    element.add = [this, &optical]() {
+      AddSubtreeInterfaceFromOptical(optical);
+    };
+    elements.push_back(element);
   }
 
   for (const auto& trunk : change.new_config_.trunk_ports()) {
@@ -169,16 +289,159 @@ void YangParseTree::ProcessPushedConfig(
     const NodeConfigParams& node_config =
         node_id != kNodeIdUnknown ? node_id_to_node[node_id]->config_params()
                                   : empty_node_config;
-    AddSubtreeInterfaceFromTrunk(trunk.name(), node_id, trunk.id(),
-                                 node_config);
+    ConfigElement element;
+    element.key = absl::StrCat("trunk:", trunk.id());
+    element.fingerprint = absl::StrCat(
+        node_id, ":", ConfigFingerprint({&trunk, &node_config}));
+    element.port = std::make_pair(node_id, trunk.id());
+    element.add = [this, &trunk, node_id, &node_config]() {
+      AddSubtreeInterfaceFromTrunk(trunk.name(), node_id, trunk.id(),
+                                   node_config);
+    };
+    elements.push_back(element);
   }
   // Add all chassis-related gNMI paths.
-  AddSubtreeChassis(change.new_config_.chassis());
-  // Add all system-related gNMI paths.
-  AddSubtreeSystem();
+  {
+    const Chassis& chassis = change.new_config_.chassis();
+    ConfigElement element;
+    element.key = "chassis";
+    element.fingerprint = ConfigFingerprint({&chassis});
+    element.add = [this, &chassis]() { AddSubtreeChassis(chassis); };
+    elements.push_back(element);
+  }
+  // Add all system-related gNMI paths. They do not depend on the config.
+  {
+    ConfigElement element;
+    element.key = "system";
+    element.add = [this]() { AddSubtreeSystem(); };
+    elements.push_back(element);
+  }
   // Add all node-related gNMI paths.
   for (const auto& node : change.new_config_.nodes()) {
-    AddSubtreeNode(node);
+    ConfigElement element;
+    element.key = absl::StrCat("node:", node.id());
+    element.fingerprint = ConfigFingerprint({&node});
+    element.add = [this, &node]() { AddSubtreeNode(node); };
+    elements.push_back(element);
+  }
+
+  // Remove the subtrees of the elements which are no longer configured.
+  absl::flat_hash_set<std::string> element_keys;
+  for (const auto& element : elements) element_keys.insert(element.key);
+  for (auto it = config_subtrees_.begin(); it != config_subtrees_.end();) {
+    if (element_keys.contains(it->first)) {
+      ++it;
+      continue;
+    }
+    if (it->second.port) {
+      port_counters_cache_.RemovePort(it->second.port->first,
+                                      it->second.port->second);
+    }
+    ReleaseKeyedNodes(it->second.keyed_nodes);
+    it = config_subtrees_.erase(it);
+  }
+
+  // Add the subtrees of the new elements and update the ones of the changed
+  // elements. The subtrees of unchanged elements are left alone.
+  for (const auto& element : elements) {
+    auto it = config_subtrees_.find(element.key);
+    if (it != config_subtrees_.end() &&
+        it->second.fingerprint == element.fingerprint) {
+      continue;
+    }
+    ConfigSubtree* subtree = &config_subtrees_[element.key];
+    // The port may have changed. It is registered again with the cache while
+    // its subtree is added.
+    if (subtree->port) {
+      port_counters_cache_.RemovePort(subtree->port->first,
+                                      subtree->port->second);
+    }
+    UpdateConfigSubtree(element.add, subtree);
+    subtree->fingerprint = element.fingerprint;
+    subtree->port = element.port;
+  }
+
+  DeleteUnusedRemovedSubtrees();
+}
+
+void YangParseTree::UpdateConfigSubtree(const Action& add,
+                                        ConfigSubtree* subtree) {
+  std::map<TreeNode*, TreeNode*> old_keyed_nodes;
+  old_keyed_nodes.swap(subtree->keyed_nodes);
+  // Existing nodes on the added paths are reused and get their handlers
+  // replaced, so subscriptions to them see the new config.
+  added_keyed_nodes_ = &subtree->keyed_nodes;
+  add();
+  added_keyed_nodes_ = nullptr;
+  for (const auto& entry : subtree->keyed_nodes) {
+    if (old_keyed_nodes.erase(entry.first) == 0) {
+      ++keyed_node_to_num_users_[entry.first];
+    }
+  }
+  // The remaining keyed nodes are no longer used by this element.
+  ReleaseKeyedNodes(old_keyed_nodes);
+}
+
+void YangParseTree::ReleaseKeyedNodes(
+    const std::map<TreeNode*, TreeNode*>& keyed_nodes) {
+  for (const auto& entry : keyed_nodes) {
+    auto it = keyed_node_to_num_users_.find(entry.first);
+    if (it == keyed_node_to_num_users_.end() || --it->second > 0) continue;
+    keyed_node_to_num_users_.erase(it);
+    std::unique_ptr<TreeNode> removed = entry.second->RemoveChild(entry.first);
+    if (removed) removed_subtrees_.push_back(std::move(removed));
+  }
+}
+
+void YangParseTree::DeleteUnusedRemovedSubtrees() {
+  absl::flat_hash_set<const TreeNode*> deleted_nodes;
+  // Deleting a subtree can make the subtree holding the parent of its root
+  // deletable, so repeat until nothing changes.
+  bool deleted = true;
+  while (deleted && !removed_subtrees_.empty()) {
+    deleted = false;
+    // The nodes of another removed subtree still build their paths through
+    // the parent of its root.
+    absl::flat_hash_set<const TreeNode*> parents;
+    for (const auto& subtree : removed_subtrees_) {
+      parents.insert(&subtree->parent());
+    }
+    for (auto it = removed_subtrees_.begin(); it != removed_subtrees_.end();) {
+      absl::flat_hash_set<const TreeNode*> nodes;
+      (*it)->CollectSubtreeNodes(&nodes);
+      bool is_parent = std::any_of(
+          nodes.begin(), nodes.end(),
+          [&parents](const TreeNode* node) { return parents.contains(node); });
+      if (is_parent || (*it)->SubtreeHasHandlers()) {
+        ++it;
+        continue;
+      }
+      deleted_nodes.insert(nodes.begin(), nodes.end());
+      it = removed_subtrees_.erase(it);
+      deleted = true;
+    }
+  }
+  if (deleted_nodes.empty()) return;
+
+  // Keyed nodes of other config elements may have been below a removed node.
+  // Forget them, so that they are not released again.
+  for (auto it = keyed_node_to_num_users_.begin();
+       it != keyed_node_to_num_users_.end();) {
+    if (deleted_nodes.contains(it->first)) {
+      it = keyed_node_to_num_users_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto& entry : config_subtrees_) {
+    auto& keyed_nodes = entry.second.keyed_nodes;
+    for (auto it = keyed_nodes.begin(); it != keyed_nodes.end();) {
+      if (deleted_nodes.contains(it->first)) {
+        it = keyed_nodes.erase(it);
+      } else {
+        ++it;
+      }
+    }
   }
 }
 
@@ -199,8 +462,8 @@ bool YangParseTree::IsWildcard(const std::string& name) const {
       // Skip this one!
       continue;
     }
-    auto* leaf = subpath.elem_size() ? entry.second.FindNodeOrNull(subpath)
-                                     : &entry.second;
+    auto* leaf = subpath.elem_size() ? entry.second->FindNodeOrNull(subpath)
+                                     : entry.second.get();
     if (leaf == nullptr) {
       // This will happen if the subpath does not exist in the path.
       // For example, trying to query node-id from all components
@@ -213,7 +476,11 @@ bool YangParseTree::IsWildcard(const std::string& name) const {
 }
 
 YangParseTree::YangParseTree(SwitchInterface* switch_interface)
-    : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)) {
+    : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
+      added_keyed_nodes_(nullptr),
+      port_counters_cache_(
+          switch_interface,
+          absl::Milliseconds(FLAGS_gnmi_port_counters_max_staleness_ms)) {
   // Add the minimum nodes:
   //   /interfaces/interface[name=*]/state/ifindex
   //   /interfaces/interface[name=*]/state/name
@@ -226,31 +493,45 @@ YangParseTree::YangParseTree(SwitchInterface* switch_interface)
   AddRoot();
 }
 
+::util::Status YangParseTree::RetrieveValue(
+    uint64 node_id, const DataRequest& request,
+    WriterInterface<DataResponse>* writer,
+    std::vector<::util::Status>* details) {
+  if (this_thread_batch != nullptr) {
+    return this_thread_batch->RetrieveValue(node_id, request, writer, details);
+  }
+  return switch_interface_->RetrieveValue(node_id, request, writer, details);
+}
+
+void YangParseTree::SetDataRequestBatchForThisThread(DataRequestBatch* batch) {
+  this_thread_batch = batch;
+}
+
+bool YangParseTree::IsRecordingDataRequests() const {
+  return this_thread_batch != nullptr && this_thread_batch->IsRecording();
+}
+
 TreeNode* YangParseTree::AddNode(const ::gnmi::Path& path) {
   // No need to lock the mutex - it is locked by method calling this one.
   TreeNode* node = &root_;
   for (const auto& element : path.elem()) {
-    TreeNode* child = gtl::FindOrNull(node->children_, element.name());
-    if (child == nullptr) {
-      // This path is not supported yet. Let's add a node with default
-      // processing.
-      node->children_.emplace(element.name(), TreeNode(*node, element.name()));
-      child = gtl::FindOrNull(node->children_, element.name());
-    }
-    node = child;
+    // If this path is not supported yet, a node with default processing is
+    // added.
+    node = node->AddChild(element.name());
     auto* search = gtl::FindOrNull(element.key(), "name");
     if (search == nullptr) {
       continue;
     }
 
     // A filtering pattern has been found!
-    child = gtl::FindOrNull(node->children_, *search);
-    if (child == nullptr) {
-      // This path is not supported yet. Let's add a node with default
-      // processing.
-      node->children_.emplace(
-          *search, TreeNode(*node, *search, true /* mark as a key */));
-      child = gtl::FindOrNull(node->children_, *search);
+    const bool is_new = node->FindChildOrNull(*search) == nullptr;
+    TreeNode* child = node->AddChild(*search, true /* mark as a key */);
+    // Record the keyed node as part of the subtree being added, if any. Keyed
+    // nodes which were not added for a config element, like the ones added by
+    // the constructor, are never removed.
+    if (added_keyed_nodes_ != nullptr &&
+        (is_new || keyed_node_to_num_users_.count(child))) {
+      added_keyed_nodes_->emplace(child, node);
     }
     node = child;
   }
@@ -10,12 +10,17 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 #include "gnmi/gnmi.grpc.pb.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/data_request_batch.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
+#include "stratum/hal/lib/common/port_counters_cache.h"
 #include "stratum/hal/lib/common/switch_interface.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/lib/macros.h"
@@ -48,13 +53,19 @@ using TreeNodeEventRegistration =
 // When a client requests subscription for a node or a leaf this tree is used to
 // check if such node or leaf is supported - it is done by walking the tree
 // starting from the root and then checking if the next element in the path can
-// be found in the map of children kept by the root TreeNode object. If found,
+// be found in the children kept by the root TreeNode object. If found,
 // this node is used to check if the second element of the path can be found in
 // its children and so on until the first unknown path element is found (and the
 // client is notified that such leaf is not supported) or the whole path is
 // processed (which means that the leaf is supported).
 class TreeNode {
  public:
+  // The children of a node, sorted by name. The names are kept in a flat
+  // vector, which is cheaper to search and to iterate than a map. The nodes
+  // themselves are allocated separately, so their addresses, which are
+  // captured by the handlers returned by Get*Handler(), never change.
+  using Children =
+      std::vector<std::pair<std::string, std::unique_ptr<TreeNode>>>;
   using SupportsOnPtr = bool TreeNode::*;
   using TargetDefinedModeFunc =
       std::function<::util::Status(::gnmi::Subscription* subscription)>;
@@ -149,6 +160,24 @@ class TreeNode {
   // Returns a node that handles the YANG path starting from this node.
   const TreeNode* FindNodeOrNull(const ::gnmi::Path& path) const;
 
+  // Returns the child with the given name or nullptr if there is none.
+  const TreeNode* FindChildOrNull(const std::string& name) const;
+  TreeNode* FindChildOrNull(const std::string& name);
+
+  // Returns the child with the given name. Adds it if there is none.
+  TreeNode* AddChild(const std::string& name, bool is_name_a_key = false);
+
+  // Detaches the given child from this node and returns it. Returns nullptr if
+  // it is not a child of this node.
+  std::unique_ptr<TreeNode> RemoveChild(const TreeNode* child);
+
+  // Returns true if a handler returned by Get*Handler() of this node or of a
+  // node below it still exists.
+  bool SubtreeHasHandlers() const;
+
+  // Adds this node and all nodes below it to 'nodes'.
+  void CollectSubtreeNodes(absl::flat_hash_set<const TreeNode*>* nodes) const;
+
   // A generic method that checks if the subtree starting from this node
   // supports a particular type of events. The input parameter is a pointer to
   // the mameber variable that keeps information if this node supports the
@@ -163,7 +192,7 @@ class TreeNode {
     bool supported = true;
     for (const auto& entry : children_) {
       supported =
-          supported && entry.second.AllSubtreeLeavesSupportOn(supports_on);
+          supported && entry.second->AllSubtreeLeavesSupportOn(supports_on);
     }
     return supported;
   }
@@ -231,7 +260,8 @@ class TreeNode {
 
   // Returns a functor that will execute handlers of this node and its children.
   GnmiEventHandler GetOnTimerHandler() const {
-    return [this](const GnmiEvent& event, GnmiSubscribeStream* stream) {
+    std::shared_ptr<const bool> anchor = handler_anchor_;
+    return [this, anchor](const GnmiEvent& event, GnmiSubscribeStream* stream) {
       return VisitThisNodeAndItsChildren(&TreeNode::on_timer_handler_, event,
                                          this->GetPath(), stream);
     };
@@ -239,7 +269,8 @@ class TreeNode {
 
   // Returns a functor that will execute handlers of this node and its children.
   GnmiEventHandler GetOnChangeHandler() const {
-    return [this](const GnmiEvent& event, GnmiSubscribeStream* stream) {
+    std::shared_ptr<const bool> anchor = handler_anchor_;
+    return [this, anchor](const GnmiEvent& event, GnmiSubscribeStream* stream) {
       return VisitThisNodeAndItsChildren(&TreeNode::on_change_handler_, event,
                                          this->GetPath(), stream);
     };
@@ -247,7 +278,8 @@ class TreeNode {
 
   // Returns a functor that will execute handlers of this node and its children.
   GnmiEventHandler GetOnPollHandler() const {
-    return [this](const GnmiEvent& event, GnmiSubscribeStream* stream) {
+    std::shared_ptr<const bool> anchor = handler_anchor_;
+    return [this, anchor](const GnmiEvent& event, GnmiSubscribeStream* stream) {
       return VisitThisNodeAndItsChildren(&TreeNode::on_poll_handler_, event,
                                          this->GetPath(), stream);
     };
@@ -275,7 +307,7 @@ class TreeNode {
   // Returns path from root to this node.
   ::gnmi::Path GetPath() const;
 
-  std::map<std::string, TreeNode> children_;
+  Children children_;
 
  private:
   using TreeNodeEventHandlerPtr = TreeNodeEventHandler TreeNode::*;
@@ -352,6 +384,9 @@ class TreeNode {
     return MAKE_ERROR() << "unsupported mode: DELETE for: '"
                         << path.ShortDebugString() << "'";
   };
+  // Shared with the handlers returned by Get*Handler(), which refer to this
+  // node, so that the node is not deleted while they exist.
+  std::shared_ptr<const bool> handler_anchor_ = std::make_shared<bool>(true);
   const TreeNode* parent_;
   std::string name_;
   // Some nodes are mapped to ::gnmi::PathElem 'name' key value. This variable
@@ -444,6 +479,25 @@ class YangParseTree {
     return switch_interface_;
   }
 
+  // Returns the cache serving the port counters leaves.
+  PortCountersCache* GetPortCountersCache() { return &port_counters_cache_; }
+
+  // Retrieves values from the switch for the leaves. While a DataRequestBatch
+  // is set for the calling thread, the request is passed to the batch instead.
+  // Same contract as SwitchInterface::RetrieveValue().
+  ::util::Status RetrieveValue(uint64 node_id, const DataRequest& request,
+                               WriterInterface<DataResponse>* writer,
+                               std::vector<::util::Status>* details);
+
+  // Sets the batch that RetrieveValue() calls made by the calling thread are
+  // passed to. A null 'batch' clears it.
+  void SetDataRequestBatchForThisThread(DataRequestBatch* batch);
+
+  // Returns true while the batch set for the calling thread records requests.
+  // The responses of the leaves are dropped then, so leaves which read the
+  // switch other than through RetrieveValue() must not do it.
+  bool IsRecordingDataRequests() const;
+
   // A getter providing a functor setting TARGET_DEFINED mode of a leaf to be
   // STREAM:SAMPLE.
   const TreeNode::TargetDefinedModeFunc& GetStreamSampleModeFunc() {
@@ -455,13 +509,45 @@ class YangParseTree {
   virtual void SendNotification(const GnmiEventPtr& event)
       LOCKS_EXCLUDED(root_access_lock_);
 
-  // An action that modifies the tree to reflect new configuration.
+  // An action that modifies the tree to reflect new configuration. Only the
+  // subtrees of the config elements (singleton ports, optical interfaces,
+  // trunks, nodes, chassis) which were added, removed or changed since the
+  // previous push are updated.
   void ProcessPushedConfig(const ConfigHasBeenPushedEvent& change)
       LOCKS_EXCLUDED(root_access_lock_);
 
  protected:
   using Action = std::function<void()>;
 
+  // The subtrees added to the tree for an element of the pushed config, like a
+  // singleton port or a node.
+  struct ConfigSubtree {
+    // The serialized config the subtrees were added for. The subtrees of an
+    // element are only updated when this changes.
+    std::string fingerprint;
+    // Map from the keyed nodes on the paths added for the element, like
+    // /interfaces/interface[name=1/1/1], to their parents.
+    std::map<TreeNode*, TreeNode*> keyed_nodes;
+    // The (node ID, port ID) of the port whose counters the subtrees serve.
+    absl::optional<std::pair<uint64, uint32>> port;
+  };
+
+  // Adds, or updates in place, the subtrees of a config element by calling
+  // 'add', and removes the keyed nodes of the previous subtrees that are no
+  // longer used.
+  void UpdateConfigSubtree(const Action& add, ConfigSubtree* subtree)
+      EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
+
+  // Releases the given keyed nodes of a config element. A keyed node which is
+  // not used by any other config element is removed from the tree.
+  void ReleaseKeyedNodes(const std::map<TreeNode*, TreeNode*>& keyed_nodes)
+      EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
+
+  // Deletes the removed subtrees which are no longer referenced, neither by the
+  // handlers of a subscription nor as the parent of another removed subtree.
+  void DeleteUnusedRemovedSubtrees()
+      EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
+
   // Adds node to a tree at specified path.
   TreeNode* AddNode(const ::gnmi::Path& path)
       EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
@@ -495,6 +581,31 @@ class YangParseTree {
   // A Mutex used to guard access to the root.
   mutable absl::Mutex root_access_lock_;
 
+  // Map from a key identifying an element of the last pushed config, like
+  // "singleton:<node ID>:<port ID>", to the subtrees added for it.
+  std::map<std::string, ConfigSubtree> config_subtrees_
+      GUARDED_BY(root_access_lock_);
+
+  // Map from a keyed node to the number of config elements using it. Keyed
+  // nodes can be shared, e.g. /qos/queues/queue[name=BE1] by all the ports.
+  std::map<TreeNode*, int> keyed_node_to_num_users_
+      GUARDED_BY(root_access_lock_);
+
+  // While the subtrees of a config element are added, AddNode() records the
+  // keyed nodes on the added paths here. Null otherwise.
+  std::map<TreeNode*, TreeNode*>* added_keyed_nodes_
+      GUARDED_BY(root_access_lock_);
+
+  // The subtrees removed from the tree. Subscriptions may still hold handlers
+  // of their nodes, so they are kept until the config push after the last of
+  // these handlers is gone.
+  std::vector<std::unique_ptr<TreeNode>> removed_subtrees_
+      GUARDED_BY(root_access_lock_);
+
+  // Serves the port counters leaves from per-node snapshots. Thread-safe on
+  // its own.
+  PortCountersCache port_counters_cache_;
+
   // In most cases the TARGET_DEFINED mode is ON_CHANGE mode as this mode
   // is the least resource-hungry. But to make the gNMI demo more realistic it
   // is changed to SAMPLE with the period of 1s.
@@ -0,0 +1,91 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the latency from a ChassisConfig push to the first gNMI path
+// lookup in a YangParseTree with up to 512 singleton ports. The initial push
+// builds the whole tree, while the following pushes only change one port.
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/gnmi_publisher.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/hal/lib/common/yang_parse_tree.h"
+#include "stratum/lib/constants.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr uint64 kNodeId = 1;
+
+// Returns a config with one node and the given number of singleton ports.
+ChassisConfig MakeChassisConfig(int num_ports) {
+  ChassisConfig config;
+  config.mutable_chassis()->set_name("chassis-1");
+  auto* node = config.add_nodes();
+  node->set_id(kNodeId);
+  node->set_name("node-1");
+  for (int i = 0; i < num_ports; ++i) {
+    auto* singleton = config.add_singleton_ports();
+    singleton->set_id(i + 1);
+    singleton->set_name(absl::StrCat(i / 4 + 1, "/", i % 4));
+    singleton->set_node(kNodeId);
+    singleton->set_slot(1);
+    singleton->set_port(i / 4 + 1);
+    singleton->set_channel(i % 4);
+    singleton->set_speed_bps(kTwentyFiveGigBps);
+  }
+  return config;
+}
+
+// Looks up the state of the last port, as a Get for it would.
+void LookUpLastPort(const YangParseTree& tree, const ChassisConfig& config) {
+  const auto& name = config.singleton_ports().rbegin()->name();
+  const TreeNode* node = tree.FindNodeOrNull(
+      GetPath("interfaces")("interface", name)("state")("oper-status")());
+  CHECK(node != nullptr);
+  benchmark::DoNotOptimize(node);
+}
+
+// Arguments: number of ports.
+void BM_YangParseTreeInitialPush(benchmark::State& state) {
+  SwitchMock switch_mock;
+  const ChassisConfig config = MakeChassisConfig(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto tree = absl::make_unique<YangParseTree>(&switch_mock);
+    state.ResumeTiming();
+    tree->ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+    LookUpLastPort(*tree, config);
+    state.PauseTiming();
+    tree.reset();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_YangParseTreeInitialPush)->Arg(64)->Arg(512);
+
+// Arguments: number of ports.
+void BM_YangParseTreePushOnePortChange(benchmark::State& state) {
+  SwitchMock switch_mock;
+  ChassisConfig config = MakeChassisConfig(state.range(0));
+  YangParseTree tree(&switch_mock);
+  tree.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  auto* changed_port = config.mutable_singleton_ports(0);
+  for (auto _ : state) {
+    changed_port->set_speed_bps(changed_port->speed_bps() == kFortyGigBps
+                                    ? kTwentyFiveGigBps
+                                    : kFortyGigBps);
+    tree.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+    LookUpLastPort(tree, config);
+  }
+}
+BENCHMARK(BM_YangParseTreePushOnePortChange)->Arg(64)->Arg(512);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
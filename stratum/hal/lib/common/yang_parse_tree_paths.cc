@@ -265,8 +265,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -306,8 +305,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -341,8 +339,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -377,8 +374,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -422,8 +418,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -438,6 +433,16 @@ TreeNodeEventRegistration RegisterFunc() {
   };
 }
 
+// A helper method that hides the details of registering an event handler into
+// per event type handler list, for the events of one port only.
+template <typename E>
+TreeNodeEventRegistration RegisterFunc(uint64 node_id, uint32 port_id) {
+  return [node_id, port_id](const EventHandlerRecordPtr& record) {
+    return EventHandlerList<E>::GetInstance()->Register(
+        GnmiEventKey(node_id, port_id), record);
+  };
+}
+
 // A helper method that hides the details of registering an event handler into
 // two per event type handler lists.
 template <typename E1, typename E2>
@@ -512,8 +517,7 @@ TreeNodeEventHandler GetOnPollFunctor(
     // notify the controller that something went wrong. The error is logged when
     // it is created.
     // Here we ignore the node_id since it is not valid in this case.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     // Return the retrieved value.
     T value = (resp.*inner_message_get_field_func)();
@@ -550,8 +554,7 @@ TreeNodeEventHandler GetOnPollFunctor(
     // notify the controller that something went wrong. The error is logged when
     // it is created.
     // Here we ignore the node_id since it is not valid in this case.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     // Return the retrieved value. Note that we will return a default value if
     // the second level nest message does not exists.
@@ -924,7 +927,8 @@ void SetUpInterfacesInterfaceStateLastChange(uint64 node_id, uint32 port_id,
                        &OperStatus::time_last_changed);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortOperStateChangedEvent::GetTimeLastChanged);
-  auto register_functor = RegisterFunc<PortOperStateChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortOperStateChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -990,7 +994,8 @@ void SetUpInterfacesInterfaceStateOperStatus(uint64 node_id, uint32 port_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortOperStateChangedEvent::GetNewState,
       ConvertPortStateToString);
-  auto register_functor = RegisterFunc<PortOperStateChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortOperStateChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1010,7 +1015,8 @@ void SetUpInterfacesInterfaceStateAdminStatus(uint64 node_id, uint32 port_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortAdminStateChangedEvent::GetNewState,
       ConvertAdminStateToString);
-  auto register_functor = RegisterFunc<PortAdminStateChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortAdminStateChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1031,7 +1037,8 @@ void SetUpInterfacesInterfaceStateLoopbackMode(uint64 node_id, uint32 port_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortLoopbackStateChangedEvent::GetNewState,
       IsLoopbackStateEnabled);
-  auto register_functor = RegisterFunc<PortLoopbackStateChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortLoopbackStateChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1070,7 +1077,8 @@ void SetUpInterfacesInterfaceStateHealthIndicator(uint64 node_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortHealthIndicatorChangedEvent::GetState,
       ConvertHealthStateToString);
-  auto register_functor = RegisterFunc<PortHealthIndicatorChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortHealthIndicatorChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1139,7 +1147,8 @@ void SetUpInterfacesInterfaceConfigHealthIndicator(const std::string& state,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortHealthIndicatorChangedEvent::GetState,
       ConvertHealthStateToString);
-  auto register_functor = RegisterFunc<PortHealthIndicatorChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortHealthIndicatorChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1203,7 +1212,8 @@ void SetUpInterfacesInterfaceConfigEnabled(const bool state, uint64 node_id,
 
     return ::util::OkStatus();
   };
-  auto register_functor = RegisterFunc<PortAdminStateChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortAdminStateChangedEvent>(node_id, port_id);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortAdminStateChangedEvent::GetNewState,
       IsAdminStateEnabled);
@@ -1271,7 +1281,8 @@ void SetUpInterfacesInterfaceConfigLoopbackMode(const bool loopback,
 
     return ::util::OkStatus();
   };
-  auto register_functor = RegisterFunc<PortLoopbackStateChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortLoopbackStateChangedEvent>(node_id, port_id);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortLoopbackStateChangedEvent::GetNewState,
       IsLoopbackStateEnabled);
@@ -1297,7 +1308,8 @@ void SetUpLacpInterfacesInterfaceStateSystemIdMac(uint64 node_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortLacpRouterMacChangedEvent::GetSystemIdMac,
       MacAddressToYangString);
-  auto register_functor = RegisterFunc<PortLacpRouterMacChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortLacpRouterMacChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1317,7 +1329,8 @@ void SetUpLacpInterfacesInterfaceStateSystemPriority(uint64 node_id,
       &SystemPriority::priority);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortLacpSystemPriorityChangedEvent::GetSystemPriority);
-  auto register_functor = RegisterFunc<PortLacpSystemPriorityChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortLacpSystemPriorityChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1455,7 +1468,8 @@ void SetUpInterfacesInterfaceEthernetConfigPortSpeed(uint64 node_id,
 
     return ::util::OkStatus();
   };
-  auto register_functor = RegisterFunc<PortSpeedBpsChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortSpeedBpsChangedEvent>(node_id, port_id);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortSpeedBpsChangedEvent::GetSpeedBps,
       ConvertSpeedBpsToString);
@@ -1523,7 +1537,8 @@ void SetUpInterfacesInterfaceEthernetConfigAutoNegotiate(uint64 node_id,
 
     return ::util::OkStatus();
   };
-  auto register_functor = RegisterFunc<PortAutonegChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortAutonegChangedEvent>(node_id, port_id);
   auto on_change_functor =
       GetOnChangeFunctor(node_id, port_id, &PortAutonegChangedEvent::GetState,
                          IsPortAutonegEnabled);
@@ -1602,7 +1617,8 @@ void SetUpInterfacesInterfaceEthernetStateMacAddress(uint64 node_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortMacAddressChangedEvent::GetMacAddress,
       MacAddressToYangString);
-  auto register_functor = RegisterFunc<PortMacAddressChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortMacAddressChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1622,7 +1638,8 @@ void SetUpInterfacesInterfaceEthernetStatePortSpeed(uint64 node_id,
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortSpeedBpsChangedEvent::GetSpeedBps,
       ConvertSpeedBpsToString);
-  auto register_functor = RegisterFunc<PortSpeedBpsChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortSpeedBpsChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1642,7 +1659,8 @@ void SetUpInterfacesInterfaceEthernetStateNegotiatedPortSpeed(
       node_id, port_id,
       &PortNegotiatedSpeedBpsChangedEvent::GetNegotiatedSpeedBps,
       ConvertSpeedBpsToString);
-  auto register_functor = RegisterFunc<PortNegotiatedSpeedBpsChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortNegotiatedSpeedBpsChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1661,7 +1679,8 @@ void SetUpInterfacesInterfaceEthernetStateForwardingViability(
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortForwardingViabilityChangedEvent::GetState,
       ConvertTrunkMemberBlockStateToBool);
-  auto register_functor = RegisterFunc<PortForwardingViabilityChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortForwardingViabilityChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1682,7 +1701,8 @@ void SetUpInterfacesInterfaceEthernetStateAutoNegotiate(uint64 node_id,
   auto on_change_functor =
       GetOnChangeFunctor(node_id, port_id, &PortAutonegChangedEvent::GetState,
                          IsPortAutonegEnabled);
-  auto register_functor = RegisterFunc<PortAutonegChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortAutonegChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1699,29 +1719,23 @@ TreeNodeEventHandler GetPollCounterFunctor(uint64 node_id, uint32 port_id,
                                            uint64 (PortCounters::*func_ptr)()
                                                const,
                                            YangParseTree* tree) {
+  // All the counters leaves of all the ports of a node are served from a
+  // shared snapshot, which reads the counters of the node only once per
+  // refresh.
+  tree->GetPortCountersCache()->AddPort(node_id, port_id);
   return [tree, node_id, port_id, func_ptr](const GnmiEvent& event,
                                             const ::gnmi::Path& path,
                                             GnmiSubscribeStream* stream) {
-    // Create a data retrieval request.
-    DataRequest req;
-    auto* request = req.add_requests()->mutable_port_counters();
-    request->set_node_id(node_id);
-    request->set_port_id(port_id);
-
-    // In-place definition of method retrieving data from generic response
-    // and saving into 'resp' local variable.
+    // The snapshot is not taken through a DataRequestBatch, so it is only
+    // refreshed once the batch serves the responses.
+    if (tree->IsRecordingDataRequests()) return ::util::OkStatus();
+    // The returned status is ignored as there is no way to notify the
+    // controller that something went wrong. The error is logged when it is
+    // created.
     uint64 resp = 0;
-    DataResponseWriter writer(
-        [&resp, func_ptr](const DataResponse& in) -> bool {
-          if (!in.has_port_counters()) return false;
-          resp = (in.port_counters().*func_ptr)();
-          return true;
-        });
-    // Query the switch. The returned status is ignored as there is no way to
-    // notify the controller that something went wrong. The error is logged when
-    // it is created.
-    auto status = tree->GetSwitchInterface()->RetrieveValue(
-        node_id, req, &writer, /* details= */ nullptr);
+    auto counters =
+        tree->GetPortCountersCache()->GetPortCounters(node_id, port_id);
+    if (counters.ok()) resp = (counters.ValueOrDie().*func_ptr)();
     return SendResponse(GetResponse(path, resp), stream);
   };
 }
@@ -1736,7 +1750,8 @@ void SetUpInterfacesInterfaceStateCountersInOctets(uint64 node_id,
       GetPollCounterFunctor(node_id, port_id, &PortCounters::in_octets, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInOctets);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1759,7 +1774,8 @@ void SetUpInterfacesInterfaceStateCountersOutOctets(uint64 node_id,
       GetPollCounterFunctor(node_id, port_id, &PortCounters::out_octets, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetOutOctets);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1782,7 +1798,8 @@ void SetUpInterfacesInterfaceStateCountersInUnicastPkts(uint64 node_id,
       node_id, port_id, &PortCounters::in_unicast_pkts, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInUnicastPkts);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1805,7 +1822,8 @@ void SetUpInterfacesInterfaceStateCountersOutUnicastPkts(uint64 node_id,
       node_id, port_id, &PortCounters::out_unicast_pkts, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetOutUnicastPkts);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1828,7 +1846,8 @@ void SetUpInterfacesInterfaceStateCountersInBroadcastPkts(uint64 node_id,
       node_id, port_id, &PortCounters::in_broadcast_pkts, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInBroadcastPkts);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1849,7 +1868,8 @@ void SetUpInterfacesInterfaceStateCountersOutBroadcastPkts(
       node_id, port_id, &PortCounters::out_broadcast_pkts, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetOutBroadcastPkts);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1872,7 +1892,8 @@ void SetUpInterfacesInterfaceStateCountersInDiscards(uint64 node_id,
       GetPollCounterFunctor(node_id, port_id, &PortCounters::in_discards, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInDiscards);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1895,7 +1916,8 @@ void SetUpInterfacesInterfaceStateCountersOutDiscards(uint64 node_id,
                                             &PortCounters::out_discards, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetOutDiscards);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1918,7 +1940,8 @@ void SetUpInterfacesInterfaceStateCountersInUnknownProtos(uint64 node_id,
       node_id, port_id, &PortCounters::in_unknown_protos, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInUnknownProtos);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1941,7 +1964,8 @@ void SetUpInterfacesInterfaceStateCountersInMulticastPkts(uint64 node_id,
       node_id, port_id, &PortCounters::in_multicast_pkts, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInMulticastPkts);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1964,7 +1988,8 @@ void SetUpInterfacesInterfaceStateCountersInErrors(uint64 node_id,
       GetPollCounterFunctor(node_id, port_id, &PortCounters::in_errors, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInErrors);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -1987,7 +2012,8 @@ void SetUpInterfacesInterfaceStateCountersOutErrors(uint64 node_id,
       GetPollCounterFunctor(node_id, port_id, &PortCounters::out_errors, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetOutErrors);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -2010,7 +2036,8 @@ void SetUpInterfacesInterfaceStateCountersInFcsErrors(uint64 node_id,
                                             &PortCounters::in_fcs_errors, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetInFcsErrors);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -2031,7 +2058,8 @@ void SetUpInterfacesInterfaceStateCountersOutMulticastPkts(
       node_id, port_id, &PortCounters::out_multicast_pkts, tree);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, &PortCountersChangedEvent::GetOutMulticastPkts);
-  auto register_functor = RegisterFunc<PortCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortCountersChangedEvent>(node_id, port_id);
   node->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
@@ -2110,8 +2138,7 @@ void SetUpComponentsComponentChassisAlarmsMemoryErrorInfo(TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2213,8 +2240,7 @@ void SetUpComponentsComponentChassisAlarmsFlowProgrammingExceptionInfo(
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2290,8 +2316,7 @@ void SetUpComponentsComponentTransceiverStateSerialNo(TreeNode* node,
     // Query the switch. The returned status is ignored as there is no
     // way to notify the controller that something went wrong.
     // The error is logged when it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2328,8 +2353,7 @@ void SetUpComponentsComponentTransceiverStateVendor(TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is
     // logged when it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2366,8 +2390,7 @@ void SetUpComponentsComponentTransceiverStateVendorPart(TreeNode* node,
     // Query the switch. The returned status is ignored as there is no
     // way to notify the controller that something went wrong.
     // The error is logged when it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -3012,8 +3035,7 @@ void SetUpComponentsComponentStatePartNo(uint64 node_id, TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -3045,8 +3067,7 @@ void SetUpComponentsComponentStateMfgName(uint64 node_id, TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -3084,7 +3105,8 @@ void SetUpQosInterfacesInterfaceOutputQueuesQueueStateId(uint64 node_id,
       &DataResponse::has_port_qos_counters,
       &DataRequest::Request::mutable_port_qos_counters,
       &PortQosCounters::queue_id);
-  auto register_functor = RegisterFunc<PortQosCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortQosCountersChangedEvent>(node_id, port_id);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, queue_id, &PortQosCountersChangedEvent::GetQueueId);
   node->SetOnTimerHandler(poll_functor)
@@ -3104,7 +3126,8 @@ void SetUpQosInterfacesInterfaceOutputQueuesQueueStateTransmitPkts(
       &DataResponse::has_port_qos_counters,
       &DataRequest::Request::mutable_port_qos_counters,
       &PortQosCounters::out_pkts);
-  auto register_functor = RegisterFunc<PortQosCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortQosCountersChangedEvent>(node_id, port_id);
   auto on_change_functor =
       GetOnChangeFunctor(node_id, port_id, queue_id,
                          &PortQosCountersChangedEvent::GetTransmitPkts);
@@ -3125,7 +3148,8 @@ void SetUpQosInterfacesInterfaceOutputQueuesQueueStateTransmitOctets(
       &DataResponse::has_port_qos_counters,
       &DataRequest::Request::mutable_port_qos_counters,
       &PortQosCounters::out_octets);
-  auto register_functor = RegisterFunc<PortQosCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortQosCountersChangedEvent>(node_id, port_id);
   auto on_change_functor =
       GetOnChangeFunctor(node_id, port_id, queue_id,
                          &PortQosCountersChangedEvent::GetTransmitOctets);
@@ -3146,7 +3170,8 @@ void SetUpQosInterfacesInterfaceOutputQueuesQueueStateDroppedPkts(
       &DataResponse::has_port_qos_counters,
       &DataRequest::Request::mutable_port_qos_counters,
       &PortQosCounters::out_dropped_pkts);
-  auto register_functor = RegisterFunc<PortQosCountersChangedEvent>();
+  auto register_functor =
+      RegisterFunc<PortQosCountersChangedEvent>(node_id, port_id);
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, queue_id, &PortQosCountersChangedEvent::GetDroppedPkts);
   node->SetOnTimerHandler(poll_functor)
@@ -3215,8 +3240,7 @@ void SetUpDebugNodesNodePacketIoDebugString(uint64 node_id, TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
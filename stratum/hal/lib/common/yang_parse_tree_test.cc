@@ -2,6 +2,7 @@
 // Copyright 2018-present Open Networking Foundation
 // SPDX-License-Identifier: Apache-2.0
 
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "gnmi/gnmi.pb.h"
@@ -63,7 +64,7 @@ class YangParseTreeTest : public ::testing::Test {
   void PrintNode(const TreeNode& node, const std::string& prefix) const {
     LOG(INFO) << prefix << node.name();
     for (const auto& entry : node.children_) {
-      PrintNode(entry.second, prefix + " ");
+      PrintNode(*entry.second, prefix + " ");
     }
   }
 
@@ -73,7 +74,7 @@ class YangParseTreeTest : public ::testing::Test {
               << node.AllSubtreeLeavesSupportOnTimer() << " "
               << node.supports_on_timer_;
     for (const auto& entry : node.children_) {
-      PrintNodeWithOnTimer(entry.second, prefix + " ");
+      PrintNodeWithOnTimer(*entry.second, prefix + " ");
     }
   }
 
@@ -88,6 +89,11 @@ class YangParseTreeTest : public ::testing::Test {
     return parse_tree_.AddNode(path);
   }
 
+  size_t NumRemovedSubtrees() {
+    absl::WriterMutexLock l(&parse_tree_.root_access_lock_);
+    return parse_tree_.removed_subtrees_.size();
+  }
+
   // A proxy for YangParseTree::PerformActionForAllNonWildcardNodes().
   ::util::Status PerformActionForAllNonWildcardNodes(
       const gnmi::Path& path, const gnmi::Path& subpath,
@@ -703,6 +709,90 @@ TEST_F(YangParseTreeTest, PerformActionForAllNodesOnePresent) {
       GetPath("interfaces")("interface", "interface-1")("state")("ifindex")()));
 }
 
+// Check if a config push only updates the subtrees of the changed ports.
+TEST_F(YangParseTreeTest, ProcessPushedConfigIsIncremental) {
+  ChassisConfig config;
+  config.mutable_chassis()->set_name("chassis-1");
+  auto* node = config.add_nodes();
+  node->set_id(kInterface1NodeId);
+  node->set_name("node-1");
+  for (int i = 1; i <= 3; ++i) {
+    auto* singleton = config.add_singleton_ports();
+    singleton->set_name(absl::StrCat("interface-", i));
+    singleton->set_node(kInterface1NodeId);
+    singleton->set_id(i);
+    singleton->set_speed_bps(kTwentyFiveGigBps);
+  }
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+
+  const auto id_path = [](const std::string& name) {
+    return GetPath("interfaces")("interface", name)("state")("id")();
+  };
+  const TreeNode* unchanged = GetRoot().FindNodeOrNull(id_path("interface-1"));
+  const TreeNode* changed = GetRoot().FindNodeOrNull(id_path("interface-2"));
+  ASSERT_NE(unchanged, nullptr);
+  ASSERT_NE(changed, nullptr);
+  ASSERT_NE(GetRoot().FindNodeOrNull(id_path("interface-3")), nullptr);
+
+  // Change the speed of the second port and remove the third one.
+  config.mutable_singleton_ports(1)->set_speed_bps(kFortyGigBps);
+  config.mutable_singleton_ports()->RemoveLast();
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+
+  // The subtrees of the remaining ports are kept in place.
+  EXPECT_EQ(unchanged, GetRoot().FindNodeOrNull(id_path("interface-1")));
+  EXPECT_EQ(changed, GetRoot().FindNodeOrNull(id_path("interface-2")));
+  // The subtree of the removed port is gone.
+  EXPECT_EQ(nullptr, GetRoot().FindNodeOrNull(
+                         GetPath("interfaces")("interface", "interface-3")()));
+  // The wildcard subtree added at construction time is untouched.
+  EXPECT_NE(nullptr, GetRoot().FindNodeOrNull(id_path("*")));
+  EXPECT_NE(nullptr, GetRoot().FindNodeOrNull(
+                         GetPath("components")("component", "node-1")()));
+}
+
+// Check if a port removed by a config push can be added back by the next one.
+TEST_F(YangParseTreeTest, ProcessPushedConfigReAddsRemovedPort) {
+  ChassisConfig config;
+  auto* singleton = config.add_singleton_ports();
+  singleton->set_name("interface-1");
+  singleton->set_node(kInterface1NodeId);
+  singleton->set_id(kInterface1PortId);
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  const auto path = GetPath("interfaces")("interface", "interface-1")();
+  ASSERT_NE(nullptr, GetRoot().FindNodeOrNull(path));
+
+  ChassisConfig empty_config;
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(empty_config));
+  EXPECT_EQ(nullptr, GetRoot().FindNodeOrNull(path));
+
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  EXPECT_NE(nullptr, GetRoot().FindNodeOrNull(path));
+}
+
+// Check if a removed subtree is kept while a subscription holds a handler of
+// one of its nodes, and deleted by the first config push after that.
+TEST_F(YangParseTreeTest, ProcessPushedConfigDeletesUnusedRemovedSubtrees) {
+  ChassisConfig config;
+  auto* singleton = config.add_singleton_ports();
+  singleton->set_name("interface-1");
+  singleton->set_node(kInterface1NodeId);
+  singleton->set_id(kInterface1PortId);
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  const TreeNode* node = GetRoot().FindNodeOrNull(
+      GetPath("interfaces")("interface", "interface-1")("state")("id")());
+  ASSERT_NE(nullptr, node);
+  GnmiEventHandler handler = node->GetOnPollHandler();
+
+  ChassisConfig empty_config;
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(empty_config));
+  EXPECT_LT(0, NumRemovedSubtrees());
+
+  handler = nullptr;
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(empty_config));
+  EXPECT_EQ(0, NumRemovedSubtrees());
+}
+
 // Check if RetrieveValue is called.
 TEST_F(YangParseTreeTest, GetDataFromSwitchInterfaceCalled) {
   // Create a fake switch interface object.
@@ -1402,6 +1492,69 @@ TEST_F(YangParseTreeTest,
   EXPECT_EQ(resp.update().update(0).val().uint_val(), kInOctets);
 }
 
+// Check that the counters leaves of a port are served from a single snapshot
+// of the port counters.
+TEST_F(YangParseTreeTest,
+       InterfacesInterfaceStateCountersOnPollSharesOneSnapshot) {
+  constexpr uint64 kInOctets = 5;
+  constexpr uint64 kOutOctets = 6;
+
+  // Mock implementation of RetrieveValue() that sends a response with both
+  // counters set. It is expected to be called only once.
+  EXPECT_CALL(switch_, RetrieveValue(_, _, _, _))
+      .WillOnce(DoAll(WithArg<2>(Invoke([](WriterInterface<DataResponse>* w) {
+                        DataResponse resp;
+                        resp.mutable_port_counters()->set_in_octets(kInOctets);
+                        resp.mutable_port_counters()->set_out_octets(
+                            kOutOctets);
+                        w->Write(resp);
+                      })),
+                      Return(::util::OkStatus())));
+
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_OK(ExecuteOnPoll(GetPath("interfaces")("interface", "interface-1")(
+                              "state")("counters")("in-octets")(),
+                          &resp));
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_EQ(resp.update().update(0).val().uint_val(), kInOctets);
+
+  EXPECT_OK(ExecuteOnPoll(GetPath("interfaces")("interface", "interface-1")(
+                              "state")("counters")("out-octets")(),
+                          &resp));
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_EQ(resp.update().update(0).val().uint_val(), kOutOctets);
+}
+
+// Check that the counters leaves do not read the switch while the requests of
+// a batched poll are recorded.
+TEST_F(YangParseTreeTest,
+       InterfacesInterfaceStateCountersOnPollSkipsBatchRecording) {
+  constexpr uint64 kInOctets = 5;
+  auto path = GetPath("interfaces")(
+      "interface", "interface-1")("state")("counters")("in-octets")();
+
+  DataRequestBatch batch(&switch_);
+  parse_tree_.SetDataRequestBatchForThisThread(&batch);
+  EXPECT_CALL(switch_, RetrieveValue(_, _, _, _)).Times(0);
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_OK(ExecuteOnPoll(path, &resp));
+  EXPECT_EQ(0, parse_tree_.GetPortCountersCache()->GetNumSnapshots());
+  ::testing::Mock::VerifyAndClearExpectations(&switch_);
+
+  EXPECT_CALL(switch_, RetrieveValue(_, _, _, _))
+      .WillOnce(DoAll(WithArg<2>(Invoke([](WriterInterface<DataResponse>* w) {
+                        DataResponse resp;
+                        resp.mutable_port_counters()->set_in_octets(kInOctets);
+                        w->Write(resp);
+                      })),
+                      Return(::util::OkStatus())));
+  batch.Execute();
+  EXPECT_OK(ExecuteOnPoll(path, &resp));
+  parse_tree_.SetDataRequestBatchForThisThread(nullptr);
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_EQ(resp.update().update(0).val().uint_val(), kInOctets);
+}
+
 // Check if the 'counters/in-octets' OnChange action works correctly.
 TEST_F(YangParseTreeTest,
        InterfacesInterfaceStateCountersInOctetsOnChangeSuccess) {
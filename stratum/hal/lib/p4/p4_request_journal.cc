@@ -0,0 +1,354 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/p4/p4_request_journal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// The interval at which the background thread polls the empty queue.
+constexpr absl::Duration kPollInterval = absl::Milliseconds(10);
+
+// The maximum size of the records written with a single write() call.
+constexpr size_t kMaxBatchSizeBytes = 1024 * 1024;
+
+// The maximum size of the varint that precedes every record.
+constexpr int kMaxVarint32Bytes = 5;
+
+// Returns the size of the valid records at the start of the given file. A
+// zero-sized or truncated record marks the end. This skips the preallocated
+// tail of a journal file that was mapped when the process stopped.
+::util::StatusOr<uint64> FindEndOfRecords(int fd) {
+  off_t file_size = lseek(fd, 0, SEEK_END);
+  if (file_size < 0) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Could not seek in journal file: " << strerror(errno) << ".";
+  }
+  uint64 end = 0;
+  while (end < static_cast<uint64>(file_size)) {
+    uint8 header[kMaxVarint32Bytes];
+    ssize_t n = pread(fd, header,
+                      std::min<uint64>(sizeof(header), file_size - end), end);
+    if (n <= 0) break;
+    ::google::protobuf::io::CodedInputStream input(header, n);
+    uint32 record_size;
+    if (!input.ReadVarint32(&record_size) || record_size == 0) break;
+    uint64 next = end + input.CurrentPosition() + record_size;
+    if (next > static_cast<uint64>(file_size)) break;
+    end = next;
+  }
+  return end;
+}
+
+}  // namespace
+
+P4RequestJournal::P4RequestJournal(const std::string& path,
+                                   const Options& options)
+    : path_(path),
+      options_(options),
+      queue_(options.queue_capacity),
+      num_enqueued_(0),
+      num_processed_(0),
+      num_dropped_(0),
+      fd_(-1),
+      file_size_(0),
+      mapped_(nullptr),
+      mapped_size_(0) {}
+
+P4RequestJournal::~P4RequestJournal() {
+  shutdown_.Notify();
+  if (writer_thread_.joinable()) writer_thread_.join();
+}
+
+bool P4RequestJournal::AppendWriteRequest(
+    uint64 node_id, const ::p4::v1::WriteRequest& req,
+    const std::vector<::util::Status>& results, absl::Time timestamp) {
+  return Enqueue(node_id, results, timestamp,
+                 P4RequestJournalEntry::kWriteRequestFieldNumber, req);
+}
+
+bool P4RequestJournal::AppendReadRequest(
+    uint64 node_id, const ::p4::v1::ReadRequest& req,
+    const std::vector<::util::Status>& results, absl::Time timestamp) {
+  return Enqueue(node_id, results, timestamp,
+                 P4RequestJournalEntry::kReadRequestFieldNumber, req);
+}
+
+::util::Status P4RequestJournal::Flush(absl::Duration timeout) {
+  const uint64 target = num_enqueued_.load();
+  const absl::Time deadline = absl::Now() + timeout;
+  while (num_processed_.load() < target) {
+    if (absl::Now() > deadline) {
+      return MAKE_ERROR(ERR_OPER_TIMEOUT)
+             << "Timed out flushing the request journal " << path_ << ".";
+    }
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  return ::util::OkStatus();
+}
+
+uint64 P4RequestJournal::GetNumDroppedEntries() const {
+  return num_dropped_.load();
+}
+
+::util::StatusOr<std::unique_ptr<P4RequestJournal>>
+P4RequestJournal::CreateInstance(const std::string& path,
+                                 const Options& options) {
+  RET_CHECK(!path.empty()) << "Journal path is empty.";
+  RET_CHECK(options.max_file_size_bytes > 0)
+      << "Invalid max journal file size.";
+  // Using new to access the private constructor.
+  std::unique_ptr<P4RequestJournal> journal(
+      new P4RequestJournal(path, options));
+  RETURN_IF_ERROR(journal->OpenFile());
+  journal->writer_thread_ = std::thread(&P4RequestJournal::Run, journal.get());
+
+  return std::move(journal);
+}
+
+::util::Status P4RequestJournal::ReadEntries(
+    const std::string& path,
+    const std::function<::util::Status(const P4RequestJournalEntry&)>&
+        callback) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return MAKE_ERROR(ERR_FILE_NOT_FOUND)
+           << "Could not open journal file " << path << ": " << strerror(errno)
+           << ".";
+  }
+  ::google::protobuf::io::FileInputStream input(fd);
+  input.SetCloseOnDelete(true);
+  while (true) {
+    P4RequestJournalEntry entry;
+    bool clean_eof = false;
+    if (!::google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+            &entry, &input, &clean_eof)) {
+      if (clean_eof) break;
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Truncated or corrupt record in journal file " << path << ".";
+    }
+    // An empty record marks the end of a preallocated journal file.
+    if (entry.ByteSizeLong() == 0) break;
+    RETURN_IF_ERROR(callback(entry));
+  }
+
+  return ::util::OkStatus();
+}
+
+bool P4RequestJournal::Enqueue(uint64 node_id,
+                               const std::vector<::util::Status>& results,
+                               absl::Time timestamp, int request_field_number,
+                               const ::google::protobuf::Message& req) {
+  using ::google::protobuf::internal::WireFormatLite;
+
+  P4RequestJournalEntry header;
+  header.set_timestamp_us(absl::ToUnixMicros(timestamp));
+  header.set_node_id(node_id);
+  for (const auto& result : results) {
+    auto* r = header.add_results();
+    if (!result.ok()) {
+      r->set_error_code(result.error_code());
+      r->set_error_message(result.error_message());
+    }
+  }
+  // The request is serialized straight into the record as the last field of
+  // the entry, instead of being copied into the entry first.
+  std::string record = header.SerializeAsString();
+  {
+    ::google::protobuf::io::StringOutputStream output(&record);
+    ::google::protobuf::io::CodedOutputStream coded(&output);
+    coded.WriteTag(WireFormatLite::MakeTag(
+        request_field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+    coded.WriteVarint32(req.ByteSizeLong());
+    req.SerializeWithCachedSizes(&coded);
+  }
+
+  // Counted before the push, so that Flush() also waits for entries that are
+  // being pushed concurrently and may be popped before this one. A dropped
+  // entry counts as processed right away.
+  ++num_enqueued_;
+  if (!queue_.TryPush(std::move(record))) {
+    ++num_dropped_;
+    ++num_processed_;
+    LOG_EVERY_N(WARNING, 100) << "Request journal " << path_
+                              << " is full. Dropped " << num_dropped_.load()
+                              << " entries so far.";
+    return false;
+  }
+
+  return true;
+}
+
+void P4RequestJournal::Run() {
+  std::string records;
+  std::string record;
+  while (true) {
+    records.clear();
+    uint64 num_records = 0;
+    while (records.size() < kMaxBatchSizeBytes && queue_.TryPop(&record)) {
+      uint8 header[kMaxVarint32Bytes];
+      uint8* end = ::google::protobuf::io::CodedOutputStream::
+          WriteVarint32ToArray(record.size(), header);
+      records.append(reinterpret_cast<const char*>(header), end - header);
+      records.append(record);
+      ++num_records;
+    }
+    if (num_records > 0) {
+      ::util::Status status = WriteRecords(records);
+      if (!status.ok()) {
+        num_dropped_ += num_records;
+        LOG_EVERY_N(ERROR, 50)
+            << "Failed to write to request journal " << path_ << ": "
+            << status.error_message();
+      }
+      num_processed_ += num_records;
+      continue;
+    }
+    // The queue is drained completely before shutting down.
+    if (shutdown_.HasBeenNotified()) break;
+    shutdown_.WaitForNotificationWithTimeout(kPollInterval);
+  }
+  ::util::Status status = CloseFile();
+  LOG_IF(ERROR, !status.ok()) << "Failed to close request journal " << path_
+                              << ": " << status.error_message();
+}
+
+::util::Status P4RequestJournal::WriteRecords(const std::string& records) {
+  if (fd_ < 0) RETURN_IF_ERROR(OpenFile());
+  if (file_size_ > 0 &&
+      file_size_ + records.size() > options_.max_file_size_bytes) {
+    RETURN_IF_ERROR(RotateFile());
+  }
+  if (options_.use_mmap) {
+    if (file_size_ + records.size() > mapped_size_) {
+      RETURN_IF_ERROR(MapFile(file_size_ + records.size()));
+    }
+    memcpy(mapped_ + file_size_, records.data(), records.size());
+  } else {
+    size_t written = 0;
+    while (written < records.size()) {
+      ssize_t n =
+          write(fd_, records.data() + written, records.size() - written);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        return MAKE_ERROR(ERR_INTERNAL) << "Could not write to " << path_
+                                        << ": " << strerror(errno) << ".";
+      }
+      written += n;
+    }
+  }
+  file_size_ += records.size();
+
+  return ::util::OkStatus();
+}
+
+::util::Status P4RequestJournal::OpenFile() {
+  fd_ = open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Could not open journal file " << path_
+                                    << ": " << strerror(errno) << ".";
+  }
+  // Cut off what follows the last complete record, so that new records are
+  // appended right after it.
+  ASSIGN_OR_RETURN(file_size_, FindEndOfRecords(fd_));
+  if (ftruncate(fd_, file_size_) != 0 ||
+      lseek(fd_, file_size_, SEEK_SET) < 0) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Could not truncate journal file "
+                                    << path_ << ": " << strerror(errno) << ".";
+  }
+  if (options_.use_mmap) RETURN_IF_ERROR(MapFile(file_size_));
+
+  return ::util::OkStatus();
+}
+
+::util::Status P4RequestJournal::CloseFile() {
+  if (fd_ < 0) return ::util::OkStatus();
+  ::util::Status status = ::util::OkStatus();
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+    // Give back the preallocated space that was not used.
+    if (ftruncate(fd_, file_size_) != 0) {
+      APPEND_ERROR(status) << "Could not truncate journal file " << path_
+                           << ": " << strerror(errno) << ".";
+    }
+  }
+  close(fd_);
+  fd_ = -1;
+  file_size_ = 0;
+
+  return status;
+}
+
+::util::Status P4RequestJournal::RotateFile() {
+  RETURN_IF_ERROR(CloseFile());
+  if (options_.max_num_rotated_files <= 0) {
+    if (unlink(path_.c_str()) != 0 && errno != ENOENT) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Could not remove journal file "
+                                      << path_ << ": " << strerror(errno)
+                                      << ".";
+    }
+  } else {
+    for (int i = options_.max_num_rotated_files - 1; i >= 0; --i) {
+      std::string from = i == 0 ? path_ : absl::StrCat(path_, ".", i);
+      std::string to = absl::StrCat(path_, ".", i + 1);
+      if (rename(from.c_str(), to.c_str()) != 0 && errno != ENOENT) {
+        return MAKE_ERROR(ERR_INTERNAL) << "Could not rename " << from
+                                        << " to " << to << ": "
+                                        << strerror(errno) << ".";
+      }
+    }
+  }
+
+  return OpenFile();
+}
+
+::util::Status P4RequestJournal::MapFile(uint64 min_size) {
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+  }
+  uint64 size = std::max(min_size, options_.max_file_size_bytes);
+  if (ftruncate(fd_, size) != 0) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Could not preallocate journal file "
+                                    << path_ << ": " << strerror(errno) << ".";
+  }
+  void* mapped =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mapped == MAP_FAILED) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Could not map journal file " << path_
+                                    << ": " << strerror(errno) << ".";
+  }
+  mapped_ = static_cast<char*>(mapped);
+  mapped_size_ = size;
+
+  return ::util::OkStatus();
+}
+
+}  // namespace hal
+}  // namespace stratum
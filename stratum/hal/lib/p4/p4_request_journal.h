@@ -0,0 +1,148 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_P4_P4_REQUEST_JOURNAL_H_
+#define STRATUM_HAL_LIB_P4_P4_REQUEST_JOURNAL_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/p4/p4_request_journal.pb.h"
+#include "stratum/lib/channel/ring_buffer.h"
+
+namespace stratum {
+namespace hal {
+
+// The class "P4RequestJournal" records P4Runtime Write and Read requests and
+// their results in a binary journal file, for later debugging and replay. The
+// RPC threads only serialize the request and push it into a bounded lock-free
+// queue. A background thread drains the queue and appends the entries to the
+// file as length-delimited P4RequestJournalEntry protos. Entries are dropped,
+// and counted, if the queue is full. Once the file reaches its maximum size it
+// is rotated to <path>.1, <path>.1 to <path>.2, and so on.
+// This class is thread-safe.
+class P4RequestJournal {
+ public:
+  struct Options {
+    // The maximum number of entries waiting to be written.
+    size_t queue_capacity = 4096;
+    // The size after which the journal file is rotated.
+    uint64 max_file_size_bytes = 64 * 1024 * 1024;
+    // The number of rotated files kept next to the journal file. With zero,
+    // the journal file is truncated instead of rotated.
+    int max_num_rotated_files = 4;
+    // If true, the journal file is preallocated to its maximum size and
+    // written through a shared memory mapping instead of write() calls.
+    bool use_mmap = false;
+  };
+
+  virtual ~P4RequestJournal();
+
+  // Journals a Write request and the per-update results. Never blocks. Returns
+  // false if the entry was dropped.
+  bool AppendWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
+                          const std::vector<::util::Status>& results,
+                          absl::Time timestamp);
+
+  // Journals a Read request and the per-entity results. Never blocks. Returns
+  // false if the entry was dropped.
+  bool AppendReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
+                         const std::vector<::util::Status>& results,
+                         absl::Time timestamp);
+
+  // Waits until all the entries appended before this call have been written to
+  // the journal file or dropped.
+  ::util::Status Flush(absl::Duration timeout);
+
+  // Returns the number of entries dropped so far, either because the queue was
+  // full or because they could not be written.
+  uint64 GetNumDroppedEntries() const;
+
+  // Creates a journal appending to the file at the given path and starts its
+  // background thread.
+  static ::util::StatusOr<std::unique_ptr<P4RequestJournal>> CreateInstance(
+      const std::string& path, const Options& options);
+
+  // Reads the journal file at the given path and calls 'callback' for every
+  // entry, in order. Stops at the first error returned by the callback.
+  static ::util::Status ReadEntries(
+      const std::string& path,
+      const std::function<::util::Status(const P4RequestJournalEntry&)>&
+          callback);
+
+  // P4RequestJournal is neither copyable nor movable.
+  P4RequestJournal(const P4RequestJournal&) = delete;
+  P4RequestJournal& operator=(const P4RequestJournal&) = delete;
+
+ private:
+  // Private constructor, use CreateInstance() to create an instance.
+  P4RequestJournal(const std::string& path, const Options& options);
+
+  // Serializes an entry with the given header fields, followed by an already
+  // serialized request field, and pushes it into the queue.
+  bool Enqueue(uint64 node_id, const std::vector<::util::Status>& results,
+               absl::Time timestamp, int request_field_number,
+               const ::google::protobuf::Message& req);
+
+  // The body of the background thread.
+  void Run();
+
+  // Appends the given length-delimited records to the journal file, rotating
+  // it if needed.
+  ::util::Status WriteRecords(const std::string& records);
+
+  // Opens the journal file for appending and, in mmap mode, maps it.
+  ::util::Status OpenFile();
+
+  // Unmaps and closes the journal file, if open.
+  ::util::Status CloseFile();
+
+  // Closes the journal file and shifts it and the rotated files by one.
+  ::util::Status RotateFile();
+
+  // Grows the file to at least 'min_size' bytes and (re)maps it.
+  ::util::Status MapFile(uint64 min_size);
+
+  // The path of the journal file.
+  const std::string path_;
+
+  const Options options_;
+
+  // The queue of serialized entries.
+  RingBuffer<std::string> queue_;
+
+  // The number of entries appended and the number of those that have been
+  // written or dropped.
+  std::atomic<uint64> num_enqueued_;
+  std::atomic<uint64> num_processed_;
+
+  // The number of dropped entries.
+  std::atomic<uint64> num_dropped_;
+
+  // Notified to stop the background thread.
+  absl::Notification shutdown_;
+
+  // The state of the journal file. Only accessed by the background thread
+  // after construction.
+  int fd_;
+  uint64 file_size_;
+  char* mapped_;
+  uint64 mapped_size_;
+
+  std::thread writer_thread_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_P4_P4_REQUEST_JOURNAL_H_
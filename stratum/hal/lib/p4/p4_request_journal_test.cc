@@ -0,0 +1,194 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/p4/p4_request_journal.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "gflags/gflags.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+DECLARE_string(test_tmpdir);
+
+namespace stratum {
+namespace hal {
+namespace {
+
+using test_utils::EqualsProto;
+using test_utils::StatusIs;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+constexpr uint64 kNodeId = 1;
+constexpr absl::Duration kFlushTimeout = absl::Seconds(10);
+
+class P4RequestJournalTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(FLAGS_test_tmpdir, "/p4_request_journal",
+                         GetParam() ? "_mmap" : "", ".bin");
+    for (const auto& path : {path_, path_ + ".1", path_ + ".2", path_ + ".3"}) {
+      if (PathExists(path)) {
+        ASSERT_OK(RemoveFile(path));
+      }
+    }
+    options_.use_mmap = GetParam();
+  }
+
+  // Returns a write request with a single table entry insert.
+  static ::p4::v1::WriteRequest MakeWriteRequest(uint32 table_id) {
+    ::p4::v1::WriteRequest req;
+    req.set_device_id(kNodeId);
+    auto* update = req.add_updates();
+    update->set_type(::p4::v1::Update::INSERT);
+    update->mutable_entity()->mutable_table_entry()->set_table_id(table_id);
+    return req;
+  }
+
+  // Returns all the entries of the journal file at the given path.
+  static std::vector<P4RequestJournalEntry> ReadEntries(
+      const std::string& path) {
+    std::vector<P4RequestJournalEntry> entries;
+    EXPECT_OK(P4RequestJournal::ReadEntries(
+        path, [&entries](const P4RequestJournalEntry& entry) -> ::util::Status {
+          entries.push_back(entry);
+          return ::util::OkStatus();
+        }));
+    return entries;
+  }
+
+  std::string path_;
+  P4RequestJournal::Options options_;
+};
+
+TEST_P(P4RequestJournalTest, AppendAndReadEntries) {
+  ASSERT_OK_AND_ASSIGN(auto journal,
+                       P4RequestJournal::CreateInstance(path_, options_));
+  const ::p4::v1::WriteRequest write_req = MakeWriteRequest(1);
+  ::p4::v1::ReadRequest read_req;
+  read_req.set_device_id(kNodeId);
+  read_req.add_entities()->mutable_table_entry();
+  const absl::Time timestamp = absl::FromUnixMicros(1234567);
+  EXPECT_TRUE(journal->AppendWriteRequest(
+      kNodeId, write_req,
+      {::util::Status(StratumErrorSpace(), ERR_ENTRY_EXISTS, "exists")},
+      timestamp));
+  EXPECT_TRUE(journal->AppendReadRequest(kNodeId, read_req,
+                                         {::util::OkStatus()}, timestamp));
+  ASSERT_OK(journal->Flush(kFlushTimeout));
+
+  auto entries = ReadEntries(path_);
+  ASSERT_THAT(entries, SizeIs(2));
+  EXPECT_EQ(1234567, entries[0].timestamp_us());
+  EXPECT_EQ(kNodeId, entries[0].node_id());
+  EXPECT_THAT(entries[0].write_request(), EqualsProto(write_req));
+  ASSERT_EQ(1, entries[0].results_size());
+  EXPECT_EQ(ERR_ENTRY_EXISTS, entries[0].results(0).error_code());
+  EXPECT_EQ("exists", entries[0].results(0).error_message());
+  EXPECT_THAT(entries[1].read_request(), EqualsProto(read_req));
+  ASSERT_EQ(1, entries[1].results_size());
+  EXPECT_EQ(0, entries[1].results(0).error_code());
+  EXPECT_EQ(0, journal->GetNumDroppedEntries());
+}
+
+TEST_P(P4RequestJournalTest, AppendsToExistingFile) {
+  {
+    ASSERT_OK_AND_ASSIGN(auto journal,
+                         P4RequestJournal::CreateInstance(path_, options_));
+    EXPECT_TRUE(journal->AppendWriteRequest(kNodeId, MakeWriteRequest(1), {},
+                                            absl::Now()));
+    EXPECT_TRUE(journal->AppendWriteRequest(kNodeId, MakeWriteRequest(2), {},
+                                            absl::Now()));
+  }
+  ASSERT_OK_AND_ASSIGN(auto journal,
+                       P4RequestJournal::CreateInstance(path_, options_));
+  EXPECT_TRUE(journal->AppendWriteRequest(kNodeId, MakeWriteRequest(3), {},
+                                          absl::Now()));
+  ASSERT_OK(journal->Flush(kFlushTimeout));
+
+  auto entries = ReadEntries(path_);
+  ASSERT_THAT(entries, SizeIs(3));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(entries[i].write_request(),
+                EqualsProto(MakeWriteRequest(i + 1)));
+  }
+}
+
+TEST_P(P4RequestJournalTest, RotatesFiles) {
+  options_.max_file_size_bytes = 1024;
+  options_.max_num_rotated_files = 2;
+  ASSERT_OK_AND_ASSIGN(auto journal,
+                       P4RequestJournal::CreateInstance(path_, options_));
+  constexpr int kNumEntries = 150;
+  for (int i = 0; i < kNumEntries; ++i) {
+    EXPECT_TRUE(journal->AppendWriteRequest(kNodeId, MakeWriteRequest(i), {},
+                                            absl::Now()));
+    // Flushing every entry makes every write hit the size limit in order.
+    ASSERT_OK(journal->Flush(kFlushTimeout));
+  }
+  EXPECT_TRUE(PathExists(path_ + ".1"));
+  EXPECT_TRUE(PathExists(path_ + ".2"));
+  EXPECT_FALSE(PathExists(path_ + ".3"));
+
+  // The newest entries are in the journal file, preceded by the rotated files.
+  std::vector<P4RequestJournalEntry> entries;
+  for (const auto& path : {path_ + ".2", path_ + ".1", path_}) {
+    std::string content;
+    ASSERT_OK(ReadFileToString(path, &content));
+    EXPECT_LE(content.size(), options_.max_file_size_bytes);
+    for (const auto& entry : ReadEntries(path)) entries.push_back(entry);
+  }
+  ASSERT_FALSE(entries.empty());
+  ASSERT_LT(entries.size(), kNumEntries);
+  int first = kNumEntries - entries.size();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const auto& update = entries[i].write_request().updates(0);
+    EXPECT_EQ(first + i, update.entity().table_entry().table_id());
+  }
+}
+
+TEST_P(P4RequestJournalTest, ReadEntriesStopsOnCallbackError) {
+  ASSERT_OK_AND_ASSIGN(auto journal,
+                       P4RequestJournal::CreateInstance(path_, options_));
+  EXPECT_TRUE(journal->AppendWriteRequest(kNodeId, MakeWriteRequest(1), {},
+                                          absl::Now()));
+  EXPECT_TRUE(journal->AppendWriteRequest(kNodeId, MakeWriteRequest(2), {},
+                                          absl::Now()));
+  ASSERT_OK(journal->Flush(kFlushTimeout));
+
+  int num_entries = 0;
+  EXPECT_THAT(P4RequestJournal::ReadEntries(
+                  path_,
+                  [&num_entries](
+                      const P4RequestJournalEntry& entry) -> ::util::Status {
+                    ++num_entries;
+                    return MAKE_ERROR(ERR_INVALID_PARAM) << "some error";
+                  }),
+              StatusIs(_, ERR_INVALID_PARAM, HasSubstr("some error")));
+  EXPECT_EQ(1, num_entries);
+}
+
+TEST_P(P4RequestJournalTest, ReadEntriesFromMissingFile) {
+  EXPECT_THAT(P4RequestJournal::ReadEntries(
+                  path_,
+                  [](const P4RequestJournalEntry& entry) -> ::util::Status {
+                    return ::util::OkStatus();
+                  }),
+              StatusIs(_, ERR_FILE_NOT_FOUND, _));
+}
+
+INSTANTIATE_TEST_SUITE_P(P4RequestJournalTestWithMmap, P4RequestJournalTest,
+                         ::testing::Bool());
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
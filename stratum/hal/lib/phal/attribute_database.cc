@@ -14,13 +14,19 @@
 #include "absl/time/time.h"
 #include "google/protobuf/util/message_differencer.h"
 #include "stratum/glue/status/status_macros.h"
-#include "stratum/hal/lib/phal/dummy_threadpool.h"
+#include "stratum/hal/lib/phal/work_stealing_threadpool.h"
 #include "stratum/lib/constants.h"
 #include "stratum/lib/macros.h"
 #include "stratum/lib/utils.h"
 
 DEFINE_string(phal_config_file, "",
               "The path to read the PhalInitConfig proto file from.");
+DEFINE_int32(phal_threadpool_num_threads, 8,
+             "Number of threads used to update the PHAL datasources.");
+DEFINE_int32(phal_threadpool_max_tasks_per_group, 4,
+             "Maximum number of datasource updates of the same concurrency "
+             "group (e.g. the same I2C bus) which run at the same time. A "
+             "non-positive value means no limit.");
 
 namespace stratum {
 namespace hal {
@@ -186,9 +192,11 @@ AttributeDatabase::~AttributeDatabase() {
 
 ::util::StatusOr<std::unique_ptr<AttributeDatabase>>
 AttributeDatabase::MakePhalDb(std::unique_ptr<AttributeGroup> root_group) {
-  ASSIGN_OR_RETURN(
-      std::unique_ptr<AttributeDatabase> database,
-      Make(std::move(root_group), absl::make_unique<DummyThreadpool>()));
+  ASSIGN_OR_RETURN(std::unique_ptr<AttributeDatabase> database,
+                   Make(std::move(root_group),
+                        absl::make_unique<WorkStealingThreadpool>(
+                            FLAGS_phal_threadpool_num_threads,
+                            FLAGS_phal_threadpool_max_tasks_per_group)));
 
   // Create and run PhalDb service
   {
@@ -403,29 +403,34 @@ void AttributeGroupQueryNode::RemoveAllFields() {
   // and have a list of all the datasources and attributes we'll need to touch.
   // We can now execute our query in a threadpool.
   ::util::Status output_status;
-  absl::Mutex output_status_lock;
+  // Protects output_status and the query result written by the setters. Only
+  // the datasource updates run in parallel.
+  absl::Mutex output_lock;
   {
     // We acquire our query lock to avoid messy interleaving with other calls to
     // Get().
     absl::MutexLock l(&query_lock_);
     threadpool_->Start();
-    std::vector<TaskId> task_ids(datasources.size());
+    std::vector<TaskId> task_ids;
+    task_ids.reserve(datasources.size());
     for (auto& datasource_and_attributes : datasources) {
-      task_ids.push_back(threadpool_->Schedule([&]() {
-        ::util::Status update_status =
-            datasource_and_attributes.first->UpdateValuesAndLock();
-        if (update_status.ok()) {
-          for (auto& attribute_and_setter : datasource_and_attributes.second) {
-            update_status = (*attribute_and_setter.second)(
-                attribute_and_setter.first->GetValue());
-          }
-        }
-        if (!update_status.ok()) {
-          absl::MutexLock l(&output_status_lock);
-          APPEND_STATUS_IF_ERROR(output_status, update_status);
-        }
-        datasource_and_attributes.first->Unlock();
-      }));
+      DataSource* datasource = datasource_and_attributes.first;
+      task_ids.push_back(threadpool_->ScheduleWithOptions(
+          [&output_status, &output_lock, &datasource_and_attributes,
+           datasource]() {
+            ::util::Status update_status = datasource->UpdateValuesAndLock();
+            absl::MutexLock l(&output_lock);
+            if (update_status.ok()) {
+              for (auto& attribute_and_setter :
+                   datasource_and_attributes.second) {
+                update_status = (*attribute_and_setter.second)(
+                    attribute_and_setter.first->GetValue());
+              }
+            }
+            APPEND_STATUS_IF_ERROR(output_status, update_status);
+            datasource->Unlock();
+          },
+          datasource->GetUpdateTaskOptions()));
     }
     threadpool_->WaitAll(task_ids);
     out->CopyFrom(*query_result_);
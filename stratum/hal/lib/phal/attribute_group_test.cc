@@ -17,6 +17,7 @@
 #include "stratum/hal/lib/phal/managed_attribute_mock.h"
 #include "stratum/hal/lib/phal/test/test.pb.h"
 #include "stratum/hal/lib/phal/test_util.h"
+#include "stratum/hal/lib/phal/work_stealing_threadpool.h"
 #include "stratum/lib/test_utils/matchers.h"
 
 namespace stratum {
@@ -945,6 +946,36 @@ TEST_F(AttributeGroupQueryTest, CanQueryRepeatedTerminalGroup) {
   EXPECT_EQ(result.repeated_sub(1).val1(), kInt32TestVal);
 }
 
+// Runs the datasource updates of a query on worker threads, with the
+// threadpool used by the attribute database.
+TEST_F(AttributeGroupQueryTest, CanCallQueryGetOnWorkStealingThreadpool) {
+  constexpr int kNumRepeatedSubs = 16;
+  ASSERT_OK(AddSingleQueryPath());
+  for (int i = 0; i < kNumRepeatedSubs; ++i) {
+    ASSERT_OK(AddRepeatedQueryPath());
+  }
+  WorkStealingThreadpool threadpool(4, 1);
+  threadpool.Start();
+  AttributeGroupQuery query(group_.get(), &threadpool);
+  PathEntry repeated_entry("repeated_sub");
+  repeated_entry.indexed = true;
+  repeated_entry.all = true;
+  ASSERT_OK(group_->AcquireReadable()->RegisterQuery(
+      &query, {{PathEntry("single_sub"), PathEntry("val1")},
+               {repeated_entry, PathEntry("val1")}}));
+
+  for (int i = 0; i < 3; ++i) {
+    TestTop result;
+    ASSERT_OK(query.Get(&result));
+    ASSERT_TRUE(result.has_single_sub());
+    EXPECT_EQ(result.single_sub().val1(), kInt32TestVal);
+    ASSERT_EQ(result.repeated_sub_size(), kNumRepeatedSubs);
+    for (const auto& repeated_sub : result.repeated_sub()) {
+      EXPECT_EQ(repeated_sub.val1(), kInt32TestVal);
+    }
+  }
+}
+
 class AttributeGroupSetTest : public ::testing::Test {
  public:
   AttributeGroupSetTest() {
@@ -15,6 +15,7 @@
 #include "stratum/hal/lib/phal/attribute_database_interface.h"
 #include "stratum/hal/lib/phal/managed_attribute.h"
 #include "stratum/hal/lib/phal/phal.pb.h"
+#include "stratum/hal/lib/phal/threadpool_interface.h"
 
 namespace stratum {
 namespace hal {
@@ -71,6 +72,11 @@ class DataSource : public std::enable_shared_from_this<DataSource> {
   virtual std::shared_ptr<DataSource> GetSharedPointer() {
     return shared_from_this();
   }
+  // Returns the options used to schedule UpdateValuesAndLock() in the
+  // threadpool of a query. Datasources which access the same bus or device
+  // should return the same concurrency group, so that a query does not flood
+  // it with parallel requests.
+  virtual TaskOptions GetUpdateTaskOptions() const { return TaskOptions(); }
 
   // Updates this datasource without acquiring a lock, and skips all caching
   // behavior. This is generally unsafe, and should never be called while this
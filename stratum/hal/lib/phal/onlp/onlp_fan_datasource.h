@@ -58,6 +58,15 @@ class OnlpFanDataSource : public DataSource {
   ManagedAttribute* GetCapGetRpm() { return &fan_cap_get_rpm_; }
   ManagedAttribute* GetCapGetPercentage() { return &fan_cap_get_percentage_; }
 
+  // ONLP does not serialize concurrent calls into the platform library, so
+  // the updates of all ONLP datasources share one concurrency group.
+  TaskOptions GetUpdateTaskOptions() const override {
+    TaskOptions options;
+    options.concurrency_group = kOnlpConcurrencyGroup;
+    options.max_group_concurrency = 1;
+    return options;
+  }
+
  private:
   OnlpFanDataSource(int fan_id, OnlpInterface* onlp_interface,
                     CachePolicy* cache_policy, const FanInfo& fan_info);
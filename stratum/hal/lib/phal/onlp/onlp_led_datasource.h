@@ -63,6 +63,15 @@ class OnlpLedDataSource : public DataSource {
   ManagedAttribute* GetCapPurple() { return &led_cap_purple_; }
   ManagedAttribute* GetCapPurpleBlinking() { return &led_cap_purple_blinking_; }
 
+  // ONLP does not serialize concurrent calls into the platform library, so
+  // the updates of all ONLP datasources share one concurrency group.
+  TaskOptions GetUpdateTaskOptions() const override {
+    TaskOptions options;
+    options.concurrency_group = kOnlpConcurrencyGroup;
+    options.max_group_concurrency = 1;
+    return options;
+  }
+
  private:
   OnlpLedDataSource(int led_id, OnlpInterface* onlp_interface,
                     CachePolicy* cache_policy, const LedInfo& led_info);
@@ -54,6 +54,15 @@ class OnlpPsuDataSource : public DataSource {
   ManagedAttribute* GetCapGetPIn() { return &psu_cap_pin_; }
   ManagedAttribute* GetCapGetPOut() { return &psu_cap_pout_; }
 
+  // ONLP does not serialize concurrent calls into the platform library, so
+  // the updates of all ONLP datasources share one concurrency group.
+  TaskOptions GetUpdateTaskOptions() const override {
+    TaskOptions options;
+    options.concurrency_group = kOnlpConcurrencyGroup;
+    options.max_group_concurrency = 1;
+    return options;
+  }
+
  private:
   OnlpPsuDataSource(int psu_id, OnlpInterface* onlp_interface,
                     CachePolicy* cache_policy, const PsuInfo& psu_info);
@@ -65,6 +65,17 @@ class OnlpSfpDataSource : public DataSource {
     return &tx_bias_[channel_index];
   }
 
+  // ONLP does not serialize concurrent calls into the platform library, so
+  // the updates of all ONLP datasources share one concurrency group. This
+  // also keeps the transceivers, which share one management bus, from being
+  // read in parallel.
+  TaskOptions GetUpdateTaskOptions() const override {
+    TaskOptions options;
+    options.concurrency_group = kOnlpConcurrencyGroup;
+    options.max_group_concurrency = 1;
+    return options;
+  }
+
  private:
   OnlpSfpDataSource(int id, OnlpInterface* onlp_interface,
                     CachePolicy* cache_policy, const SfpInfo& sfp_info);
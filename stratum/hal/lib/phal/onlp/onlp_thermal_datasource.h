@@ -54,6 +54,15 @@ class OnlpThermalDataSource : public DataSource {
     return &thermal_cap_shutdown_thresh_;
   }
 
+  // ONLP does not serialize concurrent calls into the platform library, so
+  // the updates of all ONLP datasources share one concurrency group.
+  TaskOptions GetUpdateTaskOptions() const override {
+    TaskOptions options;
+    options.concurrency_group = kOnlpConcurrencyGroup;
+    options.max_group_concurrency = 1;
+    return options;
+  }
+
  private:
   OnlpThermalDataSource(int thermal_id, OnlpInterface* onlp_interface,
                         CachePolicy* cache_policy,
@@ -46,6 +46,10 @@ using SffInfo = sff_info_t;
 using OnlpSfpInfo = onlp_sfp_info_t;
 using OnlpPortNumber = onlp_oid_t;
 
+// The concurrency group of the updates of all ONLP datasources in the PHAL
+// threadpool. Only one of them runs at a time.
+constexpr char kOnlpConcurrencyGroup[] = "onlp";
+
 // This class encapsulates information that exists for every type of OID. More
 // specialized classes for specific OID types should derive from this.
 class OidInfo {
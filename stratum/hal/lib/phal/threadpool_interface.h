@@ -6,6 +6,8 @@
 #define STRATUM_HAL_LIB_PHAL_THREADPOOL_INTERFACE_H_
 
 #include <functional>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "stratum/glue/integral_types.h"
@@ -17,6 +19,20 @@ namespace phal {
 
 typedef uint32 TaskId;
 
+// Scheduling hints for a task. Threadpools that execute tasks serially may
+// ignore them.
+struct TaskOptions {
+  // Queued tasks with a higher priority are started first.
+  int priority = 0;
+  // Tasks with the same non-empty concurrency group, e.g. the devices behind
+  // the same I2C bus, are subject to a shared concurrency limit.
+  std::string concurrency_group;
+  // If positive, the concurrency limit of the group of this task, which
+  // overrides the default limit of the threadpool. E.g. 1 for a bus which does
+  // not allow concurrent transactions. All tasks of a group must agree on it.
+  int max_group_concurrency = 0;
+};
+
 class ThreadpoolInterface {
  public:
   virtual ~ThreadpoolInterface() {}
@@ -24,6 +40,11 @@ class ThreadpoolInterface {
   virtual void Start() = 0;
   // Schedule a single task to execute, and return a TaskId for the new task.
   virtual TaskId Schedule(std::function<void()> closure) = 0;
+  // Same as Schedule(), with the given scheduling hints.
+  virtual TaskId ScheduleWithOptions(std::function<void()> closure,
+                                     const TaskOptions& options) {
+    return Schedule(std::move(closure));
+  }
   // Block until all tasks with the given TaskIds have completed. Any TaskIds
   // that have no matching task are ignored.
   virtual void WaitAll(const std::vector<TaskId>& tasks) = 0;
@@ -18,6 +18,8 @@ class ThreadpoolInterfaceMock : public ThreadpoolInterface {
  public:
   MOCK_METHOD0(Start, void());
   MOCK_METHOD1(Schedule, TaskId(std::function<void()> closure));
+  MOCK_METHOD2(ScheduleWithOptions, TaskId(std::function<void()> closure,
+                                           const TaskOptions& options));
   MOCK_METHOD1(WaitAll, void(const std::vector<TaskId>& threads));
 };
 
@@ -0,0 +1,197 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/phal/work_stealing_threadpool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace stratum {
+namespace hal {
+namespace phal {
+
+WorkStealingThreadpool::WorkStealingThreadpool(int num_threads,
+                                               int max_tasks_per_group)
+    : num_threads_(std::max(num_threads, 0)),
+      max_tasks_per_group_(max_tasks_per_group),
+      shutdown_(false),
+      next_task_id_(0),
+      next_sequence_(0),
+      next_queue_(0),
+      num_queued_(0) {
+  for (size_t i = 0; i < std::max<size_t>(num_threads_, 1); ++i) {
+    queues_.push_back(absl::make_unique<TaskQueue>());
+  }
+}
+
+WorkStealingThreadpool::~WorkStealingThreadpool() {
+  std::vector<std::thread> threads;
+  {
+    absl::MutexLock l(&lock_);
+    shutdown_ = true;
+    threads.swap(threads_);
+  }
+  for (auto& thread : threads) thread.join();
+  // Run whatever is left, e.g. if the threadpool was never started.
+  while (auto task = Dequeue(0)) Run(std::move(task));
+}
+
+void WorkStealingThreadpool::Start() {
+  absl::MutexLock l(&lock_);
+  if (!threads_.empty() || shutdown_) return;
+  for (size_t i = 0; i < num_threads_; ++i) {
+    threads_.emplace_back(&WorkStealingThreadpool::WorkerLoop, this, i);
+  }
+}
+
+TaskId WorkStealingThreadpool::Schedule(std::function<void()> closure) {
+  return ScheduleWithOptions(std::move(closure), TaskOptions());
+}
+
+TaskId WorkStealingThreadpool::ScheduleWithOptions(
+    std::function<void()> closure, const TaskOptions& options) {
+  auto task = absl::make_unique<Task>();
+  task->priority = options.priority;
+  task->concurrency_group = options.concurrency_group;
+  task->max_group_concurrency = options.max_group_concurrency > 0
+                                    ? options.max_group_concurrency
+                                    : max_tasks_per_group_;
+  task->closure = std::move(closure);
+  TaskId id;
+  {
+    absl::MutexLock l(&lock_);
+    // Skip IDs of unfinished tasks, in case the counter wrapped around.
+    do {
+      id = next_task_id_++;
+    } while (unfinished_tasks_.contains(id));
+    unfinished_tasks_.insert(id);
+    task->id = id;
+    task->sequence = next_sequence_++;
+  }
+  Enqueue(std::move(task));
+  return id;
+}
+
+void WorkStealingThreadpool::WaitAll(const std::vector<TaskId>& tasks) {
+  WaitAllArgs args = {this, &tasks};
+  while (true) {
+    size_t index;
+    {
+      absl::MutexLock l(&lock_);
+      lock_.Await(absl::Condition(&HasWorkOrTasksDone, &args));
+      if (AllTasksDone(tasks)) return;
+      index = next_queue_++ % queues_.size();
+    }
+    // Help out instead of blocking a thread.
+    auto task = Dequeue(index);
+    if (task) Run(std::move(task));
+  }
+}
+
+void WorkStealingThreadpool::Enqueue(std::unique_ptr<Task> task) {
+  size_t index;
+  {
+    absl::MutexLock l(&lock_);
+    index = next_queue_++ % queues_.size();
+  }
+  {
+    TaskQueue* queue = queues_[index].get();
+    absl::MutexLock l(&queue->lock);
+    queue->tasks.push_back(std::move(task));
+    std::push_heap(queue->tasks.begin(), queue->tasks.end(), TaskOrder());
+  }
+  absl::MutexLock l(&lock_);
+  ++num_queued_;
+}
+
+std::unique_ptr<WorkStealingThreadpool::Task> WorkStealingThreadpool::Dequeue(
+    size_t index) {
+  std::unique_ptr<Task> task;
+  // Start with the given queue, then try to steal from the others.
+  for (size_t i = 0; i < queues_.size() && !task; ++i) {
+    TaskQueue* queue = queues_[(index + i) % queues_.size()].get();
+    absl::MutexLock l(&queue->lock);
+    if (queue->tasks.empty()) continue;
+    std::pop_heap(queue->tasks.begin(), queue->tasks.end(), TaskOrder());
+    task = std::move(queue->tasks.back());
+    queue->tasks.pop_back();
+  }
+  if (task) {
+    absl::MutexLock l(&lock_);
+    --num_queued_;
+  }
+  return task;
+}
+
+void WorkStealingThreadpool::Run(std::unique_ptr<Task> task) {
+  const std::string group = task->concurrency_group;
+  const bool limited = !group.empty() && task->max_group_concurrency > 0;
+  if (limited) {
+    absl::MutexLock l(&lock_);
+    ConcurrencyGroup& state = groups_[group];
+    if (state.num_running >= task->max_group_concurrency) {
+      state.held_back_tasks.push_back(std::move(task));
+      std::push_heap(state.held_back_tasks.begin(),
+                     state.held_back_tasks.end(), TaskOrder());
+      return;
+    }
+    ++state.num_running;
+  }
+  // Keep running the held back tasks of the group, if any, in this thread.
+  while (task) {
+    task->closure();
+    task->closure = nullptr;
+    absl::MutexLock l(&lock_);
+    unfinished_tasks_.erase(task->id);
+    task.reset();
+    if (limited) {
+      auto it = groups_.find(group);
+      ConcurrencyGroup& state = it->second;
+      if (!state.held_back_tasks.empty()) {
+        std::pop_heap(state.held_back_tasks.begin(),
+                      state.held_back_tasks.end(), TaskOrder());
+        task = std::move(state.held_back_tasks.back());
+        state.held_back_tasks.pop_back();
+      } else if (--state.num_running == 0) {
+        groups_.erase(it);
+      }
+    }
+  }
+}
+
+void WorkStealingThreadpool::WorkerLoop(size_t index) {
+  while (true) {
+    auto task = Dequeue(index);
+    if (task) {
+      Run(std::move(task));
+      continue;
+    }
+    absl::MutexLock l(&lock_);
+    lock_.Await(absl::Condition(&HasWorkOrShutdown, this));
+    if (shutdown_ && num_queued_ <= 0) return;
+  }
+}
+
+bool WorkStealingThreadpool::HasWorkOrShutdown(
+    WorkStealingThreadpool* threadpool) {
+  return threadpool->shutdown_ || threadpool->num_queued_ > 0;
+}
+
+bool WorkStealingThreadpool::HasWorkOrTasksDone(WaitAllArgs* args) {
+  return args->threadpool->num_queued_ > 0 ||
+         args->threadpool->AllTasksDone(*args->tasks);
+}
+
+bool WorkStealingThreadpool::AllTasksDone(
+    const std::vector<TaskId>& tasks) const {
+  for (const auto& id : tasks) {
+    if (unfinished_tasks_.contains(id)) return false;
+  }
+  return true;
+}
+
+}  // namespace phal
+}  // namespace hal
+}  // namespace stratum
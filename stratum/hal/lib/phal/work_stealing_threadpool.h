@@ -0,0 +1,143 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_PHAL_WORK_STEALING_THREADPOOL_H_
+#define STRATUM_HAL_LIB_PHAL_WORK_STEALING_THREADPOOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/hal/lib/phal/threadpool_interface.h"
+
+namespace stratum {
+namespace hal {
+namespace phal {
+
+// A threadpool that executes tasks on a fixed number of worker threads. Every
+// worker has its own queue of tasks, ordered by priority. Scheduled tasks are
+// distributed round-robin over the queues, and a worker whose queue is empty
+// steals the highest priority task of another queue. At most
+// max_tasks_per_group tasks of the same concurrency group run at the same
+// time, unless the tasks of the group set their own limit; the others are held
+// back until one of the running ones finishes.
+//
+// Threads calling WaitAll() execute queued tasks while they wait, so WaitAll()
+// can be called from within a task and before Start().
+class WorkStealingThreadpool : public ThreadpoolInterface {
+ public:
+  // Creates a threadpool with the given number of worker threads, which are
+  // spawned by Start(). A non-positive max_tasks_per_group means no limit.
+  WorkStealingThreadpool(int num_threads, int max_tasks_per_group);
+  // Runs all queued tasks and joins the worker threads.
+  ~WorkStealingThreadpool() override;
+
+  // Spawns the worker threads. Subsequent calls have no effect.
+  void Start() override LOCKS_EXCLUDED(lock_);
+  TaskId Schedule(std::function<void()> closure) override
+      LOCKS_EXCLUDED(lock_);
+  TaskId ScheduleWithOptions(std::function<void()> closure,
+                             const TaskOptions& options) override
+      LOCKS_EXCLUDED(lock_);
+  void WaitAll(const std::vector<TaskId>& tasks) override
+      LOCKS_EXCLUDED(lock_);
+
+  // WorkStealingThreadpool is neither copyable nor movable.
+  WorkStealingThreadpool(const WorkStealingThreadpool&) = delete;
+  WorkStealingThreadpool& operator=(const WorkStealingThreadpool&) = delete;
+
+ private:
+  struct Task {
+    TaskId id;
+    int priority;
+    // Orders tasks of the same priority by scheduling time.
+    uint64 sequence;
+    std::string concurrency_group;
+    // The concurrency limit of the group, non-positive for no limit.
+    int max_group_concurrency;
+    std::function<void()> closure;
+  };
+
+  // Heap order of tasks: highest priority first, then oldest first.
+  struct TaskOrder {
+    bool operator()(const std::unique_ptr<Task>& a,
+                    const std::unique_ptr<Task>& b) const {
+      if (a->priority != b->priority) return a->priority < b->priority;
+      return a->sequence > b->sequence;
+    }
+  };
+
+  // A priority queue of tasks, kept as a heap ordered by TaskOrder.
+  struct TaskQueue {
+    absl::Mutex lock;
+    std::vector<std::unique_ptr<Task>> tasks GUARDED_BY(lock);
+  };
+
+  // The state of a concurrency group.
+  struct ConcurrencyGroup {
+    int num_running = 0;
+    // Tasks held back because of the concurrency limit, ordered by TaskOrder.
+    std::vector<std::unique_ptr<Task>> held_back_tasks;
+  };
+
+  // The arguments of the WaitAll() wake-up condition.
+  struct WaitAllArgs {
+    WorkStealingThreadpool* threadpool;
+    const std::vector<TaskId>* tasks;
+  };
+
+  // Pushes a task into one of the task queues.
+  void Enqueue(std::unique_ptr<Task> task) LOCKS_EXCLUDED(lock_);
+
+  // Pops the highest priority task of the queue with the given index, or
+  // steals one from another queue. Returns nullptr if all queues are empty.
+  std::unique_ptr<Task> Dequeue(size_t index) LOCKS_EXCLUDED(lock_);
+
+  // Runs the given task, or holds it back if its concurrency group is at the
+  // limit. After a task finished, held back tasks of its group are run.
+  void Run(std::unique_ptr<Task> task) LOCKS_EXCLUDED(lock_);
+
+  // The main loop of the worker thread with the given index.
+  void WorkerLoop(size_t index) LOCKS_EXCLUDED(lock_);
+
+  // Conditions used with absl::Mutex::Await().
+  static bool HasWorkOrShutdown(WorkStealingThreadpool* threadpool)
+      SHARED_LOCKS_REQUIRED(threadpool->lock_);
+  static bool HasWorkOrTasksDone(WaitAllArgs* args)
+      SHARED_LOCKS_REQUIRED(args->threadpool->lock_);
+  bool AllTasksDone(const std::vector<TaskId>& tasks) const
+      SHARED_LOCKS_REQUIRED(lock_);
+
+  const size_t num_threads_;
+  const int max_tasks_per_group_;
+
+  // One task queue per worker thread. Always contains at least one queue.
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+
+  // Protects the state below and is used to wait for tasks.
+  mutable absl::Mutex lock_;
+  std::vector<std::thread> threads_ GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_);
+  TaskId next_task_id_ GUARDED_BY(lock_);
+  uint64 next_sequence_ GUARDED_BY(lock_);
+  size_t next_queue_ GUARDED_BY(lock_);
+  // Number of tasks in queues_, updated after every push and pop. May be
+  // briefly negative if a task is popped before its push was counted.
+  int64 num_queued_ GUARDED_BY(lock_);
+  // Tasks that were scheduled but have not finished yet.
+  absl::flat_hash_set<TaskId> unfinished_tasks_ GUARDED_BY(lock_);
+  absl::flat_hash_map<std::string, ConcurrencyGroup> groups_ GUARDED_BY(lock_);
+};
+
+}  // namespace phal
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_PHAL_WORK_STEALING_THREADPOOL_H_
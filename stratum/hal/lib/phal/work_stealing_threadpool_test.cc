@@ -0,0 +1,166 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/phal/work_stealing_threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace hal {
+namespace phal {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(WorkStealingThreadpoolTest, RunsTasksConcurrently) {
+  constexpr int kNumTasks = 4;
+  WorkStealingThreadpool threadpool(kNumTasks, 0);
+  threadpool.Start();
+  // Every task waits for all the others to start, which only completes if
+  // they all run at the same time.
+  absl::Mutex lock;
+  int num_started = 0;
+  std::vector<TaskId> tasks;
+  for (int i = 0; i < kNumTasks; ++i) {
+    tasks.push_back(threadpool.Schedule([&lock, &num_started]() {
+      absl::MutexLock l(&lock);
+      ++num_started;
+      lock.Await(absl::Condition(
+          +[](int* n) { return *n == kNumTasks; }, &num_started));
+    }));
+  }
+  threadpool.WaitAll(tasks);
+}
+
+TEST(WorkStealingThreadpoolTest, RunsHigherPriorityTasksFirst) {
+  WorkStealingThreadpool threadpool(1, 0);
+  absl::Mutex lock;
+  std::vector<int> order;
+  std::vector<TaskId> tasks;
+  for (int priority : {0, 2, 1, 2}) {
+    TaskOptions options;
+    options.priority = priority;
+    tasks.push_back(threadpool.ScheduleWithOptions(
+        [&lock, &order, priority]() {
+          absl::MutexLock l(&lock);
+          order.push_back(priority);
+        },
+        options));
+  }
+  // Without worker threads, the tasks are run one by one by WaitAll().
+  threadpool.WaitAll(tasks);
+  EXPECT_THAT(order, ElementsAre(2, 2, 1, 0));
+}
+
+TEST(WorkStealingThreadpoolTest, LimitsConcurrencyPerGroup) {
+  constexpr int kMaxTasksPerGroup = 2;
+  WorkStealingThreadpool threadpool(8, kMaxTasksPerGroup);
+  threadpool.Start();
+  std::atomic<int> num_running(0);
+  std::atomic<int> max_running(0);
+  std::atomic<int> num_ungrouped_done(0);
+  std::vector<TaskId> tasks;
+  TaskOptions options;
+  options.concurrency_group = "i2c-1";
+  for (int i = 0; i < 8; ++i) {
+    tasks.push_back(threadpool.ScheduleWithOptions(
+        [&num_running, &max_running]() {
+          int running = ++num_running;
+          int max = max_running.load();
+          while (running > max &&
+                 !max_running.compare_exchange_weak(max, running)) {
+          }
+          absl::SleepFor(absl::Milliseconds(10));
+          --num_running;
+        },
+        options));
+    // Tasks without a group are not held back.
+    tasks.push_back(threadpool.Schedule(
+        [&num_ungrouped_done]() { ++num_ungrouped_done; }));
+  }
+  threadpool.WaitAll(tasks);
+  EXPECT_LE(max_running.load(), kMaxTasksPerGroup);
+  EXPECT_EQ(8, num_ungrouped_done.load());
+}
+
+TEST(WorkStealingThreadpoolTest, GroupLimitOfTaskOverridesDefault) {
+  WorkStealingThreadpool threadpool(8, 4);
+  threadpool.Start();
+  std::atomic<int> num_running(0);
+  std::atomic<int> max_running(0);
+  std::vector<TaskId> tasks;
+  TaskOptions options;
+  options.concurrency_group = "i2c-1";
+  options.max_group_concurrency = 1;
+  for (int i = 0; i < 8; ++i) {
+    tasks.push_back(threadpool.ScheduleWithOptions(
+        [&num_running, &max_running]() {
+          int running = ++num_running;
+          int max = max_running.load();
+          while (running > max &&
+                 !max_running.compare_exchange_weak(max, running)) {
+          }
+          absl::SleepFor(absl::Milliseconds(10));
+          --num_running;
+        },
+        options));
+  }
+  threadpool.WaitAll(tasks);
+  EXPECT_EQ(1, max_running.load());
+}
+
+TEST(WorkStealingThreadpoolTest, WaitAllRunsTasksWithoutStart) {
+  WorkStealingThreadpool threadpool(2, 1);
+  int num_done = 0;
+  std::vector<TaskId> tasks;
+  TaskOptions options;
+  options.concurrency_group = "i2c-1";
+  for (int i = 0; i < 3; ++i) {
+    tasks.push_back(
+        threadpool.ScheduleWithOptions([&num_done]() { ++num_done; }, options));
+  }
+  threadpool.WaitAll(tasks);
+  EXPECT_EQ(3, num_done);
+  // Unknown tasks are ignored.
+  threadpool.WaitAll({12345});
+}
+
+TEST(WorkStealingThreadpoolTest, WaitAllFromWithinTask) {
+  WorkStealingThreadpool threadpool(1, 0);
+  threadpool.Start();
+  std::atomic<int> num_done(0);
+  TaskId outer = threadpool.Schedule([&threadpool, &num_done]() {
+    std::vector<TaskId> inner;
+    for (int i = 0; i < 4; ++i) {
+      inner.push_back(threadpool.Schedule([&num_done]() { ++num_done; }));
+    }
+    // The only worker is busy with this task, so the inner tasks are run here.
+    threadpool.WaitAll(inner);
+    EXPECT_EQ(4, num_done.load());
+  });
+  threadpool.WaitAll({outer});
+}
+
+TEST(WorkStealingThreadpoolTest, DestructorRunsQueuedTasks) {
+  std::atomic<int> num_done(0);
+  {
+    WorkStealingThreadpool threadpool(2, 0);
+    for (int i = 0; i < 5; ++i) {
+      threadpool.Schedule([&num_done]() { ++num_done; });
+    }
+  }
+  EXPECT_EQ(5, num_done.load());
+}
+
+}  // namespace
+}  // namespace phal
+}  // namespace hal
+}  // namespace stratum
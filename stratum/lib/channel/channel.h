@@ -42,6 +42,9 @@ namespace stratum {
 //
 //   T: Message type. T must be move-assignable.
 //
+//   LockFreeChannel<T>: A Channel<T> backed by a lock-free ring buffer, for
+//   high-rate message paths. See lock_free_channel.h.
+//
 // Example Setup and Cleanup:
 //
 //   int max_depth = 128;
@@ -248,6 +251,13 @@ class Channel : public channel_internal::ChannelBase {
   virtual ::util::Status TryWrite(const T& t) LOCKS_EXCLUDED(queue_lock_);
   virtual ::util::Status TryWrite(T&& t) LOCKS_EXCLUDED(queue_lock_);
 
+  // Moves the elements of t_s into the Channel, in order. Blocks while the
+  // queue is full until the timeout. Returns the same errors as Write(), in
+  // which case t_s holds the elements which have not been written. On success,
+  // t_s is left empty.
+  virtual ::util::Status WriteBatch(std::vector<T>* t_s, absl::Duration timeout)
+      LOCKS_EXCLUDED(queue_lock_);
+
   // Reads and pops the first element of the queue into t. Returns ERR_SUCCESS
   // on successful dequeue. Blocks if the queue is empty until the timeout, then
   // returns ERR_ENTRY_NOT_FOUND. Returns ERR_CANCELED if Channel is closed and
@@ -379,6 +389,10 @@ class ChannelWriter {
   virtual ::util::Status TryWrite(T&& t) {
     return channel_->TryWrite(std::move(t));
   }
+  virtual ::util::Status WriteBatch(std::vector<T>* t_s,
+                                    absl::Duration timeout) {
+    return channel_->WriteBatch(t_s, timeout);
+  }
   virtual bool IsClosed() { return channel_->IsClosed(); }
 
   // Disallow copy and assign.
@@ -501,13 +515,39 @@ template <typename T>
   return ::util::OkStatus();
 }
 
+template <typename T>
+::util::Status Channel<T>::WriteBatch(std::vector<T>* t_s,
+                                      absl::Duration timeout) {
+  absl::MutexLock l(&queue_lock_);
+  absl::Time deadline = absl::Now() + timeout;
+  ::util::Status status = ::util::OkStatus();
+  auto it = t_s->begin();
+  while (it != t_s->end()) {
+    // Check internal state, blocking until the deadline if queue is full.
+    status = CheckWriteStateAndBlock(deadline - absl::Now());
+    if (!status.ok()) break;
+    // Enqueue as many messages as the queue can hold.
+    while (it != t_s->end() && queue_.size() < max_depth_) {
+      queue_.push_back(std::move(*it));
+      ++it;
+    }
+    // Signal all blocked ChannelReaders.
+    cond_not_empty_.SignalAll();
+    // Signal any Select()-ing threads..
+    ClearSelectList(true);
+  }
+  // Only keep the messages which have not been written.
+  t_s->erase(t_s->begin(), it);
+  return status;
+}
+
 template <typename T>
 ::util::Status Channel<T>::CheckWriteState() {
   // Check for Channel closure.
   if (closed_) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
   // Check for full internal buffer.
   if (queue_.size() == max_depth_) {
-    return MAKE_ERROR(ERR_NO_RESOURCE) << "Channel is full.";
+    return MAKE_ERROR(ERR_NO_RESOURCE).without_logging() << "Channel is full.";
   }
   // Queue size should never exceed maximum queue depth.
   if (queue_.size() > max_depth_) {
@@ -570,7 +610,8 @@ template <typename T>
   if (closed_) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
   // Check for empty internal buffer.
   if (queue_.empty()) {
-    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND) << "Channel is empty.";
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
+           << "Channel is empty.";
   }
   // Dequeue message.
   *t = std::move(queue_.front());
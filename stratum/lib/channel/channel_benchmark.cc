@@ -0,0 +1,170 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the mutex-based Channel against the LockFreeChannel with one
+// reader and one or more writers, as in the packet I/O path. The throughput
+// benchmarks push messages as fast as possible, optionally in batches. The
+// paced benchmarks offer a fixed total load of 1M messages per second and
+// report the achieved rate and the enqueue-to-dequeue latency.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/lib/channel/channel.h"
+#include "stratum/lib/channel/lock_free_channel.h"
+
+namespace stratum {
+namespace {
+
+constexpr size_t kChannelDepth = 1024;
+constexpr int kMessagesPerIteration = 1 << 20;
+constexpr int kPacedMessagesPerSecond = 1000000;
+// Size of a typical PacketIn payload.
+constexpr size_t kPayloadSize = 128;
+
+struct Message {
+  int64 enqueue_time_ns = 0;
+  std::string payload;
+};
+
+struct MutexChannelFactory {
+  static std::shared_ptr<Channel<Message>> Create() {
+    return Channel<Message>::Create(kChannelDepth);
+  }
+};
+
+struct LockFreeChannelFactory {
+  static std::shared_ptr<Channel<Message>> Create() {
+    return LockFreeChannel<Message>::Create(kChannelDepth);
+  }
+};
+
+// Writes num_messages messages, one by one or in batches, at the given rate or
+// as fast as possible if the rate is zero.
+void RunWriter(std::shared_ptr<Channel<Message>> channel, int num_messages,
+               int batch_size, double messages_per_second) {
+  auto writer = ChannelWriter<Message>::Create(std::move(channel));
+  const std::string payload(kPayloadSize, 'x');
+  const absl::Time start = absl::Now();
+  std::vector<Message> batch;
+  for (int i = 0; i < num_messages; ++i) {
+    if (messages_per_second > 0) {
+      const absl::Time send_time =
+          start + absl::Seconds(i / messages_per_second);
+      while (absl::Now() < send_time) {
+      }
+    }
+    Message msg;
+    msg.enqueue_time_ns = absl::GetCurrentTimeNanos();
+    msg.payload = payload;
+    if (batch_size > 1) {
+      batch.push_back(std::move(msg));
+      if (batch.size() < batch_size && i + 1 < num_messages) continue;
+      CHECK_OK(writer->WriteBatch(&batch, absl::InfiniteDuration()));
+    } else {
+      CHECK_OK(writer->Write(std::move(msg), absl::InfiniteDuration()));
+    }
+  }
+}
+
+// Reads num_messages messages and returns their latencies in nanoseconds.
+std::vector<int64> RunReader(ChannelReader<Message>* reader, int num_messages,
+                             bool read_all) {
+  std::vector<int64> latencies;
+  latencies.reserve(num_messages);
+  std::vector<Message> msgs;
+  Message msg;
+  while (latencies.size() < num_messages) {
+    if (read_all) {
+      CHECK_OK(reader->ReadAll(&msgs));
+      if (msgs.empty()) continue;
+    } else {
+      CHECK_OK(reader->Read(&msg, absl::InfiniteDuration()));
+      msgs.clear();
+      msgs.push_back(std::move(msg));
+    }
+    const int64 now = absl::GetCurrentTimeNanos();
+    for (const auto& m : msgs) latencies.push_back(now - m.enqueue_time_ns);
+  }
+  return latencies;
+}
+
+int64 Percentile(const std::vector<int64>& sorted, double p) {
+  return sorted[std::min(sorted.size() - 1,
+                         static_cast<size_t>(p * sorted.size()))];
+}
+
+// Passes messages from state.range(0) writers to a single reader. With a batch
+// size (state.range(1)) larger than one, the writers use WriteBatch() and the
+// reader uses ReadAll().
+template <typename Factory>
+void RunBenchmark(benchmark::State& state, double messages_per_second) {
+  const int num_writers = state.range(0);
+  const int batch_size = state.range(1);
+  const int messages_per_writer = kMessagesPerIteration / num_writers;
+  const int num_messages = messages_per_writer * num_writers;
+  std::vector<int64> latencies;
+  for (auto _ : state) {
+    auto channel = Factory::Create();
+    auto reader = ChannelReader<Message>::Create(channel);
+    std::vector<std::thread> writers;
+    for (int i = 0; i < num_writers; ++i) {
+      writers.emplace_back(RunWriter, channel, messages_per_writer, batch_size,
+                           messages_per_second / num_writers);
+    }
+    auto iteration_latencies =
+        RunReader(reader.get(), num_messages, batch_size > 1);
+    for (auto& writer : writers) writer.join();
+    latencies.insert(latencies.end(), iteration_latencies.begin(),
+                     iteration_latencies.end());
+  }
+  state.SetItemsProcessed(state.iterations() * num_messages);
+  std::sort(latencies.begin(), latencies.end());
+  state.counters["p50_latency_ns"] = Percentile(latencies, 0.5);
+  state.counters["p99_latency_ns"] = Percentile(latencies, 0.99);
+  state.counters["max_latency_ns"] = latencies.back();
+}
+
+template <typename Factory>
+void BM_Throughput(benchmark::State& state) {
+  RunBenchmark<Factory>(state, 0);
+}
+
+template <typename Factory>
+void BM_Paced(benchmark::State& state) {
+  RunBenchmark<Factory>(state, kPacedMessagesPerSecond);
+}
+
+void ThroughputArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"writers", "batch"});
+  for (int writers : {1, 2, 4}) {
+    for (int batch : {1, 32}) b->Args({writers, batch});
+  }
+  b->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+void PacedArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"writers", "batch"});
+  for (int writers : {1, 4}) b->Args({writers, 1});
+  b->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_Throughput, MutexChannelFactory)->Apply(ThroughputArgs);
+BENCHMARK_TEMPLATE(BM_Throughput, LockFreeChannelFactory)
+    ->Apply(ThroughputArgs);
+BENCHMARK_TEMPLATE(BM_Paced, MutexChannelFactory)->Apply(PacedArgs);
+BENCHMARK_TEMPLATE(BM_Paced, LockFreeChannelFactory)->Apply(PacedArgs);
+
+}  // namespace
+}  // namespace stratum
+
+BENCHMARK_MAIN();
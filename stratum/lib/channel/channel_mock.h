@@ -26,6 +26,8 @@ class ChannelMock : public Channel<T> {
   MOCK_METHOD2_T(Write, ::util::Status(T&& t, absl::Duration timeout));
   MOCK_METHOD1_T(TryWrite, ::util::Status(const T& t));
   MOCK_METHOD1_T(TryWrite, ::util::Status(T&& t));
+  MOCK_METHOD2_T(WriteBatch,
+                 ::util::Status(std::vector<T>* t_s, absl::Duration timeout));
   MOCK_METHOD2_T(
       SelectRegister,
       void(const std::shared_ptr<channel_internal::SelectData>& select_data,
@@ -48,6 +50,8 @@ class ChannelWriterMock : public ChannelWriter<T> {
   MOCK_METHOD2_T(Write, ::util::Status(T&& t, absl::Duration timeout));
   MOCK_METHOD1_T(TryWrite, ::util::Status(const T& t));
   MOCK_METHOD1_T(TryWrite, ::util::Status(T&& t));
+  MOCK_METHOD2_T(WriteBatch,
+                 ::util::Status(std::vector<T>* t_s, absl::Duration timeout));
   MOCK_METHOD0_T(IsClosed, bool());
 };
 
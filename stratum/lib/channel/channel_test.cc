@@ -97,6 +97,33 @@ TEST(ChannelTest, TestReadWriteClose) {
   EXPECT_EQ(ERR_CANCELLED, reader->Read(&msg, timeout).error_code());
 }
 
+// Test WriteBatch() of more messages than the Channel can hold.
+TEST(ChannelTest, TestWriteBatch) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(2);
+  auto reader = ChannelReader<int>::Create(channel);
+  auto writer = ChannelWriter<int>::Create(channel);
+
+  // Only the messages which fit are written, the others are kept.
+  std::vector<int> batch = {1, 2, 3};
+  EXPECT_EQ(ERR_NO_RESOURCE,
+            writer->WriteBatch(&batch, absl::Milliseconds(10)).error_code());
+  EXPECT_EQ(std::vector<int>({3}), batch);
+  std::vector<int> msgs;
+  EXPECT_OK(reader->ReadAll(&msgs));
+  EXPECT_EQ(std::vector<int>({1, 2}), msgs);
+
+  EXPECT_OK(writer->WriteBatch(&batch, absl::InfiniteDuration()));
+  EXPECT_TRUE(batch.empty());
+  EXPECT_OK(reader->ReadAll(&msgs));
+  EXPECT_EQ(std::vector<int>({3}), msgs);
+
+  EXPECT_TRUE(channel->Close());
+  batch = {4};
+  EXPECT_EQ(ERR_CANCELLED,
+            writer->WriteBatch(&batch, absl::InfiniteDuration()).error_code());
+  EXPECT_EQ(std::vector<int>({4}), batch);
+}
+
 namespace {
 
 void* TestCloseReadFunc(void* arg) {
@@ -0,0 +1,376 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_LIB_CHANNEL_LOCK_FREE_CHANNEL_H_
+#define STRATUM_LIB_CHANNEL_LOCK_FREE_CHANNEL_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "stratum/lib/channel/channel.h"
+#include "stratum/lib/channel/ring_buffer.h"
+#include "stratum/lib/macros.h"
+
+namespace stratum {
+
+// LockFreeChannel<T> is a Channel<T> backed by a lock-free RingBuffer<T>
+// instead of a mutex-protected deque. It is meant for high-rate message paths
+// such as packet I/O, with one or more writers (SPSC or MPSC) and a single
+// reader. Writers and readers which do not have to block never take a lock;
+// the internal mutex is only used to park blocked ChannelReaders,
+// ChannelWriters and Select()-ing threads, and is only taken on the other side
+// if such a waiter is registered.
+//
+// A LockFreeChannel<T> is used through the regular ChannelReader<T>,
+// ChannelWriter<T> and Select() API:
+//
+//   std::shared_ptr<Channel<T>> channel = LockFreeChannel<T>::Create(1024);
+//   auto reader = ChannelReader<T>::Create(channel);
+//   auto writer = ChannelWriter<T>::Create(channel);
+//
+// Differences to Channel<T>:
+//
+// 1. The maximum queue depth is rounded up to the next power of two, and is at
+//    least two.
+//
+// 2. T must also be default constructible.
+//
+// 3. Select() may report the Channel as ready slightly before a concurrent
+//    write becomes visible to readers, in which case a following TryRead()
+//    returns ERR_ENTRY_NOT_FOUND and ReadAll() returns no elements.
+template <typename T>
+class LockFreeChannel : public Channel<T> {
+ public:
+  ~LockFreeChannel() override {}
+
+  // Creates a lock-free Channel object with given maximum queue depth.
+  static std::unique_ptr<Channel<T>> Create(size_t max_depth) {
+    return absl::WrapUnique<Channel<T>>(new LockFreeChannel<T>(max_depth));
+  }
+
+  bool Close() LOCKS_EXCLUDED(wait_lock_) override;
+  bool IsClosed() override;
+
+  // Disallow copy and assign.
+  LockFreeChannel(const LockFreeChannel&) = delete;
+  LockFreeChannel& operator=(const LockFreeChannel&) = delete;
+
+ protected:
+  explicit LockFreeChannel(size_t max_depth)
+      : Channel<T>(max_depth),
+        ring_(max_depth),
+        closed_(false),
+        num_read_waiters_(0),
+        num_write_waiters_(0) {}
+
+  // See Channel<T> for the semantics of the following functions.
+  ::util::Status Write(const T& t, absl::Duration timeout)
+      LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status Write(T&& t, absl::Duration timeout)
+      LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status TryWrite(const T& t) LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status TryWrite(T&& t) LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status WriteBatch(std::vector<T>* t_s, absl::Duration timeout)
+      LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status Read(T* t, absl::Duration timeout)
+      LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status TryRead(T* t) LOCKS_EXCLUDED(wait_lock_) override;
+  ::util::Status ReadAll(std::vector<T>* t_s)
+      LOCKS_EXCLUDED(wait_lock_) override;
+  void SelectRegister(
+      const std::shared_ptr<channel_internal::SelectData>& select_data,
+      bool* ready) LOCKS_EXCLUDED(wait_lock_) override;
+
+ private:
+  // Number of times a reader polls the ring before it blocks. Spinning for a
+  // short while avoids parking the reader, and waking it up from the writer,
+  // for every message of a steady stream.
+  static constexpr int kNumReadSpins = 128;
+
+  // Blocks until t can be moved into the ring, the Channel is closed or the
+  // deadline is reached.
+  ::util::Status WaitAndPush(T* t, absl::Time deadline)
+      LOCKS_EXCLUDED(wait_lock_);
+
+  // Blocks until an element can be moved out of the ring into t, the Channel
+  // is closed or the deadline is reached.
+  ::util::Status WaitAndPop(T* t, absl::Time deadline)
+      LOCKS_EXCLUDED(wait_lock_);
+
+  // Wakes up blocked ChannelReaders and Select()-ing threads, if any, after
+  // elements have been written.
+  void NotifyReaders() LOCKS_EXCLUDED(wait_lock_);
+
+  // Wakes up blocked ChannelWriters, if any, after elements have been read.
+  void NotifyWriters(bool all) LOCKS_EXCLUDED(wait_lock_);
+
+  // Pops each element on the select list, setting the corresponding done and
+  // ready flags to the given value and signaling their condition variables.
+  void ClearSelectList(bool ready) EXCLUSIVE_LOCKS_REQUIRED(wait_lock_);
+
+  // The queue of messages.
+  RingBuffer<T> ring_;
+
+  // True once the Channel has been closed. Only set with wait_lock_ held, so
+  // that blocked threads cannot miss the transition.
+  std::atomic<bool> closed_;
+
+  // The number of blocked ChannelReaders plus the number of registered
+  // Select() operations, and the number of blocked ChannelWriters. Every
+  // waiter registers itself before checking the ring for the last time, and
+  // every reader or writer checks these counters after updating the ring,
+  // with a full fence on both sides. So either the waiter sees the update or
+  // the updater sees the waiter and signals it under wait_lock_.
+  std::atomic<int> num_read_waiters_;
+  std::atomic<int> num_write_waiters_;
+
+  // Mutex used to park blocked threads.
+  absl::Mutex wait_lock_;
+  std::list<std::pair<std::shared_ptr<channel_internal::SelectData>, bool>>
+      select_list_ GUARDED_BY(wait_lock_);
+
+  // Condition variable for ChannelReaders waiting on an empty ring.
+  absl::CondVar cond_not_empty_;
+
+  // Condition variable for ChannelWriters waiting on a full ring.
+  absl::CondVar cond_not_full_;
+};
+
+template <typename T>
+constexpr int LockFreeChannel<T>::kNumReadSpins;
+
+template <typename T>
+bool LockFreeChannel<T>::Close() {
+  absl::MutexLock l(&wait_lock_);
+  if (closed_.exchange(true)) return false;
+  // Signal all blocked ChannelWriters.
+  cond_not_full_.SignalAll();
+  // Signal all blocked ChannelReaders.
+  cond_not_empty_.SignalAll();
+  // Signal any Select()-ing threads.
+  ClearSelectList(false);
+  return true;
+}
+
+template <typename T>
+bool LockFreeChannel<T>::IsClosed() {
+  return closed_.load(std::memory_order_acquire);
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::Write(const T& t, absl::Duration timeout) {
+  T copy = t;
+  return Write(std::move(copy), timeout);
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::Write(T&& t, absl::Duration timeout) {
+  if (IsClosed()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  if (!ring_.TryPush(std::move(t))) {
+    RETURN_IF_ERROR(WaitAndPush(&t, absl::Now() + timeout));
+  }
+  NotifyReaders();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::TryWrite(const T& t) {
+  T copy = t;
+  return TryWrite(std::move(copy));
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::TryWrite(T&& t) {
+  if (IsClosed()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  if (!ring_.TryPush(std::move(t))) {
+    return MAKE_ERROR(ERR_NO_RESOURCE).without_logging() << "Channel is full.";
+  }
+  NotifyReaders();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::WriteBatch(std::vector<T>* t_s,
+                                              absl::Duration timeout) {
+  if (IsClosed()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  absl::Time deadline = absl::Now() + timeout;
+  ::util::Status status = ::util::OkStatus();
+  auto it = t_s->begin();
+  for (; it != t_s->end(); ++it) {
+    if (ring_.TryPush(std::move(*it))) continue;
+    // Let the readers drain what has been written so far before blocking.
+    NotifyReaders();
+    status = WaitAndPush(&*it, deadline);
+    if (!status.ok()) break;
+  }
+  if (it != t_s->begin()) NotifyReaders();
+  // Only keep the messages which have not been written.
+  t_s->erase(t_s->begin(), it);
+  return status;
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::Read(T* t, absl::Duration timeout) {
+  if (IsClosed()) {
+    return MAKE_ERROR(ERR_CANCELLED).without_logging() << "Channel is closed.";
+  }
+  bool popped = false;
+  for (int i = 0; i < kNumReadSpins && !popped; ++i) popped = ring_.TryPop(t);
+  if (!popped) RETURN_IF_ERROR(WaitAndPop(t, absl::Now() + timeout));
+  NotifyWriters(false);
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::TryRead(T* t) {
+  if (IsClosed()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  if (!ring_.TryPop(t)) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
+           << "Channel is empty.";
+  }
+  NotifyWriters(false);
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::ReadAll(std::vector<T>* t_s) {
+  if (IsClosed()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  t_s->clear();
+  // Read at most one ring worth of messages, so that a fast writer cannot keep
+  // the reader in here forever.
+  T t;
+  while (t_s->size() < ring_.Capacity() && ring_.TryPop(&t)) {
+    t_s->push_back(std::move(t));
+  }
+  if (!t_s->empty()) NotifyWriters(true);
+  return ::util::OkStatus();
+}
+
+template <typename T>
+void LockFreeChannel<T>::SelectRegister(
+    const std::shared_ptr<channel_internal::SelectData>& select_data,
+    bool* ready) {
+  absl::MutexLock l(&wait_lock_);
+  // Check for Channel closure.
+  if (IsClosed()) return;
+  num_read_waiters_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  absl::MutexLock sel_lock(&select_data->lock);
+  if (ring_.SizeEstimate() == 0) {
+    // Only enqueue select_data if the operation is not done. The waiter count
+    // is released once the list is cleared.
+    if (!select_data->done) {
+      select_list_.push_back(std::make_pair(select_data, ready));
+      return;
+    }
+  } else {
+    *ready = true;
+    select_data->done = true;
+  }
+  num_read_waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::WaitAndPush(T* t, absl::Time deadline) {
+  absl::MutexLock l(&wait_lock_);
+  num_write_waiters_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  ::util::Status status = ::util::OkStatus();
+  bool expired = false;
+  while (true) {
+    // Could have been signalled because Channel is now closed.
+    if (IsClosed()) {
+      status = MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+      break;
+    }
+    if (ring_.TryPush(std::move(*t))) break;
+    // Could have been signalled even if timeout has expired.
+    if (expired) {
+      status = MAKE_ERROR(ERR_NO_RESOURCE)
+               << "Write did not succeed within timeout due to full Channel.";
+      break;
+    }
+    expired = cond_not_full_.WaitWithDeadline(&wait_lock_, deadline);
+  }
+  num_write_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  return status;
+}
+
+template <typename T>
+::util::Status LockFreeChannel<T>::WaitAndPop(T* t, absl::Time deadline) {
+  absl::MutexLock l(&wait_lock_);
+  num_read_waiters_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  ::util::Status status = ::util::OkStatus();
+  bool expired = false;
+  while (true) {
+    // Could have been signalled because Channel is now closed.
+    if (IsClosed()) {
+      status = MAKE_ERROR(ERR_CANCELLED).without_logging()
+               << "Channel is closed.";
+      break;
+    }
+    if (ring_.TryPop(t)) break;
+    // Could have been signalled even if timeout has expired.
+    if (expired) {
+      status = MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Read did not succeed within timeout due to empty Channel.";
+      break;
+    }
+    expired = cond_not_empty_.WaitWithDeadline(&wait_lock_, deadline);
+  }
+  num_read_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  return status;
+}
+
+template <typename T>
+void LockFreeChannel<T>::NotifyReaders() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_read_waiters_.load(std::memory_order_relaxed) == 0) return;
+  absl::MutexLock l(&wait_lock_);
+  // Signal next blocked ChannelReader.
+  cond_not_empty_.Signal();
+  // Signal any Select()-ing threads.
+  ClearSelectList(true);
+}
+
+template <typename T>
+void LockFreeChannel<T>::NotifyWriters(bool all) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_write_waiters_.load(std::memory_order_relaxed) == 0) return;
+  absl::MutexLock l(&wait_lock_);
+  if (all) {
+    cond_not_full_.SignalAll();
+  } else {
+    cond_not_full_.Signal();
+  }
+}
+
+template <typename T>
+void LockFreeChannel<T>::ClearSelectList(bool ready) {
+  while (!select_list_.empty()) {
+    auto& pair = select_list_.front();
+    {
+      // Set select done flag and Channel ready flag and signal Select()-ing
+      // thread.
+      pair.second = ready;
+      absl::MutexLock sel_lock(&pair.first->lock);
+      pair.first->done = ready;
+      pair.first->cond.Signal();
+    }
+    select_list_.pop_front();
+    num_read_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_CHANNEL_LOCK_FREE_CHANNEL_H_
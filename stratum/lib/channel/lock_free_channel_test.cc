@@ -0,0 +1,241 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/lib/channel/lock_free_channel.h"
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+
+namespace stratum {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(LockFreeChannelTest, ReadWriteClose) {
+  std::shared_ptr<Channel<int>> channel = LockFreeChannel<int>::Create(2);
+  auto reader = ChannelReader<int>::Create(channel);
+  auto writer = ChannelWriter<int>::Create(channel);
+  absl::Duration timeout = absl::InfiniteDuration();
+
+  EXPECT_FALSE(writer->IsClosed());
+  EXPECT_OK(writer->TryWrite(1));
+  EXPECT_OK(writer->Write(2, timeout));  // Should not block.
+  // No space available in Channel.
+  EXPECT_EQ(ERR_NO_RESOURCE, writer->TryWrite(3).error_code());
+  EXPECT_EQ(ERR_NO_RESOURCE,
+            writer->Write(3, absl::Milliseconds(10)).error_code());
+
+  EXPECT_FALSE(reader->IsClosed());
+  int msg;
+  EXPECT_OK(reader->TryRead(&msg));
+  EXPECT_EQ(1, msg);
+  EXPECT_OK(reader->Read(&msg, timeout));  // Should not block.
+  EXPECT_EQ(2, msg);
+  // No messages left in Channel.
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND, reader->TryRead(&msg).error_code());
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND,
+            reader->Read(&msg, absl::Milliseconds(10)).error_code());
+
+  EXPECT_OK(writer->TryWrite(3));
+  EXPECT_OK(writer->TryWrite(4));
+  std::vector<int> msgs;
+  EXPECT_OK(reader->ReadAll(&msgs));
+  EXPECT_THAT(msgs, ElementsAre(3, 4));
+  EXPECT_OK(reader->ReadAll(&msgs));
+  EXPECT_THAT(msgs, IsEmpty());
+
+  // Close() prevents any access to the Channel.
+  EXPECT_OK(writer->TryWrite(1));
+  EXPECT_TRUE(channel->Close());
+  EXPECT_FALSE(channel->Close());
+  EXPECT_TRUE(writer->IsClosed());
+  EXPECT_TRUE(reader->IsClosed());
+  EXPECT_EQ(ERR_CANCELLED, writer->TryWrite(2).error_code());
+  EXPECT_EQ(ERR_CANCELLED, writer->Write(3, timeout).error_code());
+  EXPECT_EQ(ERR_CANCELLED, reader->TryRead(&msg).error_code());
+  EXPECT_EQ(ERR_CANCELLED, reader->ReadAll(&msgs).error_code());
+  EXPECT_EQ(ERR_CANCELLED, reader->Read(&msg, timeout).error_code());
+  EXPECT_EQ(nullptr, ChannelReader<int>::Create(channel));
+}
+
+TEST(LockFreeChannelTest, WriteBatch) {
+  std::shared_ptr<Channel<int>> channel = LockFreeChannel<int>::Create(2);
+  auto reader = ChannelReader<int>::Create(channel);
+  auto writer = ChannelWriter<int>::Create(channel);
+
+  // Only the messages which fit are written, the others are kept.
+  std::vector<int> batch = {1, 2, 3};
+  EXPECT_EQ(ERR_NO_RESOURCE,
+            writer->WriteBatch(&batch, absl::Milliseconds(10)).error_code());
+  EXPECT_THAT(batch, ElementsAre(3));
+  std::vector<int> msgs;
+  EXPECT_OK(reader->ReadAll(&msgs));
+  EXPECT_THAT(msgs, ElementsAre(1, 2));
+
+  EXPECT_OK(writer->WriteBatch(&batch, absl::InfiniteDuration()));
+  EXPECT_THAT(batch, IsEmpty());
+  EXPECT_OK(reader->ReadAll(&msgs));
+  EXPECT_THAT(msgs, ElementsAre(3));
+
+  EXPECT_TRUE(channel->Close());
+  batch = {4};
+  EXPECT_EQ(ERR_CANCELLED,
+            writer->WriteBatch(&batch, absl::InfiniteDuration()).error_code());
+  EXPECT_THAT(batch, ElementsAre(4));
+}
+
+TEST(LockFreeChannelTest, CloseUnblocksReaderAndWriter) {
+  std::shared_ptr<Channel<int>> empty_channel = LockFreeChannel<int>::Create(2);
+  auto reader = ChannelReader<int>::Create(empty_channel);
+  std::shared_ptr<Channel<int>> full_channel = LockFreeChannel<int>::Create(2);
+  auto writer = ChannelWriter<int>::Create(full_channel);
+  ASSERT_OK(writer->TryWrite(0));
+  ASSERT_OK(writer->TryWrite(0));
+
+  std::thread reader_thread([&reader]() {
+    int msg;
+    EXPECT_EQ(ERR_CANCELLED,
+              reader->Read(&msg, absl::InfiniteDuration()).error_code());
+  });
+  std::thread writer_thread([&writer]() {
+    EXPECT_EQ(ERR_CANCELLED,
+              writer->Write(1, absl::InfiniteDuration()).error_code());
+  });
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_TRUE(empty_channel->Close());
+  EXPECT_TRUE(full_channel->Close());
+  reader_thread.join();
+  writer_thread.join();
+}
+
+TEST(LockFreeChannelTest, BlockingReadAndWrite) {
+  std::shared_ptr<Channel<int>> channel = LockFreeChannel<int>::Create(2);
+  auto reader = ChannelReader<int>::Create(channel);
+  auto writer = ChannelWriter<int>::Create(channel);
+  ASSERT_OK(writer->TryWrite(0));
+  ASSERT_OK(writer->TryWrite(1));
+
+  // The writer blocks until the reader makes room.
+  std::thread writer_thread([&writer]() {
+    EXPECT_OK(writer->Write(2, absl::InfiniteDuration()));
+  });
+  absl::SleepFor(absl::Milliseconds(50));
+  int msg;
+  EXPECT_OK(reader->Read(&msg, absl::InfiniteDuration()));
+  EXPECT_EQ(0, msg);
+  writer_thread.join();
+
+  // The reader blocks until the writer writes.
+  EXPECT_OK(reader->Read(&msg, absl::InfiniteDuration()));
+  EXPECT_EQ(1, msg);
+  EXPECT_OK(reader->Read(&msg, absl::InfiniteDuration()));
+  EXPECT_EQ(2, msg);
+  std::thread reader_thread([&reader]() {
+    int msg;
+    EXPECT_OK(reader->Read(&msg, absl::InfiniteDuration()));
+    EXPECT_EQ(3, msg);
+  });
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_OK(writer->Write(3, absl::InfiniteDuration()));
+  reader_thread.join();
+}
+
+TEST(LockFreeChannelTest, Select) {
+  std::shared_ptr<Channel<int>> channel = LockFreeChannel<int>::Create(2);
+  std::shared_ptr<Channel<int>> other_channel = Channel<int>::Create(2);
+  auto writer = ChannelWriter<int>::Create(channel);
+  auto reader = ChannelReader<int>::Create(channel);
+
+  // When the Channels are empty, Select() should fail.
+  auto status_or_ready =
+      Select({channel.get(), other_channel.get()}, absl::Milliseconds(10));
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND, status_or_ready.status().error_code());
+
+  EXPECT_OK(writer->TryWrite(1));
+  status_or_ready =
+      Select({channel.get(), other_channel.get()}, absl::InfiniteDuration());
+  ASSERT_OK(status_or_ready.status());
+  EXPECT_TRUE(status_or_ready.ValueOrDie()(channel.get()));
+  EXPECT_FALSE(status_or_ready.ValueOrDie()(other_channel.get()));
+  int msg;
+  EXPECT_OK(reader->TryRead(&msg));
+
+  // A write wakes up a blocked Select().
+  absl::Notification selected;
+  std::thread select_thread([&channel, &selected]() {
+    EXPECT_OK(Select({channel.get()}, absl::InfiniteDuration()).status());
+    selected.Notify();
+  });
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_FALSE(selected.HasBeenNotified());
+  EXPECT_OK(writer->TryWrite(2));
+  select_thread.join();
+
+  EXPECT_TRUE(channel->Close());
+  EXPECT_TRUE(other_channel->Close());
+  status_or_ready =
+      Select({channel.get(), other_channel.get()}, absl::InfiniteDuration());
+  EXPECT_EQ(ERR_CANCELLED, status_or_ready.status().error_code());
+}
+
+// Several writers, some of them writing in batches, and a single reader
+// pass messages through a small Channel, so that all of them block.
+TEST(LockFreeChannelTest, MultipleWritersStressTest) {
+  constexpr int kNumWriters = 4;
+  constexpr int kNumMessagesPerWriter = 20000;
+  std::shared_ptr<Channel<int>> channel = LockFreeChannel<int>::Create(16);
+  auto reader = ChannelReader<int>::Create(channel);
+
+  std::vector<std::thread> writer_threads;
+  for (int w = 0; w < kNumWriters; ++w) {
+    writer_threads.emplace_back([&channel, w]() {
+      auto writer = ChannelWriter<int>::Create(channel);
+      std::vector<int> batch;
+      for (int i = 0; i < kNumMessagesPerWriter; ++i) {
+        int msg = w * kNumMessagesPerWriter + i;
+        if (w % 2) {
+          batch.push_back(msg);
+          if (batch.size() == 7) {
+            EXPECT_OK(writer->WriteBatch(&batch, absl::InfiniteDuration()));
+          }
+        } else {
+          EXPECT_OK(writer->Write(msg, absl::InfiniteDuration()));
+        }
+      }
+      EXPECT_OK(writer->WriteBatch(&batch, absl::InfiniteDuration()));
+    });
+  }
+
+  // Messages of every writer are received in order.
+  std::vector<int> next(kNumWriters, 0);
+  std::vector<int> msgs;
+  int num_received = 0;
+  int msg;
+  while (num_received < kNumWriters * kNumMessagesPerWriter) {
+    if (num_received % 3) {
+      ASSERT_OK(reader->Read(&msg, absl::InfiniteDuration()));
+      msgs = {msg};
+    } else {
+      ASSERT_OK(reader->ReadAll(&msgs));
+    }
+    for (int m : msgs) {
+      int w = m / kNumMessagesPerWriter;
+      ASSERT_EQ(w * kNumMessagesPerWriter + next[w], m);
+      ++next[w];
+      ++num_received;
+    }
+  }
+  for (auto& thread : writer_threads) thread.join();
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND, reader->TryRead(&msg).error_code());
+}
+
+}  // namespace
+}  // namespace stratum
@@ -0,0 +1,156 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_LIB_CHANNEL_RING_BUFFER_H_
+#define STRATUM_LIB_CHANNEL_RING_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace stratum {
+
+// RingBuffer<T> is a bounded, lock-free multi-producer multi-consumer FIFO
+// queue. Every slot of the ring carries a sequence number, which tells
+// producers and consumers whether the slot is free to be written or ready to
+// be read for their current lap around the ring (D. Vyukov's bounded MPMC
+// queue). Producers and consumers never block each other and never take a
+// lock; TryPush() and TryPop() fail instead when the ring is full or empty.
+//
+// The capacity is rounded up to the next power of two, and is at least two
+// so that the sequence numbers of consecutive laps differ. T must be default
+// constructible and move-assignable. Slots keep the moved-from value of popped
+// elements until they are overwritten.
+template <typename T>
+class RingBuffer {
+  static_assert(std::is_default_constructible<T>::value,
+                "RingBuffer<T> requires T to be DefaultConstructible.");
+  static_assert(std::is_move_assignable<T>::value,
+                "RingBuffer<T> requires T to be MoveAssignable.");
+
+ public:
+  explicit RingBuffer(size_t min_capacity)
+      : capacity_(RoundUpToPowerOfTwo(min_capacity)),
+        mask_(capacity_ - 1),
+        slots_(new Slot[capacity_]),
+        push_pos_(0),
+        pop_pos_(0) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Moves t into the ring. Returns false if the ring is full, in which case t
+  // is left untouched.
+  bool TryPush(T&& t) {
+    Slot* slot;
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        // The slot is free for this lap. Claim it.
+        if (push_pos_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot still holds an element of the previous lap.
+        return false;
+      } else {
+        // Another producer claimed the slot. Retry with the current position.
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(t);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Copies t into the ring. Returns false if the ring is full.
+  bool TryPush(const T& t) {
+    T copy = t;
+    return TryPush(std::move(copy));
+  }
+
+  // Moves the oldest element of the ring into t. Returns false if the ring is
+  // empty.
+  bool TryPop(T* t) {
+    Slot* slot;
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        // The slot holds an element of this lap. Claim it.
+        if (pop_pos_.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot has not been written in this lap yet.
+        return false;
+      } else {
+        // Another consumer claimed the slot. Retry with the current position.
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *t = std::move(slot->value);
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns an estimate of the number of elements in the ring. The value may
+  // be stale by the time it is returned if other threads are pushing or
+  // popping concurrently.
+  size_t SizeEstimate() const {
+    size_t push_pos = push_pos_.load(std::memory_order_relaxed);
+    size_t pop_pos = pop_pos_.load(std::memory_order_relaxed);
+    return push_pos > pop_pos ? push_pos - pop_pos : 0;
+  }
+
+  // Returns the capacity of the ring.
+  size_t Capacity() const { return capacity_; }
+
+  // Disallow copy and assign.
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
+
+ private:
+  // Size of a cache line. The hot atomics are kept on separate lines to avoid
+  // false sharing between producers and consumers.
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n) capacity <<= 1;
+    return capacity;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> push_pos_;
+  char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> pop_pos_;
+  char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+};
+
+template <typename T>
+constexpr size_t RingBuffer<T>::kCacheLineSize;
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_CHANNEL_RING_BUFFER_H_
@@ -0,0 +1,124 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/lib/channel/ring_buffer.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace {
+
+TEST(RingBufferTest, CapacityIsRoundedUpToPowerOfTwo) {
+  EXPECT_EQ(2, RingBuffer<int>(0).Capacity());
+  EXPECT_EQ(2, RingBuffer<int>(1).Capacity());
+  EXPECT_EQ(4, RingBuffer<int>(3).Capacity());
+  EXPECT_EQ(1024, RingBuffer<int>(1000).Capacity());
+}
+
+TEST(RingBufferTest, PushPopInOrder) {
+  RingBuffer<int> ring(4);
+  int value = 0;
+  EXPECT_FALSE(ring.TryPop(&value));
+  for (int i = 0; i < 4; ++i) EXPECT_TRUE(ring.TryPush(i));
+  EXPECT_FALSE(ring.TryPush(4));
+  EXPECT_EQ(4, ring.SizeEstimate());
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(ring.TryPop(&value));
+  EXPECT_EQ(0, ring.SizeEstimate());
+}
+
+// Checks that the ring keeps its order across many laps.
+TEST(RingBufferTest, WrapsAround) {
+  RingBuffer<int> ring(2);
+  int value = 0;
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(ring.TryPush(i));
+    ASSERT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(i, value);
+  }
+}
+
+// Checks that a ring requested with a single slot does not overwrite an
+// element that has not been popped yet.
+TEST(RingBufferTest, SingleSlotRequestDoesNotOverwrite) {
+  RingBuffer<int> ring(1);
+  EXPECT_TRUE(ring.TryPush(1));
+  EXPECT_TRUE(ring.TryPush(2));
+  EXPECT_FALSE(ring.TryPush(3));
+  int value = 0;
+  ASSERT_TRUE(ring.TryPop(&value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(ring.TryPop(&value));
+  EXPECT_EQ(2, value);
+  EXPECT_FALSE(ring.TryPop(&value));
+}
+
+TEST(RingBufferTest, MoveOnlyValues) {
+  RingBuffer<std::unique_ptr<std::string>> ring(2);
+  EXPECT_TRUE(ring.TryPush(std::unique_ptr<std::string>(new std::string("a"))));
+  std::unique_ptr<std::string> value;
+  ASSERT_TRUE(ring.TryPop(&value));
+  ASSERT_NE(nullptr, value);
+  EXPECT_EQ("a", *value);
+}
+
+// Checks that every element pushed by concurrent producers is popped exactly
+// once by concurrent consumers.
+TEST(RingBufferTest, ConcurrentProducersAndConsumers) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumConsumers = 4;
+  constexpr int kNumElementsPerProducer = 100000;
+  RingBuffer<int> ring(64);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumProducers; ++p) {
+    threads.emplace_back([&ring, p]() {
+      for (int i = 0; i < kNumElementsPerProducer; ++i) {
+        while (!ring.TryPush(p * kNumElementsPerProducer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  std::vector<std::vector<int>> popped(kNumConsumers);
+  std::atomic<int> num_popped(0);
+  for (int c = 0; c < kNumConsumers; ++c) {
+    threads.emplace_back([&ring, &popped, &num_popped, c]() {
+      int value;
+      while (num_popped.load() < kNumProducers * kNumElementsPerProducer) {
+        if (ring.TryPop(&value)) {
+          popped[c].push_back(value);
+          ++num_popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::vector<int> seen(kNumProducers * kNumElementsPerProducer, 0);
+  for (const auto& values : popped) {
+    // Elements of the same producer are popped in order by each consumer.
+    std::vector<int> last(kNumProducers, -1);
+    for (int value : values) {
+      ++seen[value];
+      int producer = value / kNumElementsPerProducer;
+      EXPECT_LT(last[producer], value);
+      last[producer] = value;
+    }
+  }
+  for (int count : seen) ASSERT_EQ(1, count);
+}
+
+}  // namespace
+}  // namespace stratum
@@ -40,6 +40,12 @@ ssize_t PassthroughLibcProxy::recvmsg(int sockfd, struct msghdr* msg,
   return ::recvmsg(sockfd, msg, flags);
 }
 
+int PassthroughLibcProxy::recvmmsg(int sockfd, struct mmsghdr* msgvec,
+                                   unsigned int vlen, int flags,
+                                   struct timespec* timeout) {
+  return ::recvmmsg(sockfd, msgvec, vlen, flags, timeout);
+}
+
 int PassthroughLibcProxy::epoll_create1(int flags) {
   return ::epoll_create1(flags);
 }
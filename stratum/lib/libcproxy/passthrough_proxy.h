@@ -39,6 +39,9 @@ class PassthroughLibcProxy {
 
   virtual ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags);
 
+  virtual int recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen,
+                       int flags, struct timespec* timeout);
+
   virtual int epoll_create1(int flags);
 
   virtual int epoll_ctl(int efd, int op, int fd, struct epoll_event* event);
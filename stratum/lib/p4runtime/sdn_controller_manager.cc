@@ -5,6 +5,8 @@
 #include "stratum/lib/p4runtime/sdn_controller_manager.h"
 
 #include <algorithm>
+#include <memory>
+#include <utility>
 
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
@@ -184,33 +186,6 @@ grpc::Status VerifyRoleConfig(
   return grpc::Status::OK;
 }
 
-bool VerifyStreamMessageNotFiltered(
-    const absl::optional<P4RoleConfig>& role_config,
-    const p4::v1::StreamMessageResponse& response) {
-  if (!role_config.has_value()) return true;  // No filter rules set, allow.
-
-  switch (response.update_case()) {
-    case p4::v1::StreamMessageResponse::kPacket: {
-      if (!role_config->receives_packet_ins()) return false;
-      if (!role_config->has_packet_in_filter()) return true;
-      for (const auto& metadata : response.packet().metadata()) {
-        if (role_config->packet_in_filter().metadata_id() ==
-                metadata.metadata_id() &&
-            role_config->packet_in_filter().value() == metadata.value()) {
-          return true;
-        }
-      }
-      VLOG(1) << "Discarding PacketIn " << response.packet().ShortDebugString()
-              << " because it did not match the role config filter: "
-              << role_config->packet_in_filter().ShortDebugString() << ".";
-      return false;  // No packet filter match, discard.
-    }
-    default:
-      // TODO(max): implement filtering for other message types
-      return true;
-  }
-}
-
 uint32_t GetP4IdFromEntity(const p4::v1::Entity& entity) {
   switch (entity.entity_case()) {
     case p4::v1::Entity::kExternEntry:
@@ -303,6 +278,27 @@ grpc::Status VerifyRoleCanAccessIds(
 
 }  // namespace
 
+SdnConnection::SdnConnection(
+    grpc::ServerContext* context,
+    grpc::ServerReaderWriterInterface<p4::v1::StreamMessageResponse,
+                                      p4::v1::StreamMessageRequest>* stream,
+    const SendQueueOptions& options)
+    : initialized_(false),
+      grpc_context_(context),
+      grpc_stream_(stream),
+      send_queue_options_(options),
+      stop_writer_(false),
+      stream_closed_(false),
+      writer_thread_([this]() { WriterLoop(); }) {}
+
+SdnConnection::~SdnConnection() {
+  {
+    absl::MutexLock l(&send_queue_lock_);
+    stop_writer_ = true;
+  }
+  writer_thread_.join();
+}
+
 void SdnConnection::SetElectionId(const absl::optional<absl::uint128>& id) {
   election_id_ = id;
 }
@@ -315,7 +311,7 @@ void SdnConnection::SetRoleName(const absl::optional<std::string>& name) {
   role_name_ = name;
 }
 
-absl::optional<std::string> SdnConnection::GetRoleName() const {
+const absl::optional<std::string>& SdnConnection::GetRoleName() const {
   return role_name_;
 }
 
@@ -327,10 +323,98 @@ std::string SdnConnection::GetName() const {
 
 void SdnConnection::SendStreamMessageResponse(
     const p4::v1::StreamMessageResponse& response) {
-  VLOG(2) << "Sending response: " << response.ShortDebugString();
-  if (!grpc_stream_->Write(response)) {
+  SendStreamMessageResponse(
+      std::make_shared<const p4::v1::StreamMessageResponse>(response));
+}
+
+void SdnConnection::SendStreamMessageResponse(
+    StreamMessageResponsePtr response) {
+  absl::MutexLock l(&send_queue_lock_);
+  if (stream_closed_) {
+    ++send_queue_stats_.dropped[response->update_case()];
+    return;
+  }
+  if (send_queue_.size() >= send_queue_options_.max_size) {
+    const auto kind = response->update_case();
+    auto it = send_queue_options_.drop_policies.find(kind);
+    if (it != send_queue_options_.drop_policies.end()) {
+      auto oldest = send_queue_.end();
+      if (it->second == DropPolicy::kDropOldest) {
+        oldest = std::find_if(send_queue_.begin(), send_queue_.end(),
+                              [kind](const StreamMessageResponsePtr& queued) {
+                                return queued->update_case() == kind;
+                              });
+      }
+      ++send_queue_stats_.dropped[kind];
+      VLOG(1) << "Outbound queue of SDN connection " << GetName()
+              << " is full, dropping " << (oldest == send_queue_.end()
+                                               ? "new"
+                                               : "oldest queued")
+              << " message: " << response->ShortDebugString();
+      if (oldest == send_queue_.end()) return;
+      send_queue_.erase(oldest);
+    }
+  }
+  send_queue_.push_back(std::move(response));
+  send_queue_stats_.max_backlog =
+      std::max(send_queue_stats_.max_backlog, send_queue_.size());
+}
+
+SdnConnection::SendQueueStats SdnConnection::GetSendQueueStats() const {
+  absl::MutexLock l(&send_queue_lock_);
+  SendQueueStats stats = send_queue_stats_;
+  stats.backlog = send_queue_.size();
+  return stats;
+}
+
+bool SdnConnection::WriterShouldWake() const {
+  return stop_writer_ || !send_queue_.empty();
+}
+
+void SdnConnection::DropSendQueue() {
+  for (const auto& response : send_queue_) {
+    ++send_queue_stats_.dropped[response->update_case()];
+  }
+  send_queue_.clear();
+}
+
+void SdnConnection::WriterLoop() {
+  while (true) {
+    StreamMessageResponsePtr response;
+    {
+      absl::MutexLock l(&send_queue_lock_);
+      send_queue_lock_.Await(
+          absl::Condition(this, &SdnConnection::WriterShouldWake));
+      // The messages still queued are written before the thread exits.
+      if (send_queue_.empty()) return;
+      // Nothing can be written to a cancelled stream, e.g. after the
+      // controller disconnected.
+      if (grpc_context_->IsCancelled()) {
+        VLOG(1) << "Stream to gRPC context '" << grpc_context_
+                << "' is cancelled, dropping " << send_queue_.size()
+                << " queued messages.";
+        stream_closed_ = true;
+        DropSendQueue();
+        continue;
+      }
+      response = std::move(send_queue_.front());
+      send_queue_.pop_front();
+    }
+    VLOG(2) << "Sending response: " << response->ShortDebugString();
+    const bool success = grpc_stream_->Write(*response);
+    absl::MutexLock l(&send_queue_lock_);
+    if (success) {
+      ++send_queue_stats_.sent;
+      continue;
+    }
+    ++send_queue_stats_.write_failures;
+    // A failed write means the stream is broken, so the remaining messages
+    // are dropped rather than written one by one.
     LOG(ERROR) << "Could not send stream message response to gRPC context '"
-               << grpc_context_ << "': " << response.ShortDebugString();
+               << grpc_context_ << "', dropping " << send_queue_.size()
+               << " queued messages: " << response->ShortDebugString();
+    stream_closed_ = true;
+    DropSendQueue();
   }
 }
 
@@ -456,6 +540,7 @@ grpc::Status SdnControllerManager::HandleArbitrationUpdate(
     election_id_past_for_role = new_election_id_for_connection;
     // Update the configuration for this controllers role.
     role_config_by_name_[role_name] = role_config;
+    stream_filter_by_role_[role_name] = CompileStreamMessageFilter(role_config);
     // The spec demands we send a notifcation even if the old & new primary
     // match.
     InformConnectionsAboutPrimaryChange(role_name);
@@ -509,6 +594,14 @@ void SdnControllerManager::Disconnect(SdnConnection* connection) {
                 << " with election ID "
                 << PrettyPrintElectionId(connection->GetElectionId()) << ".";
       connections_.erase(iter);
+      const auto stats = connection->GetSendQueueStats();
+      uint64_t dropped = 0;
+      for (const auto& e : stats.dropped) dropped += e.second;
+      LOG(INFO) << "Outbound queue of SDN connection " << connection->GetName()
+                << ": " << stats.sent << " sent, " << stats.write_failures
+                << " write failures, " << dropped << " dropped, "
+                << stats.backlog << " backlog, " << stats.max_backlog
+                << " max backlog.";
       break;
     }
   }
@@ -746,7 +839,7 @@ void SdnControllerManager::SendArbitrationResponse(SdnConnection* connection) {
   if (connection->GetRoleName().has_value()) {
     *arbitration->mutable_role()->mutable_name() =
         connection->GetRoleName().value();
-    absl::optional<P4RoleConfig> role_config =
+    const absl::optional<P4RoleConfig>& role_config =
         role_config_by_name_[connection->GetRoleName()];
     if (role_config.has_value()) {
       arbitration->mutable_role()->mutable_config()->PackFrom(*role_config);
@@ -799,20 +892,26 @@ absl::Status SdnControllerManager::SendPacketInToPrimary(
 
 absl::Status SdnControllerManager::SendStreamMessageToPrimary(
     const p4::v1::StreamMessageResponse& response) {
+  // The message is shared by the outbound queues of all the connections it is
+  // sent to.
+  auto shared_response =
+      std::make_shared<const p4::v1::StreamMessageResponse>(response);
+
   absl::MutexLock l(&lock_);
 
   bool found_at_least_one_primary = false;
 
   for (const auto& connection : connections_) {
-    absl::optional<absl::uint128> election_id_past_for_role =
-        election_id_past_by_role_[connection->GetRoleName()];
-    if (election_id_past_for_role.has_value() &&
-        election_id_past_for_role == connection->GetElectionId()) {
-      absl::optional<P4RoleConfig> role_config =
-          role_config_by_name_[connection->GetRoleName()];
-      if (VerifyStreamMessageNotFiltered(role_config, response)) {
+    const auto& role_name = connection->GetRoleName();
+    auto election_id_past_for_role = election_id_past_by_role_.find(role_name);
+    if (election_id_past_for_role != election_id_past_by_role_.end() &&
+        election_id_past_for_role->second.has_value() &&
+        election_id_past_for_role->second == connection->GetElectionId()) {
+      auto filter = stream_filter_by_role_.find(role_name);
+      if (filter == stream_filter_by_role_.end() ||
+          StreamMessageNotFiltered(filter->second, response)) {
         found_at_least_one_primary = true;
-        connection->SendStreamMessageResponse(response);
+        connection->SendStreamMessageResponse(shared_response);
       }
       // We don't report an error for packets getting filtered as this is
       // expected operation.
@@ -829,5 +928,42 @@ absl::Status SdnControllerManager::SendStreamMessageToPrimary(
   return absl::OkStatus();
 }
 
+SdnControllerManager::StreamMessageFilter
+SdnControllerManager::CompileStreamMessageFilter(
+    const absl::optional<P4RoleConfig>& role_config) {
+  StreamMessageFilter filter;
+  if (!role_config.has_value()) return filter;  // No filter rules set.
+  filter.receives_packet_ins = role_config->receives_packet_ins();
+  filter.has_packet_in_filter = role_config->has_packet_in_filter();
+  filter.packet_in_filter_metadata_id =
+      role_config->packet_in_filter().metadata_id();
+  filter.packet_in_filter_value = role_config->packet_in_filter().value();
+  return filter;
+}
+
+bool SdnControllerManager::StreamMessageNotFiltered(
+    const StreamMessageFilter& filter,
+    const p4::v1::StreamMessageResponse& response) {
+  switch (response.update_case()) {
+    case p4::v1::StreamMessageResponse::kPacket: {
+      if (!filter.receives_packet_ins) return false;
+      if (!filter.has_packet_in_filter) return true;
+      for (const auto& metadata : response.packet().metadata()) {
+        if (filter.packet_in_filter_metadata_id == metadata.metadata_id() &&
+            filter.packet_in_filter_value == metadata.value()) {
+          return true;
+        }
+      }
+      VLOG(1) << "Discarding PacketIn " << response.packet().ShortDebugString()
+              << " because it did not match the role config filter for "
+              << "metadata ID " << filter.packet_in_filter_metadata_id << ".";
+      return false;  // No packet filter match, discard.
+    }
+    default:
+      // TODO(max): implement filtering for other message types
+      return true;
+  }
+}
+
 }  // namespace p4runtime
 }  // namespace stratum
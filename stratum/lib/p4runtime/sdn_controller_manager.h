@@ -5,13 +5,18 @@
 #ifndef STRATUM_LIB_P4RUNTIME_SDN_CONTROLLER_MANAGER_H_
 #define STRATUM_LIB_P4RUNTIME_SDN_CONTROLLER_MANAGER_H_
 
+#include <deque>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 #include "p4/v1/p4runtime.grpc.pb.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/public/proto/p4_role_config.pb.h"
@@ -23,13 +28,72 @@ namespace p4runtime {
 constexpr char kP4RuntimeRoleSdnController[] = "sdn_controller";
 
 // A connection between a controller and p4rt server.
+//
+// Stream messages are not written to the gRPC stream by the caller. They are
+// put on a bounded outbound queue and written by a writer thread owned by the
+// connection, so a slow or stalled controller cannot block the threads sending
+// PacketIns, digests or arbitration updates to the other controllers. When the
+// queue is full, a message is dropped according to the drop policy of its kind.
 class SdnConnection {
  public:
+  using StreamMessageResponsePtr =
+      std::shared_ptr<const p4::v1::StreamMessageResponse>;
+
+  // What to do with a message that does not fit on a full outbound queue.
+  enum class DropPolicy {
+    // Drop the oldest queued message of the same kind, then queue the message.
+    // If no message of that kind is queued, the message itself is dropped.
+    kDropOldest,
+    // Drop the message itself.
+    kDropNewest,
+  };
+
+  struct SendQueueOptions {
+    // The maximum number of messages waiting to be written.
+    size_t max_size = 1024;
+    // The drop policy for each message kind. Messages of kinds not listed here
+    // (e.g. arbitration updates) are never dropped, even if the queue is full.
+    absl::flat_hash_map<p4::v1::StreamMessageResponse::UpdateCase, DropPolicy>
+        drop_policies = {
+            {p4::v1::StreamMessageResponse::kPacket, DropPolicy::kDropOldest},
+            {p4::v1::StreamMessageResponse::kDigest, DropPolicy::kDropNewest},
+            {p4::v1::StreamMessageResponse::kIdleTimeoutNotification,
+             DropPolicy::kDropNewest},
+            {p4::v1::StreamMessageResponse::kError, DropPolicy::kDropNewest},
+        };
+  };
+
+  // Statistics of the outbound queue.
+  struct SendQueueStats {
+    // The number of messages waiting to be written.
+    size_t backlog = 0;
+    // The largest backlog seen so far.
+    size_t max_backlog = 0;
+    // The number of messages written to the stream.
+    uint64_t sent = 0;
+    // The number of messages the stream failed to write.
+    uint64_t write_failures = 0;
+    // The number of messages dropped, by message kind. Once the stream is
+    // cancelled or a write fails, all the messages of the connection are
+    // dropped, whatever their kind.
+    absl::flat_hash_map<p4::v1::StreamMessageResponse::UpdateCase, uint64_t>
+        dropped;
+  };
+
   SdnConnection(
       grpc::ServerContext* context,
       grpc::ServerReaderWriterInterface<p4::v1::StreamMessageResponse,
                                         p4::v1::StreamMessageRequest>* stream)
-      : initialized_(false), grpc_context_(context), grpc_stream_(stream) {}
+      : SdnConnection(context, stream, SendQueueOptions()) {}
+  SdnConnection(
+      grpc::ServerContext* context,
+      grpc::ServerReaderWriterInterface<p4::v1::StreamMessageResponse,
+                                        p4::v1::StreamMessageRequest>* stream,
+      const SendQueueOptions& options);
+
+  // Writes the messages still queued, unless the stream is gone, and stops the
+  // writer thread.
+  ~SdnConnection();
 
   void Initialize() { initialized_ = true; }
   bool IsInitialized() const { return initialized_; }
@@ -38,15 +102,37 @@ class SdnConnection {
   absl::optional<absl::uint128> GetElectionId() const;
 
   void SetRoleName(const absl::optional<std::string>& name);
-  absl::optional<std::string> GetRoleName() const;
+  const absl::optional<std::string>& GetRoleName() const;
 
   // A unique name string for the controller.
   std::string GetName() const;
 
-  // Sends back StreamMessageResponse to this controller.
-  void SendStreamMessageResponse(const p4::v1::StreamMessageResponse& response);
+  // Sends back StreamMessageResponse to this controller. The message is queued
+  // and written asynchronously.
+  void SendStreamMessageResponse(const p4::v1::StreamMessageResponse& response)
+      ABSL_LOCKS_EXCLUDED(send_queue_lock_);
+  void SendStreamMessageResponse(StreamMessageResponsePtr response)
+      ABSL_LOCKS_EXCLUDED(send_queue_lock_);
+
+  // Returns the statistics of the outbound queue.
+  SendQueueStats GetSendQueueStats() const
+      ABSL_LOCKS_EXCLUDED(send_queue_lock_);
+
+  // SdnConnection is neither copyable nor movable.
+  SdnConnection(const SdnConnection&) = delete;
+  SdnConnection& operator=(const SdnConnection&) = delete;
 
  private:
+  // Writes the queued messages to the stream until the connection is
+  // destroyed.
+  void WriterLoop() ABSL_LOCKS_EXCLUDED(send_queue_lock_);
+
+  // Returns true if the writer thread has a message to write or should exit.
+  bool WriterShouldWake() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(send_queue_lock_);
+
+  // Drops all the queued messages and counts them as dropped.
+  void DropSendQueue() ABSL_EXCLUSIVE_LOCKS_REQUIRED(send_queue_lock_);
+
   // The SDN connection should be initialized through arbitration before it can
   // be used.
   bool initialized_;
@@ -68,6 +154,29 @@ class SdnConnection {
   grpc::ServerReaderWriterInterface<p4::v1::StreamMessageResponse,
                                     p4::v1::StreamMessageRequest>*
       grpc_stream_;  // not owned.
+
+  // Configuration of the outbound queue.
+  const SendQueueOptions send_queue_options_;
+
+  // Lock for protecting the outbound queue.
+  mutable absl::Mutex send_queue_lock_;
+
+  // The messages waiting to be written, oldest first.
+  std::deque<StreamMessageResponsePtr> send_queue_
+      ABSL_GUARDED_BY(send_queue_lock_);
+
+  // Statistics of the outbound queue. The backlog is computed on demand.
+  SendQueueStats send_queue_stats_ ABSL_GUARDED_BY(send_queue_lock_);
+
+  // True once the writer thread should exit after emptying the queue.
+  bool stop_writer_ ABSL_GUARDED_BY(send_queue_lock_);
+
+  // True once the stream has been cancelled or a write to it has failed. No
+  // more messages are written to it after that.
+  bool stream_closed_ ABSL_GUARDED_BY(send_queue_lock_);
+
+  // The thread writing the queued messages to the stream.
+  std::thread writer_thread_;
 };
 
 class SdnControllerManager {
@@ -123,6 +232,25 @@ class SdnControllerManager {
   void SendArbitrationResponse(SdnConnection* connection)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // The stream message filter of a role, compiled from its role config so that
+  // sending a stream message does not need to look at the config.
+  struct StreamMessageFilter {
+    bool receives_packet_ins = true;
+    bool has_packet_in_filter = false;
+    uint32_t packet_in_filter_metadata_id = 0;
+    std::string packet_in_filter_value;
+  };
+
+  // Compiles the stream message filter of a role config. A role without config
+  // receives all stream messages.
+  static StreamMessageFilter CompileStreamMessageFilter(
+      const absl::optional<P4RoleConfig>& role_config);
+
+  // Returns true if the filter lets the message through.
+  static bool StreamMessageNotFiltered(
+      const StreamMessageFilter& filter,
+      const p4::v1::StreamMessageResponse& response);
+
   // Lock for protecting SdnControllerManager member fields.
   mutable absl::Mutex lock_;
 
@@ -158,6 +286,14 @@ class SdnControllerManager {
           {absl::nullopt, {}},  // default role
       };
 
+  // The stream message filters compiled from role_config_by_name_. Roles
+  // without an entry receive all stream messages.
+  //
+  // key:   role_name   (no value indicates the default/root role)
+  // value: stream message filter
+  absl::flat_hash_map<absl::optional<std::string>, StreamMessageFilter>
+      stream_filter_by_role_ ABSL_GUARDED_BY(lock_);
+
   // We maintain a map of the highest election IDs that have been selected for
   // the primary connection of a role. Once an election ID is set all new
   // primary connections for that role must use an election ID that is >= in
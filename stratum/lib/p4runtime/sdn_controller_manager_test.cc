@@ -0,0 +1,127 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/lib/p4runtime/sdn_controller_manager.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "grpcpp/grpcpp.h"
+#include "gtest/gtest.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/lib/p4runtime/stream_message_reader_writer_mock.h"
+#include "stratum/lib/test_utils/matchers.h"
+
+namespace stratum {
+namespace p4runtime {
+namespace {
+
+using ::stratum::test_utils::EqualsProto;
+using ::testing::_;
+using ::testing::Invoke;
+
+::p4::v1::StreamMessageResponse PacketIn(const std::string& payload) {
+  ::p4::v1::StreamMessageResponse resp;
+  resp.mutable_packet()->set_payload(payload);
+  return resp;
+}
+
+::p4::v1::StreamMessageResponse Digest(uint64_t list_id) {
+  ::p4::v1::StreamMessageResponse resp;
+  resp.mutable_digest()->set_list_id(list_id);
+  return resp;
+}
+
+// Checks that a stalled controller only fills its own send queue and that the
+// queue drops messages according to the drop policy of their kind.
+TEST(SdnConnectionTest, SendQueueDropsPerKindWhenFull) {
+  ::grpc::ServerContext context;
+  StreamMessageReaderWriterMock stream;
+  absl::Notification write_started;
+  absl::Notification write_released;
+  std::vector<::p4::v1::StreamMessageResponse> written;
+  EXPECT_CALL(stream, Write(_, _))
+      .WillRepeatedly(Invoke([&](const ::p4::v1::StreamMessageResponse& resp,
+                                 ::grpc::WriteOptions options) {
+        if (!write_started.HasBeenNotified()) write_started.Notify();
+        write_released.WaitForNotification();
+        written.push_back(resp);
+        return true;
+      }));
+  ::p4::v1::StreamMessageResponse arbitration;
+  arbitration.mutable_arbitration()->set_device_id(1);
+
+  SdnConnection::SendQueueOptions options;
+  options.max_size = 2;
+  {
+    SdnConnection connection(&context, &stream, options);
+    // The writer blocks on the first message, the others are queued.
+    connection.SendStreamMessageResponse(PacketIn("0"));
+    write_started.WaitForNotification();
+    connection.SendStreamMessageResponse(PacketIn("1"));
+    connection.SendStreamMessageResponse(Digest(1));
+    // The queue is full. The new PacketIn replaces the oldest queued one, the
+    // new digest is dropped and the arbitration update is always queued.
+    connection.SendStreamMessageResponse(PacketIn("2"));
+    connection.SendStreamMessageResponse(Digest(2));
+    connection.SendStreamMessageResponse(arbitration);
+
+    auto stats = connection.GetSendQueueStats();
+    EXPECT_EQ(3U, stats.backlog);
+    EXPECT_EQ(3U, stats.max_backlog);
+    EXPECT_EQ(1U, stats.dropped[::p4::v1::StreamMessageResponse::kPacket]);
+    EXPECT_EQ(1U, stats.dropped[::p4::v1::StreamMessageResponse::kDigest]);
+    write_released.Notify();
+  }  // The queued messages are written before the connection goes away.
+
+  ASSERT_EQ(4U, written.size());
+  EXPECT_EQ("0", written[0].packet().payload());
+  EXPECT_EQ(1U, written[1].digest().list_id());
+  EXPECT_EQ("2", written[2].packet().payload());
+  EXPECT_THAT(written[3], EqualsProto(arbitration));
+}
+
+// Checks that once a write fails, the queued messages and the ones sent later
+// are dropped instead of being written to the broken stream.
+TEST(SdnConnectionTest, SendQueueIsDroppedAfterWriteFailure) {
+  ::grpc::ServerContext context;
+  StreamMessageReaderWriterMock stream;
+  absl::Notification write_started;
+  absl::Notification write_released;
+  EXPECT_CALL(stream, Write(_, _))
+      .WillOnce(Invoke([&](const ::p4::v1::StreamMessageResponse& resp,
+                           ::grpc::WriteOptions options) {
+        write_started.Notify();
+        write_released.WaitForNotification();
+        return false;
+      }));
+  ::p4::v1::StreamMessageResponse arbitration;
+  arbitration.mutable_arbitration()->set_device_id(1);
+
+  SdnConnection connection(&context, &stream);
+  connection.SendStreamMessageResponse(PacketIn("0"));
+  write_started.WaitForNotification();
+  connection.SendStreamMessageResponse(PacketIn("1"));
+  connection.SendStreamMessageResponse(arbitration);
+  write_released.Notify();
+  while (connection.GetSendQueueStats().write_failures == 0) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  connection.SendStreamMessageResponse(Digest(1));
+
+  auto stats = connection.GetSendQueueStats();
+  EXPECT_EQ(0U, stats.backlog);
+  EXPECT_EQ(0U, stats.sent);
+  EXPECT_EQ(1U, stats.write_failures);
+  EXPECT_EQ(1U, stats.dropped[::p4::v1::StreamMessageResponse::kPacket]);
+  EXPECT_EQ(1U, stats.dropped[::p4::v1::StreamMessageResponse::kArbitration]);
+  EXPECT_EQ(1U, stats.dropped[::p4::v1::StreamMessageResponse::kDigest]);
+}
+
+}  // namespace
+}  // namespace p4runtime
+}  // namespace stratum
@@ -4,11 +4,25 @@
 
 #include "stratum/lib/timer_daemon.h"
 
+#include <algorithm>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+
+DEFINE_int32(timer_daemon_num_worker_threads, 4,
+             "Number of worker threads running the actions of the timers. With "
+             "0, the actions are run by the timer thread.");
 
 namespace stratum {
 namespace hal {
 
+constexpr int TimerDaemon::kNumLevels;
+constexpr int TimerDaemon::kSlotBits;
+constexpr int TimerDaemon::kNumSlots;
+
 namespace {
 // A function that is executed by the thread created by TimerDaemon::Start().
 // It provides a timer resolution of 1ms.
@@ -24,39 +38,190 @@ static void* Timer(void* arg) {
   }
   return nullptr;
 }
+
+// The length of a tick of the timer wheel.
+constexpr absl::Duration kTick = absl::Milliseconds(1);
 }  // namespace
 
+TimerDaemon::TimerDaemon()
+    : origin_(absl::Now()),
+      current_tick_(0),
+      num_timers_(0),
+      wheel_(),
+      started_(false),
+      queue_(),
+      stop_workers_(false),
+      worker_tids_() {}
+
 bool TimerDaemon::IsStopped() {
   absl::WriterMutexLock l(&access_lock_);
   return !started_;
 }
 
-TimerDaemon::DescriptorPtr TimerDaemon::GetAction() {
-  // Once woken up check if the timer at the top of the heap is due.
+int64 TimerDaemon::DueTick(absl::Time time) const {
+  return absl::ToInt64Milliseconds(absl::Ceil(time - origin_, kTick));
+}
+
+int64 TimerDaemon::CurrentTick(absl::Time time) const {
+  return absl::ToInt64Milliseconds(absl::Floor(time - origin_, kTick));
+}
+
+void TimerDaemon::InsertGroup(TimerGroup group, int64 earliest_tick) {
+  group.due_tick = std::max(group.due_tick, earliest_tick);
+  const int64 delta = group.due_tick - current_tick_;
+  int level = 0;
+  while (level < kNumLevels - 1 &&
+         delta >= (int64{1} << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+  // Timers beyond the range of the wheel are parked in the last slot of the
+  // top level and re-inserted each time that slot is cascaded.
+  const int64 max_delta = (int64{1} << (kSlotBits * kNumLevels)) - 1;
+  const int64 slot_tick = current_tick_ + std::min(delta, max_delta);
+  Slot& slot =
+      wheel_[level][(slot_tick >> (kSlotBits * level)) & (kNumSlots - 1)];
+  num_timers_ += group.timers.size();
+  if (!slot.empty() && slot.back().due_tick == group.due_tick &&
+      slot.back().period_ticks == group.period_ticks) {
+    auto& timers = slot.back().timers;
+    timers.insert(timers.end(), group.timers.begin(), group.timers.end());
+  } else {
+    slot.push_back(std::move(group));
+  }
+}
+
+void TimerDaemon::Cascade(int level) {
+  Slot slot;
+  slot.swap(
+      wheel_[level][(current_tick_ >> (kSlotBits * level)) & (kNumSlots - 1)]);
+  for (auto& group : slot) {
+    num_timers_ -= group.timers.size();
+    // Cascading happens before the level 0 slot of the current tick is
+    // drained, so groups due in this tick still expire in it.
+    InsertGroup(std::move(group), current_tick_);
+  }
+}
+
+void TimerDaemon::Clear() {
+  for (auto& level : wheel_) {
+    for (auto& slot : level) slot.clear();
+  }
+  num_timers_ = 0;
+}
+
+std::vector<TimerDaemon::DescriptorPtr> TimerDaemon::GetActions() {
   absl::WriterMutexLock l(&access_lock_);
+  return AdvanceTo(CurrentTick(absl::Now()));
+}
 
-  if (timers_.empty()) {
-    return nullptr;
+std::vector<TimerDaemon::DescriptorPtr> TimerDaemon::AdvanceTo(
+    int64 now_tick) {
+  std::vector<DescriptorPtr> actions;
+  while (current_tick_ < now_tick) {
+    if (num_timers_ == 0) {
+      // Nothing to expire, jump straight to the current tick.
+      current_tick_ = now_tick;
+      break;
+    }
+    ++current_tick_;
+    // When the lower levels wrap around, the next slot of the level above is
+    // spread over them.
+    for (int level = 1; level < kNumLevels; ++level) {
+      if ((current_tick_ & ((int64{1} << (kSlotBits * level)) - 1)) != 0) break;
+      Cascade(level);
+    }
+    Slot slot;
+    slot.swap(wheel_[0][current_tick_ & (kNumSlots - 1)]);
+    for (auto& group : slot) {
+      num_timers_ -= group.timers.size();
+      // Canceled timers are dropped, the live ones are expired together.
+      size_t num_live = 0;
+      for (size_t i = 0; i < group.timers.size(); ++i) {
+        if (DescriptorPtr desc = group.timers[i].lock()) {
+          actions.push_back(desc);
+          if (num_live != i) group.timers[num_live] = group.timers[i];
+          ++num_live;
+        }
+      }
+      group.timers.resize(num_live);
+      if (group.period_ticks == 0 || group.timers.empty()) continue;
+      // Periodic timers keep their phase. Periods missed while the daemon was
+      // late are skipped rather than run back-to-back.
+      group.due_tick += group.period_ticks;
+      if (group.due_tick <= now_tick) {
+        group.due_tick +=
+            ((now_tick - group.due_tick) / group.period_ticks + 1) *
+            group.period_ticks;
+      }
+      InsertGroup(std::move(group), current_tick_ + 1);
+    }
   }
-  if (timers_.front().expired()) {
-    pop_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
-    timers_.pop_back();
-    return nullptr;
+  return actions;
+}
+
+void TimerDaemon::RunActions(const std::vector<DescriptorPtr>& actions) {
+  if (actions.empty()) return;
+  {
+    absl::MutexLock l(&pool_lock_);
+    // Map from batch runner to the index of its batch in the queue.
+    absl::flat_hash_map<const BatchRunner*, size_t> runner_batches;
+    for (const auto& desc : actions) {
+      if (desc->running_) {
+        VLOG(1) << "Timer skipped, its previous action is still running.";
+        continue;
+      }
+      desc->running_ = true;
+      if (desc->batch_runner_ == nullptr) {
+        queue_.push_back({nullptr, {desc}});
+        continue;
+      }
+      auto ret =
+          runner_batches.emplace(desc->batch_runner_.get(), queue_.size());
+      if (ret.second) queue_.push_back({desc->batch_runner_, {}});
+      queue_[ret.first->second].timers.push_back(desc);
+    }
   }
-  TimerDaemon::DescriptorPtr front = DescriptorPtr(timers_.front());
-  absl::Time now = absl::Now();
-  if (front->due_time_ <= now) {
-    pop_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
-    timers_.pop_back();
-    if (front->Repeat()) {
-      // Periodic timer. Insert it in the queue again.
-      front->due_time_ += front->Period();
-      timers_.push_back(front);
-      push_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
+  if (worker_tids_.empty()) {
+    while (RunNextAction()) {
     }
-    return front;
   }
-  return nullptr;
+}
+
+bool TimerDaemon::RunNextAction() {
+  ActionBatch batch;
+  {
+    absl::MutexLock l(&pool_lock_);
+    if (queue_.empty()) return false;
+    batch = std::move(queue_.front());
+    queue_.pop_front();
+  }
+  // Execute the timers' actions!
+  const auto& status = batch.batch_runner != nullptr
+                           ? (*batch.batch_runner)(batch.timers)
+                           : batch.timers.front()->ExecuteAction();
+  if (status.ok()) {
+    VLOG(1) << "Timer has been triggered!";
+  } else {
+    LOG(ERROR) << "Error executing action: " << status;
+  }
+  absl::MutexLock l(&pool_lock_);
+  for (const auto& desc : batch.timers) desc->running_ = false;
+  return true;
+}
+
+bool TimerDaemon::WorkerShouldWake() const {
+  return stop_workers_ || !queue_.empty();
+}
+
+void TimerDaemon::WorkerLoop() {
+  while (true) {
+    {
+      absl::MutexLock l(&pool_lock_);
+      pool_lock_.Await(absl::Condition(this, &TimerDaemon::WorkerShouldWake));
+      if (stop_workers_) return;
+    }
+    RunNextAction();
+  }
 }
 
 bool TimerDaemon::Execute() {
@@ -64,28 +229,41 @@ bool TimerDaemon::Execute() {
 
   if (daemon->IsStopped()) return false;
 
-  auto front = daemon->GetAction();
-  if (front != nullptr) {
-    // Execute the timer's action!
-    const auto& status = front->ExecuteAction();
-    if (status.ok()) {
-      VLOG(1) << "Timer has been triggered!";
-    } else {
-      LOG(ERROR) << "Error executing action: " << status;
-    }
-  }
+  daemon->RunActions(daemon->GetActions());
   return true;
 }
 
 ::util::Status TimerDaemon::Start() {
-  absl::WriterMutexLock l(&GetInstance()->access_lock_);
-  if (GetInstance()->started_ == true) {
+  TimerDaemon* daemon = GetInstance();
+  absl::WriterMutexLock l(&daemon->access_lock_);
+  if (daemon->started_ == true) {
     return ::util::OkStatus();
   }
 
-  GetInstance()->started_ = true;
+  daemon->started_ = true;
+  if (daemon->num_timers_ == 0) {
+    daemon->current_tick_ = daemon->CurrentTick(absl::Now());
+  }
 
-  if (pthread_create(&GetInstance()->tid_, nullptr, &Timer, nullptr) != 0) {
+  {
+    absl::MutexLock pool_lock(&daemon->pool_lock_);
+    daemon->stop_workers_ = false;
+  }
+  for (int i = 0; i < FLAGS_timer_daemon_num_worker_threads; ++i) {
+    pthread_t tid;
+    if (pthread_create(
+            &tid, nullptr,
+            [](void* arg) -> void* {
+              static_cast<TimerDaemon*>(arg)->WorkerLoop();
+              return nullptr;
+            },
+            daemon) != 0) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Failed to create a worker thread.";
+    }
+    daemon->worker_tids_.push_back(tid);
+  }
+
+  if (pthread_create(&daemon->tid_, nullptr, &Timer, nullptr) != 0) {
     return MAKE_ERROR(ERR_INTERNAL) << "Failed to create the timer thread.";
   } else {
     VLOG(1) << "The timer daemon has been started.";
@@ -94,25 +272,42 @@ bool TimerDaemon::Execute() {
 }
 
 ::util::Status TimerDaemon::Stop() {
+  TimerDaemon* daemon = GetInstance();
   {
-    absl::WriterMutexLock l(&GetInstance()->access_lock_);
-    if (GetInstance()->started_ == false) {
+    absl::WriterMutexLock l(&daemon->access_lock_);
+    if (daemon->started_ == false) {
       return ::util::OkStatus();
     }
 
-    GetInstance()->started_ = false;
+    daemon->started_ = false;
   }
 
-  if (pthread_join(GetInstance()->tid_, nullptr) != 0) {
+  if (pthread_join(daemon->tid_, nullptr) != 0) {
     return MAKE_ERROR(ERR_INTERNAL) << "Failed to join the timer thread.";
-  } else {
-    absl::WriterMutexLock l(&GetInstance()->access_lock_);
-    GetInstance()->timers_.clear();
-    GetInstance()->tid_ = 0;
-
-    VLOG(1) << "The timer daemon has been stopped.";
-    return ::util::OkStatus();
   }
+  {
+    // The queued actions are dropped, the running ones complete before the
+    // worker threads exit.
+    absl::MutexLock l(&daemon->pool_lock_);
+    daemon->stop_workers_ = true;
+    for (const auto& batch : daemon->queue_) {
+      for (const auto& desc : batch.timers) desc->running_ = false;
+    }
+    daemon->queue_.clear();
+  }
+  for (pthread_t tid : daemon->worker_tids_) {
+    if (pthread_join(tid, nullptr) != 0) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Failed to join a worker thread.";
+    }
+  }
+  daemon->worker_tids_.clear();
+
+  absl::WriterMutexLock l(&daemon->access_lock_);
+  daemon->Clear();
+  daemon->tid_ = 0;
+
+  VLOG(1) << "The timer daemon has been stopped.";
+  return ::util::OkStatus();
 }
 
 ::util::Status TimerDaemon::RequestOneShotTimer(uint64 delay_ms,
@@ -120,29 +315,41 @@ bool TimerDaemon::Execute() {
                                                 DescriptorPtr* desc) {
   return GetInstance()->RequestTimer(false, delay_ms,
                                      /* period_ms (ignored)= */ 0, action,
-                                     desc);
+                                     desc, /* batch_runner= */ nullptr);
 }
 
-::util::Status TimerDaemon::RequestPeriodicTimer(uint64 delay_ms,
-                                                 uint64 period_ms,
-                                                 const Action& action,
-                                                 DescriptorPtr* desc) {
-  return GetInstance()->RequestTimer(true, delay_ms, period_ms, action, desc);
+::util::Status TimerDaemon::RequestPeriodicTimer(
+    uint64 delay_ms, uint64 period_ms, const Action& action,
+    DescriptorPtr* desc, const BatchRunnerPtr& batch_runner) {
+  return GetInstance()->RequestTimer(true, delay_ms, period_ms, action, desc,
+                                     batch_runner);
 }
 
 ::util::Status TimerDaemon::RequestTimer(bool repeat, uint64 delay_ms,
                                          uint64 period_ms, Action action,
-                                         DescriptorPtr* desc) {
+                                         DescriptorPtr* desc,
+                                         const BatchRunnerPtr& batch_runner) {
   absl::WriterMutexLock l(&access_lock_);
 
   VLOG(1) << "Registered timer.";
 
   absl::Time now = absl::Now();
+  if (num_timers_ == 0) {
+    // The wheel does not need to catch up on ticks without timers.
+    current_tick_ = std::max(current_tick_, CurrentTick(now));
+  }
   *desc = std::make_shared<Descriptor>(repeat, action);
   (*desc)->due_time_ = now + absl::Milliseconds(delay_ms);
   (*desc)->period_ = absl::Milliseconds(period_ms);
-  timers_.push_back(DescriptorWeakPtr(*desc));
-  push_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
+  (*desc)->batch_runner_ = batch_runner;
+
+  TimerGroup group;
+  group.due_tick = DueTick((*desc)->due_time_);
+  // A tick is 1ms long and a periodic timer expires at most once per tick.
+  group.period_ticks = repeat ? std::max<int64>(1, period_ms) : 0;
+  group.timers.push_back(DescriptorWeakPtr(*desc));
+  // Timers cannot expire in a tick that has already been processed.
+  InsertGroup(std::move(group), current_tick_ + 1);
 
   return ::util::OkStatus();
 }
@@ -7,7 +7,8 @@
 
 #include <pthread.h>
 
-#include <algorithm>
+#include <array>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -24,7 +25,29 @@
 namespace stratum {
 namespace hal {
 
+// The TimerDaemon keeps the timers in a hierarchical timer wheel with a
+// resolution of 1ms. Requesting a timer and canceling it, by releasing its
+// descriptor, are O(1). Timers which are due in the same tick with the same
+// period are kept together in a group that expires and is re-scheduled as a
+// whole, so the many periodic timers of gNMI SAMPLE subscriptions cost one
+// wheel operation per group and tick. The actions of the timers that expire
+// in a tick are run by a pool of worker threads. The timer thread does not wait
+// for them, so a slow action does not delay the other timers. A timer whose
+// previous action is still running skips the tick, the action of a timer never
+// runs concurrently with itself. Timers can share a batch runner, which is
+// given all of them that expire in the same tick, instead of their actions
+// being run one by one.
 class TimerDaemon final {
+ private:
+  class Descriptor;
+
+ public:
+  using DescriptorPtr = std::shared_ptr<Descriptor>;
+  // Runs the actions of the given timers, by calling their ExecuteAction().
+  using BatchRunner =
+      std::function<::util::Status(const std::vector<DescriptorPtr>&)>;
+  using BatchRunnerPtr = std::shared_ptr<const BatchRunner>;
+
  private:
   using Action = std::function<::util::Status()>;
 
@@ -42,6 +65,11 @@ class TimerDaemon final {
     bool repeat_;
     absl::Time due_time_;
     absl::Duration period_;
+    // True while the action is queued or running. Guarded by the pool_lock_
+    // of the TimerDaemon.
+    bool running_ = false;
+    // The runner of the action, or nullptr if it is run on its own.
+    BatchRunnerPtr batch_runner_;
 
    private:
     Action action_ = []() {
@@ -52,51 +80,41 @@ class TimerDaemon final {
 
   using DescriptorWeakPtr = std::weak_ptr<Descriptor>;
 
-  // In order to use TimerDaemon::Descriptor as a key in heap operations a
-  // comparator functor has to be defined.
-  struct TimerDescriptorComparator {
-    bool operator()(const TimerDaemon::DescriptorWeakPtr& lhs,
-                    const TimerDaemon::DescriptorWeakPtr& rhs) const {
-      // The goal of this method is to find which timer descriptor describes a
-      // timer that should be executed earlier: lhs or rhs?
-      // If a timer is canceled then the weak pointer pointing to it will
-      // 'expire' and there is no point in keeping such pointer on the heap. As
-      // the most effective way of removing an element from a heap is to move it
-      // to the top and then delete it, expired pointers should be theated as
-      // ones that are to be executed 'now'. This approach makes them to
-      // 'bubbled up' to the top as quickly as possible and then they can be
-      // removed.
-      if (lhs.expired() && !rhs.expired()) {
-        // rhs is expired, so, it is the lowest number.
-        return true;
-      }
-      if (rhs.expired() && !lhs.expired()) {
-        // lhs is expired, so, it is the lowest number.
-        return false;
-      }
-      if (rhs.expired() && lhs.expired()) {
-        // Both are expired, so, it really does not matter what we return.
-        return false;
-      }
-      // Both elements are still valid. Compare them!
-      return std::shared_ptr<Descriptor>(lhs)->due_time_ >
-             std::shared_ptr<Descriptor>(rhs)->due_time_;
-    }
+  // The timers whose actions are run together by a worker thread: a single
+  // timer, or the timers of a batch runner that expired in the same tick.
+  struct ActionBatch {
+    BatchRunnerPtr batch_runner;
+    std::vector<DescriptorPtr> timers;
   };
 
- public:
-  using DescriptorPtr = std::shared_ptr<Descriptor>;
+  // Timers that are due in the same tick and have the same period. A canceled
+  // timer stays in its group until the group expires and is then dropped.
+  struct TimerGroup {
+    // The tick in which the timers are due.
+    int64 due_tick;
+    // The period of the timers in ticks, or 0 for one-shot timers.
+    int64 period_ticks;
+    std::vector<DescriptorWeakPtr> timers;
+  };
+
+  // The wheel has kNumLevels levels of kNumSlots slots. A slot of level 0
+  // spans one tick, a slot of level n spans all the slots of level n-1.
+  static constexpr int kNumLevels = 4;
+  static constexpr int kSlotBits = 8;
+  static constexpr int kNumSlots = 1 << kSlotBits;
+  using Slot = std::vector<TimerGroup>;
 
-  // Starts the timer service. Creates a thread that calls Execute() every 1ms.
+ public:
+  // Starts the timer service. Creates a thread that calls Execute() every 1ms
+  // and the worker threads that run the timer actions.
   static ::util::Status Start() LOCKS_EXCLUDED(access_lock_);
-  // Stops the timer service. Notifies the timer thread to exit and waits until
-  // it joins.
+  // Stops the timer service. Notifies the timer and worker threads to exit and
+  // waits until they join.
   static ::util::Status Stop() LOCKS_EXCLUDED(access_lock_);
-  // The 'worker' of the timer service. Is called every 1ms and checks if the
-  // first timer to be executed should be executed. If so, the action is
-  // executed and then if the timer is periodic the timer is updated and
-  // re-inserted into the heap with timers. It also takes care of all expired
-  // timers.
+  // The 'worker' of the timer service. Is called every 1ms and advances the
+  // wheel to the current time. The actions of all the timers that are due are
+  // queued to the worker threads, or run by the calling thread if there are
+  // none. Periodic timers are re-scheduled and canceled timers dropped.
   static bool Execute() LOCKS_EXCLUDED(access_lock_);
 
   // Creates a one-shot timer that will execute 'action' 'delay_ms' milliseconds
@@ -106,17 +124,41 @@ class TimerDaemon final {
                                             DescriptorPtr* desc);
   // Creates a periodic timier that will first time execute the 'action'
   // 'delay_ms' milliseconds from now and then will execute the 'action' every
-  // 'period_ms' missilseconds.
-  static ::util::Status RequestPeriodicTimer(uint64 delay_ms, uint64 period_ms,
-                                             const Action& action,
-                                             DescriptorPtr* desc);
+  // 'period_ms' missilseconds. If 'batch_runner' is not nullptr, the action is
+  // run by it, together with the actions of the other timers of the runner
+  // that expire in the same tick.
+  static ::util::Status RequestPeriodicTimer(
+      uint64 delay_ms, uint64 period_ms, const Action& action,
+      DescriptorPtr* desc, const BatchRunnerPtr& batch_runner = nullptr);
 
  private:
-  TimerDaemon() : started_(false) {}
+  TimerDaemon();
+
+  // Advances the wheel to the current tick and returns the descriptors of the
+  // timers that are due.
+  std::vector<DescriptorPtr> GetActions() LOCKS_EXCLUDED(access_lock_);
+
+  // Advances the wheel up to and including 'now_tick' and returns the
+  // descriptors of the timers that expired on the way.
+  std::vector<DescriptorPtr> AdvanceTo(int64 now_tick)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Queues the actions to the worker threads, skipping the timers whose
+  // previous action has not completed yet. The timers of a batch runner are
+  // queued as one batch. Without worker threads, the actions are run by the
+  // calling thread before returning.
+  void RunActions(const std::vector<DescriptorPtr>& actions)
+      LOCKS_EXCLUDED(pool_lock_);
+
+  // Runs the next queued batch of actions. Returns false if the queue is
+  // empty.
+  bool RunNextAction() LOCKS_EXCLUDED(pool_lock_);
 
-  // If there is an action to be executed at this moment of time a non-null
-  // pointer is returned.
-  DescriptorPtr GetAction();
+  // The loop of a worker thread.
+  void WorkerLoop() LOCKS_EXCLUDED(pool_lock_);
+
+  // Returns true if a worker thread has an action to start or should exit.
+  bool WorkerShouldWake() const EXCLUSIVE_LOCKS_REQUIRED(pool_lock_);
 
   // Returns true if the timer daemon is stopped.
   bool IsStopped();
@@ -128,19 +170,61 @@ class TimerDaemon final {
   }
   // Internal method creating requested timer.
   ::util::Status RequestTimer(bool repeat, uint64 delay_ms, uint64 period_ms,
-                              Action action, DescriptorPtr* desc)
+                              Action action, DescriptorPtr* desc,
+                              const BatchRunnerPtr& batch_runner)
       LOCKS_EXCLUDED(access_lock_);
 
-  // A Mutex used to guard access to the list of pointers to timer requests and
-  // the started_ flag.
+  // Returns the first tick that starts at or after 'time'. A timer due at
+  // 'time' expires in this tick.
+  int64 DueTick(absl::Time time) const;
+
+  // Returns the last tick that started at or before 'time'.
+  int64 CurrentTick(absl::Time time) const;
+
+  // Inserts the group into the slot of the wheel that matches its due tick,
+  // or 'earliest_tick' if that is later. The group is merged into the last
+  // group of that slot if both are due in the same tick with the same period.
+  void InsertGroup(TimerGroup group, int64 earliest_tick)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Re-inserts the groups of a slot of the given level into the lower levels.
+  void Cascade(int level) EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Removes all the timers from the wheel.
+  void Clear() EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // A Mutex used to guard access to the timer wheel and the started_ flag.
   mutable absl::Mutex access_lock_;
 
-  std::vector<DescriptorWeakPtr> timers_ GUARDED_BY(access_lock_);
+  // The time of tick 0.
+  const absl::Time origin_;
+
+  // The last tick the wheel has been advanced to.
+  int64 current_tick_ GUARDED_BY(access_lock_);
+
+  // The number of timers in the wheel, including canceled ones that have not
+  // been dropped yet.
+  int64 num_timers_ GUARDED_BY(access_lock_);
+
+  std::array<std::array<Slot, kNumSlots>, kNumLevels> wheel_
+      GUARDED_BY(access_lock_);
 
   pthread_t tid_ = 0;  // will not be destroyed before the thread is joined.
 
   bool started_ GUARDED_BY(access_lock_);
 
+  // A Mutex used to guard the state of the worker pool.
+  absl::Mutex pool_lock_;
+
+  // The actions waiting for a worker thread, in the order they expired.
+  std::deque<ActionBatch> queue_ GUARDED_BY(pool_lock_);
+
+  // True if the worker threads should exit.
+  bool stop_workers_ GUARDED_BY(pool_lock_);
+
+  // The worker threads. Modified only by Start() and Stop().
+  std::vector<pthread_t> worker_tids_;
+
   friend class TimerDaemonTest;
 };
 
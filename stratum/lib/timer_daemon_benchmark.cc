@@ -0,0 +1,110 @@
+// Copyright 2021-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the TimerDaemon with as many periodic timers as gNMI SAMPLE
+// subscriptions create at scale: the cost of requesting a timer while many
+// others are scheduled, and the lateness of the timer actions, reported as the
+// p50, p99 and max of the delay between the due time and the execution of an
+// action.
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/lib/timer_daemon.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr uint64 kPeriodMs = 100;
+
+// Arguments: number of timers already scheduled.
+void BM_TimerDaemonRequestPeriodicTimer(benchmark::State& state) {
+  CHECK(TimerDaemon::Start().ok());
+  auto action = []() { return ::util::OkStatus(); };
+  std::vector<TimerDaemon::DescriptorPtr> descs(state.range(0));
+  for (auto& desc : descs) {
+    CHECK(TimerDaemon::RequestPeriodicTimer(60000, kPeriodMs, action, &desc)
+              .ok());
+  }
+  for (auto _ : state) {
+    TimerDaemon::DescriptorPtr desc;
+    CHECK(TimerDaemon::RequestPeriodicTimer(60000, kPeriodMs, action, &desc)
+              .ok());
+    // Releasing the descriptor cancels the timer.
+    desc.reset();
+  }
+  descs.clear();
+  CHECK(TimerDaemon::Stop().ok());
+}
+BENCHMARK(BM_TimerDaemonRequestPeriodicTimer)->Arg(0)->Arg(1000)->Arg(50000);
+
+// The state of a periodic timer whose lateness is sampled. The action of a
+// timer is never run concurrently with itself, so no locking is needed.
+struct SampledTimer {
+  absl::Time next_due;
+  std::vector<int64> lateness_us;
+};
+
+// Returns the given percentile of the sorted samples.
+int64 Percentile(const std::vector<int64>& sorted, double percentile) {
+  if (sorted.empty()) return 0;
+  return sorted[std::min(sorted.size() - 1,
+                         static_cast<size_t>(sorted.size() * percentile))];
+}
+
+// Arguments: number of periodic timers.
+void BM_TimerDaemonPeriodicTimerLateness(benchmark::State& state) {
+  const int num_timers = state.range(0);
+  CHECK(TimerDaemon::Start().ok());
+  std::vector<SampledTimer> timers(num_timers);
+  std::vector<TimerDaemon::DescriptorPtr> descs(num_timers);
+  for (int i = 0; i < num_timers; ++i) {
+    SampledTimer* timer = &timers[i];
+    timer->next_due = absl::Now() + absl::Milliseconds(kPeriodMs);
+    CHECK(TimerDaemon::RequestPeriodicTimer(
+              kPeriodMs, kPeriodMs,
+              [timer]() {
+                timer->lateness_us.push_back(
+                    absl::ToInt64Microseconds(absl::Now() - timer->next_due));
+                timer->next_due += absl::Milliseconds(kPeriodMs);
+                return ::util::OkStatus();
+              },
+              &descs[i])
+              .ok());
+  }
+  for (auto _ : state) {
+    absl::SleepFor(absl::Milliseconds(kPeriodMs));
+  }
+  descs.clear();
+  CHECK(TimerDaemon::Stop().ok());
+
+  std::vector<int64> lateness_us;
+  for (const auto& timer : timers) {
+    lateness_us.insert(lateness_us.end(), timer.lateness_us.begin(),
+                       timer.lateness_us.end());
+  }
+  std::sort(lateness_us.begin(), lateness_us.end());
+  state.counters["p50_lateness_us"] = Percentile(lateness_us, 0.5);
+  state.counters["p99_lateness_us"] = Percentile(lateness_us, 0.99);
+  state.counters["max_lateness_us"] =
+      lateness_us.empty() ? 0 : lateness_us.back();
+  state.counters["actions"] = lateness_us.size();
+}
+BENCHMARK(BM_TimerDaemonPeriodicTimerLateness)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(50000)
+    ->Iterations(20)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -4,6 +4,11 @@
 
 #include "stratum/lib/timer_daemon.h"
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "absl/synchronization/mutex.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/status/status_test_util.h"
@@ -38,16 +43,87 @@ class TimerDaemonTest : public ::testing::Test {
 
   void TearDown() override { ASSERT_OK(TimerDaemon::Stop()); }
 
-  TimerDaemon::DescriptorPtr GetTimerDescriptorPtr(const absl::Time when) {
-    TimerDaemon::DescriptorPtr desc = std::make_shared<TimerDaemon::Descriptor>(
-        /* repeat = */ false, []() { return ::util::OkStatus(); });
-    desc->due_time_ = when;
+  TimerDaemon::DescriptorPtr GetTimerDescriptorPtr() {
+    return std::make_shared<TimerDaemon::Descriptor>(
+        []() { return ::util::OkStatus(); });
+  }
+
+  // Returns a descriptor whose action increments 'count_', run by
+  // 'batch_runner' if it is not nullptr.
+  TimerDaemon::DescriptorPtr GetCountingTimerDescriptorPtr(
+      const TimerDaemon::BatchRunnerPtr& batch_runner) {
+    auto desc = std::make_shared<TimerDaemon::Descriptor>([this]() {
+      absl::WriterMutexLock l(&access_lock_);
+      count_++;
+      return ::util::OkStatus();
+    });
+    desc->batch_runner_ = batch_runner;
     return desc;
   }
 
-  TimerDaemon::DescriptorWeakPtr GetTimerDescriptorWeakPtr(
-      const TimerDaemon::DescriptorPtr& desc) {
-    return TimerDaemon::DescriptorWeakPtr(desc);
+  // Returns a daemon whose wheel is not advanced by the timer thread. Tests
+  // advance it with AdvanceTo() to check on which tick the timers expire.
+  std::unique_ptr<TimerDaemon> CreateManualDaemon() {
+    return std::unique_ptr<TimerDaemon>(new TimerDaemon());
+  }
+
+  // Inserts a timer due 'delay_ticks' ticks after the current tick directly
+  // into the wheel.
+  void InsertTimer(TimerDaemon* daemon, int64 delay_ticks, int64 period_ticks,
+                   const TimerDaemon::DescriptorPtr& desc) {
+    absl::WriterMutexLock l(&daemon->access_lock_);
+    TimerDaemon::TimerGroup group;
+    group.due_tick = daemon->current_tick_ + delay_ticks;
+    group.period_ticks = period_ticks;
+    group.timers.push_back(TimerDaemon::DescriptorWeakPtr(desc));
+    daemon->InsertGroup(std::move(group), daemon->current_tick_ + 1);
+  }
+
+  void InsertTimer(int64 delay_ticks, int64 period_ticks,
+                   const TimerDaemon::DescriptorPtr& desc) {
+    InsertTimer(TimerDaemon::GetInstance(), delay_ticks, period_ticks, desc);
+  }
+
+  // Advances the wheel of 'daemon' to 'tick', runs the actions of the timers
+  // that expired and returns their number.
+  int AdvanceTo(TimerDaemon* daemon, int64 tick) {
+    std::vector<TimerDaemon::DescriptorPtr> actions;
+    {
+      absl::WriterMutexLock l(&daemon->access_lock_);
+      actions = daemon->AdvanceTo(tick);
+    }
+    for (const auto& desc : actions) EXPECT_OK(desc->ExecuteAction());
+    return actions.size();
+  }
+
+  // Advances the wheel of 'daemon' to 'tick' and runs the actions of the
+  // timers that expired as the timer thread does. 'daemon' must not have
+  // worker threads, so that the actions are run by the calling thread.
+  void RunActionsOfTick(TimerDaemon* daemon, int64 tick) {
+    std::vector<TimerDaemon::DescriptorPtr> actions;
+    {
+      absl::WriterMutexLock l(&daemon->access_lock_);
+      actions = daemon->AdvanceTo(tick);
+    }
+    daemon->RunActions(actions);
+  }
+
+  // Returns the number of timer groups in the wheel.
+  int GetNumTimerGroups() {
+    TimerDaemon* daemon = TimerDaemon::GetInstance();
+    absl::WriterMutexLock l(&daemon->access_lock_);
+    int num_groups = 0;
+    for (const auto& level : daemon->wheel_) {
+      for (const auto& slot : level) num_groups += slot.size();
+    }
+    return num_groups;
+  }
+
+  // Returns the number of timers in the wheel.
+  int64 GetNumTimers() {
+    TimerDaemon* daemon = TimerDaemon::GetInstance();
+    absl::WriterMutexLock l(&daemon->access_lock_);
+    return daemon->num_timers_;
   }
 
   // A counter used to check if timers are executed in correct order. Each timer
@@ -57,63 +133,8 @@ class TimerDaemonTest : public ::testing::Test {
   int count_ GUARDED_BY(access_lock_);
   // A Mutex used to guard access to the 'count_'.
   mutable absl::Mutex access_lock_;
-
-  // A comparator used internally by the TimerSevice to compare timestamps.
-  // This class is private, so, it is instantiated here to allow access by
-  // relevant tests.
-  TimerDaemon::TimerDescriptorComparator cmp_;
 };
 
-TEST_F(TimerDaemonTest, CompareSmallerBigger) {
-  absl::Time now = absl::Now();
-  auto desc1 = GetTimerDescriptorPtr(now);
-  auto desc2 = GetTimerDescriptorPtr(now + absl::Milliseconds(10));
-
-  auto weak1 = GetTimerDescriptorWeakPtr(desc1);
-  auto weak2 = GetTimerDescriptorWeakPtr(desc2);
-
-  // 0 > 10
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc2.reset();
-  // 0 > expired 10
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc1.reset();
-  // expired 0 > expired 10
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc2 = GetTimerDescriptorPtr(now + absl::Milliseconds(10));
-  weak2 = GetTimerDescriptorWeakPtr(desc2);
-  // expired 0 > 10
-  EXPECT_TRUE(cmp_(weak1, weak2));
-}
-
-TEST_F(TimerDaemonTest, CompareBiggerSmaller) {
-  absl::Time now = absl::Now();
-  auto desc1 = GetTimerDescriptorPtr(now + absl::Milliseconds(10));
-  auto desc2 = GetTimerDescriptorPtr(now);
-
-  auto weak1 = GetTimerDescriptorWeakPtr(desc1);
-  auto weak2 = GetTimerDescriptorWeakPtr(desc2);
-
-  // 10 > 0
-  EXPECT_TRUE(cmp_(weak1, weak2));
-
-  desc2.reset();
-  // 10 > expired 0
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc1.reset();
-  // expired 10 > expired 0
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc2 = GetTimerDescriptorPtr(now);
-  weak2 = GetTimerDescriptorWeakPtr(desc2);
-  // expired 10 > 0
-  EXPECT_TRUE(cmp_(weak1, weak2));
-}
-
 TEST_F(TimerDaemonTest, CreateOneShot) {
   // This test verifies that TimerDaemon does create one-shot timer.
   TimerDaemon::DescriptorPtr desc;
@@ -151,7 +172,162 @@ TEST_F(TimerDaemonTest, CreateTwoOneShots) {
 }
 
 TEST_F(TimerDaemonTest, CreatePeriodic) {
-  // This test verifies that TimerDaemon does create periodic timer.
+  // This test verifies that a periodic timer expires once per period.
+  auto daemon = CreateManualDaemon();
+  auto desc = GetTimerDescriptorPtr();
+  InsertTimer(daemon.get(), 100, 100, desc);
+  std::vector<int64> fired;
+  for (int64 tick = 1; tick <= 1050; ++tick) {
+    if (AdvanceTo(daemon.get(), tick) > 0) fired.push_back(tick);
+  }
+  EXPECT_EQ(std::vector<int64>({100, 200, 300, 400, 500, 600, 700, 800, 900,
+                                1000}),
+            fired);
+}
+
+TEST_F(TimerDaemonTest, CancelTimer) {
+  // This test verifies that a timer does not fire once its descriptor has been
+  // released and that it is then dropped from the wheel.
+  TimerDaemon::DescriptorPtr desc;
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      100, 100,
+      [&]() {
+        absl::WriterMutexLock l(&access_lock_);
+        count_++;
+        return ::util::OkStatus();
+      },
+      &desc));
+  EXPECT_EQ(1, GetNumTimers());
+  desc.reset();
+  usleep(200000);
+  EXPECT_EQ(0, GetNumTimers());
+  absl::WriterMutexLock l(&access_lock_);
+  EXPECT_EQ(count_, 0);
+}
+
+TEST_F(TimerDaemonTest, CreateLongOneShot) {
+  // This test verifies that a timer beyond the first level of the wheel is
+  // cascaded down and fires on time.
+  auto daemon = CreateManualDaemon();
+  auto desc = GetTimerDescriptorPtr();
+  InsertTimer(daemon.get(), 700, 0, desc);
+  EXPECT_EQ(0, AdvanceTo(daemon.get(), 699));
+  EXPECT_EQ(1, AdvanceTo(daemon.get(), 700));
+  EXPECT_EQ(0, AdvanceTo(daemon.get(), 2000));
+}
+
+TEST_F(TimerDaemonTest, CascadedTimerFiresInItsTick) {
+  // This test verifies that timers which are cascaded down in the tick they
+  // are due fire in that tick.
+  auto daemon = CreateManualDaemon();
+  auto desc1 = GetTimerDescriptorPtr();
+  auto desc2 = GetTimerDescriptorPtr();
+  InsertTimer(daemon.get(), 512, 0, desc1);
+  InsertTimer(daemon.get(), 65536, 0, desc2);
+  EXPECT_EQ(0, AdvanceTo(daemon.get(), 511));
+  EXPECT_EQ(1, AdvanceTo(daemon.get(), 512));
+  EXPECT_EQ(0, AdvanceTo(daemon.get(), 65535));
+  EXPECT_EQ(1, AdvanceTo(daemon.get(), 65536));
+}
+
+TEST_F(TimerDaemonTest, CoScheduledTimersShareGroup) {
+  // This test verifies that timers due in the same tick with the same period
+  // are kept in one group.
+  auto desc1 = GetTimerDescriptorPtr();
+  auto desc2 = GetTimerDescriptorPtr();
+  auto desc3 = GetTimerDescriptorPtr();
+  InsertTimer(10000, 1000, desc1);
+  InsertTimer(10000, 1000, desc2);
+  EXPECT_EQ(1, GetNumTimerGroups());
+  InsertTimer(10000, 2000, desc3);
+  EXPECT_EQ(2, GetNumTimerGroups());
+  EXPECT_EQ(3, GetNumTimers());
+}
+
+TEST_F(TimerDaemonTest, CreateManyOneShots) {
+  // This test verifies that the actions of many timers expiring at the same
+  // time are all executed.
+  constexpr int kNumTimers = 10000;
+  std::vector<TimerDaemon::DescriptorPtr> descs(kNumTimers);
+  for (auto& desc : descs) {
+    ASSERT_OK(TimerDaemon::RequestOneShotTimer(
+        10,
+        [&]() {
+          absl::WriterMutexLock l(&access_lock_);
+          count_++;
+          return ::util::OkStatus();
+        },
+        &desc));
+  }
+  usleep(500000);
+  absl::WriterMutexLock l(&access_lock_);
+  EXPECT_EQ(count_, kNumTimers);
+}
+
+TEST_F(TimerDaemonTest, SlowActionDoesNotDelayOtherTimers) {
+  // This test verifies that the timer thread does not wait for a slow action,
+  // and that a timer whose action is still running skips its ticks instead of
+  // running concurrently with itself.
+  absl::Mutex lock;
+  bool release = false;
+  int slow_running = 0;
+  int slow_max_running = 0;
+  TimerDaemon::DescriptorPtr slow_desc, fast_desc;
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      0, 1,
+      [&]() {
+        absl::MutexLock l(&lock);
+        slow_max_running = std::max(slow_max_running, ++slow_running);
+        lock.Await(absl::Condition(&release));
+        --slow_running;
+        return ::util::OkStatus();
+      },
+      &slow_desc));
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      10, 10,
+      [&]() {
+        absl::WriterMutexLock l(&access_lock_);
+        count_++;
+        return ::util::OkStatus();
+      },
+      &fast_desc));
+  usleep(200000);
+  {
+    absl::WriterMutexLock l(&access_lock_);
+    EXPECT_GE(count_, 5);
+  }
+  slow_desc.reset();
+  fast_desc.reset();
+  absl::MutexLock l(&lock);
+  release = true;
+  auto slow_completed = [&slow_running]() { return slow_running == 0; };
+  lock.Await(absl::Condition(&slow_completed));
+  EXPECT_EQ(1, slow_max_running);
+}
+
+TEST_F(TimerDaemonTest, TimersOfBatchRunnerRunTogether) {
+  // This test verifies that the timers of a batch runner which expire in the
+  // same tick are given to the runner together, and that the other timers are
+  // run on their own.
+  auto daemon = CreateManualDaemon();
+  std::vector<size_t> batch_sizes;
+  auto runner = std::make_shared<TimerDaemon::BatchRunner>(
+      [&batch_sizes](const std::vector<TimerDaemon::DescriptorPtr>& timers) {
+        batch_sizes.push_back(timers.size());
+        for (const auto& desc : timers) RETURN_IF_ERROR(desc->ExecuteAction());
+        return ::util::OkStatus();
+      });
+  auto desc1 = GetCountingTimerDescriptorPtr(runner);
+  auto desc2 = GetCountingTimerDescriptorPtr(runner);
+  auto desc3 = GetCountingTimerDescriptorPtr(nullptr);
+  // Timers with different periods are in different groups.
+  InsertTimer(daemon.get(), 10, 10, desc1);
+  InsertTimer(daemon.get(), 10, 20, desc2);
+  InsertTimer(daemon.get(), 10, 10, desc3);
+  RunActionsOfTick(daemon.get(), 10);
+  EXPECT_EQ(std::vector<size_t>({2}), batch_sizes);
+  absl::WriterMutexLock l(&access_lock_);
+  EXPECT_EQ(3, count_);
 }
 
 TEST_F(TimerDaemonTest, StartIdempotent) {
@@ -1,24 +1,32 @@
 // Copyright 2020-present Open Networking Foundation
 // SPDX-License-Identifier: Apache-2.0
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
+#include "google/rpc/status.pb.h"
 #include "grpcpp/grpcpp.h"
 #include "grpcpp/security/credentials.h"
 #include "grpcpp/security/tls_credentials_options.h"
 #include "p4/v1/p4runtime.grpc.pb.h"
 #include "p4/v1/p4runtime.pb.h"
-#include "re2/re2.h"
 #include "stratum/glue/gtl/map_util.h"
 #include "stratum/glue/init_google.h"
+#include "stratum/glue/integral_types.h"
 #include "stratum/glue/logging.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/p4/forwarding_pipeline_configs.pb.h"
+#include "stratum/hal/lib/p4/p4_request_journal.h"
 #include "stratum/hal/lib/p4/utils.h"
 #include "stratum/lib/constants.h"
 #include "stratum/lib/macros.h"
@@ -31,21 +39,224 @@ DEFINE_string(pipeline_cfg, "pipeline_cfg.pb.txt", "The pipeline config file.");
 DEFINE_string(election_id, "0,1",
               "Election id for arbitration update (high,low).");
 DEFINE_uint64(device_id, 1, "P4Runtime device ID.");
+DEFINE_int32(batch_size, 0,
+             "Number of updates per write request. The updates of the journal "
+             "are re-batched into requests of this size. 0 keeps the original "
+             "requests.");
+DEFINE_int32(max_outstanding_writes, 1,
+             "Max number of write requests in flight at any time. Values "
+             "above 1 can reorder the updates of concurrent requests.");
+DEFINE_double(timing_scale, 0,
+              "Replays the requests at the original pace, with the time "
+              "between two requests multiplied by this factor. 1 replays at "
+              "the original pace, 0.5 twice as fast. 0 sends the requests as "
+              "fast as possible.");
 
 namespace stratum {
 namespace tools {
 namespace p4rt_replay {
 
 const char kUsage[] = R"USAGE(
-Usage: stratum_replay [options] [p4runtime write log file]
+Usage: stratum_replay [options] [p4runtime write request journal]
   This tool replays P4Runtime write requests to a Stratum device from a given
-  Stratum P4Runtime write request log.
+  Stratum P4Runtime write request journal. It can also be used as a load
+  generator: the updates can be re-batched, sent with many write requests in
+  flight and at a scaled pace. The write latency and throughput are reported
+  at the end.
 )USAGE";
 
 using ClientStreamChannelReaderWriter =
     ::grpc::ClientReaderWriter<::p4::v1::StreamMessageRequest,
                                ::p4::v1::StreamMessageResponse>;
 
+// A write request to replay, with the results of its updates in the journal.
+struct WriteBatch {
+  ::p4::v1::WriteRequest req;
+  // The expected error message of each update, empty for success.
+  std::vector<std::string> expected_errors;
+  // The time the first update of the batch was originally sent.
+  absl::Time timestamp;
+};
+
+// A write request in flight.
+struct PendingWrite {
+  const WriteBatch* batch;
+  ::grpc::ClientContext context;
+  ::p4::v1::WriteResponse resp;
+  ::grpc::Status status;
+  std::unique_ptr<::grpc::ClientAsyncResponseReader<::p4::v1::WriteResponse>>
+      reader;
+  absl::Time start_time;
+};
+
+// Reads the write requests of the journal at the given path. If 'batch_size'
+// is positive, the updates are re-batched into requests of that many updates.
+::util::StatusOr<std::vector<WriteBatch>> ReadWriteBatches(
+    const std::string& path, int batch_size, absl::uint128 election_id) {
+  std::vector<WriteBatch> batches;
+  RETURN_IF_ERROR(::stratum::hal::P4RequestJournal::ReadEntries(
+      path,
+      [&](const ::stratum::hal::P4RequestJournalEntry& entry)
+          -> ::util::Status {
+        if (!entry.has_write_request()) return ::util::OkStatus();
+        const auto& req = entry.write_request();
+        for (int i = 0; i < req.updates_size(); ++i) {
+          // Updates of different roles are never batched together.
+          bool new_batch = batches.empty() ||
+                           batches.back().req.role() != req.role() ||
+                           (batch_size > 0 &&
+                            batches.back().req.updates_size() >= batch_size) ||
+                           (batch_size <= 0 && i == 0);
+          if (new_batch) {
+            batches.emplace_back();
+            WriteBatch& batch = batches.back();
+            batch.req.set_device_id(FLAGS_device_id);
+            batch.req.set_role(req.role());
+            batch.req.mutable_election_id()->set_high(
+                absl::Uint128High64(election_id));
+            batch.req.mutable_election_id()->set_low(
+                absl::Uint128Low64(election_id));
+            batch.timestamp = absl::FromUnixMicros(entry.timestamp_us());
+          }
+          WriteBatch& batch = batches.back();
+          *batch.req.add_updates() = req.updates(i);
+          batch.expected_errors.push_back(
+              i < entry.results_size() ? entry.results(i).error_message() : "");
+        }
+        return ::util::OkStatus();
+      }));
+
+  return batches;
+}
+
+// Compares the status of a replayed write request with the expected results.
+// Only an unexpected error fails the replay. Other mismatches are reported as
+// warnings.
+::util::Status CheckWriteStatus(const WriteBatch& batch,
+                                const ::grpc::Status& status) {
+  std::vector<std::string> expected_errors;
+  for (const auto& error : batch.expected_errors) {
+    if (!error.empty()) expected_errors.push_back(error);
+  }
+  if (expected_errors.empty()) {
+    RET_CHECK(status.ok()) << "Failed to send P4Runtime write request: "
+                           << batch.req.ShortDebugString() << "\n"
+                           << ::stratum::hal::P4RuntimeGrpcStatusToString(
+                                  status);
+    return ::util::OkStatus();
+  }
+  if (status.ok()) {
+    LOG(WARNING) << "Expect to get an error, but the request succeeded.\n"
+                 << "Expected errors: " << absl::StrJoin(expected_errors, "; ")
+                 << "\n"
+                 << "Request: " << batch.req.ShortDebugString();
+    return ::util::OkStatus();
+  }
+  ::google::rpc::Status details;
+  RET_CHECK(details.ParseFromString(status.error_details()))
+      << "Failed to parse error details from gRPC status.";
+  int num_details =
+      std::min({details.details_size(), batch.req.updates_size(),
+                static_cast<int>(batch.expected_errors.size())});
+  for (int i = 0; i < num_details; ++i) {
+    ::p4::v1::Error detail;
+    RET_CHECK(details.details(i).UnpackTo(&detail))
+        << "Failed to parse the P4Runtime error from detail message.";
+    const std::string& error_msg = batch.expected_errors[i];
+    if (detail.message() != error_msg) {
+      LOG(WARNING) << "The expected error message is different "
+                      "to the actual error message:\n"
+                   << "Expected: " << error_msg << "\n"
+                   << "Actual: " << detail.message() << "\n"
+                   << "Update: " << batch.req.updates(i).ShortDebugString();
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+// Returns the given percentile of the sorted latencies.
+absl::Duration Percentile(const std::vector<absl::Duration>& sorted,
+                          double percentile) {
+  if (sorted.empty()) return absl::ZeroDuration();
+  size_t index = static_cast<size_t>(percentile / 100 * sorted.size());
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Waits for the next write request in flight to complete, records its latency
+// and checks its status.
+::util::Status CompleteWrite(::grpc::CompletionQueue* cq,
+                             std::vector<absl::Duration>* latencies) {
+  void* tag;
+  bool ok;
+  RET_CHECK(cq->Next(&tag, &ok)) << "Completion queue shut down.";
+  std::unique_ptr<PendingWrite> pending(static_cast<PendingWrite*>(tag));
+  latencies->push_back(absl::Now() - pending->start_time);
+  RET_CHECK(ok) << "Write request did not complete.";
+
+  return CheckWriteStatus(*pending->batch, pending->status);
+}
+
+// Sends the write requests to the switch, keeping up to
+// FLAGS_max_outstanding_writes requests in flight, and reports the write
+// latency and throughput.
+::util::Status ReplayWriteBatches(::p4::v1::P4Runtime::Stub* stub,
+                                  const std::vector<WriteBatch>& batches) {
+  RET_CHECK(FLAGS_max_outstanding_writes > 0)
+      << "Invalid max number of outstanding writes.";
+  RET_CHECK(FLAGS_timing_scale >= 0) << "Invalid timing scale.";
+  ::grpc::CompletionQueue cq;
+  std::vector<absl::Duration> latencies;
+  latencies.reserve(batches.size());
+  ::util::Status status = ::util::OkStatus();
+  int num_outstanding = 0;
+  int64 num_updates = 0;
+  const absl::Time start_time = absl::Now();
+  for (const auto& batch : batches) {
+    if (FLAGS_timing_scale > 0) {
+      absl::Duration offset =
+          (batch.timestamp - batches.front().timestamp) * FLAGS_timing_scale;
+      absl::SleepFor(start_time + offset - absl::Now());
+    }
+    if (num_outstanding >= FLAGS_max_outstanding_writes) {
+      APPEND_STATUS_IF_ERROR(status, CompleteWrite(&cq, &latencies));
+      --num_outstanding;
+    }
+    // Stop sending requests after the first failure.
+    if (!status.ok()) break;
+    auto* pending = new PendingWrite();
+    pending->batch = &batch;
+    pending->start_time = absl::Now();
+    VLOG(1) << "Sending request " << batch.req.DebugString();
+    pending->reader = stub->AsyncWrite(&pending->context, batch.req, &cq);
+    pending->reader->Finish(&pending->resp, &pending->status, pending);
+    ++num_outstanding;
+    num_updates += batch.req.updates_size();
+  }
+  // Wait for all the requests in flight, also after a failure.
+  for (; num_outstanding > 0; --num_outstanding) {
+    APPEND_STATUS_IF_ERROR(status, CompleteWrite(&cq, &latencies));
+  }
+  const absl::Duration elapsed = absl::Now() - start_time;
+  cq.Shutdown();
+  RETURN_IF_ERROR(status);
+
+  std::sort(latencies.begin(), latencies.end());
+  const double seconds = absl::ToDoubleSeconds(elapsed);
+  LOG(INFO) << "Sent " << latencies.size() << " write requests with "
+            << num_updates << " updates in " << elapsed << " ("
+            << (seconds > 0 ? num_updates / seconds : 0) << " updates/s, "
+            << (seconds > 0 ? latencies.size() / seconds : 0)
+            << " requests/s).";
+  LOG(INFO) << "Write latency: p50 " << Percentile(latencies, 50) << ", p99 "
+            << Percentile(latencies, 99) << ", p999 "
+            << Percentile(latencies, 99.9) << ", max "
+            << (latencies.empty() ? absl::ZeroDuration() : latencies.back())
+            << ".";
+
+  return ::util::OkStatus();
+}
+
 ::util::Status Main(int argc, char** argv) {
   if (argc < 2) {
     LOG(INFO) << kUsage;
@@ -117,72 +328,11 @@ using ClientStreamChannelReaderWriter =
                                   status);
   }
 
-  // Parse the P4Runtime write log file and send write requests to the
-  // target device.
-  std::string p4_write_logs;
-  RETURN_IF_ERROR(::stratum::ReadFileToString(argv[1], &p4_write_logs));
-  std::vector<std::string> lines =
-      absl::StrSplit(p4_write_logs, '\n', absl::SkipEmpty());
-  for (const std::string& line : lines) {
-    ::p4::v1::WriteRequest write_req;
-    ::p4::v1::WriteResponse write_resp;
-    // Log format: <timestamp>;<node_id>;<update proto>;<status>
-    // This regular expression contains 4 sub-match groups which extracts
-    // elements from the log string. See LogWriteRequest() in P4Service.
-    RE2 write_req_regex(
-        "(\\d{4}-\\d{1,2}-\\d{1,2} "
-        "\\d{1,2}:\\d{1,2}:\\d{1,2}\\.\\d{6});(\\d+);(type[^;]*);(.*)");
-
-    std::string write_request_text;
-    std::string error_msg;
-    if (!RE2::FullMatch(line, write_req_regex, nullptr, nullptr,
-                        &write_request_text, &error_msg)) {
-      // Can not find what we want in this line.
-      LOG(ERROR) << "Unable to find write request message, skip: " << line;
-      continue;
-    }
-
-    auto update = write_req.add_updates();
-    RETURN_IF_ERROR(ParseProtoFromString(write_request_text, update));
-    write_req.set_device_id(FLAGS_device_id);
-    write_req.mutable_election_id()->set_high(absl::Uint128High64(election_id));
-    write_req.mutable_election_id()->set_low(absl::Uint128Low64(election_id));
-    VLOG(1) << "Sending request " << write_req.DebugString();
-    ::grpc::ClientContext context;
-    status = stub->Write(&context, write_req, &write_resp);
-
-    if (!error_msg.empty()) {
-      // Here we expect to get an error, since we only send one update per
-      // write request, all we need to do is to check the first error detail.
-      // For now, we only show the message if there is an error instead of
-      // return with an error status.
-      if (status.ok()) {
-        LOG(WARNING) << "Expect to get an error, but the request succeeded.\n"
-                     << "Expected error: " << error_msg << "\n"
-                     << "Request: " << write_req.ShortDebugString();
-      } else {
-        ::google::rpc::Status details;
-        RET_CHECK(details.ParseFromString(status.error_details()))
-            << "Failed to parse error details from gRPC status.";
-        if (details.details_size() != 0) {
-          ::p4::v1::Error detail;
-          RET_CHECK(details.details(0).UnpackTo(&detail))
-              << "Failed to parse the P4Runtime error from detail message.";
-          if (detail.message() != error_msg) {
-            LOG(WARNING) << "The expected error message is different "
-                            "to the actual error message:\n"
-                         << "Expected: " << error_msg << "\n"
-                         << "Actual: " << detail.message();
-          }
-        }
-      }
-    } else {
-      RET_CHECK(status.ok())
-          << "Failed to send P4Runtime write request: "
-          << write_req.ShortDebugString() << "\n"
-          << ::stratum::hal::P4RuntimeGrpcStatusToString(status);
-    }
-  }
+  // Read the P4Runtime request journal and replay the write requests to the
+  // target device, in the order they were originally sent.
+  ASSIGN_OR_RETURN(const auto batches,
+                   ReadWriteBatches(argv[1], FLAGS_batch_size, election_id));
+  RETURN_IF_ERROR(ReplayWriteBatches(stub.get(), batches));
 
   LOG(INFO) << "Done";
   return ::util::OkStatus();
@@ -214,7 +214,7 @@ nodes {{
             '-external_stratum_urls=0.0.0.0:%d' % self.grpcPort,
             '-local_stratum_url=localhost:%d' % pickUnusedPort(),
             '-max_num_controllers_per_node=%d' % MAX_CONTROLLERS_PER_NODE,
-            '-write_req_log_file=%s/write-reqs.txt' % self.tmpDir,
+            '-write_req_log_file=%s/write-reqs.bin' % self.tmpDir,
             '-bmv2_log_level=%s' % self.loglevel,
         ]
 